@@ -29,6 +29,33 @@ Application::Application(HINSTANCE hInstance, const wchar_t* windowTitle, int wi
 	SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
 	EnableDebugLayer();
+
+	// Threads
+	{
+		// Pin the WndProc thread (Update & Render) and size the worker pools by the 
+		//		physical cores - SMT siblings share the execution units of a core, 
+		//		two workers on one core mostly fight over its caches.
+		m_CpuTopology = CpuTopology::Query();
+		m_AffinityPolicy = std::make_shared<ThreadAffinityPolicy>(m_CpuTopology, AffinityPolicy::PhysicalCores);
+		m_AffinityPolicy->ApplyToCurrentThread(ThreadRole::Render);
+
+		std::shared_ptr<ThreadAffinityPolicy> policy = m_AffinityPolicy;
+
+		// Task scheduler - worker indices start at 1 (0 is this thread).
+		m_TaskScheduler = std::make_shared<TaskScheduler>(policy->GetNumThreads(ThreadRole::Worker), [policy](uint32_t workerIndex) {
+			policy->ApplyToCurrentThread(ThreadRole::Worker, workerIndex - 1);
+		});
+		// Job system - fiber pool + its own workers, on cores the task scheduler doesn't use.
+		m_JobSystem = std::make_shared<JobSystem>(policy->GetNumThreads(ThreadRole::JobWorker), 128, 64 * 1024, [policy](uint32_t workerIndex) {
+			policy->ApplyToCurrentThread(ThreadRole::JobWorker, workerIndex);
+		});
+		// File I/O thread - mostly waits for the disk, it gets the streaming core.
+		AsyncFileIO::Settings fileIOSettings;
+		fileIOSettings.onThreadStart = [policy]() {
+			policy->ApplyToCurrentThread(ThreadRole::Streaming);
+		};
+		m_FileIO = std::make_shared<AsyncFileIO>(fileIOSettings);
+	}
 	
 	// DirectX 12 objects
 	{	
@@ -42,6 +69,11 @@ Application::Application(HINSTANCE hInstance, const wchar_t* windowTitle, int wi
 			m_DirectCommandQueue  = std::make_shared<CommandQueue> (m_d3d12Device, D3D12_COMMAND_LIST_TYPE_DIRECT);
 			m_ComputeCommandQueue = std::make_shared<CommandQueue> (m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COMPUTE);
 			m_CopyCommandQueue    = std::make_shared<CommandQueue> (m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COPY);
+
+			// Sources are read from Shaders/, compiled bytecode goes to ShaderCache/.
+			m_ShaderCache = std::make_shared<ShaderCache>("ShaderCache", std::make_shared<ShaderCompiler>(),
+				std::vector<std::string>(1, "Shaders"));
+			m_MipGenerator = std::make_shared<MipGenerator>(m_d3d12Device, m_ComputeCommandQueue, *m_ShaderCache);
 		}
 	}
 
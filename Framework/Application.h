@@ -20,7 +20,13 @@ using namespace Microsoft::WRL;
 
 // Framework
 #include "Window.h"
+#include "AsyncFileIO.h"
 #include "CommandQueue.h"
+#include "MipGenerator.h"
+#include "ShaderCache.h"
+#include "TaskScheduler.h"
+#include "JobSystem.h"
+#include "CpuTopology.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -64,7 +70,14 @@ protected:
 	UINT32 GetClientWidth() const { return m_Window->GetClientWidth(); }
 	UINT32 GetClientHeight() const { return m_Window->GetClientHeight(); }
 	ComPtr<ID3D12Device2> GetDevice() const { return m_d3d12Device; }
+	std::shared_ptr<TaskScheduler> GetTaskScheduler() const { return m_TaskScheduler; }
+	std::shared_ptr<JobSystem> GetJobSystem() const { return m_JobSystem; }
+	const CpuTopology& GetCpuTopology() const { return m_CpuTopology; }
+	std::shared_ptr<ThreadAffinityPolicy> GetAffinityPolicy() const { return m_AffinityPolicy; }
+	std::shared_ptr<AsyncFileIO> GetFileIO() const { return m_FileIO; }
 	std::shared_ptr<CommandQueue> GetCommandQueue(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) const;
+	std::shared_ptr<MipGenerator> GetMipGenerator() const { return m_MipGenerator; }
+	std::shared_ptr<ShaderCache> GetShaderCache() const { return m_ShaderCache; }
 	UINT GetCurrentBackbufferIndex() const { return m_Window->GetCurrentBackBufferIndex(); }
 	ComPtr<ID3D12Resource> GetBackbuffer(UINT BackBufferIndex);
 	CD3DX12_CPU_DESCRIPTOR_HANDLE GetCurrentBackbufferRTV();
@@ -85,6 +98,25 @@ private:
 	// APP instance handle
 	HINSTANCE m_hInstance;
 
+	// CPU topology and where our threads run:
+	//   The WndProc (render) thread gets the first performance core,
+	//   the worker pools are sized by the physical cores.
+	CpuTopology m_CpuTopology;
+	std::shared_ptr<ThreadAffinityPolicy> m_AffinityPolicy = nullptr;
+
+	// Worker threads:
+	//   Created on the WndProc thread, which makes that thread worker 0 -
+	//   Update and Render can spawn tasks and help executing them.
+	std::shared_ptr<TaskScheduler> m_TaskScheduler = nullptr;
+	// Fiber based jobs:
+	//   For deep job graphs - jobs can wait on counters without 
+	//   blocking a thread. Workers sleep while there are no jobs.
+	std::shared_ptr<JobSystem> m_JobSystem = nullptr;
+	// File reads:
+	//   Asynchronous and prioritized on their own thread (ThreadRole::Streaming),
+	//   so neither Update/Render nor the workers block on the disk.
+	std::shared_ptr<AsyncFileIO> m_FileIO = nullptr;
+
 	// DirectX 12 Objects
 	ComPtr<ID3D12Device2> m_d3d12Device;
 
@@ -93,6 +125,12 @@ private:
 	std::shared_ptr<CommandQueue> m_ComputeCommandQueue = nullptr;
 	std::shared_ptr<CommandQueue> m_CopyCommandQueue = nullptr;
 
+	// Shaders compiled at runtime (DXC), cached on disk by source hash.
+	std::shared_ptr<ShaderCache> m_ShaderCache = nullptr;
+
+	// Mips of textures rendered at runtime, on the compute queue.
+	std::shared_ptr<MipGenerator> m_MipGenerator = nullptr;
+
 	// Heap with RTVs
 	ComPtr<ID3D12DescriptorHeap> m_RTVDescriptorHeap;
 	UINT m_RTVDescriptorSize;
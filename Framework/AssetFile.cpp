@@ -0,0 +1,276 @@
+#include "AssetFile.h"
+
+#include <algorithm> // std::min
+#include <cstdint>
+#include <cstring>   // std::memcpy
+#include <memory>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	// Bounce buffer of reads whose destination isn't aligned like the file offset.
+	constexpr size_t BOUNCE_SIZE = 256 * 1024;
+	// Largest single request - a DWORD on Windows, and big requests don't go faster.
+	constexpr size_t MAX_REQUEST_SIZE = size_t(1) << 30;
+
+	static_assert((ASSET_FILE_IO_ALIGNMENT & (ASSET_FILE_IO_ALIGNMENT - 1)) == 0, "Must be a power of 2.");
+	static_assert(BOUNCE_SIZE % ASSET_FILE_IO_ALIGNMENT == 0, "Whole blocks only.");
+
+	// Aligned scratch memory without an aligned allocator: over-allocate and round up.
+	class BounceBuffer
+	{
+	public:
+		uint8_t* Get(size_t size)
+		{
+			if (size > m_Size)
+			{
+				m_Memory.reset(new uint8_t[size + ASSET_FILE_IO_ALIGNMENT]);
+				const uintptr_t address = reinterpret_cast<uintptr_t>(m_Memory.get());
+				m_Data = reinterpret_cast<uint8_t*>((address + ASSET_FILE_IO_ALIGNMENT - 1) & ~uintptr_t(ASSET_FILE_IO_ALIGNMENT - 1));
+				m_Size = size;
+			}
+			return m_Data;
+		}
+
+	private:
+		std::unique_ptr<uint8_t[]> m_Memory;
+		uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+}
+
+
+// =====================================================================================
+//										Open / Close
+// =====================================================================================
+
+AssetFile::~AssetFile()
+{
+	Close();
+}
+
+bool AssetFile::Open(const char* path, AssetFileMode mode)
+{
+	Close();
+
+	if (mode == AssetFileMode::Mapped)
+	{
+		// Uploads walk a file front to back.
+		if (!m_Mapping.Open(path, true))
+			return false;
+		m_Size = m_Mapping.GetSize();
+		m_Mode = mode;
+		m_Open = true;
+		return true;
+	}
+
+#if defined(_WIN32)
+	const int length = ::MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::vector<wchar_t> widePath(length > 0 ? length : 1, L'\0');
+	::MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+
+	HANDLE file = ::CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(file, &size))
+	{
+		::CloseHandle(file);
+		return false;
+	}
+	m_File = reinterpret_cast<intptr_t>(file);
+	m_Size = uint64_t(size.QuadPart);
+#else
+	int flags = O_RDONLY | O_CLOEXEC;
+#if defined(O_DIRECT)
+	flags |= O_DIRECT;
+#endif
+	int file = ::open(path, flags);
+	if (file < 0 && errno == EINVAL)
+	{
+		// The file system can't do direct I/O (tmpfs): same reads, through the page cache.
+		file = ::open(path, O_RDONLY | O_CLOEXEC);
+	}
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (::fstat(file, &status) != 0 || !S_ISREG(status.st_mode))
+	{
+		::close(file);
+		return false;
+	}
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+	// macOS: no O_DIRECT, but the same effect per descriptor.
+	::fcntl(file, F_NOCACHE, 1);
+#endif
+	m_File = file;
+	m_Size = uint64_t(status.st_size);
+#endif
+
+	m_Mode = mode;
+	m_Open = true;
+	return true;
+}
+
+void AssetFile::Close()
+{
+	m_Mapping.Close();
+	if (m_File != INVALID_FILE)
+	{
+#if defined(_WIN32)
+		::CloseHandle(reinterpret_cast<HANDLE>(m_File));
+#else
+		::close(int(m_File));
+#endif
+		m_File = INVALID_FILE;
+	}
+
+	m_Size = 0;
+	m_Mode = AssetFileMode::Mapped;
+	m_Open = false;
+}
+
+// =====================================================================================
+//										Read
+// =====================================================================================
+
+size_t AssetFile::ReadBlocks(uint64_t offset, uint8_t* destination, size_t size) const
+{
+	size_t total = 0;
+	while (total < size)
+	{
+		const size_t request = std::min(size - total, MAX_REQUEST_SIZE);
+#if defined(_WIN32)
+		// An explicit offset makes ReadFile positional - no shared file pointer to race on.
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = DWORD(offset);
+		overlapped.OffsetHigh = DWORD(offset >> 32);
+		DWORD read = 0;
+		if (!::ReadFile(reinterpret_cast<HANDLE>(m_File), destination + total, DWORD(request), &read, &overlapped))
+		{
+			if (::GetLastError() == ERROR_HANDLE_EOF)
+				break;
+			return SIZE_MAX;
+		}
+#else
+		const ssize_t read = ::pread(int(m_File), destination + total, request, off_t(offset));
+		if (read < 0 && errno == EINTR)
+			continue;
+		if (read < 0)
+			return SIZE_MAX;
+#endif
+		if (read == 0)
+			break;
+		total += size_t(read);
+		offset += uint64_t(read);
+		// A short read of an aligned request only happens at the end of the file.
+		if (size_t(read) % ASSET_FILE_IO_ALIGNMENT != 0)
+			break;
+	}
+	return total;
+}
+
+bool AssetFile::Read(uint64_t offset, void* destination, size_t size) const
+{
+	if (!m_Open || offset > m_Size || size > m_Size - offset)
+		return false;
+	if (size == 0)
+		return true;
+
+	if (m_Mode == AssetFileMode::Mapped)
+	{
+		// The one copy of the mapped path: page cache -> destination.
+		std::memcpy(destination, m_Mapping.GetData() + offset, size);
+		return true;
+	}
+
+	constexpr uint64_t ALIGNMENT_MASK = ASSET_FILE_IO_ALIGNMENT - 1;
+	uint8_t* out = static_cast<uint8_t*>(destination);
+	// Congruent: the destination can be read into directly once the offset is aligned.
+	const bool congruent = (reinterpret_cast<uintptr_t>(out) & ALIGNMENT_MASK) == (offset & ALIGNMENT_MASK);
+	BounceBuffer bounce;
+
+	while (size > 0)
+	{
+		if (congruent && (offset & ALIGNMENT_MASK) == 0 && size >= ASSET_FILE_IO_ALIGNMENT)
+		{
+			// The middle of the read: straight from the disk to the destination.
+			const size_t direct = size_t(size & ~ALIGNMENT_MASK);
+			if (ReadBlocks(offset, out, direct) != direct)
+				return false;
+			out += direct;
+			offset += direct;
+			size -= direct;
+			continue;
+		}
+
+		// A partial first or last block, or a chunk of a misaligned read: through the
+		//		bounce buffer, reading the whole blocks around it.
+		const uint64_t blockOffset = offset & ~ALIGNMENT_MASK;
+		const size_t skip = size_t(offset - blockOffset);
+		const size_t limit = congruent ? ASSET_FILE_IO_ALIGNMENT : BOUNCE_SIZE;
+		const size_t chunk = std::min(size, limit - skip);
+		const size_t blockSize = size_t((skip + chunk + ALIGNMENT_MASK) & ~ALIGNMENT_MASK);
+
+		uint8_t* blocks = bounce.Get(limit);
+		const size_t read = ReadBlocks(blockOffset, blocks, blockSize);
+		if (read == SIZE_MAX || read < skip + chunk)
+			return false;
+		std::memcpy(out, blocks + skip, chunk);
+		out += chunk;
+		offset += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+// =====================================================================================
+//										Package table
+// =====================================================================================
+
+bool ReadAssetPackageTable(const AssetFile& file, AssetPackageHeader& header, std::vector<AssetSection>& sections)
+{
+	sections.clear();
+	if (!file.Read(0, &header, sizeof(header)) ||
+		!AssetPackageView::IsValidHeader(header) || header.fileSize != file.GetSize())
+		return false;
+
+	const uint64_t size = file.GetSize();
+	const uint64_t tableEnd = sizeof(AssetPackageHeader) + uint64_t(header.sectionCount) * sizeof(AssetSection);
+	if (tableEnd > size)
+		return false;
+
+	sections.resize(header.sectionCount);
+	if (!file.Read(sizeof(AssetPackageHeader), sections.data(), sections.size() * sizeof(AssetSection)))
+		return false;
+
+	// Same checks as AssetPackageView::Open - offsets from here go straight to Read().
+	for (const AssetSection& section : sections)
+	{
+		if (section.offset % ASSET_SECTION_ALIGNMENT != 0 || section.offset < tableEnd ||
+			section.offset > size || section.size > size - section.offset)
+		{
+			sections.clear();
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AssetPackage.h"
+#include "MappedFile.h"
+
+// =====================================================================================
+//										Asset files
+// =====================================================================================
+
+// How an AssetFile gets its bytes to the destination (normally upload heap memory):
+//
+//		Mapped		the file is mapped (MappedFile), Read() is one memcpy from the mapped
+//					pages. Pages the OS already cached are not read again - the best choice
+//					for small files and files that are loaded more than once.
+//		Unbuffered	FILE_FLAG_NO_BUFFERING / O_DIRECT: the disk DMAs straight into the
+//					destination, bypassing the OS file cache - no copy at all for the
+//					aligned part of a read. For big, load-once data (texture mips, streamed
+//					meshes) that would only evict more useful pages from the cache.
+enum class AssetFileMode : uint8_t
+{
+	Mapped,
+	Unbuffered,
+};
+
+// Unbuffered reads must start at, and cover, whole multiples of the volume's sector size,
+//		into memory aligned the same way. 4096 covers the sector size of every current disk
+//		(512 byte and 4K native) and the page size, so it is used everywhere.
+constexpr size_t ASSET_FILE_IO_ALIGNMENT = 4096;
+
+// A cooked asset file opened for reading into memory the caller provides - the way to get
+//		package sections into upload memory without the file being read into a heap buffer
+//		first (FrameUploadBuffer::AllocateAndRead does the placement).
+//
+// Read() accepts any offset, size and destination in both modes. In Unbuffered mode the
+//		part of the read where the destination and the file offset are both on a 4K boundary
+//		goes straight to the destination; the rest (a partial first and last page, or all
+//		of it if the two are misaligned to each other) is bounced through a small aligned
+//		buffer. Destinations at the same offset modulo 4096 as the file offset are read
+//		without the bounce.
+//
+// Read() is const and may be called from several threads at once (positional reads, no
+//		shared file pointer).
+class AssetFile
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	AssetFile() = default;
+	~AssetFile();
+	AssetFile(const AssetFile&) = delete;
+	AssetFile& operator=(const AssetFile&) = delete;
+
+	// UTF-8 path. False if the file doesn't exist or can't be opened. Unbuffered falls back
+	//		to buffered reads where the file system has no unbuffered I/O (tmpfs, some
+	//		network shares) - GetMode() still reports Unbuffered, the placement rules are
+	//		the same.
+	bool Open(const char* path, AssetFileMode mode = AssetFileMode::Mapped);
+	void Close();
+
+	bool IsOpen() const { return m_Open; }
+	AssetFileMode GetMode() const { return m_Mode; }
+	uint64_t GetSize() const { return m_Size; }
+	// The whole file in Mapped mode (AssetPackageView::Open can work on it), nullptr in
+	//		Unbuffered mode.
+	const uint8_t* GetMappedData() const { return m_Mapping.GetData(); }
+
+	// Copies [offset, offset + size) of the file to "destination". False if the range is
+	//		outside the file or the read fails.
+	bool Read(uint64_t offset, void* destination, size_t size) const;
+
+private:
+	// Unbuffered read of whole aligned blocks; returns the number of bytes read, less than
+	//		"size" only at the end of the file. SIZE_MAX on errors.
+	size_t ReadBlocks(uint64_t offset, uint8_t* destination, size_t size) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	static constexpr intptr_t INVALID_FILE = -1;
+
+	MappedFile m_Mapping;
+	// HANDLE on Windows, file descriptor elsewhere - Unbuffered mode only.
+	intptr_t m_File = INVALID_FILE;
+	uint64_t m_Size = 0;
+	AssetFileMode m_Mode = AssetFileMode::Mapped;
+	bool m_Open = false;
+};
+
+// Reads and checks the header and section table of a package without reading the rest:
+//		every section must lie within the file. In Mapped mode AssetPackageView::Open on
+//		GetMappedData() does the same without copying.
+bool ReadAssetPackageTable(const AssetFile& file, AssetPackageHeader& header, std::vector<AssetSection>& sections);
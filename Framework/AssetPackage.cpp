@@ -0,0 +1,135 @@
+#include "AssetPackage.h"
+
+#include <cassert>
+#include <cstring> // std::memcpy
+
+
+// =====================================================================================
+//										Writer
+// =====================================================================================
+
+AssetPackageWriter::AssetPackageWriter(AssetType type, uint64_t settingsHash)
+	: m_Type(type)
+	, m_SettingsHash(settingsHash)
+{
+}
+
+void AssetPackageWriter::AddSection(SectionType type, const void* data, size_t size)
+{
+	PendingSection section;
+	section.type = type;
+	section.data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	m_Sections.push_back(std::move(section));
+}
+
+uint64_t AssetPackageWriter::GetSize() const
+{
+	uint64_t size = sizeof(AssetPackageHeader) + m_Sections.size() * sizeof(AssetSection);
+	for (const PendingSection& section : m_Sections)
+	{
+		size = AlignAssetOffset(size) + section.data.size();
+	}
+	return size;
+}
+
+void AssetPackageWriter::Serialize(std::vector<uint8_t>& out) const
+{
+	// Padding is zeroed, so identical input always gives identical files.
+	out.assign(static_cast<size_t>(GetSize()), 0);
+
+	AssetPackageHeader header = {};
+	header.magic = ASSET_PACKAGE_MAGIC;
+	header.version = ASSET_PACKAGE_VERSION;
+	header.type = m_Type;
+	header.sectionCount = static_cast<uint32_t>(m_Sections.size());
+	header.settingsHash = m_SettingsHash;
+	header.fileSize = out.size();
+	std::memcpy(out.data(), &header, sizeof(header));
+
+	uint64_t offset = sizeof(AssetPackageHeader) + m_Sections.size() * sizeof(AssetSection);
+	for (size_t i = 0; i < m_Sections.size(); ++i)
+	{
+		const PendingSection& pending = m_Sections[i];
+		offset = AlignAssetOffset(offset);
+
+		AssetSection section = {};
+		section.type = pending.type;
+		section.offset = offset;
+		section.size = pending.data.size();
+		std::memcpy(out.data() + sizeof(AssetPackageHeader) + i * sizeof(AssetSection), &section, sizeof(section));
+
+		if (!pending.data.empty())
+		{
+			std::memcpy(out.data() + offset, pending.data.data(), pending.data.size());
+		}
+		offset += pending.data.size();
+	}
+	assert(offset == out.size());
+}
+
+// =====================================================================================
+//										View
+// =====================================================================================
+
+bool AssetPackageView::IsValidHeader(const AssetPackageHeader& header)
+{
+	return header.magic == ASSET_PACKAGE_MAGIC && header.version == ASSET_PACKAGE_VERSION &&
+		(header.type == AssetType::Mesh || header.type == AssetType::Texture);
+}
+
+bool AssetPackageView::Open(const void* data, size_t size)
+{
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Header = nullptr;
+	m_Sections = nullptr;
+
+	if (!data || size < sizeof(AssetPackageHeader))
+		return false;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const AssetPackageHeader* header = reinterpret_cast<const AssetPackageHeader*>(bytes);
+	if (!IsValidHeader(*header) || header->fileSize != size)
+		return false;
+
+	const uint64_t tableEnd = sizeof(AssetPackageHeader) + uint64_t(header->sectionCount) * sizeof(AssetSection);
+	if (tableEnd > size)
+		return false;
+
+	// A truncated or corrupted file must not hand out pointers past its end.
+	const AssetSection* sections = reinterpret_cast<const AssetSection*>(bytes + sizeof(AssetPackageHeader));
+	for (uint32_t i = 0; i < header->sectionCount; ++i)
+	{
+		const AssetSection& section = sections[i];
+		if (section.offset % ASSET_SECTION_ALIGNMENT != 0 || section.offset < tableEnd ||
+			section.offset > size || section.size > size - section.offset)
+			return false;
+	}
+
+	m_Data = bytes;
+	m_Size = size;
+	m_Header = header;
+	m_Sections = sections;
+	return true;
+}
+
+const AssetSection* AssetPackageView::FindSection(SectionType type) const
+{
+	assert(m_Header && "Open() the package first.");
+	for (uint32_t i = 0; i < m_Header->sectionCount; ++i)
+	{
+		if (m_Sections[i].type == type)
+			return &m_Sections[i];
+	}
+	return nullptr;
+}
+
+const void* AssetPackageView::GetSectionData(SectionType type, size_t* size) const
+{
+	const AssetSection* section = FindSection(type);
+	if (size)
+	{
+		*size = section ? static_cast<size_t>(section->size) : 0;
+	}
+	return section ? m_Data + section->offset : nullptr;
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =====================================================================================
+//									Cooked asset packages
+// =====================================================================================
+
+// Binary layout of the files written by the asset cooker (Tools/AssetCooker). Everything
+//		is already in its final GPU format, so loading a package is: map or read the file,
+//		Open() a view on it, and hand the section pointers to UpdateBufferResource (or
+//		copy them into upload memory) as they are - no parsing, no conversion. AssetFile
+//		(AssetFile.h) reads sections straight into upload memory.
+//
+//		AssetPackageHeader
+//		AssetSection[sectionCount]		section table
+//		(padding)
+//		section 0						each section starts at a multiple of
+//		(padding)						ASSET_SECTION_ALIGNMENT from the file start
+//		section 1
+//		...
+//
+// All values are little endian. The alignment of 512 bytes is the placement alignment of
+//		texture subresources in upload buffers (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) and
+//		the sector size unbuffered file reads need, so a section can be read or copied
+//		straight to its destination.
+constexpr uint32_t ASSET_PACKAGE_MAGIC = 0x41465844; // "DXFA"
+// Bump on any change to the structures below - the cooker rebuilds older packages.
+constexpr uint32_t ASSET_PACKAGE_VERSION = 1;
+constexpr uint32_t ASSET_SECTION_ALIGNMENT = 512;
+// Row pitch alignment of texture data (D3D12_TEXTURE_DATA_PITCH_ALIGNMENT).
+constexpr uint32_t ASSET_TEXTURE_PITCH_ALIGNMENT = 256;
+
+enum class AssetType : uint32_t
+{
+	Mesh = 1,
+	Texture = 2,
+};
+
+enum class SectionType : uint32_t
+{
+	// Mesh
+	MeshHeader = 1,		// MeshAssetHeader
+	Positions,			// QuantizedPosition[vertexCount]
+	Normals,			// PackedNormal[vertexCount]		(optional)
+	UVs,				// PackedUV[vertexCount]			(optional)
+	Indices,			// indices of all LODs, 16 or 32 bit
+	Lods,				// MeshAssetLod[lodCount]
+
+	// Texture
+	TextureHeader = 16,	// TextureAssetHeader
+	Subresources,		// TextureAssetSubresource[mipCount * arraySize]
+	TextureData,		// all subresources, rows padded to ASSET_TEXTURE_PITCH_ALIGNMENT
+};
+
+struct AssetPackageHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	AssetType type;
+	uint32_t sectionCount;
+	// Hash of the cooker settings the package was built with - a package is out of date
+	//		when the settings change, even if the source didn't.
+	uint64_t settingsHash;
+	uint64_t fileSize;
+};
+static_assert(sizeof(AssetPackageHeader) == 32, "AssetPackageHeader is read from disk as is.");
+
+struct AssetSection
+{
+	SectionType type;
+	uint32_t reserved;
+	// From the start of the file.
+	uint64_t offset;
+	uint64_t size;
+};
+static_assert(sizeof(AssetSection) == 24, "AssetSection is read from disk as is.");
+
+// =====================================================================================
+//										Mesh sections
+// =====================================================================================
+
+// Vertex streams are stored one per section (not interleaved): bind them as separate
+//		vertex buffer slots. Positions are quantized to the mesh bounds - fold
+//		QuantizationBounds{ boundsCenter, boundsExtent }.GetDequantizationMatrix() into the
+//		world matrix.
+struct MeshAssetHeader
+{
+	uint32_t vertexCount;
+	// Of all LODs together.
+	uint32_t indexCount;
+	// IndexFormat (MeshOptimizer.h): 0 = 16 bit, 1 = 32 bit.
+	uint32_t indexFormat;
+	uint32_t lodCount;
+	float boundsCenter[3];
+	float boundsExtent[3];
+};
+static_assert(sizeof(MeshAssetHeader) == 40, "MeshAssetHeader is read from disk as is.");
+
+// One level of detail: a range of the index section over the shared vertices. Level 0 is
+//		the full detail mesh; "geometricError" goes into LodLevel.
+struct MeshAssetLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float geometricError;
+	uint32_t reserved;
+};
+static_assert(sizeof(MeshAssetLod) == 16, "MeshAssetLod is read from disk as is.");
+
+// =====================================================================================
+//										Texture sections
+// =====================================================================================
+
+struct TextureAssetHeader
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t arraySize;
+	uint32_t mipCount;
+	// DXGI_FORMAT value.
+	uint32_t format;
+	uint32_t reserved;
+};
+static_assert(sizeof(TextureAssetHeader) == 24, "TextureAssetHeader is read from disk as is.");
+
+// Placement of one subresource in the TextureData section, laid out the way
+//		GetCopyableFootprints would: copy TextureData into an upload buffer at a 512 byte
+//		aligned offset and every subresource is a valid D3D12_PLACED_SUBRESOURCE_FOOTPRINT
+//		(offset + upload offset, format, width, height, 1, rowPitch) for CopyTextureRegion.
+struct TextureAssetSubresource
+{
+	// From the start of the TextureData section, multiple of ASSET_SECTION_ALIGNMENT.
+	uint64_t offset;
+	uint32_t width;
+	uint32_t height;
+	// Multiple of ASSET_TEXTURE_PITCH_ALIGNMENT.
+	uint32_t rowPitch;
+	// Rows of texels - or of 4x4 blocks for block compressed formats.
+	uint32_t rowCount;
+};
+static_assert(sizeof(TextureAssetSubresource) == 24, "TextureAssetSubresource is read from disk as is.");
+
+inline uint64_t AlignAssetOffset(uint64_t value, uint64_t alignment = ASSET_SECTION_ALIGNMENT)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// =====================================================================================
+//										Writer
+// =====================================================================================
+
+// Collects the sections of a package and lays them out. The data is copied, so sources
+//		can be temporaries.
+class AssetPackageWriter
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	AssetPackageWriter(AssetType type, uint64_t settingsHash);
+
+	void AddSection(SectionType type, const void* data, size_t size);
+
+	template<typename T>
+	void AddSection(SectionType type, const T& value)
+	{
+		AddSection(type, &value, sizeof(T));
+	}
+	template<typename T>
+	void AddSection(SectionType type, const std::vector<T>& values)
+	{
+		AddSection(type, values.data(), values.size() * sizeof(T));
+	}
+
+	// Size of the finished package.
+	uint64_t GetSize() const;
+	// The complete file contents.
+	void Serialize(std::vector<uint8_t>& out) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	struct PendingSection
+	{
+		SectionType type;
+		std::vector<uint8_t> data;
+	};
+
+	AssetType m_Type;
+	uint64_t m_SettingsHash;
+	std::vector<PendingSection> m_Sections;
+};
+
+// =====================================================================================
+//										View
+// =====================================================================================
+
+// Read-only view on a package in memory (loaded or mapped). Doesn't copy or own the data.
+class AssetPackageView
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// Checks the header and that every section lies within "size" bytes. Returns false
+	//		for anything that isn't a complete package of the current version.
+	bool Open(const void* data, size_t size);
+
+	// Checks just the header, e.g. the first sizeof(AssetPackageHeader) bytes of a file.
+	static bool IsValidHeader(const AssetPackageHeader& header);
+
+	const AssetPackageHeader& GetHeader() const { return *m_Header; }
+	AssetType GetType() const { return m_Header->type; }
+
+	// nullptr if the package has no such section.
+	const AssetSection* FindSection(SectionType type) const;
+	const void* GetSectionData(SectionType type, size_t* size = nullptr) const;
+
+	// Section as an array of T; nullptr (and count 0) if missing or not a whole number of T.
+	template<typename T>
+	const T* GetSectionArray(SectionType type, size_t& count) const
+	{
+		size_t size = 0;
+		const void* data = GetSectionData(type, &size);
+		count = data && size % sizeof(T) == 0 ? size / sizeof(T) : 0;
+		return count ? static_cast<const T*>(data) : nullptr;
+	}
+	// Section holding exactly one T, nullptr otherwise.
+	template<typename T>
+	const T* GetSectionStruct(SectionType type) const
+	{
+		size_t size = 0;
+		const void* data = GetSectionData(type, &size);
+		return data && size == sizeof(T) ? static_cast<const T*>(data) : nullptr;
+	}
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+	const AssetPackageHeader* m_Header = nullptr;
+	const AssetSection* m_Sections = nullptr;
+};
@@ -0,0 +1,939 @@
+#include "AsyncFileIO.h"
+#include "AssetFile.h" // ASSET_FILE_IO_ALIGNMENT
+
+#include <algorithm> // std::min
+#include <cassert>
+#include <cstring>   // std::memset
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+
+namespace
+{
+	// Largest single read - a DWORD on Windows, just under 2 GB on Linux.
+	constexpr size_t MAX_READ_SIZE = size_t(1) << 30;
+
+#if defined(_WIN32)
+	// OVERLAPPED that knows its request - completion packets only carry the OVERLAPPED.
+	struct RequestOverlapped : OVERLAPPED
+	{
+		AsyncFileIO::Request* request;
+	};
+#endif
+}
+
+struct AsyncFileIO::Request
+{
+	IoReadRequest read;
+	IoRequestId id = INVALID_IO_REQUEST;
+	// Reads can complete in parts (short reads, reads over MAX_READ_SIZE): the backend
+	//		reads [bytesRead, size) of the request on every submit.
+	size_t bytesRead = 0;
+
+	enum class State : uint8_t { Queued, InFlight, Cancelled, Finishing } state = State::Queued;
+	// Set by Cancel() while in flight: no further parts are submitted.
+	std::atomic<bool> cancelRequested{ false };
+
+#if defined(_WIN32)
+	RequestOverlapped overlapped;
+#else
+	struct iovec iov;
+#endif
+
+	uint64_t GetOffset() const { return read.offset + bytesRead; }
+	uint8_t* GetDestination() const { return static_cast<uint8_t*>(read.destination) + bytesRead; }
+	size_t GetPartSize() const { return std::min(read.size - bytesRead, MAX_READ_SIZE); }
+};
+
+// =====================================================================================
+//										Backends
+// =====================================================================================
+
+// Owned and used by the I/O thread only, except Wake().
+class AsyncFileIO::Backend
+{
+public:
+	struct Completion
+	{
+		Request* request;
+		// Completed: bytes of this part, 0 at the end of the file.
+		IoStatus status;
+		size_t bytes;
+	};
+
+	virtual ~Backend() = default;
+
+	virtual IoBackendType GetType() const = 0;
+	virtual uint32_t GetMaxInFlight(uint32_t queueDepth) const { return queueDepth; }
+	// Called for every file opened.
+	virtual bool BindFile(intptr_t /*handle*/) { return true; }
+
+	// Starts reading the next part of "request".
+	virtual void Submit(Request* request) = 0;
+	// Passes what Submit and Cancel queued up to the OS.
+	virtual void Flush() {}
+	virtual void Cancel(Request* request) = 0;
+	// Blocks until at least one read completes or Wake() is called.
+	virtual void Wait(std::vector<Completion>& completions) = 0;
+	// Any thread.
+	virtual void Wake() = 0;
+};
+
+namespace
+{
+	typedef AsyncFileIO::Backend Backend;
+	typedef AsyncFileIO::Request Request;
+
+	// ---------------------------------------------------------------------------------
+	//	Blocking: positional reads on the I/O thread. One read in flight at a time, so a
+	//		Critical request waits for at most one read to finish.
+	// ---------------------------------------------------------------------------------
+	class BlockingBackend : public Backend
+	{
+	public:
+		IoBackendType GetType() const override { return IoBackendType::Blocking; }
+		uint32_t GetMaxInFlight(uint32_t) const override { return 1; }
+
+		void Submit(Request* request) override { m_Pending.push_back(request); }
+		// A read is over by the time anyone could cancel it.
+		void Cancel(Request*) override {}
+		void Wake() override {}
+
+		void Wait(std::vector<Completion>& completions) override
+		{
+			while (!m_Pending.empty())
+			{
+				Request* request = m_Pending.front();
+				m_Pending.pop_front();
+				completions.push_back(ReadPart(request));
+			}
+		}
+
+	private:
+		static Completion ReadPart(Request* request)
+		{
+#if defined(_WIN32)
+			// Files are opened for overlapped I/O: start the read, then wait for it.
+			HANDLE file = reinterpret_cast<HANDLE>(request->read.file.handle);
+			OVERLAPPED overlapped = {};
+			const uint64_t offset = request->GetOffset();
+			overlapped.Offset = DWORD(offset);
+			overlapped.OffsetHigh = DWORD(offset >> 32);
+			DWORD read = 0;
+			if (!::ReadFile(file, request->GetDestination(), DWORD(request->GetPartSize()), nullptr, &overlapped) &&
+				::GetLastError() != ERROR_IO_PENDING)
+			{
+				return { request, ::GetLastError() == ERROR_HANDLE_EOF ? IoStatus::Completed : IoStatus::Failed, 0 };
+			}
+			if (!::GetOverlappedResult(file, &overlapped, &read, TRUE))
+				return { request, ::GetLastError() == ERROR_HANDLE_EOF ? IoStatus::Completed : IoStatus::Failed, 0 };
+			return { request, IoStatus::Completed, size_t(read) };
+#else
+			for (;;)
+			{
+				const ssize_t read = ::pread(int(request->read.file.handle), request->GetDestination(),
+					request->GetPartSize(), off_t(request->GetOffset()));
+				if (read < 0 && errno == EINTR)
+					continue;
+				if (read < 0)
+					return { request, IoStatus::Failed, 0 };
+				return { request, IoStatus::Completed, size_t(read) };
+			}
+#endif
+		}
+
+		std::deque<Request*> m_Pending;
+	};
+
+#if defined(_WIN32)
+	// ---------------------------------------------------------------------------------
+	//	IOCP: every file is bound to one completion port; a read is an overlapped ReadFile
+	//		and its completion packet carries the request's OVERLAPPED.
+	// ---------------------------------------------------------------------------------
+	class IocpBackend : public Backend
+	{
+	public:
+		static std::unique_ptr<Backend> Create()
+		{
+			std::unique_ptr<IocpBackend> backend(new IocpBackend());
+			backend->m_Port = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+			if (!backend->m_Port)
+				return nullptr;
+			return backend;
+		}
+
+		~IocpBackend() override
+		{
+			if (m_Port)
+				::CloseHandle(m_Port);
+		}
+
+		IoBackendType GetType() const override { return IoBackendType::IOCP; }
+
+		bool BindFile(intptr_t handle) override
+		{
+			return ::CreateIoCompletionPort(reinterpret_cast<HANDLE>(handle), m_Port, FILE_KEY, 0) == m_Port;
+		}
+
+		void Submit(Request* request) override
+		{
+			RequestOverlapped& overlapped = request->overlapped;
+			std::memset(&overlapped, 0, sizeof(OVERLAPPED));
+			overlapped.request = request;
+			const uint64_t offset = request->GetOffset();
+			overlapped.Offset = DWORD(offset);
+			overlapped.OffsetHigh = DWORD(offset >> 32);
+
+			// Reads that finish right away still post a packet; only a failure to start
+			//		doesn't.
+			if (!::ReadFile(reinterpret_cast<HANDLE>(request->read.file.handle), request->GetDestination(),
+				DWORD(request->GetPartSize()), nullptr, &overlapped))
+			{
+				const DWORD error = ::GetLastError();
+				if (error != ERROR_IO_PENDING)
+				{
+					m_Immediate.push_back({ request, error == ERROR_HANDLE_EOF ? IoStatus::Completed : IoStatus::Failed, 0 });
+				}
+			}
+		}
+
+		void Cancel(Request* request) override
+		{
+			// ERROR_NOT_FOUND if it just finished - its packet is on the way either way.
+			::CancelIoEx(reinterpret_cast<HANDLE>(request->read.file.handle), &request->overlapped);
+		}
+
+		void Wait(std::vector<Completion>& completions) override
+		{
+			if (!m_Immediate.empty())
+			{
+				completions.insert(completions.end(), m_Immediate.begin(), m_Immediate.end());
+				m_Immediate.clear();
+				return;
+			}
+
+			OVERLAPPED_ENTRY entries[64];
+			ULONG count = 0;
+			if (!::GetQueuedCompletionStatusEx(m_Port, entries, _countof(entries), &count, INFINITE, FALSE))
+				return;
+
+			for (ULONG i = 0; i < count; ++i)
+			{
+				if (entries[i].lpCompletionKey == WAKE_KEY)
+					continue;
+
+				RequestOverlapped* overlapped = static_cast<RequestOverlapped*>(entries[i].lpOverlapped);
+				Request* request = overlapped->request;
+				DWORD read = 0;
+				if (::GetOverlappedResult(reinterpret_cast<HANDLE>(request->read.file.handle), overlapped, &read, FALSE))
+				{
+					completions.push_back({ request, IoStatus::Completed, size_t(read) });
+					continue;
+				}
+				const DWORD error = ::GetLastError();
+				const IoStatus status = error == ERROR_HANDLE_EOF ? IoStatus::Completed :
+					error == ERROR_OPERATION_ABORTED ? IoStatus::Cancelled : IoStatus::Failed;
+				completions.push_back({ request, status, 0 });
+			}
+		}
+
+		void Wake() override
+		{
+			::PostQueuedCompletionStatus(m_Port, 0, WAKE_KEY, nullptr);
+		}
+
+	private:
+		static constexpr ULONG_PTR FILE_KEY = 1;
+		static constexpr ULONG_PTR WAKE_KEY = 2;
+
+		HANDLE m_Port = nullptr;
+		// Reads that failed to start - completed by the next Wait.
+		std::vector<Completion> m_Immediate;
+	};
+#endif
+
+#if defined(__linux__)
+	// ---------------------------------------------------------------------------------
+	//	io_uring, through the raw system calls (no liburing dependency). Reads are READV
+	//		entries in the submission ring, passed to the kernel together by one
+	//		io_uring_enter in Flush(). Wake() writes an eventfd the ring polls.
+	//
+	//	The rings are shared with the kernel: the kernel consumes the submission ring
+	//		from the head we read, we fill it at the tail; for the completion ring the
+	//		roles swap. Our side publishes with a release store, reads the kernel's side
+	//		with an acquire load.
+	// ---------------------------------------------------------------------------------
+	class IoUringBackend : public Backend
+	{
+	public:
+		static std::unique_ptr<Backend> Create(uint32_t queueDepth)
+		{
+			std::unique_ptr<IoUringBackend> backend(new IoUringBackend());
+			if (!backend->Init(queueDepth))
+				return nullptr;
+			return backend;
+		}
+
+		~IoUringBackend() override
+		{
+			if (m_Sqes)
+				::munmap(m_Sqes, m_SqesSize);
+			if (m_CqMemory && m_CqMemory != m_SqMemory)
+				::munmap(m_CqMemory, m_CqMemorySize);
+			if (m_SqMemory)
+				::munmap(m_SqMemory, m_SqMemorySize);
+			if (m_Ring >= 0)
+				::close(m_Ring);
+			if (m_WakeEvent >= 0)
+				::close(m_WakeEvent);
+		}
+
+		IoBackendType GetType() const override { return IoBackendType::IoUring; }
+
+		void Submit(Request* request) override
+		{
+			request->iov.iov_base = request->GetDestination();
+			request->iov.iov_len = request->GetPartSize();
+
+			io_uring_sqe* sqe = GetSqe();
+			sqe->opcode = IORING_OP_READV;
+			sqe->fd = int(request->read.file.handle);
+			sqe->off = request->GetOffset();
+			sqe->addr = reinterpret_cast<uint64_t>(&request->iov);
+			sqe->len = 1;
+			sqe->user_data = reinterpret_cast<uint64_t>(request);
+		}
+
+		void Flush() override
+		{
+			__atomic_store_n(m_SqTail, m_SqTailLocal, __ATOMIC_RELEASE);
+			if (m_Pending > 0)
+				Enter(0, 0);
+		}
+
+		void Cancel(Request* request) override
+		{
+			// -ENOENT / -EALREADY if it finished or can't be stopped - fine either way.
+			io_uring_sqe* sqe = GetSqe();
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = reinterpret_cast<uint64_t>(request);
+			sqe->user_data = CANCEL_TAG;
+		}
+
+		void Wait(std::vector<Completion>& completions) override
+		{
+			Flush();
+			while (!Reap(completions))
+			{
+				Enter(1, IORING_ENTER_GETEVENTS);
+			}
+		}
+
+		void Wake() override
+		{
+			const uint64_t one = 1;
+			while (::write(m_WakeEvent, &one, sizeof(one)) < 0 && errno == EINTR)
+			{
+			}
+		}
+
+	private:
+		static constexpr uint64_t WAKE_TAG = 1;
+		static constexpr uint64_t CANCEL_TAG = 2;
+
+		bool Init(uint32_t queueDepth)
+		{
+			// Room for a read, a cancel of every read, and the wake poll. The completion
+			//		ring is twice as big, it can't overflow.
+			io_uring_params params;
+			std::memset(&params, 0, sizeof(params));
+			m_Ring = int(::syscall(__NR_io_uring_setup, 2 * queueDepth + 2, &params));
+			if (m_Ring < 0)
+				return false;
+
+			m_SqMemorySize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+			m_CqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMapping)
+			{
+				m_SqMemorySize = m_CqMemorySize = std::max(m_SqMemorySize, m_CqMemorySize);
+			}
+
+			m_SqMemory = Map(m_SqMemorySize, IORING_OFF_SQ_RING);
+			if (!m_SqMemory)
+				return false;
+			m_CqMemory = singleMapping ? m_SqMemory : Map(m_CqMemorySize, IORING_OFF_CQ_RING);
+			m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			m_Sqes = static_cast<io_uring_sqe*>(Map(m_SqesSize, IORING_OFF_SQES));
+			if (!m_CqMemory || !m_Sqes)
+				return false;
+
+			uint8_t* sq = static_cast<uint8_t*>(m_SqMemory);
+			m_SqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+			m_SqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+			m_SqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+			m_SqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+			m_SqEntries = params.sq_entries;
+			m_SqTailLocal = *m_SqTail;
+
+			uint8_t* cq = static_cast<uint8_t*>(m_CqMemory);
+			m_CqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+			m_CqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+			m_CqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+			m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+			m_WakeEvent = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+			if (m_WakeEvent < 0)
+				return false;
+			ArmWake();
+
+			// Seccomp filters (containers) can allow io_uring_setup and block the rest -
+			//		make sure a submission goes through before relying on the ring.
+			Flush();
+			return m_Pending == 0;
+		}
+
+		void* Map(size_t size, off_t offset)
+		{
+			void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, offset);
+			return memory == MAP_FAILED ? nullptr : memory;
+		}
+
+		io_uring_sqe* GetSqe()
+		{
+			// The ring is sized for everything that can be outstanding; it is only full
+			//		if the kernel didn't take the last batch yet.
+			while (m_SqTailLocal - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE) >= m_SqEntries)
+			{
+				Flush();
+			}
+			const uint32_t index = m_SqTailLocal & m_SqMask;
+			io_uring_sqe* sqe = &m_Sqes[index];
+			std::memset(sqe, 0, sizeof(*sqe));
+			m_SqArray[index] = index;
+			++m_SqTailLocal;
+			++m_Pending;
+			return sqe;
+		}
+
+		void ArmWake()
+		{
+			io_uring_sqe* sqe = GetSqe();
+			sqe->opcode = IORING_OP_POLL_ADD;
+			sqe->fd = m_WakeEvent;
+			sqe->poll_events = POLLIN;
+			sqe->user_data = WAKE_TAG;
+		}
+
+		void Enter(uint32_t minComplete, uint32_t flags)
+		{
+			const int submitted = int(::syscall(__NR_io_uring_enter, m_Ring, m_Pending, minComplete, flags, nullptr, 0));
+			// EINTR, EAGAIN, EBUSY: whatever wasn't taken goes with the next call.
+			if (submitted > 0)
+				m_Pending -= uint32_t(submitted);
+		}
+
+		// True if anything completed (a wake up included).
+		bool Reap(std::vector<Completion>& completions)
+		{
+			uint32_t head = *m_CqHead;
+			const uint32_t tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+			if (head == tail)
+				return false;
+
+			bool rearm = false;
+			for (; head != tail; ++head)
+			{
+				const io_uring_cqe& cqe = m_Cqes[head & m_CqMask];
+				if (cqe.user_data == CANCEL_TAG)
+					continue;
+				if (cqe.user_data == WAKE_TAG)
+				{
+					rearm = true;
+					continue;
+				}
+
+				Request* request = reinterpret_cast<Request*>(cqe.user_data);
+				if (cqe.res >= 0)
+					completions.push_back({ request, IoStatus::Completed, size_t(cqe.res) });
+				else
+					completions.push_back({ request, cqe.res == -ECANCELED ? IoStatus::Cancelled : IoStatus::Failed, 0 });
+			}
+			__atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+
+			if (rearm)
+			{
+				// Poll requests are one-shot: reset the counter, then poll again.
+				uint64_t value;
+				while (::read(m_WakeEvent, &value, sizeof(value)) > 0)
+				{
+				}
+				ArmWake();
+			}
+			return true;
+		}
+
+		int m_Ring = -1;
+		int m_WakeEvent = -1;
+
+		void* m_SqMemory = nullptr;
+		size_t m_SqMemorySize = 0;
+		void* m_CqMemory = nullptr;
+		size_t m_CqMemorySize = 0;
+		io_uring_sqe* m_Sqes = nullptr;
+		size_t m_SqesSize = 0;
+
+		uint32_t* m_SqHead = nullptr;
+		uint32_t* m_SqTail = nullptr;
+		uint32_t* m_SqArray = nullptr;
+		uint32_t m_SqMask = 0;
+		uint32_t m_SqEntries = 0;
+		// Tail including entries not published yet / entries the kernel didn't take yet.
+		uint32_t m_SqTailLocal = 0;
+		uint32_t m_Pending = 0;
+
+		uint32_t* m_CqHead = nullptr;
+		uint32_t* m_CqTail = nullptr;
+		uint32_t m_CqMask = 0;
+		io_uring_cqe* m_Cqes = nullptr;
+	};
+#endif
+
+	std::unique_ptr<Backend> CreateBackend(const AsyncFileIO::Settings& settings)
+	{
+		std::unique_ptr<Backend> backend;
+		if (settings.useNativeBackend)
+		{
+#if defined(_WIN32)
+			backend = IocpBackend::Create();
+#elif defined(__linux__)
+			backend = IoUringBackend::Create(settings.queueDepth);
+#endif
+		}
+		if (!backend)
+			backend.reset(new BlockingBackend());
+		return backend;
+	}
+}
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+AsyncFileIO::AsyncFileIO(const Settings& settings) :
+	m_Backend(CreateBackend(settings)),
+	m_QueueDepth(std::max(settings.queueDepth, 1u)),
+	m_OnThreadStart(settings.onThreadStart)
+{
+	SetBandwidthLimit(settings.bandwidthLimit);
+	m_Thread = std::thread(&AsyncFileIO::ThreadMain, this);
+}
+
+AsyncFileIO::~AsyncFileIO()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+		for (std::deque<Request*>& queue : m_Queues)
+		{
+			for (Request* request : queue)
+			{
+				request->state = Request::State::Cancelled;
+				m_CancelledQueued.push_back(request);
+			}
+			queue.clear();
+		}
+		WakeThread();
+	}
+	m_Thread.join();
+
+	for (Request* request : m_FreeRequests)
+	{
+		delete request;
+	}
+}
+
+IoBackendType AsyncFileIO::GetBackendType() const
+{
+	return m_Backend->GetType();
+}
+
+void AsyncFileIO::SetBandwidthLimit(uint64_t bytesPerSecond)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_BandwidthLimit = bytesPerSecond;
+	m_Tokens = double(bytesPerSecond) / 4.0;
+	m_LastRefill = Clock::now();
+	WakeThread();
+}
+
+// =====================================================================================
+//										Files
+// =====================================================================================
+
+IoFile AsyncFileIO::OpenFile(const char* path, bool unbuffered)
+{
+	IoFile file;
+	file.unbuffered = unbuffered;
+
+#if defined(_WIN32)
+	const int length = ::MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::vector<wchar_t> widePath(length > 0 ? length : 1, L'\0');
+	::MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+
+	HANDLE handle = ::CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED | (unbuffered ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN), nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return IoFile();
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(handle, &size) || !m_Backend->BindFile(reinterpret_cast<intptr_t>(handle)))
+	{
+		::CloseHandle(handle);
+		return IoFile();
+	}
+	file.handle = reinterpret_cast<intptr_t>(handle);
+	file.size = uint64_t(size.QuadPart);
+#else
+	int flags = O_RDONLY | O_CLOEXEC;
+#if defined(O_DIRECT)
+	if (unbuffered)
+		flags |= O_DIRECT;
+#endif
+	int handle = ::open(path, flags);
+	if (handle < 0 && errno == EINVAL && unbuffered)
+	{
+		// No direct I/O on this file system (tmpfs): same reads, through the page cache.
+		handle = ::open(path, O_RDONLY | O_CLOEXEC);
+	}
+	if (handle < 0)
+		return IoFile();
+
+	struct stat status;
+	if (::fstat(handle, &status) != 0 || !S_ISREG(status.st_mode) || !m_Backend->BindFile(handle))
+	{
+		::close(handle);
+		return IoFile();
+	}
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+	if (unbuffered)
+		::fcntl(handle, F_NOCACHE, 1);
+#endif
+	file.handle = handle;
+	file.size = uint64_t(status.st_size);
+#endif
+	return file;
+}
+
+void AsyncFileIO::CloseFile(IoFile& file)
+{
+	if (!file.IsValid())
+		return;
+#if defined(_WIN32)
+	::CloseHandle(reinterpret_cast<HANDLE>(file.handle));
+#else
+	::close(int(file.handle));
+#endif
+	file = IoFile();
+}
+
+// =====================================================================================
+//										Requests
+// =====================================================================================
+
+IoRequestId AsyncFileIO::Read(IoReadRequest request)
+{
+	IoRequestId id = INVALID_IO_REQUEST;
+	ReadBatch(&request, 1, &id);
+	return id;
+}
+
+void AsyncFileIO::ReadBatch(IoReadRequest* requests, size_t count, IoRequestId* outIds)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	assert(!m_Stop);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		IoReadRequest& read = requests[i];
+		assert(read.file.IsValid() && (read.destination || read.size == 0));
+		assert(read.priority < IoPriority::Count);
+		assert(!read.file.unbuffered || (read.offset % ASSET_FILE_IO_ALIGNMENT == 0 &&
+			read.size % ASSET_FILE_IO_ALIGNMENT == 0 &&
+			reinterpret_cast<uintptr_t>(read.destination) % ASSET_FILE_IO_ALIGNMENT == 0));
+
+		Request* request;
+		if (!m_FreeRequests.empty())
+		{
+			request = m_FreeRequests.back();
+			m_FreeRequests.pop_back();
+		}
+		else
+		{
+			request = new Request();
+		}
+
+		request->read = std::move(read);
+		request->id = m_NextId++;
+		request->bytesRead = 0;
+		request->state = Request::State::Queued;
+		request->cancelRequested.store(false, std::memory_order_relaxed);
+
+		m_Queues[size_t(request->read.priority)].push_back(request);
+		m_Requests.emplace(request->id, request);
+		if (outIds)
+			outIds[i] = request->id;
+	}
+
+	if (count > 0)
+		WakeThread();
+}
+
+bool AsyncFileIO::Cancel(IoRequestId id)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_Requests.find(id);
+	if (found == m_Requests.end())
+		return false;
+
+	Request* request = found->second;
+	switch (request->state)
+	{
+	case Request::State::Queued:
+	{
+		std::deque<Request*>& queue = m_Queues[size_t(request->read.priority)];
+		queue.erase(std::find(queue.begin(), queue.end(), request));
+		request->state = Request::State::Cancelled;
+		m_CancelledQueued.push_back(request);
+		WakeThread();
+		return true;
+	}
+	case Request::State::InFlight:
+		if (!request->cancelRequested.exchange(true, std::memory_order_relaxed))
+		{
+			m_CancelInFlight.push_back(request);
+			WakeThread();
+		}
+		return true;
+	default:
+		// Already cancelled or its callback is running.
+		return false;
+	}
+}
+
+void AsyncFileIO::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Idle.wait(lock, [this] { return m_Requests.empty(); });
+}
+
+void AsyncFileIO::WakeThread()
+{
+	m_WakeUp.notify_one();
+	// While reads are in flight the thread waits in the backend, not on m_WakeUp.
+	if (m_InFlight > 0)
+		m_Backend->Wake();
+}
+
+// =====================================================================================
+//										I/O thread
+// =====================================================================================
+
+AsyncFileIO::Request* AsyncFileIO::PopNextRequest(Clock::time_point now, Clock::time_point& throttledUntil)
+{
+	if (m_BandwidthLimit > 0)
+	{
+		const double elapsed = std::chrono::duration<double>(now - m_LastRefill).count();
+		m_Tokens = std::min(m_Tokens + elapsed * double(m_BandwidthLimit), double(m_BandwidthLimit) / 4.0);
+		m_LastRefill = now;
+	}
+
+	for (size_t priority = 0; priority < size_t(IoPriority::Count); ++priority)
+	{
+		std::deque<Request*>& queue = m_Queues[priority];
+		if (queue.empty())
+			continue;
+
+		const bool throttled = priority != size_t(IoPriority::Critical) && m_BandwidthLimit > 0;
+		if (throttled && m_Tokens < 0.0)
+		{
+			// Lower priorities are throttled just the same - nothing else can start.
+			const double wait = -m_Tokens / double(m_BandwidthLimit);
+			throttledUntil = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait));
+			return nullptr;
+		}
+
+		Request* request = queue.front();
+		queue.pop_front();
+		if (throttled)
+			m_Tokens -= double(request->read.size);
+		return request;
+	}
+	return nullptr;
+}
+
+void AsyncFileIO::Finish(FinishedList& finished)
+{
+	if (finished.empty())
+		return;
+
+	{
+		// Cancel() leaves requests alone from here on.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& entry : finished)
+		{
+			if (entry.first->state == Request::State::InFlight)
+				--m_InFlight;
+			entry.first->state = Request::State::Finishing;
+		}
+		// A cancel of a request that finished meanwhile would hit the request's next use.
+		m_CancelInFlight.erase(std::remove_if(m_CancelInFlight.begin(), m_CancelInFlight.end(),
+			[](const Request* request) { return request->state == Request::State::Finishing; }), m_CancelInFlight.end());
+	}
+
+	for (auto& entry : finished)
+	{
+		Request* request = entry.first;
+		if (request->read.onComplete)
+		{
+			const IoResult result = { request->id, entry.second, request->bytesRead, request->read.userData };
+			request->read.onComplete(result);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& entry : finished)
+	{
+		Request* request = entry.first;
+		m_Requests.erase(request->id);
+		// Drop the callback and whatever it captured now, not when the request is reused.
+		request->read = IoReadRequest();
+		m_FreeRequests.push_back(request);
+	}
+	finished.clear();
+	if (m_Requests.empty())
+		m_Idle.notify_all();
+}
+
+void AsyncFileIO::ThreadMain()
+{
+	if (m_OnThreadStart)
+		m_OnThreadStart();
+
+	const uint32_t maxInFlight = std::min(m_QueueDepth, m_Backend->GetMaxInFlight(m_QueueDepth));
+	std::vector<Request*> submit;
+	std::vector<Request*> cancel;
+	std::vector<Backend::Completion> completions;
+	FinishedList finished;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			for (;;)
+			{
+				for (Request* request : m_CancelledQueued)
+				{
+					finished.emplace_back(request, IoStatus::Cancelled);
+				}
+				m_CancelledQueued.clear();
+				cancel.insert(cancel.end(), m_CancelInFlight.begin(), m_CancelInFlight.end());
+				m_CancelInFlight.clear();
+
+				// Highest priority first, as long as the backend and the bandwidth allow.
+				const Clock::time_point now = Clock::now();
+				Clock::time_point throttledUntil = Clock::time_point::max();
+				while (m_InFlight < maxInFlight)
+				{
+					Request* request = PopNextRequest(now, throttledUntil);
+					if (!request)
+						break;
+					request->state = Request::State::InFlight;
+					++m_InFlight;
+					submit.push_back(request);
+				}
+
+				if (!finished.empty() || !submit.empty() || !cancel.empty() || m_InFlight > 0)
+					break;
+				// Stopping: the destructor cancelled the queues, nothing left in flight.
+				if (m_Stop && m_Requests.empty())
+					return;
+
+				if (throttledUntil != Clock::time_point::max())
+					m_WakeUp.wait_until(lock, throttledUntil);
+				else
+					m_WakeUp.wait(lock);
+			}
+		}
+
+		Finish(finished);
+
+		for (Request* request : submit)
+		{
+			m_Backend->Submit(request);
+		}
+		for (Request* request : cancel)
+		{
+			m_Backend->Cancel(request);
+		}
+		submit.clear();
+		cancel.clear();
+
+		// Only this thread changes m_InFlight, reading it unlocked here is fine.
+		if (m_InFlight == 0)
+			continue;
+
+		m_Backend->Wait(completions);
+		for (const Backend::Completion& completion : completions)
+		{
+			Request* request = completion.request;
+			if (completion.status != IoStatus::Completed)
+			{
+				finished.emplace_back(request, completion.status);
+				continue;
+			}
+
+			// Short read or a part of a big one: read the rest, unless it was the end of the
+			//		file or the request was cancelled meanwhile. (Unbuffered reads of the
+			//		last block end short at the end of the file, another read would fail.)
+			request->bytesRead += completion.bytes;
+			if (request->bytesRead < request->read.size && completion.bytes > 0 &&
+				request->GetOffset() < request->read.file.size)
+			{
+				if (request->cancelRequested.load(std::memory_order_relaxed))
+					finished.emplace_back(request, IoStatus::Cancelled);
+				else
+					m_Backend->Submit(request);
+				continue;
+			}
+			finished.emplace_back(request, IoStatus::Completed);
+		}
+		completions.clear();
+		m_Backend->Flush();
+		Finish(finished);
+	}
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+// Portable C++ only - the backends live in AsyncFileIO.cpp, Windows.h stays out.
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// =====================================================================================
+//										Async file I/O
+// =====================================================================================
+
+// Ordering of queued reads. Critical is for data the current frame waits for and is
+//		never throttled; the others are streaming (High: visible now at low detail, Normal:
+//		regular streaming, Low: prefetch) and share the bandwidth limit.
+enum class IoPriority : uint8_t
+{
+	Critical,
+	High,
+	Normal,
+	Low,
+	Count
+};
+
+enum class IoStatus : uint8_t
+{
+	Completed,	// All bytes read - or fewer, if the read reached the end of the file.
+	Failed,
+	Cancelled,
+};
+
+enum class IoBackendType : uint8_t
+{
+	IoUring,	// Linux 5.1+ - one system call submits a whole batch.
+	IOCP,		// Windows - overlapped ReadFile, completions through a completion port.
+	Blocking,	// Fallback (io_uring unavailable or blocked by seccomp, other systems):
+				//		positional reads on the I/O thread, one at a time.
+};
+
+typedef uint64_t IoRequestId;
+constexpr IoRequestId INVALID_IO_REQUEST = 0;
+
+// An open file. Get one from AsyncFileIO::OpenFile - on Windows the handle is bound to
+//		that AsyncFileIO's completion port.
+struct IoFile
+{
+	// HANDLE on Windows, file descriptor elsewhere.
+	intptr_t handle = -1;
+	uint64_t size = 0;
+	// Opened for unbuffered reads (AssetFile.h): offsets, sizes and destinations of its
+	//		reads must be multiples of ASSET_FILE_IO_ALIGNMENT.
+	bool unbuffered = false;
+
+	bool IsValid() const { return handle != -1; }
+};
+
+struct IoResult
+{
+	IoRequestId id;
+	IoStatus status;
+	size_t bytesRead;
+	// Copied from the request.
+	void* userData;
+};
+
+struct IoReadRequest
+{
+	IoFile file;
+	uint64_t offset = 0;
+	void* destination = nullptr;
+	size_t size = 0;
+	IoPriority priority = IoPriority::Normal;
+	// Runs on the I/O thread: keep it short - decrement a counter, queue the result or
+	//		spawn a task. Reads aren't submitted while it runs.
+	std::function<void(const IoResult&)> onComplete;
+	void* userData = nullptr;
+};
+
+// Asynchronous, prioritized file reads on one I/O thread, which owns the OS backend:
+//
+//		Read / ReadBatch	queue requests (one lock and one wake up per batch) and return
+//							right away - the render thread never waits for the disk.
+//		I/O thread			moves the highest priority requests into the backend while
+//							fewer than "queueDepth" reads are in flight and the bandwidth
+//							budget allows it, then waits for completions.
+//
+// Bandwidth throttling is a token bucket over the non-Critical reads: bytes are spent when
+//		a read is submitted, a read may overdraw the bucket (big reads aren't starved) and
+//		the next one waits until it is positive again. The bucket holds 1/4 second of
+//		bandwidth, so an idle period allows a short burst.
+//
+// Cancel() removes a queued request; one in flight is cancelled in the kernel where the
+//		backend can (io_uring ASYNC_CANCEL, CancelIoEx) - it may still complete normally.
+//		Every request gets exactly one onComplete call, cancelled ones included.
+class AsyncFileIO
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	struct Settings
+	{
+		// Reads in flight in the backend. Deeper queues keep NVMe drives busy, shallower
+		//		ones let later Critical requests overtake sooner.
+		uint32_t queueDepth = 32;
+		// Bytes per second for the non-Critical priorities, 0: unlimited.
+		uint64_t bandwidthLimit = 0;
+		// Try io_uring / IOCP - false forces the Blocking backend.
+		bool useNativeBackend = true;
+		// Runs first thing on the I/O thread (thread naming, affinity: ThreadRole::Streaming).
+		std::function<void()> onThreadStart;
+	};
+
+	explicit AsyncFileIO(const Settings& settings);
+	AsyncFileIO(const AsyncFileIO&) = delete;
+	AsyncFileIO& operator=(const AsyncFileIO&) = delete;
+	// Cancels what is still queued, waits for the reads in flight.
+	~AsyncFileIO();
+
+	// UTF-8 path. An invalid IoFile if it can't be opened. Unbuffered falls back to
+	//		buffered reads where the file system has no direct I/O.
+	IoFile OpenFile(const char* path, bool unbuffered = false);
+	// No reads of the file may be queued or in flight.
+	void CloseFile(IoFile& file);
+
+	IoRequestId Read(IoReadRequest request);
+	// Ids go to "outIds" (may be nullptr).
+	void ReadBatch(IoReadRequest* requests, size_t count, IoRequestId* outIds = nullptr);
+	// False if the request already completed (or never existed).
+	bool Cancel(IoRequestId id);
+	// Blocks until nothing is queued or in flight and all callbacks ran - loading screens
+	//		and shutdown. Not from an onComplete callback.
+	void WaitIdle();
+
+	void SetBandwidthLimit(uint64_t bytesPerSecond);
+	IoBackendType GetBackendType() const;
+
+	// Defined in AsyncFileIO.cpp - a queued or in flight read, and the OS backend.
+	struct Request;
+	class Backend;
+
+private:
+	typedef std::vector<std::pair<Request*, IoStatus>> FinishedList;
+
+	void ThreadMain();
+	// Next request allowed to start, nullptr if none or throttled ("throttledUntil": when
+	//		to try again). Under m_Mutex.
+	Request* PopNextRequest(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& throttledUntil);
+	// Runs the callbacks and recycles the requests. I/O thread only.
+	void Finish(FinishedList& finished);
+	// Under m_Mutex.
+	void WakeThread();
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	std::unique_ptr<Backend> m_Backend;
+	uint32_t m_QueueDepth;
+	std::function<void()> m_OnThreadStart;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WakeUp;
+	std::condition_variable m_Idle;
+
+	// Everything below is guarded by m_Mutex.
+	std::deque<Request*> m_Queues[size_t(IoPriority::Count)];
+	// Queued and in flight requests by id, for Cancel().
+	std::unordered_map<IoRequestId, Request*> m_Requests;
+	// Cancelled while queued (completed by the I/O thread) / while in flight.
+	std::vector<Request*> m_CancelledQueued;
+	std::vector<Request*> m_CancelInFlight;
+	std::vector<Request*> m_FreeRequests;
+	IoRequestId m_NextId = 1;
+	uint32_t m_InFlight = 0;
+	bool m_Stop = false;
+
+	// Token bucket.
+	uint64_t m_BandwidthLimit = 0;
+	double m_Tokens = 0.0;
+	std::chrono::steady_clock::time_point m_LastRefill;
+
+	std::thread m_Thread;
+};
@@ -0,0 +1,669 @@
+#include "Bvh.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::min, std::max, std::swap
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BVH_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+
+
+// =====================================================================================
+//										Globals
+// =====================================================================================
+
+namespace
+{
+	constexpr uint32_t SAH_BINS = 16;
+	// Nodes with at most this many primitives are never split.
+	constexpr uint32_t MAX_LEAF_SIZE = 4;
+	// Subtrees bigger than this are built as separate tasks.
+	constexpr uint32_t PARALLEL_BUILD_THRESHOLD = 4096;
+	// Deeper nodes become leaves - bounds the traversal stacks below.
+	constexpr uint32_t MAX_DEPTH = 64;
+
+	const float FLOAT_MAX = std::numeric_limits<float>::max();
+	const float FLOAT_INFINITY = std::numeric_limits<float>::infinity();
+
+	struct Bounds
+	{
+		float minX = FLOAT_MAX, minY = FLOAT_MAX, minZ = FLOAT_MAX;
+		float maxX = -FLOAT_MAX, maxY = -FLOAT_MAX, maxZ = -FLOAT_MAX;
+
+		void Grow(float x0, float y0, float z0, float x1, float y1, float z1)
+		{
+			minX = std::min(minX, x0); minY = std::min(minY, y0); minZ = std::min(minZ, z0);
+			maxX = std::max(maxX, x1); maxY = std::max(maxY, y1); maxZ = std::max(maxZ, z1);
+		}
+		void Grow(const Bounds& b) { Grow(b.minX, b.minY, b.minZ, b.maxX, b.maxY, b.maxZ); }
+
+		// Half the surface area - the SAH only compares ratios.
+		float HalfArea() const
+		{
+			if (minX > maxX)
+				return 0.0f;
+			float ex = maxX - minX, ey = maxY - minY, ez = maxZ - minZ;
+			return ex * ey + ey * ez + ez * ex;
+		}
+	};
+
+	inline void GrowByPrimitive(Bounds& bounds, const BoundingBoxes& boxes, uint32_t p)
+	{
+		bounds.Grow(boxes.centerX[p] - boxes.extentX[p], boxes.centerY[p] - boxes.extentY[p], boxes.centerZ[p] - boxes.extentZ[p],
+			boxes.centerX[p] + boxes.extentX[p], boxes.centerY[p] + boxes.extentY[p], boxes.centerZ[p] + boxes.extentZ[p]);
+	}
+
+	inline float GetCentroid(const BoundingBoxes& boxes, uint32_t p, int axis)
+	{
+		return axis == 0 ? boxes.centerX[p] : axis == 1 ? boxes.centerY[p] : boxes.centerZ[p];
+	}
+
+	// Ray with precomputed reciprocal direction for the slab test.
+	struct PreparedRay
+	{
+		float ox, oy, oz;
+		float ix, iy, iz;
+
+		explicit PreparedRay(const Ray& ray) :
+			ox(ray.origin.x), oy(ray.origin.y), oz(ray.origin.z),
+			ix(1.0f / ray.direction.x), iy(1.0f / ray.direction.y), iz(1.0f / ray.direction.z)
+		{}
+
+		// Where the ray enters and leaves the slab between two planes of one axis.
+		//		A zero direction component makes the reciprocal infinite: the slab is then
+		//		either everything or nothing, except when the origin lies on one of the
+		//		planes, where (plane - o) * (1/d) is 0 * inf = NaN. The ray runs inside that
+		//		plane and boxes are closed, so the slab doesn't limit it at all.
+		static void Slab(float min, float max, float o, float i, float& tEnter, float& tLeave)
+		{
+			float t1 = (min - o) * i, t2 = (max - o) * i;
+			if (std::isnan(t1) || std::isnan(t2))
+			{
+				tEnter = -FLOAT_INFINITY;
+				tLeave = FLOAT_INFINITY;
+				return;
+			}
+			tEnter = std::min(t1, t2);
+			tLeave = std::max(t1, t2);
+		}
+
+		// Entry distance into the box, or FLOAT_MAX if missed (or farther than tMax).
+		float Intersect(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, float tMax) const
+		{
+			float tx1, tx2, ty1, ty2, tz1, tz2;
+			Slab(minX, maxX, ox, ix, tx1, tx2);
+			Slab(minY, maxY, oy, iy, ty1, ty2);
+			Slab(minZ, maxZ, oz, iz, tz1, tz2);
+
+			float tNear = std::max(std::max(tx1, ty1), std::max(tz1, 0.0f));
+			float tFar = std::min(std::min(tx2, ty2), tz2);
+			return (tFar >= tNear && tNear < tMax) ? tNear : FLOAT_MAX;
+		}
+
+		float Intersect(const Bvh::Node& node, float tMax) const
+		{
+			return Intersect(node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, tMax);
+		}
+
+		float Intersect(const BoundingBoxes& boxes, uint32_t p, float tMax) const
+		{
+			return Intersect(boxes.centerX[p] - boxes.extentX[p], boxes.centerY[p] - boxes.extentY[p], boxes.centerZ[p] - boxes.extentZ[p],
+				boxes.centerX[p] + boxes.extentX[p], boxes.centerY[p] + boxes.extentY[p], boxes.centerZ[p] + boxes.extentZ[p], tMax);
+		}
+	};
+
+	inline int PopCount4(int mask)
+	{
+		return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+	}
+
+	// Hit distance of a primitive: the box entry, refined by the intersector if there is one.
+	inline bool IntersectPrimitive(const PreparedRay& prepared, const Ray& ray, const BoundingBoxes& boxes,
+		uint32_t p, float tMax, const Bvh::PrimitiveIntersector& intersector, float& t)
+	{
+		t = prepared.Intersect(boxes, p, tMax);
+		if (t == FLOAT_MAX)
+			return false;
+
+		if (intersector)
+		{
+			Ray clipped = ray;
+			clipped.tMax = tMax;
+			return intersector(p, clipped, t) && t < tMax;
+		}
+		return true;
+	}
+}
+
+// =====================================================================================
+//										Build
+// =====================================================================================
+
+void Bvh::Build(const BoundingBoxes& boxes, TaskScheduler* scheduler)
+{
+	const uint32_t count = static_cast<uint32_t>(boxes.GetCount());
+
+	m_PrimitiveIndices.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+		m_PrimitiveIndices[i] = i;
+
+	// A binary tree with at most one primitive per leaf has 2n - 1 nodes, +1 for the gap.
+	m_Nodes.resize(std::max<size_t>(2 * size_t(count), 2));
+	m_NodeCount = 0;
+	if (count == 0)
+		return;
+
+	Node& root = m_Nodes[0];
+	root.leftFirst = 0;
+	root.count = count;
+	ComputeLeafBounds(root, boxes);
+	m_NodesUsed.store(2, std::memory_order_relaxed);
+
+	if (scheduler && count > PARALLEL_BUILD_THRESHOLD)
+	{
+		TaskGroup group(*scheduler);
+		Subdivide(0, boxes, &group);
+		group.Wait();
+	}
+	else
+	{
+		Subdivide(0, boxes, nullptr);
+	}
+
+	m_NodeCount = m_NodesUsed.load(std::memory_order_relaxed);
+}
+
+void Bvh::ComputeLeafBounds(Node& node, const BoundingBoxes& boxes) const
+{
+	Bounds bounds;
+	for (uint32_t i = 0; i < node.count; ++i)
+	{
+		GrowByPrimitive(bounds, boxes, m_PrimitiveIndices[node.leftFirst + i]);
+	}
+	node.minX = bounds.minX; node.minY = bounds.minY; node.minZ = bounds.minZ;
+	node.maxX = bounds.maxX; node.maxY = bounds.maxY; node.maxZ = bounds.maxZ;
+}
+
+void Bvh::Subdivide(uint32_t nodeIndex, const BoundingBoxes& boxes, TaskGroup* group)
+{
+	// Carries the build state through the recursion (and into the subtree tasks).
+	struct Builder
+	{
+		Bvh& bvh;
+		const BoundingBoxes& boxes;
+		TaskGroup* group;
+
+		void Run(uint32_t nodeIndex, uint32_t depth) const
+		{
+			Node& node = bvh.m_Nodes[nodeIndex];
+			if (node.count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+				return;
+
+			uint32_t* prims = bvh.m_PrimitiveIndices.data() + node.leftFirst;
+
+			// Centroid bounds - the bins span these, not the node box.
+			float cMin[3] = { FLOAT_MAX, FLOAT_MAX, FLOAT_MAX };
+			float cMax[3] = { -FLOAT_MAX, -FLOAT_MAX, -FLOAT_MAX };
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					float c = GetCentroid(boxes, prims[i], axis);
+					cMin[axis] = std::min(cMin[axis], c);
+					cMax[axis] = std::max(cMax[axis], c);
+				}
+			}
+
+			// Binned SAH over all 3 axes.
+			float bestCost = FLOAT_MAX;
+			int bestAxis = -1;
+			uint32_t bestSplit = 0;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				if (cMax[axis] <= cMin[axis])
+					continue;
+
+				Bounds binBounds[SAH_BINS];
+				uint32_t binCount[SAH_BINS] = {};
+				const float scale = SAH_BINS / (cMax[axis] - cMin[axis]);
+				for (uint32_t i = 0; i < node.count; ++i)
+				{
+					uint32_t bin = std::min(SAH_BINS - 1,
+						static_cast<uint32_t>((GetCentroid(boxes, prims[i], axis) - cMin[axis]) * scale));
+					++binCount[bin];
+					GrowByPrimitive(binBounds[bin], boxes, prims[i]);
+				}
+
+				// Sweep from both sides: cost of splitting after bin i.
+				float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+				uint32_t leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+				Bounds left, right;
+				uint32_t leftSum = 0, rightSum = 0;
+				for (uint32_t i = 0; i < SAH_BINS - 1; ++i)
+				{
+					leftSum += binCount[i];
+					left.Grow(binBounds[i]);
+					leftCount[i] = leftSum;
+					leftArea[i] = left.HalfArea();
+
+					rightSum += binCount[SAH_BINS - 1 - i];
+					right.Grow(binBounds[SAH_BINS - 1 - i]);
+					rightCount[SAH_BINS - 2 - i] = rightSum;
+					rightArea[SAH_BINS - 2 - i] = right.HalfArea();
+				}
+
+				for (uint32_t i = 0; i < SAH_BINS - 1; ++i)
+				{
+					float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+					if (leftCount[i] && rightCount[i] && cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = i;
+					}
+				}
+			}
+
+			// Splitting must beat intersecting every primitive of the leaf.
+			Bounds nodeBounds;
+			nodeBounds.Grow(node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ);
+			if (bestAxis < 0 || bestCost >= node.count * nodeBounds.HalfArea())
+				return;
+
+			// Partition the primitive range.
+			const float scale = SAH_BINS / (cMax[bestAxis] - cMin[bestAxis]);
+			uint32_t* first = prims;
+			uint32_t* last = prims + node.count;
+			while (first < last)
+			{
+				uint32_t bin = std::min(SAH_BINS - 1,
+					static_cast<uint32_t>((GetCentroid(boxes, *first, bestAxis) - cMin[bestAxis]) * scale));
+				if (bin <= bestSplit)
+					++first;
+				else
+					std::swap(*first, *--last);
+			}
+			uint32_t leftCount = static_cast<uint32_t>(first - prims);
+			if (leftCount == 0 || leftCount == node.count)
+				return;
+
+			uint32_t childIndex = bvh.m_NodesUsed.fetch_add(2, std::memory_order_relaxed);
+			Node& leftChild = bvh.m_Nodes[childIndex];
+			Node& rightChild = bvh.m_Nodes[childIndex + 1];
+			leftChild.leftFirst = node.leftFirst;
+			leftChild.count = leftCount;
+			rightChild.leftFirst = node.leftFirst + leftCount;
+			rightChild.count = node.count - leftCount;
+			bvh.ComputeLeafBounds(leftChild, boxes);
+			bvh.ComputeLeafBounds(rightChild, boxes);
+
+			const bool parallel = group && node.count > PARALLEL_BUILD_THRESHOLD;
+			node.leftFirst = childIndex;
+			node.count = 0;
+
+			// Children work on disjoint primitive ranges and nodes - safe to build in parallel.
+			if (parallel)
+			{
+				const Builder builder = *this;
+				group->Run([builder, childIndex, depth]() { builder.Run(childIndex, depth + 1); });
+			}
+			else
+			{
+				Run(childIndex, depth + 1);
+			}
+			Run(childIndex + 1, depth + 1);
+		}
+	};
+
+	Builder builder = { *this, boxes, group };
+	builder.Run(nodeIndex, 0);
+}
+
+// Children are always allocated after their parent, so walking the nodes backwards
+//		visits both children before the parent.
+void Bvh::Refit(const BoundingBoxes& boxes)
+{
+	assert(boxes.GetCount() == m_PrimitiveIndices.size() && "Refit needs the primitives of the last Build().");
+
+	for (size_t i = m_NodeCount; i-- > 0;)
+	{
+		if (i == 1)
+			continue;
+
+		Node& node = m_Nodes[i];
+		if (node.count)
+		{
+			ComputeLeafBounds(node, boxes);
+			continue;
+		}
+
+		const Node& left = m_Nodes[node.leftFirst];
+		const Node& right = m_Nodes[node.leftFirst + 1];
+		node.minX = std::min(left.minX, right.minX); node.minY = std::min(left.minY, right.minY); node.minZ = std::min(left.minZ, right.minZ);
+		node.maxX = std::max(left.maxX, right.maxX); node.maxY = std::max(left.maxY, right.maxY); node.maxZ = std::max(left.maxZ, right.maxZ);
+	}
+}
+
+// =====================================================================================
+//									Frustum culling
+// =====================================================================================
+
+void Bvh::AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visible) const
+{
+	// The primitives of a subtree are one contiguous range - find it from the
+	//		leftmost and rightmost leaves.
+	uint32_t first = nodeIndex;
+	while (m_Nodes[first].count == 0)
+		first = m_Nodes[first].leftFirst;
+	uint32_t last = nodeIndex;
+	while (m_Nodes[last].count == 0)
+		last = m_Nodes[last].leftFirst + 1;
+
+	const uint32_t* begin = m_PrimitiveIndices.data() + m_Nodes[first].leftFirst;
+	const uint32_t* end = m_PrimitiveIndices.data() + m_Nodes[last].leftFirst + m_Nodes[last].count;
+	visible.insert(visible.end(), begin, end);
+}
+
+void Bvh::CullFrustum(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible) const
+{
+	if (m_NodeCount == 0)
+		return;
+
+	// Every stack entry carries the planes its box still intersects - a plane the parent
+	//		is completely inside of can't cut any of the children.
+	struct Entry { uint32_t node; uint32_t planeMask; };
+	Entry stack[MAX_DEPTH + 2];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, (1u << Frustum::Count) - 1 };
+
+	while (stackSize)
+	{
+		const Entry entry = stack[--stackSize];
+		const Node& node = m_Nodes[entry.node];
+
+		float cx = (node.minX + node.maxX) * 0.5f, cy = (node.minY + node.maxY) * 0.5f, cz = (node.minZ + node.maxZ) * 0.5f;
+		float ex = (node.maxX - node.minX) * 0.5f, ey = (node.maxY - node.minY) * 0.5f, ez = (node.maxZ - node.minZ) * 0.5f;
+
+		uint32_t planeMask = entry.planeMask;
+		bool outside = false;
+		for (int i = 0; i < Frustum::Count && !outside; ++i)
+		{
+			if (!(planeMask & (1u << i)))
+				continue;
+
+			const XMFLOAT4& p = frustum.planes[i];
+			float distance = p.x * cx + p.y * cy + p.z * cz + p.w;
+			float radius = std::fabs(p.x) * ex + std::fabs(p.y) * ey + std::fabs(p.z) * ez;
+			if (distance + radius < 0.0f)
+				outside = true;
+			else if (distance - radius >= 0.0f)
+				planeMask &= ~(1u << i);
+		}
+
+		if (outside)
+			continue;
+
+		if (planeMask == 0)
+		{
+			AppendSubtree(entry.node, visible);
+		}
+		else if (node.count)
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t p = m_PrimitiveIndices[node.leftFirst + i];
+				if (FrustumCuller::CullBoxesScalar(frustum, boxes, p, p + 1, &p))
+					visible.push_back(p);
+			}
+		}
+		else
+		{
+			stack[stackSize++] = { node.leftFirst + 1, planeMask };
+			stack[stackSize++] = { node.leftFirst, planeMask };
+		}
+	}
+}
+
+// =====================================================================================
+//									  Ray queries
+// =====================================================================================
+
+bool Bvh::Raycast(const Ray& ray, const BoundingBoxes& boxes, RayHit& hit, const PrimitiveIntersector& intersector) const
+{
+	hit.primitive = INVALID_PRIMITIVE;
+	hit.t = ray.tMax;
+	if (m_NodeCount == 0)
+		return false;
+
+	const PreparedRay prepared(ray);
+	if (prepared.Intersect(m_Nodes[0], ray.tMax) == FLOAT_MAX)
+		return false;
+
+	// Nearest child first; the far child is pushed with its entry distance so it can be
+	//		skipped if a closer hit was found in the meantime.
+	struct Entry { uint32_t node; float t; };
+	Entry stack[MAX_DEPTH + 2];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+
+	while (stackSize)
+	{
+		const Entry entry = stack[--stackSize];
+		if (entry.t >= hit.t)
+			continue;
+
+		const Node& node = m_Nodes[entry.node];
+		if (node.count)
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t p = m_PrimitiveIndices[node.leftFirst + i];
+				float t;
+				if (IntersectPrimitive(prepared, ray, boxes, p, hit.t, intersector, t))
+				{
+					hit.t = t;
+					hit.primitive = p;
+				}
+			}
+			continue;
+		}
+
+		uint32_t nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+		float tNear = prepared.Intersect(m_Nodes[nearChild], hit.t);
+		float tFar = prepared.Intersect(m_Nodes[farChild], hit.t);
+		if (tFar < tNear)
+		{
+			std::swap(nearChild, farChild);
+			std::swap(tNear, tFar);
+		}
+		if (tFar != FLOAT_MAX)
+			stack[stackSize++] = { farChild, tFar };
+		if (tNear != FLOAT_MAX)
+			stack[stackSize++] = { nearChild, tNear };
+	}
+
+	return hit.primitive != INVALID_PRIMITIVE;
+}
+
+bool Bvh::IsOccluded(const Ray& ray, const BoundingBoxes& boxes, const PrimitiveIntersector& intersector) const
+{
+	if (m_NodeCount == 0)
+		return false;
+
+	const PreparedRay prepared(ray);
+	uint32_t stack[MAX_DEPTH + 2];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	// Any hit ends the query, so no ordering is needed.
+	while (stackSize)
+	{
+		const Node& node = m_Nodes[stack[--stackSize]];
+		if (prepared.Intersect(node, ray.tMax) == FLOAT_MAX)
+			continue;
+
+		if (node.count)
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				float t;
+				if (IntersectPrimitive(prepared, ray, boxes, m_PrimitiveIndices[node.leftFirst + i], ray.tMax, intersector, t))
+					return true;
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.leftFirst + 1;
+		stack[stackSize++] = node.leftFirst;
+	}
+	return false;
+}
+
+void Bvh::RaycastPacket(const Ray rays[4], const BoundingBoxes& boxes, RayHit hits[4], const PrimitiveIntersector& intersector) const
+{
+#if defined(BVH_SSE)
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		hits[lane].primitive = INVALID_PRIMITIVE;
+		hits[lane].t = rays[lane].tMax;
+	}
+	if (m_NodeCount == 0)
+		return;
+
+	// One register per ray component, one lane per ray.
+	const __m128 ox = _mm_setr_ps(rays[0].origin.x, rays[1].origin.x, rays[2].origin.x, rays[3].origin.x);
+	const __m128 oy = _mm_setr_ps(rays[0].origin.y, rays[1].origin.y, rays[2].origin.y, rays[3].origin.y);
+	const __m128 oz = _mm_setr_ps(rays[0].origin.z, rays[1].origin.z, rays[2].origin.z, rays[3].origin.z);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 ix = _mm_div_ps(one, _mm_setr_ps(rays[0].direction.x, rays[1].direction.x, rays[2].direction.x, rays[3].direction.x));
+	const __m128 iy = _mm_div_ps(one, _mm_setr_ps(rays[0].direction.y, rays[1].direction.y, rays[2].direction.y, rays[3].direction.y));
+	const __m128 iz = _mm_div_ps(one, _mm_setr_ps(rays[0].direction.z, rays[1].direction.z, rays[2].direction.z, rays[3].direction.z));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 negativeInfinity = _mm_set1_ps(-FLOAT_INFINITY);
+	const __m128 positiveInfinity = _mm_set1_ps(FLOAT_INFINITY);
+
+	// Closest hit so far per ray - boxes behind it are culled.
+	__m128 best = _mm_setr_ps(rays[0].tMax, rays[1].tMax, rays[2].tMax, rays[3].tMax);
+
+	// PreparedRay::Slab for 4 rays: lanes where 0 * inf gave NaN don't limit the ray.
+	auto slab4 = [&](float min, float max, __m128 o, __m128 i, __m128& tEnter, __m128& tLeave) {
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(min), o), i), t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(max), o), i);
+		__m128 onPlane = _mm_cmpunord_ps(t1, t2);
+		tEnter = _mm_or_ps(_mm_andnot_ps(onPlane, _mm_min_ps(t1, t2)), _mm_and_ps(onPlane, negativeInfinity));
+		tLeave = _mm_or_ps(_mm_andnot_ps(onPlane, _mm_max_ps(t1, t2)), _mm_and_ps(onPlane, positiveInfinity));
+	};
+
+	// Entry distance of 4 rays into one box and the mask of rays that hit it.
+	auto intersect4 = [&](float minX, float minY, float minZ, float maxX, float maxY, float maxZ, __m128& tNear) {
+		__m128 tx1, tx2, ty1, ty2, tz1, tz2;
+		slab4(minX, maxX, ox, ix, tx1, tx2);
+		slab4(minY, maxY, oy, iy, ty1, ty2);
+		slab4(minZ, maxZ, oz, iz, tz1, tz2);
+
+		tNear = _mm_max_ps(_mm_max_ps(tx1, ty1), _mm_max_ps(tz1, zero));
+		__m128 tFar = _mm_min_ps(_mm_min_ps(tx2, ty2), tz2);
+		return _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(tFar, tNear), _mm_cmplt_ps(tNear, best)));
+	};
+
+	uint32_t stack[MAX_DEPTH + 2];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = m_Nodes[stack[--stackSize]];
+		__m128 tNode;
+		if (!intersect4(node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, tNode))
+			continue;
+
+		if (node.count == 0)
+		{
+			// Visit first the child that most rays of the packet enter first.
+			const Node& left = m_Nodes[node.leftFirst];
+			const Node& right = m_Nodes[node.leftFirst + 1];
+			__m128 tLeft, tRight;
+			int leftMask = intersect4(left.minX, left.minY, left.minZ, left.maxX, left.maxY, left.maxZ, tLeft);
+			int rightMask = intersect4(right.minX, right.minY, right.minZ, right.maxX, right.maxY, right.maxZ, tRight);
+			int bothMask = leftMask & rightMask;
+			int leftCloser = _mm_movemask_ps(_mm_cmple_ps(tLeft, tRight)) & bothMask;
+
+			bool leftNearer = leftMask && (!rightMask || 2 * PopCount4(leftCloser) >= PopCount4(bothMask));
+			if (leftNearer)
+			{
+				if (rightMask) stack[stackSize++] = node.leftFirst + 1;
+				stack[stackSize++] = node.leftFirst;
+			}
+			else
+			{
+				if (leftMask) stack[stackSize++] = node.leftFirst;
+				if (rightMask) stack[stackSize++] = node.leftFirst + 1;
+			}
+			continue;
+		}
+
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			uint32_t p = m_PrimitiveIndices[node.leftFirst + i];
+			__m128 tPrim;
+			int mask = intersect4(boxes.centerX[p] - boxes.extentX[p], boxes.centerY[p] - boxes.extentY[p], boxes.centerZ[p] - boxes.extentZ[p],
+				boxes.centerX[p] + boxes.extentX[p], boxes.centerY[p] + boxes.extentY[p], boxes.centerZ[p] + boxes.extentZ[p], tPrim);
+			if (!mask)
+				continue;
+
+			float t[4], bestT[4];
+			_mm_storeu_ps(t, tPrim);
+			_mm_storeu_ps(bestT, best);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (!(mask & (1 << lane)))
+					continue;
+
+				if (intersector)
+				{
+					Ray clipped = rays[lane];
+					clipped.tMax = bestT[lane];
+					if (!intersector(p, clipped, t[lane]) || t[lane] >= bestT[lane])
+						continue;
+				}
+				bestT[lane] = t[lane];
+				hits[lane].t = t[lane];
+				hits[lane].primitive = p;
+			}
+			best = _mm_loadu_ps(bestT);
+		}
+	}
+#else
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		Raycast(rays[lane], boxes, hits[lane], intersector);
+	}
+#endif
+}
+
+// =====================================================================================
+//										Picking
+// =====================================================================================
+
+Ray ScreenPointToRay(float x, float y, float width, float height, FXMMATRIX view, CXMMATRIX projection)
+{
+	// Pixel -> normalized device coordinates (y points up in NDC).
+	float ndcX = 2.0f * x / width - 1.0f;
+	float ndcY = 1.0f - 2.0f * y / height;
+
+	XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, XMMatrixMultiply(view, projection));
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverseViewProjection);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverseViewProjection);
+
+	// t = 0 on the near plane, t = 1 on the far plane.
+	Ray ray;
+	XMStoreFloat3(&ray.origin, nearPoint);
+	XMStoreFloat3(&ray.direction, XMVectorSubtract(farPoint, nearPoint));
+	ray.tMax = 1.0f;
+	return ray;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+class TaskScheduler;
+class TaskGroup;
+
+// =====================================================================================
+//										Rays
+// =====================================================================================
+
+struct Ray
+{
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 direction;	// does not need to be normalized, t is in units of it; zero components are fine
+	float tMax;
+};
+
+struct RayHit
+{
+	uint32_t primitive;				// INVALID_PRIMITIVE if nothing was hit
+	float t;
+};
+
+constexpr uint32_t INVALID_PRIMITIVE = 0xFFFFFFFFu;
+
+// World space ray through a pixel (mouse picking). x, y in pixels from the top left.
+Ray ScreenPointToRay(float x, float y, float width, float height,
+	DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection);
+
+// =====================================================================================
+//								Bounding volume hierarchy
+// =====================================================================================
+
+// Binary BVH over the primitive boxes of a BoundingBoxes array.
+//
+// Build:
+//		Top down, binned SAH - at every node the primitive centroids are sorted into 16
+//		bins per axis and the split with the lowest surface area cost is taken. Subtrees
+//		larger than a few thousand primitives are built in parallel on the TaskScheduler.
+//
+// Refit:
+//		For moving objects the topology is kept and only the node boxes are recomputed
+//		bottom up - O(n) and much cheaper than a rebuild. The tree quality slowly degrades
+//		as objects move away from their original neighbours, so rebuild every now and then.
+//
+// Layout:
+//		Nodes are 32 bytes in one flat array, the two children of a node are always
+//		stored next to each other (leftFirst, leftFirst + 1) so both child boxes are
+//		fetched together. Node 1 is left unused so the pairs start at even indices.
+//
+// Primitives are the boxes themselves; ray queries can refine a box hit with an exact
+//		intersector callback (triangles, spheres, ...).
+class Bvh
+{
+public:
+	struct Node
+	{
+		float minX, minY, minZ;
+		uint32_t leftFirst;			// interior: index of the left child, leaf: first primitive
+		float maxX, maxY, maxZ;
+		uint32_t count;				// 0 for interior nodes, number of primitives for leaves
+	};
+
+	// Exact primitive test, called for primitives whose box is hit.
+	//		Return true and the hit distance in "t" if the ray hits the primitive.
+	typedef std::function<bool(uint32_t primitive, const Ray& ray, float& t)> PrimitiveIntersector;
+
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	void Build(const BoundingBoxes& boxes, TaskScheduler* scheduler = nullptr);
+	// Same primitives, new boxes - the count must not have changed since Build().
+	void Refit(const BoundingBoxes& boxes);
+
+	// Hierarchical culling: subtrees completely inside the frustum are accepted without
+	//		testing their primitives, subtrees completely outside are skipped. The visible
+	//		primitives are appended to "visible" in traversal order.
+	void CullFrustum(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible) const;
+
+	// Closest hit.
+	bool Raycast(const Ray& ray, const BoundingBoxes& boxes, RayHit& hit,
+		const PrimitiveIntersector& intersector = nullptr) const;
+	// Any hit - for visibility queries (shadows, line of sight).
+	bool IsOccluded(const Ray& ray, const BoundingBoxes& boxes,
+		const PrimitiveIntersector& intersector = nullptr) const;
+	// Closest hit for 4 rays at once. Coherent rays (same origin, close directions) share
+	//		most of the traversal, so the nodes are tested for all 4 rays with SSE.
+	void RaycastPacket(const Ray rays[4], const BoundingBoxes& boxes, RayHit hits[4],
+		const PrimitiveIntersector& intersector = nullptr) const;
+
+	size_t GetNodeCount() const { return m_NodeCount; }
+	const Node* GetNodes() const { return m_Nodes.data(); }
+	const uint32_t* GetPrimitiveIndices() const { return m_PrimitiveIndices.data(); }
+
+private:
+	void Subdivide(uint32_t nodeIndex, const BoundingBoxes& boxes, TaskGroup* group);
+	void ComputeLeafBounds(Node& node, const BoundingBoxes& boxes) const;
+	void AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visible) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	std::vector<Node> m_Nodes;
+	size_t m_NodeCount = 0;
+	// Leaves reference contiguous ranges of this array.
+	std::vector<uint32_t> m_PrimitiveIndices;
+
+	// Node allocation during a (parallel) build.
+	std::atomic<uint32_t> m_NodesUsed{ 0 };
+};
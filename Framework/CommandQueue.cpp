@@ -59,6 +59,12 @@ void CommandQueue::Flush()
 }
 
 
+void CommandQueue::Wait(const CommandQueue& other, UINT64 fenceValue)
+{
+	ThrowIfFailed(m_d3d12CommandQueue->Wait(other.m_d3d12Fence.Get(), fenceValue));
+}
+
+
 ComPtr<ID3D12CommandAllocator> CommandQueue::CreateCommandAllocator()
 {
 	ComPtr<ID3D12CommandAllocator> commandAllocator;
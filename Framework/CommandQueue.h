@@ -15,6 +15,9 @@ public:
 	bool IsFenceComplete(UINT64 fenceValue);
 	void WaitForFenceValue(UINT64 fenceValue);
 	void Flush();
+	// GPU side wait: work submitted to this queue from now on starts after "other" reached
+	//		"fenceValue" - e.g. the compute queue waiting for rendering on the direct queue.
+	void Wait(const CommandQueue& other, UINT64 fenceValue);
 
 	// Get an available command list from the command queue.
 	ComPtr<ID3D12GraphicsCommandList2> GetCommandList();
@@ -0,0 +1,500 @@
+#include "Compression.h"
+
+#include <algorithm> // std::min
+#include <cstring>   // std::memcpy
+#include <vector>
+
+#if defined(DX12FW_WITH_ZSTD)
+#include <zstd.h>
+#include <memory>
+#endif
+
+
+// =====================================================================================
+//										LZ4
+// =====================================================================================
+
+// A block is a list of sequences:
+//		token			literal length (high 4 bits), match length - 4 (low 4 bits);
+//						15 means "more length bytes follow"
+//		[length bytes]	255, 255, ..., < 255 - added to the literal length
+//		literals
+//		offset			2 bytes, little endian, 1 - 65535 back from the current position
+//		[length bytes]	added to the match length
+// The last sequence has literals only. The format requires the last 5 bytes to be
+//		literals and the last match to start at least 12 bytes before the end.
+namespace
+{
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5;
+	constexpr size_t MF_LIMIT = 12;
+	constexpr size_t MAX_OFFSET = 65535;
+
+	constexpr int FAST_HASH_BITS = 14;
+	constexpr int CHAIN_HASH_BITS = 15;
+	constexpr size_t CHAIN_WINDOW = 65536;
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Hash4(uint32_t value, int bits)
+	{
+		return (value * 2654435761u) >> (32 - bits);
+	}
+
+	// Number of equal bytes at "a" and "b", not reading past "limit" (a > b).
+	inline size_t CountMatch(const uint8_t* a, const uint8_t* b, const uint8_t* limit)
+	{
+		const uint8_t* start = a;
+		while (a + 8 <= limit)
+		{
+			uint64_t x, y;
+			std::memcpy(&x, a, 8);
+			std::memcpy(&y, b, 8);
+			const uint64_t difference = x ^ y;
+			if (difference)
+			{
+				// Little endian: the lowest set bit is the first differing byte.
+				size_t equal = 0;
+				uint64_t d = difference;
+				while (!(d & 0xFF))
+				{
+					d >>= 8;
+					++equal;
+				}
+				return size_t(a - start) + equal;
+			}
+			a += 8;
+			b += 8;
+		}
+		while (a < limit && *a == *b)
+		{
+			++a;
+			++b;
+		}
+		return size_t(a - start);
+	}
+
+	inline uint8_t* WriteLength(uint8_t* op, size_t length)
+	{
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = uint8_t(length);
+		return op;
+	}
+
+	// Appends one sequence, a match length of 0 makes it the final literals-only one.
+	//		False if the output is full.
+	bool EmitSequence(uint8_t*& op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLength,
+		size_t offset, size_t matchLength)
+	{
+		const size_t needed = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+		if (size_t(opEnd - op) < needed)
+			return false;
+
+		uint8_t* token = op++;
+		const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+		*token = uint8_t((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+		if (literalLength >= 15)
+			op = WriteLength(op, literalLength - 15);
+		std::memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		if (matchLength)
+		{
+			*op++ = uint8_t(offset);
+			*op++ = uint8_t(offset >> 8);
+			if (matchCode >= 15)
+				op = WriteLength(op, matchCode - 15);
+		}
+		return true;
+	}
+
+	// Greedy, one hash table probe per position. Positions that keep missing are skipped
+	//		faster and faster (1 + misses / 64), so incompressible data goes through quickly.
+	size_t Lz4CompressFast(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+	{
+		uint8_t* op = dst;
+		const uint8_t* opEnd = dst + capacity;
+		const uint8_t* anchor = src;
+		const uint8_t* end = src + size;
+
+		if (size > MF_LIMIT)
+		{
+			std::vector<uint32_t> table(size_t(1) << FAST_HASH_BITS, 0);
+			const uint8_t* matchLimit = end - LAST_LITERALS;
+			const uint8_t* mfLimit = end - MF_LIMIT;
+
+			const uint8_t* ip = src;
+			while (ip < mfLimit)
+			{
+				const uint32_t hash = Hash4(Read32(ip), FAST_HASH_BITS);
+				const uint8_t* candidate = src + table[hash];
+				table[hash] = uint32_t(ip - src);
+
+				if (candidate >= ip || size_t(ip - candidate) > MAX_OFFSET || Read32(candidate) != Read32(ip))
+				{
+					ip += 1 + (size_t(ip - anchor) >> 6);
+					continue;
+				}
+
+				// Grow the match backwards into the pending literals.
+				while (ip > anchor && candidate > src && ip[-1] == candidate[-1])
+				{
+					--ip;
+					--candidate;
+				}
+
+				const size_t length = MIN_MATCH + CountMatch(ip + MIN_MATCH, candidate + MIN_MATCH, matchLimit);
+				if (!EmitSequence(op, opEnd, anchor, size_t(ip - anchor), size_t(ip - candidate), length))
+					return 0;
+				ip += length;
+				anchor = ip;
+
+				// The position just before the match end often starts the next match.
+				if (ip < mfLimit)
+					table[Hash4(Read32(ip - 2), FAST_HASH_BITS)] = uint32_t(ip - 2 - src);
+			}
+		}
+
+		if (!EmitSequence(op, opEnd, anchor, size_t(end - anchor), 0, 0))
+			return 0;
+		return size_t(op - dst);
+	}
+
+	// Hash chains: every position links to the previous one with the same hash, within
+	//		the 64KB window. The longest of up to "maxAttempts" candidates wins, and a match
+	//		is deferred by one byte if the next position has a longer one (lazy matching).
+	class Lz4ChainMatcher
+	{
+	public:
+		Lz4ChainMatcher(const uint8_t* src, const uint8_t* matchLimit, int maxAttempts)
+			: m_Src(src), m_MatchLimit(matchLimit), m_MaxAttempts(maxAttempts)
+			, m_Head(size_t(1) << CHAIN_HASH_BITS, -1), m_Chain(CHAIN_WINDOW, 0)
+		{
+		}
+
+		// Longest match at "position", 0 if none.
+		size_t Find(size_t position, size_t& offset)
+		{
+			// Link every position before this one first.
+			for (; m_NextInsert < position; ++m_NextInsert)
+			{
+				const uint32_t hash = Hash4(Read32(m_Src + m_NextInsert), CHAIN_HASH_BITS);
+				const int32_t previous = m_Head[hash];
+				const size_t delta = previous < 0 ? 0 : std::min<size_t>(m_NextInsert - size_t(previous), 65535);
+				m_Chain[m_NextInsert & (CHAIN_WINDOW - 1)] = uint16_t(delta);
+				m_Head[hash] = int32_t(m_NextInsert);
+			}
+
+			const uint8_t* ip = m_Src + position;
+			const uint32_t value = Read32(ip);
+			int64_t candidate = m_Head[Hash4(value, CHAIN_HASH_BITS)];
+			size_t best = 0;
+			for (int attempts = m_MaxAttempts; candidate >= 0 && attempts > 0; --attempts)
+			{
+				if (position - size_t(candidate) > MAX_OFFSET)
+					break;
+
+				const uint8_t* match = m_Src + candidate;
+				if (Read32(match) == value)
+				{
+					const size_t length = MIN_MATCH + CountMatch(ip + MIN_MATCH, match + MIN_MATCH, m_MatchLimit);
+					if (length > best)
+					{
+						best = length;
+						offset = position - size_t(candidate);
+					}
+				}
+
+				const uint16_t delta = m_Chain[size_t(candidate) & (CHAIN_WINDOW - 1)];
+				if (delta == 0)
+					break;
+				candidate -= delta;
+			}
+			return best;
+		}
+
+	private:
+		const uint8_t* m_Src;
+		const uint8_t* m_MatchLimit;
+		int m_MaxAttempts;
+		std::vector<int32_t> m_Head;
+		std::vector<uint16_t> m_Chain;
+		size_t m_NextInsert = 0;
+	};
+
+	size_t Lz4CompressChain(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, int level)
+	{
+		uint8_t* op = dst;
+		const uint8_t* opEnd = dst + capacity;
+		size_t anchor = 0;
+
+		if (size > MF_LIMIT)
+		{
+			const size_t mfLimit = size - MF_LIMIT;
+			Lz4ChainMatcher matcher(src, src + size - LAST_LITERALS, 1 << std::min(level - 1, 12));
+
+			size_t position = 0;
+			while (position < mfLimit)
+			{
+				size_t offset = 0;
+				size_t length = matcher.Find(position, offset);
+				if (length == 0)
+				{
+					++position;
+					continue;
+				}
+
+				// Lazy: take the next position instead if its match is longer.
+				while (position + 1 < mfLimit)
+				{
+					size_t nextOffset = 0;
+					const size_t nextLength = matcher.Find(position + 1, nextOffset);
+					if (nextLength <= length)
+						break;
+					++position;
+					length = nextLength;
+					offset = nextOffset;
+				}
+
+				if (!EmitSequence(op, opEnd, src + anchor, position - anchor, offset, length))
+					return 0;
+				position += length;
+				anchor = position;
+			}
+		}
+
+		if (!EmitSequence(op, opEnd, src + anchor, size - anchor, 0, 0))
+			return 0;
+		return size_t(op - dst);
+	}
+
+	// Reads an extended length (the bytes after a 15 in the token). False if the input ends.
+	inline bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (ip >= end)
+				return false;
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+}
+
+size_t Lz4Compress(const void* source, size_t sourceSize, void* destination, size_t capacity, int level)
+{
+	const uint8_t* src = static_cast<const uint8_t*>(source);
+	uint8_t* dst = static_cast<uint8_t*>(destination);
+	return level <= LZ4_LEVEL_FAST ?
+		Lz4CompressFast(src, sourceSize, dst, capacity) :
+		Lz4CompressChain(src, sourceSize, dst, capacity, std::min(level, LZ4_LEVEL_MAX));
+}
+
+bool Lz4Decompress(const void* source, size_t sourceSize, void* destination, size_t destinationSize)
+{
+	const uint8_t* ip = static_cast<const uint8_t*>(source);
+	const uint8_t* const ipEnd = ip + sourceSize;
+	uint8_t* const dst = static_cast<uint8_t*>(destination);
+	uint8_t* op = dst;
+	uint8_t* const opEnd = dst + destinationSize;
+
+	for (;;)
+	{
+		if (ip >= ipEnd)
+			return false;
+		const uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength < 15 && ipEnd - ip >= 16 && opEnd - op >= 16)
+		{
+			// Short literals: one fixed size copy, the extra bytes are overwritten later.
+			std::memcpy(op, ip, 16);
+		}
+		else
+		{
+			if (literalLength == 15 && !ReadLength(ip, ipEnd, literalLength))
+				return false;
+			if (literalLength > size_t(ipEnd - ip) || literalLength > size_t(opEnd - op))
+				return false;
+			std::memcpy(op, ip, literalLength);
+		}
+		op += literalLength;
+		ip += literalLength;
+
+		// The last sequence ends the block right after its literals.
+		if (ip == ipEnd)
+			return op == opEnd;
+
+		if (ipEnd - ip < 2)
+			return false;
+		const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+		ip += 2;
+		if (offset == 0 || offset > size_t(op - dst))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(ip, ipEnd, matchLength))
+			return false;
+		matchLength += MIN_MATCH;
+		if (matchLength > size_t(opEnd - op))
+			return false;
+
+		const uint8_t* match = op - offset;
+		if (offset >= 16 && size_t(opEnd - op) >= matchLength + 15)
+		{
+			// 16 byte chunks never read what the same chunk writes when offset >= 16. The
+			//		last chunk may run up to 15 bytes past the match, into space that the
+			//		following sequences overwrite.
+			uint8_t* const matchEnd = op + matchLength;
+			do
+			{
+				std::memcpy(op, match, 16);
+				op += 16;
+				match += 16;
+			} while (op < matchEnd);
+			op = matchEnd;
+		}
+		else if (offset >= matchLength)
+		{
+			std::memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			// Overlapping copy repeats the last "offset" bytes. Copying from the fixed match
+			//		start doubles the repeated span with every memcpy.
+			uint8_t* const matchEnd = op + matchLength;
+			while (op < matchEnd)
+			{
+				const size_t chunk = std::min(size_t(matchEnd - op), size_t(op - match));
+				std::memcpy(op, match, chunk);
+				op += chunk;
+			}
+		}
+	}
+}
+
+// =====================================================================================
+//										Zstd
+// =====================================================================================
+
+#if defined(DX12FW_WITH_ZSTD)
+
+namespace
+{
+	struct ZstdContextDeleter
+	{
+		void operator()(ZSTD_DCtx* context) const { ZSTD_freeDCtx(context); }
+	};
+
+	// Creating a decompression context costs more than decompressing a 64KB block - keep
+	//		one per thread.
+	ZSTD_DCtx* GetThreadDecompressionContext()
+	{
+		thread_local std::unique_ptr<ZSTD_DCtx, ZstdContextDeleter> context(ZSTD_createDCtx());
+		return context.get();
+	}
+}
+
+#endif
+
+// =====================================================================================
+//										Dispatch
+// =====================================================================================
+
+bool IsCompressionSupported(CompressionMethod method)
+{
+	switch (method)
+	{
+	case CompressionMethod::None:
+	case CompressionMethod::LZ4:
+		return true;
+	case CompressionMethod::Zstd:
+#if defined(DX12FW_WITH_ZSTD)
+		return true;
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+size_t GetCompressBound(CompressionMethod method, size_t size)
+{
+	switch (method)
+	{
+	case CompressionMethod::None:
+		return size;
+	case CompressionMethod::LZ4:
+		return size + size / 255 + 16;
+	case CompressionMethod::Zstd:
+#if defined(DX12FW_WITH_ZSTD)
+		return ZSTD_compressBound(size);
+#else
+		return 0;
+#endif
+	}
+	return 0;
+}
+
+size_t CompressBlock(CompressionMethod method, int level, const void* source, size_t sourceSize,
+	void* destination, size_t capacity)
+{
+	switch (method)
+	{
+	case CompressionMethod::None:
+		if (sourceSize > capacity)
+			return 0;
+		std::memcpy(destination, source, sourceSize);
+		return sourceSize;
+	case CompressionMethod::LZ4:
+		return Lz4Compress(source, sourceSize, destination, capacity, level);
+	case CompressionMethod::Zstd:
+	{
+#if defined(DX12FW_WITH_ZSTD)
+		const size_t result = ZSTD_compress(destination, capacity, source, sourceSize, level);
+		return ZSTD_isError(result) ? 0 : result;
+#else
+		return 0;
+#endif
+	}
+	}
+	return 0;
+}
+
+bool DecompressBlock(CompressionMethod method, const void* source, size_t sourceSize,
+	void* destination, size_t destinationSize)
+{
+	switch (method)
+	{
+	case CompressionMethod::None:
+		if (sourceSize != destinationSize)
+			return false;
+		std::memcpy(destination, source, sourceSize);
+		return true;
+	case CompressionMethod::LZ4:
+		return Lz4Decompress(source, sourceSize, destination, destinationSize);
+	case CompressionMethod::Zstd:
+	{
+#if defined(DX12FW_WITH_ZSTD)
+		const size_t result = ZSTD_decompressDCtx(GetThreadDecompressionContext(),
+			destination, destinationSize, source, sourceSize);
+		return !ZSTD_isError(result) && result == destinationSize;
+#else
+		return false;
+#endif
+	}
+	}
+	return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// =====================================================================================
+//										Block compression
+// =====================================================================================
+
+// Lossless codecs for pack file blocks. Every call works on one independent block - no
+//		state carries over from one block to the next, so blocks can be (de)compressed on
+//		any thread in any order.
+//
+//		LZ4		in-tree, always available. Byte-aligned LZ77 without entropy coding:
+//				decompression runs at several GB/s per core, the ratio is moderate.
+//		Zstd	the zstd library (facebook/zstd) when built with DX12FW_WITH_ZSTD defined and
+//				libzstd linked. Entropy coded: clearly smaller, decompression ~3x slower
+//				than LZ4. Without it, Zstd blocks can neither be written nor read.
+enum class CompressionMethod : uint8_t
+{
+	None = 0,
+	LZ4 = 1,
+	Zstd = 2,
+};
+
+// LZ4 levels: LZ4_LEVEL_FAST is the single probe greedy compressor (hundreds of MB/s),
+//		higher levels search hash chains (2^(level - 1) candidates per position) with lazy
+//		matching - slower to compress, same decompression speed, better ratio.
+constexpr int LZ4_LEVEL_FAST = 1;
+constexpr int LZ4_LEVEL_MAX = 12;
+// Zstd levels go from 1 to 22, 3 is the library default.
+constexpr int ZSTD_LEVEL_DEFAULT = 3;
+
+bool IsCompressionSupported(CompressionMethod method);
+
+// Largest compressed size of "size" input bytes.
+size_t GetCompressBound(CompressionMethod method, size_t size);
+
+// Returns the compressed size, 0 if it doesn't fit in "capacity" (with
+//		GetCompressBound() bytes it always fits) or the method isn't supported.
+size_t CompressBlock(CompressionMethod method, int level, const void* source, size_t sourceSize,
+	void* destination, size_t capacity);
+
+// Decompresses a whole block. "destinationSize" is the exact uncompressed size - false if
+//		the data doesn't decode to exactly that many bytes. Never reads or writes out of
+//		bounds, even for corrupted input.
+bool DecompressBlock(CompressionMethod method, const void* source, size_t sourceSize,
+	void* destination, size_t destinationSize);
+
+// The raw LZ4 block format (compatible with the reference LZ4_decompress_safe).
+size_t Lz4Compress(const void* source, size_t sourceSize, void* destination, size_t capacity,
+	int level = LZ4_LEVEL_FAST);
+bool Lz4Decompress(const void* source, size_t sourceSize, void* destination, size_t destinationSize);
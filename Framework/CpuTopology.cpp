@@ -0,0 +1,587 @@
+#include "CpuTopology.h"
+
+#include <algorithm> // std::sort, std::max
+#include <cassert>
+#include <map>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+// std::max is used below - keep Windows.h from defining min/max macros.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <intrin.h>  // __cpuid, _xgetbv
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <cstdlib>   // std::strtoul
+#include <fstream>
+#include <sstream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#endif
+
+
+// =====================================================================================
+//									Platform queries
+// =====================================================================================
+
+#if defined(_WIN32)
+
+bool CpuTopology::QueryPlatform(std::vector<RawProcessor>& processors)
+{
+	// The first call only returns the required buffer size.
+	DWORD length = 0;
+	::GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+	if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+		return false;
+
+	std::vector<uint8_t> buffer(length);
+	auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+	if (!::GetLogicalProcessorInformationEx(RelationAll, info, &length))
+		return false;
+
+	// Records are variable sized - walk them with their Size member.
+	//		Packages are reported as masks, map every logical processor to its package first.
+	std::map<uint32_t, uint32_t> packageOf;
+	uint32_t packageIndex = 0;
+	for (DWORD offset = 0; offset < length;)
+	{
+		auto* record = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+		if (record->Relationship == RelationProcessorPackage)
+		{
+			for (WORD g = 0; g < record->Processor.GroupCount; ++g)
+			{
+				const GROUP_AFFINITY& affinity = record->Processor.GroupMask[g];
+				for (uint32_t bit = 0; bit < 64; ++bit)
+				{
+					if (affinity.Mask & (KAFFINITY(1) << bit))
+						packageOf[affinity.Group * 64 + bit] = packageIndex;
+				}
+			}
+			++packageIndex;
+		}
+		offset += record->Size;
+	}
+
+	// EfficiencyClass: higher means faster. It is 0 for every core on non-hybrid CPUs.
+	BYTE maxEfficiencyClass = 0;
+	for (DWORD offset = 0; offset < length;)
+	{
+		auto* record = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+		if (record->Relationship == RelationProcessorCore)
+			maxEfficiencyClass = std::max(maxEfficiencyClass, record->Processor.EfficiencyClass);
+		offset += record->Size;
+	}
+
+	uint64_t coreKey = 0;
+	for (DWORD offset = 0; offset < length;)
+	{
+		auto* record = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+		if (record->Relationship == RelationProcessorCore)
+		{
+			CoreType type = record->Processor.EfficiencyClass < maxEfficiencyClass ?
+				CoreType::Efficiency : CoreType::Performance;
+
+			for (WORD g = 0; g < record->Processor.GroupCount; ++g)
+			{
+				const GROUP_AFFINITY& affinity = record->Processor.GroupMask[g];
+				for (uint32_t bit = 0; bit < 64; ++bit)
+				{
+					if (affinity.Mask & (KAFFINITY(1) << bit))
+					{
+						uint32_t id = affinity.Group * 64 + bit;
+						processors.push_back(RawProcessor{ id, coreKey, packageOf[id], type });
+					}
+				}
+			}
+			++coreKey;
+		}
+		offset += record->Size;
+	}
+
+	return !processors.empty();
+}
+
+bool SetCurrentThreadAffinity(const std::vector<uint32_t>& logicalProcessors)
+{
+	if (logicalProcessors.empty())
+		return false;
+
+	GROUP_AFFINITY affinity = {};
+	affinity.Group = static_cast<WORD>(logicalProcessors.front() / 64);
+	for (uint32_t id : logicalProcessors)
+	{
+		assert(id / 64 == affinity.Group && "Thread affinity can not span processor groups.");
+		affinity.Mask |= KAFFINITY(1) << (id % 64);
+	}
+
+	return ::SetThreadGroupAffinity(::GetCurrentThread(), &affinity, nullptr) != 0;
+}
+
+#else
+
+namespace
+{
+	// Larger cpu ids than this are treated as garbage (Linux supports up to 8192 cpus).
+	constexpr uint32_t MAX_CPU_ID = 65535;
+
+	// Decimal number with optional surrounding whitespace. Unlike std::stoul this never
+	//		throws - sysfs and /proc/cpuinfo can contain empty or unexpected fields.
+	bool ParseUInt(const std::string& text, uint32_t& value)
+	{
+		const char* begin = text.c_str();
+		while (*begin == ' ' || *begin == '\t')
+			++begin;
+		if (*begin < '0' || *begin > '9')
+			return false;
+
+		errno = 0;
+		char* end = nullptr;
+		unsigned long parsed = std::strtoul(begin, &end, 10);
+		if (errno == ERANGE || parsed > 0xFFFFFFFFul)
+			return false;
+		while (*end == ' ' || *end == '\t' || *end == '\n' || *end == '\r')
+			++end;
+		if (*end != '\0')
+			return false;
+
+		value = static_cast<uint32_t>(parsed);
+		return true;
+	}
+
+	// Parse sysfs cpu lists: "0-3,8,10-11". False if the list is malformed.
+	bool ParseCpuList(const std::string& list, std::vector<uint32_t>& cpus)
+	{
+		cpus.clear();
+		std::stringstream stream(list);
+		std::string range;
+		while (std::getline(stream, range, ','))
+		{
+			if (range.find_first_not_of(" \t\n\r") == std::string::npos)
+				continue;
+
+			size_t dash = range.find('-');
+			uint32_t first = 0, last = 0;
+			if (!ParseUInt(range.substr(0, dash), first))
+				return false;
+			if (dash == std::string::npos)
+				last = first;
+			else if (!ParseUInt(range.substr(dash + 1), last))
+				return false;
+			if (last < first || last > MAX_CPU_ID)
+				return false;
+
+			for (uint32_t cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		}
+
+		return !cpus.empty();
+	}
+
+	bool ReadFirstLine(const std::string& path, std::string& line)
+	{
+		std::ifstream file(path);
+		return file && std::getline(file, line);
+	}
+
+	bool ReadUInt(const std::string& path, uint32_t& value)
+	{
+		std::string line;
+		return ReadFirstLine(path, line) && ParseUInt(line, value);
+	}
+
+	// /proc/cpuinfo - used when sysfs topology is not available (some containers).
+	//		False if the file is missing or malformed.
+	bool QueryProcCpuInfo(std::vector<uint32_t>& ids, std::vector<uint64_t>& coreKeys,
+		std::vector<uint32_t>& packages)
+	{
+		std::ifstream file("/proc/cpuinfo");
+		if (!file)
+			return false;
+
+		uint32_t processor = 0, package = 0, core = 0;
+		bool hasProcessor = false;
+		std::string line;
+		auto flush = [&]() {
+			if (hasProcessor)
+			{
+				ids.push_back(processor);
+				coreKeys.push_back((static_cast<uint64_t>(package) << 32) | core);
+				packages.push_back(package);
+			}
+			hasProcessor = false;
+			package = 0;
+			core = processor;
+		};
+
+		while (std::getline(file, line))
+		{
+			size_t colon = line.find(':');
+			if (line.empty())
+			{
+				flush();
+				continue;
+			}
+			if (colon == std::string::npos)
+				continue;
+
+			std::string key = line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1);
+			std::string value = line.substr(colon + 1);
+			bool valid = true;
+			if (key == "processor")
+			{
+				valid = ParseUInt(value, processor) && processor <= MAX_CPU_ID;
+				core = processor;
+				hasProcessor = true;
+			}
+			else if (key == "physical id")
+				valid = ParseUInt(value, package);
+			else if (key == "core id")
+				valid = ParseUInt(value, core);
+
+			if (!valid)
+				return false;
+		}
+		flush();
+
+		return !ids.empty();
+	}
+}
+
+bool CpuTopology::QueryPlatform(std::vector<RawProcessor>& processors)
+{
+	const std::string cpuRoot = "/sys/devices/system/cpu/";
+
+	std::string onlineList;
+	std::vector<uint32_t> online;
+	if (ReadFirstLine(cpuRoot + "online", onlineList))
+		ParseCpuList(onlineList, online);
+
+	// Intel hybrid CPUs expose the P-cores and E-cores as two PMUs.
+	std::string atomList;
+	std::vector<uint32_t> atomCpus;
+	if (ReadFirstLine("/sys/devices/cpu_atom/cpus", atomList))
+		ParseCpuList(atomList, atomCpus);
+
+	// ARM big.LITTLE reports a relative capacity per cpu instead (1024 for the biggest).
+	std::map<uint32_t, uint32_t> capacities;
+	uint32_t maxCapacity = 0;
+	for (uint32_t cpu : online)
+	{
+		uint32_t capacity = 0;
+		if (ReadUInt(cpuRoot + "cpu" + std::to_string(cpu) + "/cpu_capacity", capacity))
+		{
+			capacities[cpu] = capacity;
+			maxCapacity = std::max(maxCapacity, capacity);
+		}
+	}
+
+	for (uint32_t cpu : online)
+	{
+		const std::string topology = cpuRoot + "cpu" + std::to_string(cpu) + "/topology/";
+
+		uint32_t coreId = 0, packageId = 0;
+		if (!ReadUInt(topology + "core_id", coreId) ||
+			!ReadUInt(topology + "physical_package_id", packageId))
+		{
+			processors.clear();
+			break;
+		}
+
+		CoreType type = CoreType::Performance;
+		if (std::find(atomCpus.begin(), atomCpus.end(), cpu) != atomCpus.end())
+			type = CoreType::Efficiency;
+		else if (capacities.count(cpu) && capacities[cpu] < maxCapacity)
+			type = CoreType::Efficiency;
+
+		// core_id is only unique within a package.
+		uint64_t coreKey = (static_cast<uint64_t>(packageId) << 32) | coreId;
+		processors.push_back(RawProcessor{ cpu, coreKey, packageId, type });
+	}
+
+	if (processors.empty())
+	{
+		std::vector<uint32_t> ids, packages;
+		std::vector<uint64_t> coreKeys;
+		// A malformed /proc/cpuinfo leaves "processors" empty: flat topology.
+		if (QueryProcCpuInfo(ids, coreKeys, packages))
+		{
+			for (size_t i = 0; i < ids.size(); ++i)
+				processors.push_back(RawProcessor{ ids[i], coreKeys[i], packages[i], CoreType::Performance });
+		}
+	}
+
+	return !processors.empty();
+}
+
+bool SetCurrentThreadAffinity(const std::vector<uint32_t>& logicalProcessors)
+{
+	if (logicalProcessors.empty())
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (uint32_t id : logicalProcessors)
+		CPU_SET(id, &set);
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#endif
+
+// =====================================================================================
+//										Topology
+// =====================================================================================
+
+CpuTopology CpuTopology::Query()
+{
+	std::vector<RawProcessor> processors;
+	if (!QueryPlatform(processors))
+	{
+		// Unknown - every hardware thread is a core of its own.
+		processors.clear();
+		uint32_t count = std::max(1u, std::thread::hardware_concurrency());
+		for (uint32_t i = 0; i < count; ++i)
+			processors.push_back(RawProcessor{ i, i, 0, CoreType::Performance });
+	}
+
+	CpuTopology topology;
+	topology.Finalize(processors);
+	return topology;
+}
+
+void CpuTopology::Finalize(std::vector<RawProcessor>& processors)
+{
+	std::sort(processors.begin(), processors.end(),
+		[](const RawProcessor& a, const RawProcessor& b) { return a.id < b.id; });
+
+	// Cores are numbered in order of their first hardware thread.
+	std::map<uint64_t, uint32_t> coreIndexOf;
+	for (const RawProcessor& processor : processors)
+	{
+		auto it = coreIndexOf.find(processor.coreKey);
+		if (it == coreIndexOf.end())
+		{
+			it = coreIndexOf.emplace(processor.coreKey, static_cast<uint32_t>(m_PhysicalCores.size())).first;
+			m_PhysicalCores.push_back(PhysicalCore{ processor.packageIndex, processor.type, {} });
+		}
+
+		PhysicalCore& core = m_PhysicalCores[it->second];
+		LogicalProcessor logical;
+		logical.id = processor.id;
+		logical.coreIndex = it->second;
+		logical.packageIndex = processor.packageIndex;
+		logical.smtIndex = static_cast<uint32_t>(core.logicalProcessors.size());
+		core.logicalProcessors.push_back(processor.id);
+
+		m_LogicalProcessors.push_back(logical);
+	}
+}
+
+uint32_t CpuTopology::GetNumCores(CoreType type) const
+{
+	return static_cast<uint32_t>(std::count_if(m_PhysicalCores.begin(), m_PhysicalCores.end(),
+		[type](const PhysicalCore& core) { return core.type == type; }));
+}
+
+// =====================================================================================
+//									Instruction sets
+// =====================================================================================
+
+namespace
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	void CpuId(uint32_t leaf, uint32_t subLeaf, uint32_t registers[4])
+	{
+#if defined(_MSC_VER)
+		int values[4];
+		__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subLeaf));
+		for (int i = 0; i < 4; ++i)
+			registers[i] = static_cast<uint32_t>(values[i]);
+#else
+		__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	// XCR0 - which register states the OS saves on a context switch.
+	uint64_t GetEnabledRegisterStates()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		uint32_t low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+	}
+
+	CpuFeatures QueryCpuFeatures()
+	{
+		CpuFeatures features;
+
+		uint32_t registers[4];
+		CpuId(0, 0, registers);
+		const uint32_t maxLeaf = registers[0];
+		if (maxLeaf < 1)
+			return features;
+
+		CpuId(1, 0, registers);
+		const uint32_t ecx1 = registers[2];
+		features.sse41 = (ecx1 & (1u << 19)) != 0;
+
+		// AVX needs the CPU bit and OSXSAVE, plus XMM and YMM state enabled by the OS.
+		const bool osSavesYmm = (ecx1 & (1u << 27)) != 0 && (GetEnabledRegisterStates() & 0x6) == 0x6;
+		features.avx = osSavesYmm && (ecx1 & (1u << 28)) != 0;
+		features.fma = features.avx && (ecx1 & (1u << 12)) != 0;
+		features.f16c = features.avx && (ecx1 & (1u << 29)) != 0;
+
+		if (maxLeaf >= 7)
+		{
+			CpuId(7, 0, registers);
+			features.avx2 = features.avx && (registers[1] & (1u << 5)) != 0;
+		}
+
+		return features;
+	}
+#else
+	CpuFeatures QueryCpuFeatures()
+	{
+		return CpuFeatures();
+	}
+#endif
+}
+
+const CpuFeatures& CpuFeatures::Get()
+{
+	static const CpuFeatures features = QueryCpuFeatures();
+	return features;
+}
+
+// =====================================================================================
+//									Affinity policy
+// =====================================================================================
+
+ThreadAffinityPolicy::ThreadAffinityPolicy(const CpuTopology& topology, AffinityPolicy policy)
+	: m_Policy(policy)
+{
+	if (m_Policy == AffinityPolicy::None)
+	{
+		// Unpinned - leave one hardware thread for the render thread.
+		uint32_t numWorkers = std::max(1u, topology.GetNumLogicalProcessors() - 1);
+		m_WorkerProcessors.resize(std::max(1u, numWorkers - numWorkers / 4));
+		m_JobWorkerProcessors.resize(std::max(1u, numWorkers / 4));
+		return;
+	}
+
+	// Performance cores first, so the render thread and the workers get the fast cores.
+	std::vector<const PhysicalCore*> cores;
+	for (const PhysicalCore& core : topology.GetPhysicalCores())
+		if (core.type == CoreType::Performance)
+			cores.push_back(&core);
+	size_t numPerformanceCores = cores.size();
+	for (const PhysicalCore& core : topology.GetPhysicalCores())
+		if (core.type == CoreType::Efficiency)
+			cores.push_back(&core);
+
+	assert(!cores.empty());
+
+	// Render thread: the whole first performance core (including its SMT sibling,
+	//		nothing else is scheduled there).
+	m_RenderProcessors = cores.front()->logicalProcessors;
+
+	// Workers: one per remaining core, on the core's first hardware thread. The last
+	//		quarter of them goes to the job system, the task scheduler never shares a core
+	//		with it.
+	size_t lastWorkerCore = m_Policy == AffinityPolicy::PerformanceCores ? numPerformanceCores : cores.size();
+	size_t numWorkerCores = lastWorkerCore > 1 ? lastWorkerCore - 1 : 0;
+	size_t numJobWorkerCores = numWorkerCores >= 2 ? std::max<size_t>(1, numWorkerCores / 4) : 0;
+	for (size_t i = 1; i < lastWorkerCore; ++i)
+	{
+		std::vector<std::vector<uint32_t>>& pool = i < lastWorkerCore - numJobWorkerCores ? m_WorkerProcessors : m_JobWorkerProcessors;
+		pool.push_back({ cores[i]->logicalProcessors.front() });
+	}
+
+	// Single core machine - still keep one worker, sharing the render core.
+	if (m_WorkerProcessors.empty())
+		m_WorkerProcessors.push_back(m_RenderProcessors);
+	// Not enough cores to split - one job system thread, left to the OS.
+	if (m_JobWorkerProcessors.empty())
+		m_JobWorkerProcessors.resize(1);
+
+	// Streaming: efficiency cores that are not running workers, otherwise
+	//		the SMT siblings of the worker cores, otherwise share with the workers.
+	for (size_t i = lastWorkerCore; i < cores.size(); ++i)
+		m_StreamingProcessors.insert(m_StreamingProcessors.end(),
+			cores[i]->logicalProcessors.begin(), cores[i]->logicalProcessors.end());
+
+	if (m_StreamingProcessors.empty())
+	{
+		for (size_t i = 1; i < lastWorkerCore; ++i)
+			m_StreamingProcessors.insert(m_StreamingProcessors.end(),
+				cores[i]->logicalProcessors.begin() + 1, cores[i]->logicalProcessors.end());
+	}
+	if (m_StreamingProcessors.empty())
+	{
+		for (const std::vector<uint32_t>& worker : m_WorkerProcessors)
+			m_StreamingProcessors.insert(m_StreamingProcessors.end(), worker.begin(), worker.end());
+	}
+}
+
+uint32_t ThreadAffinityPolicy::GetNumThreads(ThreadRole role) const
+{
+	switch (role)
+	{
+	case ThreadRole::Worker:
+		return static_cast<uint32_t>(m_WorkerProcessors.size());
+	case ThreadRole::JobWorker:
+		return static_cast<uint32_t>(m_JobWorkerProcessors.size());
+	default:
+		return 1;
+	}
+}
+
+const char* ThreadAffinityPolicy::GetPolicyName() const
+{
+	switch (m_Policy)
+	{
+	case AffinityPolicy::None:				return "None";
+	case AffinityPolicy::PhysicalCores:		return "PhysicalCores";
+	case AffinityPolicy::PerformanceCores:	return "PerformanceCores";
+	}
+
+	return "Unknown";
+}
+
+std::vector<uint32_t> ThreadAffinityPolicy::GetProcessors(ThreadRole role, uint32_t index) const
+{
+	switch (role)
+	{
+	case ThreadRole::Render:
+		return m_RenderProcessors;
+	case ThreadRole::Streaming:
+		return m_StreamingProcessors;
+	case ThreadRole::Worker:
+		return m_WorkerProcessors[index % m_WorkerProcessors.size()];
+	case ThreadRole::JobWorker:
+		return m_JobWorkerProcessors[index % m_JobWorkerProcessors.size()];
+	}
+
+	return {};
+}
+
+bool ThreadAffinityPolicy::ApplyToCurrentThread(ThreadRole role, uint32_t index) const
+{
+	std::vector<uint32_t> processors = GetProcessors(role, index);
+	if (processors.empty())
+		return true;
+
+	return SetCurrentThreadAffinity(processors);
+}
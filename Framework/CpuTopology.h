@@ -0,0 +1,157 @@
+#pragma once
+
+// Portable C++ only - the platform specific queries live in the .cpp:
+//		- Linux: sysfs (/sys/devices/system/cpu) with /proc/cpuinfo as a fallback.
+//		- Windows: GetLogicalProcessorInformationEx.
+#include <cstdint>
+#include <vector>
+
+// =====================================================================================
+//										Topology
+// =====================================================================================
+
+// Hybrid CPUs (Intel Alder Lake and later, ARM big.LITTLE) mix fast and
+//		power efficient cores. Everything else reports Performance.
+enum class CoreType : uint8_t
+{
+	Performance,
+	Efficiency
+};
+
+struct LogicalProcessor
+{
+	// OS id of the logical processor. On Windows this is group * 64 + number in group.
+	uint32_t id;
+	// Index into CpuTopology::GetPhysicalCores().
+	uint32_t coreIndex;
+	uint32_t packageIndex;
+	// 0 for the first hardware thread of a core, 1 for its SMT sibling, ...
+	uint32_t smtIndex;
+};
+
+struct PhysicalCore
+{
+	uint32_t packageIndex;
+	CoreType type;
+	// Ids of the hardware threads of the core (SMT siblings), ascending.
+	std::vector<uint32_t> logicalProcessors;
+};
+
+class CpuTopology
+{
+public:
+	// Query the topology of the machine. Never fails - if nothing can be queried
+	//		every hardware thread is reported as its own performance core.
+	static CpuTopology Query();
+
+	const std::vector<LogicalProcessor>& GetLogicalProcessors() const { return m_LogicalProcessors; }
+	const std::vector<PhysicalCore>& GetPhysicalCores() const { return m_PhysicalCores; }
+
+	uint32_t GetNumLogicalProcessors() const { return static_cast<uint32_t>(m_LogicalProcessors.size()); }
+	uint32_t GetNumPhysicalCores() const { return static_cast<uint32_t>(m_PhysicalCores.size()); }
+	uint32_t GetNumCores(CoreType type) const;
+	bool IsHybrid() const { return GetNumCores(CoreType::Efficiency) > 0 && GetNumCores(CoreType::Performance) > 0; }
+	bool HasSMT() const { return GetNumLogicalProcessors() > GetNumPhysicalCores(); }
+
+private:
+	// (os id, core key, package, type) for every logical processor - sorted and
+	//		grouped into cores by Finalize().
+	struct RawProcessor
+	{
+		uint32_t id;
+		uint64_t coreKey;
+		uint32_t packageIndex;
+		CoreType type;
+	};
+
+	static bool QueryPlatform(std::vector<RawProcessor>& processors);
+	void Finalize(std::vector<RawProcessor>& processors);
+
+private:
+	std::vector<LogicalProcessor> m_LogicalProcessors;
+	std::vector<PhysicalCore> m_PhysicalCores;
+};
+
+// =====================================================================================
+//									Instruction sets
+// =====================================================================================
+
+// SIMD extensions the running machine supports, for kernels that are compiled for a newer
+//		instruction set than the rest of the program (their own .cpp with /arch:AVX2) and
+//		picked at runtime. AVX and up also require the OS to save the YMM registers.
+//		All false on non x86 CPUs.
+struct CpuFeatures
+{
+	bool sse41 = false;
+	bool avx = false;
+	bool avx2 = false;
+	bool fma = false;
+	bool f16c = false;
+
+	// Queried on first use.
+	static const CpuFeatures& Get();
+};
+
+// =====================================================================================
+//									Affinity policy
+// =====================================================================================
+
+enum class ThreadRole : uint8_t
+{
+	Render,		// The thread driving Update/Render (the WndProc thread).
+	Streaming,	// Asset streaming / file IO.
+	Worker,		// Task scheduler workers.
+	JobWorker	// Job system workers.
+};
+
+enum class AffinityPolicy : uint8_t
+{
+	// Don't pin anything, one worker per remaining hardware thread (OS decides).
+	None,
+	// One worker per physical core, pinned to the core's first hardware thread.
+	// SMT siblings are left free for the OS and for streaming.
+	PhysicalCores,
+	// Like PhysicalCores, but workers only run on performance cores. On hybrid CPUs
+	// the efficiency cores are left for streaming and background work.
+	PerformanceCores
+};
+
+// Decides where the threads of the framework run and how big the pools are.
+//		The render thread always gets the first performance core to itself.
+//
+// The task scheduler and the job system each get their own cores: both pools spin for a
+//		while before they sleep, two pinned workers on one core would take turns spinning.
+//		The job system takes the last quarter of the worker cores (efficiency cores come
+//		last), the task scheduler the rest. With fewer than two worker cores the job
+//		system gets one unpinned thread.
+class ThreadAffinityPolicy
+{
+public:
+	ThreadAffinityPolicy(const CpuTopology& topology, AffinityPolicy policy);
+
+	AffinityPolicy GetPolicy() const { return m_Policy; }
+	const char* GetPolicyName() const;
+
+	// Number of threads of a role: the size of the task scheduler (Worker) and job system
+	//		(JobWorker) pools, 1 for the others.
+	uint32_t GetNumThreads(ThreadRole role) const;
+
+	// Logical processors a thread may run on. An empty list means "don't pin".
+	//		"index" selects the worker of a pool (wraps around if larger than the pool).
+	std::vector<uint32_t> GetProcessors(ThreadRole role, uint32_t index = 0) const;
+
+	// Pin the calling thread according to the policy.
+	bool ApplyToCurrentThread(ThreadRole role, uint32_t index = 0) const;
+
+private:
+	AffinityPolicy m_Policy;
+
+	std::vector<uint32_t> m_RenderProcessors;
+	std::vector<uint32_t> m_StreamingProcessors;
+	std::vector<std::vector<uint32_t>> m_WorkerProcessors;
+	std::vector<std::vector<uint32_t>> m_JobWorkerProcessors;
+};
+
+// Restrict the calling thread to the given logical processors (OS ids).
+//		On Windows all processors must be in the same processor group.
+bool SetCurrentThreadAffinity(const std::vector<uint32_t>& logicalProcessors);
@@ -0,0 +1,42 @@
+#include "Entity.h"
+
+#include <cassert>
+
+
+Entity EntityRegistry::Create()
+{
+	uint32_t index;
+	if (!m_FreeIndices.empty())
+	{
+		index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_Generations.size());
+		// The last index is reserved for INVALID_ENTITY.
+		assert(index < ENTITY_INDEX_MASK && "Out of entity ids.");
+		m_Generations.push_back(0);
+	}
+
+	++m_NumAlive;
+	return MakeEntity(index, m_Generations[index]);
+}
+
+void EntityRegistry::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	uint32_t index = GetEntityIndex(entity);
+	m_Generations[index] = (m_Generations[index] + 1) & ENTITY_GENERATION_MASK;
+	m_FreeIndices.push_back(index);
+	--m_NumAlive;
+}
+
+bool EntityRegistry::IsAlive(Entity entity) const
+{
+	uint32_t index = GetEntityIndex(entity);
+	return entity != INVALID_ENTITY && index < m_Generations.size() &&
+		m_Generations[index] == GetEntityGeneration(entity);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// =====================================================================================
+//										Entity
+// =====================================================================================
+
+// An entity is just an id. Components (transforms, bounds, ...) live in their own
+//		stores, which map entity ids to their dense arrays.
+//
+// The id packs a slot index and a generation. When an entity is destroyed its slot is
+//		recycled with an incremented generation, so stale ids of destroyed entities
+//		never alias new ones.
+typedef uint32_t Entity;
+
+constexpr uint32_t ENTITY_INDEX_BITS = 24;
+constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+constexpr uint32_t ENTITY_GENERATION_BITS = 32 - ENTITY_INDEX_BITS;
+constexpr uint32_t ENTITY_GENERATION_MASK = (1u << ENTITY_GENERATION_BITS) - 1;
+constexpr Entity INVALID_ENTITY = 0xFFFFFFFFu;
+
+inline uint32_t GetEntityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+inline uint32_t GetEntityGeneration(Entity entity) { return (entity >> ENTITY_INDEX_BITS) & ENTITY_GENERATION_MASK; }
+inline Entity MakeEntity(uint32_t index, uint32_t generation)
+{
+	return (index & ENTITY_INDEX_MASK) | ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS);
+}
+
+// =====================================================================================
+//									Entity registry
+// =====================================================================================
+
+class EntityRegistry
+{
+public:
+	Entity Create();
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	uint32_t GetNumAlive() const { return m_NumAlive; }
+
+private:
+	// Current generation of every slot.
+	std::vector<uint32_t> m_Generations;
+	// Slots of destroyed entities, ready for reuse.
+	std::vector<uint32_t> m_FreeIndices;
+	uint32_t m_NumAlive = 0;
+};
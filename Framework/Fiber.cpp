@@ -0,0 +1,133 @@
+#include "Fiber.h"
+
+#include <cassert>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#if defined(FIBER_TSAN)
+#include <sanitizer/tsan_interface.h>
+#endif
+
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+Fiber::Fiber()
+	: m_IsThreadFiber(true)
+{
+}
+
+#if defined(_WIN32)
+
+Fiber::Fiber(size_t stackSize, EntryPoint entry, void* userData)
+	: m_Entry(entry)
+	, m_UserData(userData)
+{
+	// The Win32 fiber callback has the same signature as our entry point.
+	m_Handle = ::CreateFiber(stackSize, reinterpret_cast<LPFIBER_START_ROUTINE>(entry), userData);
+	assert(m_Handle && "Failed to create fiber.");
+}
+
+Fiber::~Fiber()
+{
+	if (m_Handle && !m_IsThreadFiber)
+	{
+		::DeleteFiber(m_Handle);
+	}
+}
+
+std::unique_ptr<Fiber> Fiber::ConvertCurrentThread()
+{
+	std::unique_ptr<Fiber> fiber(new Fiber());
+	fiber->m_Handle = ::ConvertThreadToFiber(nullptr);
+	assert(fiber->m_Handle && "Failed to convert thread to fiber.");
+
+	return fiber;
+}
+
+void Fiber::ConvertBackToThread()
+{
+	::ConvertFiberToThread();
+}
+
+void Fiber::Switch(Fiber& from, Fiber& to)
+{
+	// The current fiber is implicit on Windows.
+	(void)from;
+	::SwitchToFiber(to.m_Handle);
+}
+
+#else
+
+Fiber::Fiber(size_t stackSize, EntryPoint entry, void* userData)
+	: m_Entry(entry)
+	, m_UserData(userData)
+	, m_Stack(new uint8_t[stackSize])
+{
+	getcontext(&m_Context);
+	m_Context.uc_stack.ss_sp = m_Stack.get();
+	m_Context.uc_stack.ss_size = stackSize;
+	m_Context.uc_link = nullptr;
+
+	// makecontext only passes int arguments - split the pointer in two halves.
+	uintptr_t self = reinterpret_cast<uintptr_t>(this);
+	makecontext(&m_Context, reinterpret_cast<void (*)()>(&Fiber::Trampoline), 2,
+		static_cast<uint32_t>(self & 0xFFFFFFFFu),
+		static_cast<uint32_t>(static_cast<uint64_t>(self) >> 32));
+
+#if defined(FIBER_TSAN)
+	m_TsanFiber = __tsan_create_fiber(0);
+#endif
+}
+
+Fiber::~Fiber()
+{
+#if defined(FIBER_TSAN)
+	// The thread's own TSan state belongs to the thread.
+	if (!m_IsThreadFiber)
+	{
+		__tsan_destroy_fiber(m_TsanFiber);
+	}
+#endif
+}
+
+std::unique_ptr<Fiber> Fiber::ConvertCurrentThread()
+{
+	// Nothing to convert - the context is filled in by the first Switch() away from it.
+	std::unique_ptr<Fiber> fiber(new Fiber());
+#if defined(FIBER_TSAN)
+	fiber->m_TsanFiber = __tsan_get_current_fiber();
+#endif
+	return fiber;
+}
+
+void Fiber::ConvertBackToThread()
+{
+}
+
+void Fiber::Switch(Fiber& from, Fiber& to)
+{
+#if defined(FIBER_TSAN)
+	// Flags 0: the switch synchronizes, "to" sees everything done before it.
+	__tsan_switch_to_fiber(to.m_TsanFiber, 0);
+#endif
+	swapcontext(&from.m_Context, &to.m_Context);
+}
+
+void Fiber::Trampoline(uint32_t lowBits, uint32_t highBits)
+{
+	uintptr_t self = static_cast<uintptr_t>((static_cast<uint64_t>(highBits) << 32) | lowBits);
+	Fiber* fiber = reinterpret_cast<Fiber*>(self);
+
+	fiber->m_Entry(fiber->m_UserData);
+
+	assert(false && "A fiber entry point must never return.");
+}
+
+#endif
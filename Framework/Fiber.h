@@ -0,0 +1,77 @@
+#pragma once
+
+// Portable fiber (user-mode cooperative context):
+//		- Windows: Win32 fibers (ConvertThreadToFiber / CreateFiber / SwitchToFiber).
+//		- Linux & other POSIX: ucontext (getcontext / makecontext / swapcontext).
+//
+// A fiber never "returns" - the entry function must switch away to another fiber
+//		once it is done. Returning from a fiber entry point terminates the thread
+//		on Windows and is undefined with ucontext.
+//
+// !NOTE!
+//		Code that runs on fibers can be resumed on a different thread than the one it
+//		was suspended on. The compiler must not cache thread-local addresses across a
+//		fiber switch - with MSVC compile with /GT (fiber-safe optimizations).
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if !defined(_WIN32)
+#include <ucontext.h>
+#endif
+
+// ThreadSanitizer has to be told about every stack switch (GCC defines
+//		__SANITIZE_THREAD__ for -fsanitize=thread, Clang has __has_feature).
+#if defined(__SANITIZE_THREAD__)
+#define FIBER_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define FIBER_TSAN 1
+#endif
+#endif
+
+class Fiber
+{
+public:
+	typedef void (*EntryPoint)(void* userData);
+
+	// Create a new fiber with its own stack. It starts running "entry(userData)"
+	//		the first time it is switched to.
+	Fiber(size_t stackSize, EntryPoint entry, void* userData);
+	~Fiber();
+	Fiber(const Fiber&) = delete;
+	Fiber& operator=(const Fiber&) = delete;
+
+	// Turn the calling thread into a fiber so it can switch to other fibers.
+	//		The returned fiber represents the thread's original stack.
+	static std::unique_ptr<Fiber> ConvertCurrentThread();
+	// Undo ConvertCurrentThread(). Must be called on the same thread.
+	static void ConvertBackToThread();
+
+	// Suspend "from" (which must be the fiber currently running on the calling
+	//		thread) and resume "to".
+	static void Switch(Fiber& from, Fiber& to);
+
+private:
+	Fiber();
+
+#if !defined(_WIN32)
+	static void Trampoline(uint32_t lowBits, uint32_t highBits);
+#endif
+
+private:
+	EntryPoint m_Entry = nullptr;
+	void* m_UserData = nullptr;
+	bool m_IsThreadFiber = false;
+
+#if defined(_WIN32)
+	void* m_Handle = nullptr;
+#else
+	ucontext_t m_Context;
+	std::unique_ptr<uint8_t[]> m_Stack;
+#endif
+#if defined(FIBER_TSAN)
+	void* m_TsanFiber = nullptr;
+#endif
+};
@@ -0,0 +1,109 @@
+#include "FrameUploadBuffer.h"
+#include "AssetFile.h"
+
+#include "../Helpers/d3dx12.h"
+#include "../Helpers/Helpers.h"
+
+#include <algorithm> // std::max
+#include <cassert>
+
+
+FrameUploadBuffer::FrameUploadBuffer(ComPtr<ID3D12Device2> device, size_t initialSize) :
+	m_Device(device)
+{
+	for (UINT i = 0; i < NUM_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_Pages[i] = CreatePage(initialSize);
+	}
+}
+
+FrameUploadBuffer::~FrameUploadBuffer()
+{
+	// Upload heap resources may stay mapped for their whole lifetime; unmapping is optional
+	//		but keeps debug layers quiet.
+	for (UINT i = 0; i < NUM_FRAMES_IN_FLIGHT; ++i)
+	{
+		if (m_Pages[i].resource)
+			m_Pages[i].resource->Unmap(0, nullptr);
+	}
+}
+
+FrameUploadBuffer::Page FrameUploadBuffer::CreatePage(size_t size)
+{
+	Page page;
+	page.size = size;
+
+	ThrowIfFailed(m_Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&page.resource)));
+
+	// Persistent map - the CPU never reads, so an empty read range.
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(page.resource->Map(0, &readRange, reinterpret_cast<void**>(&page.cpu)));
+	page.gpu = page.resource->GetGPUVirtualAddress();
+	return page;
+}
+
+void FrameUploadBuffer::Begin(UINT frameIndex)
+{
+	assert(frameIndex < NUM_FRAMES_IN_FLIGHT);
+	m_FrameIndex = frameIndex;
+	m_Offset = 0;
+
+	// The GPU is done with this frame, so are the pages it outgrew.
+	for (Page& page : m_RetiredPages[frameIndex])
+	{
+		page.resource->Unmap(0, nullptr);
+	}
+	m_RetiredPages[frameIndex].clear();
+}
+
+FrameUploadBuffer::Allocation FrameUploadBuffer::Allocate(size_t size, size_t alignment)
+{
+	assert(alignment && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of 2.");
+
+	Page& page = m_Pages[m_FrameIndex];
+	size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+	if (offset + size > page.size)
+	{
+		// Grow: the full page stays alive until this frame index comes around again.
+		size_t newSize = std::max(page.size * 2, size + alignment);
+		m_RetiredPages[m_FrameIndex].push_back(page);
+		page = CreatePage(newSize);
+		offset = 0;
+	}
+
+	m_Offset = offset + size;
+	return { page.cpu + offset, page.gpu + offset, page.resource.Get(), offset };
+}
+
+bool FrameUploadBuffer::AllocateAndRead(const AssetFile& file, uint64_t offset, size_t size, size_t alignment, Allocation& out)
+{
+	assert(offset % alignment == 0 && "The file offset must have the alignment of the allocation.");
+
+	Allocation allocation;
+	if (file.GetMode() == AssetFileMode::Unbuffered && alignment < ASSET_FILE_IO_ALIGNMENT)
+	{
+		// Start at the same position within a 4K block as the file data: everything but
+		//		the first and last partial block is then read in place. The shift is a
+		//		multiple of "alignment", as the offset is.
+		const size_t shift = size_t(offset % ASSET_FILE_IO_ALIGNMENT);
+		allocation = Allocate(shift + size, ASSET_FILE_IO_ALIGNMENT);
+		allocation.cpu = static_cast<uint8_t*>(allocation.cpu) + shift;
+		allocation.gpu += shift;
+		allocation.offset += shift;
+	}
+	else
+	{
+		allocation = Allocate(size, alignment);
+	}
+
+	if (!file.Read(offset, allocation.cpu, size))
+		return false;
+	out = allocation;
+	return true;
+}
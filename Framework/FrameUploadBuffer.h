@@ -0,0 +1,84 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Window.h" // NUM_FRAMES_IN_FLIGHT
+
+class AssetFile;
+
+using Microsoft::WRL::ComPtr;
+
+// =====================================================================================
+//									Frame upload buffer
+// =====================================================================================
+
+// Linear allocator for per-frame GPU data (instance transforms, draw arguments, ...).
+//
+// Every frame in flight owns a persistently mapped buffer in the UPLOAD heap. Begin()
+//		rewinds the buffer of the frame that is about to be recorded - the caller must
+//		have waited for the GPU to finish that frame (the Game waits on the back buffer
+//		fence right after Present, so at the start of Render() it is free).
+//
+// If a frame needs more memory than the buffer has, a bigger buffer is created. The
+//		old one may already be referenced by commands recorded this frame, so it is kept
+//		alive until the same frame index comes around again.
+//
+// Upload heap memory is write-combined: write it sequentially (memcpy) and never read it.
+class FrameUploadBuffer
+{
+public:
+	struct Allocation
+	{
+		void* cpu;
+		D3D12_GPU_VIRTUAL_ADDRESS gpu;
+		// For APIs taking a resource + offset instead of an address (ExecuteIndirect).
+		ID3D12Resource* resource;
+		UINT64 offset;
+	};
+
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	FrameUploadBuffer(ComPtr<ID3D12Device2> device, size_t initialSize = 1024 * 1024);
+	~FrameUploadBuffer();
+
+	void Begin(UINT frameIndex);
+	// Alignment must be a power of 2 (256 for constant buffers, 16 is enough for vertex data).
+	Allocation Allocate(size_t size, size_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	// Allocates "size" bytes and fills them with [offset, offset + size) of "file" - file
+	//		data goes to upload memory without a heap buffer in between. "offset" must be a
+	//		multiple of "alignment" (package sections are 512 byte aligned, enough for
+	//		buffers and texture data). In Unbuffered mode the allocation is placed at the
+	//		file offset modulo ASSET_FILE_IO_ALIGNMENT, so the disk writes into it directly.
+	//		False if the read fails - the memory stays allocated until the next Begin().
+	bool AllocateAndRead(const AssetFile& file, uint64_t offset, size_t size, size_t alignment, Allocation& out);
+
+private:
+	struct Page
+	{
+		ComPtr<ID3D12Resource> resource;
+		uint8_t* cpu = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS gpu = 0;
+		size_t size = 0;
+	};
+
+	Page CreatePage(size_t size);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	ComPtr<ID3D12Device2> m_Device;
+
+	Page m_Pages[NUM_FRAMES_IN_FLIGHT];
+	// Pages replaced during a frame, released when that frame index is reused.
+	std::vector<Page> m_RetiredPages[NUM_FRAMES_IN_FLIGHT];
+
+	UINT m_FrameIndex = 0;
+	size_t m_Offset = 0;
+};
@@ -0,0 +1,359 @@
+#include "FrustumCulling.h"
+#include "CpuTopology.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::min
+#include <cassert>
+#include <cmath>
+#include <cstring>   // std::memmove
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FRUSTUM_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+
+
+// =====================================================================================
+//									Bounding volumes
+// =====================================================================================
+
+void BoundingSpheres::Resize(size_t count)
+{
+	centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+	radius.resize(count);
+}
+
+void BoundingSpheres::Set(size_t index, const XMFLOAT3& center, float r)
+{
+	centerX[index] = center.x; centerY[index] = center.y; centerZ[index] = center.z;
+	radius[index] = r;
+}
+
+void BoundingBoxes::Resize(size_t count)
+{
+	centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+	extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+}
+
+void BoundingBoxes::Set(size_t index, const XMFLOAT3& center, const XMFLOAT3& extent)
+{
+	centerX[index] = center.x; centerY[index] = center.y; centerZ[index] = center.z;
+	extentX[index] = extent.x; extentY[index] = extent.y; extentZ[index] = extent.z;
+}
+
+// =====================================================================================
+//										Frustum
+// =====================================================================================
+
+// With row vectors clip = p * M, so every clip coordinate is a dot product with one
+//		column of M. The clip space conditions (D3D: 0 <= z <= w)
+//			-w <= x <= w,  -w <= y <= w,  0 <= z <= w
+//		become plane equations built from those columns, e.g. x >= -w <=> dot(p, c3 + c0) >= 0.
+// The columns of M are the rows of its transpose.
+Frustum Frustum::FromViewProjection(FXMMATRIX viewProjection)
+{
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+
+	XMVECTOR planes[Count];
+	planes[Left] = XMVectorAdd(columns.r[3], columns.r[0]);
+	planes[Right] = XMVectorSubtract(columns.r[3], columns.r[0]);
+	planes[Bottom] = XMVectorAdd(columns.r[3], columns.r[1]);
+	planes[Top] = XMVectorSubtract(columns.r[3], columns.r[1]);
+	planes[Near] = columns.r[2];
+	planes[Far] = XMVectorSubtract(columns.r[3], columns.r[2]);
+
+	// Normalized planes give real distances, which the sphere test needs.
+	Frustum frustum;
+	for (int i = 0; i < Count; ++i)
+	{
+		XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+	}
+	return frustum;
+}
+
+// =====================================================================================
+//									Culling kernels
+// =====================================================================================
+
+namespace
+{
+	// Both tests have the same shape:
+	//		visible if for every plane: dot(n, center) + d + radius >= 0
+	//		- sphere: radius is the sphere radius
+	//		- box:    radius is the box extent projected on the plane normal,
+	//				  |n.x| * e.x + |n.y| * e.y + |n.z| * e.z
+	bool IsSphereVisible(const Frustum& frustum, float x, float y, float z, float r)
+	{
+		for (const XMFLOAT4& p : frustum.planes)
+		{
+			if (p.x * x + p.y * y + p.z * z + p.w + r < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	bool IsBoxVisible(const Frustum& frustum, float x, float y, float z, float ex, float ey, float ez)
+	{
+		for (const XMFLOAT4& p : frustum.planes)
+		{
+			float r = std::fabs(p.x) * ex + std::fabs(p.y) * ey + std::fabs(p.z) * ez;
+			if (p.x * x + p.y * y + p.z * z + p.w + r < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// Branch free compaction: always store, advance only for visible lanes.
+	inline size_t AppendVisible(uint32_t* out, size_t count, size_t first, int mask, int lanes)
+	{
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			out[count] = static_cast<uint32_t>(first + lane);
+			count += (mask >> lane) & 1;
+		}
+		return count;
+	}
+
+#if defined(FRUSTUM_CULLING_SSE)
+	// Planes broadcast once per call - one register per plane component.
+	struct PlanesSSE
+	{
+		__m128 x[Frustum::Count], y[Frustum::Count], z[Frustum::Count], w[Frustum::Count];
+		__m128 absX[Frustum::Count], absY[Frustum::Count], absZ[Frustum::Count];
+
+		explicit PlanesSSE(const Frustum& frustum)
+		{
+			for (int i = 0; i < Frustum::Count; ++i)
+			{
+				const XMFLOAT4& p = frustum.planes[i];
+				x[i] = _mm_set1_ps(p.x); y[i] = _mm_set1_ps(p.y); z[i] = _mm_set1_ps(p.z); w[i] = _mm_set1_ps(p.w);
+				absX[i] = _mm_set1_ps(std::fabs(p.x)); absY[i] = _mm_set1_ps(std::fabs(p.y)); absZ[i] = _mm_set1_ps(std::fabs(p.z));
+			}
+		}
+	};
+
+	inline __m128 PlaneDistanceSSE(const PlanesSSE& planes, int i, __m128 cx, __m128 cy, __m128 cz)
+	{
+		__m128 d = _mm_add_ps(_mm_mul_ps(planes.x[i], cx), planes.w[i]);
+		d = _mm_add_ps(d, _mm_mul_ps(planes.y[i], cy));
+		return _mm_add_ps(d, _mm_mul_ps(planes.z[i], cz));
+	}
+#endif
+}
+
+size_t FrustumCuller::CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	size_t count = 0;
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (IsSphereVisible(frustum, spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]))
+		{
+			outIndices[count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return count;
+}
+
+size_t FrustumCuller::CullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	size_t count = 0;
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (IsBoxVisible(frustum, boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i],
+			boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]))
+		{
+			outIndices[count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return count;
+}
+
+size_t FrustumCuller::CullSpheresSSE(const Frustum& frustum, const BoundingSpheres& spheres,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	assert(end <= spheres.GetCount());
+
+	size_t count = 0;
+	size_t i = begin;
+
+	const float* cx = spheres.centerX.data();
+	const float* cy = spheres.centerY.data();
+	const float* cz = spheres.centerZ.data();
+	const float* r = spheres.radius.data();
+
+#if defined(FRUSTUM_CULLING_SSE)
+	{
+		const PlanesSSE planes(frustum);
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+			__m128 radius = _mm_loadu_ps(r + i);
+
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(PlaneDistanceSSE(planes, 0, x, y, z), radius), zero);
+			for (int p = 1; p < Frustum::Count; ++p)
+			{
+				__m128 d = _mm_add_ps(PlaneDistanceSSE(planes, p, x, y, z), radius);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+			}
+			count = AppendVisible(outIndices, count, i, _mm_movemask_ps(inside), 4);
+		}
+	}
+#endif
+
+	// Remainder (or everything without SIMD).
+	size_t tail = CullSpheresScalar(frustum, spheres, i, end, outIndices + count);
+	return count + tail;
+}
+
+size_t FrustumCuller::CullBoxesSSE(const Frustum& frustum, const BoundingBoxes& boxes,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	assert(end <= boxes.GetCount());
+
+	size_t count = 0;
+	size_t i = begin;
+
+	const float* cx = boxes.centerX.data();
+	const float* cy = boxes.centerY.data();
+	const float* cz = boxes.centerZ.data();
+	const float* ex = boxes.extentX.data();
+	const float* ey = boxes.extentY.data();
+	const float* ez = boxes.extentZ.data();
+
+#if defined(FRUSTUM_CULLING_SSE)
+	{
+		const PlanesSSE planes(frustum);
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+			__m128 extX = _mm_loadu_ps(ex + i), extY = _mm_loadu_ps(ey + i), extZ = _mm_loadu_ps(ez + i);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::Count; ++p)
+			{
+				__m128 radius = _mm_mul_ps(planes.absX[p], extX);
+				radius = _mm_add_ps(radius, _mm_mul_ps(planes.absY[p], extY));
+				radius = _mm_add_ps(radius, _mm_mul_ps(planes.absZ[p], extZ));
+
+				__m128 d = _mm_add_ps(PlaneDistanceSSE(planes, p, x, y, z), radius);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+			}
+			count = AppendVisible(outIndices, count, i, _mm_movemask_ps(inside), 4);
+		}
+	}
+#endif
+
+	size_t tail = CullBoxesScalar(frustum, boxes, i, end, outIndices + count);
+	return count + tail;
+}
+
+size_t FrustumCuller::CullSpheresAVX(const Frustum& frustum, const BoundingSpheres& spheres,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	assert(IsAVXSupported());
+	assert(end <= spheres.GetCount());
+
+	size_t count = 0;
+	size_t i = CullSphereBlocksAVX(frustum, spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(),
+		spheres.radius.data(), begin, end, outIndices, count);
+
+	// Fewer than 8 left.
+	return count + CullSpheresSSE(frustum, spheres, i, end, outIndices + count);
+}
+
+size_t FrustumCuller::CullBoxesAVX(const Frustum& frustum, const BoundingBoxes& boxes,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	assert(IsAVXSupported());
+	assert(end <= boxes.GetCount());
+
+	size_t count = 0;
+	size_t i = CullBoxBlocksAVX(frustum, boxes.centerX.data(), boxes.centerY.data(), boxes.centerZ.data(),
+		boxes.extentX.data(), boxes.extentY.data(), boxes.extentZ.data(), begin, end, outIndices, count);
+
+	return count + CullBoxesSSE(frustum, boxes, i, end, outIndices + count);
+}
+
+// The CPU doesn't change while the program runs: the check is a cached load.
+size_t FrustumCuller::CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	return IsAVXSupported()
+		? CullSpheresAVX(frustum, spheres, begin, end, outIndices)
+		: CullSpheresSSE(frustum, spheres, begin, end, outIndices);
+}
+
+size_t FrustumCuller::CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes,
+	size_t begin, size_t end, uint32_t* outIndices)
+{
+	return IsAVXSupported()
+		? CullBoxesAVX(frustum, boxes, begin, end, outIndices)
+		: CullBoxesSSE(frustum, boxes, begin, end, outIndices);
+}
+
+// =====================================================================================
+//									Parallel culling
+// =====================================================================================
+
+// Every chunk writes its visible indices to its own slice of "visible" (starting at the
+//		chunk's first object, so chunks never overlap), then the slices are moved together
+//		in chunk order. The result is identical to a single threaded cull.
+template<typename Kernel>
+void FrustumCuller::CullParallel(size_t count, std::vector<uint32_t>& visible, TaskScheduler* scheduler,
+	size_t grainSize, const Kernel& kernel)
+{
+	visible.resize(count);
+	uint32_t* out = visible.data();
+
+	if (!scheduler || count <= grainSize)
+	{
+		visible.resize(kernel(0, count, out));
+		return;
+	}
+
+	// Multiples of 8 keep every chunk on the full width SIMD path.
+	grainSize = (grainSize + 7) & ~size_t(7);
+	size_t numChunks = (count + grainSize - 1) / grainSize;
+	m_ChunkCounts.assign(numChunks, 0);
+
+	scheduler->ParallelFor(0, numChunks, 1, [&](size_t firstChunk, size_t lastChunk) {
+		for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+		{
+			size_t begin = chunk * grainSize;
+			size_t end = std::min(begin + grainSize, count);
+			m_ChunkCounts[chunk] = kernel(begin, end, out + begin);
+		}
+	});
+
+	size_t total = 0;
+	for (size_t chunk = 0; chunk < numChunks; ++chunk)
+	{
+		size_t begin = chunk * grainSize;
+		if (total != begin)
+		{
+			std::memmove(out + total, out + begin, m_ChunkCounts[chunk] * sizeof(uint32_t));
+		}
+		total += m_ChunkCounts[chunk];
+	}
+	visible.resize(total);
+}
+
+void FrustumCuller::CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres,
+	std::vector<uint32_t>& visible, TaskScheduler* scheduler, size_t grainSize)
+{
+	CullParallel(spheres.GetCount(), visible, scheduler, grainSize,
+		[&](size_t begin, size_t end, uint32_t* out) { return CullSpheres(frustum, spheres, begin, end, out); });
+}
+
+void FrustumCuller::CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes,
+	std::vector<uint32_t>& visible, TaskScheduler* scheduler, size_t grainSize)
+{
+	CullParallel(boxes.GetCount(), visible, scheduler, grainSize,
+		[&](size_t begin, size_t end, uint32_t* out) { return CullBoxes(frustum, boxes, begin, end, out); });
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Bounding volumes
+// =====================================================================================
+
+// Bounding volumes are stored as structure-of-arrays (one array per float component),
+//		so the culling kernels can load 4 (SSE) or 8 (AVX) objects with one aligned-free
+//		load per component and test them against a plane in a handful of instructions.
+struct BoundingSpheres
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> radius;
+
+	void Resize(size_t count);
+	size_t GetCount() const { return radius.size(); }
+	void Set(size_t index, const DirectX::XMFLOAT3& center, float r);
+};
+
+// Axis aligned boxes as center + half extents.
+struct BoundingBoxes
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void Resize(size_t count);
+	size_t GetCount() const { return extentX.size(); }
+	void Set(size_t index, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extent);
+};
+
+// =====================================================================================
+//										Frustum
+// =====================================================================================
+
+// The 6 planes of a view frustum, normals pointing inwards: a point p is inside a plane
+//		if dot(normal, p) + d >= 0.
+struct Frustum
+{
+	enum Plane { Left = 0, Right, Bottom, Top, Near, Far, Count };
+
+	DirectX::XMFLOAT4 planes[Count];
+
+	// Gribb/Hartmann plane extraction from a (view * projection) matrix.
+	//		Works in any space: pass projection only for view space planes, view * projection
+	//		for world space planes, world * view * projection for object space planes.
+	static Frustum FromViewProjection(DirectX::FXMMATRIX viewProjection);
+};
+
+// =====================================================================================
+//									Frustum culler
+// =====================================================================================
+
+// Tests bounding volumes against a frustum and outputs the indices of the visible ones.
+//
+// The index list is compact and sorted ascending - the same order the objects are stored
+//		in - so it can be fed straight into draw submission. The kernels write indices
+//		branch free: every lane's index is stored and the output pointer only advances
+//		for visible lanes.
+//
+// Kernels:
+//		- AVX (8 objects per iteration), picked at runtime when the CPU supports it. They
+//		  live in FrustumCullingAVX.cpp, the only file built with /arch:AVX, so the rest
+//		  of the program still runs on any x64 CPU.
+//		- SSE (4 objects per iteration) on x86/x64.
+//		- scalar for the remainder and as the reference path.
+class FrustumCuller
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// Cull all objects. With a scheduler the objects are split in chunks of "grainSize"
+	//		that are culled in parallel, then the per-chunk results are packed together.
+	void CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres,
+		std::vector<uint32_t>& visible, TaskScheduler* scheduler = nullptr, size_t grainSize = 4096);
+	void CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes,
+		std::vector<uint32_t>& visible, TaskScheduler* scheduler = nullptr, size_t grainSize = 4096);
+
+	// Single threaded kernels over [begin, end). "outIndices" needs room for (end - begin)
+	//		entries; returns the number of visible objects written. Uses the widest kernel
+	//		the CPU supports.
+	static size_t CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres,
+		size_t begin, size_t end, uint32_t* outIndices);
+	static size_t CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes,
+		size_t begin, size_t end, uint32_t* outIndices);
+
+	// Scalar reference versions of the kernels above (baseline for comparisons).
+	static size_t CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres,
+		size_t begin, size_t end, uint32_t* outIndices);
+	static size_t CullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes,
+		size_t begin, size_t end, uint32_t* outIndices);
+
+	// The SIMD kernels by instruction set. The SSE ones fall back to scalar without SSE;
+	//		the AVX ones must only be called if IsAVXSupported().
+	static size_t CullSpheresSSE(const Frustum& frustum, const BoundingSpheres& spheres,
+		size_t begin, size_t end, uint32_t* outIndices);
+	static size_t CullBoxesSSE(const Frustum& frustum, const BoundingBoxes& boxes,
+		size_t begin, size_t end, uint32_t* outIndices);
+	static size_t CullSpheresAVX(const Frustum& frustum, const BoundingSpheres& spheres,
+		size_t begin, size_t end, uint32_t* outIndices);
+	static size_t CullBoxesAVX(const Frustum& frustum, const BoundingBoxes& boxes,
+		size_t begin, size_t end, uint32_t* outIndices);
+
+	// True if the AVX kernels were compiled in and the CPU and OS support AVX.
+	static bool IsAVXSupported();
+
+private:
+	// Culls whole blocks of 8 from "begin" on, appending to outIndices[count]. Returns
+	//		where the blocks stopped (fewer than 8 objects left). Defined in
+	//		FrustumCullingAVX.cpp; raw pointers keep std::vector's inline functions out of
+	//		that file, whose copies would be AVX code the linker may pick for everyone.
+	static size_t CullSphereBlocksAVX(const Frustum& frustum, const float* cx, const float* cy,
+		const float* cz, const float* r, size_t begin, size_t end, uint32_t* outIndices, size_t& count);
+	static size_t CullBoxBlocksAVX(const Frustum& frustum, const float* cx, const float* cy,
+		const float* cz, const float* ex, const float* ey, const float* ez,
+		size_t begin, size_t end, uint32_t* outIndices, size_t& count);
+
+	template<typename Kernel>
+	void CullParallel(size_t count, std::vector<uint32_t>& visible, TaskScheduler* scheduler,
+		size_t grainSize, const Kernel& kernel);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	// Number of visible objects per chunk of the last parallel cull.
+	std::vector<size_t> m_ChunkCounts;
+};
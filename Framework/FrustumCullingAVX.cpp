@@ -0,0 +1,140 @@
+// The AVX culling kernels. This is the only file compiled with /arch:AVX (-mavx): the
+//		rest of the program keeps the baseline instruction set, and FrustumCuller picks
+//		these kernels at runtime when the CPU supports them (FrustumCuller::IsAVXSupported).
+//
+// Keep inline functions shared with other files out of here (std::min, std::fabs,
+//		std::vector accessors, DirectXMath): the compiler emits an AVX copy of every one
+//		this file uses, and the linker is free to keep that copy for the whole program.
+#include "FrustumCulling.h"
+#include "CpuTopology.h"
+
+// MSVC defines __AVX__ for /arch:AVX and /arch:AVX2, GCC/Clang for -mavx and up.
+#if defined(__AVX__)
+#define FRUSTUM_CULLING_AVX 1
+#include <immintrin.h>
+#endif
+
+bool FrustumCuller::IsAVXSupported()
+{
+#if defined(FRUSTUM_CULLING_AVX)
+	return CpuFeatures::Get().avx;
+#else
+	return false;
+#endif
+}
+
+#if defined(FRUSTUM_CULLING_AVX)
+
+// =====================================================================================
+//									Culling kernels
+// =====================================================================================
+
+namespace
+{
+	// Planes broadcast once per call - one register per plane component.
+	struct PlanesAVX
+	{
+		__m256 x[Frustum::Count], y[Frustum::Count], z[Frustum::Count], w[Frustum::Count];
+		__m256 absX[Frustum::Count], absY[Frustum::Count], absZ[Frustum::Count];
+
+		explicit PlanesAVX(const Frustum& frustum)
+		{
+			const __m256 signMask = _mm256_set1_ps(-0.0f);
+			for (int i = 0; i < Frustum::Count; ++i)
+			{
+				const float* p = &frustum.planes[i].x;
+				x[i] = _mm256_set1_ps(p[0]); y[i] = _mm256_set1_ps(p[1]); z[i] = _mm256_set1_ps(p[2]); w[i] = _mm256_set1_ps(p[3]);
+				absX[i] = _mm256_andnot_ps(signMask, x[i]); absY[i] = _mm256_andnot_ps(signMask, y[i]); absZ[i] = _mm256_andnot_ps(signMask, z[i]);
+			}
+		}
+	};
+
+	__m256 PlaneDistanceAVX(const PlanesAVX& planes, int i, __m256 cx, __m256 cy, __m256 cz)
+	{
+		__m256 d = _mm256_add_ps(_mm256_mul_ps(planes.x[i], cx), planes.w[i]);
+		d = _mm256_add_ps(d, _mm256_mul_ps(planes.y[i], cy));
+		return _mm256_add_ps(d, _mm256_mul_ps(planes.z[i], cz));
+	}
+
+	// Branch free compaction: always store, advance only for visible lanes.
+	size_t AppendVisible8(uint32_t* out, size_t count, size_t first, int mask)
+	{
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			out[count] = static_cast<uint32_t>(first + lane);
+			count += (mask >> lane) & 1;
+		}
+		return count;
+	}
+}
+
+size_t FrustumCuller::CullSphereBlocksAVX(const Frustum& frustum, const float* cx, const float* cy,
+	const float* cz, const float* r, size_t begin, size_t end, uint32_t* outIndices, size_t& count)
+{
+	const PlanesAVX planes(frustum);
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+		__m256 radius = _mm256_loadu_ps(r + i);
+
+		__m256 inside = _mm256_cmp_ps(_mm256_add_ps(PlaneDistanceAVX(planes, 0, x, y, z), radius), zero, _CMP_GE_OQ);
+		for (int p = 1; p < Frustum::Count; ++p)
+		{
+			__m256 d = _mm256_add_ps(PlaneDistanceAVX(planes, p, x, y, z), radius);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+		}
+		count = AppendVisible8(outIndices, count, i, _mm256_movemask_ps(inside));
+	}
+
+	return i;
+}
+
+size_t FrustumCuller::CullBoxBlocksAVX(const Frustum& frustum, const float* cx, const float* cy,
+	const float* cz, const float* ex, const float* ey, const float* ez,
+	size_t begin, size_t end, uint32_t* outIndices, size_t& count)
+{
+	const PlanesAVX planes(frustum);
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+		__m256 extX = _mm256_loadu_ps(ex + i), extY = _mm256_loadu_ps(ey + i), extZ = _mm256_loadu_ps(ez + i);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < Frustum::Count; ++p)
+		{
+			__m256 radius = _mm256_mul_ps(planes.absX[p], extX);
+			radius = _mm256_add_ps(radius, _mm256_mul_ps(planes.absY[p], extY));
+			radius = _mm256_add_ps(radius, _mm256_mul_ps(planes.absZ[p], extZ));
+
+			__m256 d = _mm256_add_ps(PlaneDistanceAVX(planes, p, x, y, z), radius);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+		}
+		count = AppendVisible8(outIndices, count, i, _mm256_movemask_ps(inside));
+	}
+
+	return i;
+}
+
+#else
+
+// Not an x86 build: IsAVXSupported() is false and the dispatch never gets here.
+size_t FrustumCuller::CullSphereBlocksAVX(const Frustum&, const float*, const float*,
+	const float*, const float*, size_t begin, size_t, uint32_t*, size_t&)
+{
+	return begin;
+}
+
+size_t FrustumCuller::CullBoxBlocksAVX(const Frustum&, const float*, const float*,
+	const float*, const float*, const float*, const float*,
+	size_t begin, size_t, uint32_t*, size_t&)
+{
+	return begin;
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include "Hash.h"
+
+#include <cstring> // std::memcpy
+
+
+namespace
+{
+	constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+	constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+	constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// Unaligned little endian loads (every target of this project is little endian).
+	inline uint64_t Read64(const uint8_t* p)
+	{
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t Round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * PRIME64_2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * PRIME64_1;
+	}
+
+	inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+	{
+		hash ^= Round(0, accumulator);
+		return hash * PRIME64_1 + PRIME64_4;
+	}
+
+	// Consumes whole 32 byte stripes, returns the number of bytes consumed.
+	size_t ConsumeStripes(uint64_t accumulators[4], const uint8_t* p, size_t size)
+	{
+		const uint8_t* begin = p;
+		const uint8_t* end = p + (size & ~size_t(31));
+		uint64_t v1 = accumulators[0], v2 = accumulators[1], v3 = accumulators[2], v4 = accumulators[3];
+		while (p < end)
+		{
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		}
+		accumulators[0] = v1; accumulators[1] = v2; accumulators[2] = v3; accumulators[3] = v4;
+		return size_t(p - begin);
+	}
+
+	// The remaining (< 32) bytes and the final avalanche.
+	uint64_t Finalize(uint64_t hash, const uint8_t* p, size_t size)
+	{
+		while (size >= 8)
+		{
+			hash ^= Round(0, Read64(p));
+			hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+			p += 8;
+			size -= 8;
+		}
+		if (size >= 4)
+		{
+			hash ^= uint64_t(Read32(p)) * PRIME64_1;
+			hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+			p += 4;
+			size -= 4;
+		}
+		while (size > 0)
+		{
+			hash ^= (*p) * PRIME64_5;
+			hash = RotateLeft(hash, 11) * PRIME64_1;
+			++p;
+			--size;
+		}
+
+		hash ^= hash >> 33;
+		hash *= PRIME64_2;
+		hash ^= hash >> 29;
+		hash *= PRIME64_3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	void InitAccumulators(uint64_t accumulators[4], uint64_t seed)
+	{
+		accumulators[0] = seed + PRIME64_1 + PRIME64_2;
+		accumulators[1] = seed + PRIME64_2;
+		accumulators[2] = seed;
+		accumulators[3] = seed - PRIME64_1;
+	}
+
+	uint64_t MergeAccumulators(const uint64_t accumulators[4])
+	{
+		uint64_t hash = RotateLeft(accumulators[0], 1) + RotateLeft(accumulators[1], 7) +
+			RotateLeft(accumulators[2], 12) + RotateLeft(accumulators[3], 18);
+		for (int i = 0; i < 4; ++i)
+			hash = MergeRound(hash, accumulators[i]);
+		return hash;
+	}
+}
+
+
+// =====================================================================================
+//										One shot
+// =====================================================================================
+
+uint64_t HashXXH64(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+
+	uint64_t hash;
+	size_t consumed = 0;
+	if (size >= 32)
+	{
+		uint64_t accumulators[4];
+		InitAccumulators(accumulators, seed);
+		consumed = ConsumeStripes(accumulators, p, size);
+		hash = MergeAccumulators(accumulators);
+	}
+	else
+	{
+		hash = seed + PRIME64_5;
+	}
+
+	hash += uint64_t(size);
+	return Finalize(hash, p + consumed, size - consumed);
+}
+
+// =====================================================================================
+//										Streaming
+// =====================================================================================
+
+void StreamingHash64::Reset(uint64_t seed)
+{
+	m_Seed = seed;
+	InitAccumulators(m_Accumulators, seed);
+	m_TotalSize = 0;
+	m_BufferSize = 0;
+}
+
+void StreamingHash64::Update(const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	m_TotalSize += size;
+
+	// Top up a partial stripe first.
+	if (m_BufferSize > 0)
+	{
+		const size_t fill = size < 32 - m_BufferSize ? size : 32 - m_BufferSize;
+		std::memcpy(m_Buffer + m_BufferSize, p, fill);
+		m_BufferSize += uint32_t(fill);
+		p += fill;
+		size -= fill;
+		if (m_BufferSize < 32)
+			return;
+		ConsumeStripes(m_Accumulators, m_Buffer, 32);
+		m_BufferSize = 0;
+	}
+
+	const size_t consumed = ConsumeStripes(m_Accumulators, p, size);
+	m_BufferSize = uint32_t(size - consumed);
+	std::memcpy(m_Buffer, p + consumed, m_BufferSize);
+}
+
+uint64_t StreamingHash64::Digest() const
+{
+	uint64_t hash = m_TotalSize >= 32 ? MergeAccumulators(m_Accumulators) : m_Seed + PRIME64_5;
+	hash += m_TotalSize;
+	return Finalize(hash, m_Buffer, m_BufferSize);
+}
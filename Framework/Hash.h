@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// =====================================================================================
+//										XXH64
+// =====================================================================================
+
+// xxHash, 64 bit variant (Yann Collet) - a non-cryptographic hash running at several GB/s
+//		with good distribution, for pack file tables of contents and content keys. Output is
+//		identical to the reference implementation (XXH64()), so hashes can be checked with
+//		xxhsum.
+uint64_t HashXXH64(const void* data, size_t size, uint64_t seed = 0);
+
+// Same hash over data arriving in pieces: Update() any number of times, then Digest().
+//		Digest(Update(a), Update(b)) == HashXXH64(a + b).
+class StreamingHash64
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	explicit StreamingHash64(uint64_t seed = 0) { Reset(seed); }
+
+	void Reset(uint64_t seed = 0);
+	void Update(const void* data, size_t size);
+	template<typename T>
+	void UpdateValue(const T& value) { Update(&value, sizeof(T)); }
+	uint64_t Digest() const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	uint64_t m_Seed;
+	uint64_t m_Accumulators[4];
+	uint64_t m_TotalSize;
+	// Input not yet consumed: less than one 32 byte stripe.
+	uint8_t m_Buffer[32];
+	uint32_t m_BufferSize;
+};
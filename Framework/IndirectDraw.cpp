@@ -0,0 +1,55 @@
+#include "IndirectDraw.h"
+#include "TaskScheduler.h"
+
+#include <cassert>
+#include <cstddef>   // offsetof
+
+#if defined(_WIN32)
+#include <d3d12.h>
+
+static_assert(sizeof(DrawIndexedArguments) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "Layout mismatch.");
+static_assert(offsetof(DrawIndexedArguments, indexCountPerInstance) == offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, IndexCountPerInstance), "Layout mismatch.");
+static_assert(offsetof(DrawIndexedArguments, instanceCount) == offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, InstanceCount), "Layout mismatch.");
+static_assert(offsetof(DrawIndexedArguments, startIndexLocation) == offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, StartIndexLocation), "Layout mismatch.");
+static_assert(offsetof(DrawIndexedArguments, baseVertexLocation) == offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, BaseVertexLocation), "Layout mismatch.");
+static_assert(offsetof(DrawIndexedArguments, startInstanceLocation) == offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, StartInstanceLocation), "Layout mismatch.");
+#endif
+
+
+namespace
+{
+	// Commands per ParallelFor task.
+	constexpr size_t PACK_GRAIN_SIZE = 4096;
+}
+
+size_t PackIndirectDrawCommands(const InstanceBatch* batches, size_t numBatches,
+	const MeshDrawRange* meshes, size_t numMeshes, IndirectDrawCommand* out,
+	TaskScheduler* scheduler)
+{
+	(void)numMeshes;
+
+	auto pack = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			const InstanceBatch& batch = batches[i];
+			const MeshId mesh = GetBatchMesh(batch.key);
+			assert(mesh < numMeshes && "Batch references an unknown mesh.");
+
+			// Built in a local and stored at once - "out" is usually write-combined memory.
+			IndirectDrawCommand command;
+			command.draw.indexCountPerInstance = meshes[mesh].indexCount;
+			command.draw.instanceCount = batch.instanceCount;
+			command.draw.startIndexLocation = meshes[mesh].startIndex;
+			command.draw.baseVertexLocation = meshes[mesh].baseVertex;
+			command.draw.startInstanceLocation = batch.firstInstance;
+			out[i] = command;
+		}
+	};
+
+	if (scheduler && numBatches > PACK_GRAIN_SIZE)
+		scheduler->ParallelFor(0, numBatches, PACK_GRAIN_SIZE, pack);
+	else
+		pack(0, numBatches);
+
+	return numBatches;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "InstanceBatcher.h"
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Indirect draw commands
+// =====================================================================================
+
+// Same layout as D3D12_DRAW_INDEXED_ARGUMENTS (checked in IndirectDraw.cpp on Windows),
+//		declared here so the packing code builds and runs without the D3D12 headers.
+struct DrawIndexedArguments
+{
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+};
+
+// One ExecuteIndirect command. The matching command signature is a single
+//		D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED argument with
+//		ByteStride = sizeof(IndirectDrawCommand) and no root signature: no root arguments
+//		change per draw. The instance data is a vertex stream, which StartInstanceLocation
+//		already offsets to the batch's slice. Per draw root constants (e.g. a material
+//		index) would go in front of "draw".
+struct IndirectDrawCommand
+{
+	DrawIndexedArguments draw;
+};
+
+static_assert(sizeof(DrawIndexedArguments) == 20, "DrawIndexedArguments must match D3D12_DRAW_INDEXED_ARGUMENTS.");
+static_assert(sizeof(IndirectDrawCommand) == sizeof(DrawIndexedArguments), "IndirectDrawCommand must be tightly packed.");
+
+// Index range of a mesh in the (shared) index and vertex buffers.
+struct MeshDrawRange
+{
+	uint32_t indexCount;
+	uint32_t startIndex;
+	int32_t baseVertex;
+};
+
+// Pack one command per instance batch into "out" (e.g. the mapped argument buffer).
+//		"meshes" is indexed by MeshId. Large batch lists are packed in parallel. Returns the
+//		number of commands written - the value for the count buffer.
+size_t PackIndirectDrawCommands(const InstanceBatch* batches, size_t numBatches,
+	const MeshDrawRange* meshes, size_t numMeshes, IndirectDrawCommand* out,
+	TaskScheduler* scheduler = nullptr);
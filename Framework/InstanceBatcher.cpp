@@ -0,0 +1,127 @@
+#include "InstanceBatcher.h"
+#include "TaskScheduler.h"
+
+#include <cstring>   // std::memcpy
+
+using namespace DirectX;
+
+
+namespace
+{
+	constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+
+	// Instances per ParallelFor task when gathering transforms.
+	constexpr size_t WRITE_GRAIN_SIZE = 8192;
+
+	// 64 bit finalizer (MurmurHash3) - mesh and material ids are small sequential numbers,
+	//		so they need proper mixing before masking with the table size.
+	inline uint64_t HashKey(uint64_t key)
+	{
+		key ^= key >> 33;
+		key *= 0xFF51AFD7ED558CCDull;
+		key ^= key >> 33;
+		key *= 0xC4CEB9FE1A85EC53ull;
+		key ^= key >> 33;
+		return key;
+	}
+}
+
+// =====================================================================================
+//										Build
+// =====================================================================================
+
+void InstanceBatcher::Build(const uint32_t* visible, size_t numVisible, const BatchKey* objectKeys)
+{
+	// Empty the slots the last build filled. The table is all empty between builds, so
+	//		this costs one store per batch instead of a pass over the whole table, which
+	//		stays as big as the busiest frame ever made it.
+	for (uint32_t slot : m_UsedSlots)
+		m_TableBatches[slot] = EMPTY_SLOT;
+	m_UsedSlots.clear();
+
+	m_Batches.clear();
+	m_InstanceObjects.resize(numVisible);
+	m_ObjectBatches.resize(numVisible);
+	if (numVisible == 0)
+		return;
+
+	// At most one batch per object; keep the load factor at or below 1/2. The table only
+	//		grows, so steady state frames don't allocate.
+	size_t tableSize = 64;
+	while (tableSize < numVisible * 2)
+		tableSize *= 2;
+	if (m_TableKeys.size() < tableSize)
+	{
+		m_TableKeys.resize(tableSize);
+		m_TableBatches.resize(tableSize, EMPTY_SLOT);
+	}
+	tableSize = m_TableKeys.size();
+	const size_t tableMask = tableSize - 1;
+
+	// 1) Find (or create) the batch of every object and count the instances.
+	//		Neighbouring objects very often share the key - remember the last one to skip
+	//		the probe entirely.
+	BatchKey lastKey = ~objectKeys[visible[0]];
+	uint32_t lastBatch = EMPTY_SLOT;
+	for (size_t i = 0; i < numVisible; ++i)
+	{
+		const BatchKey key = objectKeys[visible[i]];
+		if (key != lastKey)
+		{
+			size_t slot = HashKey(key) & tableMask;
+			while (m_TableBatches[slot] != EMPTY_SLOT && m_TableKeys[slot] != key)
+				slot = (slot + 1) & tableMask;
+
+			if (m_TableBatches[slot] == EMPTY_SLOT)
+			{
+				m_TableKeys[slot] = key;
+				m_TableBatches[slot] = static_cast<uint32_t>(m_Batches.size());
+				m_UsedSlots.push_back(static_cast<uint32_t>(slot));
+				m_Batches.push_back({ key, 0, 0 });
+			}
+			lastKey = key;
+			lastBatch = m_TableBatches[slot];
+		}
+
+		m_ObjectBatches[i] = lastBatch;
+		++m_Batches[lastBatch].instanceCount;
+	}
+
+	// 2) Prefix sum -> instance ranges.
+	m_Cursors.resize(m_Batches.size());
+	uint32_t firstInstance = 0;
+	for (size_t b = 0; b < m_Batches.size(); ++b)
+	{
+		m_Batches[b].firstInstance = firstInstance;
+		m_Cursors[b] = firstInstance;
+		firstInstance += m_Batches[b].instanceCount;
+	}
+
+	// 3) Scatter. Stable, so instances keep the order of the visible list inside a batch.
+	for (size_t i = 0; i < numVisible; ++i)
+	{
+		m_InstanceObjects[m_Cursors[m_ObjectBatches[i]]++] = visible[i];
+	}
+}
+
+// =====================================================================================
+//									Instance data
+// =====================================================================================
+
+void InstanceBatcher::WriteInstanceTransforms(const XMFLOAT4X4* objectWorldMatrices,
+	XMFLOAT4X4* out, TaskScheduler* scheduler) const
+{
+	auto write = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			// memcpy - "out" is usually write-combined upload memory, which must only be
+			//		written sequentially and never read.
+			std::memcpy(&out[i], &objectWorldMatrices[m_InstanceObjects[i]], sizeof(XMFLOAT4X4));
+		}
+	};
+
+	if (scheduler && m_InstanceObjects.size() > WRITE_GRAIN_SIZE)
+		scheduler->ParallelFor(0, m_InstanceObjects.size(), WRITE_GRAIN_SIZE, write);
+	else
+		write(0, m_InstanceObjects.size());
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Instance batcher
+// =====================================================================================
+
+typedef uint32_t MeshId;
+typedef uint32_t MaterialId;
+
+// Objects with the same key can be drawn with one instanced draw.
+typedef uint64_t BatchKey;
+inline BatchKey MakeBatchKey(MeshId mesh, MaterialId material)
+{
+	return (static_cast<uint64_t>(mesh) << 32) | material;
+}
+inline MeshId GetBatchMesh(BatchKey key) { return static_cast<MeshId>(key >> 32); }
+inline MaterialId GetBatchMaterial(BatchKey key) { return static_cast<MaterialId>(key & 0xFFFFFFFFu); }
+
+// One DrawIndexedInstanced: instances [firstInstance, firstInstance + instanceCount) of
+//		the instance buffer.
+struct InstanceBatch
+{
+	BatchKey key;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+// Groups the visible objects by (mesh, material) so each group is one instanced draw.
+//
+// Grouping is a counting sort keyed by a hash table instead of a comparison sort:
+//		1) every visible object looks up its key in an open addressing table - the first
+//		   occurrence of a key creates a batch, later ones only increment its count,
+//		2) a prefix sum over the batch counts gives every batch its instance range,
+//		3) the objects are scattered into their batch's range.
+//		That is O(n) with one hash probe per object, and the batches come out in the order
+//		their keys first appear, so the result is deterministic frame to frame.
+class InstanceBatcher
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// "objectKeys" is indexed by object (the values in "visible").
+	void Build(const uint32_t* visible, size_t numVisible, const BatchKey* objectKeys);
+
+	const std::vector<InstanceBatch>& GetBatches() const { return m_Batches; }
+	// Object of every instance, batch after batch.
+	const std::vector<uint32_t>& GetInstanceObjects() const { return m_InstanceObjects; }
+	size_t GetInstanceCount() const { return m_InstanceObjects.size(); }
+
+	// Gather the world matrices of all instances into "out" (GetInstanceCount() entries,
+	//		e.g. the mapped instance buffer), in parallel with a scheduler.
+	void WriteInstanceTransforms(const DirectX::XMFLOAT4X4* objectWorldMatrices,
+		DirectX::XMFLOAT4X4* out, TaskScheduler* scheduler = nullptr) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	std::vector<InstanceBatch> m_Batches;
+	std::vector<uint32_t> m_InstanceObjects;
+
+	// Open addressing hash table: key -> batch index. Power of two sized.
+	std::vector<BatchKey> m_TableKeys;
+	std::vector<uint32_t> m_TableBatches;
+	// Slots filled by the last Build(), emptied by the next one.
+	std::vector<uint32_t> m_UsedSlots;
+	// Batch of every visible object (pass 1 -> pass 3).
+	std::vector<uint32_t> m_ObjectBatches;
+	// Scatter cursors, one per batch.
+	std::vector<uint32_t> m_Cursors;
+};
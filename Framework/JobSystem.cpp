@@ -0,0 +1,423 @@
+#include "JobSystem.h"
+
+#include <algorithm> // std::max
+#include <cassert>
+
+// The thread state must be looked up again after every fiber switch (a job can be
+//		resumed on a different worker), so the lookup must never be inlined and its
+//		result cached by the optimizer.
+#if defined(_MSC_VER)
+#define JOBSYSTEM_NOINLINE __declspec(noinline)
+#else
+#define JOBSYSTEM_NOINLINE __attribute__((noinline))
+#endif
+
+
+// =====================================================================================
+//										Globals
+// =====================================================================================
+
+namespace
+{
+	// Owned by the worker threads' WorkerMain.
+	thread_local void* t_ThreadState = nullptr;
+	thread_local const JobSystem* t_JobSystem = nullptr;
+
+	// Number of empty scheduling loops before a worker goes to sleep.
+	constexpr int NUM_SPINS_BEFORE_SLEEP = 64;
+}
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+JobSystem::JobSystem(uint32_t numWorkerThreads, uint32_t numFibers, size_t fiberStackSize,
+	std::function<void(uint32_t)> onWorkerStart)
+	: m_OnWorkerStart(std::move(onWorkerStart))
+	, m_NumQueued(0)
+	, m_FiberStackSize(fiberStackSize)
+	, m_NumFibersInUse(0)
+	, m_WakeEpoch(0)
+	, m_NumSleeping(0)
+	, m_NumWaiting(0)
+	, m_Running(true)
+{
+	if (numWorkerThreads == 0)
+	{
+		numWorkerThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Fiber pool - the stacks are allocated up front.
+	assert(numFibers > 0);
+	for (uint32_t i = 0; i < numFibers; ++i)
+	{
+		m_FreeFibers.push_back(CreateFiberSlot());
+	}
+
+	for (uint32_t i = 0; i < numWorkerThreads; ++i)
+	{
+		m_Workers.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	// The workers keep going until every queued, running and parked job has finished.
+	//		A job waiting for a counter that never reaches its value hangs here.
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Running.store(false, std::memory_order_seq_cst);
+		++m_WakeEpoch;
+	}
+	m_WakeUp.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+
+	assert(m_NumQueued.load() == 0 && m_NumFibersInUse.load() == 0 && m_WaitList.empty());
+}
+
+// =====================================================================================
+//									  Kick & Wait
+// =====================================================================================
+
+void JobSystem::RunJobs(const std::function<void()>* jobs, size_t count,
+	JobCounter* counter, JobPriority priority)
+{
+	// The counter must be raised before any job of the batch can finish.
+	if (counter)
+	{
+		counter->value.fetch_add(static_cast<int32_t>(count), std::memory_order_acq_rel);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_JobMutex);
+		std::deque<Job>& queue = m_JobQueues[static_cast<size_t>(priority)];
+		for (size_t i = 0; i < count; ++i)
+		{
+			queue.push_back(Job{ jobs[i], counter });
+		}
+	}
+	m_NumQueued.fetch_add(static_cast<int32_t>(count), std::memory_order_seq_cst);
+
+	WakeWorkers();
+}
+
+void JobSystem::RunJob(std::function<void()> job, JobCounter* counter, JobPriority priority)
+{
+	RunJobs(&job, 1, counter, priority);
+}
+
+void JobSystem::WaitForCounter(JobCounter& counter, int32_t value)
+{
+	if (counter.GetValue() <= value)
+		return;
+
+	ThreadState* state = GetThreadState();
+	if (!state || !state->currentSlot || t_JobSystem != this)
+	{
+		// Not a job - there is no fiber to suspend, block the thread until a finishing
+		//		job brings the counter down (see OnCounterDecremented()).
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_NumWaiting.fetch_add(1, std::memory_order_seq_cst);
+		m_NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_WakeUp.wait(lock, [&counter, value]() {
+			return counter.value.load(std::memory_order_seq_cst) <= value;
+		});
+		m_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+		m_NumWaiting.fetch_sub(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// Hand the fiber over to the worker loop which parks it AFTER the switch.
+	FiberSlot* slot = state->currentSlot;
+	state->action = FiberAction::Park;
+	state->waitCounter = &counter;
+	state->waitValue = value;
+
+	Fiber::Switch(*slot->fiber, *state->threadFiber);
+
+	// Resumed - possibly on another worker. "state" must not be used anymore.
+}
+
+bool JobSystem::IsInsideJob() const
+{
+	ThreadState* state = GetThreadState();
+	return state && state->currentSlot && t_JobSystem == this;
+}
+
+// =====================================================================================
+//									   Workers
+// =====================================================================================
+
+JOBSYSTEM_NOINLINE JobSystem::ThreadState* JobSystem::GetThreadState()
+{
+	return static_cast<ThreadState*>(t_ThreadState);
+}
+
+void JobSystem::WorkerMain(uint32_t workerIndex)
+{
+	if (m_OnWorkerStart)
+	{
+		m_OnWorkerStart(workerIndex);
+	}
+
+	ThreadState state;
+	state.threadFiber = Fiber::ConvertCurrentThread();
+	t_ThreadState = &state;
+	t_JobSystem = this;
+
+	int spins = 0;
+	for (;;)
+	{
+		// Resuming parked fibers first lets waiting jobs finish before new ones start,
+		//		which keeps the number of fibers in use (and their stacks) low.
+		FiberSlot* slot = PopReadyFiber();
+
+		if (!slot && m_NumQueued.load(std::memory_order_seq_cst) > 0)
+		{
+			// The fiber is taken before the job leaves the queue, so the job is always
+			//		counted as either queued or in use (see IsDrained()).
+			slot = AcquireFreeFiber();
+			if (!PopJob(slot->job))
+			{
+				ReleaseFiber(slot);
+				slot = nullptr;
+			}
+		}
+
+		if (!slot)
+		{
+			if (!m_Running.load(std::memory_order_acquire) && IsDrained())
+				break;
+
+			if (++spins < NUM_SPINS_BEFORE_SLEEP)
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				Sleep();
+				spins = 0;
+			}
+			continue;
+		}
+		spins = 0;
+
+		// Run the job (or the rest of it) until it finishes or waits.
+		state.currentSlot = slot;
+		state.action = FiberAction::None;
+		Fiber::Switch(*state.threadFiber, *slot->fiber);
+		state.currentSlot = nullptr;
+
+		switch (state.action)
+		{
+		case FiberAction::ReturnToPool:
+			ReleaseFiber(slot);
+			break;
+		case FiberAction::Park:
+		{
+			// Registered before the next PopReadyFiber(): a job finishing after this
+			//		point wakes the sleepers, one that finished before is seen by the scan.
+			std::lock_guard<std::mutex> lock(m_WaitListMutex);
+			m_WaitList.push_back(WaitingFiber{ slot, state.waitCounter, state.waitValue });
+			m_NumWaiting.fetch_add(1, std::memory_order_seq_cst);
+		}
+			break;
+		default:
+			assert(false && "A job fiber switched back without an action.");
+			break;
+		}
+	}
+
+	t_ThreadState = nullptr;
+	t_JobSystem = nullptr;
+	Fiber::ConvertBackToThread();
+}
+
+void JobSystem::FiberMain(void* userData)
+{
+	FiberSlot* slot = static_cast<FiberSlot*>(userData);
+
+	for (;;)
+	{
+		JobCounter* counter = nullptr;
+		{
+			Job job = std::move(slot->job);
+			slot->job.function = nullptr;
+			slot->job.counter = nullptr;
+
+			job.function();
+			counter = job.counter;
+
+			// The job's captures are destroyed here - before the counter says the job is
+			//		done and before the switch below (a fiber's last job would never be
+			//		destroyed otherwise).
+		}
+
+		if (counter)
+		{
+			counter->value.fetch_sub(1, std::memory_order_seq_cst);
+			slot->system->OnCounterDecremented();
+		}
+
+		// Look the thread state up again - the job might have been
+		//		resumed on a different worker while it was waiting.
+		ThreadState* state = GetThreadState();
+		state->action = FiberAction::ReturnToPool;
+		Fiber::Switch(*slot->fiber, *state->threadFiber);
+	}
+}
+
+// =====================================================================================
+//										Queues
+// =====================================================================================
+
+bool JobSystem::PopJob(Job& job)
+{
+	std::lock_guard<std::mutex> lock(m_JobMutex);
+	for (std::deque<Job>& queue : m_JobQueues)
+	{
+		if (!queue.empty())
+		{
+			job = std::move(queue.front());
+			queue.pop_front();
+			m_NumQueued.fetch_sub(1, std::memory_order_seq_cst);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+JobSystem::FiberSlot* JobSystem::PopReadyFiber()
+{
+	std::lock_guard<std::mutex> lock(m_WaitListMutex);
+	for (size_t i = 0; i < m_WaitList.size(); ++i)
+	{
+		const WaitingFiber& waiting = m_WaitList[i];
+		if (waiting.counter->GetValue() <= waiting.value)
+		{
+			FiberSlot* slot = waiting.slot;
+			m_WaitList[i] = m_WaitList.back();
+			m_WaitList.pop_back();
+			m_NumWaiting.fetch_sub(1, std::memory_order_relaxed);
+			return slot;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::HasReadyFiber()
+{
+	std::lock_guard<std::mutex> lock(m_WaitListMutex);
+	for (const WaitingFiber& waiting : m_WaitList)
+	{
+		if (waiting.counter->value.load(std::memory_order_seq_cst) <= waiting.value)
+			return true;
+	}
+
+	return false;
+}
+
+// =====================================================================================
+//									   Fiber pool
+// =====================================================================================
+
+// Called with m_FreeFiberMutex locked (or from the constructor).
+JobSystem::FiberSlot* JobSystem::CreateFiberSlot()
+{
+	std::unique_ptr<FiberSlot> slot(new FiberSlot());
+	slot->system = this;
+	slot->fiber.reset(new Fiber(m_FiberStackSize, &JobSystem::FiberMain, slot.get()));
+	slot->job.counter = nullptr;
+
+	m_FiberSlots.push_back(std::move(slot));
+	return m_FiberSlots.back().get();
+}
+
+JobSystem::FiberSlot* JobSystem::AcquireFreeFiber()
+{
+	std::lock_guard<std::mutex> lock(m_FreeFiberMutex);
+	m_NumFibersInUse.fetch_add(1, std::memory_order_relaxed);
+
+	// Every fiber runs a job or is parked. Parked jobs can be waiting for the very job
+	//		that needs a fiber now - grow instead of waiting for one to come back.
+	if (m_FreeFibers.empty())
+		return CreateFiberSlot();
+
+	FiberSlot* slot = m_FreeFibers.back();
+	m_FreeFibers.pop_back();
+	return slot;
+}
+
+void JobSystem::ReleaseFiber(FiberSlot* slot)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_FreeFiberMutex);
+		m_FreeFibers.push_back(slot);
+	}
+	m_NumFibersInUse.fetch_sub(1, std::memory_order_seq_cst);
+
+	// The last job to finish at shutdown lets the sleeping workers exit.
+	if (!m_Running.load(std::memory_order_seq_cst))
+	{
+		WakeWorkers();
+	}
+}
+
+// =====================================================================================
+//										Sleeping
+// =====================================================================================
+
+bool JobSystem::IsDrained() const
+{
+	return m_NumQueued.load(std::memory_order_seq_cst) == 0 &&
+		m_NumFibersInUse.load(std::memory_order_seq_cst) == 0;
+}
+
+// Lost wake ups are avoided the same way as in the TaskScheduler: the sleeper registers
+//		in m_NumSleeping BEFORE it checks for work one last time, while whoever publishes
+//		work (a job, a counter decrement, the shutdown) does so BEFORE it checks
+//		m_NumSleeping. Either the sleeper sees the work, or the publisher sees the sleeper
+//		and bumps the epoch under the sleep mutex.
+void JobSystem::Sleep()
+{
+	std::unique_lock<std::mutex> lock(m_SleepMutex);
+	m_NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+
+	const uint64_t epoch = m_WakeEpoch;
+	const bool shutdown = !m_Running.load(std::memory_order_seq_cst);
+	const bool hasWork = m_NumQueued.load(std::memory_order_seq_cst) > 0 || HasReadyFiber() ||
+		(shutdown && IsDrained());
+	if (!hasWork)
+	{
+		m_WakeUp.wait(lock, [this, epoch]() { return m_WakeEpoch != epoch; });
+	}
+
+	m_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void JobSystem::WakeWorkers()
+{
+	if (m_NumSleeping.load(std::memory_order_seq_cst) == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		++m_WakeEpoch;
+	}
+	m_WakeUp.notify_all();
+}
+
+void JobSystem::OnCounterDecremented()
+{
+	// Only counters somebody waits for can make progress possible.
+	if (m_NumWaiting.load(std::memory_order_seq_cst) > 0)
+	{
+		WakeWorkers();
+	}
+}
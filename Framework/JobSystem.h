@@ -0,0 +1,194 @@
+#pragma once
+
+// Portable C++ only (see Fiber.h for the platform specific part).
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Fiber.h"
+
+// =====================================================================================
+//										Counter
+// =====================================================================================
+
+// Jobs are kicked with an (optional) counter. The counter is incremented by the number
+//		of jobs kicked and decremented as every job finishes, so waiting for "counter == 0"
+//		waits for the whole batch. Waiting on a value other than 0 allows to wait for
+//		"all but N" jobs of a batch.
+struct JobCounter
+{
+	JobCounter() : value(0) {}
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	int32_t GetValue() const { return value.load(std::memory_order_acquire); }
+
+	std::atomic<int32_t> value;
+};
+
+enum class JobPriority : uint8_t
+{
+	High = 0,
+	Normal,
+	Low,
+
+	Count
+};
+
+// =====================================================================================
+//									  Job system
+// =====================================================================================
+
+// Fiber based job system ("Parallelizing the Naughty Dog Engine Using Fibers", GDC 2015):
+//		- Every job runs on a fiber taken from a fiber pool. The pool is allocated up front
+//		  and only grows when every fiber is running or waiting: the waiting jobs may
+//		  depend on the queued ones, so refusing to start them could deadlock.
+//		- A job can wait for a counter in the middle of its execution with WaitForCounter().
+//		  Instead of blocking the worker thread, the job's fiber is parked in a wait list
+//		  and the worker picks up other jobs. Once the counter reaches the wanted value,
+//		  any worker resumes the parked fiber (not necessarily the one it was parked on).
+//		- Worker threads never run jobs directly - they run a small scheduling loop on their
+//		  own thread fiber and only switch to job fibers. A job fiber always switches back
+//		  to the thread fiber of the worker it runs on; the loop then returns the fiber to
+//		  the pool or parks it. This way a fiber is never visible to other workers before
+//		  it has been fully switched out.
+//
+// Non-job threads (Game::Update, the command list recording path) can kick jobs and wait
+//		for counters as well - they simply block until the counter is reached.
+//
+// Idle workers sleep until there is something to do: a job is kicked, or a counter that a
+//		parked fiber (or a blocked thread) waits for is decremented. Counters must only be
+//		changed by the job system.
+//
+// The destructor lets every job that was kicked run to completion before the workers exit.
+class JobSystem
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// 0 worker threads means one per hardware thread.
+	//		"onWorkerStart(workerIndex)" runs first thing on every worker thread.
+	explicit JobSystem(uint32_t numWorkerThreads = 0, uint32_t numFibers = 128,
+		size_t fiberStackSize = 64 * 1024, std::function<void(uint32_t)> onWorkerStart = nullptr);
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	~JobSystem();
+
+	// Kick "count" jobs. If a counter is given it's incremented by "count" before
+	//		any of the jobs can start.
+	void RunJobs(const std::function<void()>* jobs, size_t count,
+		JobCounter* counter = nullptr, JobPriority priority = JobPriority::Normal);
+	void RunJob(std::function<void()> job,
+		JobCounter* counter = nullptr, JobPriority priority = JobPriority::Normal);
+
+	// Wait until counter <= value.
+	//		- Inside a job: the job's fiber is suspended, the worker keeps running other jobs.
+	//		- Outside a job: the calling thread blocks.
+	void WaitForCounter(JobCounter& counter, int32_t value = 0);
+
+	// True if the calling code runs inside a job of this job system.
+	bool IsInsideJob() const;
+
+	uint32_t GetNumWorkerThreads() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+protected:
+	void WorkerMain(uint32_t workerIndex);
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	// A fiber of the pool and the job it is currently running.
+	struct FiberSlot
+	{
+		JobSystem* system;
+		std::unique_ptr<Fiber> fiber;
+		Job job;
+	};
+
+	struct WaitingFiber
+	{
+		FiberSlot* slot;
+		JobCounter* counter;
+		int32_t value;
+	};
+
+	// What the worker loop should do with the fiber that just switched back to it.
+	enum class FiberAction : uint8_t
+	{
+		None,
+		ReturnToPool,
+		Park
+	};
+
+	struct ThreadState
+	{
+		std::unique_ptr<Fiber> threadFiber;
+		FiberSlot* currentSlot = nullptr;
+
+		FiberAction action = FiberAction::None;
+		JobCounter* waitCounter = nullptr;
+		int32_t waitValue = 0;
+	};
+
+	static void FiberMain(void* userData);
+	static ThreadState* GetThreadState();
+
+	bool PopJob(Job& job);
+	FiberSlot* PopReadyFiber();
+	bool HasReadyFiber();
+	FiberSlot* CreateFiberSlot();
+	FiberSlot* AcquireFreeFiber();
+	void ReleaseFiber(FiberSlot* slot);
+	void OnCounterDecremented();
+
+	// Workers only leave once every kicked job has finished.
+	bool IsDrained() const;
+	void Sleep();
+	void WakeWorkers();
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	std::vector<std::thread> m_Workers;
+	std::function<void(uint32_t)> m_OnWorkerStart;
+
+	// Job queues - one per priority, always drained from the highest priority first.
+	std::mutex m_JobMutex;
+	std::deque<Job> m_JobQueues[static_cast<size_t>(JobPriority::Count)];
+	std::atomic<int32_t> m_NumQueued;
+
+	// Fiber pool. Fibers in use are either running a job or parked.
+	size_t m_FiberStackSize;
+	std::mutex m_FreeFiberMutex;
+	std::vector<std::unique_ptr<FiberSlot>> m_FiberSlots;
+	std::vector<FiberSlot*> m_FreeFibers;
+	std::atomic<int32_t> m_NumFibersInUse;
+
+	// Fibers suspended in WaitForCounter().
+	std::mutex m_WaitListMutex;
+	std::vector<WaitingFiber> m_WaitList;
+
+	// Sleeping workers and threads blocked in WaitForCounter() (m_NumSleeping), parked
+	//		fibers and blocked threads (m_NumWaiting) - a finished job only takes the
+	//		sleep mutex when both are non zero. Every wake up bumps m_WakeEpoch.
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeUp;
+	uint64_t m_WakeEpoch;
+	std::atomic<int32_t> m_NumSleeping;
+	std::atomic<int32_t> m_NumWaiting;
+
+	std::atomic<bool> m_Running;
+};
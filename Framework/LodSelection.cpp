@@ -0,0 +1,199 @@
+#include "LodSelection.h"
+#include "FrustumCulling.h" // BoundingSpheres
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::max, std::min
+#include <cassert>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define LOD_SELECTION_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+
+
+namespace
+{
+	// Objects per ParallelFor task.
+	constexpr size_t SELECT_GRAIN_SIZE = 4096;
+
+	// Levels are stored in 8 bits per object.
+	constexpr size_t MAX_LOD_LEVELS = 256;
+
+	// Objects whose bounding sphere contains the eye get (almost) no allowed error - full detail.
+	constexpr float MIN_DISTANCE = 1e-3f;
+}
+
+// =====================================================================================
+//										LOD sets
+// =====================================================================================
+
+LodSetId LodSelector::AddLodSet(const LodLevel* levels, size_t numLevels)
+{
+	assert(numLevels > 0 && numLevels <= MAX_LOD_LEVELS);
+	for (size_t i = 1; i < numLevels; ++i)
+	{
+		assert(levels[i].geometricError >= levels[i - 1].geometricError && "Levels must be ordered fine to coarse.");
+	}
+
+	LodSet set;
+	set.firstLevel = static_cast<uint32_t>(m_Levels.size());
+	set.numLevels = static_cast<uint32_t>(numLevels);
+	m_Levels.insert(m_Levels.end(), levels, levels + numLevels);
+	m_Sets.push_back(set);
+	return static_cast<LodSetId>(m_Sets.size() - 1);
+}
+
+void LodSelector::SetCamera(const XMFLOAT3& eyePosition, float fovYRadians, float viewportHeight)
+{
+	m_EyePosition = eyePosition;
+	m_ProjectionScale = viewportHeight / (2.0f * std::tan(fovYRadians * 0.5f));
+}
+
+MeshId LodSelector::GetMesh(size_t object) const
+{
+	return m_Levels[m_Sets[m_ObjectSets[object]].firstLevel + m_Lods[object]].mesh;
+}
+
+MeshId LodSelector::GetPreviousMesh(size_t object) const
+{
+	return m_Levels[m_Sets[m_ObjectSets[object]].firstLevel + m_PreviousLods[object]].mesh;
+}
+
+// =====================================================================================
+//										Selection
+// =====================================================================================
+
+void LodSelector::Select(const BoundingSpheres& bounds, const LodSetId* objectLodSets, float deltaTime,
+	TaskScheduler* scheduler)
+{
+	const size_t count = bounds.GetCount();
+
+	// New objects start at full detail with no fade running.
+	m_AllowedErrors.resize(count);
+	m_ObjectSets.resize(count);
+	m_Lods.resize(count, 0);
+	m_PreviousLods.resize(count, 0);
+	m_Fades.resize(count, 1.0f);
+
+	auto select = [&](size_t begin, size_t end) {
+		ComputeAllowedErrors(bounds, begin, end);
+		SelectLevels(objectLodSets, deltaTime, begin, end);
+	};
+
+	if (scheduler && count > SELECT_GRAIN_SIZE)
+		scheduler->ParallelFor(0, count, SELECT_GRAIN_SIZE, select);
+	else
+		select(0, count);
+}
+
+// allowedError = threshold * max(|center - eye| - radius, MIN_DISTANCE) / projScale
+void LodSelector::ComputeAllowedErrors(const BoundingSpheres& bounds, size_t begin, size_t end)
+{
+	const float errorPerDistance = m_Settings.errorThreshold / m_ProjectionScale;
+
+	const float* cx = bounds.centerX.data();
+	const float* cy = bounds.centerY.data();
+	const float* cz = bounds.centerZ.data();
+	const float* r = bounds.radius.data();
+	float* out = m_AllowedErrors.data();
+
+	size_t i = begin;
+#if LOD_SELECTION_SSE
+	const __m128 eyeX = _mm_set1_ps(m_EyePosition.x);
+	const __m128 eyeY = _mm_set1_ps(m_EyePosition.y);
+	const __m128 eyeZ = _mm_set1_ps(m_EyePosition.z);
+	const __m128 minDistance = _mm_set1_ps(MIN_DISTANCE);
+	const __m128 scale = _mm_set1_ps(errorPerDistance);
+
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(cx + i), eyeX);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(cy + i), eyeY);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(cz + i), eyeZ);
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 dist = _mm_sub_ps(_mm_sqrt_ps(distSq), _mm_loadu_ps(r + i));
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_max_ps(dist, minDistance), scale));
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		float dx = cx[i] - m_EyePosition.x;
+		float dy = cy[i] - m_EyePosition.y;
+		float dz = cz[i] - m_EyePosition.z;
+		float dist = std::sqrt(dx * dx + dy * dy + dz * dz) - r[i];
+		out[i] = std::max(dist, MIN_DISTANCE) * errorPerDistance;
+	}
+}
+
+void LodSelector::SelectLevels(const LodSetId* objectLodSets, float deltaTime, size_t begin, size_t end)
+{
+	const float coarserFactor = 1.0f - m_Settings.hysteresis;
+	const bool crossFade = m_Settings.crossFade && m_Settings.fadeDuration > 0.0f;
+	const float fadeStep = crossFade ? deltaTime / m_Settings.fadeDuration : 1.0f;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const LodSetId setId = objectLodSets[i];
+		assert(setId < m_Sets.size() && "Object references an unknown LOD set.");
+		const LodSet& set = m_Sets[setId];
+		const LodLevel* levels = m_Levels.data() + set.firstLevel;
+
+		// An object moved to another set starts over at full detail.
+		uint32_t current = m_Lods[i];
+		if (m_ObjectSets[i] != setId)
+		{
+			m_ObjectSets[i] = setId;
+			current = 0;
+			m_Lods[i] = 0;
+			m_PreviousLods[i] = 0;
+			m_Fades[i] = 1.0f;
+		}
+
+		// Level 0 is always acceptable, the sets are short - a linear scan from the
+		//		coarse end finds the coarsest level within each limit.
+		const float allowed = m_AllowedErrors[i];
+		const float allowedCoarser = allowed * coarserFactor;
+		uint32_t finest = 0, coarser = 0;
+		for (uint32_t level = set.numLevels - 1; level > 0; --level)
+		{
+			if (levels[level].geometricError <= allowed)
+			{
+				finest = level;
+				break;
+			}
+		}
+		for (uint32_t level = finest; level > 0; --level)
+		{
+			if (levels[level].geometricError <= allowedCoarser)
+			{
+				coarser = level;
+				break;
+			}
+		}
+
+		// Refine as soon as the current level is too coarse, coarsen only past the dead band.
+		uint32_t selected = current;
+		if (current > finest)
+			selected = finest;
+		else if (coarser > current)
+			selected = coarser;
+
+		if (selected != current)
+		{
+			m_PreviousLods[i] = static_cast<uint8_t>(current);
+			m_Lods[i] = static_cast<uint8_t>(selected);
+			m_Fades[i] = crossFade ? 0.0f : 1.0f;
+		}
+		else
+		{
+			m_Fades[i] = std::min(m_Fades[i] + fadeStep, 1.0f);
+		}
+
+		if (m_Fades[i] >= 1.0f)
+			m_PreviousLods[i] = m_Lods[i];
+	}
+}
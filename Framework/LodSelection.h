@@ -0,0 +1,126 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InstanceBatcher.h" // MeshId
+
+struct BoundingSpheres;
+class TaskScheduler;
+
+// =====================================================================================
+//										LOD sets
+// =====================================================================================
+
+// One level of detail of a mesh. "geometricError" is the largest distance (object/world
+//		units) between this level's surface and the full detail surface - 0 for the full
+//		detail level itself. Mesh simplifiers report it directly.
+struct LodLevel
+{
+	MeshId mesh;
+	float geometricError;
+};
+
+typedef uint32_t LodSetId;
+
+// =====================================================================================
+//										LOD selector
+// =====================================================================================
+
+// Picks a discrete level of detail for every object, every frame, by its projected
+//		screen-space error.
+//
+// A level with geometric error e, seen from distance d through a perspective projection,
+//		deviates from the full detail mesh by about
+//			pixels = e * projScale / d,		projScale = viewportHeight / (2 * tan(fovY / 2))
+//		on screen. Turned around, the coarsest acceptable level is the coarsest one with
+//			e <= threshold * d / projScale		(the "allowed error" of the object)
+//		The distance is measured to the bounding sphere, not its center, so large objects
+//		don't drop detail on the side facing the camera.
+//
+// The allowed error is computed for 4 objects at a time (SSE) over the SoA bounding
+//		spheres; the level is then picked per object from its (short) LOD set.
+//
+// Popping:
+//		- Hysteresis: an object only switches to a coarser level once that level fits with
+//		  a margin (allowed error shrunk by "hysteresis"). Objects near a switch distance
+//		  don't flip back and forth on tiny camera movements.
+//		- Cross-fade: after a switch the previous level stays available for
+//		  "fadeDuration" seconds with a fade factor going 0 -> 1. The renderer draws both
+//		  levels and dithers them against each other (current level where
+//		  noise < fade, previous level where noise >= fade).
+class LodSelector
+{
+public:
+	struct Settings
+	{
+		// Largest acceptable error in pixels.
+		float errorThreshold = 1.0f;
+		// Fraction of the allowed error a coarser level must stay below before switching.
+		float hysteresis = 0.1f;
+		// Seconds, 0 switches instantly.
+		float fadeDuration = 0.25f;
+		bool crossFade = true;
+	};
+
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// Levels ordered from full detail to coarsest, with increasing geometric error.
+	LodSetId AddLodSet(const LodLevel* levels, size_t numLevels);
+	size_t GetLodSetCount() const { return m_Sets.size(); }
+
+	void SetSettings(const Settings& settings) { m_Settings = settings; }
+	const Settings& GetSettings() const { return m_Settings; }
+
+	// Same field of view as the projection matrix, viewport height in pixels.
+	void SetCamera(const DirectX::XMFLOAT3& eyePosition, float fovYRadians, float viewportHeight);
+
+	// Select the levels of all objects. "objectLodSets" is indexed like "bounds".
+	//		"deltaTime" (seconds) advances the cross-fades.
+	void Select(const BoundingSpheres& bounds, const LodSetId* objectLodSets, float deltaTime,
+		TaskScheduler* scheduler = nullptr);
+
+	// Results of the last Select(), by object. Levels index the object's LOD set.
+	uint32_t GetLod(size_t object) const { return m_Lods[object]; }
+	uint32_t GetPreviousLod(size_t object) const { return m_PreviousLods[object]; }
+	// 1 when the switch to GetLod() finished, the previous level is drawn until then.
+	float GetFade(size_t object) const { return m_Fades[object]; }
+	bool IsFading(size_t object) const { return m_Fades[object] < 1.0f; }
+
+	MeshId GetMesh(size_t object) const;
+	MeshId GetPreviousMesh(size_t object) const;
+
+private:
+	struct LodSet
+	{
+		uint32_t firstLevel;
+		uint32_t numLevels;
+	};
+
+	void ComputeAllowedErrors(const BoundingSpheres& bounds, size_t begin, size_t end);
+	void SelectLevels(const LodSetId* objectLodSets, float deltaTime, size_t begin, size_t end);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	Settings m_Settings;
+
+	std::vector<LodLevel> m_Levels;
+	std::vector<LodSet> m_Sets;
+
+	DirectX::XMFLOAT3 m_EyePosition = { 0.0f, 0.0f, 0.0f };
+	float m_ProjectionScale = 1.0f;
+
+	// Per object (SoA), in the order of the bounding spheres.
+	std::vector<float> m_AllowedErrors;
+	std::vector<LodSetId> m_ObjectSets;
+	std::vector<uint8_t> m_Lods;
+	std::vector<uint8_t> m_PreviousLods;
+	std::vector<float> m_Fades;
+};
@@ -0,0 +1,155 @@
+#include "MappedFile.h"
+
+#include <utility> // std::swap
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(m_Data, other.m_Data);
+		std::swap(m_Size, other.m_Size);
+		std::swap(m_Open, other.m_Open);
+#if defined(_WIN32)
+		std::swap(m_File, other.m_File);
+		std::swap(m_Mapping, other.m_Mapping);
+#endif
+	}
+	return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const char* path, bool sequential)
+{
+	Close();
+
+	const int length = ::MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::vector<wchar_t> widePath(length > 0 ? length : 1, L'\0');
+	::MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+
+	HANDLE file = ::CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(file, &size))
+	{
+		::CloseHandle(file);
+		return false;
+	}
+
+	// Empty files can't be mapped.
+	if (size.QuadPart > 0)
+	{
+		HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void* view = mapping ? ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!view)
+		{
+			if (mapping)
+				::CloseHandle(mapping);
+			::CloseHandle(file);
+			return false;
+		}
+		m_Mapping = mapping;
+		m_Data = static_cast<const uint8_t*>(view);
+		m_Size = size_t(size.QuadPart);
+	}
+
+	m_File = file;
+	m_Open = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+		::UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		::CloseHandle(m_Mapping);
+	if (m_File)
+		::CloseHandle(m_File);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Mapping = nullptr;
+	m_File = nullptr;
+	m_Open = false;
+}
+
+#else
+
+bool MappedFile::Open(const char* path, bool sequential)
+{
+	Close();
+
+	const int file = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (::fstat(file, &status) != 0 || !S_ISREG(status.st_mode))
+	{
+		::close(file);
+		return false;
+	}
+
+	// Empty files can't be mapped.
+	if (status.st_size > 0)
+	{
+		void* view = ::mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (view == MAP_FAILED)
+		{
+			::close(file);
+			return false;
+		}
+		::madvise(view, size_t(status.st_size), sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+		m_Data = static_cast<const uint8_t*>(view);
+		m_Size = size_t(status.st_size);
+	}
+
+	// The mapping keeps the file referenced, the descriptor isn't needed any more.
+	::close(file);
+	m_Open = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+		::munmap(const_cast<uint8_t*>(m_Data), m_Size);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Open = false;
+}
+
+#endif
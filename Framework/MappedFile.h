@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// =====================================================================================
+//										Mapped files
+// =====================================================================================
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile). The file's pages are
+//		the buffer: nothing is read up front, no heap copy exists, and the OS streams the
+//		pages in as they are touched (and can drop them again under memory pressure, they
+//		are backed by the file). Parsers can work on the mapping directly; uploads can copy
+//		from it straight into upload heap memory.
+//
+// The data is not zero terminated and must not be written to.
+class MappedFile
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+
+	// UTF-8 path. False if the file doesn't exist or can't be mapped. An empty file opens
+	//		fine, with GetData() == nullptr.
+	//		"sequential" hints the OS to read ahead aggressively and drop pages behind.
+	bool Open(const char* path, bool sequential = true);
+	void Close();
+
+	bool IsOpen() const { return m_Open; }
+	const uint8_t* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_Open = false;
+#if defined(_WIN32)
+	// File and file mapping HANDLEs - Windows.h stays out of the header.
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
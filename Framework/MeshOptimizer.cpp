@@ -0,0 +1,460 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm> // std::sort, std::min
+#include <cassert>
+#include <cmath>
+#include <cstring>   // std::memcpy
+#include <vector>
+
+using namespace DirectX;
+
+
+namespace
+{
+	constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+	// Forsyth's scoring parameters (from the original article).
+	constexpr int FORSYTH_CACHE_SIZE = 32;
+	constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+	// Valences above this use the last table entry - the boost is tiny by then anyway.
+	constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+
+	// Cache size the overdraw optimizer simulates to find the cluster boundaries.
+	constexpr size_t OVERDRAW_CACHE_SIZE = 16;
+
+	// Score tables, so the inner loop has no pow().
+	struct ForsythScoreTables
+	{
+		float cachePosition[FORSYTH_CACHE_SIZE];
+		float valence[FORSYTH_MAX_VALENCE + 1];
+
+		ForsythScoreTables()
+		{
+			for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+			{
+				// The vertices of the last triangle get a fixed score, so the next triangle
+				//		doesn't simply reuse the same edge over and over (long thin strips).
+				cachePosition[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE :
+					std::pow(1.0f - static_cast<float>(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+			}
+			valence[0] = 0.0f;
+			for (uint32_t i = 1; i <= FORSYTH_MAX_VALENCE; ++i)
+			{
+				valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -FORSYTH_VALENCE_BOOST_POWER);
+			}
+		}
+
+		float GetVertexScore(int cachePosition, uint32_t remainingTriangles) const
+		{
+			// No triangles left: the vertex doesn't matter anymore.
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = cachePosition >= 0 ? this->cachePosition[cachePosition] : 0.0f;
+			return score + valence[std::min(remainingTriangles, FORSYTH_MAX_VALENCE)];
+		}
+	};
+
+	// FIFO cache simulation with timestamps: a vertex is in the cache if fewer than
+	//		"cacheSize" misses happened since it was last transformed.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, size_t cacheSize) :
+			m_Timestamps(vertexCount, 0), m_CacheSize(cacheSize), m_Time(cacheSize + 1)
+		{
+		}
+
+		// Returns true on a miss.
+		bool Access(uint32_t vertex)
+		{
+			if (m_Time - m_Timestamps[vertex] > m_CacheSize)
+			{
+				m_Timestamps[vertex] = m_Time++;
+				return true;
+			}
+			return false;
+		}
+
+		// Evict everything.
+		void Flush() { m_Time += m_CacheSize + 1; }
+
+	private:
+		std::vector<size_t> m_Timestamps;
+		size_t m_CacheSize;
+		size_t m_Time;
+	};
+}
+
+// =====================================================================================
+//									Analysis
+// =====================================================================================
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	size_t cacheSize)
+{
+	assert(indexCount % 3 == 0);
+
+	FifoCache cache(vertexCount, cacheSize);
+	size_t transforms = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < vertexCount);
+		transforms += cache.Access(indices[i]) ? 1 : 0;
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.vertexTransforms = transforms;
+	statistics.acmr = indexCount ? static_cast<float>(transforms) / (indexCount / 3) : 0.0f;
+	statistics.atvr = vertexCount ? static_cast<float>(transforms) / vertexCount : 0.0f;
+	return statistics;
+}
+
+// =====================================================================================
+//									Vertex cache
+// =====================================================================================
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	assert(indexCount % 3 == 0);
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	static const ForsythScoreTables tables;
+
+	// Triangles of every vertex (CSR). The first "remaining[v]" entries of a vertex's range
+	//		are its triangles not emitted yet.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < vertexCount);
+		++remaining[indices[i]];
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScores[v] = tables.GetVertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t bestTriangle = INVALID_INDEX;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > bestScore)
+		{
+			bestScore = triangleScores[t];
+			bestTriangle = static_cast<uint32_t>(t);
+		}
+	}
+
+	// The LRU cache plus room for the 3 vertices pushed in front of it.
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+	int cacheSize = 0;
+
+	std::vector<uint32_t> output(indexCount);
+	size_t searchCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// Nothing useful in the cache: continue with the next triangle in input order.
+		//		(Searching the best triangle of the whole mesh would make this O(n^2).)
+		if (bestTriangle == INVALID_INDEX)
+		{
+			while (emitted[searchCursor])
+				++searchCursor;
+			bestTriangle = static_cast<uint32_t>(searchCursor);
+		}
+
+		const uint32_t* triangle = indices + bestTriangle * 3;
+		output[emittedCount * 3 + 0] = triangle[0];
+		output[emittedCount * 3 + 1] = triangle[1];
+		output[emittedCount * 3 + 2] = triangle[2];
+		emitted[bestTriangle] = true;
+
+		// Remove the triangle from its vertices' lists (once per corner, so degenerate
+		//		triangles work too).
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t v = triangle[corner];
+			uint32_t* list = adjacency.data() + offsets[v];
+			for (uint32_t i = 0; i < remaining[v]; ++i)
+			{
+				if (list[i] == bestTriangle)
+				{
+					list[i] = list[remaining[v] - 1];
+					--remaining[v];
+					break;
+				}
+			}
+		}
+
+		// The triangle's vertices move to the front of the LRU cache.
+		int newCacheSize = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t v = triangle[corner];
+			if (std::find(newCache, newCache + newCacheSize, v) == newCache + newCacheSize)
+				newCache[newCacheSize++] = v;
+		}
+		for (int i = 0; i < cacheSize; ++i)
+		{
+			const uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCacheSize++] = v;
+		}
+
+		// Rescore the cached vertices (and the ones that just fell out), then the
+		//		triangles using them - the best of those is emitted next.
+		for (int i = 0; i < newCacheSize; ++i)
+		{
+			const uint32_t v = newCache[i];
+			cachePositions[v] = i < FORSYTH_CACHE_SIZE ? i : -1;
+			vertexScores[v] = tables.GetVertexScore(cachePositions[v], remaining[v]);
+		}
+
+		bestTriangle = INVALID_INDEX;
+		bestScore = -1.0f;
+		for (int i = 0; i < newCacheSize; ++i)
+		{
+			const uint32_t v = newCache[i];
+			const uint32_t* list = adjacency.data() + offsets[v];
+			for (uint32_t j = 0; j < remaining[v]; ++j)
+			{
+				const uint32_t t = list[j];
+				const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheSize = std::min(newCacheSize, FORSYTH_CACHE_SIZE);
+		std::memcpy(cache, newCache, cacheSize * sizeof(uint32_t));
+	}
+
+	std::memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+// =====================================================================================
+//										Overdraw
+// =====================================================================================
+
+void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions,
+	size_t positionStride, size_t vertexCount, float threshold)
+{
+	assert(indexCount % 3 == 0);
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	auto position = [&](uint32_t v) -> const XMFLOAT3& {
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+	};
+
+	// 1) Hard boundaries: triangles that miss the cache with all 3 vertices start a new
+	//		cluster - the cache is cold there no matter what comes before.
+	std::vector<uint32_t> hardClusters;
+	{
+		FifoCache cache(vertexCount, OVERDRAW_CACHE_SIZE);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			int misses = 0;
+			for (int corner = 0; corner < 3; ++corner)
+				misses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+			if (t == 0 || misses == 3)
+				hardClusters.push_back(static_cast<uint32_t>(t));
+		}
+	}
+	hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+
+	// 2) Soft boundaries: within a hard cluster, start a new cluster as soon as the part
+	//		so far (simulated from a cold cache) is within "threshold" of the cluster's own
+	//		miss ratio. Smaller clusters sort better, the threshold bounds the cost.
+	std::vector<uint32_t> clusters;
+	{
+		FifoCache cache(vertexCount, OVERDRAW_CACHE_SIZE);
+		for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+		{
+			const size_t begin = hardClusters[c], end = hardClusters[c + 1];
+
+			cache.Flush();
+			size_t clusterMisses = 0;
+			for (size_t i = begin * 3; i < end * 3; ++i)
+				clusterMisses += cache.Access(indices[i]) ? 1 : 0;
+			const float target = static_cast<float>(clusterMisses) / (end - begin) * threshold;
+
+			cache.Flush();
+			clusters.push_back(static_cast<uint32_t>(begin));
+			size_t misses = 0, start = begin;
+			for (size_t t = begin; t < end; ++t)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+					misses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+
+				if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= target)
+				{
+					clusters.push_back(static_cast<uint32_t>(t + 1));
+					cache.Flush();
+					misses = 0;
+					start = t + 1;
+				}
+			}
+		}
+	}
+	const size_t clusterCount = clusters.size();
+	clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+	// 3) Area weighted centroid and normal of every cluster and of the whole mesh.
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount), clusterNormals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			const XMVECTOR p0 = XMLoadFloat3(&position(indices[t * 3 + 0]));
+			const XMVECTOR p1 = XMLoadFloat3(&position(indices[t * 3 + 1]));
+			const XMVECTOR p2 = XMLoadFloat3(&position(indices[t * 3 + 2]));
+			// Length = 2 * area, so the sum is an area weighted normal.
+			const XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			const float a = XMVectorGetX(XMVector3Length(n)) * 0.5f;
+			const XMVECTOR triangleCentroid = XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.0f / 3.0f);
+
+			normal = XMVectorAdd(normal, n);
+			centroid = XMVectorAdd(centroid, XMVectorScale(triangleCentroid, a));
+			area += a;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+	if (meshArea > 0.0f)
+		meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+	// 4) Clusters facing away from the mesh center, further out, first: from most view
+	//		directions they are in front of the rest.
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&clusterCentroids[c]), meshCentroid);
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+		order[c] = static_cast<uint32_t>(c);
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return sortKeys[a] > sortKeys[b] || (sortKeys[a] == sortKeys[b] && a < b);
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+	for (uint32_t c : order)
+	{
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	}
+	std::memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+// =====================================================================================
+//									Vertex fetch
+// =====================================================================================
+
+size_t GenerateVertexFetchRemap(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	uint32_t* remap)
+{
+	std::fill(remap, remap + vertexCount, INVALID_INDEX);
+
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < vertexCount);
+		if (remap[indices[i]] == INVALID_INDEX)
+			remap[indices[i]] = next++;
+	}
+	return next;
+}
+
+void RemapVertices(const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap,
+	void* out)
+{
+	const uint8_t* source = static_cast<const uint8_t*>(vertices);
+	uint8_t* destination = static_cast<uint8_t*>(out);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] != INVALID_INDEX)
+			std::memcpy(destination + remap[v] * vertexSize, source + v * vertexSize, vertexSize);
+	}
+}
+
+size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, void* vertices, size_t vertexCount,
+	size_t vertexSize)
+{
+	std::vector<uint32_t> remap(vertexCount);
+	const size_t usedVertices = GenerateVertexFetchRemap(indices, indexCount, vertexCount, remap.data());
+
+	std::vector<uint8_t> reordered(usedVertices * vertexSize);
+	RemapVertices(vertices, vertexCount, vertexSize, remap.data(), reordered.data());
+	std::memcpy(vertices, reordered.data(), reordered.size());
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		indices[i] = remap[indices[i]];
+	}
+	return usedVertices;
+}
+
+// =====================================================================================
+//									Index format
+// =====================================================================================
+
+IndexFormat SelectIndexFormat(size_t vertexCount)
+{
+	// 0xFFFF is left out - it is the strip cut (primitive restart) value of 16 bit indices.
+	return vertexCount <= 0xFFFF ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+void PackIndices(const uint32_t* indices, size_t indexCount, IndexFormat format, void* out)
+{
+	if (format == IndexFormat::UInt32)
+	{
+		std::memcpy(out, indices, indexCount * sizeof(uint32_t));
+		return;
+	}
+
+	uint16_t* out16 = static_cast<uint16_t*>(out);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < 0xFFFF && "Index does not fit the 16 bit format.");
+		out16[i] = static_cast<uint16_t>(indices[i]);
+	}
+}
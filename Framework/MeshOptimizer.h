@@ -0,0 +1,74 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// =====================================================================================
+//									Mesh optimizer
+// =====================================================================================
+
+// Reorders indexed triangle lists for the GPU. The usual order of the passes is
+//		1) OptimizeVertexCache	- triangle order for the post-transform vertex cache,
+//		2) OptimizeOverdraw		- reorders clusters of 1) front to back-ish, keeping most
+//								  of the cache efficiency,
+//		3) OptimizeVertexFetch	- vertex order = first use, so vertex fetches walk memory
+//								  linearly,
+//		4) SelectIndexFormat / PackIndices - 16 bit indices whenever possible.
+// All passes work on 32 bit indices; 3) changes the vertices, 1) and 2) only the indices.
+
+// Vertex cache simulation results.
+struct VertexCacheStatistics
+{
+	// Average cache miss ratio: transformed vertices per triangle (0.5 - 3, lower is better).
+	float acmr;
+	// Average transform to vertex ratio: transformed vertices per vertex (1 is optimal).
+	float atvr;
+	size_t vertexTransforms;
+};
+
+// Simulates a FIFO cache of "cacheSize" entries, like the hardware's post-transform cache.
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	size_t cacheSize = 16);
+
+// Tom Forsyth's linear-speed vertex cache optimization: triangles are emitted greedily by
+//		the score of their vertices - vertices in the (simulated LRU) cache score higher the
+//		more recently they were used, vertices with few remaining triangles get a bonus so
+//		they are finished off instead of left behind. In place, O(triangles).
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Sorts the clusters of a cache optimized index list so outward facing parts of the mesh
+//		come first, which lowers overdraw from most view directions (Sander et al., "Fast
+//		Triangle Reordering for Vertex Locality and Reduced Overdraw").
+//		Clusters end where the cache would be cold anyway, and are split further as long as
+//		the cache miss ratio stays within "threshold" times the original (1.05 = 5% worse).
+void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const DirectX::XMFLOAT3* positions,
+	size_t positionStride, size_t vertexCount, float threshold = 1.05f);
+
+// Reorders the vertices into the order the indices first reference them and rewrites the
+//		indices. "vertices" holds "vertexCount" vertices of "vertexSize" bytes. Unreferenced
+//		vertices are dropped - returns the new vertex count.
+size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, void* vertices, size_t vertexCount,
+	size_t vertexSize);
+
+// Same order as OptimizeVertexFetch as a remap table (old vertex -> new vertex, ~0u for
+//		unused ones), for meshes with several vertex streams. Returns the new vertex count.
+size_t GenerateVertexFetchRemap(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	uint32_t* remap);
+// Apply a remap table to a vertex stream.
+void RemapVertices(const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap,
+	void* out);
+
+// Index buffer formats. 16 bit indices halve the index buffer size and bandwidth.
+enum class IndexFormat : uint8_t
+{
+	UInt16,
+	UInt32,
+};
+
+// 16 bit whenever all vertices are addressable with 16 bits.
+IndexFormat SelectIndexFormat(size_t vertexCount);
+inline size_t GetIndexSize(IndexFormat format) { return format == IndexFormat::UInt16 ? 2 : 4; }
+// Converts the indices to "format", "out" needs indexCount * GetIndexSize(format) bytes.
+void PackIndices(const uint32_t* indices, size_t indexCount, IndexFormat format, void* out);
@@ -0,0 +1,493 @@
+#include "MeshSimplifier.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::sort, std::max
+#include <cassert>
+#include <cfloat>    // FLT_MAX, DBL_MAX
+#include <cmath>
+#include <cstring>   // std::memcpy
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace DirectX;
+
+
+namespace
+{
+	// Border edges of unlocked borders get a plane perpendicular to their triangle, weighted
+	//		this much stronger than the surface, to keep the outline in place.
+	constexpr double BORDER_PLANE_WEIGHT = 10.0;
+
+	// Smallest cosine between a triangle's normal before and after a collapse.
+	constexpr float MIN_NORMAL_DOT = 0.25f;
+
+	enum VertexKind : uint8_t
+	{
+		Manifold,	// free to collapse
+		Border,		// on an open edge - collapses only along the border, if not locked
+		Locked,		// seam, non-manifold or locked border
+	};
+
+	// Symmetric 4x4 matrix of a sum of planes: Q(p) = sum w * (dot(n, p) + d)^2, and the
+	//		sum of the weights - Q(p) / weight is the mean squared distance to the planes.
+	struct Quadric
+	{
+		double a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		void AddPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			a00 += weight * nx * nx; a11 += weight * ny * ny; a22 += weight * nz * nz;
+			a10 += weight * nx * ny; a20 += weight * nx * nz; a21 += weight * ny * nz;
+			b0 += weight * nx * d; b1 += weight * ny * d; b2 += weight * nz * d;
+			c += weight * d * d;
+			this->weight += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22; a10 += q.a10; a20 += q.a20; a21 += q.a21;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		// Weighted mean of the squared distances - a length squared, whatever the weights.
+		double Evaluate(const XMFLOAT3& p) const
+		{
+			if (weight <= 0.0)
+				return 0.0;
+			const double x = p.x, y = p.y, z = p.z;
+			const double result = a00 * x * x + a11 * y * y + a22 * z * z +
+				2.0 * (a10 * x * y + a20 * x * z + a21 * y * z) +
+				2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			// Rounding can make it slightly negative.
+			return result > 0.0 ? result / weight : 0.0;
+		}
+	};
+
+	inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	struct Collapse
+	{
+		uint32_t vertex;	// removed
+		uint32_t target;	// kept
+		float cost;
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const SimplifyMeshInput& input, const SimplifySettings& settings) :
+			m_Input(input), m_Settings(settings)
+		{
+		}
+
+		float Run(std::vector<uint32_t>& outIndices);
+
+	private:
+		const XMFLOAT3& Position(uint32_t v) const
+		{
+			return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(m_Input.positions) + v * m_Input.positionStride);
+		}
+		const float* Attributes(uint32_t v) const
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(m_Input.attributes) + v * m_Input.attributeStride);
+		}
+
+		void ComputeScale();
+		void FindSeams();
+		void ClassifyVertices();
+		void ComputeQuadrics();
+		void BuildAdjacency();
+		double GetCollapseCost(uint32_t vertex, uint32_t target) const;
+		bool CanCollapse(uint32_t vertex, uint32_t target) const;
+		bool FlipsTriangles(uint32_t vertex, uint32_t target) const;
+
+		const SimplifyMeshInput& m_Input;
+		SimplifySettings m_Settings;
+
+		float m_Scale = 1.0f;
+		std::vector<uint32_t> m_Indices;
+		std::vector<Quadric> m_Quadrics;
+		std::vector<uint8_t> m_Kinds;
+		std::vector<bool> m_Seams;
+		std::unordered_set<uint64_t> m_BorderEdges;
+		std::vector<uint32_t> m_Remap;
+		std::vector<bool> m_PassLocked;
+		// Vertex -> triangles at the start of the pass (CSR).
+		std::vector<uint32_t> m_AdjacencyOffsets;
+		std::vector<uint32_t> m_Adjacency;
+	};
+
+	void Simplifier::ComputeScale()
+	{
+		XMFLOAT3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t v = 0; v < m_Input.vertexCount; ++v)
+		{
+			const XMFLOAT3& p = Position(static_cast<uint32_t>(v));
+			lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+			lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+			lo.z = std::min(lo.z, p.z); hi.z = std::max(hi.z, p.z);
+		}
+		m_Scale = std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z);
+		if (!(m_Scale > 0.0f))
+			m_Scale = 1.0f;
+	}
+
+	// Vertices sharing their position with another vertex sit on an attribute seam (UV,
+	//		normal or material split). Collapsing them would tear the seam open.
+	void Simplifier::FindSeams()
+	{
+		m_Seams.assign(m_Input.vertexCount, false);
+
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				uint32_t bits[3];
+				std::memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+			{
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}
+		};
+
+		std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> firstVertex;
+		firstVertex.reserve(m_Input.vertexCount);
+		for (size_t v = 0; v < m_Input.vertexCount; ++v)
+		{
+			auto result = firstVertex.emplace(Position(static_cast<uint32_t>(v)), static_cast<uint32_t>(v));
+			if (!result.second)
+			{
+				m_Seams[v] = true;
+				m_Seams[result.first->second] = true;
+			}
+		}
+	}
+
+	// Per pass - collapses turn interior edges into border edges and back.
+	void Simplifier::ClassifyVertices()
+	{
+		// Directed edge counts: an edge without its opposite is a border, a directed edge
+		//		used twice (or an edge with more than two triangles) is non-manifold.
+		std::unordered_map<uint64_t, uint32_t> edges;
+		edges.reserve(m_Indices.size());
+		for (size_t i = 0; i < m_Indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+				++edges[EdgeKey(m_Indices[i + e], m_Indices[i + (e + 1) % 3])];
+		}
+
+		m_Kinds.assign(m_Input.vertexCount, Manifold);
+		m_BorderEdges.clear();
+		for (const auto& edge : edges)
+		{
+			const uint32_t a = static_cast<uint32_t>(edge.first >> 32);
+			const uint32_t b = static_cast<uint32_t>(edge.first & 0xFFFFFFFFu);
+			auto opposite = edges.find(EdgeKey(b, a));
+			const uint32_t oppositeCount = opposite != edges.end() ? opposite->second : 0;
+
+			if (edge.second > 1 || oppositeCount > 1)
+			{
+				m_Kinds[a] = m_Kinds[b] = Locked;
+			}
+			else if (oppositeCount == 0)
+			{
+				m_BorderEdges.insert(EdgeKey(a, b));
+				m_BorderEdges.insert(EdgeKey(b, a));
+				const uint8_t kind = m_Settings.lockBorder ? Locked : Border;
+				m_Kinds[a] = std::max(m_Kinds[a], kind);
+				m_Kinds[b] = std::max(m_Kinds[b], kind);
+			}
+		}
+
+		for (size_t v = 0; v < m_Input.vertexCount; ++v)
+		{
+			if (m_Seams[v])
+				m_Kinds[v] = Locked;
+		}
+	}
+
+	void Simplifier::ComputeQuadrics()
+	{
+		m_Quadrics.assign(m_Input.vertexCount, Quadric());
+
+		for (size_t i = 0; i < m_Indices.size(); i += 3)
+		{
+			const uint32_t v[3] = { m_Indices[i], m_Indices[i + 1], m_Indices[i + 2] };
+			const XMVECTOR p0 = XMLoadFloat3(&Position(v[0]));
+			const XMVECTOR p1 = XMLoadFloat3(&Position(v[1]));
+			const XMVECTOR p2 = XMLoadFloat3(&Position(v[2]));
+			const XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			const float length = XMVectorGetX(XMVector3Length(cross));
+			if (length <= 0.0f)
+				continue;
+
+			// Plane weighted by the triangle area.
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, XMVectorScale(cross, 1.0f / length));
+			const double d = -(n.x * Position(v[0]).x + n.y * Position(v[0]).y + n.z * Position(v[0]).z);
+			const double area = length * 0.5;
+			for (int corner = 0; corner < 3; ++corner)
+				m_Quadrics[v[corner]].AddPlane(n.x, n.y, n.z, d, area);
+
+			// Border edges: a plane through the edge, perpendicular to the triangle.
+			if (m_Settings.lockBorder)
+				continue;
+			for (int e = 0; e < 3; ++e)
+			{
+				const uint32_t a = v[e], b = v[(e + 1) % 3];
+				if (!m_BorderEdges.count(EdgeKey(a, b)))
+					continue;
+				const XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&Position(b)), XMLoadFloat3(&Position(a)));
+				const float edgeLengthSq = XMVectorGetX(XMVector3LengthSq(edge));
+				XMFLOAT3 m;
+				XMStoreFloat3(&m, XMVector3Normalize(XMVector3Cross(edge, XMLoadFloat3(&n))));
+				const double md = -(m.x * Position(a).x + m.y * Position(a).y + m.z * Position(a).z);
+				m_Quadrics[a].AddPlane(m.x, m.y, m.z, md, edgeLengthSq * BORDER_PLANE_WEIGHT);
+				m_Quadrics[b].AddPlane(m.x, m.y, m.z, md, edgeLengthSq * BORDER_PLANE_WEIGHT);
+			}
+		}
+	}
+
+	void Simplifier::BuildAdjacency()
+	{
+		m_AdjacencyOffsets.assign(m_Input.vertexCount + 1, 0);
+		for (uint32_t index : m_Indices)
+			++m_AdjacencyOffsets[index + 1];
+		for (size_t v = 0; v < m_Input.vertexCount; ++v)
+			m_AdjacencyOffsets[v + 1] += m_AdjacencyOffsets[v];
+
+		m_Adjacency.resize(m_Indices.size());
+		std::vector<uint32_t> cursor(m_AdjacencyOffsets.begin(), m_AdjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < m_Indices.size(); ++i)
+			m_Adjacency[cursor[m_Indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	bool Simplifier::CanCollapse(uint32_t vertex, uint32_t target) const
+	{
+		switch (m_Kinds[vertex])
+		{
+		case Manifold:
+			return true;
+		case Border:
+			// Only along the border, or the border would be pulled inwards.
+			return m_BorderEdges.count(EdgeKey(vertex, target)) != 0;
+		default:
+			return false;
+		}
+	}
+
+	double Simplifier::GetCollapseCost(uint32_t vertex, uint32_t target) const
+	{
+		Quadric q = m_Quadrics[vertex];
+		q.Add(m_Quadrics[target]);
+		// Relative to the mesh extent, so the same mesh at any scale collapses the same way.
+		const double scale = m_Scale;
+		double cost = q.Evaluate(Position(target)) / (scale * scale);
+
+		if (m_Input.attributes)
+		{
+			// Attribute differences count like distances relative to the mesh extent.
+			const float* a = Attributes(vertex);
+			const float* b = Attributes(target);
+			double attributeError = 0.0;
+			for (size_t k = 0; k < m_Input.attributeCount; ++k)
+			{
+				const double difference = a[k] - b[k];
+				attributeError += m_Input.attributeWeights[k] * difference * difference;
+			}
+			cost += attributeError;
+		}
+		return cost;
+	}
+
+	// Moving "vertex" onto "target" must not turn any of its remaining triangles over.
+	bool Simplifier::FlipsTriangles(uint32_t vertex, uint32_t target) const
+	{
+		const XMVECTOR targetPosition = XMLoadFloat3(&Position(target));
+		for (uint32_t i = m_AdjacencyOffsets[vertex]; i < m_AdjacencyOffsets[vertex + 1]; ++i)
+		{
+			const uint32_t t = m_Adjacency[i];
+			uint32_t v[3] = { m_Remap[m_Indices[t * 3]], m_Remap[m_Indices[t * 3 + 1]], m_Remap[m_Indices[t * 3 + 2]] };
+
+			// Triangles containing both vertices disappear; degenerate ones don't matter.
+			if (v[0] == target || v[1] == target || v[2] == target)
+				continue;
+			if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+				continue;
+
+			XMVECTOR p[3], q[3];
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				p[corner] = XMLoadFloat3(&Position(v[corner]));
+				q[corner] = v[corner] == vertex ? targetPosition : p[corner];
+			}
+			const XMVECTOR before = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+			const XMVECTOR after = XMVector3Cross(XMVectorSubtract(q[1], q[0]), XMVectorSubtract(q[2], q[0]));
+			// Rejects normals turning by more than ~75 degrees - not only actual flips, sliver
+			//		triangles on the edge of flipping too.
+			const float dot = XMVectorGetX(XMVector3Dot(before, after));
+			const float lengths = std::sqrt(XMVectorGetX(XMVector3LengthSq(before)) * XMVectorGetX(XMVector3LengthSq(after)));
+			if (dot <= MIN_NORMAL_DOT * lengths)
+				return true;
+		}
+		return false;
+	}
+
+	float Simplifier::Run(std::vector<uint32_t>& outIndices)
+	{
+		m_Indices.assign(m_Input.indices, m_Input.indices + m_Input.indexCount);
+		const size_t targetIndexCount = static_cast<size_t>(m_Input.indexCount / 3 * m_Settings.targetRatio) * 3;
+
+		ComputeScale();
+		FindSeams();
+		ClassifyVertices();
+		ComputeQuadrics();
+
+		// Costs are squared errors relative to the mesh extent.
+		const double maxCost = static_cast<double>(m_Settings.maxError) * m_Settings.maxError;
+		double resultCost = 0.0;
+
+		m_Remap.resize(m_Input.vertexCount);
+		std::vector<Collapse> collapses;
+		while (m_Indices.size() > targetIndexCount)
+		{
+			for (size_t v = 0; v < m_Input.vertexCount; ++v)
+				m_Remap[v] = static_cast<uint32_t>(v);
+			m_PassLocked.assign(m_Input.vertexCount, false);
+			BuildAdjacency();
+
+			// Score every edge in the cheaper of its two directions.
+			collapses.clear();
+			for (size_t i = 0; i < m_Indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint32_t a = m_Indices[i + e], b = m_Indices[i + (e + 1) % 3];
+					// Interior edges are seen from both triangles - score them once.
+					if (a > b && !m_BorderEdges.count(EdgeKey(a, b)))
+						continue;
+
+					const bool ab = CanCollapse(a, b), ba = CanCollapse(b, a);
+					if (!ab && !ba)
+						continue;
+					const double costAB = ab ? GetCollapseCost(a, b) : DBL_MAX;
+					const double costBA = ba ? GetCollapseCost(b, a) : DBL_MAX;
+					if (costAB <= costBA)
+						collapses.push_back({ a, b, static_cast<float>(costAB) });
+					else
+						collapses.push_back({ b, a, static_cast<float>(costBA) });
+				}
+			}
+			// Ties broken by vertex - deterministic across standard libraries.
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+				if (x.cost != y.cost)
+					return x.cost < y.cost;
+				if (x.vertex != y.vertex)
+					return x.vertex < y.vertex;
+				return x.target < y.target;
+			});
+
+			// An interior collapse removes 2 triangles - stop the pass about at the target.
+			const size_t triangleCount = m_Indices.size() / 3;
+			const size_t collapseLimit = (triangleCount - targetIndexCount / 3) / 2 + 1;
+			size_t collapsed = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.cost > maxCost || collapsed >= collapseLimit)
+					break;
+				if (m_PassLocked[collapse.vertex] || m_PassLocked[collapse.target])
+					continue;
+				if (FlipsTriangles(collapse.vertex, collapse.target))
+					continue;
+
+				m_Remap[collapse.vertex] = collapse.target;
+				m_Quadrics[collapse.target].Add(m_Quadrics[collapse.vertex]);
+				m_PassLocked[collapse.vertex] = m_PassLocked[collapse.target] = true;
+				resultCost = std::max(resultCost, static_cast<double>(collapse.cost));
+				++collapsed;
+			}
+			if (collapsed == 0)
+				break;
+
+			// Apply the pass and drop the triangles that collapsed.
+			size_t write = 0;
+			for (size_t i = 0; i < m_Indices.size(); i += 3)
+			{
+				const uint32_t a = m_Remap[m_Indices[i]], b = m_Remap[m_Indices[i + 1]], c = m_Remap[m_Indices[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+				m_Indices[write++] = a;
+				m_Indices[write++] = b;
+				m_Indices[write++] = c;
+			}
+			m_Indices.resize(write);
+
+			ClassifyVertices();
+		}
+
+		outIndices.swap(m_Indices);
+		return static_cast<float>(std::sqrt(resultCost) * m_Scale);
+	}
+}
+
+// =====================================================================================
+//										Simplify
+// =====================================================================================
+
+float SimplifyMesh(const SimplifyMeshInput& input, const SimplifySettings& settings,
+	std::vector<uint32_t>& outIndices)
+{
+	assert(input.indexCount % 3 == 0);
+	assert(!input.attributes || input.attributeWeights);
+
+	Simplifier simplifier(input, settings);
+	return simplifier.Run(outIndices);
+}
+
+void GenerateLodChains(const SimplifyMeshInput* meshes, size_t numMeshes, const float* ratios, size_t numRatios,
+	const SimplifySettings& settings, std::vector<SimplifiedLod>* outChains, TaskScheduler* scheduler)
+{
+	for (size_t m = 0; m < numMeshes; ++m)
+	{
+		outChains[m].resize(numRatios + 1);
+		outChains[m][0].indices.assign(meshes[m].indices, meshes[m].indices + meshes[m].indexCount);
+		outChains[m][0].error = 0.0f;
+	}
+
+	// One job per (mesh, level).
+	auto simplify = [&](size_t begin, size_t end) {
+		for (size_t job = begin; job < end; ++job)
+		{
+			const size_t mesh = job / numRatios, level = job % numRatios;
+			SimplifySettings levelSettings = settings;
+			levelSettings.targetRatio = ratios[level];
+			SimplifiedLod& lod = outChains[mesh][level + 1];
+			lod.error = SimplifyMesh(meshes[mesh], levelSettings, lod.indices);
+		}
+	};
+	const size_t numJobs = numMeshes * numRatios;
+	if (scheduler && numJobs > 1)
+		scheduler->ParallelFor(0, numJobs, 1, simplify);
+	else
+		simplify(0, numJobs);
+
+	// A coarser level can't claim to be more accurate than a finer one.
+	for (size_t m = 0; m < numMeshes; ++m)
+	{
+		for (size_t level = 1; level < outChains[m].size(); ++level)
+			outChains[m][level].error = std::max(outChains[m][level].error, outChains[m][level - 1].error);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Mesh simplifier
+// =====================================================================================
+
+// The mesh to simplify. Attributes (normals, UVs, colors, ...) are optional: "attributeCount"
+//		floats per vertex, "attributeStride" bytes apart, each with a weight - a weight of 1
+//		makes an attribute difference of 1 cost as much as moving the surface by the mesh
+//		extent.
+struct SimplifyMeshInput
+{
+	const uint32_t* indices = nullptr;
+	size_t indexCount = 0;
+
+	const DirectX::XMFLOAT3* positions = nullptr;
+	size_t positionStride = sizeof(DirectX::XMFLOAT3);
+	size_t vertexCount = 0;
+
+	const float* attributes = nullptr;
+	size_t attributeStride = 0;
+	const float* attributeWeights = nullptr;
+	size_t attributeCount = 0;
+};
+
+struct SimplifySettings
+{
+	// Target triangle count as a fraction of the input.
+	float targetRatio = 0.5f;
+	// Stop before the error exceeds this, relative to the mesh extent (0.01 = 1%).
+	float maxError = 0.01f;
+	// Keep open borders (holes, mesh boundaries) exactly. Otherwise border vertices may
+	//		slide along the border.
+	bool lockBorder = true;
+};
+
+// Quadric error metric simplification (Garland & Heckbert) by half-edge collapses: a
+//		vertex collapses onto a neighbour, so the result is a new index buffer over the
+//		same vertex buffer - every LOD of a chain shares the vertices.
+//
+// Every vertex accumulates the (area weighted) planes of its triangles in a quadric, the
+//		cost of moving it is the weighted mean of the squared distances to those planes,
+//		relative to the mesh extent - the same mesh at any scale simplifies the same way. Collapses are
+//		done in passes: all edges are scored and sorted, then collapsed cheapest first,
+//		skipping those that would flip a triangle or touch a vertex that already changed
+//		in this pass.
+//
+// Vertices are never collapsed if they are on an attribute seam (several vertices with
+//		the same position), on a non-manifold edge, or - with lockBorder - on a border.
+//
+// Writes the new triangle list to "outIndices" and returns the error reached, in mesh
+//		units - usable as LodLevel::geometricError.
+float SimplifyMesh(const SimplifyMeshInput& input, const SimplifySettings& settings,
+	std::vector<uint32_t>& outIndices);
+
+// One level of a LOD chain: index buffer over the original vertices and its error.
+struct SimplifiedLod
+{
+	std::vector<uint32_t> indices;
+	float error;
+};
+
+// Generates a LOD chain for each of "numMeshes" meshes: level 0 is the input itself,
+//		level i the mesh simplified to ratios[i - 1] of its triangles (ratios decreasing).
+//		Every level is simplified from the full mesh, so all (mesh, level) pairs are
+//		independent and run in parallel with a scheduler. Errors are made non-decreasing
+//		along the chain, as LodSelector expects.
+void GenerateLodChains(const SimplifyMeshInput* meshes, size_t numMeshes, const float* ratios, size_t numRatios,
+	const SimplifySettings& settings, std::vector<SimplifiedLod>* outChains, TaskScheduler* scheduler = nullptr);
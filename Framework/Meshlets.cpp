@@ -0,0 +1,285 @@
+#include "Meshlets.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::min, std::max
+#include <cassert>
+#include <cmath>
+#include <cstring>   // std::memcpy
+
+using namespace DirectX;
+
+
+namespace
+{
+	// Triangles per partitioning task. Fixed - the chunk boundaries end meshlets, so they
+	//		must not depend on the thread count.
+	constexpr size_t TRIANGLES_PER_CHUNK = 16384;
+	// Meshlets per bounds task.
+	constexpr size_t BOUNDS_GRAIN_SIZE = 256;
+
+	// Normal cones wider than this (minimum dot between the axis and a normal) can't be
+	//		culled from any position worth testing.
+	constexpr float MIN_CONE_DOT = 0.1f;
+
+	struct MeshletChunk
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> vertices;
+		std::vector<uint32_t> triangles;
+	};
+
+	// Greedy partitioning of triangles [firstTriangle, lastTriangle). Offsets are relative
+	//		to the chunk.
+	void PartitionChunk(const uint32_t* indices, size_t firstTriangle, size_t lastTriangle, MeshletChunk& chunk)
+	{
+		Meshlet meshlet = { 0, 0, 0, 0 };
+
+		for (size_t t = firstTriangle; t < lastTriangle; ++t)
+		{
+			const uint32_t* triangle = indices + t * 3;
+			const uint32_t* meshletVertices = chunk.vertices.data() + meshlet.vertexOffset;
+
+			// Local index of every corner, or ~0u for vertices new to the meshlet. A linear
+			//		search over at most 64 vertices beats a mesh sized lookup table per thread.
+			uint32_t local[3];
+			uint32_t newVertices = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				local[corner] = ~0u;
+				for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+				{
+					if (meshletVertices[i] == triangle[corner])
+					{
+						local[corner] = i;
+						break;
+					}
+				}
+				// Repeated corners of a degenerate triangle only count once.
+				if (local[corner] == ~0u && !(corner > 0 && triangle[corner] == triangle[0]) &&
+					!(corner > 1 && triangle[corner] == triangle[1]))
+				{
+					++newVertices;
+				}
+			}
+
+			if (meshlet.vertexCount + newVertices > MAX_MESHLET_VERTICES ||
+				meshlet.triangleCount + 1 > MAX_MESHLET_TRIANGLES)
+			{
+				chunk.meshlets.push_back(meshlet);
+				meshlet.vertexOffset = static_cast<uint32_t>(chunk.vertices.size());
+				meshlet.triangleOffset = static_cast<uint32_t>(chunk.triangles.size());
+				meshlet.vertexCount = 0;
+				meshlet.triangleCount = 0;
+				local[0] = local[1] = local[2] = ~0u;
+			}
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (local[corner] != ~0u)
+					continue;
+				// Earlier corner of the same triangle, just added?
+				for (int previous = 0; previous < corner; ++previous)
+				{
+					if (triangle[previous] == triangle[corner])
+						local[corner] = local[previous];
+				}
+				if (local[corner] == ~0u)
+				{
+					local[corner] = meshlet.vertexCount++;
+					chunk.vertices.push_back(triangle[corner]);
+				}
+			}
+
+			chunk.triangles.push_back(local[0] | (local[1] << 8) | (local[2] << 16));
+			++meshlet.triangleCount;
+		}
+
+		if (meshlet.triangleCount)
+			chunk.meshlets.push_back(meshlet);
+	}
+}
+
+// =====================================================================================
+//										Bounds
+// =====================================================================================
+
+void MeshletBounds::Resize(size_t meshletCount)
+{
+	count = meshletCount;
+	data.resize(StreamCount * meshletCount);
+}
+
+bool MeshletBounds::IsBackfacing(size_t meshlet, const XMFLOAT3& eye) const
+{
+	const float dx = GetStream(ConeApexX)[meshlet] - eye.x;
+	const float dy = GetStream(ConeApexY)[meshlet] - eye.y;
+	const float dz = GetStream(ConeApexZ)[meshlet] - eye.z;
+	const float d = dx * GetStream(ConeAxisX)[meshlet] + dy * GetStream(ConeAxisY)[meshlet] + dz * GetStream(ConeAxisZ)[meshlet];
+	// dot(normalize(apex - eye), axis) >= cutoff without the division.
+	return d >= GetStream(ConeCutoff)[meshlet] * std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+namespace
+{
+	void ComputeMeshletBounds(const MeshletMesh& mesh, const XMFLOAT3* positions, size_t positionStride,
+		size_t meshletIndex, MeshletBounds& bounds)
+	{
+		auto position = [&](uint32_t v) {
+			return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride));
+		};
+
+		const Meshlet& meshlet = mesh.meshlets[meshletIndex];
+		const uint32_t* vertices = mesh.vertices.data() + meshlet.vertexOffset;
+		const uint32_t* triangles = mesh.triangles.data() + meshlet.triangleOffset;
+
+		// Sphere around the center of the bounding box.
+		XMVECTOR lo = position(vertices[0]), hi = lo;
+		for (uint32_t i = 1; i < meshlet.vertexCount; ++i)
+		{
+			lo = XMVectorMin(lo, position(vertices[i]));
+			hi = XMVectorMax(hi, position(vertices[i]));
+		}
+		const XMVECTOR center = XMVectorScale(XMVectorAdd(lo, hi), 0.5f);
+		float radiusSq = 0.0f;
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(position(vertices[i]), center))));
+		}
+
+		// Normal cone: the axis is the average triangle normal, the cutoff comes from the
+		//		normal furthest from it.
+		XMVECTOR normals[MAX_MESHLET_TRIANGLES];
+		bool valid[MAX_MESHLET_TRIANGLES];
+		XMVECTOR axis = XMVectorZero();
+		for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+		{
+			const uint32_t packed = triangles[t];
+			const XMVECTOR p0 = position(vertices[packed & 0xFF]);
+			const XMVECTOR p1 = position(vertices[(packed >> 8) & 0xFF]);
+			const XMVECTOR p2 = position(vertices[(packed >> 16) & 0xFF]);
+			const XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			// Degenerate triangles have no facing - skip them.
+			valid[t] = XMVectorGetX(XMVector3LengthSq(n)) > 0.0f;
+			normals[t] = XMVector3Normalize(n);
+			if (valid[t])
+				axis = XMVectorAdd(axis, normals[t]);
+		}
+		axis = XMVector3Normalize(axis);
+
+		float minDot = 1.0f;
+		for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+		{
+			if (valid[t])
+				minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, normals[t])));
+		}
+
+		// The cone apex: the point on the axis behind every triangle's plane, so the test
+		//		stays conservative for cameras close to the meshlet.
+		float cutoff = 1.0f;
+		float apexDistance = 0.0f;
+		if (minDot > MIN_CONE_DOT && XMVectorGetX(XMVector3LengthSq(axis)) > 0.0f)
+		{
+			// Backfacing for all triangles: the view direction is within 90 - acos(minDot)
+			//		degrees of the axis, i.e. dot(view, axis) >= sin(acos(minDot)).
+			cutoff = std::sqrt(1.0f - minDot * minDot);
+			for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+			{
+				if (!valid[t])
+					continue;
+				const XMVECTOR p0 = position(vertices[triangles[t] & 0xFF]);
+				const float dc = XMVectorGetX(XMVector3Dot(normals[t], axis));
+				const float distance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), normals[t])) / dc;
+				apexDistance = std::max(apexDistance, distance);
+			}
+		}
+		const XMVECTOR apex = XMVectorSubtract(center, XMVectorScale(axis, apexDistance));
+
+		XMFLOAT3 c, a, p;
+		XMStoreFloat3(&c, center);
+		XMStoreFloat3(&a, axis);
+		XMStoreFloat3(&p, apex);
+		bounds.GetStream(MeshletBounds::CenterX)[meshletIndex] = c.x;
+		bounds.GetStream(MeshletBounds::CenterY)[meshletIndex] = c.y;
+		bounds.GetStream(MeshletBounds::CenterZ)[meshletIndex] = c.z;
+		bounds.GetStream(MeshletBounds::Radius)[meshletIndex] = std::sqrt(radiusSq);
+		bounds.GetStream(MeshletBounds::ConeAxisX)[meshletIndex] = a.x;
+		bounds.GetStream(MeshletBounds::ConeAxisY)[meshletIndex] = a.y;
+		bounds.GetStream(MeshletBounds::ConeAxisZ)[meshletIndex] = a.z;
+		bounds.GetStream(MeshletBounds::ConeCutoff)[meshletIndex] = cutoff;
+		bounds.GetStream(MeshletBounds::ConeApexX)[meshletIndex] = p.x;
+		bounds.GetStream(MeshletBounds::ConeApexY)[meshletIndex] = p.y;
+		bounds.GetStream(MeshletBounds::ConeApexZ)[meshletIndex] = p.z;
+	}
+}
+
+// =====================================================================================
+//										Build
+// =====================================================================================
+
+void BuildMeshlets(const uint32_t* indices, size_t indexCount, const XMFLOAT3* positions,
+	size_t positionStride, size_t vertexCount, MeshletMesh& out, TaskScheduler* scheduler)
+{
+	assert(indexCount % 3 == 0);
+	(void)vertexCount;
+#ifndef NDEBUG
+	for (size_t i = 0; i < indexCount; ++i)
+		assert(indices[i] < vertexCount);
+#endif
+
+	out.meshlets.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+
+	// 1) Partition every chunk.
+	const size_t triangleCount = indexCount / 3;
+	const size_t numChunks = (triangleCount + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK;
+	std::vector<MeshletChunk> chunks(numChunks);
+	auto partition = [&](size_t firstChunk, size_t lastChunk) {
+		for (size_t c = firstChunk; c < lastChunk; ++c)
+		{
+			PartitionChunk(indices, c * TRIANGLES_PER_CHUNK, std::min(triangleCount, (c + 1) * TRIANGLES_PER_CHUNK), chunks[c]);
+		}
+	};
+	if (scheduler && numChunks > 1)
+		scheduler->ParallelFor(0, numChunks, 1, partition);
+	else
+		partition(0, numChunks);
+
+	// 2) Concatenate in chunk order.
+	size_t numMeshlets = 0, numVertices = 0, numTriangles = 0;
+	for (const MeshletChunk& chunk : chunks)
+	{
+		numMeshlets += chunk.meshlets.size();
+		numVertices += chunk.vertices.size();
+		numTriangles += chunk.triangles.size();
+	}
+	out.meshlets.reserve(numMeshlets);
+	out.vertices.reserve(numVertices);
+	out.triangles.reserve(numTriangles);
+	for (const MeshletChunk& chunk : chunks)
+	{
+		const uint32_t vertexBase = static_cast<uint32_t>(out.vertices.size());
+		const uint32_t triangleBase = static_cast<uint32_t>(out.triangles.size());
+		for (Meshlet meshlet : chunk.meshlets)
+		{
+			meshlet.vertexOffset += vertexBase;
+			meshlet.triangleOffset += triangleBase;
+			out.meshlets.push_back(meshlet);
+		}
+		out.vertices.insert(out.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+		out.triangles.insert(out.triangles.end(), chunk.triangles.begin(), chunk.triangles.end());
+	}
+
+	// 3) Bounds.
+	out.bounds.Resize(numMeshlets);
+	auto computeBounds = [&](size_t begin, size_t end) {
+		for (size_t m = begin; m < end; ++m)
+		{
+			ComputeMeshletBounds(out, positions, positionStride, m, out.bounds);
+		}
+	};
+	if (scheduler && numMeshlets > BOUNDS_GRAIN_SIZE)
+		scheduler->ParallelFor(0, numMeshlets, BOUNDS_GRAIN_SIZE, computeBounds);
+	else
+		computeBounds(0, numMeshlets);
+}
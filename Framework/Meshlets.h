@@ -0,0 +1,85 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//										Meshlets
+// =====================================================================================
+
+// Limits of one meshlet - 64 vertices and 124 triangles fit the mesh shader output limits
+//		(256 vertices / 256 primitives) comfortably and keep the per meshlet vertex data in
+//		one 64 lane wave (or two 32 lane waves).
+constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+// A cluster of triangles: meshlet vertices [vertexOffset, vertexOffset + vertexCount) of
+//		MeshletMesh::vertices, triangles [triangleOffset, triangleOffset + triangleCount) of
+//		MeshletMesh::triangles.
+struct Meshlet
+{
+	uint32_t vertexOffset;
+	uint32_t triangleOffset;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+static_assert(sizeof(Meshlet) == 16, "Meshlet is uploaded as is.");
+
+// Culling data of all meshlets, structure-of-arrays: StreamCount float streams of
+//		GetCount() values, back to back in one array, so it uploads with a single
+//		UpdateBufferResource(..., data.size(), sizeof(float), data.data()).
+//
+// Per meshlet:
+//		- bounding sphere (center, radius) for frustum / occlusion culling,
+//		- normal cone (axis, cutoff, apex) for backface culling of the whole cluster:
+//		  all triangles face away from a camera at "eye" if
+//				dot(normalize(apex - eye), axis) >= cutoff
+//		  A cutoff of 1 (or more) means the normals spread too far - never culled.
+struct MeshletBounds
+{
+	enum Stream
+	{
+		CenterX = 0, CenterY, CenterZ, Radius,
+		ConeAxisX, ConeAxisY, ConeAxisZ, ConeCutoff,
+		ConeApexX, ConeApexY, ConeApexZ,
+		StreamCount
+	};
+
+	std::vector<float> data;
+	size_t count = 0;
+
+	void Resize(size_t meshletCount);
+	size_t GetCount() const { return count; }
+	float* GetStream(Stream stream) { return data.data() + stream * count; }
+	const float* GetStream(Stream stream) const { return data.data() + stream * count; }
+
+	bool IsBackfacing(size_t meshlet, const DirectX::XMFLOAT3& eye) const;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> meshlets;
+	// Meshlet vertex -> mesh vertex.
+	std::vector<uint32_t> vertices;
+	// One entry per triangle: 3 local (meshlet) vertex indices, 8 bits each (x | y << 8 | z << 16).
+	std::vector<uint32_t> triangles;
+	MeshletBounds bounds;
+};
+
+// Partitions an indexed triangle list into meshlets.
+//
+// Triangles are added in index buffer order to the current meshlet until the next one
+//		doesn't fit. That relies on the input having vertex locality - run
+//		OptimizeVertexCache first, its triangle order is what makes meshlets full.
+//
+// With a scheduler the index buffer is split in fixed size chunks that are partitioned in
+//		parallel and concatenated in order; chunk boundaries don't depend on the number of
+//		threads, so the output is identical with or without a scheduler. The bounds are
+//		computed in parallel as well.
+void BuildMeshlets(const uint32_t* indices, size_t indexCount, const DirectX::XMFLOAT3* positions,
+	size_t positionStride, size_t vertexCount, MeshletMesh& out, TaskScheduler* scheduler = nullptr);
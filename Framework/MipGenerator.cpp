@@ -0,0 +1,224 @@
+#include "MipGenerator.h"
+
+#include "../Helpers/d3dx12.h"
+#include "../Helpers/Helpers.h"
+
+#include <algorithm> // std::max
+#include <cassert>
+#include <vector>
+
+
+namespace
+{
+	// Root parameters - matches Shaders/GenerateMips_CS.hlsl.
+	enum RootParameter
+	{
+		ROOT_MIP_CONSTANTS,		// b0: MipConstants
+		ROOT_MIP_VIEWS,			// t0 + u0: source mip SRV, destination mip UAV
+		ROOT_PARAMETER_COUNT,
+	};
+
+	struct MipConstants
+	{
+		UINT32 srcWidth;
+		UINT32 srcHeight;
+		UINT32 dstWidth;
+		UINT32 dstHeight;
+		UINT32 isSRGB;
+	};
+
+	constexpr UINT MIP_THREAD_GROUP_SIZE = 8;
+}
+
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+MipGenerator::MipGenerator(ComPtr<ID3D12Device2> device, std::shared_ptr<CommandQueue> computeQueue, ShaderCache& shaderCache) :
+	m_Device(device),
+	m_ComputeQueue(computeQueue)
+{
+	ShaderDesc computeShaderDesc;
+	computeShaderDesc.path = "Shaders/GenerateMips_CS.hlsl";
+	computeShaderDesc.stage = ShaderStage::Compute;
+	ShaderBytecode computeShader = shaderCache.GetShader(computeShaderDesc);
+
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+	featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	if (FAILED(m_Device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+	{
+		featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	}
+
+	// The source mip is read with Load, no sampler needed.
+	CD3DX12_DESCRIPTOR_RANGE1 ranges[2];
+	ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+
+	CD3DX12_ROOT_PARAMETER1 rootParameters[ROOT_PARAMETER_COUNT];
+	rootParameters[ROOT_MIP_CONSTANTS].InitAsConstants(sizeof(MipConstants) / 4, 0);
+	rootParameters[ROOT_MIP_VIEWS].InitAsDescriptorTable(_countof(ranges), ranges);
+
+	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
+	rootSignatureDescription.Init_1_1(_countof(rootParameters), rootParameters);
+
+	ComPtr<ID3DBlob> rootSignatureBlob;
+	ComPtr<ID3DBlob> errorBlob;
+	ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDescription,
+		featureData.HighestVersion, &rootSignatureBlob, &errorBlob));
+	ThrowIfFailed(m_Device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(),
+		rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&m_RootSignature)));
+
+	struct PipelineStateStream
+	{
+		CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+		CD3DX12_PIPELINE_STATE_STREAM_CS CS;
+	} pipelineStateStream;
+	pipelineStateStream.pRootSignature = m_RootSignature.Get();
+	pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShader->data(), computeShader->size());
+
+	D3D12_PIPELINE_STATE_STREAM_DESC pipelineStateStreamDesc = {
+		sizeof(PipelineStateStream), &pipelineStateStream
+	};
+	ThrowIfFailed(m_Device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = DESCRIPTOR_CAPACITY;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(m_Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_DescriptorHeap)));
+	m_DescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+// =====================================================================================
+//										Descriptors
+// =====================================================================================
+
+UINT MipGenerator::AllocateDescriptors(UINT count)
+{
+	assert(count <= DESCRIPTOR_CAPACITY);
+	for (;;)
+	{
+		while (!m_DescriptorsInFlight.empty() && m_ComputeQueue->IsFenceComplete(m_DescriptorsInFlight.front().fenceValue))
+		{
+			m_DescriptorsInFlight.pop_front();
+		}
+		if (m_DescriptorsInFlight.empty())
+		{
+			m_DescriptorHead = 0;
+		}
+
+		// The ranges in flight are [tail, head), possibly wrapped around the end.
+		const UINT tail = m_DescriptorsInFlight.empty() ? m_DescriptorHead : m_DescriptorsInFlight.front().begin;
+		if (m_DescriptorsInFlight.empty() || m_DescriptorHead > tail)
+		{
+			if (m_DescriptorHead + count <= DESCRIPTOR_CAPACITY)
+				return m_DescriptorHead;
+			// Skip the rest of the heap and start over at the front.
+			if (count <= tail)
+				return 0;
+		}
+		else if (m_DescriptorHead + count <= tail)
+		{
+			return m_DescriptorHead;
+		}
+
+		// Full: wait for the oldest Generate to finish.
+		m_ComputeQueue->WaitForFenceValue(m_DescriptorsInFlight.front().fenceValue);
+	}
+}
+
+// =====================================================================================
+//										Generate
+// =====================================================================================
+
+UINT64 MipGenerator::Generate(ID3D12Resource* texture, bool srgb, const CommandQueue* waitQueue, UINT64 waitFenceValue)
+{
+	const D3D12_RESOURCE_DESC desc = texture->GetDesc();
+	assert(desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D && desc.DepthOrArraySize == 1);
+	assert(desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || desc.Format == DXGI_FORMAT_R8G8B8A8_TYPELESS);
+	assert(desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+	const UINT mipCount = desc.MipLevels;
+	if (waitQueue)
+	{
+		m_ComputeQueue->Wait(*waitQueue, waitFenceValue);
+	}
+	if (mipCount < 2)
+	{
+		return m_ComputeQueue->Signal();
+	}
+
+	// SRV of level - 1 and UAV of level for every level, as one table per dispatch.
+	const UINT firstDescriptor = AllocateDescriptors(2 * (mipCount - 1));
+	CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle(m_DescriptorHeap->GetCPUDescriptorHandleForHeapStart(), firstDescriptor, m_DescriptorSize);
+	CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle(m_DescriptorHeap->GetGPUDescriptorHandleForHeapStart(), firstDescriptor, m_DescriptorSize);
+	for (UINT mip = 1; mip < mipCount; ++mip)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MostDetailedMip = mip - 1;
+		srvDesc.Texture2D.MipLevels = 1;
+		m_Device->CreateShaderResourceView(texture, &srvDesc, cpuHandle);
+		cpuHandle.Offset(1, m_DescriptorSize);
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		uavDesc.Texture2D.MipSlice = mip;
+		m_Device->CreateUnorderedAccessView(texture, nullptr, &uavDesc, cpuHandle);
+		cpuHandle.Offset(1, m_DescriptorSize);
+	}
+
+	auto commandList = m_ComputeQueue->GetCommandList();
+	ID3D12DescriptorHeap* heaps[] = { m_DescriptorHeap.Get() };
+	commandList->SetDescriptorHeaps(_countof(heaps), heaps);
+	commandList->SetPipelineState(m_PipelineState.Get());
+	commandList->SetComputeRootSignature(m_RootSignature.Get());
+
+	// Mip 0 is only read, the others are written once and then read by the next level.
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(texture,
+		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0));
+	for (UINT mip = 1; mip < mipCount; ++mip)
+	{
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(texture,
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, mip));
+	}
+	commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+
+	for (UINT mip = 1; mip < mipCount; ++mip)
+	{
+		MipConstants constants;
+		constants.srcWidth = std::max<UINT32>(1, static_cast<UINT32>(desc.Width >> (mip - 1)));
+		constants.srcHeight = std::max<UINT32>(1, desc.Height >> (mip - 1));
+		constants.dstWidth = std::max<UINT32>(1, static_cast<UINT32>(desc.Width >> mip));
+		constants.dstHeight = std::max<UINT32>(1, desc.Height >> mip);
+		constants.isSRGB = srgb ? 1 : 0;
+
+		commandList->SetComputeRoot32BitConstants(ROOT_MIP_CONSTANTS, sizeof(MipConstants) / 4, &constants, 0);
+		commandList->SetComputeRootDescriptorTable(ROOT_MIP_VIEWS, gpuHandle);
+		gpuHandle.Offset(2, m_DescriptorSize);
+
+		commandList->Dispatch((constants.dstWidth + MIP_THREAD_GROUP_SIZE - 1) / MIP_THREAD_GROUP_SIZE,
+			(constants.dstHeight + MIP_THREAD_GROUP_SIZE - 1) / MIP_THREAD_GROUP_SIZE, 1);
+
+		// Write -> read: the next level filters this one.
+		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mip);
+		commandList->ResourceBarrier(1, &barrier);
+	}
+
+	// Hand the texture back in COMMON, every level.
+	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON);
+	commandList->ResourceBarrier(1, &barrier);
+
+	const UINT64 fenceValue = m_ComputeQueue->ExecuteCommandList(commandList);
+	m_DescriptorsInFlight.push_back(DescriptorRange{ firstDescriptor, 2 * (mipCount - 1), fenceValue });
+	m_DescriptorHead = firstDescriptor + 2 * (mipCount - 1);
+	return fenceValue;
+}
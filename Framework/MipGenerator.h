@@ -0,0 +1,82 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "CommandQueue.h"
+#include "ShaderCache.h"
+
+using Microsoft::WRL::ComPtr;
+
+// =====================================================================================
+//									GPU mip generation
+// =====================================================================================
+
+// Builds the mip chain of textures rendered at runtime (reflection probes, impostors, ...)
+//		with Shaders/GenerateMips_CS.hlsl on the compute queue - the cooker builds the mips of
+//		texture assets offline (Tools/AssetCooker/MipChain.h), with the same box footprint.
+//
+// One dispatch per level, each level filtered from the one above it. A level is read
+//		through an SRV of that mip alone and written through a UAV, so between two levels
+//		the written mip is transitioned to NON_PIXEL_SHADER_RESOURCE - that transition is
+//		also the barrier that makes the next dispatch see its writes.
+//
+// The texture must be R8G8B8A8_UNORM or R8G8B8A8_TYPELESS (for an sRGB SRV elsewhere),
+//		a single 2D slice created with D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, and in
+//		D3D12_RESOURCE_STATE_COMMON - compute queues can't use render target states, so the
+//		direct queue transitions it to COMMON after rendering. It is left in COMMON, from
+//		which the direct queue promotes it to PIXEL_SHADER_RESOURCE on first use.
+//
+// Descriptors come from a shader visible heap used as a ring; a range is reused once the
+//		compute queue passed the fence of the Generate call that took it.
+class MipGenerator
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	MipGenerator(ComPtr<ID3D12Device2> device, std::shared_ptr<CommandQueue> computeQueue, ShaderCache& shaderCache);
+	MipGenerator(const MipGenerator&) = delete;
+	MipGenerator& operator=(const MipGenerator&) = delete;
+
+	// Fills mips 1.. of "texture" from mip 0. "srgb": the texels are sRGB encoded, they are
+	//		filtered in linear space. The compute queue first waits for "waitQueue" to reach
+	//		"waitFenceValue" (the submission that rendered mip 0; nullptr: no wait).
+	//		Returns the compute queue's fence value of the work - the direct queue waits
+	//		for it (CommandQueue::Wait) before sampling the texture.
+	UINT64 Generate(ID3D12Resource* texture, bool srgb, const CommandQueue* waitQueue = nullptr, UINT64 waitFenceValue = 0);
+
+private:
+	// Start of "count" contiguous free descriptors, waits for the GPU if the ring is full.
+	UINT AllocateDescriptors(UINT count);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	// 2 descriptors (SRV + UAV) per level: 16 levels of 64 textures.
+	static constexpr UINT DESCRIPTOR_CAPACITY = 2 * 16 * 64;
+
+	struct DescriptorRange
+	{
+		UINT begin;
+		UINT count;
+		UINT64 fenceValue;
+	};
+
+	ComPtr<ID3D12Device2> m_Device;
+	std::shared_ptr<CommandQueue> m_ComputeQueue;
+
+	ComPtr<ID3D12RootSignature> m_RootSignature;
+	ComPtr<ID3D12PipelineState> m_PipelineState;
+
+	ComPtr<ID3D12DescriptorHeap> m_DescriptorHeap;
+	UINT m_DescriptorSize = 0;
+	// Ranges the GPU may still read, oldest first; new ranges start at m_DescriptorHead.
+	std::deque<DescriptorRange> m_DescriptorsInFlight;
+	UINT m_DescriptorHead = 0;
+};
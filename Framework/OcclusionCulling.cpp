@@ -0,0 +1,386 @@
+#include "OcclusionCulling.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::min, std::max, std::swap
+#include <cassert>
+#include <cmath>
+#include <cstring>   // std::memset
+
+using namespace DirectX;
+
+
+// =====================================================================================
+//										Globals
+// =====================================================================================
+
+constexpr uint32_t MaskedOcclusionBuffer::TILE_WIDTH;
+constexpr uint32_t MaskedOcclusionBuffer::TILE_HEIGHT;
+
+namespace
+{
+	// Vertices closer than this (in clip space w) count as crossing the near plane.
+	constexpr float MIN_W = 1e-5f;
+	constexpr float BIG = 1e30f;
+
+	// Occludees per ParallelFor task.
+	constexpr size_t TEST_GRAIN_SIZE = 256;
+}
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+void MaskedOcclusionBuffer::Resize(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_TilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	m_TilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	m_Tiles.resize(size_t(m_TilesX) * m_TilesY);
+	m_TileRowBins.resize(m_TilesY);
+	Clear();
+}
+
+void MaskedOcclusionBuffer::Clear()
+{
+	for (Tile& tile : m_Tiles)
+	{
+		std::memset(tile.mask, 0, sizeof(tile.mask));
+		tile.zMax0 = 1.0f;
+		tile.zMax1 = 0.0f;
+	}
+	m_Triangles.clear();
+}
+
+// =====================================================================================
+//										Occluders
+// =====================================================================================
+
+void MaskedOcclusionBuffer::AddOccluder(const void* positions, size_t stride, size_t numVertices,
+	const uint16_t* indices, size_t numIndices, FXMMATRIX worldViewProjection, bool backfaceCull)
+{
+	AddOccluderImpl(positions, stride, numVertices, indices, numIndices, worldViewProjection, backfaceCull);
+}
+
+void MaskedOcclusionBuffer::AddOccluder(const void* positions, size_t stride, size_t numVertices,
+	const uint32_t* indices, size_t numIndices, FXMMATRIX worldViewProjection, bool backfaceCull)
+{
+	AddOccluderImpl(positions, stride, numVertices, indices, numIndices, worldViewProjection, backfaceCull);
+}
+
+template<typename Index>
+void MaskedOcclusionBuffer::AddOccluderImpl(const void* positions, size_t stride, size_t numVertices,
+	const Index* indices, size_t numIndices, FXMMATRIX worldViewProjection, bool backfaceCull)
+{
+	assert(m_Width && m_Height && "Resize() the occlusion buffer first.");
+
+	// Every vertex is transformed once, not once per triangle.
+	m_ClipPositions.resize(numVertices);
+	const uint8_t* vertex = static_cast<const uint8_t*>(positions);
+	for (size_t i = 0; i < numVertices; ++i, vertex += stride)
+	{
+		XMVECTOR position = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(vertex));
+		XMStoreFloat4(&m_ClipPositions[i], XMVector3Transform(position, worldViewProjection));
+	}
+
+	const float width = static_cast<float>(m_Width);
+	const float height = static_cast<float>(m_Height);
+
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		const XMFLOAT4* clip[3] = { &m_ClipPositions[indices[i]], &m_ClipPositions[indices[i + 1]], &m_ClipPositions[indices[i + 2]] };
+
+		Triangle triangle;
+		bool crossesNearPlane = false;
+		triangle.zMax = 0.0f;
+		for (int v = 0; v < 3; ++v)
+		{
+			if (clip[v]->w < MIN_W || clip[v]->z < 0.0f)
+			{
+				crossesNearPlane = true;
+				break;
+			}
+			float invW = 1.0f / clip[v]->w;
+			triangle.x[v] = (clip[v]->x * invW * 0.5f + 0.5f) * width;
+			triangle.y[v] = (0.5f - clip[v]->y * invW * 0.5f) * height;
+			triangle.zMax = std::max(triangle.zMax, clip[v]->z * invW);
+		}
+		if (crossesNearPlane)
+			continue;
+
+		// With y pointing down, clockwise triangles have a positive area.
+		float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+			(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+		if (area == 0.0f || (backfaceCull && area < 0.0f))
+			continue;
+		if (area < 0.0f)
+		{
+			std::swap(triangle.x[1], triangle.x[2]);
+			std::swap(triangle.y[1], triangle.y[2]);
+		}
+
+		float minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+		float maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+		float minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+		float maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+		if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height || triangle.zMax >= 1.0f)
+			continue;
+
+		triangle.tileMinX = static_cast<uint32_t>(std::max(minX, 0.0f)) / TILE_WIDTH;
+		triangle.tileMinY = static_cast<uint32_t>(std::max(minY, 0.0f)) / TILE_HEIGHT;
+		triangle.tileMaxX = std::min(static_cast<uint32_t>(maxX) / TILE_WIDTH, m_TilesX - 1);
+		triangle.tileMaxY = std::min(static_cast<uint32_t>(maxY) / TILE_HEIGHT, m_TilesY - 1);
+		m_Triangles.push_back(triangle);
+	}
+}
+
+void MaskedOcclusionBuffer::RenderOccluders(TaskScheduler* scheduler)
+{
+	// Bin the triangles by tile row. Every row then owns its tiles exclusively and sees
+	//		the triangles in submission order, so the result does not depend on threading.
+	for (std::vector<uint32_t>& bin : m_TileRowBins)
+		bin.clear();
+	for (uint32_t i = 0; i < m_Triangles.size(); ++i)
+	{
+		for (uint32_t tileY = m_Triangles[i].tileMinY; tileY <= m_Triangles[i].tileMaxY; ++tileY)
+			m_TileRowBins[tileY].push_back(i);
+	}
+
+	if (scheduler)
+	{
+		scheduler->ParallelFor(0, m_TilesY, 1, [this](size_t begin, size_t end) {
+			for (size_t tileY = begin; tileY < end; ++tileY)
+				RasterizeTileRow(static_cast<uint32_t>(tileY));
+		});
+	}
+	else
+	{
+		for (uint32_t tileY = 0; tileY < m_TilesY; ++tileY)
+			RasterizeTileRow(tileY);
+	}
+
+	m_Triangles.clear();
+}
+
+void MaskedOcclusionBuffer::RasterizeTileRow(uint32_t tileY)
+{
+	for (uint32_t triangleIndex : m_TileRowBins[tileY])
+	{
+		RasterizeTriangle(m_Triangles[triangleIndex], tileY);
+	}
+}
+
+// =====================================================================================
+//									  Rasterization
+// =====================================================================================
+
+// Update the working layer depth of a tile for one triangle (the merge heuristic of
+//		the paper). Returns true if the working layer was discarded - the caller then
+//		clears the mask before adding the triangle's coverage.
+bool MaskedOcclusionBuffer::UpdateTileDepth(Tile& tile, float triangleZMax)
+{
+	// If the triangle is much farther from the working layer than from the reference
+	//		layer, the working layer would only get worse - start a new one.
+	float dist1 = triangleZMax - tile.zMax1;
+	float dist0 = tile.zMax0 - triangleZMax;
+	bool discard = dist1 > dist0;
+	if (discard)
+		tile.zMax1 = 0.0f;
+	tile.zMax1 = std::max(tile.zMax1, triangleZMax);
+	return discard;
+}
+
+// Edge functions E(x, y) = a * x + b * y + c >= 0 inside. For a fixed scanline y the
+//		condition is a * x >= -(b * y + c), a half line in x, so the covered span of a row
+//		is the intersection of 3 half lines [xLeft, xRight]. A pixel is covered if its
+//		center lies inside the span.
+void MaskedOcclusionBuffer::RasterizeTriangle(const Triangle& triangle, uint32_t tileY)
+{
+	float a[3], b[3], c[3];
+	for (int e = 0; e < 3; ++e)
+	{
+		int next = (e + 1) % 3;
+		a[e] = -(triangle.y[next] - triangle.y[e]);
+		b[e] = triangle.x[next] - triangle.x[e];
+		c[e] = -(a[e] * triangle.x[e] + b[e] * triangle.y[e]);
+	}
+
+	const float rowY0 = tileY * TILE_HEIGHT + 0.5f;
+	const uint32_t rowsInside = std::min(TILE_HEIGHT, m_Height - tileY * TILE_HEIGHT);
+	Tile* tiles = m_Tiles.data() + size_t(tileY) * m_TilesX;
+
+	if (m_UseAVX2)
+	{
+		RasterizeTilesAVX2(triangle, tiles, a, b, c, rowY0, rowsInside, m_Width);
+		return;
+	}
+
+	float xLeft[TILE_HEIGHT], xRight[TILE_HEIGHT];
+	for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+	{
+		const float y = rowY0 + row;
+		xLeft[row] = -BIG;
+		xRight[row] = row < rowsInside ? BIG : -BIG;
+		for (int e = 0; e < 3; ++e)
+		{
+			float k = -(b[e] * y + c[e]);
+			if (a[e] > 0.0f)
+				xLeft[row] = std::max(xLeft[row], k / a[e]);
+			else if (a[e] < 0.0f)
+				xRight[row] = std::min(xRight[row], k / a[e]);
+			else if (k > 0.0f)
+				xRight[row] = -BIG;
+		}
+	}
+
+	for (uint32_t tileX = triangle.tileMinX; tileX <= triangle.tileMaxX; ++tileX)
+	{
+		Tile& tile = tiles[tileX];
+		if (triangle.zMax >= tile.zMax0)
+			continue;
+
+		const float tileX0 = tileX * TILE_WIDTH + 0.5f;
+		const uint32_t columnsInside = std::min(TILE_WIDTH, m_Width - tileX * TILE_WIDTH);
+		const float columnLimit = static_cast<float>(columnsInside);
+		// Pixels past the right or bottom edge of the buffer count as covered, otherwise
+		//		the edge tiles of a buffer that isn't a multiple of the tile size never fill.
+		const uint32_t outsideColumns = columnsInside < TILE_WIDTH ? ~0u << columnsInside : 0u;
+
+		uint32_t coverage[TILE_HEIGHT];
+		uint32_t anyCoverage = 0;
+		for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+		{
+			float start = std::min(std::max(std::ceil(xLeft[row] - tileX0), 0.0f), 32.0f);
+			float end = std::min(std::max(std::floor(xRight[row] - tileX0) + 1.0f, 0.0f), columnLimit);
+			uint32_t startColumn = static_cast<uint32_t>(start), endColumn = static_cast<uint32_t>(end);
+
+			uint32_t startBits = startColumn >= 32 ? 0u : ~0u << startColumn;
+			uint32_t endBits = endColumn >= 32 ? ~0u : (1u << endColumn) - 1;
+			coverage[row] = startBits & endBits;
+			anyCoverage |= coverage[row];
+		}
+		if (!anyCoverage)
+			continue;
+
+		bool discard = UpdateTileDepth(tile, triangle.zMax);
+		uint32_t full = ~0u;
+		for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+		{
+			tile.mask[row] = (discard ? 0u : tile.mask[row]) | coverage[row];
+			full &= tile.mask[row] | (row < rowsInside ? outsideColumns : ~0u);
+		}
+
+		if (full == ~0u)
+		{
+			tile.zMax0 = tile.zMax1;
+			tile.zMax1 = 0.0f;
+			std::memset(tile.mask, 0, sizeof(tile.mask));
+		}
+	}
+}
+
+// =====================================================================================
+//										Occludees
+// =====================================================================================
+
+// The box is visible if its nearest point is in front of zMax0 in any tile it overlaps.
+//		Testing against zMax0 only (not the partially covered working layer) keeps the
+//		test conservative at tile granularity.
+bool MaskedOcclusionBuffer::IsVisible(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, FXMMATRIX viewProjection) const
+{
+	float minX = BIG, minY = BIG, maxX = -BIG, maxY = -BIG;
+	float zMin = BIG;
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		XMVECTOR position = XMVectorSet(
+			(corner & 1) ? boxMax.x : boxMin.x,
+			(corner & 2) ? boxMax.y : boxMin.y,
+			(corner & 4) ? boxMax.z : boxMin.z, 1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(position, viewProjection));
+
+		// Crossing the near plane: the screen rect is unbounded, assume visible.
+		if (clip.w < MIN_W)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * m_Width;
+		float y = (0.5f - clip.y * invW * 0.5f) * m_Height;
+		minX = std::min(minX, x); maxX = std::max(maxX, x);
+		minY = std::min(minY, y); maxY = std::max(maxY, y);
+		zMin = std::min(zMin, clip.z * invW);
+	}
+
+	if (zMin < 0.0f)
+		return true;
+	if (maxX < 0.0f || maxY < 0.0f || minX >= m_Width || minY >= m_Height)
+		return false;
+
+	uint32_t tileMinX = static_cast<uint32_t>(std::max(minX, 0.0f)) / TILE_WIDTH;
+	uint32_t tileMinY = static_cast<uint32_t>(std::max(minY, 0.0f)) / TILE_HEIGHT;
+	uint32_t tileMaxX = std::min(static_cast<uint32_t>(maxX) / TILE_WIDTH, m_TilesX - 1);
+	uint32_t tileMaxY = std::min(static_cast<uint32_t>(maxY) / TILE_HEIGHT, m_TilesY - 1);
+
+	for (uint32_t tileY = tileMinY; tileY <= tileMaxY; ++tileY)
+	{
+		const Tile* row = m_Tiles.data() + size_t(tileY) * m_TilesX;
+		for (uint32_t tileX = tileMinX; tileX <= tileMaxX; ++tileX)
+		{
+			if (zMin < row[tileX].zMax0)
+				return true;
+		}
+	}
+	return false;
+}
+
+template<typename GetBox>
+void MaskedOcclusionBuffer::FilterVisible(size_t count, FXMMATRIX viewProjection,
+	std::vector<uint32_t>& visible, TaskScheduler* scheduler, const GetBox& getBox) const
+{
+	const XMMATRIX matrix = viewProjection;
+	std::vector<uint8_t> keep(visible.size());
+
+	auto test = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			assert(visible[i] < count);
+			(void)count;
+			XMFLOAT3 boxMin, boxMax;
+			getBox(visible[i], boxMin, boxMax);
+			keep[i] = IsVisible(boxMin, boxMax, matrix) ? 1 : 0;
+		}
+	};
+
+	if (scheduler && visible.size() > TEST_GRAIN_SIZE)
+		scheduler->ParallelFor(0, visible.size(), TEST_GRAIN_SIZE, test);
+	else
+		test(0, visible.size());
+
+	// Compact in place, keeping the order.
+	size_t numVisible = 0;
+	for (size_t i = 0; i < visible.size(); ++i)
+	{
+		if (keep[i])
+			visible[numVisible++] = visible[i];
+	}
+	visible.resize(numVisible);
+}
+
+void MaskedOcclusionBuffer::TestBoxes(const BoundingBoxes& boxes, FXMMATRIX viewProjection,
+	std::vector<uint32_t>& visible, TaskScheduler* scheduler) const
+{
+	FilterVisible(boxes.GetCount(), viewProjection, visible, scheduler, [&](uint32_t i, XMFLOAT3& boxMin, XMFLOAT3& boxMax) {
+		boxMin = XMFLOAT3(boxes.centerX[i] - boxes.extentX[i], boxes.centerY[i] - boxes.extentY[i], boxes.centerZ[i] - boxes.extentZ[i]);
+		boxMax = XMFLOAT3(boxes.centerX[i] + boxes.extentX[i], boxes.centerY[i] + boxes.extentY[i], boxes.centerZ[i] + boxes.extentZ[i]);
+	});
+}
+
+void MaskedOcclusionBuffer::TestSpheres(const BoundingSpheres& spheres, FXMMATRIX viewProjection,
+	std::vector<uint32_t>& visible, TaskScheduler* scheduler) const
+{
+	FilterVisible(spheres.GetCount(), viewProjection, visible, scheduler, [&](uint32_t i, XMFLOAT3& boxMin, XMFLOAT3& boxMax) {
+		float r = spheres.radius[i];
+		boxMin = XMFLOAT3(spheres.centerX[i] - r, spheres.centerY[i] - r, spheres.centerZ[i] - r);
+		boxMax = XMFLOAT3(spheres.centerX[i] + r, spheres.centerY[i] + r, spheres.centerZ[i] + r);
+	});
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+class TaskScheduler;
+
+// =====================================================================================
+//								Masked occlusion buffer
+// =====================================================================================
+
+// CPU software occlusion culling with a low resolution masked depth buffer
+//		(after Andersson, Hasselgren and Akenine-Moller, "Masked Software Occlusion Culling").
+//
+// Instead of a depth value per pixel, the screen is split in 32x8 pixel tiles and every
+//		tile stores
+//		- zMax0:  a depth that every pixel of the tile is known to be closer than or equal to,
+//		- zMax1:  the farthest depth of the occluders in the working layer,
+//		- mask:   which pixels the working layer covers, one 32 bit row mask per scanline.
+//		When the working layer covers the whole tile it becomes the new zMax0. A heuristic
+//		discards the working layer when a triangle is much farther than it, so one layer per
+//		tile is enough for typical occluders.
+//
+// The 8 rows of a tile map to the 8 lanes of an AVX2 register: a triangle's coverage of a
+//		tile is computed for all 8 scanlines at once with variable shifts. That kernel is
+//		in OcclusionCullingAVX2.cpp, the only file built with /arch:AVX2, and is used when
+//		the CPU supports it; otherwise a scalar kernel with identical results runs.
+//
+// Usage per frame:
+//		Clear(); AddOccluder(...) for the big occluders; RenderOccluders(scheduler);
+//		then test the frustum culling survivors with TestBoxes()/TestSpheres().
+//
+// Depths are post-projection z/w in [0, 1] (larger is farther). Triangles crossing the
+//		near plane are not rasterized and occludees crossing it are always visible, so
+//		both simplifications stay conservative.
+class MaskedOcclusionBuffer
+{
+public:
+	static constexpr uint32_t TILE_WIDTH = 32;
+	static constexpr uint32_t TILE_HEIGHT = 8;
+
+	struct Tile
+	{
+		uint32_t mask[TILE_HEIGHT];
+		float zMax0;
+		float zMax1;
+	};
+
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// Resolution of the occlusion buffer - a fraction of the screen (e.g. 320x192) is plenty.
+	void Resize(uint32_t width, uint32_t height);
+	void Clear();
+
+	// Transform an occluder mesh to screen space and queue its triangles. positions are
+	//		float3 with "stride" bytes between vertices. Front faces are clockwise (D3D default).
+	void AddOccluder(const void* positions, size_t stride, size_t numVertices,
+		const uint16_t* indices, size_t numIndices, DirectX::FXMMATRIX worldViewProjection, bool backfaceCull = true);
+	void AddOccluder(const void* positions, size_t stride, size_t numVertices,
+		const uint32_t* indices, size_t numIndices, DirectX::FXMMATRIX worldViewProjection, bool backfaceCull = true);
+
+	// Rasterize the queued occluders. With a scheduler every tile row is rasterized as a
+	//		separate task (tiles never share state, so no synchronization is needed).
+	void RenderOccluders(TaskScheduler* scheduler = nullptr);
+
+	// Occludee tests, world space volumes against the current buffer.
+	bool IsVisible(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax,
+		DirectX::FXMMATRIX viewProjection) const;
+	// Remove the occluded objects from "visible" (e.g. the output of the FrustumCuller).
+	void TestBoxes(const BoundingBoxes& boxes, DirectX::FXMMATRIX viewProjection,
+		std::vector<uint32_t>& visible, TaskScheduler* scheduler = nullptr) const;
+	void TestSpheres(const BoundingSpheres& spheres, DirectX::FXMMATRIX viewProjection,
+		std::vector<uint32_t>& visible, TaskScheduler* scheduler = nullptr) const;
+
+	// True if the AVX2 rasterizer was compiled in and the CPU supports AVX2 and FMA.
+	static bool IsAVX2Supported();
+	// Rasterize with the AVX2 kernel when supported (the default) or always with the
+	//		scalar one, e.g. to compare both.
+	void SetUseAVX2(bool useAVX2) { m_UseAVX2 = useAVX2 && IsAVX2Supported(); }
+	bool GetUseAVX2() const { return m_UseAVX2; }
+
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+	const Tile* GetTiles() const { return m_Tiles.data(); }
+	uint32_t GetNumTilesX() const { return m_TilesX; }
+	uint32_t GetNumTilesY() const { return m_TilesY; }
+
+private:
+	// Screen space triangle, ready for rasterization.
+	struct Triangle
+	{
+		float x[3], y[3];
+		float zMax;						// conservative (farthest) depth of the triangle
+		uint32_t tileMinX, tileMinY, tileMaxX, tileMaxY;	// inclusive
+	};
+
+	template<typename Index>
+	void AddOccluderImpl(const void* positions, size_t stride, size_t numVertices,
+		const Index* indices, size_t numIndices, DirectX::FXMMATRIX worldViewProjection, bool backfaceCull);
+	void RasterizeTileRow(uint32_t tileY);
+	void RasterizeTriangle(const Triangle& triangle, uint32_t tileY);
+	// The AVX2 version of the tile loop of RasterizeTriangle, in OcclusionCullingAVX2.cpp.
+	//		Only raw data goes in, so that file needs none of the inline functions of
+	//		std::vector or <algorithm> - their AVX2 copies could be picked for everyone.
+	static void RasterizeTilesAVX2(const Triangle& triangle, Tile* tiles, const float a[3], const float b[3],
+		const float c[3], float rowY0, uint32_t rowsInside, uint32_t width);
+	static bool UpdateTileDepth(Tile& tile, float triangleZMax);
+	template<typename GetBox>
+	void FilterVisible(size_t count, DirectX::FXMMATRIX viewProjection,
+		std::vector<uint32_t>& visible, TaskScheduler* scheduler, const GetBox& getBox) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	uint32_t m_Width = 0;
+	uint32_t m_Height = 0;
+	uint32_t m_TilesX = 0;
+	uint32_t m_TilesY = 0;
+	std::vector<Tile> m_Tiles;
+
+	// Queued occluder triangles and the triangles touching each tile row.
+	std::vector<Triangle> m_Triangles;
+	std::vector<std::vector<uint32_t>> m_TileRowBins;
+	std::vector<DirectX::XMFLOAT4> m_ClipPositions;
+
+	bool m_UseAVX2 = IsAVX2Supported();
+};
@@ -0,0 +1,109 @@
+// The AVX2 coverage kernel of the masked occlusion buffer. This is the only file compiled
+//		with /arch:AVX2 (-mavx2 -mfma): the rest of the program keeps the baseline
+//		instruction set, and the buffer uses this kernel only when the CPU supports it
+//		(MaskedOcclusionBuffer::IsAVX2Supported).
+//
+// Keep inline functions shared with other files out of here (std::min, std::max,
+//		std::vector accessors, DirectXMath): the compiler emits an AVX2 copy of every one
+//		this file uses, and the linker is free to keep that copy for the whole program.
+#include "OcclusionCulling.h"
+#include "CpuTopology.h"
+
+// MSVC defines __AVX2__ for /arch:AVX2, GCC/Clang for -mavx2.
+#if defined(__AVX2__)
+#define OCCLUSION_CULLING_AVX2 1
+#include <immintrin.h>
+#endif
+
+bool MaskedOcclusionBuffer::IsAVX2Supported()
+{
+#if defined(OCCLUSION_CULLING_AVX2)
+	// /arch:AVX2 lets the compiler use FMA instructions too.
+	const CpuFeatures& features = CpuFeatures::Get();
+	return features.avx2 && features.fma;
+#else
+	return false;
+#endif
+}
+
+#if defined(OCCLUSION_CULLING_AVX2)
+
+namespace
+{
+	constexpr float BIG = 1e30f;
+}
+
+// Same as the scalar loop of RasterizeTriangle, with one lane per scanline.
+void MaskedOcclusionBuffer::RasterizeTilesAVX2(const Triangle& triangle, Tile* tiles, const float a[3], const float b[3],
+	const float c[3], float rowY0, uint32_t rowsInside, uint32_t width)
+{
+	const __m256 y = _mm256_add_ps(_mm256_set1_ps(rowY0), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 xLeft = _mm256_set1_ps(-BIG);
+	__m256 xRight = _mm256_set1_ps(BIG);
+	for (int e = 0; e < 3; ++e)
+	{
+		__m256 k = _mm256_sub_ps(zero, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(b[e]), y), _mm256_set1_ps(c[e])));
+		if (a[e] > 0.0f)
+			xLeft = _mm256_max_ps(xLeft, _mm256_div_ps(k, _mm256_set1_ps(a[e])));
+		else if (a[e] < 0.0f)
+			xRight = _mm256_min_ps(xRight, _mm256_div_ps(k, _mm256_set1_ps(a[e])));
+		else
+			xRight = _mm256_blendv_ps(xRight, _mm256_set1_ps(-BIG), _mm256_cmp_ps(k, zero, _CMP_GT_OQ));
+	}
+	// Rows below the bottom of the buffer.
+	const __m256i rowIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i rowValid = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(rowsInside)), rowIndex);
+	xRight = _mm256_blendv_ps(_mm256_set1_ps(-BIG), xRight, _mm256_castsi256_ps(rowValid));
+
+	const __m256i ones = _mm256_set1_epi32(-1);
+	for (uint32_t tileX = triangle.tileMinX; tileX <= triangle.tileMaxX; ++tileX)
+	{
+		Tile& tile = tiles[tileX];
+		if (triangle.zMax >= tile.zMax0)
+			continue;
+
+		// Column range [start, end) of every row relative to the tile, clamped to [0, 32].
+		const float tileX0 = tileX * TILE_WIDTH + 0.5f;
+		const uint32_t columnsInside = width - tileX * TILE_WIDTH < TILE_WIDTH ? width - tileX * TILE_WIDTH : TILE_WIDTH;
+		const float columnLimit = static_cast<float>(columnsInside);
+		// Pixels past the edge of the buffer count as covered.
+		const uint32_t outsideColumns = columnsInside < TILE_WIDTH ? ~0u << columnsInside : 0u;
+		const __m256i outside = _mm256_blendv_epi8(ones, _mm256_set1_epi32(static_cast<int>(outsideColumns)), rowValid);
+		__m256 start = _mm256_ceil_ps(_mm256_sub_ps(xLeft, _mm256_set1_ps(tileX0)));
+		__m256 end = _mm256_add_ps(_mm256_floor_ps(_mm256_sub_ps(xRight, _mm256_set1_ps(tileX0))), _mm256_set1_ps(1.0f));
+		start = _mm256_min_ps(_mm256_max_ps(start, zero), _mm256_set1_ps(32.0f));
+		end = _mm256_min_ps(_mm256_max_ps(end, zero), _mm256_set1_ps(columnLimit));
+
+		// Shifts by 32 give 0, so empty and full rows need no special case.
+		__m256i startBits = _mm256_sllv_epi32(ones, _mm256_cvttps_epi32(start));
+		__m256i endBits = _mm256_andnot_si256(_mm256_sllv_epi32(ones, _mm256_cvttps_epi32(end)), ones);
+		__m256i coverage = _mm256_and_si256(startBits, endBits);
+		if (_mm256_testz_si256(coverage, coverage))
+			continue;
+
+		__m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tile.mask));
+		if (UpdateTileDepth(tile, triangle.zMax))
+			mask = _mm256_setzero_si256();
+		mask = _mm256_or_si256(mask, coverage);
+
+		// Fully covered: the working layer becomes the reference layer.
+		if (_mm256_testc_si256(_mm256_or_si256(mask, outside), ones))
+		{
+			tile.zMax0 = tile.zMax1;
+			tile.zMax1 = 0.0f;
+			mask = _mm256_setzero_si256();
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(tile.mask), mask);
+	}
+}
+
+#else
+
+// Not an x86 build: IsAVX2Supported() is false and the dispatch never gets here.
+void MaskedOcclusionBuffer::RasterizeTilesAVX2(const Triangle&, Tile*, const float[3], const float[3],
+	const float[3], float, uint32_t, uint32_t)
+{
+}
+
+#endif
@@ -0,0 +1,441 @@
+#include "PackFile.h"
+#include "Hash.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::min
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstring>   // std::memcpy
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	// Largest block size a reader accepts - guards the scratch allocations against
+	//		corrupted headers.
+	constexpr uint32_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+	uint32_t GetBucketCount(uint32_t entryCount)
+	{
+		// At most half full, so probe sequences stay short.
+		uint32_t count = 1;
+		while (count < entryCount * 2)
+			count *= 2;
+		return count;
+	}
+
+	uint32_t GetEntryBlockCount(uint64_t size, uint32_t blockSize)
+	{
+		return uint32_t((size + blockSize - 1) / blockSize);
+	}
+}
+
+std::string NormalizePackName(const std::string& name)
+{
+	std::string result;
+	result.reserve(name.size());
+	for (char c : name)
+	{
+		if (c == '\\')
+			c = '/';
+		else if (c >= 'A' && c <= 'Z')
+			c = char(c - 'A' + 'a');
+		result.push_back(c);
+	}
+
+	size_t start = 0;
+	while (start < result.size())
+	{
+		if (result[start] == '/')
+			++start;
+		else if (result.compare(start, 2, "./") == 0)
+			start += 2;
+		else
+			break;
+	}
+	return result.substr(start);
+}
+
+// =====================================================================================
+//										Writer
+// =====================================================================================
+
+bool PackFileWriter::AddEntry(const std::string& name, const void* data, size_t size,
+	CompressionMethod compression, int level)
+{
+	if (!IsCompressionSupported(compression))
+		return false;
+
+	const std::string normalized = NormalizePackName(name);
+	for (const PendingEntry& entry : m_Entries)
+	{
+		if (entry.name == normalized)
+			return false;
+	}
+
+	PendingEntry entry;
+	entry.name = normalized;
+	entry.data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	entry.compression = compression;
+	entry.level = level;
+	m_Entries.push_back(std::move(entry));
+	m_UncompressedSize += size;
+	return true;
+}
+
+bool PackFileWriter::Write(const char* path, TaskScheduler* scheduler)
+{
+	// Every block of every entry, compressed independently.
+	struct BlockJob
+	{
+		uint32_t entry;
+		uint64_t offset;
+		uint32_t size;
+		CompressionMethod compression;
+		std::vector<uint8_t> data;
+	};
+
+	std::vector<PackEntry> entries(m_Entries.size());
+	std::vector<BlockJob> jobs;
+	std::string names;
+	for (uint32_t i = 0; i < m_Entries.size(); ++i)
+	{
+		const PendingEntry& pending = m_Entries[i];
+		PackEntry& entry = entries[i];
+		entry = PackEntry();
+		entry.nameHash = HashXXH64(pending.name.data(), pending.name.size());
+		entry.size = pending.data.size();
+		entry.firstBlock = uint32_t(jobs.size());
+		entry.blockCount = GetEntryBlockCount(entry.size, PACK_BLOCK_SIZE);
+		entry.nameOffset = uint32_t(names.size());
+		entry.compression = pending.compression;
+		names.append(pending.name);
+		names.push_back('\0');
+
+		for (uint32_t block = 0; block < entry.blockCount; ++block)
+		{
+			BlockJob job;
+			job.entry = i;
+			job.offset = uint64_t(block) * PACK_BLOCK_SIZE;
+			job.size = uint32_t(std::min<uint64_t>(PACK_BLOCK_SIZE, entry.size - job.offset));
+			job.compression = pending.compression;
+			jobs.push_back(std::move(job));
+		}
+	}
+
+	auto compress = [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; ++j)
+		{
+			BlockJob& job = jobs[j];
+			const PendingEntry& pending = m_Entries[job.entry];
+			const uint8_t* source = pending.data.data() + job.offset;
+
+			size_t compressedSize = 0;
+			if (job.compression != CompressionMethod::None)
+			{
+				job.data.resize(GetCompressBound(job.compression, job.size));
+				compressedSize = CompressBlock(job.compression, pending.level, source, job.size, job.data.data(), job.data.size());
+			}
+			// Store blocks that don't shrink - they read faster as they are.
+			if (compressedSize == 0 || compressedSize >= job.size)
+			{
+				job.compression = CompressionMethod::None;
+				job.data.assign(source, source + job.size);
+			}
+			else
+			{
+				job.data.resize(compressedSize);
+			}
+		}
+	};
+	if (scheduler && jobs.size() > 1)
+		scheduler->ParallelFor(0, jobs.size(), 1, compress);
+	else
+		compress(0, jobs.size());
+
+	FILE* file = std::fopen(path, "wb");
+	if (!file)
+		return false;
+
+	// Header last, once the table of contents is known.
+	PackHeader header = {};
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+	std::vector<PackBlock> blocks(jobs.size());
+	uint64_t offset = sizeof(PackHeader);
+	for (size_t j = 0; j < jobs.size() && ok; ++j)
+	{
+		blocks[j] = PackBlock();
+		blocks[j].offset = offset;
+		blocks[j].compressedSize = uint32_t(jobs[j].data.size());
+		blocks[j].compression = jobs[j].compression;
+		ok = jobs[j].data.empty() || std::fwrite(jobs[j].data.data(), jobs[j].data.size(), 1, file) == 1;
+		offset += jobs[j].data.size();
+	}
+
+	const uint32_t bucketCount = GetBucketCount(uint32_t(entries.size()));
+	std::vector<uint32_t> buckets(bucketCount, 0);
+	for (uint32_t i = 0; i < entries.size(); ++i)
+	{
+		uint32_t bucket = uint32_t(entries[i].nameHash) & (bucketCount - 1);
+		while (buckets[bucket] != 0)
+			bucket = (bucket + 1) & (bucketCount - 1);
+		buckets[bucket] = i + 1;
+	}
+
+	std::vector<uint8_t> toc;
+	auto append = [&toc](const void* data, size_t size) {
+		toc.insert(toc.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	};
+	append(entries.data(), entries.size() * sizeof(PackEntry));
+	append(blocks.data(), blocks.size() * sizeof(PackBlock));
+	append(buckets.data(), buckets.size() * sizeof(uint32_t));
+	append(names.data(), names.size());
+
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.blockSize = PACK_BLOCK_SIZE;
+	header.entryCount = uint32_t(entries.size());
+	header.blockCount = uint32_t(blocks.size());
+	header.bucketCount = bucketCount;
+	header.tocOffset = offset;
+	header.tocSize = toc.size();
+	header.tocHash = HashXXH64(toc.data(), toc.size());
+
+	ok = ok && std::fwrite(toc.data(), toc.size(), 1, file) == 1;
+	ok = ok && std::fseek(file, 0, SEEK_SET) == 0;
+	ok = ok && std::fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = (std::fclose(file) == 0) && ok;
+
+	m_CompressedSize = offset + toc.size();
+	return ok;
+}
+
+// =====================================================================================
+//										Reader
+// =====================================================================================
+
+PackFileReader::~PackFileReader()
+{
+	Close();
+}
+
+bool PackFileReader::Open(const char* path)
+{
+	Close();
+
+#if defined(_WIN32)
+	const int length = ::MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::vector<wchar_t> widePath(length > 0 ? length : 1, L'\0');
+	::MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+
+	HANDLE file = ::CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	m_File = reinterpret_cast<intptr_t>(file);
+#else
+	const int file = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+		return false;
+	m_File = file;
+#endif
+
+	// Header and table of contents, checked before anything points into them.
+	if (!ReadAt(0, &m_Header, sizeof(m_Header)) ||
+		m_Header.magic != PACK_MAGIC || m_Header.version != PACK_VERSION ||
+		m_Header.blockSize == 0 || m_Header.blockSize > MAX_BLOCK_SIZE ||
+		m_Header.bucketCount == 0 || (m_Header.bucketCount & (m_Header.bucketCount - 1)) != 0 ||
+		m_Header.bucketCount < m_Header.entryCount)
+	{
+		Close();
+		return false;
+	}
+
+	const uint64_t fixedSize = uint64_t(m_Header.entryCount) * sizeof(PackEntry) +
+		uint64_t(m_Header.blockCount) * sizeof(PackBlock) + uint64_t(m_Header.bucketCount) * sizeof(uint32_t);
+	if (m_Header.tocSize < fixedSize || m_Header.tocSize > (uint64_t(1) << 32))
+	{
+		Close();
+		return false;
+	}
+
+	m_Toc.resize(size_t(m_Header.tocSize));
+	if (!ReadAt(m_Header.tocOffset, m_Toc.data(), m_Toc.size()) ||
+		HashXXH64(m_Toc.data(), m_Toc.size()) != m_Header.tocHash)
+	{
+		Close();
+		return false;
+	}
+
+	const uint8_t* toc = m_Toc.data();
+	m_Entries = reinterpret_cast<const PackEntry*>(toc);
+	toc += m_Header.entryCount * sizeof(PackEntry);
+	m_Blocks = reinterpret_cast<const PackBlock*>(toc);
+	toc += m_Header.blockCount * sizeof(PackBlock);
+	m_Buckets = reinterpret_cast<const uint32_t*>(toc);
+	toc += m_Header.bucketCount * sizeof(uint32_t);
+	m_Names = reinterpret_cast<const char*>(toc);
+	m_NamesSize = size_t(m_Toc.data() + m_Toc.size() - toc);
+
+	// The hash protects against damage, these against a writer bug.
+	bool valid = m_NamesSize > 0 || m_Header.entryCount == 0;
+	valid = valid && (m_NamesSize == 0 || m_Names[m_NamesSize - 1] == '\0');
+	for (uint32_t i = 0; i < m_Header.entryCount && valid; ++i)
+	{
+		const PackEntry& entry = m_Entries[i];
+		valid = entry.nameOffset < m_NamesSize &&
+			uint64_t(entry.firstBlock) + entry.blockCount <= m_Header.blockCount &&
+			entry.blockCount == GetEntryBlockCount(entry.size, m_Header.blockSize);
+	}
+	for (uint32_t i = 0; i < m_Header.blockCount && valid; ++i)
+	{
+		valid = m_Blocks[i].offset + m_Blocks[i].compressedSize <= m_Header.tocOffset;
+	}
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void PackFileReader::Close()
+{
+	if (m_File != INVALID_FILE)
+	{
+#if defined(_WIN32)
+		::CloseHandle(reinterpret_cast<HANDLE>(m_File));
+#else
+		::close(int(m_File));
+#endif
+		m_File = INVALID_FILE;
+	}
+
+	m_Header = PackHeader();
+	m_Toc.clear();
+	m_Entries = nullptr;
+	m_Blocks = nullptr;
+	m_Buckets = nullptr;
+	m_Names = nullptr;
+	m_NamesSize = 0;
+}
+
+bool PackFileReader::ReadAt(uint64_t offset, void* destination, size_t size) const
+{
+	uint8_t* out = static_cast<uint8_t*>(destination);
+	while (size > 0)
+	{
+#if defined(_WIN32)
+		// An explicit offset makes ReadFile positional - no shared file pointer to race on.
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = DWORD(offset);
+		overlapped.OffsetHigh = DWORD(offset >> 32);
+		DWORD read = 0;
+		const DWORD request = DWORD(std::min<size_t>(size, 1u << 30));
+		if (!::ReadFile(reinterpret_cast<HANDLE>(m_File), out, request, &read, &overlapped) || read == 0)
+			return false;
+#else
+		const ssize_t read = ::pread(int(m_File), out, size, off_t(offset));
+		if (read < 0 && errno == EINTR)
+			continue;
+		if (read <= 0)
+			return false;
+#endif
+		out += read;
+		offset += uint64_t(read);
+		size -= size_t(read);
+	}
+	return true;
+}
+
+const PackEntry* PackFileReader::FindEntry(const std::string& name) const
+{
+	if (!IsOpen())
+		return nullptr;
+
+	const std::string normalized = NormalizePackName(name);
+	const uint64_t hash = HashXXH64(normalized.data(), normalized.size());
+	const uint32_t mask = m_Header.bucketCount - 1;
+	for (uint32_t bucket = uint32_t(hash) & mask, probes = 0; probes < m_Header.bucketCount; bucket = (bucket + 1) & mask, ++probes)
+	{
+		const uint32_t slot = m_Buckets[bucket];
+		if (slot == 0 || slot > m_Header.entryCount)
+			return nullptr;
+
+		// The name comparison settles hash collisions.
+		const PackEntry& entry = m_Entries[slot - 1];
+		if (entry.nameHash == hash && normalized == GetEntryName(entry))
+			return &entry;
+	}
+	return nullptr;
+}
+
+bool PackFileReader::ReadBlock(const PackEntry& entry, uint32_t block, uint8_t* destination,
+	std::vector<uint8_t>& compressed, std::vector<uint8_t>& decompressed) const
+{
+	assert(block < entry.blockCount);
+	const PackBlock& packBlock = m_Blocks[entry.firstBlock + block];
+	const uint64_t start = uint64_t(block) * m_Header.blockSize;
+	const size_t size = size_t(std::min<uint64_t>(m_Header.blockSize, entry.size - start));
+
+	if (packBlock.compression == CompressionMethod::None)
+	{
+		return packBlock.compressedSize == size && ReadAt(packBlock.offset, destination, size);
+	}
+
+	compressed.resize(packBlock.compressedSize);
+	decompressed.resize(size);
+	if (!ReadAt(packBlock.offset, compressed.data(), compressed.size()) ||
+		!DecompressBlock(packBlock.compression, compressed.data(), compressed.size(), decompressed.data(), size))
+		return false;
+
+	std::memcpy(destination, decompressed.data(), size);
+	return true;
+}
+
+bool PackFileReader::ReadBlocks(const PackEntry& entry, uint32_t firstBlock, uint32_t blockCount, void* destination) const
+{
+	if (!IsOpen() || uint64_t(firstBlock) + blockCount > entry.blockCount)
+		return false;
+
+	std::vector<uint8_t> compressed, decompressed;
+	uint8_t* out = static_cast<uint8_t*>(destination);
+	for (uint32_t block = firstBlock; block < firstBlock + blockCount; ++block)
+	{
+		if (!ReadBlock(entry, block, out + uint64_t(block - firstBlock) * m_Header.blockSize, compressed, decompressed))
+			return false;
+	}
+	return true;
+}
+
+bool PackFileReader::ReadEntry(const PackEntry& entry, void* destination, TaskScheduler* scheduler) const
+{
+	if (!scheduler || entry.blockCount <= 1)
+		return ReadBlocks(entry, 0, entry.blockCount, destination);
+	if (!IsOpen())
+		return false;
+
+	// A few blocks per task amortize the scratch buffers and the task overhead.
+	std::atomic<bool> ok(true);
+	scheduler->ParallelFor(0, entry.blockCount, 4, [&](size_t begin, size_t end) {
+		if (!ReadBlocks(entry, uint32_t(begin), uint32_t(end - begin),
+			static_cast<uint8_t*>(destination) + uint64_t(begin) * m_Header.blockSize))
+			ok.store(false, std::memory_order_relaxed);
+	});
+	return ok.load();
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "Compression.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//										Pack files
+// =====================================================================================
+
+// Many assets in one file, each compressed on its own in fixed size blocks:
+//
+//		PackHeader
+//		block data				compressed blocks of all entries, back to back
+//		table of contents		PackEntry[entryCount]
+//								PackBlock[blockCount]
+//								uint32_t buckets[bucketCount]	hash table: entry index + 1, 0 = empty
+//								names							zero terminated, normalized
+//
+// Every entry is split into PACK_BLOCK_SIZE blocks (the last one shorter) that are
+//		compressed independently. That is what makes
+//		- streaming possible: any block range can be decompressed without the ones before it,
+//		- decompression parallel: the blocks of one entry go to different workers,
+//		- the scratch memory bounded: one block per thread, whatever the asset size.
+// Blocks that don't get smaller are stored uncompressed.
+//
+// The table of contents is found by name hash (XXH64 of the normalized name) in an open
+//		addressing table with linear probing, so FindEntry() is O(1). It is checksummed as
+//		a whole, a damaged table fails Open().
+constexpr uint32_t PACK_MAGIC = 0x4B505844; // "DXPK"
+constexpr uint32_t PACK_VERSION = 1;
+constexpr uint32_t PACK_BLOCK_SIZE = 64 * 1024;
+
+struct PackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t blockSize;
+	uint32_t entryCount;
+	uint32_t blockCount;
+	uint32_t bucketCount;
+	uint64_t tocOffset;
+	uint64_t tocSize;
+	// HashXXH64 of the table of contents.
+	uint64_t tocHash;
+};
+static_assert(sizeof(PackHeader) == 48, "PackHeader is read from disk as is.");
+
+struct PackEntry
+{
+	uint64_t nameHash;
+	// Uncompressed.
+	uint64_t size;
+	uint32_t firstBlock;
+	uint32_t blockCount;
+	// Into the names of the table of contents.
+	uint32_t nameOffset;
+	// How the entry was packed, blocks can still be stored (CompressionMethod::None).
+	CompressionMethod compression;
+	uint8_t reserved[3];
+};
+static_assert(sizeof(PackEntry) == 32, "PackEntry is read from disk as is.");
+
+struct PackBlock
+{
+	// From the start of the file.
+	uint64_t offset;
+	uint32_t compressedSize;
+	CompressionMethod compression;
+	uint8_t reserved[3];
+};
+static_assert(sizeof(PackBlock) == 16, "PackBlock is read from disk as is.");
+
+// Lower case, forward slashes, no leading "./" or "/" - "Meshes\\Cube.mesh" and
+//		"meshes/cube.mesh" are the same entry.
+std::string NormalizePackName(const std::string& name);
+
+// =====================================================================================
+//										Writer
+// =====================================================================================
+
+class PackFileWriter
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	PackFileWriter() = default;
+	PackFileWriter(const PackFileWriter&) = delete;
+	PackFileWriter& operator=(const PackFileWriter&) = delete;
+
+	// Copies the data. Returns false if an entry of that name exists already or the
+	//		compression method isn't supported by this build.
+	bool AddEntry(const std::string& name, const void* data, size_t size,
+		CompressionMethod compression = CompressionMethod::LZ4, int level = LZ4_LEVEL_FAST);
+
+	// Compresses all blocks - in parallel with a scheduler - and writes the pack.
+	//		Returns false on I/O errors.
+	bool Write(const char* path, TaskScheduler* scheduler = nullptr);
+
+	uint64_t GetUncompressedSize() const { return m_UncompressedSize; }
+	// Valid after Write().
+	uint64_t GetCompressedSize() const { return m_CompressedSize; }
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	struct PendingEntry
+	{
+		std::string name;
+		std::vector<uint8_t> data;
+		CompressionMethod compression;
+		int level;
+	};
+
+	std::vector<PendingEntry> m_Entries;
+	uint64_t m_UncompressedSize = 0;
+	uint64_t m_CompressedSize = 0;
+};
+
+// =====================================================================================
+//										Reader
+// =====================================================================================
+
+// Keeps the file open and the table of contents in memory. Reads are positional (pread /
+//		overlapped ReadFile), so any number of threads can read from one reader at once.
+//
+// Destinations may be upload heap memory (FrameUploadBuffer::Allocation::cpu, a mapped
+//		upload resource): the data is written to them sequentially and never read back.
+//		LZ4 and zstd do read back what they decoded (matches copy earlier output), which
+//		is very slow on write-combined memory - so compressed blocks are decoded into a
+//		per-task scratch block that stays in the cache, then copied out with one memcpy.
+//		Stored blocks are read straight into the destination.
+class PackFileReader
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	PackFileReader() = default;
+	~PackFileReader();
+	PackFileReader(const PackFileReader&) = delete;
+	PackFileReader& operator=(const PackFileReader&) = delete;
+
+	// False if the file can't be opened or isn't a valid pack.
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const { return m_File != INVALID_FILE; }
+
+	// nullptr if the pack has no entry of that name.
+	const PackEntry* FindEntry(const std::string& name) const;
+	uint32_t GetEntryCount() const { return m_Header.entryCount; }
+	const PackEntry& GetEntry(uint32_t index) const { return m_Entries[index]; }
+	const char* GetEntryName(const PackEntry& entry) const { return m_Names + entry.nameOffset; }
+
+	// Decompresses a whole entry into "destination" (entry.size bytes). With a scheduler
+	//		the blocks are spread over the workers and the call returns once all are done.
+	//		False on read errors or corrupted data.
+	bool ReadEntry(const PackEntry& entry, void* destination, TaskScheduler* scheduler = nullptr) const;
+
+	// Streaming: decompresses blocks [firstBlock, firstBlock + blockCount) of an entry on
+	//		the calling thread, to "destination" (their uncompressed bytes, contiguous).
+	//		Block i covers bytes [i * PACK_BLOCK_SIZE, (i + 1) * PACK_BLOCK_SIZE) of the entry.
+	bool ReadBlocks(const PackEntry& entry, uint32_t firstBlock, uint32_t blockCount, void* destination) const;
+
+private:
+	// Thread safe positional read of exactly "size" bytes.
+	bool ReadAt(uint64_t offset, void* destination, size_t size) const;
+	bool ReadBlock(const PackEntry& entry, uint32_t block, uint8_t* destination, std::vector<uint8_t>& compressed,
+		std::vector<uint8_t>& decompressed) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	static constexpr intptr_t INVALID_FILE = -1;
+
+	// HANDLE on Windows, file descriptor elsewhere.
+	intptr_t m_File = INVALID_FILE;
+
+	PackHeader m_Header = {};
+	std::vector<uint8_t> m_Toc;
+	const PackEntry* m_Entries = nullptr;
+	const PackBlock* m_Blocks = nullptr;
+	const uint32_t* m_Buckets = nullptr;
+	const char* m_Names = nullptr;
+	size_t m_NamesSize = 0;
+};
@@ -0,0 +1,300 @@
+#include "SceneHierarchy.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::max, std::fill
+#include <cassert>
+
+using namespace DirectX;
+
+
+constexpr uint32_t SceneHierarchy::INVALID_INDEX;
+
+namespace
+{
+	// Apply a permutation (newIndex[oldIndex]) to a per-node array.
+	template<typename T>
+	void Permute(std::vector<T>& array, const std::vector<uint32_t>& newIndex)
+	{
+		std::vector<T> permuted(array.size());
+		for (size_t i = 0; i < array.size(); ++i)
+		{
+			permuted[newIndex[i]] = array[i];
+		}
+		array.swap(permuted);
+	}
+}
+
+// =====================================================================================
+//									  Add & Remove
+// =====================================================================================
+
+NodeId SceneHierarchy::AddNode(NodeId parent, FXMMATRIX localTransform)
+{
+	uint32_t parentIndex = INVALID_INDEX;
+	if (parent != INVALID_NODE)
+	{
+		assert(IsValid(parent) && "Invalid parent node.");
+		parentIndex = m_IndexOf[parent];
+	}
+
+	NodeId id;
+	if (!m_FreeIds.empty())
+	{
+		id = m_FreeIds.back();
+		m_FreeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<NodeId>(m_IndexOf.size());
+		m_IndexOf.push_back(INVALID_INDEX);
+	}
+
+	// Appending keeps "parents before children" - only the level ranges break.
+	uint32_t index = static_cast<uint32_t>(m_Parent.size());
+	m_IndexOf[id] = index;
+	m_IdOf.push_back(id);
+	m_Parent.push_back(parentIndex);
+
+	XMFLOAT4X4 local;
+	XMStoreFloat4x4(&local, localTransform);
+	m_Local.push_back(local);
+	m_World.push_back(local);
+	m_LocalDirty.push_back(0);
+	m_WorldChanged.push_back(0);
+
+	m_LevelsDirty = true;
+	MarkDirty(index);
+
+	return id;
+}
+
+void SceneHierarchy::RemoveNode(NodeId node)
+{
+	if (!IsValid(node))
+		return;
+
+	// Parents come first, so one front to back pass finds the whole subtree.
+	const size_t count = m_Parent.size();
+	std::vector<uint8_t> removed(count, 0);
+	removed[m_IndexOf[node]] = 1;
+	for (size_t i = m_IndexOf[node] + 1; i < count; ++i)
+	{
+		if (m_Parent[i] != INVALID_INDEX && removed[m_Parent[i]])
+			removed[i] = 1;
+	}
+
+	// Compact, keeping the relative order (and therefore the parent-first property).
+	std::vector<uint32_t> newIndex(count, INVALID_INDEX);
+	uint32_t next = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (removed[i])
+		{
+			m_IndexOf[m_IdOf[i]] = INVALID_INDEX;
+			m_FreeIds.push_back(m_IdOf[i]);
+			continue;
+		}
+
+		newIndex[i] = next;
+		m_Parent[next] = m_Parent[i] == INVALID_INDEX ? INVALID_INDEX : newIndex[m_Parent[i]];
+		m_IdOf[next] = m_IdOf[i];
+		m_Local[next] = m_Local[i];
+		m_World[next] = m_World[i];
+		m_LocalDirty[next] = m_LocalDirty[i];
+		m_WorldChanged[next] = 0;
+		m_IndexOf[m_IdOf[next]] = next;
+		++next;
+	}
+
+	m_Parent.resize(next);
+	m_IdOf.resize(next);
+	m_Local.resize(next);
+	m_World.resize(next);
+	m_LocalDirty.resize(next);
+	m_WorldChanged.resize(next);
+
+	m_LevelsDirty = true;
+	m_FirstDirty = INVALID_INDEX;
+	for (uint32_t i = 0; i < next; ++i)
+	{
+		if (m_LocalDirty[i])
+		{
+			m_FirstDirty = i;
+			break;
+		}
+	}
+}
+
+void SceneHierarchy::RebuildLevels()
+{
+	const size_t count = m_Parent.size();
+
+	// Depth of every node - parents are already computed when a child is reached.
+	std::vector<uint32_t> depth(count);
+	uint32_t maxDepth = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		depth[i] = m_Parent[i] == INVALID_INDEX ? 0 : depth[m_Parent[i]] + 1;
+		maxDepth = std::max(maxDepth, depth[i]);
+	}
+
+	// Stable counting sort by depth.
+	m_LevelBegin.assign(count ? maxDepth + 2 : 1, 0);
+	for (size_t i = 0; i < count; ++i)
+		++m_LevelBegin[depth[i] + 1];
+	for (size_t d = 1; d < m_LevelBegin.size(); ++d)
+		m_LevelBegin[d] += m_LevelBegin[d - 1];
+
+	std::vector<uint32_t> cursor(m_LevelBegin.begin(), m_LevelBegin.end());
+	std::vector<uint32_t> newIndex(count);
+	for (size_t i = 0; i < count; ++i)
+		newIndex[i] = cursor[depth[i]]++;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (m_Parent[i] != INVALID_INDEX)
+			m_Parent[i] = newIndex[m_Parent[i]];
+	}
+
+	Permute(m_Parent, newIndex);
+	Permute(m_IdOf, newIndex);
+	Permute(m_Local, newIndex);
+	Permute(m_World, newIndex);
+	Permute(m_LocalDirty, newIndex);
+	Permute(m_WorldChanged, newIndex);
+
+	m_FirstDirty = INVALID_INDEX;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		m_IndexOf[m_IdOf[i]] = i;
+		if (m_LocalDirty[i] && m_FirstDirty == INVALID_INDEX)
+			m_FirstDirty = i;
+	}
+
+	m_LevelsDirty = false;
+}
+
+// =====================================================================================
+//									  Get and Set
+// =====================================================================================
+
+void SceneHierarchy::MarkDirty(uint32_t index)
+{
+	m_LocalDirty[index] = 1;
+	if (m_FirstDirty == INVALID_INDEX || index < m_FirstDirty)
+		m_FirstDirty = index;
+}
+
+void SceneHierarchy::SetLocalTransform(NodeId node, FXMMATRIX localTransform)
+{
+	assert(IsValid(node));
+	uint32_t index = m_IndexOf[node];
+	XMStoreFloat4x4(&m_Local[index], localTransform);
+	MarkDirty(index);
+}
+
+XMMATRIX SceneHierarchy::GetLocalTransform(NodeId node) const
+{
+	assert(IsValid(node));
+	return XMLoadFloat4x4(&m_Local[m_IndexOf[node]]);
+}
+
+XMMATRIX SceneHierarchy::GetWorldMatrix(NodeId node) const
+{
+	assert(IsValid(node));
+	return XMLoadFloat4x4(&m_World[m_IndexOf[node]]);
+}
+
+NodeId SceneHierarchy::GetParent(NodeId node) const
+{
+	assert(IsValid(node));
+	uint32_t parent = m_Parent[m_IndexOf[node]];
+	return parent == INVALID_INDEX ? INVALID_NODE : m_IdOf[parent];
+}
+
+// =====================================================================================
+//										Update
+// =====================================================================================
+
+void SceneHierarchy::Update(TaskScheduler* scheduler, size_t parallelThreshold)
+{
+	if (m_LevelsDirty)
+	{
+		RebuildLevels();
+	}
+
+	m_NumUpdated = 0;
+	if (m_FirstDirty == INVALID_INDEX)
+		return;
+
+	// Levels strictly in order - a level reads the world matrices of the previous one.
+	for (size_t d = 0; d + 1 < m_LevelBegin.size(); ++d)
+	{
+		size_t begin = std::max<size_t>(m_LevelBegin[d], m_FirstDirty);
+		size_t end = m_LevelBegin[d + 1];
+		if (begin < end)
+		{
+			UpdateLevel(begin, end, scheduler, parallelThreshold);
+		}
+	}
+
+	// Nothing before m_FirstDirty was touched.
+	std::fill(m_LocalDirty.begin() + m_FirstDirty, m_LocalDirty.end(), 0);
+	std::fill(m_WorldChanged.begin() + m_FirstDirty, m_WorldChanged.end(), 0);
+	m_FirstDirty = INVALID_INDEX;
+}
+
+void SceneHierarchy::UpdateAll(TaskScheduler* scheduler)
+{
+	if (m_Parent.empty())
+		return;
+
+	std::fill(m_LocalDirty.begin(), m_LocalDirty.end(), 1);
+	m_FirstDirty = 0;
+	Update(scheduler, 4096);
+}
+
+void SceneHierarchy::UpdateLevel(size_t begin, size_t end, TaskScheduler* scheduler, size_t parallelThreshold)
+{
+	// 1) Find the changed nodes of the level (cheap flag checks only).
+	m_Changed.clear();
+	for (size_t i = begin; i < end; ++i)
+	{
+		uint32_t parent = m_Parent[i];
+		uint8_t changed = m_LocalDirty[i] | (parent != INVALID_INDEX ? m_WorldChanged[parent] : 0);
+		m_WorldChanged[i] = changed;
+		if (changed)
+		{
+			m_Changed.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	m_NumUpdated += m_Changed.size();
+
+	// 2) Batched matrix multiplies over the changed nodes only.
+	auto multiply = [this](size_t first, size_t last) {
+		for (size_t k = first; k < last; ++k)
+		{
+			uint32_t i = m_Changed[k];
+			uint32_t parent = m_Parent[i];
+
+			XMMATRIX local = XMLoadFloat4x4(&m_Local[i]);
+			if (parent == INVALID_INDEX)
+			{
+				XMStoreFloat4x4(&m_World[i], local);
+			}
+			else
+			{
+				XMStoreFloat4x4(&m_World[i], XMMatrixMultiply(local, XMLoadFloat4x4(&m_World[parent])));
+			}
+		}
+	};
+
+	if (scheduler && m_Changed.size() >= parallelThreshold)
+	{
+		scheduler->ParallelFor(0, m_Changed.size(), 1024, multiply);
+	}
+	else
+	{
+		multiply(0, m_Changed.size());
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Scene hierarchy
+// =====================================================================================
+
+// Parent/child transform hierarchy with incremental world matrix updates.
+//
+// Layout:
+//		All nodes live in flat arrays sorted breadth-first - every depth level is one
+//		contiguous range and parents always come before their children. The world matrix
+//		of a node is then simply local * world[parent], evaluated front to back, and all
+//		nodes of a level can be processed in parallel.
+//
+// Dirty propagation:
+//		SetLocalTransform() only flags the node. Update() walks the levels starting at the
+//		first dirty node; a node is recomputed if it is dirty itself or its parent's world
+//		matrix changed this update, so only the changed subtrees are touched. If nothing
+//		is dirty Update() returns right away - static scenery costs nothing per frame.
+//
+// Node ids are stable handles; array indices change whenever nodes are added or removed.
+typedef uint32_t NodeId;
+constexpr NodeId INVALID_NODE = 0xFFFFFFFFu;
+
+class SceneHierarchy
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	NodeId AddNode(NodeId parent, DirectX::FXMMATRIX localTransform);
+	// Removes the node and its whole subtree.
+	void RemoveNode(NodeId node);
+	bool IsValid(NodeId node) const { return node < m_IndexOf.size() && m_IndexOf[node] != INVALID_INDEX; }
+
+	void SetLocalTransform(NodeId node, DirectX::FXMMATRIX localTransform);
+	DirectX::XMMATRIX GetLocalTransform(NodeId node) const;
+	// Valid after Update().
+	DirectX::XMMATRIX GetWorldMatrix(NodeId node) const;
+	NodeId GetParent(NodeId node) const;
+
+	// Recompute the world matrices of every changed subtree.
+	//		Levels with at least "parallelThreshold" changed nodes are split over the scheduler.
+	void Update(TaskScheduler* scheduler = nullptr, size_t parallelThreshold = 4096);
+	// Recompute every world matrix, dirty or not (reference path).
+	void UpdateAll(TaskScheduler* scheduler = nullptr);
+
+	size_t GetNodeCount() const { return m_Parent.size(); }
+	size_t GetLevelCount() const { return m_LevelBegin.empty() ? 0 : m_LevelBegin.size() - 1; }
+	// Number of world matrices recomputed by the last Update().
+	size_t GetNumUpdatedLastFrame() const { return m_NumUpdated; }
+
+private:
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+	void MarkDirty(uint32_t index);
+	// Re-sort the arrays breadth-first and rebuild the level ranges.
+	void RebuildLevels();
+	void UpdateLevel(size_t begin, size_t end, TaskScheduler* scheduler, size_t parallelThreshold);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	// Per node, breadth-first order.
+	std::vector<uint32_t> m_Parent;			// index of the parent or INVALID_INDEX
+	std::vector<NodeId> m_IdOf;				// index -> id
+	std::vector<DirectX::XMFLOAT4X4> m_Local;
+	std::vector<DirectX::XMFLOAT4X4> m_World;
+	std::vector<uint8_t> m_LocalDirty;
+	std::vector<uint8_t> m_WorldChanged;	// set during Update(), cleared at its end
+
+	// Per id.
+	std::vector<uint32_t> m_IndexOf;		// id -> index or INVALID_INDEX
+	std::vector<NodeId> m_FreeIds;
+
+	// m_LevelBegin[d] is the first index of depth d, the last entry is the node count.
+	std::vector<uint32_t> m_LevelBegin;
+	bool m_LevelsDirty = false;
+
+	// Nothing before this index is dirty (parents come first, so nothing before it can change).
+	uint32_t m_FirstDirty = INVALID_INDEX;
+	size_t m_NumUpdated = 0;
+
+	// Changed nodes of the level being updated - kept to avoid per-frame allocations.
+	std::vector<uint32_t> m_Changed;
+};
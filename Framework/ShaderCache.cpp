@@ -0,0 +1,408 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <algorithm> // std::find
+#include <chrono>
+#include <cstdio>
+#include <cstring>   // std::memcpy
+#include <functional> // std::hash
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+
+namespace
+{
+	constexpr uint32_t SHADER_CACHE_MAGIC = 0x43535844; // "DXSC"
+	// Bump when the key or the entry layout changes - old entries are never found again.
+	constexpr uint32_t SHADER_CACHE_VERSION = 2;
+
+	struct ShaderCacheEntryHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		// Guards against a truncated, foreign or colliding file.
+		uint64_t key;
+		uint64_t bytecodeSize;
+		uint64_t bytecodeHash;
+	};
+	static_assert(sizeof(ShaderCacheEntryHeader) == 32, "ShaderCacheEntryHeader is read from disk as is.");
+
+	bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& contents)
+	{
+		MappedFile file;
+		if (!file.Open(path.c_str()))
+			return false;
+		contents.assign(file.GetData(), file.GetData() + file.GetSize());
+		return true;
+	}
+
+#if defined(_WIN32)
+	std::wstring ToWide(const std::string& text)
+	{
+		const int length = ::MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, nullptr, 0);
+		std::vector<wchar_t> wide(length > 0 ? length : 1, L'\0');
+		::MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, wide.data(), length);
+		return std::wstring(wide.data());
+	}
+#endif
+
+	// Creates every missing directory of "path" (a directory).
+	void CreateDirectories(const std::string& path)
+	{
+		for (size_t end = 0; end != std::string::npos;)
+		{
+			end = path.find_first_of("/\\", end + 1);
+			const std::string directory = path.substr(0, end);
+			if (directory.empty())
+				continue;
+#if defined(_WIN32)
+			::CreateDirectoryW(ToWide(directory).c_str(), nullptr);
+#else
+			::mkdir(directory.c_str(), 0755);
+#endif
+		}
+	}
+
+	// Writes to a temporary file, then renames it over "path": readers (another instance
+	//		of the game) see the old file or the complete new one, never a partial write.
+	bool WriteFileAtomic(const std::string& path, const void* header, size_t headerSize, const void* data, size_t size)
+	{
+		char suffix[32];
+		std::snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+		const std::string temporary = path + suffix;
+
+#if defined(_WIN32)
+		FILE* file = ::_wfopen(ToWide(temporary).c_str(), L"wb");
+#else
+		FILE* file = std::fopen(temporary.c_str(), "wb");
+#endif
+		if (!file)
+			return false;
+		const bool written = std::fwrite(header, 1, headerSize, file) == headerSize &&
+			std::fwrite(data, 1, size, file) == size;
+		const bool closed = std::fclose(file) == 0;
+
+#if defined(_WIN32)
+		const bool renamed = written && closed &&
+			::MoveFileExW(ToWide(temporary).c_str(), ToWide(path).c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+		const bool renamed = written && closed && std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+		if (!renamed)
+			std::remove(temporary.c_str());
+		return renamed;
+	}
+
+	std::string GetDirectory(const std::string& path)
+	{
+		const size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? std::string() : path.substr(0, separator);
+	}
+
+	std::string JoinPath(const std::string& directory, const std::string& name)
+	{
+		return directory.empty() ? name : directory + "/" + name;
+	}
+
+	void HashString(StreamingHash64& hash, const std::string& text)
+	{
+		hash.UpdateValue(uint64_t(text.size()));
+		hash.Update(text.data(), text.size());
+	}
+
+	struct IncludeDirective
+	{
+		std::string name;
+		// "name" (searched next to the including file first) or <name>.
+		bool quoted;
+	};
+
+	// The #include directives of an HLSL file, in order. Comments are skipped; #if blocks
+	//		are not evaluated.
+	std::vector<IncludeDirective> FindIncludes(const uint8_t* text, size_t size)
+	{
+		std::vector<IncludeDirective> includes;
+		bool lineStart = true;
+		size_t i = 0;
+		while (i < size)
+		{
+			const char c = char(text[i]);
+			const char next = i + 1 < size ? char(text[i + 1]) : '\0';
+			if (c == '/' && next == '/')
+			{
+				while (i < size && text[i] != '\n')
+					++i;
+				continue;
+			}
+			if (c == '/' && next == '*')
+			{
+				i += 2;
+				while (i + 1 < size && !(text[i] == '*' && text[i + 1] == '/'))
+					++i;
+				i += 2;
+				continue;
+			}
+			if (c == '\n')
+			{
+				lineStart = true;
+				++i;
+				continue;
+			}
+			if (c == ' ' || c == '\t' || c == '\r')
+			{
+				++i;
+				continue;
+			}
+
+			if (c == '#' && lineStart)
+			{
+				size_t j = i + 1;
+				while (j < size && (text[j] == ' ' || text[j] == '\t'))
+					++j;
+				if (size - j >= 7 && std::memcmp(text + j, "include", 7) == 0)
+				{
+					j += 7;
+					while (j < size && (text[j] == ' ' || text[j] == '\t'))
+						++j;
+					if (j < size && (text[j] == '"' || text[j] == '<'))
+					{
+						const char close = text[j] == '"' ? '"' : '>';
+						const size_t begin = j + 1;
+						size_t end = begin;
+						while (end < size && text[end] != close && text[end] != '\n')
+							++end;
+						if (end < size && text[end] == close)
+						{
+							includes.push_back({ std::string(reinterpret_cast<const char*>(text + begin), end - begin), close == '"' });
+						}
+					}
+				}
+			}
+
+			lineStart = false;
+			++i;
+		}
+		return includes;
+	}
+}
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+ShaderCache::ShaderCache(const std::string& directory, std::shared_ptr<ShaderCompiler> compiler,
+	const std::vector<std::string>& includeDirectories) :
+	m_Directory(directory),
+	m_Compiler(compiler),
+	m_IncludeDirectories(includeDirectories)
+{
+}
+
+ShaderCache::Statistics ShaderCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Statistics;
+}
+
+// =====================================================================================
+//										Keys
+// =====================================================================================
+
+bool ShaderCache::ResolveInclude(const std::string& includingPath, const std::string& name, bool quoted,
+	std::string& resolvedPath, std::vector<uint8_t>& contents) const
+{
+	// The compiler's search order: next to the including file for "name", then the
+	//		include directories.
+	if (quoted)
+	{
+		resolvedPath = JoinPath(GetDirectory(includingPath), name);
+		if (ReadWholeFile(resolvedPath, contents))
+			return true;
+	}
+	for (const std::string& directory : m_IncludeDirectories)
+	{
+		resolvedPath = JoinPath(directory, name);
+		if (ReadWholeFile(resolvedPath, contents))
+			return true;
+	}
+	return false;
+}
+
+void ShaderCache::HashIncludes(StreamingHash64& hash, const std::string& path, const uint8_t* source, size_t size,
+	std::vector<std::string>& visited) const
+{
+	for (const IncludeDirective& include : FindIncludes(source, size))
+	{
+		HashString(hash, include.name);
+
+		std::string resolvedPath;
+		std::vector<uint8_t> contents;
+		if (!ResolveInclude(path, include.name, include.quoted, resolvedPath, contents))
+		{
+			// Missing: the compile fails (or the include is inactive) - creating the file
+			//		later changes the key.
+			hash.UpdateValue(uint8_t(0));
+			continue;
+		}
+
+		// Include guards / #pragma once: a file's contents count once.
+		if (std::find(visited.begin(), visited.end(), resolvedPath) != visited.end())
+		{
+			hash.UpdateValue(uint8_t(1));
+			continue;
+		}
+		visited.push_back(resolvedPath);
+
+		hash.UpdateValue(uint8_t(2));
+		hash.UpdateValue(uint64_t(contents.size()));
+		hash.Update(contents.data(), contents.size());
+		HashIncludes(hash, resolvedPath, contents.data(), contents.size(), visited);
+	}
+}
+
+bool ShaderCache::ComputeKey(const ShaderDesc& desc, uint64_t& key, std::vector<uint8_t>* source) const
+{
+	std::vector<uint8_t> contents;
+	if (!ReadWholeFile(desc.path, contents))
+		return false;
+
+	StreamingHash64 hash(SHADER_CACHE_VERSION);
+	HashString(hash, m_Compiler ? m_Compiler->GetVersion() : std::string());
+	HashString(hash, ShaderCompiler::GetTargetProfile(desc.stage));
+	HashString(hash, ShaderCompiler::GetLanguageVersion());
+	HashString(hash, desc.entryPoint);
+	hash.UpdateValue(uint8_t(desc.debug ? 1 : 0));
+	hash.UpdateValue(uint64_t(desc.defines.size()));
+	for (const ShaderDefine& define : desc.defines)
+	{
+		HashString(hash, define.name);
+		HashString(hash, define.value);
+	}
+
+	hash.UpdateValue(uint64_t(contents.size()));
+	hash.Update(contents.data(), contents.size());
+	std::vector<std::string> visited(1, desc.path);
+	HashIncludes(hash, desc.path, contents.data(), contents.size(), visited);
+
+	key = hash.Digest();
+	if (source)
+		source->swap(contents);
+	return true;
+}
+
+// =====================================================================================
+//										Entries
+// =====================================================================================
+
+std::string ShaderCache::GetEntryPath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.dxil", static_cast<unsigned long long>(key));
+	return JoinPath(m_Directory, name);
+}
+
+bool ShaderCache::LoadEntry(uint64_t key, std::vector<uint8_t>& bytecode) const
+{
+	MappedFile file;
+	if (!file.Open(GetEntryPath(key).c_str()) || file.GetSize() < sizeof(ShaderCacheEntryHeader))
+		return false;
+
+	ShaderCacheEntryHeader header;
+	std::memcpy(&header, file.GetData(), sizeof(header));
+	const uint8_t* data = file.GetData() + sizeof(header);
+	if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION || header.key != key ||
+		header.bytecodeSize != file.GetSize() - sizeof(header) ||
+		HashXXH64(data, size_t(header.bytecodeSize)) != header.bytecodeHash)
+		return false;
+
+	bytecode.assign(data, data + header.bytecodeSize);
+	return true;
+}
+
+void ShaderCache::StoreEntry(uint64_t key, const std::vector<uint8_t>& bytecode) const
+{
+	ShaderCacheEntryHeader header;
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.bytecodeSize = bytecode.size();
+	header.bytecodeHash = HashXXH64(bytecode.data(), bytecode.size());
+
+	CreateDirectories(m_Directory);
+	WriteFileAtomic(GetEntryPath(key), &header, sizeof(header), bytecode.data(), bytecode.size());
+}
+
+// =====================================================================================
+//										GetShader
+// =====================================================================================
+
+ShaderBytecode ShaderCache::GetShader(const ShaderDesc& desc)
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+	std::vector<uint8_t> bytecode;
+	// Incremented under the lock once the shader is there.
+	uint32_t* counter = nullptr;
+	uint64_t key = 0;
+
+	if (m_Compiler && m_Compiler->IsAvailable())
+	{
+		std::vector<uint8_t> source;
+		if (!ComputeKey(desc, key, &source))
+			throw std::runtime_error("can't read " + desc.path);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			auto found = m_Loaded.find(key);
+			if (found != m_Loaded.end())
+			{
+				++m_Statistics.memoryHits;
+				m_Statistics.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+				return found->second;
+			}
+		}
+
+		if (LoadEntry(key, bytecode))
+		{
+			counter = &m_Statistics.diskHits;
+		}
+		else
+		{
+			std::string messages;
+			if (!m_Compiler->Compile(desc, source.data(), source.size(), m_IncludeDirectories, bytecode, messages))
+				throw std::runtime_error(desc.path + ": " + messages);
+			StoreEntry(key, bytecode);
+			counter = &m_Statistics.compiled;
+		}
+	}
+	else
+	{
+		// The build's FXC output, "Shaders/Name.hlsl" -> "Name.cso".
+		std::string name = desc.path.substr(desc.path.find_last_of("/\\") + 1);
+		name = name.substr(0, name.find_last_of('.')) + ".cso";
+		if (!ReadWholeFile(name, bytecode))
+			throw std::runtime_error("no shader compiler and no " + name);
+		counter = &m_Statistics.precompiled;
+	}
+
+	ShaderBytecode shader = std::make_shared<const std::vector<uint8_t>>(std::move(bytecode));
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (counter != &m_Statistics.precompiled)
+		m_Loaded.emplace(key, shader);
+	++*counter;
+	m_Statistics.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+	return shader;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderCompiler.h"
+
+class StreamingHash64;
+
+// Compiled shader, shared by everyone who asked for it.
+typedef std::shared_ptr<const std::vector<uint8_t>> ShaderBytecode;
+
+// =====================================================================================
+//										Shader cache
+// =====================================================================================
+
+// Compiles shaders on demand and keeps the bytecode on disk, so only the first start (or
+//		the first after an edit) pays for compilation.
+//
+// Bytecode is keyed by XXH64 over everything the output depends on:
+//		- the source file,
+//		- every file it includes, recursively (#include lines are scanned in the source;
+//		  includes in inactive #if blocks count too, which can only cause a recompile),
+//		- entry point, target profile, HLSL version, defines and the debug flag,
+//		- the compiler version (ShaderCompiler::GetVersion) and the cache format.
+//
+//		<directory>/<key>.dxil		header + bytecode, written atomically
+//
+// So an edited shader or include is compiled again, and reverting the edit finds the old
+//		entry. Sources are read on every GetShader() call to compute the key; that costs
+//		microseconds, compiling costs tens of milliseconds.
+//
+// Without the compiler (no dxcompiler library), GetShader() loads "<name>.cso" from the
+//		working directory - the bytecode the build compiled with FXC.
+//
+// All member functions are thread safe.
+class ShaderCache
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	struct Statistics
+	{
+		// Found in memory / on disk, compiled, loaded from a .cso file.
+		uint32_t memoryHits = 0;
+		uint32_t diskHits = 0;
+		uint32_t compiled = 0;
+		uint32_t precompiled = 0;
+		// Time spent in GetShader() - cold starts compile, warm starts only read files.
+		double seconds = 0.0;
+	};
+
+	// "directory" is created on first store. Includes are searched next to the including
+	//		file, then in "includeDirectories".
+	ShaderCache(const std::string& directory, std::shared_ptr<ShaderCompiler> compiler,
+		const std::vector<std::string>& includeDirectories = std::vector<std::string>());
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	// Throws std::runtime_error (with the compiler's messages) if the shader can't be
+	//		compiled or loaded.
+	ShaderBytecode GetShader(const ShaderDesc& desc);
+
+	// The cache key of "desc"; "source" receives the shader's source. False if the source
+	//		file can't be read.
+	bool ComputeKey(const ShaderDesc& desc, uint64_t& key, std::vector<uint8_t>* source = nullptr) const;
+
+	Statistics GetStatistics() const;
+
+private:
+	void HashIncludes(StreamingHash64& hash, const std::string& path, const uint8_t* source, size_t size,
+		std::vector<std::string>& visited) const;
+	bool ResolveInclude(const std::string& includingPath, const std::string& name, bool quoted,
+		std::string& resolvedPath, std::vector<uint8_t>& contents) const;
+
+	std::string GetEntryPath(uint64_t key) const;
+	bool LoadEntry(uint64_t key, std::vector<uint8_t>& bytecode) const;
+	// Failures are ignored - the cache only saves time.
+	void StoreEntry(uint64_t key, const std::vector<uint8_t>& bytecode) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	std::string m_Directory;
+	std::shared_ptr<ShaderCompiler> m_Compiler;
+	std::vector<std::string> m_IncludeDirectories;
+
+	mutable std::mutex m_Mutex;
+	// Key -> bytecode, for shaders requested more than once.
+	std::unordered_map<uint64_t, ShaderBytecode> m_Loaded;
+	Statistics m_Statistics;
+};
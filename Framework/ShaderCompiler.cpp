@@ -0,0 +1,276 @@
+#include "ShaderCompiler.h"
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "../ThirdParty/dxc/dxcapi.h"
+
+
+namespace
+{
+	// Owning pointer to a DXC interface - WRL's ComPtr doesn't exist on Linux.
+	template<typename T>
+	class DxcRef
+	{
+	public:
+		DxcRef() = default;
+		explicit DxcRef(T* pointer) : m_Pointer(pointer) {}
+		~DxcRef() { Reset(); }
+		DxcRef(const DxcRef&) = delete;
+		DxcRef& operator=(const DxcRef&) = delete;
+
+		T* Get() const { return m_Pointer; }
+		T* operator->() const { return m_Pointer; }
+		// For out parameters: releases the current interface.
+		T** Put() { Reset(); return &m_Pointer; }
+		T* Detach() { T* pointer = m_Pointer; m_Pointer = nullptr; return pointer; }
+		void Reset()
+		{
+			if (m_Pointer)
+				m_Pointer->Release();
+			m_Pointer = nullptr;
+		}
+
+	private:
+		T* m_Pointer = nullptr;
+	};
+
+	// DXC takes wide strings: UTF-16 on Windows, UTF-32 (wchar_t) on Linux.
+	std::wstring ToWide(const std::string& text)
+	{
+#if defined(_WIN32)
+		const int length = ::MultiByteToWideChar(CP_UTF8, 0, text.c_str(), int(text.size()), nullptr, 0);
+		std::wstring wide(size_t(length > 0 ? length : 0), L'\0');
+		if (length > 0)
+			::MultiByteToWideChar(CP_UTF8, 0, text.c_str(), int(text.size()), &wide[0], length);
+		return wide;
+#else
+		std::wstring wide;
+		wide.reserve(text.size());
+		for (size_t i = 0; i < text.size();)
+		{
+			const uint8_t lead = uint8_t(text[i]);
+			const size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : 4;
+			uint32_t codePoint = length == 1 ? lead : length == 2 ? (lead & 0x1F) : length == 3 ? (lead & 0x0F) : (lead & 0x07);
+			for (size_t k = 1; k < length && i + k < text.size(); ++k)
+			{
+				codePoint = (codePoint << 6) | (uint8_t(text[i + k]) & 0x3F);
+			}
+			wide.push_back(wchar_t(codePoint));
+			i += length;
+		}
+		return wide;
+#endif
+	}
+
+	void* LoadCompilerLibrary()
+	{
+#if defined(_WIN32)
+		return ::LoadLibraryW(L"dxcompiler.dll");
+#else
+		return ::dlopen("libdxcompiler.so", RTLD_NOW | RTLD_LOCAL);
+#endif
+	}
+
+	void FreeCompilerLibrary(void* library)
+	{
+#if defined(_WIN32)
+		::FreeLibrary(static_cast<HMODULE>(library));
+#else
+		::dlclose(library);
+#endif
+	}
+
+	DxcCreateInstanceProc GetCreateInstance(void* library)
+	{
+#if defined(_WIN32)
+		return reinterpret_cast<DxcCreateInstanceProc>(::GetProcAddress(static_cast<HMODULE>(library), "DxcCreateInstance"));
+#else
+		return reinterpret_cast<DxcCreateInstanceProc>(::dlsym(library, "DxcCreateInstance"));
+#endif
+	}
+}
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+ShaderCompiler::ShaderCompiler()
+{
+	m_Library = LoadCompilerLibrary();
+	if (!m_Library)
+		return;
+
+	DxcCreateInstanceProc createInstance = GetCreateInstance(m_Library);
+	DxcRef<IDxcUtils> utils;
+	DxcRef<IDxcCompiler3> compiler;
+	DxcRef<IDxcIncludeHandler> includeHandler;
+	if (!createInstance ||
+		FAILED(createInstance(CLSID_DxcUtils, IID_PPV_ARGS(utils.Put()))) ||
+		FAILED(createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(compiler.Put()))) ||
+		FAILED(utils->CreateDefaultIncludeHandler(includeHandler.Put())))
+	{
+		FreeCompilerLibrary(m_Library);
+		m_Library = nullptr;
+		return;
+	}
+
+	// Version and commit - two builds with the same version number can differ.
+	UINT32 major = 0;
+	UINT32 minor = 0;
+	UINT32 commitCount = 0;
+	char* commitHash = nullptr;
+	DxcRef<IDxcVersionInfo> versionInfo;
+	if (SUCCEEDED(compiler->QueryInterface(IID_PPV_ARGS(versionInfo.Put()))))
+	{
+		versionInfo->GetVersion(&major, &minor);
+	}
+	DxcRef<IDxcVersionInfo2> versionInfo2;
+	if (SUCCEEDED(compiler->QueryInterface(IID_PPV_ARGS(versionInfo2.Put()))))
+	{
+		versionInfo2->GetCommitInfo(&commitCount, &commitHash);
+	}
+
+	char version[64];
+	std::snprintf(version, sizeof(version), "%u.%u.%u.", major, minor, commitCount);
+	m_Version = version;
+	if (commitHash)
+	{
+		m_Version += commitHash;
+		CoTaskMemFree(commitHash);
+	}
+
+	m_Utils = utils.Detach();
+	m_Compiler = compiler.Detach();
+	m_IncludeHandler = includeHandler.Detach();
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	if (m_IncludeHandler)
+		static_cast<IDxcIncludeHandler*>(m_IncludeHandler)->Release();
+	if (m_Compiler)
+		static_cast<IDxcCompiler3*>(m_Compiler)->Release();
+	if (m_Utils)
+		static_cast<IDxcUtils*>(m_Utils)->Release();
+	if (m_Library)
+		FreeCompilerLibrary(m_Library);
+}
+
+const char* ShaderCompiler::GetTargetProfile(ShaderStage stage)
+{
+	switch (stage)
+	{
+	case ShaderStage::Vertex:
+		return "vs_6_0";
+	case ShaderStage::Pixel:
+		return "ps_6_0";
+	case ShaderStage::Compute:
+		return "cs_6_0";
+	}
+	return "";
+}
+
+const char* ShaderCompiler::GetLanguageVersion()
+{
+	return "2021";
+}
+
+// =====================================================================================
+//										Compile
+// =====================================================================================
+
+bool ShaderCompiler::Compile(const ShaderDesc& desc, const void* source, size_t size,
+	const std::vector<std::string>& includeDirectories,
+	std::vector<uint8_t>& bytecode, std::string& messages) const
+{
+	bytecode.clear();
+	messages.clear();
+	if (!IsAvailable())
+	{
+		messages = "dxcompiler is not available";
+		return false;
+	}
+
+	// The source name comes first: errors refer to it, and #include "..." is resolved
+	//		next to it.
+	std::vector<std::wstring> arguments;
+	arguments.push_back(ToWide(desc.path));
+	arguments.push_back(L"-E");
+	arguments.push_back(ToWide(desc.entryPoint));
+	arguments.push_back(L"-T");
+	arguments.push_back(ToWide(GetTargetProfile(desc.stage)));
+	arguments.push_back(L"-HV");
+	arguments.push_back(ToWide(GetLanguageVersion()));
+	for (const std::string& directory : includeDirectories)
+	{
+		arguments.push_back(L"-I");
+		arguments.push_back(ToWide(directory));
+	}
+	for (const ShaderDefine& define : desc.defines)
+	{
+		arguments.push_back(L"-D");
+		arguments.push_back(ToWide(define.value.empty() ? define.name : define.name + "=" + define.value));
+	}
+	if (desc.debug)
+	{
+		arguments.push_back(L"-Od");
+		arguments.push_back(L"-Zi");
+		arguments.push_back(L"-Qembed_debug");
+	}
+	else
+	{
+		arguments.push_back(L"-O3");
+		// Root signatures are built in code, nothing reads the reflection data.
+		arguments.push_back(L"-Qstrip_reflect");
+	}
+
+	std::vector<LPCWSTR> argumentPointers;
+	for (const std::wstring& argument : arguments)
+	{
+		argumentPointers.push_back(argument.c_str());
+	}
+
+	DxcBuffer buffer;
+	buffer.Ptr = source;
+	buffer.Size = size;
+	buffer.Encoding = DXC_CP_UTF8;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	IDxcCompiler3* compiler = static_cast<IDxcCompiler3*>(m_Compiler);
+	DxcRef<IDxcResult> result;
+	if (FAILED(compiler->Compile(&buffer, argumentPointers.data(), UINT32(argumentPointers.size()),
+		static_cast<IDxcIncludeHandler*>(m_IncludeHandler), IID_PPV_ARGS(result.Put()))))
+	{
+		messages = "dxcompiler failed to run";
+		return false;
+	}
+
+	DxcRef<IDxcBlobUtf8> errors;
+	if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(errors.Put()), nullptr)) &&
+		errors.Get() && errors->GetStringLength() > 0)
+	{
+		messages.assign(errors->GetStringPointer(), errors->GetStringLength());
+	}
+
+	HRESULT status = E_FAIL;
+	result->GetStatus(&status);
+	DxcRef<IDxcBlob> object;
+	if (FAILED(status) || FAILED(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(object.Put()), nullptr)) || !object.Get())
+		return false;
+
+	const uint8_t* data = static_cast<const uint8_t*>(object->GetBufferPointer());
+	bytecode.assign(data, data + object->GetBufferSize());
+	return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// =====================================================================================
+//										Shader compiler
+// =====================================================================================
+
+enum class ShaderStage : uint8_t
+{
+	Vertex,
+	Pixel,
+	Compute,
+};
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// One shader: a source file, its entry point and the macros it is compiled with.
+struct ShaderDesc
+{
+	// UTF-8, relative to the working directory or absolute.
+	std::string path;
+	std::string entryPoint = "main";
+	ShaderStage stage = ShaderStage::Vertex;
+	std::vector<ShaderDefine> defines;
+	// No optimizations, embedded debug info (PIX).
+	bool debug = false;
+};
+
+// HLSL -> DXIL through DXC (dxcompiler.dll / libdxcompiler.so - the same compiler on
+//		Windows and Linux). The library is loaded at runtime, so nothing links against it:
+//		without it IsAvailable() is false and ShaderCache falls back to the .cso files the
+//		build compiled. DXIL is only accepted by D3D12 when signed - dxil.dll (next to
+//		dxcompiler.dll) signs it.
+//
+// Shaders are compiled for shader model 6.0, the first with DXIL, as HLSL 2021; Compile()
+//		is thread safe (one compilation at a time).
+class ShaderCompiler
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	ShaderCompiler();
+	~ShaderCompiler();
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+	bool IsAvailable() const { return m_Compiler != nullptr; }
+	// "<major>.<minor>.<commit count>.<commit hash>" - identifies the compiler build, so a
+	//		different compiler doesn't reuse bytecode cached by another one.
+	const std::string& GetVersion() const { return m_Version; }
+	// "vs_6_0", ...
+	static const char* GetTargetProfile(ShaderStage stage);
+	// HLSL language version passed with -HV. Pinned rather than left to the compiler's
+	//		default, which changed from 2018 to 2021 in DXC 1.7.
+	static const char* GetLanguageVersion();
+
+	// Compiles "source" (the contents of desc.path). Includes are searched next to the
+	//		including file, then in "includeDirectories". False on errors; "messages" gets
+	//		the errors and warnings either way.
+	bool Compile(const ShaderDesc& desc, const void* source, size_t size,
+		const std::vector<std::string>& includeDirectories,
+		std::vector<uint8_t>& bytecode, std::string& messages) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	// HMODULE / dlopen handle, IDxcUtils*, IDxcCompiler3*, IDxcIncludeHandler* -
+	//		dxcapi.h stays out of the header.
+	void* m_Library = nullptr;
+	void* m_Utils = nullptr;
+	void* m_Compiler = nullptr;
+	void* m_IncludeHandler = nullptr;
+	std::string m_Version;
+
+	mutable std::mutex m_Mutex;
+};
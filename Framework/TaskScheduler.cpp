@@ -0,0 +1,327 @@
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::max
+
+
+// =====================================================================================
+//										Globals
+// =====================================================================================
+
+namespace
+{
+	// Which scheduler (and which of its queues) the calling thread belongs to.
+	thread_local TaskScheduler* t_Scheduler = nullptr;
+	thread_local int32_t t_ThreadIndex = -1;
+
+	// Number of failed find attempts before a worker goes to sleep.
+	constexpr int NUM_SPINS_BEFORE_SLEEP = 64;
+}
+
+// =====================================================================================
+//									   Task group
+// =====================================================================================
+
+TaskGroup::~TaskGroup()
+{
+	// Tasks still referencing the group would write to freed memory.
+	Wait();
+
+	// The last finishing task may still be inside OnTaskFinished() holding the lock -
+	//		wait for it to leave before the mutex is destroyed.
+	std::lock_guard<std::mutex> lock(m_ContinuationMutex);
+}
+
+void TaskGroup::Run(std::function<void()> task)
+{
+	m_Pending.fetch_add(1, std::memory_order_relaxed);
+	m_Scheduler.Spawn(this, std::move(task));
+}
+
+void TaskGroup::Wait()
+{
+	// The waiting thread keeps executing tasks instead of blocking. This is what makes
+	//		nested waits (a task waiting on a group it spawned) safe: the waiter can never
+	//		starve the workers, it only adds one more thread to the pool.
+	while (!IsIdle())
+	{
+		if (!m_Scheduler.TryRunOneTask())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void TaskGroup::Then(std::function<void()> continuation)
+{
+	std::lock_guard<std::mutex> lock(m_ContinuationMutex);
+	if (IsIdle())
+	{
+		m_Scheduler.Spawn(std::move(continuation));
+	}
+	else
+	{
+		assert(!m_Continuation && "Only one continuation per task group is supported.");
+		m_Continuation = std::move(continuation);
+	}
+}
+
+void TaskGroup::OnTaskFinished()
+{
+	// Once the count reaches zero a waiter may return and destroy the group,
+	//		so nothing but locals may be touched after the decrement.
+	TaskScheduler& scheduler = m_Scheduler;
+
+	std::function<void()> continuation;
+	{
+		std::lock_guard<std::mutex> lock(m_ContinuationMutex);
+		if (m_Pending.load(std::memory_order_relaxed) == 1)
+		{
+			continuation = std::move(m_Continuation);
+			m_Continuation = nullptr;
+		}
+		m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	if (continuation)
+	{
+		scheduler.Spawn(std::move(continuation));
+	}
+}
+
+// =====================================================================================
+//										Init
+// =====================================================================================
+
+TaskScheduler::TaskScheduler(uint32_t numWorkerThreads, std::function<void(uint32_t)> onWorkerStart)
+	: m_OnWorkerStart(std::move(onWorkerStart))
+	, m_NumSleeping(0)
+	, m_NumQueued(0)
+	, m_Running(true)
+{
+	if (numWorkerThreads == 0)
+	{
+		// hardware_concurrency() may return 0 if the value is not computable.
+		uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		numWorkerThreads = std::max(1u, hardwareThreads - 1);
+	}
+
+	// Queue 0 belongs to the calling thread.
+	for (uint32_t i = 0; i < numWorkerThreads + 1; ++i)
+	{
+		m_Queues.emplace_back(new WorkStealingQueue<Task*>());
+	}
+
+	assert(t_Scheduler == nullptr && "The calling thread already belongs to a scheduler.");
+	t_Scheduler = this;
+	t_ThreadIndex = 0;
+
+	for (uint32_t i = 1; i < numWorkerThreads + 1; ++i)
+	{
+		m_Workers.emplace_back(&TaskScheduler::WorkerMain, this, i);
+	}
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	// Drain what's left so no task (and no TaskGroup counter) is leaked.
+	while (TryRunOneTask()) {}
+
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Running.store(false, std::memory_order_release);
+	}
+	m_WakeUp.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+
+	if (t_Scheduler == this)
+	{
+		t_Scheduler = nullptr;
+		t_ThreadIndex = -1;
+	}
+}
+
+// =====================================================================================
+//									   Workers
+// =====================================================================================
+
+void TaskScheduler::WorkerMain(uint32_t workerIndex)
+{
+	t_Scheduler = this;
+	t_ThreadIndex = static_cast<int32_t>(workerIndex);
+
+	if (m_OnWorkerStart)
+	{
+		m_OnWorkerStart(workerIndex);
+	}
+
+	int spins = 0;
+	while (m_Running.load(std::memory_order_acquire))
+	{
+		if (Task* task = FindTask(t_ThreadIndex))
+		{
+			Execute(task);
+			spins = 0;
+			continue;
+		}
+
+		if (++spins < NUM_SPINS_BEFORE_SLEEP)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Nothing to do for a while - sleep until Spawn() signals new work.
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_WakeUp.wait(lock, [this]() {
+			return m_NumQueued.load(std::memory_order_seq_cst) > 0 ||
+				!m_Running.load(std::memory_order_acquire);
+		});
+		m_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+		spins = 0;
+	}
+
+	t_Scheduler = nullptr;
+	t_ThreadIndex = -1;
+}
+
+int32_t TaskScheduler::GetCurrentThreadIndex() const
+{
+	return t_Scheduler == this ? t_ThreadIndex : -1;
+}
+
+void TaskScheduler::Spawn(TaskGroup* group, std::function<void()> function)
+{
+	Task* task = new Task{ std::move(function), group };
+
+	int32_t threadIndex = GetCurrentThreadIndex();
+	if (threadIndex >= 0)
+	{
+		m_Queues[threadIndex]->Push(task);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_InjectionMutex);
+		m_InjectionQueue.push_back(task);
+	}
+
+	m_NumQueued.fetch_add(1, std::memory_order_seq_cst);
+
+	// Taking the sleep mutex orders this notify after a worker's predicate check,
+	//		so the wake up can not be lost.
+	if (m_NumSleeping.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_WakeUp.notify_one();
+	}
+}
+
+TaskScheduler::Task* TaskScheduler::FindTask(int32_t threadIndex)
+{
+	Task* task = nullptr;
+
+	// 1) Own queue (most recently spawned, cache-hot).
+	if (threadIndex >= 0 && m_Queues[threadIndex]->Pop(task))
+	{
+		m_NumQueued.fetch_sub(1, std::memory_order_relaxed);
+		return task;
+	}
+
+	// 2) Tasks submitted by foreign threads.
+	{
+		std::lock_guard<std::mutex> lock(m_InjectionMutex);
+		if (!m_InjectionQueue.empty())
+		{
+			task = m_InjectionQueue.front();
+			m_InjectionQueue.pop_front();
+			m_NumQueued.fetch_sub(1, std::memory_order_relaxed);
+			return task;
+		}
+	}
+
+	// 3) Steal from the others, starting next to ourselves so the thieves spread out.
+	const size_t numQueues = m_Queues.size();
+	const size_t start = threadIndex >= 0 ? static_cast<size_t>(threadIndex) + 1 : 0;
+	for (size_t i = 0; i < numQueues; ++i)
+	{
+		size_t victim = (start + i) % numQueues;
+		if (static_cast<int32_t>(victim) == threadIndex)
+			continue;
+
+		if (m_Queues[victim]->Steal(task))
+		{
+			m_NumQueued.fetch_sub(1, std::memory_order_relaxed);
+			return task;
+		}
+	}
+
+	return nullptr;
+}
+
+void TaskScheduler::Execute(Task* task)
+{
+	task->function();
+
+	if (task->group)
+	{
+		task->group->OnTaskFinished();
+	}
+
+	delete task;
+}
+
+bool TaskScheduler::TryRunOneTask()
+{
+	if (Task* task = FindTask(GetCurrentThreadIndex()))
+	{
+		Execute(task);
+		return true;
+	}
+
+	return false;
+}
+
+// =====================================================================================
+//									  Parallel for
+// =====================================================================================
+
+void TaskScheduler::ParallelFor(size_t begin, size_t end, size_t grainSize,
+	const std::function<void(size_t, size_t)>& func)
+{
+	if (begin >= end)
+		return;
+
+	grainSize = std::max<size_t>(1, grainSize);
+
+	// Small ranges are not worth the task overhead.
+	if (end - begin <= grainSize)
+	{
+		func(begin, end);
+		return;
+	}
+
+	TaskGroup group(*this);
+	ParallelForRecursive(group, begin, end, grainSize, func);
+	group.Wait();
+}
+
+void TaskScheduler::ParallelForRecursive(TaskGroup& group, size_t begin, size_t end, size_t grainSize,
+	const std::function<void(size_t, size_t)>& func)
+{
+	// Keep splitting: the upper half is offered to thieves, the lower half is processed
+	//		(and split further) by the current thread.
+	while (end - begin > grainSize)
+	{
+		size_t middle = begin + (end - begin) / 2;
+		group.Run([this, &group, middle, end, grainSize, &func]() {
+			ParallelForRecursive(group, middle, end, grainSize, func);
+		});
+		end = middle;
+	}
+
+	func(begin, end);
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+// Portable C++ only - this header must not pull in Windows.h so the
+// scheduler (and everything built on top of it) also compiles on Linux.
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Work stealing queue
+// =====================================================================================
+
+// Chase-Lev work stealing deque ("Dynamic Circular Work-Stealing Deque", 2005) with the
+//		memory orderings from "Correct and Efficient Work-Stealing for Weak Memory Models"
+//		(Le, Pop, Cohen, Nardelli, 2013).
+//
+// Only the OWNER thread may call Push() and Pop() - both work on the bottom end of the
+//		deque (LIFO, which keeps the owner on cache-hot, recently spawned tasks).
+// Any other thread may call Steal() - it takes from the top end (FIFO, which hands out
+//		the oldest and therefore usually the biggest chunks of work).
+//
+// When the ring buffer is full it is grown. Old buffers cannot be freed right away since
+//		a thief might still be reading from them, so they are kept alive until the queue
+//		is destroyed (they are tiny compared to the number of tasks they held).
+template<typename T>
+class WorkStealingQueue
+{
+public:
+	explicit WorkStealingQueue(int64_t capacity = 1024)
+		: m_Top(0)
+		, m_Bottom(0)
+	{
+		m_Buffers.emplace_back(new RingBuffer(capacity));
+		m_Buffer.store(m_Buffers.back().get(), std::memory_order_relaxed);
+	}
+	WorkStealingQueue(const WorkStealingQueue&) = delete;
+	WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+	// Owner only.
+	void Push(T item)
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		RingBuffer* buffer = m_Buffer.load(std::memory_order_relaxed);
+
+		if (bottom - top > buffer->capacity - 1)
+		{
+			buffer = Grow(buffer, top, bottom);
+		}
+
+		// Release - a thief that sees the new bottom also sees the item.
+		buffer->Put(bottom, item);
+		m_Bottom.store(bottom + 1, std::memory_order_release);
+	}
+
+	// Owner only.
+	bool Pop(T& item)
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		RingBuffer* buffer = m_Buffer.load(std::memory_order_relaxed);
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		bool result = true;
+		if (top <= bottom)
+		{
+			item = buffer->Get(bottom);
+			if (top == bottom)
+			{
+				// Last item - race against the thieves for it.
+				if (!m_Top.compare_exchange_strong(top, top + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					result = false;
+				}
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			// Queue was already empty.
+			result = false;
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	// Any thread.
+	bool Steal(T& item)
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+		if (top < bottom)
+		{
+			RingBuffer* buffer = m_Buffer.load(std::memory_order_consume);
+			T stolen = buffer->Get(top);
+			if (!m_Top.compare_exchange_strong(top, top + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				// Lost the race against the owner or another thief.
+				return false;
+			}
+			item = stolen;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool Empty() const
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+		return bottom <= top;
+	}
+
+private:
+	struct RingBuffer
+	{
+		explicit RingBuffer(int64_t cap)
+			: capacity(cap)
+			, mask(cap - 1)
+			, items(new std::atomic<T>[static_cast<size_t>(cap)])
+		{
+			// Capacity must be a power of 2 for the index masking to work.
+			assert((cap & (cap - 1)) == 0);
+		}
+
+		void Put(int64_t index, T item) { items[index & mask].store(item, std::memory_order_relaxed); }
+		T Get(int64_t index) const { return items[index & mask].load(std::memory_order_relaxed); }
+
+		int64_t capacity;
+		int64_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+	};
+
+	RingBuffer* Grow(RingBuffer* old, int64_t top, int64_t bottom)
+	{
+		RingBuffer* grown = new RingBuffer(old->capacity * 2);
+		for (int64_t i = top; i != bottom; ++i)
+		{
+			grown->Put(i, old->Get(i));
+		}
+
+		m_Buffers.emplace_back(grown);
+		m_Buffer.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+private:
+	// Top and bottom are written by different threads - keep them on separate
+	// cache lines to avoid false sharing. (Padding instead of alignas so the
+	// queues can be heap allocated without C++17 aligned new.)
+	std::atomic<int64_t> m_Top;
+	char m_PadTop[64 - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t> m_Bottom;
+	char m_PadBottom[64 - sizeof(std::atomic<int64_t>)];
+	std::atomic<RingBuffer*> m_Buffer;
+
+	// Owner only - every buffer ever used by this queue.
+	std::vector<std::unique_ptr<RingBuffer>> m_Buffers;
+};
+
+// =====================================================================================
+//									  Task group
+// =====================================================================================
+
+// A task group counts the tasks spawned into it that have not finished yet.
+//		- Wait() blocks until the count drops to zero. The waiting thread does not idle,
+//		  it executes (or steals) other tasks in the meantime.
+//		- Then() registers a continuation that is spawned as a new task once every task
+//		  of the group has finished (or right away if the group is already idle).
+//
+// Groups can be reused once they are idle. A group must outlive all of its tasks.
+class TaskGroup
+{
+public:
+	explicit TaskGroup(TaskScheduler& scheduler) : m_Scheduler(scheduler), m_Pending(0) {}
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+	~TaskGroup();
+
+	// Spawn a task into the group.
+	void Run(std::function<void()> task);
+	// Block (while helping) until every task of the group has finished.
+	void Wait();
+	// Spawn "continuation" once the group becomes idle.
+	void Then(std::function<void()> continuation);
+
+	bool IsIdle() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class TaskScheduler;
+	void OnTaskFinished();
+
+private:
+	TaskScheduler& m_Scheduler;
+	std::atomic<int32_t> m_Pending;
+
+	std::mutex m_ContinuationMutex;
+	std::function<void()> m_Continuation;
+};
+
+// =====================================================================================
+//									  Scheduler
+// =====================================================================================
+
+// Work stealing task scheduler:
+//		- Every worker thread owns a WorkStealingQueue. Tasks spawned from a worker go to
+//		  its own queue; idle workers steal from the queues of the others.
+//		- The thread that creates the scheduler (the WndProc thread for the Application) is
+//		  registered as worker 0 and owns a queue as well, so Update and Render can spawn
+//		  work and help executing it while they wait.
+//		- Any other thread submits through a mutex-protected injection queue.
+//		- Idle workers spin for a short while, then sleep on a condition variable until new
+//		  work is submitted.
+class TaskScheduler
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	// 0 worker threads means "one per hardware thread minus the calling thread".
+	//		"onWorkerStart(workerIndex)" runs first thing on every worker thread
+	//		(thread naming, affinity, ...). Worker indices start at 1.
+	explicit TaskScheduler(uint32_t numWorkerThreads = 0,
+		std::function<void(uint32_t)> onWorkerStart = nullptr);
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+	~TaskScheduler();
+
+	// Fire and forget - use a TaskGroup to wait for the result.
+	void Spawn(std::function<void()> task) { Spawn(nullptr, std::move(task)); }
+
+	// Call func(begin, end) over [begin, end) split into chunks of at most grainSize
+	//		elements, and wait for all of them. The range is split recursively in halves
+	//		so thieves always take the biggest remaining piece of work.
+	void ParallelFor(size_t begin, size_t end, size_t grainSize,
+		const std::function<void(size_t, size_t)>& func);
+
+	// Execute one pending task on the calling thread. Returns false if there was none.
+	bool TryRunOneTask();
+
+	// Worker threads + the thread that created the scheduler.
+	uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_Queues.size()); }
+	// Index of the calling thread in [0, GetNumThreads()) or -1 for foreign threads.
+	int32_t GetCurrentThreadIndex() const;
+
+protected:
+	void WorkerMain(uint32_t workerIndex);
+
+private:
+	friend class TaskGroup;
+
+	struct Task
+	{
+		std::function<void()> function;
+		TaskGroup* group;
+	};
+
+	void Spawn(TaskGroup* group, std::function<void()> task);
+	void Execute(Task* task);
+	Task* FindTask(int32_t threadIndex);
+	void ParallelForRecursive(TaskGroup& group, size_t begin, size_t end, size_t grainSize,
+		const std::function<void(size_t, size_t)>& func);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	// One queue per thread. Index 0 belongs to the creating thread.
+	std::vector<std::unique_ptr<WorkStealingQueue<Task*>>> m_Queues;
+	std::vector<std::thread> m_Workers;
+	std::function<void(uint32_t)> m_OnWorkerStart;
+
+	// Tasks submitted from threads that don't own a queue.
+	std::mutex m_InjectionMutex;
+	std::deque<Task*> m_InjectionQueue;
+
+	// Sleeping.
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeUp;
+	std::atomic<int32_t> m_NumSleeping;
+	// Approximate count of queued tasks - lets the workers skip the sleep.
+	std::atomic<int32_t> m_NumQueued;
+
+	std::atomic<bool> m_Running;
+};
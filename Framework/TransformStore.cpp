@@ -0,0 +1,272 @@
+#include "TransformStore.h"
+#include "TaskScheduler.h"
+
+#include <algorithm> // std::min
+#include <cassert>
+
+using namespace DirectX;
+
+
+// =====================================================================================
+//										Globals
+// =====================================================================================
+
+namespace
+{
+	// Transforms per ParallelFor task. Big enough that the task overhead disappears
+	//		next to ~4096 matrix builds, small enough to balance a few thousand objects.
+	constexpr size_t UPDATE_GRAIN_SIZE = 4096;
+
+	// Swap element "index" with the last one and pop it.
+	template<typename T>
+	void SwapRemove(std::vector<T>& array, size_t index)
+	{
+		array[index] = array.back();
+		array.pop_back();
+	}
+}
+
+// =====================================================================================
+//									  Sparse set
+// =====================================================================================
+
+constexpr uint32_t TransformStore::INVALID_INDEX;
+
+void TransformStore::Reserve(size_t capacity)
+{
+	m_Entities.reserve(capacity);
+	m_PositionX.reserve(capacity); m_PositionY.reserve(capacity); m_PositionZ.reserve(capacity);
+	m_RotationX.reserve(capacity); m_RotationY.reserve(capacity); m_RotationZ.reserve(capacity); m_RotationW.reserve(capacity);
+	m_ScaleX.reserve(capacity); m_ScaleY.reserve(capacity); m_ScaleZ.reserve(capacity);
+	m_World.reserve(capacity);
+}
+
+void TransformStore::Add(Entity entity)
+{
+	assert(!Has(entity) && "Entity already has a transform.");
+
+	uint32_t entityIndex = GetEntityIndex(entity);
+	if (entityIndex >= m_Sparse.size())
+	{
+		m_Sparse.resize(entityIndex + 1, INVALID_INDEX);
+	}
+	m_Sparse[entityIndex] = static_cast<uint32_t>(m_Entities.size());
+	m_Entities.push_back(entity);
+
+	m_PositionX.push_back(0.0f); m_PositionY.push_back(0.0f); m_PositionZ.push_back(0.0f);
+	m_RotationX.push_back(0.0f); m_RotationY.push_back(0.0f); m_RotationZ.push_back(0.0f); m_RotationW.push_back(1.0f);
+	m_ScaleX.push_back(1.0f); m_ScaleY.push_back(1.0f); m_ScaleZ.push_back(1.0f);
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	m_World.push_back(identity);
+}
+
+void TransformStore::Remove(Entity entity)
+{
+	uint32_t index = GetIndex(entity);
+	if (index == INVALID_INDEX)
+		return;
+
+	// The last element moves into the hole - fix up its sparse entry.
+	Entity last = m_Entities.back();
+	m_Sparse[GetEntityIndex(last)] = index;
+	m_Sparse[GetEntityIndex(entity)] = INVALID_INDEX;
+
+	SwapRemove(m_Entities, index);
+	SwapRemove(m_PositionX, index); SwapRemove(m_PositionY, index); SwapRemove(m_PositionZ, index);
+	SwapRemove(m_RotationX, index); SwapRemove(m_RotationY, index); SwapRemove(m_RotationZ, index); SwapRemove(m_RotationW, index);
+	SwapRemove(m_ScaleX, index); SwapRemove(m_ScaleY, index); SwapRemove(m_ScaleZ, index);
+	SwapRemove(m_World, index);
+}
+
+uint32_t TransformStore::GetIndex(Entity entity) const
+{
+	uint32_t entityIndex = GetEntityIndex(entity);
+	if (entity == INVALID_ENTITY || entityIndex >= m_Sparse.size())
+		return INVALID_INDEX;
+
+	// The generation check rejects stale ids whose slot was reused.
+	uint32_t index = m_Sparse[entityIndex];
+	if (index == INVALID_INDEX || m_Entities[index] != entity)
+		return INVALID_INDEX;
+
+	return index;
+}
+
+// =====================================================================================
+//									  Get and Set
+// =====================================================================================
+
+void TransformStore::SetPosition(Entity entity, const XMFLOAT3& position)
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	m_PositionX[i] = position.x; m_PositionY[i] = position.y; m_PositionZ[i] = position.z;
+}
+
+void TransformStore::SetRotation(Entity entity, const XMFLOAT4& quaternion)
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	m_RotationX[i] = quaternion.x; m_RotationY[i] = quaternion.y; m_RotationZ[i] = quaternion.z; m_RotationW[i] = quaternion.w;
+}
+
+void TransformStore::SetScale(Entity entity, const XMFLOAT3& scale)
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	m_ScaleX[i] = scale.x; m_ScaleY[i] = scale.y; m_ScaleZ[i] = scale.z;
+}
+
+XMFLOAT3 TransformStore::GetPosition(Entity entity) const
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	return XMFLOAT3(m_PositionX[i], m_PositionY[i], m_PositionZ[i]);
+}
+
+XMFLOAT4 TransformStore::GetRotation(Entity entity) const
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	return XMFLOAT4(m_RotationX[i], m_RotationY[i], m_RotationZ[i], m_RotationW[i]);
+}
+
+XMFLOAT3 TransformStore::GetScale(Entity entity) const
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	return XMFLOAT3(m_ScaleX[i], m_ScaleY[i], m_ScaleZ[i]);
+}
+
+XMMATRIX TransformStore::GetWorldMatrix(Entity entity) const
+{
+	uint32_t i = GetIndex(entity);
+	assert(i != INVALID_INDEX);
+	return XMLoadFloat4x4(&m_World[i]);
+}
+
+// =====================================================================================
+//									   Iteration
+// =====================================================================================
+
+TransformStore::Chunk TransformStore::MakeChunk(size_t begin, size_t end)
+{
+	Chunk chunk;
+	chunk.begin = begin;
+	chunk.end = end;
+	chunk.entities = m_Entities.data();
+	chunk.positionX = m_PositionX.data(); chunk.positionY = m_PositionY.data(); chunk.positionZ = m_PositionZ.data();
+	chunk.rotationX = m_RotationX.data(); chunk.rotationY = m_RotationY.data(); chunk.rotationZ = m_RotationZ.data(); chunk.rotationW = m_RotationW.data();
+	chunk.scaleX = m_ScaleX.data(); chunk.scaleY = m_ScaleY.data(); chunk.scaleZ = m_ScaleZ.data();
+	chunk.world = m_World.data();
+	return chunk;
+}
+
+void TransformStore::ForEachChunk(size_t chunkSize, const std::function<void(Chunk&)>& func,
+	TaskScheduler* scheduler)
+{
+	if (scheduler)
+	{
+		scheduler->ParallelFor(0, GetCount(), chunkSize, [this, &func](size_t begin, size_t end) {
+			Chunk chunk = MakeChunk(begin, end);
+			func(chunk);
+		});
+		return;
+	}
+
+	for (size_t begin = 0; begin < GetCount(); begin += chunkSize)
+	{
+		Chunk chunk = MakeChunk(begin, std::min(begin + chunkSize, GetCount()));
+		func(chunk);
+	}
+}
+
+// =====================================================================================
+//									 World matrices
+// =====================================================================================
+
+void TransformStore::UpdateWorldMatrices(TaskScheduler* scheduler)
+{
+	if (scheduler)
+	{
+		scheduler->ParallelFor(0, GetCount(), UPDATE_GRAIN_SIZE, [this](size_t begin, size_t end) {
+			UpdateWorldMatrices(begin, end);
+		});
+	}
+	else
+	{
+		UpdateWorldMatrices(0, GetCount());
+	}
+}
+
+// The matrix of a scale S, unit quaternion (x, y, z, w) and translation T is
+//		row 0:  sx * (1 - 2(yy + zz),  2(xy + zw),       2(xz - yw),      0)
+//		row 1:  sy * (2(xy - zw),      1 - 2(xx + zz),   2(yz + xw),      0)
+//		row 2:  sz * (2(xz + yw),      2(yz - xw),       1 - 2(xx + yy),  0)
+//		row 3:       (tx,              ty,               tz,              1)
+// which is what XMMatrixAffineTransformation returns for a zero rotation origin.
+//
+// The arrays are SoA, so one XMVECTOR holds the same component of 4 transforms and
+//		all of the above is evaluated for 4 transforms at once. Each matrix row is then
+//		built with a 4x4 transpose (lane i of the 4 column vectors -> row of transform i).
+void TransformStore::UpdateWorldMatrices(size_t begin, size_t end)
+{
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+	const XMVECTOR zero = XMVectorZero();
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		// XMFLOAT4 loads are unaligned - the arrays don't need any special alignment.
+		XMVECTOR qx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_RotationX[i]));
+		XMVECTOR qy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_RotationY[i]));
+		XMVECTOR qz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_RotationZ[i]));
+		XMVECTOR qw = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_RotationW[i]));
+		XMVECTOR sx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_ScaleX[i]));
+		XMVECTOR sy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_ScaleY[i]));
+		XMVECTOR sz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_ScaleZ[i]));
+		XMVECTOR tx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_PositionX[i]));
+		XMVECTOR ty = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_PositionY[i]));
+		XMVECTOR tz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_PositionZ[i]));
+
+		XMVECTOR xx = XMVectorMultiply(qx, qx), yy = XMVectorMultiply(qy, qy), zz = XMVectorMultiply(qz, qz);
+		XMVECTOR xy = XMVectorMultiply(qx, qy), xz = XMVectorMultiply(qx, qz), yz = XMVectorMultiply(qy, qz);
+		XMVECTOR xw = XMVectorMultiply(qx, qw), yw = XMVectorMultiply(qy, qw), zw = XMVectorMultiply(qz, qw);
+
+		XMVECTOR m00 = XMVectorMultiply(sx, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(yy, zz), one));
+		XMVECTOR m01 = XMVectorMultiply(sx, XMVectorMultiply(two, XMVectorAdd(xy, zw)));
+		XMVECTOR m02 = XMVectorMultiply(sx, XMVectorMultiply(two, XMVectorSubtract(xz, yw)));
+
+		XMVECTOR m10 = XMVectorMultiply(sy, XMVectorMultiply(two, XMVectorSubtract(xy, zw)));
+		XMVECTOR m11 = XMVectorMultiply(sy, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, zz), one));
+		XMVECTOR m12 = XMVectorMultiply(sy, XMVectorMultiply(two, XMVectorAdd(yz, xw)));
+
+		XMVECTOR m20 = XMVectorMultiply(sz, XMVectorMultiply(two, XMVectorAdd(xz, yw)));
+		XMVECTOR m21 = XMVectorMultiply(sz, XMVectorMultiply(two, XMVectorSubtract(yz, xw)));
+		XMVECTOR m22 = XMVectorMultiply(sz, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, yy), one));
+
+		// SoA -> AoS: after the transpose, r[k] is the row of transform i + k.
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(m00, m01, m02, zero));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(m10, m11, m12, zero));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(m20, m21, m22, zero));
+		XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(tx, ty, tz, one));
+
+		for (size_t k = 0; k < 4; ++k)
+		{
+			XMStoreFloat4x4(&m_World[i + k], XMMATRIX(row0.r[k], row1.r[k], row2.r[k], row3.r[k]));
+		}
+	}
+
+	// Tail - fewer than 4 left.
+	for (; i < end; ++i)
+	{
+		XMVECTOR scale = XMVectorSet(m_ScaleX[i], m_ScaleY[i], m_ScaleZ[i], 0.0f);
+		XMVECTOR rotation = XMVectorSet(m_RotationX[i], m_RotationY[i], m_RotationZ[i], m_RotationW[i]);
+		XMVECTOR translation = XMVectorSet(m_PositionX[i], m_PositionY[i], m_PositionZ[i], 1.0f);
+
+		XMStoreFloat4x4(&m_World[i], XMMatrixAffineTransformation(scale, zero, rotation, translation));
+	}
+}
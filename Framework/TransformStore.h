@@ -0,0 +1,101 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Entity.h"
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Transform store
+// =====================================================================================
+
+// Structure-of-arrays transform component store.
+//
+// Every attribute lives in its own tightly packed array (one array per float component),
+//		so a loop over N transforms streams through memory linearly and the math can be
+//		done 4 transforms at a time in SIMD registers without any shuffling.
+//
+// Entity -> component mapping is a sparse set:
+//		- m_Sparse[entity index]  -> dense index (or INVALID_INDEX)
+//		- m_Entities[dense index] -> entity
+//		Removal swaps the last element into the hole, so the dense arrays never have gaps.
+//		Dense indices are therefore NOT stable - keep entities, not indices.
+//
+// World matrices are computed as Scale * Rotation(quaternion) * Translation
+//		(row vectors, the DirectXMath convention).
+class TransformStore
+{
+public:
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+	// Pointers into the dense arrays for [begin, end) - used for chunked iteration.
+	struct Chunk
+	{
+		size_t begin;
+		size_t end;
+
+		const Entity* entities;
+		float* positionX; float* positionY; float* positionZ;
+		float* rotationX; float* rotationY; float* rotationZ; float* rotationW;
+		float* scaleX; float* scaleY; float* scaleZ;
+		DirectX::XMFLOAT4X4* world;
+	};
+
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	void Reserve(size_t capacity);
+
+	// Identity transform.
+	void Add(Entity entity);
+	void Remove(Entity entity);
+	bool Has(Entity entity) const { return GetIndex(entity) != INVALID_INDEX; }
+	uint32_t GetIndex(Entity entity) const;
+	size_t GetCount() const { return m_Entities.size(); }
+
+	void SetPosition(Entity entity, const DirectX::XMFLOAT3& position);
+	void SetRotation(Entity entity, const DirectX::XMFLOAT4& quaternion);
+	void SetScale(Entity entity, const DirectX::XMFLOAT3& scale);
+	DirectX::XMFLOAT3 GetPosition(Entity entity) const;
+	DirectX::XMFLOAT4 GetRotation(Entity entity) const;
+	DirectX::XMFLOAT3 GetScale(Entity entity) const;
+
+	// Valid after UpdateWorldMatrices().
+	DirectX::XMMATRIX GetWorldMatrix(Entity entity) const;
+	const DirectX::XMFLOAT4X4* GetWorldMatrices() const { return m_World.data(); }
+	const Entity* GetEntities() const { return m_Entities.data(); }
+
+	// Call func once per chunk of at most chunkSize transforms. With a scheduler the
+	//		chunks are processed in parallel, so func must only touch its own range.
+	void ForEachChunk(size_t chunkSize, const std::function<void(Chunk&)>& func,
+		TaskScheduler* scheduler = nullptr);
+
+	// Recompute all world matrices from position, rotation and scale.
+	void UpdateWorldMatrices(TaskScheduler* scheduler = nullptr);
+	// The SIMD kernel - [begin, end) of the dense arrays.
+	void UpdateWorldMatrices(size_t begin, size_t end);
+
+private:
+	Chunk MakeChunk(size_t begin, size_t end);
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	// Sparse set.
+	std::vector<uint32_t> m_Sparse;
+	std::vector<Entity> m_Entities;
+
+	// Dense SoA arrays.
+	std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+	std::vector<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+	std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+	std::vector<DirectX::XMFLOAT4X4> m_World;
+};
@@ -0,0 +1,352 @@
+#include "VertexFormats.h"
+
+#include <algorithm> // std::min, std::max
+#include <cmath>
+#include <cstring>   // std::memcpy
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define VERTEX_FORMATS_SSE 1
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+
+namespace
+{
+	constexpr float SNORM16_SCALE = 32767.0f;
+	constexpr float UNORM8_SCALE = 255.0f;
+
+	inline uint32_t AsUint(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+	inline float AsFloat(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+
+	// The scalar paths round with nearbyint (round half to even in the default rounding
+	//		mode) - the same as cvtps2dq - so they match the SSE paths bit for bit.
+	inline int32_t Round(float value) { return static_cast<int32_t>(std::nearbyint(value)); }
+
+	inline float Clamp(float value, float lo, float hi) { return std::min(std::max(value, lo), hi); }
+
+	inline PackedColor PackColor(float r, float g, float b, float a)
+	{
+		return static_cast<uint32_t>(Round(Clamp(r, 0.0f, 1.0f) * UNORM8_SCALE)) |
+			(static_cast<uint32_t>(Round(Clamp(g, 0.0f, 1.0f) * UNORM8_SCALE)) << 8) |
+			(static_cast<uint32_t>(Round(Clamp(b, 0.0f, 1.0f) * UNORM8_SCALE)) << 16) |
+			(static_cast<uint32_t>(Round(Clamp(a, 0.0f, 1.0f) * UNORM8_SCALE)) << 24);
+	}
+
+	inline PackedNormal PackNormal(const XMFLOAT3& n)
+	{
+		const float invL1 = 1.0f / (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+		float x = n.x * invL1;
+		float y = n.y * invL1;
+		if (n.z < 0.0f)
+		{
+			// Fold the lower half: reflect over the diagonals of the square. -0 counts as
+			//		negative, like SignNotZero in the SSE path.
+			const float foldedX = (1.0f - std::fabs(y)) * (std::signbit(x) ? -1.0f : 1.0f);
+			const float foldedY = (1.0f - std::fabs(x)) * (std::signbit(y) ? -1.0f : 1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		const uint16_t qx = static_cast<uint16_t>(static_cast<int16_t>(Round(x * SNORM16_SCALE)));
+		const uint16_t qy = static_cast<uint16_t>(static_cast<int16_t>(Round(y * SNORM16_SCALE)));
+		return static_cast<uint32_t>(qx) | (static_cast<uint32_t>(qy) << 16);
+	}
+
+#if VERTEX_FORMATS_SSE
+	// |v| and copysign(1, v) (+1 for +0) for 4 lanes.
+	inline __m128 Abs(__m128 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+	inline __m128 SignNotZero(__m128 v)
+	{
+		return _mm_or_ps(_mm_and_ps(v, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f));
+	}
+	inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+#endif
+}
+
+// =====================================================================================
+//									Quantization bounds
+// =====================================================================================
+
+QuantizationBounds QuantizationBounds::FromPositions(const XMFLOAT3* positions, size_t count)
+{
+	QuantizationBounds bounds = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) };
+	if (count == 0)
+		return bounds;
+
+	XMFLOAT3 lo = positions[0], hi = positions[0];
+	for (size_t i = 1; i < count; ++i)
+	{
+		lo.x = std::min(lo.x, positions[i].x); hi.x = std::max(hi.x, positions[i].x);
+		lo.y = std::min(lo.y, positions[i].y); hi.y = std::max(hi.y, positions[i].y);
+		lo.z = std::min(lo.z, positions[i].z); hi.z = std::max(hi.z, positions[i].z);
+	}
+	bounds.center = XMFLOAT3((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+	bounds.extent = XMFLOAT3((hi.x - lo.x) * 0.5f, (hi.y - lo.y) * 0.5f, (hi.z - lo.z) * 0.5f);
+	return bounds;
+}
+
+XMMATRIX QuantizationBounds::GetDequantizationMatrix() const
+{
+	return XMMatrixMultiply(
+		XMMatrixScalingFromVector(XMVectorSet(extent.x, extent.y, extent.z, 1.0f)),
+		XMMatrixTranslation(center.x, center.y, center.z));
+}
+
+// =====================================================================================
+//										Positions
+// =====================================================================================
+
+void EncodePositions(const XMFLOAT3* positions, size_t count, const QuantizationBounds& bounds,
+	QuantizedPosition* out)
+{
+	// Flat axes (extent 0) all map to 0.
+	const float invX = bounds.extent.x > 0.0f ? 1.0f / bounds.extent.x : 0.0f;
+	const float invY = bounds.extent.y > 0.0f ? 1.0f / bounds.extent.y : 0.0f;
+	const float invZ = bounds.extent.z > 0.0f ? 1.0f / bounds.extent.z : 0.0f;
+
+	size_t i = 0;
+#if VERTEX_FORMATS_SSE
+	// One vertex per register: xyz0 -> xyz1 after the transform, 2 vertices per store.
+	const __m128 center = _mm_setr_ps(bounds.center.x, bounds.center.y, bounds.center.z, 0.0f);
+	const __m128 invExtent = _mm_setr_ps(invX, invY, invZ, 0.0f);
+	const __m128 w = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(SNORM16_SCALE);
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128 p0 = _mm_setr_ps(positions[i].x, positions[i].y, positions[i].z, 0.0f);
+		__m128 p1 = _mm_setr_ps(positions[i + 1].x, positions[i + 1].y, positions[i + 1].z, 0.0f);
+		p0 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(p0, center), invExtent), w);
+		p1 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(p1, center), invExtent), w);
+		p0 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(p0, minusOne), one), scale);
+		p1 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(p1, minusOne), one), scale);
+		const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(p0), _mm_cvtps_epi32(p1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const float x = Clamp((positions[i].x - bounds.center.x) * invX, -1.0f, 1.0f);
+		const float y = Clamp((positions[i].y - bounds.center.y) * invY, -1.0f, 1.0f);
+		const float z = Clamp((positions[i].z - bounds.center.z) * invZ, -1.0f, 1.0f);
+		out[i].x = static_cast<int16_t>(Round(x * SNORM16_SCALE));
+		out[i].y = static_cast<int16_t>(Round(y * SNORM16_SCALE));
+		out[i].z = static_cast<int16_t>(Round(z * SNORM16_SCALE));
+		out[i].w = static_cast<int16_t>(SNORM16_SCALE);
+	}
+}
+
+XMFLOAT3 DecodePosition(const QuantizedPosition& position, const QuantizationBounds& bounds)
+{
+	// SNORM decode: -32768 and -32767 both map to -1.
+	const float x = std::max(position.x / SNORM16_SCALE, -1.0f);
+	const float y = std::max(position.y / SNORM16_SCALE, -1.0f);
+	const float z = std::max(position.z / SNORM16_SCALE, -1.0f);
+	return XMFLOAT3(x * bounds.extent.x + bounds.center.x,
+		y * bounds.extent.y + bounds.center.y,
+		z * bounds.extent.z + bounds.center.z);
+}
+
+// =====================================================================================
+//										Normals
+// =====================================================================================
+
+void EncodeNormalsOctahedral(const XMFLOAT3* normals, size_t count, PackedNormal* out)
+{
+	size_t i = 0;
+#if VERTEX_FORMATS_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 scale = _mm_set1_ps(SNORM16_SCALE);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		// AoS -> SoA, 4 normals.
+		const XMFLOAT3* n = normals + i;
+		const __m128 x = _mm_setr_ps(n[0].x, n[1].x, n[2].x, n[3].x);
+		const __m128 y = _mm_setr_ps(n[0].y, n[1].y, n[2].y, n[3].y);
+		const __m128 z = _mm_setr_ps(n[0].z, n[1].z, n[2].z, n[3].z);
+
+		const __m128 invL1 = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(Abs(x), Abs(y)), Abs(z)));
+		const __m128 ox = _mm_mul_ps(x, invL1);
+		const __m128 oy = _mm_mul_ps(y, invL1);
+
+		const __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, Abs(oy)), SignNotZero(ox));
+		const __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, Abs(ox)), SignNotZero(oy));
+		const __m128 lower = _mm_cmplt_ps(z, zero);
+		const __m128i qx = _mm_cvtps_epi32(_mm_mul_ps(Select(lower, foldedX, ox), scale));
+		const __m128i qy = _mm_cvtps_epi32(_mm_mul_ps(Select(lower, foldedY, oy), scale));
+
+		// x0 y0 x1 y1 x2 y2 x3 y3 as int16.
+		const __m128i packed = _mm_unpacklo_epi16(_mm_packs_epi32(qx, qx), _mm_packs_epi32(qy, qy));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		out[i] = PackNormal(normals[i]);
+	}
+}
+
+XMFLOAT3 DecodeNormalOctahedral(PackedNormal normal)
+{
+	float x = std::max(static_cast<int16_t>(normal & 0xFFFF) / SNORM16_SCALE, -1.0f);
+	float y = std::max(static_cast<int16_t>(normal >> 16) / SNORM16_SCALE, -1.0f);
+	const float z = 1.0f - std::fabs(x) - std::fabs(y);
+	const float t = Clamp(-z, 0.0f, 1.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	const float invLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+	return XMFLOAT3(x * invLength, y * invLength, z * invLength);
+}
+
+// =====================================================================================
+//										UVs
+// =====================================================================================
+
+// Round to nearest even, like the F16C instructions (after Fabian Giesen's float_to_half).
+//		Overflow gives infinity, NaN a quiet NaN.
+uint16_t FloatToHalf(float value)
+{
+	const uint32_t infinity = 255u << 23;
+	const uint32_t halfOverflow = (127u + 16u) << 23;
+	const uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint32_t bits = AsUint(value);
+	const uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t half;
+	if (bits >= halfOverflow)
+	{
+		half = bits > infinity ? 0x7E00u : 0x7C00u;
+	}
+	else if (bits < (113u << 23))
+	{
+		// Denormal (or zero): let the FPU do the rounding by adding a magic number.
+		half = AsUint(AsFloat(bits) + AsFloat(denormMagic)) - denormMagic;
+	}
+	else
+	{
+		const uint32_t mantissaOdd = (bits >> 13) & 1u;
+		bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu;
+		bits += mantissaOdd;
+		half = bits >> 13;
+	}
+	return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+float HalfToFloat(uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1Fu;
+	const uint32_t mantissa = value & 0x3FFu;
+
+	if (exponent == 0x1F)
+		return AsFloat(sign | 0x7F800000u | (mantissa << 13));
+	if (exponent == 0)
+	{
+		// Zero or denormal: mantissa * 2^-24.
+		const float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+		return sign ? -magnitude : magnitude;
+	}
+	return AsFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+void EncodeUVsHalf(const XMFLOAT2* uvs, size_t count, PackedUV* out)
+{
+	static_assert(sizeof(XMFLOAT2) == 8 && sizeof(PackedUV) == 4, "UVs must be tightly packed.");
+	static const bool useF16C = VertexFormatsDetail::IsF16CSupported();
+	size_t i = 0;
+	if (useF16C)
+	{
+		i = VertexFormatsDetail::EncodeUVsHalfF16C(reinterpret_cast<const float*>(uvs), count,
+			reinterpret_cast<uint16_t*>(out));
+	}
+
+	for (; i < count; ++i)
+	{
+		out[i].u = FloatToHalf(uvs[i].x);
+		out[i].v = FloatToHalf(uvs[i].y);
+	}
+}
+
+// =====================================================================================
+//										Colors
+// =====================================================================================
+
+#if VERTEX_FORMATS_SSE
+namespace
+{
+	// 4 RGBA colors, one per register -> 4 packed colors.
+	inline __m128i PackColors4(__m128 c0, __m128 c1, __m128 c2, __m128 c3)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(UNORM8_SCALE);
+		c0 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(c0, zero), one), scale);
+		c1 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(c1, zero), one), scale);
+		c2 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(c2, zero), one), scale);
+		c3 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(c3, zero), one), scale);
+
+		// 32 -> 16 -> 8 bit, the values are already in [0, 255] so nothing saturates.
+		const __m128i c01 = _mm_packs_epi32(_mm_cvtps_epi32(c0), _mm_cvtps_epi32(c1));
+		const __m128i c23 = _mm_packs_epi32(_mm_cvtps_epi32(c2), _mm_cvtps_epi32(c3));
+		return _mm_packus_epi16(c01, c23);
+	}
+}
+#endif
+
+void EncodeColorsRGBA8(const XMFLOAT4* colors, size_t count, PackedColor* out)
+{
+	size_t i = 0;
+#if VERTEX_FORMATS_SSE
+	const float* source = reinterpret_cast<const float*>(colors);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i packed = PackColors4(_mm_loadu_ps(source + i * 4), _mm_loadu_ps(source + i * 4 + 4),
+			_mm_loadu_ps(source + i * 4 + 8), _mm_loadu_ps(source + i * 4 + 12));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		out[i] = PackColor(colors[i].x, colors[i].y, colors[i].z, colors[i].w);
+	}
+}
+
+void EncodeColorsRGBA8(const XMFLOAT3* colors, size_t count, PackedColor* out)
+{
+	size_t i = 0;
+#if VERTEX_FORMATS_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		const XMFLOAT3* c = colors + i;
+		const __m128i packed = PackColors4(_mm_setr_ps(c[0].x, c[0].y, c[0].z, 1.0f),
+			_mm_setr_ps(c[1].x, c[1].y, c[1].z, 1.0f), _mm_setr_ps(c[2].x, c[2].y, c[2].z, 1.0f),
+			_mm_setr_ps(c[3].x, c[3].y, c[3].z, 1.0f));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		out[i] = PackColor(colors[i].x, colors[i].y, colors[i].z, 1.0f);
+	}
+}
+
+XMFLOAT4 DecodeColorRGBA8(PackedColor color)
+{
+	return XMFLOAT4((color & 0xFF) / UNORM8_SCALE, ((color >> 8) & 0xFF) / UNORM8_SCALE,
+		((color >> 16) & 0xFF) / UNORM8_SCALE, (color >> 24) / UNORM8_SCALE);
+}
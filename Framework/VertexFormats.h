@@ -0,0 +1,100 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// =====================================================================================
+//									Quantized vertex attributes
+// =====================================================================================
+
+// Compact encodings of the common vertex attributes. Every type is decoded by the input
+//		assembler for free through its DXGI format, the shader sees plain floats:
+//
+//		attribute	type				format							bytes	(float)
+//		position	QuantizedPosition	DXGI_FORMAT_R16G16B16A16_SNORM	8		(12)
+//		normal		PackedNormal		DXGI_FORMAT_R16G16_SNORM		4		(12)
+//		uv			PackedUV			DXGI_FORMAT_R16G16_FLOAT		4		(8)
+//		color		PackedColor			DXGI_FORMAT_R8G8B8A8_UNORM		4		(12 - 16)
+//
+// Positions are stored relative to the mesh bounds (see QuantizationBounds), w is always 1
+//		so the shader can use the decoded float4 as a point directly.
+//
+// Normals use the octahedral mapping: the unit sphere is projected onto the octahedron
+//		|x| + |y| + |z| = 1, the lower half is folded over the upper half, which flattens it
+//		into the [-1, 1] square. The error is spread evenly over the sphere (a few hundredths
+//		of a degree with 16 bits per component). Decode in HLSL with:
+//
+//			float3 DecodeOctahedral(float2 e)
+//			{
+//				float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+//				float t = saturate(-n.z);
+//				n.xy += (n.xy >= 0.0f) ? -t : t;
+//				return normalize(n);
+//			}
+struct QuantizedPosition
+{
+	int16_t x, y, z, w;
+};
+typedef uint32_t PackedNormal;
+struct PackedUV
+{
+	uint16_t u, v;
+};
+// R in the lowest byte, A in the highest (little endian R8G8B8A8).
+typedef uint32_t PackedColor;
+
+static_assert(sizeof(QuantizedPosition) == 8, "QuantizedPosition must match R16G16B16A16.");
+static_assert(sizeof(PackedUV) == 4, "PackedUV must match R16G16.");
+
+// Positions are quantized to [-1, 1] within the mesh's axis aligned bounds:
+//		quantized = (position - center) / extent
+//		position  = quantized * extent + center
+// The decode is a scale and translation - fold GetDequantizationMatrix() into the world
+//		matrix of the mesh's instances and the shader needs no extra work.
+struct QuantizationBounds
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 extent;
+
+	static QuantizationBounds FromPositions(const DirectX::XMFLOAT3* positions, size_t count);
+
+	DirectX::XMMATRIX GetDequantizationMatrix() const;
+};
+
+// =====================================================================================
+//										Encoders
+// =====================================================================================
+
+// All encoders process SSE2 batches of 4 (positions 2) attributes with a scalar loop for
+//		the remainder; both produce bit identical results, so an attribute encodes the same
+//		wherever it is in the array. Outputs are tightly packed arrays
+//		(one stream per attribute) - interleave afterwards if the layout needs it.
+
+void EncodePositions(const DirectX::XMFLOAT3* positions, size_t count, const QuantizationBounds& bounds,
+	QuantizedPosition* out);
+// Normals must be normalized (or at least non-zero).
+void EncodeNormalsOctahedral(const DirectX::XMFLOAT3* normals, size_t count, PackedNormal* out);
+// Uses the F16C conversion instructions when the CPU has them (VertexFormatsF16C.cpp, the
+//		only file built with /arch:AVX2); NaNs may keep their payload there.
+void EncodeUVsHalf(const DirectX::XMFLOAT2* uvs, size_t count, PackedUV* out);
+// Colors are clamped to [0, 1], RGB colors get alpha 1.
+void EncodeColorsRGBA8(const DirectX::XMFLOAT4* colors, size_t count, PackedColor* out);
+void EncodeColorsRGBA8(const DirectX::XMFLOAT3* colors, size_t count, PackedColor* out);
+
+// Scalar conversions, also used by tools to check the encodings.
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+DirectX::XMFLOAT3 DecodePosition(const QuantizedPosition& position, const QuantizationBounds& bounds);
+DirectX::XMFLOAT3 DecodeNormalOctahedral(PackedNormal normal);
+DirectX::XMFLOAT4 DecodeColorRGBA8(PackedColor color);
+
+// Between VertexFormats.cpp and VertexFormatsF16C.cpp only.
+namespace VertexFormatsDetail
+{
+	// True if the F16C kernel was compiled in and the CPU supports AVX2 and F16C.
+	bool IsF16CSupported();
+	// Converts the UVs of whole groups of 4 ("uvs": u, v pairs); returns how many.
+	size_t EncodeUVsHalfF16C(const float* uvs, size_t count, uint16_t* out);
+}
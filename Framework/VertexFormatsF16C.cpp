@@ -0,0 +1,50 @@
+// The F16C UV encoder. This is the only file compiled with /arch:AVX2 (-mavx2 -mf16c)
+//		for the vertex formats: the rest of the program keeps the baseline instruction
+//		set, and EncodeUVsHalf uses this kernel only when the CPU supports it.
+//
+// Keep inline functions shared with other files out of here (std::min, std::vector
+//		accessors, DirectXMath): the compiler emits an AVX2 copy of every one this file
+//		uses, and the linker is free to keep that copy for the whole program.
+#include "VertexFormats.h"
+#include "CpuTopology.h"
+
+// MSVC defines __AVX2__ for /arch:AVX2 and has no separate switch for F16C; GCC/Clang
+//		need -mf16c besides -mavx2 and define __F16C__.
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define VERTEX_FORMATS_F16C 1
+#include <immintrin.h>
+#endif
+
+bool VertexFormatsDetail::IsF16CSupported()
+{
+#if defined(VERTEX_FORMATS_F16C)
+	const CpuFeatures& features = CpuFeatures::Get();
+	return features.avx2 && features.f16c;
+#else
+	return false;
+#endif
+}
+
+#if defined(VERTEX_FORMATS_F16C)
+
+size_t VertexFormatsDetail::EncodeUVsHalfF16C(const float* uvs, size_t count, uint16_t* out)
+{
+	// UV pairs are contiguous: 4 UVs are 8 floats, converted with one instruction.
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m256 values = _mm256_loadu_ps(uvs + i * 2);
+		const __m128i halves = _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), halves);
+	}
+	return i;
+}
+
+#else
+
+size_t VertexFormatsDetail::EncodeUVsHalfF16C(const float*, size_t, uint16_t*)
+{
+	return 0;
+}
+
+#endif
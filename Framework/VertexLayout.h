@@ -0,0 +1,341 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstddef>   // offsetof
+#include <cstdint>
+
+// =====================================================================================
+//									Vertex layout reflection
+// =====================================================================================
+
+// Describes a vertex struct once and builds the D3D12 input layout from it at compile time.
+//
+// A vertex struct is described with DECLARE_VERTEX_LAYOUT, one VERTEX_ELEMENT per member:
+//
+//		struct VertexPosColor { QuantizedPosition Position; PackedColor Color; };
+//		DECLARE_VERTEX_LAYOUT(VertexPosColor,
+//			VERTEX_ELEMENT(VertexPosColor, Position, "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM),
+//			VERTEX_ELEMENT(VertexPosColor, Color, "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM));
+//
+// Offsets and sizes come from the struct itself (offsetof / sizeof), so reordering or
+//		retyping a member can't silently break the layout. The declaration fails to compile
+//		when a format's size differs from its member's size, when elements overlap or run
+//		past the end of the struct, or when the stride isn't a multiple of 4 bytes.
+//
+// An input layout is a list of streams (input slots), each with its own vertex struct:
+//
+//		typedef VertexInputLayout<
+//			VertexStream<VertexPosColor, 0>,			// interleaved per vertex data
+//			InstanceStream<InstanceTransform, 1>		// per instance data
+//		> CubeInputLayout;
+//		pipelineStateStream.InputLayout = CubeInputLayout::GetDesc();
+//
+// The D3D12_INPUT_ELEMENT_DESC array is a constexpr static member - nothing is built at
+//		run time. Duplicate slots and duplicate semantics fail to compile.
+
+struct VertexElement
+{
+	const char* semantic;
+	uint32_t semanticIndex;
+	DXGI_FORMAT format;
+	uint32_t offset;
+	// sizeof the member, checked against the format.
+	uint32_t size;
+};
+
+// Size in bytes of the formats usable as vertex input, 0 for anything else.
+constexpr uint32_t GetVertexFormatSize(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 16;
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 12;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+		return 8;
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+		return 4;
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+		return 2;
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// Specialized by DECLARE_VERTEX_LAYOUT - using an undescribed vertex type is a compile error.
+template<typename Vertex>
+struct VertexLayoutOf;
+
+// =====================================================================================
+//									Compile time checks
+// =====================================================================================
+
+namespace VertexLayoutDetail
+{
+	constexpr bool StringEqual(const char* a, const char* b)
+	{
+		while (*a && *a == *b)
+		{
+			++a;
+			++b;
+		}
+		return *a == *b;
+	}
+
+	template<typename Layout>
+	constexpr bool FormatSizesMatch()
+	{
+		for (size_t i = 0; i < Layout::GetCount(); ++i)
+		{
+			const VertexElement element = Layout::Get(i);
+			if (GetVertexFormatSize(element.format) == 0 || GetVertexFormatSize(element.format) != element.size)
+				return false;
+		}
+		return true;
+	}
+
+	template<typename Layout>
+	constexpr bool ElementsFit()
+	{
+		for (size_t i = 0; i < Layout::GetCount(); ++i)
+		{
+			const VertexElement a = Layout::Get(i);
+			if (a.offset + a.size > Layout::GetStride())
+				return false;
+			for (size_t j = i + 1; j < Layout::GetCount(); ++j)
+			{
+				const VertexElement b = Layout::Get(j);
+				if (a.offset < b.offset + b.size && b.offset < a.offset + a.size)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+#define VERTEX_ELEMENT(Vertex, Member, Semantic, SemanticIndex, Format) \
+	VertexElement{ Semantic, SemanticIndex, Format, \
+		static_cast<uint32_t>(offsetof(Vertex, Member)), static_cast<uint32_t>(sizeof(Vertex::Member)) }
+
+// Must be used at global scope. The elements live in a local constexpr array of the
+//		accessors, which keeps the header free of out-of-class static member definitions.
+#define DECLARE_VERTEX_LAYOUT(Vertex, ...) \
+	template<> struct VertexLayoutOf<Vertex> \
+	{ \
+		static constexpr size_t GetCount() \
+		{ \
+			constexpr VertexElement elements[] = { __VA_ARGS__ }; \
+			return sizeof(elements) / sizeof(elements[0]); \
+		} \
+		static constexpr VertexElement Get(size_t index) \
+		{ \
+			constexpr VertexElement elements[] = { __VA_ARGS__ }; \
+			return elements[index]; \
+		} \
+		static constexpr uint32_t GetStride() { return static_cast<uint32_t>(sizeof(Vertex)); } \
+	}; \
+	static_assert(VertexLayoutDetail::FormatSizesMatch<VertexLayoutOf<Vertex>>(), \
+		#Vertex ": an element's format doesn't match the size of its member."); \
+	static_assert(VertexLayoutDetail::ElementsFit<VertexLayoutOf<Vertex>>(), \
+		#Vertex ": elements overlap or lie outside the vertex."); \
+	static_assert(sizeof(Vertex) % 4 == 0, #Vertex ": the vertex stride must be a multiple of 4 bytes.")
+
+// =====================================================================================
+//										Input layouts
+// =====================================================================================
+
+// One input slot fed by a buffer of "Vertex" structs.
+template<typename Vertex, UINT Slot,
+	D3D12_INPUT_CLASSIFICATION Classification = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+	UINT StepRate = 0>
+struct VertexStream
+{
+	typedef Vertex VertexType;
+	typedef VertexLayoutOf<Vertex> Layout;
+
+	static constexpr UINT GetSlot() { return Slot; }
+	static constexpr D3D12_INPUT_CLASSIFICATION GetClassification() { return Classification; }
+	static constexpr UINT GetStepRate() { return StepRate; }
+	static constexpr UINT GetStride() { return Layout::GetStride(); }
+
+	static_assert(Slot < D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, "Input slot out of range.");
+	static_assert(Classification == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA || StepRate == 0,
+		"Per vertex data must have a step rate of 0.");
+};
+
+// Per instance data, advancing every "StepRate" instances.
+template<typename Vertex, UINT Slot, UINT StepRate = 1>
+using InstanceStream = VertexStream<Vertex, Slot, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, StepRate>;
+
+template<size_t Count>
+struct InputElementArray
+{
+	D3D12_INPUT_ELEMENT_DESC elements[Count];
+};
+
+namespace VertexLayoutDetail
+{
+	template<typename... Streams>
+	struct StreamList;
+
+	template<>
+	struct StreamList<>
+	{
+		static constexpr size_t GetElementCount() { return 0; }
+		static constexpr size_t Append(D3D12_INPUT_ELEMENT_DESC*, size_t index) { return index; }
+		static constexpr bool HasSlot(UINT) { return false; }
+		static constexpr bool HasSemantic(const char*, uint32_t) { return false; }
+		static constexpr bool IsUnique() { return true; }
+		static constexpr UINT GetStride(UINT) { return 0; }
+	};
+
+	template<typename Stream, typename... Rest>
+	struct StreamList<Stream, Rest...>
+	{
+		typedef typename Stream::Layout Layout;
+		typedef StreamList<Rest...> Next;
+
+		static constexpr size_t GetElementCount() { return Layout::GetCount() + Next::GetElementCount(); }
+
+		static constexpr size_t Append(D3D12_INPUT_ELEMENT_DESC* out, size_t index)
+		{
+			for (size_t i = 0; i < Layout::GetCount(); ++i, ++index)
+			{
+				const VertexElement element = Layout::Get(i);
+				out[index].SemanticName = element.semantic;
+				out[index].SemanticIndex = element.semanticIndex;
+				out[index].Format = element.format;
+				out[index].InputSlot = Stream::GetSlot();
+				out[index].AlignedByteOffset = element.offset;
+				out[index].InputSlotClass = Stream::GetClassification();
+				out[index].InstanceDataStepRate = Stream::GetStepRate();
+			}
+			return Next::Append(out, index);
+		}
+
+		static constexpr bool HasSlot(UINT slot) { return Stream::GetSlot() == slot || Next::HasSlot(slot); }
+
+		static constexpr bool HasSemantic(const char* semantic, uint32_t semanticIndex)
+		{
+			for (size_t i = 0; i < Layout::GetCount(); ++i)
+			{
+				const VertexElement element = Layout::Get(i);
+				if (element.semanticIndex == semanticIndex && StringEqual(element.semantic, semantic))
+					return true;
+			}
+			return Next::HasSemantic(semantic, semanticIndex);
+		}
+
+		// Every slot and every (semantic, index) used once.
+		static constexpr bool IsUnique()
+		{
+			if (Next::HasSlot(Stream::GetSlot()))
+				return false;
+			for (size_t i = 0; i < Layout::GetCount(); ++i)
+			{
+				const VertexElement element = Layout::Get(i);
+				if (Next::HasSemantic(element.semantic, element.semanticIndex))
+					return false;
+				for (size_t j = i + 1; j < Layout::GetCount(); ++j)
+				{
+					const VertexElement other = Layout::Get(j);
+					if (element.semanticIndex == other.semanticIndex && StringEqual(element.semantic, other.semantic))
+						return false;
+				}
+			}
+			return Next::IsUnique();
+		}
+
+		static constexpr UINT GetStride(UINT slot)
+		{
+			return Stream::GetSlot() == slot ? Stream::GetStride() : Next::GetStride(slot);
+		}
+	};
+}
+
+namespace VertexLayoutDetail
+{
+	// A free function - member functions can't be evaluated in the initializers of their
+	//		own class's static members.
+	template<typename List, size_t Count>
+	constexpr InputElementArray<Count> BuildInputElements()
+	{
+		InputElementArray<Count> result = {};
+		List::Append(result.elements, 0);
+		return result;
+	}
+}
+
+template<typename... Streams>
+class VertexInputLayout
+{
+	typedef VertexLayoutDetail::StreamList<Streams...> List;
+
+	static_assert(sizeof...(Streams) > 0, "An input layout needs at least one stream.");
+	static_assert(List::IsUnique(), "Input slots and semantics must be unique within an input layout.");
+
+public:
+	static constexpr size_t ElementCount = List::GetElementCount();
+
+	static constexpr D3D12_INPUT_LAYOUT_DESC GetDesc()
+	{
+		return { s_Elements.elements, static_cast<UINT>(ElementCount) };
+	}
+
+	// Stride of the vertex buffer bound to "slot", 0 for unused slots.
+	static constexpr UINT GetStride(UINT slot) { return List::GetStride(slot); }
+
+	static constexpr const InputElementArray<ElementCount>& GetElements() { return s_Elements; }
+
+private:
+	static constexpr InputElementArray<ElementCount> s_Elements =
+		VertexLayoutDetail::BuildInputElements<List, ElementCount>();
+};
+
+template<typename... Streams>
+constexpr size_t VertexInputLayout<Streams...>::ElementCount;
+
+template<typename... Streams>
+constexpr InputElementArray<VertexInputLayout<Streams...>::ElementCount> VertexInputLayout<Streams...>::s_Elements;
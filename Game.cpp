@@ -1,6 +1,7 @@
 #include "Game.h"
 
-#include <d3dcompiler.h>
+#include <algorithm> // std::max
+#include <cmath>
 
 // =====================================================================================
 //										Global vars 
@@ -15,25 +16,68 @@ constexpr const T& clamp(const T& val, const T& min, const T& max)
 	return val < min ? min : val > max ? max : val;
 }
 
-// Vertex data for a colored cube.
+// Screen resolution / occlusion buffer resolution.
+static const int OCCLUSION_BUFFER_DIVIDER = 4;
+
+// Mesh and material ids of the sample's only mesh.
+static const MeshId CUBE_MESH = 0;
+static const MaterialId CUBE_MATERIAL = 0;
+
+// Vertex data for a colored cube, quantized when the content is loaded:
+//		position R16G16B16A16_SNORM (within the mesh bounds) + color R8G8B8A8_UNORM,
+//		12 bytes per vertex instead of 2 x XMFLOAT3 (24 bytes).
 struct VertexPosColor
 {
-	XMFLOAT3 Position;
-	XMFLOAT3 Color;
+	QuantizedPosition Position;
+	PackedColor Color;
 };
+DECLARE_VERTEX_LAYOUT(VertexPosColor,
+	VERTEX_ELEMENT(VertexPosColor, Position, "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM),
+	VERTEX_ELEMENT(VertexPosColor, Color, "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM));
 
-static VertexPosColor g_Vertices[8] = {
-	{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) }, // 0
-	{ XMFLOAT3(-1.0f,  1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) }, // 1
-	{ XMFLOAT3(1.0f,  1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 0.0f) }, // 2
-	{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) }, // 3
-	{ XMFLOAT3(-1.0f, -1.0f,  1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) }, // 4
-	{ XMFLOAT3(-1.0f,  1.0f,  1.0f), XMFLOAT3(0.0f, 1.0f, 1.0f) }, // 5
-	{ XMFLOAT3(1.0f,  1.0f,  1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) }, // 6
-	{ XMFLOAT3(1.0f, -1.0f,  1.0f), XMFLOAT3(1.0f, 0.0f, 1.0f) }  // 7
+// Per instance data: the world matrix written by the InstanceBatcher, one row per element.
+struct InstanceTransform
+{
+	XMFLOAT4 World0, World1, World2, World3;
+};
+DECLARE_VERTEX_LAYOUT(InstanceTransform,
+	VERTEX_ELEMENT(InstanceTransform, World0, "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT),
+	VERTEX_ELEMENT(InstanceTransform, World1, "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT),
+	VERTEX_ELEMENT(InstanceTransform, World2, "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT),
+	VERTEX_ELEMENT(InstanceTransform, World3, "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT));
+static_assert(sizeof(InstanceTransform) == sizeof(XMFLOAT4X4), "Instance data must match the world matrices.");
+
+// Slot 0: per vertex data, slot 1: per instance data.
+static const UINT VERTEX_SLOT = 0;
+static const UINT INSTANCE_SLOT = 1;
+typedef VertexInputLayout<
+	VertexStream<VertexPosColor, VERTEX_SLOT>,
+	InstanceStream<InstanceTransform, INSTANCE_SLOT>
+> CubeInputLayout;
+
+static const XMFLOAT3 g_Positions[8] = {
+	XMFLOAT3(-1.0f, -1.0f, -1.0f), // 0
+	XMFLOAT3(-1.0f,  1.0f, -1.0f), // 1
+	XMFLOAT3(1.0f,  1.0f, -1.0f), // 2
+	XMFLOAT3(1.0f, -1.0f, -1.0f), // 3
+	XMFLOAT3(-1.0f, -1.0f,  1.0f), // 4
+	XMFLOAT3(-1.0f,  1.0f,  1.0f), // 5
+	XMFLOAT3(1.0f,  1.0f,  1.0f), // 6
+	XMFLOAT3(1.0f, -1.0f,  1.0f)  // 7
 };
 
-static WORD g_Indicies[36] =
+static const XMFLOAT3 g_Colors[8] = {
+	XMFLOAT3(0.0f, 0.0f, 0.0f), // 0
+	XMFLOAT3(0.0f, 1.0f, 0.0f), // 1
+	XMFLOAT3(1.0f, 1.0f, 0.0f), // 2
+	XMFLOAT3(1.0f, 0.0f, 0.0f), // 3
+	XMFLOAT3(0.0f, 0.0f, 1.0f), // 4
+	XMFLOAT3(0.0f, 1.0f, 1.0f), // 5
+	XMFLOAT3(1.0f, 1.0f, 1.0f), // 6
+	XMFLOAT3(1.0f, 0.0f, 1.0f)  // 7
+};
+
+static const uint32_t g_Indicies[36] =
 {
 	0, 1, 2, 0, 2, 3,
 	4, 6, 5, 4, 7, 6,
@@ -49,12 +93,25 @@ static WORD g_Indicies[36] =
 
 Game::Game(HINSTANCE hInstance, const wchar_t * windowTitle, int width, int height, bool vSync) :
 	Application(hInstance, windowTitle, width, height, vSync),
+	m_ContentLoaded(false),
 	m_ScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX)),
 	m_Viewport(CD3DX12_VIEWPORT(0.0f, 0.0f, (float)width, (float)height)),
 	m_FoV(45.0f)
 {
 	// The first back buffer index will very likely be 0, but it depends
 	m_CurrentBackBufferIndex = Application::GetCurrentBackbufferIndex();
+
+	// Scene
+	m_CubeEntity = m_Entities.Create();
+	m_Transforms.Add(m_CubeEntity);
+
+	// The cube only has its full detail level - meshes with simplified versions add one
+	//		level per version, finest first.
+	const LodLevel cubeLevels[] = { { CUBE_MESH, 0.0f } };
+	m_CubeLodSet = m_LodSelector.AddLodSet(cubeLevels, _countof(cubeLevels));
+
+	// Occlusion culling runs at a quarter of the screen resolution.
+	m_OcclusionBuffer.Resize(std::max(1, width / OCCLUSION_BUFFER_DIVIDER), std::max(1, height / OCCLUSION_BUFFER_DIVIDER));
 }
 Game::~Game() 
 {
@@ -69,14 +126,22 @@ void Game::Update()
 { 
 	Application::Update(); 
 	double totalUpdateTime = Application::GetUpdateTotalTime();
+	float deltaTime = static_cast<float>(totalUpdateTime - m_PreviousUpdateTime);
+	m_PreviousUpdateTime = totalUpdateTime;
 
 	// Update the model matrix.
 	float angle = static_cast<float>(totalUpdateTime * 90.0);
 	const XMVECTOR rotationAxis = XMVectorSet(0, 1, 1, 0);
-	m_ModelMatrix = XMMatrixRotationAxis(rotationAxis, XMConvertToRadians(angle));
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationAxis(rotationAxis, XMConvertToRadians(angle)));
+	m_Transforms.SetRotation(m_CubeEntity, rotation);
+
+	// All world matrices are rebuilt in one SoA pass (in parallel for big scenes).
+	m_Transforms.UpdateWorldMatrices(GetTaskScheduler().get());
 
 	// Update the view matrix.
-	const XMVECTOR eyePosition = XMVectorSet(0, 0, -10, 1);
+	const XMFLOAT3 eye(0, 0, -10);
+	const XMVECTOR eyePosition = XMVectorSet(eye.x, eye.y, eye.z, 1);
 	const XMVECTOR focusPoint = XMVectorSet(0, 0, 0, 1);
 	const XMVECTOR upDirection = XMVectorSet(0, 1, 0, 0);
 	m_ViewMatrix = XMMatrixLookAtLH(eyePosition, focusPoint, upDirection);
@@ -84,6 +149,47 @@ void Game::Update()
 	// Update the projection matrix.
 	float aspectRatio = GetClientWidth() / static_cast<float>(GetClientHeight());
 	m_ProjectionMatrix = XMMatrixPerspectiveFovLH(XMConvertToRadians(m_FoV), aspectRatio, 0.1f, 100.0f);
+
+	// Frustum culling.
+	//		The cube's local bounding sphere is centered at the origin with radius sqrt(3),
+	//		so in world space it sits at the translation, scaled by the largest axis scale.
+	const size_t numObjects = m_Transforms.GetCount();
+	const XMFLOAT4X4* worldMatrices = m_Transforms.GetWorldMatrices();
+	m_WorldBounds.Resize(numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+	{
+		const XMFLOAT4X4& world = worldMatrices[i];
+		float scaleSq = std::max(world._11 * world._11 + world._12 * world._12 + world._13 * world._13,
+			std::max(world._21 * world._21 + world._22 * world._22 + world._23 * world._23,
+				world._31 * world._31 + world._32 * world._32 + world._33 * world._33));
+		m_WorldBounds.Set(i, XMFLOAT3(world._41, world._42, world._43), std::sqrt(3.0f * scaleSq));
+	}
+
+	XMMATRIX viewProjection = XMMatrixMultiply(m_ViewMatrix, m_ProjectionMatrix);
+	Frustum frustum = Frustum::FromViewProjection(viewProjection);
+	m_FrustumCuller.CullSpheres(frustum, m_WorldBounds, m_VisibleObjects, GetTaskScheduler().get());
+
+	// Occlusion culling of the frustum culling survivors.
+	//		Large occluders (walls, terrain, buildings) are added with AddOccluder()
+	//		between Clear() and RenderOccluders() - the sample has none yet.
+	m_OcclusionBuffer.Clear();
+	m_OcclusionBuffer.RenderOccluders(GetTaskScheduler().get());
+	m_OcclusionBuffer.TestSpheres(m_WorldBounds, viewProjection, m_VisibleObjects, GetTaskScheduler().get());
+
+	// Level of detail by projected screen-space error, same field of view as the projection.
+	//		Runs over all objects (not only the visible ones) so hysteresis and fades
+	//		continue while objects are culled.
+	m_ObjectLodSets.resize(numObjects, m_CubeLodSet);
+	m_LodSelector.SetCamera(eye, XMConvertToRadians(m_FoV), static_cast<float>(GetClientHeight()));
+	m_LodSelector.Select(m_WorldBounds, m_ObjectLodSets.data(), deltaTime, GetTaskScheduler().get());
+
+	// Group the visible objects into instanced draws - the selected level is the mesh.
+	m_ObjectBatchKeys.resize(numObjects);
+	for (uint32_t object : m_VisibleObjects)
+	{
+		m_ObjectBatchKeys[object] = MakeBatchKey(m_LodSelector.GetMesh(object), CUBE_MATERIAL);
+	}
+	m_InstanceBatcher.Build(m_VisibleObjects.data(), m_VisibleObjects.size(), m_ObjectBatchKeys.data());
 }
 
 // Resources must be transitioned from one state to another using a resource BARRIER
@@ -131,6 +237,70 @@ void Game::Render()
 		commandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
 	}
 
+	// Draw the visible objects, one DrawIndexedInstanced per (mesh, material) batch.
+	if (m_ContentLoaded && m_InstanceBatcher.GetInstanceCount())
+	{
+		CD3DX12_CPU_DESCRIPTOR_HANDLE rtv = GetCurrentBackbufferRTV();
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dsv(m_DSVHeap->GetCPUDescriptorHandleForHeapStart());
+		commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+		// The GPU finished with this back buffer's frame, so its instance memory is free.
+		m_InstanceUploadBuffer->Begin(m_CurrentBackBufferIndex);
+		const size_t instanceBytes = m_InstanceBatcher.GetInstanceCount() * sizeof(XMFLOAT4X4);
+		FrameUploadBuffer::Allocation instances = m_InstanceUploadBuffer->Allocate(instanceBytes, 16);
+		m_InstanceBatcher.WriteInstanceTransforms(m_Transforms.GetWorldMatrices(),
+			static_cast<XMFLOAT4X4*>(instances.cpu), GetTaskScheduler().get());
+
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[2];
+		vertexBufferViews[0] = m_VertexBufferView;
+		vertexBufferViews[1].BufferLocation = instances.gpu;
+		vertexBufferViews[1].SizeInBytes = static_cast<UINT>(instanceBytes);
+		vertexBufferViews[1].StrideInBytes = CubeInputLayout::GetStride(INSTANCE_SLOT);
+
+		commandList->SetPipelineState(m_PipelineState.Get());
+		commandList->SetGraphicsRootSignature(m_RootSignature.Get());
+		commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		commandList->IASetVertexBuffers(0, _countof(vertexBufferViews), vertexBufferViews);
+		commandList->IASetIndexBuffer(&m_IndexBufferView);
+		commandList->RSSetViewports(1, &m_Viewport);
+		commandList->RSSetScissorRects(1, &m_ScissorRect);
+		commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+
+		// The model matrix comes from the instance data, only view * projection is shared.
+		XMMATRIX viewProjection = XMMatrixMultiply(m_ViewMatrix, m_ProjectionMatrix);
+		commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &viewProjection, 0);
+
+		// StartInstanceLocation offsets the per-instance vertex buffer, so every batch
+		//		reads its own slice of the instance data.
+		const std::vector<InstanceBatch>& batches = m_InstanceBatcher.GetBatches();
+		if (m_UseExecuteIndirect)
+		{
+			// The arguments are packed on the CPU (in parallel for many batches), the
+			//		submission is a single call however many batches there are. The count
+			//		buffer lets a GPU culling pass lower the number of commands later.
+			FrameUploadBuffer::Allocation arguments = m_InstanceUploadBuffer->Allocate(
+				batches.size() * sizeof(IndirectDrawCommand), sizeof(uint32_t));
+			const UINT numCommands = static_cast<UINT>(PackIndirectDrawCommands(batches.data(), batches.size(),
+				m_MeshDrawRanges.data(), m_MeshDrawRanges.size(),
+				static_cast<IndirectDrawCommand*>(arguments.cpu), GetTaskScheduler().get()));
+
+			FrameUploadBuffer::Allocation count = m_InstanceUploadBuffer->Allocate(sizeof(uint32_t), sizeof(uint32_t));
+			*static_cast<uint32_t*>(count.cpu) = numCommands;
+
+			commandList->ExecuteIndirect(m_CommandSignature.Get(), numCommands,
+				arguments.resource, arguments.offset, count.resource, count.offset);
+		}
+		else
+		{
+			for (const InstanceBatch& batch : batches)
+			{
+				const MeshDrawRange& mesh = m_MeshDrawRanges[GetBatchMesh(batch.key)];
+				commandList->DrawIndexedInstanced(mesh.indexCount, batch.instanceCount,
+					mesh.startIndex, mesh.baseVertex, batch.firstInstance);
+			}
+		}
+	}
+
 	// PRESENT image to the screen
 	{
 		// After rendering the scene, the current back buffer is PRESENTed 
@@ -167,6 +337,8 @@ void Game::Resize(UINT32 width, UINT32 height)
 
 			ResizeDepthBuffer(width, height);
 		}
+
+		m_OcclusionBuffer.Resize(std::max(1u, width / OCCLUSION_BUFFER_DIVIDER), std::max(1u, height / OCCLUSION_BUFFER_DIVIDER));
 	}
 }
 
@@ -224,27 +396,59 @@ bool Game::LoadContent()
 	auto commandQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
 	auto commandList = commandQueue->GetCommandList();
 
+	// Per-frame instance data - and the upload memory of buffers loaded from asset files.
+	m_InstanceUploadBuffer = std::make_unique<FrameUploadBuffer>(device);
+
+	// Quantize the vertices. The cube's bounds are [-1, 1] on every axis, so the
+	//		dequantization matrix is the identity and the instance transforms can be used
+	//		as they are; other meshes fold GetDequantizationMatrix() into them.
+	const size_t numVertices = _countof(g_Positions);
+	const QuantizationBounds cubeBounds = QuantizationBounds::FromPositions(g_Positions, numVertices);
+	std::vector<QuantizedPosition> positions(numVertices);
+	std::vector<PackedColor> colors(numVertices);
+	EncodePositions(g_Positions, numVertices, cubeBounds, positions.data());
+	EncodeColorsRGBA8(g_Colors, numVertices, colors.data());
+
+	std::vector<VertexPosColor> vertices(numVertices);
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		vertices[i].Position = positions[i];
+		vertices[i].Color = colors[i];
+	}
+
+	// Reorder the triangles for the vertex cache and overdraw, then the vertices for fetch
+	//		locality, and pick the smallest index format the vertex count allows.
+	std::vector<uint32_t> indices(g_Indicies, g_Indicies + _countof(g_Indicies));
+	OptimizeVertexCache(indices.data(), indices.size(), numVertices);
+	OptimizeOverdraw(indices.data(), indices.size(), g_Positions, sizeof(XMFLOAT3), numVertices);
+	vertices.resize(OptimizeVertexFetch(indices.data(), indices.size(), vertices.data(), numVertices, sizeof(VertexPosColor)));
+
+	const IndexFormat indexFormat = SelectIndexFormat(vertices.size());
+	const size_t indexSize = GetIndexSize(indexFormat);
+	std::vector<uint8_t> indexData(indices.size() * indexSize);
+	PackIndices(indices.data(), indices.size(), indexFormat, indexData.data());
+
 	// Upload vertex buffer data.
 	ComPtr<ID3D12Resource> intermediateVertexBuffer;
 	UpdateBufferResource(commandList,
 		&m_VertexBuffer, &intermediateVertexBuffer,
-		_countof(g_Vertices), sizeof(VertexPosColor), g_Vertices);
+		vertices.size(), sizeof(VertexPosColor), vertices.data());
 
 	// Create the vertex buffer view.
 	m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
-	m_VertexBufferView.SizeInBytes = sizeof(g_Vertices);
-	m_VertexBufferView.StrideInBytes = sizeof(VertexPosColor);
+	m_VertexBufferView.SizeInBytes = static_cast<UINT>(vertices.size() * sizeof(VertexPosColor));
+	m_VertexBufferView.StrideInBytes = CubeInputLayout::GetStride(VERTEX_SLOT);
 
 	// Upload index buffer data.
 	ComPtr<ID3D12Resource> intermediateIndexBuffer;
 	UpdateBufferResource(commandList,
 		&m_IndexBuffer, &intermediateIndexBuffer,
-		_countof(g_Indicies), sizeof(WORD), g_Indicies);
+		indices.size(), indexSize, indexData.data());
 
 	// Create index buffer view.
 	m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
-	m_IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-	m_IndexBufferView.SizeInBytes = sizeof(g_Indicies);
+	m_IndexBufferView.Format = indexFormat == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	m_IndexBufferView.SizeInBytes = static_cast<UINT>(indexData.size());
 
 	// Create the descriptor heap for the depth-stencil view.
 	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
@@ -253,19 +457,27 @@ bool Game::LoadContent()
 	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 	ThrowIfFailed(device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_DSVHeap)));
 
-	// Load the vertex shader.
-	ComPtr<ID3DBlob> vertexShaderBlob;
-	ThrowIfFailed(D3DReadFileToBlob(L"VertexShader.cso", &vertexShaderBlob));
+	// Compile the shaders - or, on every start after the first, load them from the
+	//		shader cache. The vertex shader is instanced: the model matrix is per instance data.
+	std::shared_ptr<ShaderCache> shaderCache = Application::GetShaderCache();
 
-	// Load the pixel shader.
-	ComPtr<ID3DBlob> pixelShaderBlob;
-	ThrowIfFailed(D3DReadFileToBlob(L"PixelShader.cso", &pixelShaderBlob));
+	ShaderDesc vertexShaderDesc;
+	vertexShaderDesc.path = "Shaders/InstancedVertexShader.hlsl";
+	vertexShaderDesc.stage = ShaderStage::Vertex;
+	ShaderBytecode vertexShader = shaderCache->GetShader(vertexShaderDesc);
 
-	// Create the vertex input layout
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-	};
+	ShaderDesc pixelShaderDesc;
+	pixelShaderDesc.path = "Shaders/PixelShader.hlsl";
+	pixelShaderDesc.stage = ShaderStage::Pixel;
+	ShaderBytecode pixelShader = shaderCache->GetShader(pixelShaderDesc);
+
+	// Cold start (empty cache) vs warm start: compare the time with ShaderCache/ deleted.
+	const ShaderCache::Statistics shaderStatistics = shaderCache->GetStatistics();
+	wchar_t buffer[256];
+	swprintf(buffer, 256, L"Shaders: %u compiled, %u from the disk cache, %u precompiled - %.2f ms\n",
+		shaderStatistics.compiled, shaderStatistics.diskHits, shaderStatistics.precompiled,
+		shaderStatistics.seconds * 1000.0);
+	OutputDebugString(buffer);
 
 	// Create a root signature.
 	D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
@@ -283,7 +495,9 @@ bool Game::LoadContent()
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
 
-	// A single 32-bit constant root parameter that is used by the vertex shader.
+	// Root constants used by the vertex shader: view * projection (b0), set once per frame.
+	//		Nothing changes per draw - the instance data is a vertex stream offset by
+	//		StartInstanceLocation.
 	CD3DX12_ROOT_PARAMETER1 rootParameters[1];
 	rootParameters[0].InitAsConstants(sizeof(XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
@@ -315,10 +529,10 @@ bool Game::LoadContent()
 	rtvFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 
 	pipelineStateStream.pRootSignature = m_RootSignature.Get();
-	pipelineStateStream.InputLayout = { inputLayout, _countof(inputLayout) };
+	pipelineStateStream.InputLayout = CubeInputLayout::GetDesc();
 	pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-	pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
+	pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShader->data(), vertexShader->size());
+	pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShader->data(), pixelShader->size());
 	pipelineStateStream.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 	pipelineStateStream.RTVFormats = rtvFormats;
 
@@ -327,6 +541,21 @@ bool Game::LoadContent()
 	};
 	ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
 
+	// Command signature for ExecuteIndirect - the layout of IndirectDrawCommand. It only
+	//		draws and changes no root arguments, so it takes no root signature.
+	D3D12_INDIRECT_ARGUMENT_DESC indirectArguments[1] = {};
+	indirectArguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+	commandSignatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+	commandSignatureDesc.NumArgumentDescs = _countof(indirectArguments);
+	commandSignatureDesc.pArgumentDescs = indirectArguments;
+	ThrowIfFailed(device->CreateCommandSignature(&commandSignatureDesc, nullptr,
+		IID_PPV_ARGS(&m_CommandSignature)));
+
+	// The cube is the only mesh: all of the index buffer.
+	m_MeshDrawRanges.assign(1, MeshDrawRange{ _countof(g_Indicies), 0, 0 });
+
 	auto fenceValue = commandQueue->ExecuteCommandList(commandList);
 	commandQueue->WaitForFenceValue(fenceValue);
 
@@ -1,6 +1,17 @@
 #pragma once
 
 #include "Framework/Application.h"
+#include "Framework/Entity.h"
+#include "Framework/TransformStore.h"
+#include "Framework/FrustumCulling.h"
+#include "Framework/OcclusionCulling.h"
+#include "Framework/InstanceBatcher.h"
+#include "Framework/FrameUploadBuffer.h"
+#include "Framework/IndirectDraw.h"
+#include "Framework/LodSelection.h"
+#include "Framework/VertexFormats.h"
+#include "Framework/VertexLayout.h"
+#include "Framework/MeshOptimizer.h"
 
 #include <DirectXMath.h>
 
@@ -57,14 +68,42 @@ private:
 
 	// Pipeline state object.
 	ComPtr<ID3D12PipelineState> m_PipelineState;
+
+	// ExecuteIndirect: root constants + DrawIndexed per command.
+	ComPtr<ID3D12CommandSignature> m_CommandSignature;
+	// Index ranges of the meshes, indexed by MeshId.
+	std::vector<MeshDrawRange> m_MeshDrawRanges;
+	// Submit all batches with one ExecuteIndirect instead of one draw call each.
+	bool m_UseExecuteIndirect = true;
 private:	
 	// View Settings
 	D3D12_VIEWPORT m_Viewport;
 	D3D12_RECT m_ScissorRect;
 	float m_FoV;
 
+	// Scene objects
+	EntityRegistry m_Entities;
+	TransformStore m_Transforms;
+	Entity m_CubeEntity = INVALID_ENTITY;
+
+	// Culling - world space bounding spheres in TransformStore order.
+	BoundingSpheres m_WorldBounds;
+	FrustumCuller m_FrustumCuller;
+	MaskedOcclusionBuffer m_OcclusionBuffer;
+	std::vector<uint32_t> m_VisibleObjects;
+
+	// Instancing - (mesh, material) of every object in TransformStore order.
+	std::vector<BatchKey> m_ObjectBatchKeys;
+	InstanceBatcher m_InstanceBatcher;
+	std::unique_ptr<FrameUploadBuffer> m_InstanceUploadBuffer;
+
+	// Level of detail - LOD set of every object in TransformStore order.
+	LodSelector m_LodSelector;
+	LodSetId m_CubeLodSet = 0;
+	std::vector<LodSetId> m_ObjectLodSets;
+	double m_PreviousUpdateTime = 0.0;
+
 	// Camera
-	DirectX::XMMATRIX m_ModelMatrix;
 	DirectX::XMMATRIX m_ViewMatrix;
 	DirectX::XMMATRIX m_ProjectionMatrix;
 
@@ -0,0 +1,93 @@
+// One mip level from the level above it (Framework/MipGenerator.h).
+//		Every destination texel averages the source texels it covers: a 2x2 box for even
+//		sizes, for odd sizes the covered part of 3 texels per axis, weighted by coverage.
+//		The same footprint as the cooker's box filter (Tools/AssetCooker/MipChain.h).
+//		sRGB content is decoded before and encoded after filtering: the views are UNORM,
+//		UAVs of sRGB formats don't exist.
+
+struct MipConstants
+{
+	uint2 SrcSize;
+	uint2 DstSize;
+	uint IsSRGB;
+};
+
+ConstantBuffer<MipConstants> MipCB : register(b0);
+
+Texture2D<float4> SrcMip : register(t0);
+RWTexture2D<unorm float4> DstMip : register(u0);
+
+// Per component choices need select() since HLSL 2021 (ShaderCompiler passes -HV 2021):
+//		?: only takes a scalar condition there. FXC, which compiles the .cso files of the build, has no
+//		select() but a per component ?:.
+#if !defined(__HLSL_VERSION) || __HLSL_VERSION < 2021
+float3 select(bool3 condition, float3 a, float3 b)
+{
+	return condition ? a : b;
+}
+#endif
+
+float3 SRGBToLinear(float3 c)
+{
+	return select(c <= 0.04045, c / 12.92, pow((c + 0.055) / 1.055, 2.4));
+}
+
+float3 LinearToSRGB(float3 c)
+{
+	return select(c <= 0.0031308, c * 12.92, 1.055 * pow(c, 1.0 / 2.4) - 0.055);
+}
+
+// Source texels [first, first + 4) covered by destination texel "i" on one axis; texels
+//		outside the footprint get weight 0.
+void Footprint(uint i, uint srcSize, uint dstSize, out int first, out float weights[4])
+{
+	const float scale = float(srcSize) / float(dstSize);
+	const float lo = float(i) * scale;
+	const float hi = float(i + 1) * scale;
+	first = int(floor(lo));
+
+	[unroll]
+	for (int k = 0; k < 4; ++k)
+	{
+		const float texel = float(first + k);
+		weights[k] = max(min(hi, texel + 1.0) - max(lo, texel), 0.0) / scale;
+	}
+}
+
+float4 LoadLinear(int2 texel)
+{
+	float4 value = SrcMip.Load(int3(texel, 0));
+	if (MipCB.IsSRGB)
+		value.rgb = SRGBToLinear(value.rgb);
+	return value;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+	if (any(DTid.xy >= MipCB.DstSize))
+		return;
+
+	int firstX, firstY;
+	float weightsX[4], weightsY[4];
+	Footprint(DTid.x, MipCB.SrcSize.x, MipCB.DstSize.x, firstX, weightsX);
+	Footprint(DTid.y, MipCB.SrcSize.y, MipCB.DstSize.y, firstY, weightsY);
+
+	const int2 last = int2(MipCB.SrcSize) - 1;
+	float4 sum = 0.0;
+	[unroll]
+	for (int y = 0; y < 4; ++y)
+	{
+		[unroll]
+		for (int x = 0; x < 4; ++x)
+		{
+			const float weight = weightsX[x] * weightsY[y];
+			if (weight > 0.0)
+				sum += weight * LoadLinear(min(int2(firstX + x, firstY + y), last));
+		}
+	}
+
+	if (MipCB.IsSRGB)
+		sum.rgb = LinearToSRGB(saturate(sum.rgb));
+	DstMip[DTid.xy] = sum;
+}
@@ -0,0 +1,43 @@
+// Instanced version of the cube vertex shader.
+//		Slot 0: per vertex position and color, quantized (R16G16B16A16_SNORM with w = 1 and
+//				R8G8B8A8_UNORM) - the input assembler decodes them to floats.
+//		Slot 1: per instance world matrix (4 rows, DirectXMath row vector convention),
+//				written every frame by the InstanceBatcher.
+
+struct ViewProjection
+{
+	matrix VP;
+};
+
+ConstantBuffer<ViewProjection> ViewProjectionCB : register(b0);
+
+struct VertexPosColor
+{
+	float4 Position : POSITION;
+	float4 Color    : COLOR;
+	float4 World0   : WORLD0;
+	float4 World1   : WORLD1;
+	float4 World2   : WORLD2;
+	float4 World3   : WORLD3;
+};
+
+struct VertexShaderOutput
+{
+	float4 Color    : COLOR;
+	float4 Position : SV_Position;
+};
+
+VertexShaderOutput main(VertexPosColor IN)
+{
+	VertexShaderOutput OUT;
+
+	// The rows build the matrix as stored on the CPU, so row vector * matrix like DirectXMath.
+	float4x4 world = float4x4(IN.World0, IN.World1, IN.World2, IN.World3);
+	float4 worldPosition = mul(IN.Position, world);
+
+	// The view-projection root constants are read column major, i.e. transposed.
+	OUT.Position = mul(ViewProjectionCB.VP, worldPosition);
+	OUT.Color = IN.Color;
+
+	return OUT;
+}
@@ -0,0 +1,12 @@
+// Cube pixel shader: outputs the color interpolated from the vertices.
+//		Compiled at runtime by the ShaderCache (ps_6_0) and by the build (PixelShader.cso).
+
+struct PixelShaderInput
+{
+	float4 Color : COLOR;
+};
+
+float4 main(PixelShaderInput IN) : SV_Target
+{
+	return IN.Color;
+}
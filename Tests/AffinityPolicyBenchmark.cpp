@@ -0,0 +1,128 @@
+// The task scheduler and the job system under each thread affinity policy, set up the way
+//		Application does it. Not a test (timings depend on the machine and on what else
+//		runs on it); run it by hand:
+//
+//		AffinityPolicyBenchmark [iterations]
+//
+// Per policy:
+//		- compute:  ParallelFor over 8M elements of math, grain 4096,
+//		- memory:   ParallelFor streaming through 64 MB (bandwidth bound, SMT helps less),
+//		- frame:    200 small ParallelFor calls back to back (64k elements) - the cost of
+//		            waking and spinning workers, per call,
+//		- both:     the compute loop on the scheduler while the job system runs the same
+//		            amount of work - the pools are meant to get disjoint cores.
+#include "CpuTopology.h"
+#include "JobSystem.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const size_t NUM_ELEMENTS = 8 * 1024 * 1024;
+	const size_t MEMORY_ELEMENTS = 16 * 1024 * 1024;	// 64 MB of floats
+	const size_t FRAME_ELEMENTS = 64 * 1024;
+	const int FRAME_CALLS = 200;
+
+	// Best of "iterations" runs, in milliseconds.
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	void Compute(const float* in, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			out[i] = std::sqrt(in[i] * in[i] + 1.0f) * 0.5f + std::sin(in[i]);
+	}
+
+	void Stream(const float* in, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			out[i] = in[i] * 0.5f + 1.0f;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 5;
+
+	const CpuTopology topology = CpuTopology::Query();
+	std::printf("%u logical processors, %u physical cores, best of %d\n\n",
+		topology.GetNumLogicalProcessors(), topology.GetNumPhysicalCores(), iterations);
+
+	std::vector<float> in(MEMORY_ELEMENTS), out(MEMORY_ELEMENTS), jobOut(NUM_ELEMENTS);
+	for (size_t i = 0; i < MEMORY_ELEMENTS; ++i)
+		in[i] = float(i % 1000) * 0.01f;
+
+	// The calling thread is unpinned again before every policy pins it.
+	std::vector<uint32_t> allProcessors;
+	for (const LogicalProcessor& processor : topology.GetLogicalProcessors())
+		allProcessors.push_back(processor.id);
+
+	std::printf("policy            workers  jobs  compute ms  memory ms  frame us    both ms\n");
+	const AffinityPolicy policies[] = { AffinityPolicy::None, AffinityPolicy::PhysicalCores, AffinityPolicy::PerformanceCores };
+	for (AffinityPolicy policyType : policies)
+	{
+		SetCurrentThreadAffinity(allProcessors);
+
+		// Same setup as Application::Initialize.
+		const ThreadAffinityPolicy policy(topology, policyType);
+		policy.ApplyToCurrentThread(ThreadRole::Render);
+		double computeMs, memoryMs, frameMs, bothMs;
+		uint32_t numWorkers, numJobWorkers;
+		{
+			TaskScheduler scheduler(policy.GetNumThreads(ThreadRole::Worker), [&policy](uint32_t workerIndex) {
+				policy.ApplyToCurrentThread(ThreadRole::Worker, workerIndex - 1);
+			});
+			JobSystem jobSystem(policy.GetNumThreads(ThreadRole::JobWorker), 128, 64 * 1024, [&policy](uint32_t workerIndex) {
+				policy.ApplyToCurrentThread(ThreadRole::JobWorker, workerIndex);
+			});
+			numWorkers = scheduler.GetNumThreads() - 1;
+			numJobWorkers = jobSystem.GetNumWorkerThreads();
+
+			computeMs = MeasureMilliseconds(iterations, [&]() {
+				scheduler.ParallelFor(0, NUM_ELEMENTS, 4096, [&](size_t begin, size_t end) { Compute(in.data(), out.data(), begin, end); });
+			});
+			memoryMs = MeasureMilliseconds(iterations, [&]() {
+				scheduler.ParallelFor(0, MEMORY_ELEMENTS, 16384, [&](size_t begin, size_t end) { Stream(in.data(), out.data(), begin, end); });
+			});
+			frameMs = MeasureMilliseconds(iterations, [&]() {
+				for (int call = 0; call < FRAME_CALLS; ++call)
+					scheduler.ParallelFor(0, FRAME_ELEMENTS, 1024, [&](size_t begin, size_t end) { Stream(in.data(), out.data(), begin, end); });
+			});
+
+			// 64 jobs over the same 8M elements, kicked before the scheduler loop starts.
+			const size_t jobSize = NUM_ELEMENTS / 64;
+			std::vector<std::function<void()>> jobs;
+			for (size_t begin = 0; begin < NUM_ELEMENTS; begin += jobSize)
+				jobs.push_back([&in, &jobOut, begin, jobSize]() { Compute(in.data(), jobOut.data(), begin, begin + jobSize); });
+			bothMs = MeasureMilliseconds(iterations, [&]() {
+				JobCounter counter;
+				jobSystem.RunJobs(jobs.data(), jobs.size(), &counter);
+				scheduler.ParallelFor(0, NUM_ELEMENTS, 4096, [&](size_t begin, size_t end) { Compute(in.data(), out.data(), begin, end); });
+				jobSystem.WaitForCounter(counter);
+			});
+		}
+
+		std::printf("%-16s  %7u  %4u  %10.2f  %9.2f  %8.1f  %9.2f\n", policy.GetPolicyName(), numWorkers, numJobWorkers,
+			computeMs, memoryMs, frameMs * 1000.0 / FRAME_CALLS, bothMs);
+	}
+
+	return 0;
+}
@@ -0,0 +1,298 @@
+#include "Test.h"
+
+#include "AssetFile.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// AssetFile::Read() in both modes against the bytes that were written, on a file whose
+//		size isn't a multiple of the block size. On a file system with direct I/O (the
+//		test says which) the unbuffered reads are real O_DIRECT reads: a read into
+//		memory that isn't placed like the file offset only works through the bounce
+//		buffer, a partial block only by reading the whole block around it. Covered:
+//		- destinations at the same offset modulo 4096 as the file offset (the direct
+//		  path) and misaligned ones, reads within a block, across blocks and longer than
+//		  the bounce buffer, all with guard bytes around the destination,
+//		- reads up to the end of the file (a short read of the last block) and past it,
+//		- a file that shrank after it was opened: the short read is an error, not garbage,
+//		- concurrent reads, and the package table.
+namespace
+{
+	using Bytes = std::vector<uint8_t>;
+
+	const char* const FILE_PATH = "AssetFileTest.bin";
+	const char* const PACKAGE_PATH = "AssetFileTest.pkg";
+	const size_t FILE_SIZE = 3 * 1024 * 1024 + 1234;
+	const size_t BLOCK = ASSET_FILE_IO_ALIGNMENT;
+	const uint8_t GUARD = 0xCD;
+
+	void WriteFile(const char* path, const Bytes& data)
+	{
+		FILE* file = std::fopen(path, "wb");
+		CHECK(file != nullptr);
+		if (!file)
+			return;
+		CHECK(std::fwrite(data.data(), 1, data.size(), file) == data.size());
+		std::fclose(file);
+	}
+
+	Bytes MakeFile()
+	{
+		Bytes data(FILE_SIZE);
+		uint32_t state = 73;
+		for (uint8_t& b : data)
+		{
+			state = state * 1664525u + 1013904223u;
+			b = uint8_t(state >> 24);
+		}
+		WriteFile(FILE_PATH, data);
+		return data;
+	}
+
+	// Destination memory with guard bytes on both sides, placed at any offset modulo the
+	//		block size.
+	class Destination
+	{
+	public:
+		explicit Destination(size_t capacity)
+			: m_Memory(capacity + 4 * BLOCK)
+		{
+			const uintptr_t address = reinterpret_cast<uintptr_t>(m_Memory.data());
+			m_Base = m_Memory.data() + ((BLOCK - address % BLOCK) % BLOCK) + BLOCK;
+		}
+
+		uint8_t* Prepare(size_t residue, size_t size)
+		{
+			m_Data = m_Base + residue % BLOCK;
+			m_Size = size;
+			std::fill(m_Memory.begin(), m_Memory.end(), GUARD);
+			return m_Data;
+		}
+
+		// The read bytes match "expected" and nothing around them was touched.
+		bool Matches(const uint8_t* expected) const
+		{
+			if (std::memcmp(m_Data, expected, m_Size) != 0)
+				return false;
+			for (const uint8_t* p = m_Memory.data(); p < m_Data; ++p)
+			{
+				if (*p != GUARD)
+					return false;
+			}
+			for (const uint8_t* p = m_Data + m_Size; p < m_Memory.data() + m_Memory.size(); ++p)
+			{
+				if (*p != GUARD)
+					return false;
+			}
+			return true;
+		}
+
+	private:
+		std::vector<uint8_t> m_Memory;
+		uint8_t* m_Base;
+		uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+
+	const char* ModeName(AssetFileMode mode)
+	{
+		return mode == AssetFileMode::Mapped ? "mapped" : "unbuffered";
+	}
+
+	bool ReadAndCompare(const AssetFile& file, const Bytes& data, Destination& destination, uint64_t offset, size_t size, size_t residue)
+	{
+		uint8_t* out = destination.Prepare(residue, size);
+		const bool ok = file.Read(offset, out, size) && destination.Matches(data.data() + offset);
+		if (!ok)
+		{
+			std::fprintf(stderr, "\t%s read of %zu bytes at %llu into +%zu failed\n", ModeName(file.GetMode()), size,
+				(unsigned long long)offset, residue % BLOCK);
+		}
+		return ok;
+	}
+
+	void TestReads(AssetFileMode mode, const Bytes& data)
+	{
+		AssetFile file;
+		CHECK(file.Open(FILE_PATH, mode) && file.IsOpen() && file.GetMode() == mode && file.GetSize() == FILE_SIZE);
+		CHECK((mode == AssetFileMode::Mapped) == (file.GetMappedData() != nullptr));
+
+		Destination destination(FILE_SIZE);
+		const uint64_t offsets[] = { 0, 1, 100, BLOCK - 1, BLOCK, BLOCK + 1, 5 * BLOCK + 17, 1024 * 1024 - 3 };
+		const size_t sizes[] = { 1, 3, BLOCK - 1, BLOCK, BLOCK + 1, 2 * BLOCK + 5, 256 * 1024 - 1, 256 * 1024 + 4097, 700 * 1024 };
+		// Congruent (0), misaligned by a byte, by half a block, and one short of congruent.
+		const size_t shifts[] = { 0, 1, BLOCK / 2, BLOCK - 1 };
+		bool all = true;
+		for (uint64_t offset : offsets)
+			for (size_t size : sizes)
+				for (size_t shift : shifts)
+					all = ReadAndCompare(file, data, destination, offset, size, size_t(offset) + shift) && all;
+		CHECK(all);
+
+		// Up to the end: the last block is only partly in the file.
+		bool tail = true;
+		for (size_t size : { size_t(1), size_t(1234), size_t(1235), BLOCK + 1234, size_t(FILE_SIZE) })
+			for (size_t shift : shifts)
+				tail = ReadAndCompare(file, data, destination, FILE_SIZE - size, size, FILE_SIZE - size + shift) && tail;
+		CHECK(tail);
+
+		// Past the end, or starting there.
+		uint8_t* out = destination.Prepare(0, 0);
+		CHECK(!file.Read(FILE_SIZE - 10, out, 11) && !file.Read(FILE_SIZE + 1, out, 0) && !file.Read(0, out, FILE_SIZE + 1));
+		CHECK(!file.Read(~uint64_t(0), out, 2));
+		CHECK(file.Read(FILE_SIZE, out, 0) && file.Read(7, out, 0));
+
+		// Random reads.
+		std::mt19937 random(73);
+		std::uniform_int_distribution<size_t> sizeDistribution(1, 600 * 1024), shiftDistribution(0, BLOCK - 1);
+		bool fuzz = true;
+		for (int i = 0; i < 300; ++i)
+		{
+			const size_t size = sizeDistribution(random);
+			const uint64_t offset = std::uniform_int_distribution<uint64_t>(0, FILE_SIZE - size)(random);
+			// Half of them congruent.
+			const size_t residue = i % 2 ? size_t(offset) : shiftDistribution(random);
+			fuzz = ReadAndCompare(file, data, destination, offset, size, residue) && fuzz;
+		}
+		CHECK(fuzz);
+
+		file.Close();
+		CHECK(!file.IsOpen() && !file.Read(0, out, 1));
+	}
+
+	// Read() is const and positional: threads read the same file at once.
+	void TestConcurrentReads(AssetFileMode mode, const Bytes& data, TaskScheduler& scheduler)
+	{
+		AssetFile file;
+		CHECK(file.Open(FILE_PATH, mode));
+		std::atomic<int> failures(0);
+		scheduler.ParallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+			Destination destination(300 * 1024);
+			for (size_t i = begin; i < end; ++i)
+			{
+				const size_t size = 1000 + i * 4500;
+				const uint64_t offset = (i * 48611) % (FILE_SIZE - size);
+				if (!ReadAndCompare(file, data, destination, offset, size, i % 3 ? size_t(offset) : i))
+					++failures;
+			}
+		});
+		CHECK(failures == 0);
+	}
+
+	// A file that was cut short after Open(): the unbuffered reads of the lost range see
+	//		a short read, which must fail the read. (Mapped mode can't survive this - the
+	//		pages are gone - so only unbuffered.)
+	void TestShrunkFile(const Bytes& data)
+	{
+#if !defined(_WIN32)
+		AssetFile file;
+		CHECK(file.Open(FILE_PATH, AssetFileMode::Unbuffered));
+		const size_t newSize = FILE_SIZE - 3 * BLOCK - 100;
+		CHECK(::truncate(FILE_PATH, off_t(newSize)) == 0);
+
+		Destination destination(FILE_SIZE);
+		for (size_t shift : { size_t(0), size_t(1) })
+		{
+			// Still inside the file: fine.
+			CHECK(ReadAndCompare(file, data, destination, newSize - 5000, 5000, newSize - 5000 + shift));
+			// Over the new end, ending in the block that was cut, or in a later one.
+			for (size_t size : { size_t(101), size_t(BLOCK), 3 * BLOCK, size_t(FILE_SIZE - newSize) })
+			{
+				uint8_t* out = destination.Prepare(newSize - 1 + shift, size);
+				CHECK(!file.Read(newSize - 1, out, size));
+			}
+			uint8_t* out = destination.Prepare(shift, 2 * BLOCK);
+			CHECK(!file.Read(FILE_SIZE - 2 * BLOCK, out, 2 * BLOCK));
+		}
+		// Long congruent reads whose direct part runs into the new end, with and without a
+		//		partial block after it.
+		uint8_t* out = destination.Prepare(0, FILE_SIZE);
+		CHECK(!file.Read(0, out, FILE_SIZE));
+		CHECK(!file.Read(0, out, FILE_SIZE & ~(BLOCK - 1)));
+#else
+		(void)data;
+#endif
+	}
+
+	void TestPackageTable()
+	{
+		AssetPackageWriter writer(AssetType::Texture, 42);
+		writer.AddSection(SectionType::TextureHeader, TextureAssetHeader{ 4, 4, 1, 1, 28, 0 });
+		writer.AddSection(SectionType::TextureData, Bytes(5000, 7));
+		Bytes package;
+		writer.Serialize(package);
+		WriteFile(PACKAGE_PATH, package);
+
+		for (AssetFileMode mode : { AssetFileMode::Mapped, AssetFileMode::Unbuffered })
+		{
+			AssetFile file;
+			AssetPackageHeader header;
+			std::vector<AssetSection> sections;
+			CHECK(file.Open(PACKAGE_PATH, mode) && ReadAssetPackageTable(file, header, sections));
+			CHECK(header.type == AssetType::Texture && header.settingsHash == 42 && sections.size() == 2);
+			CHECK(sections.size() == 2 && sections[1].type == SectionType::TextureData && sections[1].size == 5000);
+
+			// The section read into upload-like memory: 512 aligned placement.
+			Bytes section(5000 + BLOCK);
+			uint8_t* out = section.data() + (BLOCK - reinterpret_cast<uintptr_t>(section.data()) % BLOCK) % BLOCK;
+			CHECK(sections.size() == 2 && file.Read(sections[1].offset, out, 5000) && std::count(out, out + 5000, 7) == 5000);
+		}
+
+		// A section past the end of the file.
+		Bytes damaged = package;
+		AssetSection section;
+		std::memcpy(&section, damaged.data() + sizeof(AssetPackageHeader) + sizeof(AssetSection), sizeof(section));
+		section.size += 1;
+		std::memcpy(damaged.data() + sizeof(AssetPackageHeader) + sizeof(AssetSection), &section, sizeof(section));
+		WriteFile(PACKAGE_PATH, damaged);
+		AssetFile file;
+		AssetPackageHeader header;
+		std::vector<AssetSection> sections;
+		CHECK(file.Open(PACKAGE_PATH, AssetFileMode::Unbuffered) && !ReadAssetPackageTable(file, header, sections) && sections.empty());
+		file.Close();
+		std::remove(PACKAGE_PATH);
+	}
+}
+
+int main()
+{
+#if defined(O_DIRECT)
+	{
+		const Bytes probe(BLOCK, 0);
+		WriteFile(FILE_PATH, probe);
+		const int file = ::open(FILE_PATH, O_RDONLY | O_DIRECT);
+		std::printf("AssetFile: unbuffered reads %s\n", file >= 0 ? "use O_DIRECT" : "fall back to buffered I/O here");
+		if (file >= 0)
+			::close(file);
+	}
+#endif
+
+	TaskScheduler scheduler(3);
+	const Bytes data = MakeFile();
+
+	AssetFile missing;
+	CHECK(!missing.Open("AssetFileTest.missing", AssetFileMode::Mapped) && !missing.Open("AssetFileTest.missing", AssetFileMode::Unbuffered));
+
+	for (AssetFileMode mode : { AssetFileMode::Mapped, AssetFileMode::Unbuffered })
+	{
+		TestReads(mode, data);
+		TestConcurrentReads(mode, data, scheduler);
+	}
+	TestShrunkFile(data);
+	TestPackageTable();
+
+	std::remove(FILE_PATH);
+	return Test::Result("AssetFile");
+}
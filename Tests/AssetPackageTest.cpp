@@ -0,0 +1,236 @@
+#include "Test.h"
+
+#include "AssetPackage.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// AssetPackageView::Open() is all that stands between a damaged file on disk and section
+//		pointers handed to the GPU upload code. A small mesh package is written, then
+//		damaged in every way the view must notice - truncated, grown, a wrong header, a
+//		section table that points outside the file - and finally fuzzed: whatever Open()
+//		accepts must only hand out sections inside the buffer.
+namespace
+{
+	using Bytes = std::vector<uint8_t>;
+
+	const uint64_t SETTINGS_HASH = 0x0123456789ABCDEFull;
+
+	// Header, positions that end mid section, no normals, an empty UV section, indices.
+	Bytes MakePackage()
+	{
+		MeshAssetHeader header = {};
+		header.vertexCount = 100;
+		header.indexCount = 300;
+		header.lodCount = 1;
+
+		std::vector<uint16_t> positions(header.vertexCount * 4);
+		for (size_t i = 0; i < positions.size(); ++i)
+			positions[i] = uint16_t(i * 7);
+		std::vector<uint16_t> indices(header.indexCount);
+		for (size_t i = 0; i < indices.size(); ++i)
+			indices[i] = uint16_t(i % header.vertexCount);
+
+		AssetPackageWriter writer(AssetType::Mesh, SETTINGS_HASH);
+		writer.AddSection(SectionType::MeshHeader, header);
+		writer.AddSection(SectionType::Positions, positions);
+		writer.AddSection(SectionType::UVs, nullptr, 0);
+		writer.AddSection(SectionType::Indices, indices);
+
+		Bytes package;
+		writer.Serialize(package);
+		CHECK(package.size() == writer.GetSize());
+		return package;
+	}
+
+	AssetPackageHeader& HeaderOf(Bytes& package)
+	{
+		return *reinterpret_cast<AssetPackageHeader*>(package.data());
+	}
+
+	AssetSection& SectionOf(Bytes& package, size_t index)
+	{
+		return reinterpret_cast<AssetSection*>(package.data() + sizeof(AssetPackageHeader))[index];
+	}
+
+	bool Opens(const Bytes& package)
+	{
+		AssetPackageView view;
+		return view.Open(package.data(), package.size());
+	}
+
+	void TestValid()
+	{
+		const Bytes package = MakePackage();
+		CHECK(package == MakePackage());
+
+		AssetPackageView view;
+		CHECK(view.Open(package.data(), package.size()));
+		CHECK(view.GetType() == AssetType::Mesh && view.GetHeader().settingsHash == SETTINGS_HASH);
+		CHECK(view.GetHeader().sectionCount == 4 && view.GetHeader().fileSize == package.size());
+
+		const uint64_t tableEnd = sizeof(AssetPackageHeader) + 4 * sizeof(AssetSection);
+		for (SectionType type : { SectionType::MeshHeader, SectionType::Positions, SectionType::UVs, SectionType::Indices })
+		{
+			const AssetSection* section = view.FindSection(type);
+			CHECK(section && section->offset % ASSET_SECTION_ALIGNMENT == 0 && section->offset >= tableEnd);
+		}
+
+		const MeshAssetHeader* header = view.GetSectionStruct<MeshAssetHeader>(SectionType::MeshHeader);
+		CHECK(header && header->vertexCount == 100 && header->indexCount == 300);
+		size_t count = 0;
+		const uint16_t* positions = view.GetSectionArray<uint16_t>(SectionType::Positions, count);
+		CHECK(positions && count == 400 && positions[399] == uint16_t(399 * 7));
+		const uint16_t* indices = view.GetSectionArray<uint16_t>(SectionType::Indices, count);
+		CHECK(indices && count == 300 && indices[299] == 99);
+
+		// An empty section is present but has no array; a missing one is nullptr, size 0.
+		size_t size = 1;
+		CHECK(view.FindSection(SectionType::UVs) && view.GetSectionArray<uint32_t>(SectionType::UVs, count) == nullptr && count == 0);
+		CHECK(view.GetSectionData(SectionType::Normals, &size) == nullptr && size == 0);
+		// Wrong element size or struct size.
+		CHECK(view.GetSectionStruct<MeshAssetLod>(SectionType::MeshHeader) == nullptr);
+		CHECK(view.GetSectionArray<TextureAssetHeader>(SectionType::Positions, count) == nullptr && count == 0);
+	}
+
+	void TestSize()
+	{
+		const Bytes package = MakePackage();
+		AssetPackageView view;
+		CHECK(!view.Open(nullptr, package.size()));
+		for (size_t size = 0; size < package.size(); ++size)
+		{
+			if (view.Open(package.data(), size))
+			{
+				CHECK(!"truncated package opened");
+				break;
+			}
+		}
+
+		Bytes grown = package;
+		grown.push_back(0);
+		CHECK(!Opens(grown));
+
+		// Even with fileSize matching, sections no longer fit once the file is cut short.
+		Bytes cut = package;
+		cut.resize(cut.size() - 1);
+		HeaderOf(cut).fileSize = cut.size();
+		CHECK(!Opens(cut));
+	}
+
+	void TestHeader()
+	{
+		const Bytes package = MakePackage();
+		AssetPackageHeader header;
+		std::memcpy(&header, package.data(), sizeof(header));
+		CHECK(AssetPackageView::IsValidHeader(header));
+
+		Bytes damaged = package;
+		HeaderOf(damaged).magic ^= 1;
+		CHECK(!AssetPackageView::IsValidHeader(HeaderOf(damaged)) && !Opens(damaged));
+
+		damaged = package;
+		HeaderOf(damaged).version = ASSET_PACKAGE_VERSION + 1;
+		CHECK(!AssetPackageView::IsValidHeader(HeaderOf(damaged)) && !Opens(damaged));
+
+		damaged = package;
+		HeaderOf(damaged).type = static_cast<AssetType>(3);
+		CHECK(!AssetPackageView::IsValidHeader(HeaderOf(damaged)) && !Opens(damaged));
+
+		// A table longer than the file, including one whose byte size needs 64 bits.
+		damaged = package;
+		HeaderOf(damaged).sectionCount = uint32_t(package.size() / sizeof(AssetSection));
+		CHECK(!Opens(damaged));
+		HeaderOf(damaged).sectionCount = 0xFFFFFFFFu;
+		CHECK(!Opens(damaged));
+
+		// Fewer sections is still a valid package - the rest is just unreferenced data.
+		damaged = package;
+		HeaderOf(damaged).sectionCount = 2;
+		CHECK(Opens(damaged));
+	}
+
+	void TestSections()
+	{
+		const Bytes package = MakePackage();
+		const size_t indices = 3;
+
+		Bytes damaged = package;
+		SectionOf(damaged, indices).offset -= 2;
+		CHECK(!Opens(damaged));
+
+		// Aligned, but over the header and section table.
+		damaged = package;
+		SectionOf(damaged, indices).offset = 0;
+		CHECK(!Opens(damaged));
+
+		damaged = package;
+		SectionOf(damaged, indices).offset = AlignAssetOffset(package.size());
+		SectionOf(damaged, indices).size = 0;
+		CHECK(!Opens(damaged));
+
+		// Ends one byte past the file.
+		damaged = package;
+		SectionOf(damaged, indices).size = package.size() - SectionOf(damaged, indices).offset + 1;
+		CHECK(!Opens(damaged));
+
+		// offset + size wraps around to a small value.
+		damaged = package;
+		SectionOf(damaged, indices).size = ~uint64_t(0) - SectionOf(damaged, indices).offset + 1;
+		CHECK(!Opens(damaged));
+
+		// Exactly up to the end is fine.
+		damaged = package;
+		SectionOf(damaged, indices).size = package.size() - SectionOf(damaged, indices).offset;
+		CHECK(Opens(damaged));
+	}
+
+	// Random bytes of the header and section table overwritten. Open() may accept the
+	//		result (a changed hash or section type is still a well formed package), but then every
+	//		section must lie in the buffer.
+	void TestFuzz()
+	{
+		const Bytes package = MakePackage();
+		const size_t tableEnd = sizeof(AssetPackageHeader) + 4 * sizeof(AssetSection);
+		std::mt19937 random(67);
+		std::uniform_int_distribution<size_t> position(0, tableEnd - 1);
+		std::uniform_int_distribution<int> byte(0, 255), changes(1, 4);
+
+		bool contained = true;
+		int opened = 0;
+		for (int iteration = 0; iteration < 20000; ++iteration)
+		{
+			Bytes damaged = package;
+			for (int i = changes(random); i > 0; --i)
+				damaged[position(random)] = uint8_t(byte(random));
+
+			AssetPackageView view;
+			if (!view.Open(damaged.data(), damaged.size()))
+				continue;
+			++opened;
+			const AssetPackageHeader& header = view.GetHeader();
+			for (uint32_t i = 0; i < header.sectionCount; ++i)
+			{
+				const AssetSection& section = SectionOf(damaged, i);
+				contained = contained && section.offset <= damaged.size() && section.size <= damaged.size() - section.offset;
+			}
+		}
+		CHECK(contained);
+		// Some of the damage lands on bytes that don't matter (hash, reserved, types).
+		CHECK(opened > 0);
+	}
+}
+
+int main()
+{
+	TestValid();
+	TestSize();
+	TestHeader();
+	TestSections();
+	TestFuzz();
+
+	return Test::Result("AssetPackage");
+}
@@ -0,0 +1,193 @@
+// Throughput and latency of AsyncFileIO against plain pread on the calling thread. Not a
+//		test (timings depend on the machine and the disk); run it by hand:
+//
+//		AsyncFileIOBenchmark [megabytes] [iterations]
+//
+// Reads the whole file in requests of 4 KB, 64 KB and 1 MB, buffered and unbuffered:
+//		- pread:    one read after the other on the calling thread, the baseline,
+//		- backend:  the native backend (io_uring / IOCP) and the Blocking one, with 1, 8
+//		            and 32 reads kept in flight by the caller - a new one is queued as soon
+//		            as one completes, like a streaming system refilling its budget.
+// Latency is from Read() to the onComplete call, median and 99th percentile of the last
+//		pass. Buffered passes after the first come from the page cache (best of iterations
+//		is reported), so those rows measure per-request overhead rather than the disk;
+//		unbuffered falls back to buffered where the file system has no direct I/O (tmpfs).
+#include "AssetFile.h"
+#include "AsyncFileIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+	const char* const FILE_PATH = "AsyncFileIOBenchmark.bin";
+
+	struct Pass
+	{
+		double megabytesPerSecond = 0.0;
+		double medianUs = 0.0;
+		double p99Us = 0.0;
+	};
+
+	double Microseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::micro>(duration).count();
+	}
+
+	// Best throughput of "iterations" passes, the latencies of the last one.
+	template<typename Function>
+	Pass MeasurePasses(int iterations, uint64_t fileSize, std::vector<double>& latencies, Function function)
+	{
+		Pass pass;
+		for (int i = 0; i < iterations; ++i)
+		{
+			const Clock::time_point start = Clock::now();
+			if (!function())
+				return Pass();
+			const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			pass.megabytesPerSecond = std::max(pass.megabytesPerSecond, fileSize / (1024.0 * 1024.0) / seconds);
+		}
+		std::sort(latencies.begin(), latencies.end());
+		pass.medianUs = latencies[latencies.size() / 2];
+		pass.p99Us = latencies[latencies.size() * 99 / 100];
+		return pass;
+	}
+
+	void PrintRow(const char* mode, size_t requestSize, const char* reader, uint32_t depth, const Pass& pass)
+	{
+		if (pass.megabytesPerSecond == 0.0)
+		{
+			std::printf("%-10s  %6zu KB  %-8s  %5u  read failed\n", mode, requestSize / 1024, reader, depth);
+			return;
+		}
+		std::printf("%-10s  %6zu KB  %-8s  %5u  %9.1f  %10.1f  %8.1f\n", mode, requestSize / 1024, reader, depth,
+			pass.megabytesPerSecond, pass.medianUs, pass.p99Us);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint64_t fileSize = uint64_t(argc > 1 ? std::atol(argv[1]) : 256) * 1024 * 1024;
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 3;
+
+	std::vector<uint8_t> data(1024 * 1024);
+	uint32_t state = 74;
+	for (uint8_t& b : data)
+	{
+		state = state * 1664525u + 1013904223u;
+		b = uint8_t(state >> 24);
+	}
+	FILE* file = std::fopen(FILE_PATH, "wb");
+	if (!file)
+	{
+		std::printf("can't create %s\n", FILE_PATH);
+		return 1;
+	}
+	for (uint64_t written = 0; written < fileSize; written += data.size())
+		std::fwrite(data.data(), 1, data.size(), file);
+	std::fclose(file);
+
+	// One destination for the whole file, aligned for unbuffered reads.
+	std::vector<uint8_t> buffer(size_t(fileSize) + ASSET_FILE_IO_ALIGNMENT);
+	uint8_t* destination = buffer.data() + (ASSET_FILE_IO_ALIGNMENT - reinterpret_cast<uintptr_t>(buffer.data()) % ASSET_FILE_IO_ALIGNMENT);
+
+	AsyncFileIO::Settings nativeSettings;
+	AsyncFileIO::Settings blockingSettings;
+	blockingSettings.useNativeBackend = false;
+	const bool hasNativeBackend = AsyncFileIO(nativeSettings).GetBackendType() != IoBackendType::Blocking;
+
+	std::printf("%llu MB, best of %d%s\n\n", (unsigned long long)(fileSize >> 20), iterations,
+		hasNativeBackend ? "" : ", no native backend here (io_uring unavailable)");
+	std::printf("mode        request    reader    depth       MB/s   median us    p99 us\n");
+
+	const size_t requestSizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+	const uint32_t depths[] = { 1, 8, 32 };
+	for (int unbuffered = 0; unbuffered < 2; ++unbuffered)
+	{
+		const char* mode = unbuffered ? "unbuffered" : "buffered";
+		for (size_t requestSize : requestSizes)
+		{
+			const size_t numRequests = size_t((fileSize + requestSize - 1) / requestSize);
+			std::vector<double> latencies(numRequests);
+
+#if !defined(_WIN32)
+			{
+				// The file descriptor of an IoFile opened the same way, used directly.
+				AsyncFileIO io(blockingSettings);
+				IoFile ioFile = io.OpenFile(FILE_PATH, unbuffered != 0);
+				const Pass pass = MeasurePasses(iterations, fileSize, latencies, [&]() {
+					for (size_t i = 0; i < numRequests; ++i)
+					{
+						const uint64_t offset = uint64_t(i) * requestSize;
+						const Clock::time_point start = Clock::now();
+						if (::pread(int(ioFile.handle), destination + offset, requestSize, off_t(offset)) < 0)
+							return false;
+						latencies[i] = Microseconds(Clock::now() - start);
+					}
+					return true;
+				});
+				PrintRow(mode, requestSize, "pread", 1, pass);
+				io.CloseFile(ioFile);
+			}
+#endif
+
+			for (int native = hasNativeBackend ? 1 : 0; native >= 0; --native)
+			{
+				for (uint32_t depth : depths)
+				{
+					AsyncFileIO::Settings settings = native ? nativeSettings : blockingSettings;
+					settings.queueDepth = depth;
+					AsyncFileIO io(settings);
+					IoFile ioFile = io.OpenFile(FILE_PATH, unbuffered != 0);
+
+					std::vector<Clock::time_point> submitted(numRequests);
+					std::mutex mutex;
+					std::condition_variable completedOne;
+					size_t numCompleted = 0;
+					bool failed = false;
+					const Pass pass = MeasurePasses(iterations, fileSize, latencies, [&]() {
+						numCompleted = 0;
+						for (size_t i = 0; i < numRequests; ++i)
+						{
+							{
+								std::unique_lock<std::mutex> lock(mutex);
+								completedOne.wait(lock, [&]() { return i - numCompleted < depth; });
+							}
+							IoReadRequest request;
+							request.file = ioFile;
+							request.offset = uint64_t(i) * requestSize;
+							request.destination = destination + request.offset;
+							request.size = requestSize;
+							request.onComplete = [&, i](const IoResult& result) {
+								latencies[i] = Microseconds(Clock::now() - submitted[i]);
+								std::lock_guard<std::mutex> lock(mutex);
+								failed |= result.status != IoStatus::Completed;
+								++numCompleted;
+								completedOne.notify_one();
+							};
+							submitted[i] = Clock::now();
+							io.Read(std::move(request));
+						}
+						io.WaitIdle();
+						return !failed;
+					});
+					PrintRow(mode, requestSize, native ? "native" : "blocking", depth, pass);
+					io.CloseFile(ioFile);
+				}
+			}
+		}
+	}
+
+	std::remove(FILE_PATH);
+	return 0;
+}
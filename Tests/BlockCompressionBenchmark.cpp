@@ -0,0 +1,102 @@
+// Speed and quality of the BCn encoders, per format, quality and nearest palette search
+//		kernel. Not a test (timings depend on the machine); run it by hand:
+//
+//		BlockCompressionBenchmark [size] [threads]
+//
+// Megapixels per second on one thread for every supported kernel, then with "threads"
+//		workers (default: all cores) for the fastest one, and the PSNR of the result -
+//		the same for every kernel, they produce the same blocks.
+#include "BlockCompressionImages.h"
+#include "TaskScheduler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace BlockTest;
+
+namespace
+{
+	const char* const FORMAT_NAMES[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+	const char* const QUALITY_NAMES[] = { "Fast", "Normal", "Best" };
+	const char* const KERNEL_NAMES[] = { "Scalar", "SSE2", "AVX2" };
+
+	// Encodes "image" until at least 0.2 s have passed; returns megapixels per second.
+	double Measure(BlockFormat format, BlockQuality quality, const Image& image, Bytes& blocks, TaskScheduler* scheduler)
+	{
+		const size_t blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+		const size_t outRowPitch = blocksX * GetBlockSize(format);
+		blocks.resize(outRowPitch * blocksY);
+
+		int iterations = 0;
+		const auto start = std::chrono::high_resolution_clock::now();
+		double seconds = 0.0;
+		do
+		{
+			CompressImage(format, quality, image.rgba.data(), image.width, image.height, size_t(image.width) * 4,
+				blocks.data(), outRowPitch, scheduler);
+			++iterations;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < 0.2);
+		return double(image.width) * image.height * iterations / seconds * 1e-6;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t size = argc > 1 ? uint32_t(std::atoi(argv[1])) : 512;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+
+	// Color formats on the diffuse image (BC1 opaque, it would punch through the alpha),
+	//		BC4/BC5 on the normal map.
+	Image diffuse = MakeDiffuse(size, size);
+	Image opaque = diffuse;
+	for (size_t i = 0; i < opaque.rgba.size(); i += 4)
+		opaque.rgba[i + 3] = 255;
+	const Image normals = MakeNormalMap(size, size);
+
+	const BlockKernel fastest = GetBlockKernel();
+	std::printf("%ux%u texels, %u thread(s) for the parallel column\n\n", size, size, threads);
+	std::printf("format quality     image     PSNR dB");
+	for (int kernel = 0; kernel < 3; ++kernel)
+	{
+		if (IsBlockKernelSupported(BlockKernel(kernel)))
+			std::printf(" %8s", KERNEL_NAMES[kernel]);
+	}
+	std::printf("  parallel (MPix/s)\n");
+
+	for (int format = 0; format < 5; ++format)
+	{
+		const BlockFormat blockFormat = BlockFormat(format);
+		const Image& image = blockFormat == BlockFormat::BC1 ? opaque :
+			blockFormat == BlockFormat::BC4 || blockFormat == BlockFormat::BC5 ? normals : diffuse;
+		const int channelCount = blockFormat == BlockFormat::BC4 ? 1 : blockFormat == BlockFormat::BC5 ? 2 :
+			blockFormat == BlockFormat::BC1 ? 3 : 4;
+
+		for (int quality = 0; quality < 3; ++quality)
+		{
+			Bytes blocks, decoded;
+			double speeds[3] = {};
+			for (int kernel = 0; kernel < 3; ++kernel)
+			{
+				if (SetBlockKernel(BlockKernel(kernel)))
+					speeds[kernel] = Measure(blockFormat, BlockQuality(quality), image, blocks, nullptr);
+			}
+			SetBlockKernel(fastest);
+			const double parallel = Measure(blockFormat, BlockQuality(quality), image, blocks, &scheduler);
+
+			DecodeImage(blockFormat, blocks, image.width, image.height, decoded);
+			std::printf("%-6s %-8s %8s %10.2f", FORMAT_NAMES[format], QUALITY_NAMES[quality], image.name,
+				Psnr(image, decoded, 0, channelCount));
+			for (int kernel = 0; kernel < 3; ++kernel)
+			{
+				if (IsBlockKernelSupported(BlockKernel(kernel)))
+					std::printf(" %8.2f", speeds[kernel]);
+			}
+			std::printf("  %8.2f\n", parallel);
+		}
+	}
+	return 0;
+}
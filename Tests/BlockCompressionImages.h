@@ -0,0 +1,280 @@
+#pragma once
+
+// Shared by BlockCompressionTest and BlockCompressionBenchmark: BCn decoders and the
+//		reference images the encoders are measured on.
+#include "Tools/AssetCooker/BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// =====================================================================================
+//										Decoders
+// =====================================================================================
+
+// Written from the format specifications, independent of the encoders: the test decodes
+//		what the cooker wrote the way the texture units would, and measures the result
+//		against the source image.
+namespace BlockTest
+{
+	using Bytes = std::vector<uint8_t>;
+
+	inline uint32_t Read16(const uint8_t* p) { return uint32_t(p[0]) | uint32_t(p[1]) << 8; }
+
+	inline uint64_t Read64(const uint8_t* p)
+	{
+		uint64_t value = 0;
+		for (int i = 7; i >= 0; --i)
+			value = value << 8 | p[i];
+		return value;
+	}
+
+	inline void Rgb565ToRgb888(uint32_t color, int* rgb)
+	{
+		const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// BC1, or the color half of BC3 ("bc1" false): RGB of 16 texels, and alpha for BC1.
+	//		BC3 always uses the 4 color palette, BC1 only if color0 > color1.
+	inline void DecodeBc1(const uint8_t* block, uint8_t* rgba, bool bc1)
+	{
+		const uint32_t c0 = Read16(block), c1 = Read16(block + 2);
+		const bool fourColors = !bc1 || c0 > c1;
+		int palette[4][4];
+		Rgb565ToRgb888(c0, palette[0]);
+		Rgb565ToRgb888(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		for (int c = 0; c < 3; ++c)
+		{
+			if (fourColors)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = fourColors ? 255 : 0;
+
+		const uint32_t indices = uint32_t(Read16(block + 4) | Read16(block + 6) << 16);
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* color = palette[(indices >> (2 * i)) & 3];
+			for (int c = 0; c < (bc1 ? 4 : 3); ++c)
+				rgba[i * 4 + c] = uint8_t(color[c]);
+		}
+	}
+
+	// One channel of BC3 alpha / BC4 / BC5, to every 4th byte from "out".
+	inline void DecodeBc4(const uint8_t* block, uint8_t* out)
+	{
+		const int r0 = block[0], r1 = block[1];
+		int palette[8] = { r0, r1 };
+		if (r0 > r1)
+		{
+			for (int i = 1; i < 7; ++i)
+				palette[i + 1] = ((7 - i) * r0 + i * r1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i) * r0 + i * r1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		const uint64_t indices = Read64(block) >> 16;
+		for (int i = 0; i < 16; ++i)
+			out[i * 4] = uint8_t(palette[(indices >> (3 * i)) & 7]);
+	}
+
+	// BC7 mode 6: 7 bit RGBA endpoints + a p-bit each, 4 bit indices (the first one, the
+	//		anchor, 3 bits). The encoder writes no other mode - any other fails the test.
+	inline bool DecodeBc7(const uint8_t* block, uint8_t* rgba)
+	{
+		const uint64_t low = Read64(block), high = Read64(block + 8);
+		if ((low & 0x7F) != 0x40)
+			return false;
+
+		auto bits = [&](int first, int count) {
+			uint64_t value = first >= 64 ? high >> (first - 64) : low >> first;
+			if (first < 64 && first + count > 64)
+				value |= high << (64 - first);
+			return int(value & ((1ull << count) - 1));
+		};
+
+		int endpoints[2][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = bits(7 + c * 14, 7);
+			endpoints[1][c] = bits(7 + c * 14 + 7, 7);
+		}
+		const int pbits[2] = { bits(63, 1), bits(64, 1) };
+		for (int e = 0; e < 2; ++e)
+		{
+			for (int c = 0; c < 4; ++c)
+				endpoints[e][c] = endpoints[e][c] << 1 | pbits[e];
+		}
+
+		static const int WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		int position = 65;
+		for (int i = 0; i < 16; ++i)
+		{
+			const int count = i == 0 ? 3 : 4;
+			const int weight = WEIGHTS[bits(position, count)];
+			position += count;
+			for (int c = 0; c < 4; ++c)
+				rgba[i * 4 + c] = uint8_t(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+		}
+		return true;
+	}
+
+	// Decodes a whole image written by CompressImage() to RGBA8 (unused channels 0, alpha
+	//		255 where the format has none).
+	inline bool DecodeImage(BlockFormat format, const Bytes& blocks, uint32_t width, uint32_t height, Bytes& rgba)
+	{
+		const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const size_t blockSize = GetBlockSize(format);
+		rgba.assign(size_t(width) * height * 4, 0);
+		bool valid = true;
+		for (uint32_t by = 0; by < blocksY; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocksX; ++bx)
+			{
+				const uint8_t* block = blocks.data() + (size_t(by) * blocksX + bx) * blockSize;
+				uint8_t texels[64] = {};
+				for (int i = 0; i < 16; ++i)
+					texels[i * 4 + 3] = 255;
+
+				switch (format)
+				{
+				case BlockFormat::BC1: DecodeBc1(block, texels, true); break;
+				case BlockFormat::BC3: DecodeBc4(block, texels + 3); DecodeBc1(block + 8, texels, false); break;
+				case BlockFormat::BC4: DecodeBc4(block, texels); break;
+				case BlockFormat::BC5: DecodeBc4(block, texels); DecodeBc4(block + 8, texels + 1); break;
+				case BlockFormat::BC7: valid = DecodeBc7(block, texels) && valid; break;
+				}
+
+				for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+				{
+					for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					{
+						for (int c = 0; c < 4; ++c)
+							rgba[((size_t(by) * 4 + y) * width + bx * 4 + x) * 4 + c] = texels[(y * 4 + x) * 4 + c];
+					}
+				}
+			}
+		}
+		return valid;
+	}
+}
+
+// =====================================================================================
+//										Images
+// =====================================================================================
+
+namespace BlockTest
+{
+	struct Image
+	{
+		const char* name;
+		uint32_t width, height;
+		Bytes rgba;
+	};
+
+	// Smooth value noise in [0, 1], a stand-in for natural image content.
+	inline float Noise(float x, float y, uint32_t seed)
+	{
+		auto hash = [seed](int ix, int iy) {
+			uint32_t h = uint32_t(ix) * 374761393u + uint32_t(iy) * 668265263u + seed * 2246822519u;
+			h = (h ^ (h >> 13)) * 1274126177u;
+			return float((h ^ (h >> 16)) & 0xFFFF) / 65535.0f;
+		};
+		const int ix = int(std::floor(x)), iy = int(std::floor(y));
+		const float fx = x - float(ix), fy = y - float(iy);
+		const float sx = fx * fx * (3.0f - 2.0f * fx), sy = fy * fy * (3.0f - 2.0f * fy);
+		const float top = hash(ix, iy) + (hash(ix + 1, iy) - hash(ix, iy)) * sx;
+		const float bottom = hash(ix, iy + 1) + (hash(ix + 1, iy + 1) - hash(ix, iy + 1)) * sx;
+		return top + (bottom - top) * sy;
+	}
+
+	inline float Octaves(float x, float y, uint32_t seed)
+	{
+		float sum = 0.0f, amplitude = 0.5f;
+		for (int octave = 0; octave < 4; ++octave, x *= 2.0f, y *= 2.0f, amplitude *= 0.5f)
+			sum += Noise(x, y, seed + octave) * amplitude;
+		return sum / 0.9375f;
+	}
+
+	inline uint8_t ToByte(float value)
+	{
+		return uint8_t(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Colored noise with hard edged shapes and a soft alpha - the general case.
+	inline Image MakeDiffuse(uint32_t width, uint32_t height)
+	{
+		Image image = { "diffuse", width, height, Bytes(size_t(width) * height * 4) };
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const float u = float(x) / 16.0f, v = float(y) / 16.0f;
+				const float n = Octaves(u, v, 1);
+				const bool brick = (int(x / 24 + (y / 12) % 2) + int(y / 12)) % 3 == 0;
+				uint8_t* texel = &image.rgba[(size_t(y) * width + x) * 4];
+				texel[0] = ToByte(brick ? 0.6f + 0.3f * n : 0.2f + 0.5f * n);
+				texel[1] = ToByte(brick ? 0.3f + 0.2f * n : 0.3f + 0.4f * Octaves(u, v, 7));
+				texel[2] = ToByte(brick ? 0.2f * n : 0.5f * Octaves(u, v, 13));
+				texel[3] = ToByte(Octaves(u * 0.5f, v * 0.5f, 21));
+			}
+		}
+		return image;
+	}
+
+	// Tangent space normals of a noise height field, packed to [0, 255].
+	inline Image MakeNormalMap(uint32_t width, uint32_t height)
+	{
+		Image image = { "normals", width, height, Bytes(size_t(width) * height * 4) };
+		auto heightAt = [](float x, float y) { return Octaves(x / 12.0f, y / 12.0f, 31) * 6.0f; };
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const float dx = heightAt(x + 1.0f, float(y)) - heightAt(x - 1.0f, float(y));
+				const float dy = heightAt(float(x), y + 1.0f) - heightAt(float(x), y - 1.0f);
+				const float length = std::sqrt(dx * dx + dy * dy + 4.0f);
+				uint8_t* texel = &image.rgba[(size_t(y) * width + x) * 4];
+				texel[0] = ToByte(-dx / length * 0.5f + 0.5f);
+				texel[1] = ToByte(-dy / length * 0.5f + 0.5f);
+				texel[2] = ToByte(2.0f / length * 0.5f + 0.5f);
+				texel[3] = 255;
+			}
+		}
+		return image;
+	}
+
+	// Peak signal to noise ratio over "channelCount" channels from "firstChannel", in dB.
+	inline double Psnr(const Image& source, const Bytes& decoded, int firstChannel, int channelCount)
+	{
+		double squaredError = 0.0;
+		for (size_t i = 0; i < decoded.size(); i += 4)
+		{
+			for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+			{
+				const double difference = double(decoded[i + c]) - double(source.rgba[i + c]);
+				squaredError += difference * difference;
+			}
+		}
+		const double mse = squaredError / (double(decoded.size() / 4) * channelCount);
+		return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+	}
+}
@@ -0,0 +1,195 @@
+#include "Test.h"
+
+#include "BlockCompressionImages.h"
+#include "Framework/TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// =====================================================================================
+//										Tests
+// =====================================================================================
+
+using namespace BlockTest;
+
+namespace
+{
+	const char* const FORMAT_NAMES[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+	const char* const QUALITY_NAMES[] = { "Fast", "Normal", "Best" };
+
+	struct Expectation
+	{
+		BlockFormat format;
+		// Channels the format stores, and is measured on.
+		int firstChannel, channelCount;
+		// Lowest acceptable PSNR (dB) on the diffuse and normal map images per quality,
+		//		0.3 dB under what the encoders reach - a drop below is a regression. Update
+		//		them when an encoder improves.
+		double minPsnr[2][3];
+	};
+
+	const Expectation EXPECTATIONS[] =
+	{
+		{ BlockFormat::BC1, 0, 3, { { 40.1, 40.2, 40.6 }, { 31.6, 31.6, 31.7 } } },
+		{ BlockFormat::BC3, 0, 4, { { 41.2, 41.4, 41.7 }, { 32.8, 32.8, 33.0 } } },
+		{ BlockFormat::BC4, 0, 1, { { 52.1, 52.4, 52.5 }, { 42.2, 42.9, 43.2 } } },
+		{ BlockFormat::BC5, 0, 2, { { 53.0, 53.3, 53.4 }, { 42.3, 43.0, 43.3 } } },
+		{ BlockFormat::BC7, 0, 4, { { 41.9, 41.9, 42.0 }, { 33.9, 33.9, 33.9 } } },
+	};
+
+	Bytes Compress(BlockFormat format, BlockQuality quality, const Image& image, TaskScheduler* scheduler)
+	{
+		const size_t blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+		const size_t outRowPitch = blocksX * GetBlockSize(format);
+		Bytes blocks(outRowPitch * blocksY);
+		CompressImage(format, quality, image.rgba.data(), image.width, image.height, size_t(image.width) * 4,
+			blocks.data(), outRowPitch, scheduler);
+		return blocks;
+	}
+
+	// Every format and quality on both images: PSNR above the floor, and not lower with
+	//		a higher quality. Odd sizes exercise the partial edge blocks.
+	void TestQuality(TaskScheduler& scheduler)
+	{
+		const Image images[2] = { MakeDiffuse(254, 130), MakeNormalMap(129, 67) };
+		for (const Expectation& expectation : EXPECTATIONS)
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				// BC1 would punch through the diffuse alpha - measure color on an opaque copy.
+				Image image = images[i];
+				if (expectation.format == BlockFormat::BC1)
+				{
+					for (size_t t = 0; t < image.rgba.size(); t += 4)
+						image.rgba[t + 3] = 255;
+				}
+
+				double previous = 0.0;
+				for (int quality = 0; quality < 3; ++quality)
+				{
+					const Bytes blocks = Compress(expectation.format, BlockQuality(quality), image, &scheduler);
+					Bytes decoded;
+					CHECK(DecodeImage(expectation.format, blocks, image.width, image.height, decoded));
+					const double psnr = Psnr(image, decoded, expectation.firstChannel, expectation.channelCount);
+					std::printf("%s %-6s %-8s %6.2f dB\n", FORMAT_NAMES[int(expectation.format)], QUALITY_NAMES[quality],
+						image.name, psnr);
+					CHECK(psnr >= expectation.minPsnr[i][quality]);
+					CHECK(psnr >= previous - 0.05);
+					previous = psnr;
+				}
+			}
+		}
+	}
+
+	// Texels with alpha < 128 decode fully transparent from BC1, the others opaque.
+	void TestBc1Alpha()
+	{
+		Image image = MakeDiffuse(64, 64);
+		for (size_t i = 0; i < image.rgba.size(); i += 4)
+			image.rgba[i + 3] = image.rgba[i + 3] < 128 ? 0 : 255;
+
+		for (int quality = 0; quality < 3; ++quality)
+		{
+			Bytes decoded;
+			DecodeImage(BlockFormat::BC1, Compress(BlockFormat::BC1, BlockQuality(quality), image, nullptr),
+				image.width, image.height, decoded);
+			bool alphaExact = true;
+			for (size_t i = 0; i < decoded.size(); i += 4)
+				alphaExact = alphaExact && decoded[i + 3] == image.rgba[i + 3];
+			CHECK(alphaExact);
+		}
+	}
+
+	// Flat blocks of any color come back within the format's precision. BC1 turns a
+	//		color with alpha < 128 into transparent black.
+	void TestSolidColors()
+	{
+		const uint8_t colors[][4] = { { 0, 0, 0, 255 }, { 255, 255, 255, 255 }, { 255, 0, 0, 0 }, { 17, 130, 201, 77 }, { 90, 91, 92, 200 } };
+		for (const uint8_t* color : colors)
+		{
+			Image image = { "solid", 4, 4, Bytes(64) };
+			for (size_t i = 0; i < 64; ++i)
+				image.rgba[i] = color[i % 4];
+			for (const Expectation& expectation : EXPECTATIONS)
+			{
+				int expected[4] = { color[0], color[1], color[2], color[3] };
+				int channelCount = expectation.channelCount, tolerance = 1;
+				if (expectation.format == BlockFormat::BC1)
+				{
+					const bool transparent = color[3] < 128;
+					for (int c = 0; c < 4; ++c)
+						expected[c] = transparent ? 0 : c == 3 ? 255 : color[c];
+					channelCount = 4;
+				}
+				if (expectation.format == BlockFormat::BC1 || expectation.format == BlockFormat::BC3)
+					tolerance = 4;
+
+				Bytes decoded;
+				DecodeImage(expectation.format, Compress(expectation.format, BlockQuality::Best, image, nullptr), 4, 4, decoded);
+				int maxDifference = 0;
+				for (size_t i = 0; i < 64; i += 4)
+				{
+					for (int c = expectation.firstChannel; c < expectation.firstChannel + channelCount; ++c)
+						maxDifference = std::max(maxDifference, std::abs(int(decoded[i + c]) - expected[c]));
+				}
+				CHECK(maxDifference <= tolerance);
+			}
+		}
+	}
+
+	// Block rows spread over workers give the same bytes as on one thread.
+	void TestParallel(TaskScheduler& scheduler)
+	{
+		const Image image = MakeDiffuse(100, 100);
+		for (const Expectation& expectation : EXPECTATIONS)
+			CHECK(Compress(expectation.format, BlockQuality::Normal, image, nullptr) ==
+				Compress(expectation.format, BlockQuality::Normal, image, &scheduler));
+	}
+
+	// Every kernel of the nearest palette search gives the scalar kernel's bytes, for
+	//		every format and quality.
+	void TestKernels(TaskScheduler& scheduler)
+	{
+		const BlockKernel fastest = GetBlockKernel();
+		CHECK(IsBlockKernelSupported(BlockKernel::Scalar));
+		CHECK(SetBlockKernel(BlockKernel::Scalar) && GetBlockKernel() == BlockKernel::Scalar);
+
+		const Image images[2] = { MakeDiffuse(130, 66), MakeNormalMap(67, 35) };
+		for (const Expectation& expectation : EXPECTATIONS)
+		{
+			for (const Image& image : images)
+			{
+				for (int quality = 0; quality < 3; ++quality)
+				{
+					CHECK(SetBlockKernel(BlockKernel::Scalar));
+					const Bytes scalar = Compress(expectation.format, BlockQuality(quality), image, &scheduler);
+					for (BlockKernel kernel : { BlockKernel::SSE2, BlockKernel::AVX2 })
+					{
+						if (!SetBlockKernel(kernel))
+							continue;
+						CHECK(Compress(expectation.format, BlockQuality(quality), image, &scheduler) == scalar);
+					}
+				}
+			}
+		}
+
+		if (!IsBlockKernelSupported(BlockKernel::AVX2))
+			std::printf("BlockCompression: AVX2 not supported, AVX2 kernel not tested\n");
+		CHECK(SetBlockKernel(fastest));
+	}
+}
+
+int main()
+{
+	TaskScheduler scheduler(3);
+	TestQuality(scheduler);
+	TestBc1Alpha();
+	TestSolidColors();
+	TestParallel(scheduler);
+	TestKernels(scheduler);
+
+	return Test::Result("BlockCompression");
+}
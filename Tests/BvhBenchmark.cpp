@@ -0,0 +1,148 @@
+// Timing of the BVH: build, refit, hierarchical frustum culling and ray queries on a
+//		scene of a million boxes. Not a test (timings depend on the machine); run it by hand:
+//
+//		BvhBenchmark [numPrimitives] [threads]
+//
+// Frustum culling is compared with the linear SIMD culler over all boxes, the ray
+//		queries report millions of rays per second.
+#include "Bvh.h"
+#include "FrustumCulling.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Best of "iterations" runs, in milliseconds.
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	// A city-like scene: boxes on a ground plane of side ~ sqrt(n), some of them tall.
+	void MakeScene(size_t count, BoundingBoxes& boxes)
+	{
+		const float side = std::sqrt(float(count)) * 4.0f;
+		std::mt19937 random(57);
+		std::uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+		std::uniform_real_distribution<float> size(0.2f, 2.0f);
+		std::uniform_real_distribution<float> height(0.0f, 10.0f);
+
+		boxes.Resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			float h = i % 16 == 0 ? height(random) * 4.0f : height(random);
+			boxes.Set(i, XMFLOAT3(position(random), h, position(random)), XMFLOAT3(size(random), size(random) + h * 0.5f, size(random)));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t numPrimitives = argc > 1 ? size_t(std::atol(argv[1])) : 1000000;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	const int iterations = 5;
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+
+	BoundingBoxes boxes;
+	MakeScene(numPrimitives, boxes);
+	const float side = std::sqrt(float(numPrimitives)) * 4.0f;
+
+	Bvh bvh;
+	double buildMs = MeasureMilliseconds(iterations, [&]() { bvh.Build(boxes); });
+	double parallelBuildMs = MeasureMilliseconds(iterations, [&]() { bvh.Build(boxes, &scheduler); });
+
+	// Everything moves a little every frame.
+	BoundingBoxes moved = boxes;
+	for (size_t i = 0; i < numPrimitives; ++i)
+		moved.centerX[i] += (i % 7) * 0.1f;
+	double refitMs = MeasureMilliseconds(iterations, [&]() { bvh.Refit(moved); });
+	bvh.Refit(boxes);
+
+	// A camera on the ground looking across the scene.
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(-side * 0.5f, 10.0f, -side * 0.5f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, side * 0.5f);
+	Frustum frustum = Frustum::FromViewProjection(XMMatrixMultiply(view, projection));
+
+	std::vector<uint32_t> visible;
+	visible.reserve(numPrimitives);
+	double bvhCullMs = MeasureMilliseconds(iterations, [&]() { visible.clear(); bvh.CullFrustum(frustum, boxes, visible); });
+	const size_t numVisible = visible.size();
+	FrustumCuller culler;
+	double linearCullMs = MeasureMilliseconds(iterations, [&]() { culler.CullBoxes(frustum, boxes, visible); });
+	double parallelCullMs = MeasureMilliseconds(iterations, [&]() { culler.CullBoxes(frustum, boxes, visible, &scheduler); });
+
+	// Primary rays from the same camera, 4 neighbouring pixels per packet, and random
+	//		shadow-like segments from the ground up to a light 30 units above.
+	const uint32_t width = 512, height = 256;
+	std::vector<Ray> cameraRays;
+	for (uint32_t y = 0; y < height; y += 2)
+	{
+		for (uint32_t x = 0; x < width; x += 2)
+		{
+			const uint32_t quad[4][2] = { { x, y }, { x + 1, y }, { x, y + 1 }, { x + 1, y + 1 } };
+			for (const auto& pixel : quad)
+				cameraRays.push_back(ScreenPointToRay(pixel[0] + 0.5f, pixel[1] + 0.5f, float(width), float(height), view, projection));
+		}
+	}
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+	std::vector<Ray> segments(cameraRays.size());
+	for (Ray& ray : segments)
+	{
+		ray.origin = XMFLOAT3(position(random), 1.0f, position(random));
+		ray.direction = XMFLOAT3(position(random) * 0.05f, 30.0f, position(random) * 0.05f);
+		ray.tMax = 1.0f;
+	}
+
+	RayHit hit;
+	size_t numHits = 0;
+	double raycastMs = MeasureMilliseconds(iterations, [&]() {
+		numHits = 0;
+		for (const Ray& ray : cameraRays)
+			numHits += bvh.Raycast(ray, boxes, hit);
+	});
+	double packetMs = MeasureMilliseconds(iterations, [&]() {
+		RayHit hits[4];
+		for (size_t i = 0; i < cameraRays.size(); i += 4)
+			bvh.RaycastPacket(&cameraRays[i], boxes, hits);
+	});
+	size_t numOccluded = 0;
+	double occludedMs = MeasureMilliseconds(iterations, [&]() {
+		numOccluded = 0;
+		for (const Ray& ray : segments)
+			numOccluded += bvh.IsOccluded(ray, boxes);
+	});
+
+	const double numRays = double(cameraRays.size());
+	std::printf("%zu primitives, %zu nodes, %u thread(s), best of %d\n", numPrimitives, bvh.GetNodeCount(), threads, iterations);
+	std::printf("  Build, serial:               %9.2f ms\n", buildMs);
+	std::printf("  Build, parallel:             %9.2f ms\n", parallelBuildMs);
+	std::printf("  Refit:                       %9.2f ms\n", refitMs);
+	std::printf("  CullFrustum:                 %9.2f ms  (%zu visible)\n", bvhCullMs, numVisible);
+	std::printf("  linear CullBoxes:            %9.2f ms\n", linearCullMs);
+	std::printf("  linear CullBoxes, parallel:  %9.2f ms\n", parallelCullMs);
+	std::printf("  Raycast:                     %9.2f ms  (%.2f Mrays/s, %zu hits)\n", raycastMs, numRays / raycastMs * 1e-3, numHits);
+	std::printf("  RaycastPacket:               %9.2f ms  (%.2f Mrays/s)\n", packetMs, numRays / packetMs * 1e-3);
+	std::printf("  IsOccluded:                  %9.2f ms  (%.2f Mrays/s, %zu occluded)\n", occludedMs, numRays / occludedMs * 1e-3, numOccluded);
+	return 0;
+}
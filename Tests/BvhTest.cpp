@@ -0,0 +1,279 @@
+#include "Test.h"
+
+#include "Bvh.h"
+#include "FrustumCulling.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// Every query is checked against brute force over all primitives, after a serial build,
+//		a parallel build and a refit: CullFrustum must return the set CullBoxesScalar
+//		returns, Raycast and RaycastPacket the closest box entry, IsOccluded whether there
+//		is any hit before tMax.
+//
+// Half of the boxes sit on an integer grid so that many of them share their planes, and
+//		a quarter of the rays are axis parallel with the origin on such a plane: a zero
+//		direction component gives 1/d = inf and (plane - o) * inf = 0 * inf = NaN in the
+//		slab test. The reference handles zero components with an explicit range check.
+
+namespace
+{
+	const size_t NUM_BOXES = 10000;
+	const size_t NUM_RAYS = 8192;
+
+	void MakeBoxes(std::mt19937& random, BoundingBoxes& boxes)
+	{
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.0f, 3.0f);
+		std::uniform_int_distribution<int> cell(-40, 40);
+
+		boxes.Resize(NUM_BOXES);
+		for (size_t i = 0; i < NUM_BOXES; ++i)
+		{
+			if (i % 2)
+			{
+				// min and max on integers: shared planes, exact in float.
+				boxes.Set(i, XMFLOAT3(cell(random) + 0.5f, cell(random) + 0.5f, cell(random) + 0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+			}
+			else
+			{
+				float flat = i % 10 == 0 ? 0.0f : size(random);
+				boxes.Set(i, XMFLOAT3(position(random), position(random), position(random)), XMFLOAT3(size(random), flat, size(random)));
+			}
+		}
+	}
+
+	// Random rays through the scene, coherent packets from a camera, axis parallel rays
+	//		on grid planes and short segments - 4 consecutive rays make one packet.
+	std::vector<Ray> MakeRays(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-110.0f, 110.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> length(1.0f, 60.0f);
+		std::uniform_int_distribution<int> plane(-40, 40);
+
+		std::vector<Ray> rays(NUM_RAYS);
+		for (size_t i = 0; i < NUM_RAYS; ++i)
+		{
+			Ray& ray = rays[i];
+			ray.origin = XMFLOAT3(position(random), position(random), position(random));
+			ray.direction = XMFLOAT3(unit(random), unit(random), unit(random));
+			ray.tMax = FLT_MAX;
+
+			switch (i / (NUM_RAYS / 4))
+			{
+			case 0:
+				break;
+			case 1:
+			{
+				// A camera at the edge of the scene; the 4 rays of a packet are close.
+				const size_t pixel = i / 4;
+				ray.origin = XMFLOAT3(0.0f, 20.0f, -150.0f);
+				ray.direction = XMFLOAT3((pixel % 32) / 32.0f - 0.5f + (i % 2) * 0.01f,
+					(pixel / 32 % 16) / 32.0f - 0.25f + (i % 4 / 2) * 0.01f, 1.0f);
+				break;
+			}
+			case 2:
+			{
+				// Origin on a grid plane, no direction component along its axis; one
+				//		packet lane in 4 also runs along a second grid plane.
+				const int axis = random() % 3;
+				float* origin = &ray.origin.x;
+				float* direction = &ray.direction.x;
+				origin[axis] = float(plane(random));
+				direction[axis] = i % 8 < 4 ? 0.0f : -0.0f;
+				if (i % 4 == 3)
+				{
+					const int second = (axis + 1) % 3;
+					origin[second] = float(plane(random));
+					direction[second] = 0.0f;
+				}
+				if (direction[0] == 0.0f && direction[1] == 0.0f && direction[2] == 0.0f)
+					direction[(axis + 2) % 3] = 1.0f;
+				break;
+			}
+			default:
+				ray.tMax = length(random);
+				break;
+			}
+		}
+		return rays;
+	}
+
+	// Box entry distance or FLT_MAX - the same float math as the BVH, except that zero
+	//		direction components are an explicit "is the origin between the planes".
+	float IntersectBox(const Ray& ray, const BoundingBoxes& boxes, uint32_t p, float tMax)
+	{
+		const float minimum[3] = { boxes.centerX[p] - boxes.extentX[p], boxes.centerY[p] - boxes.extentY[p], boxes.centerZ[p] - boxes.extentZ[p] };
+		const float maximum[3] = { boxes.centerX[p] + boxes.extentX[p], boxes.centerY[p] + boxes.extentY[p], boxes.centerZ[p] + boxes.extentZ[p] };
+		const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+		const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+
+		float tNear = 0.0f, tFar = std::numeric_limits<float>::infinity();
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (direction[axis] == 0.0f)
+			{
+				if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis])
+					return FLT_MAX;
+				continue;
+			}
+			const float inverse = 1.0f / direction[axis];
+			float t1 = (minimum[axis] - origin[axis]) * inverse, t2 = (maximum[axis] - origin[axis]) * inverse;
+			tNear = std::max(tNear, std::min(t1, t2));
+			tFar = std::min(tFar, std::max(t1, t2));
+		}
+		return (tFar >= tNear && tNear < tMax) ? tNear : FLT_MAX;
+	}
+
+	// Every third primitive is rejected by the exact test, the others keep the box entry.
+	bool RejectEveryThird(uint32_t primitive, const Ray&, float&)
+	{
+		return primitive % 3 != 0;
+	}
+
+	RayHit BruteForceRaycast(const Ray& ray, const BoundingBoxes& boxes, bool filtered)
+	{
+		RayHit hit = { INVALID_PRIMITIVE, ray.tMax };
+		for (uint32_t p = 0; p < boxes.GetCount(); ++p)
+		{
+			if (filtered && p % 3 == 0)
+				continue;
+			float t = IntersectBox(ray, boxes, p, hit.t);
+			if (t != FLT_MAX)
+			{
+				hit.t = t;
+				hit.primitive = p;
+			}
+		}
+		return hit;
+	}
+
+	// Ties (equal entry distances) may resolve to a different primitive - compare the
+	//		distance, and that the reported primitive really is entered there.
+	bool SameHit(const Ray& ray, const BoundingBoxes& boxes, const RayHit& hit, const RayHit& expected)
+	{
+		if (hit.primitive == INVALID_PRIMITIVE || expected.primitive == INVALID_PRIMITIVE)
+			return hit.primitive == expected.primitive;
+		return hit.t == expected.t && IntersectBox(ray, boxes, hit.primitive, FLT_MAX) == hit.t;
+	}
+
+	void CheckQueries(const Bvh& bvh, const BoundingBoxes& boxes, const std::vector<Ray>& rays)
+	{
+		// Frustum culling from a few viewpoints, one of them inside the scene.
+		const XMVECTOR eyes[] = { XMVectorSet(0.0f, 20.0f, -150.0f, 1.0f), XMVectorSet(5.0f, 1.0f, 3.0f, 1.0f), XMVectorSet(120.0f, 80.0f, 90.0f, 1.0f) };
+		for (FXMVECTOR eye : eyes)
+		{
+			XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 120.0f);
+			Frustum frustum = Frustum::FromViewProjection(XMMatrixMultiply(view, projection));
+
+			std::vector<uint32_t> expected(boxes.GetCount());
+			expected.resize(FrustumCuller::CullBoxesScalar(frustum, boxes, 0, boxes.GetCount(), expected.data()));
+			std::vector<uint32_t> visible;
+			bvh.CullFrustum(frustum, boxes, visible);
+			std::sort(visible.begin(), visible.end());
+			CHECK(visible == expected);
+		}
+
+		const Bvh::PrimitiveIntersector filter = RejectEveryThird;
+		for (int filtered = 0; filtered < 2; ++filtered)
+		{
+			const Bvh::PrimitiveIntersector& intersector = filtered ? filter : Bvh::PrimitiveIntersector();
+			int wrongRaycasts = 0, wrongPackets = 0, wrongOcclusion = 0, hits = 0;
+			for (size_t i = 0; i < rays.size(); i += 4)
+			{
+				RayHit packet[4];
+				bvh.RaycastPacket(&rays[i], boxes, packet, intersector);
+				for (size_t lane = 0; lane < 4; ++lane)
+				{
+					const Ray& ray = rays[i + lane];
+					const RayHit expected = BruteForceRaycast(ray, boxes, filtered != 0);
+					hits += expected.primitive != INVALID_PRIMITIVE;
+
+					RayHit hit;
+					bool found = bvh.Raycast(ray, boxes, hit, intersector);
+					wrongRaycasts += found != (expected.primitive != INVALID_PRIMITIVE) || !SameHit(ray, boxes, hit, expected);
+					wrongPackets += !SameHit(ray, boxes, packet[lane], expected);
+					wrongOcclusion += bvh.IsOccluded(ray, boxes, intersector) != (expected.primitive != INVALID_PRIMITIVE);
+				}
+			}
+			CHECK(wrongRaycasts == 0);
+			CHECK(wrongPackets == 0);
+			CHECK(wrongOcclusion == 0);
+			// Both outcomes are well represented.
+			CHECK(hits > int(rays.size() / 4) && hits < int(rays.size() * 3 / 4));
+		}
+	}
+
+	// An axis parallel ray along the face of a box, and along an edge of it.
+	void CheckRayOnBoxPlane()
+	{
+		BoundingBoxes boxes;
+		boxes.Resize(1);
+		boxes.Set(0, XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+		Bvh bvh;
+		bvh.Build(boxes);
+
+		const Ray rays[4] = {
+			{ XMFLOAT3(0.0f, 1.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), FLT_MAX },	// on the x = 0 face
+			{ XMFLOAT3(2.0f, 1.0f, -5.0f), XMFLOAT3(-0.0f, 0.0f, 1.0f), FLT_MAX },	// on the x = 2 face
+			{ XMFLOAT3(0.0f, 2.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), FLT_MAX },	// on an edge
+			{ XMFLOAT3(2.5f, 1.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), FLT_MAX },	// beside the box
+		};
+		RayHit packet[4];
+		bvh.RaycastPacket(rays, boxes, packet);
+		for (int i = 0; i < 4; ++i)
+		{
+			const bool expected = i < 3;
+			RayHit hit;
+			CHECK(bvh.Raycast(rays[i], boxes, hit) == expected);
+			CHECK(bvh.IsOccluded(rays[i], boxes) == expected);
+			CHECK((packet[i].primitive == 0) == expected);
+			if (expected)
+			{
+				CHECK(hit.t == 5.0f);
+				CHECK(packet[i].t == 5.0f);
+			}
+		}
+	}
+}
+
+int main()
+{
+	CheckRayOnBoxPlane();
+
+	std::mt19937 random(57);
+	BoundingBoxes boxes;
+	MakeBoxes(random, boxes);
+	const std::vector<Ray> rays = MakeRays(random);
+
+	Bvh bvh;
+	bvh.Build(boxes);
+	CheckQueries(bvh, boxes, rays);
+
+	TaskScheduler scheduler(3);
+	bvh.Build(boxes, &scheduler);
+	CheckQueries(bvh, boxes, rays);
+
+	// Everything moves a little (the grid boxes by whole units, so they keep sharing
+	//		planes), then the same queries on the refitted tree.
+	std::uniform_int_distribution<int> step(-3, 3);
+	for (size_t i = 0; i < boxes.GetCount(); ++i)
+	{
+		boxes.centerX[i] += float(step(random));
+		boxes.centerY[i] += float(step(random));
+		boxes.centerZ[i] += float(step(random));
+	}
+	bvh.Refit(boxes);
+	CheckQueries(bvh, boxes, rays);
+
+	return Test::Result("Bvh");
+}
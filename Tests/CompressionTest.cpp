@@ -0,0 +1,275 @@
+#include "Test.h"
+
+#include "Compression.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(DX12FW_TEST_WITH_LZ4)
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+namespace
+{
+	using Bytes = std::vector<uint8_t>;
+
+	// Sizes around the LZ4 end of block rules (last 5 bytes literals, no match starting
+	//		in the last 12) and around the 15 / 15 + 255 length extensions, in every kind
+	//		of data the pack files see.
+	std::vector<Bytes> MakeInputs()
+	{
+		std::mt19937 random(1);
+		std::vector<Bytes> inputs;
+		inputs.push_back(Bytes());
+		for (size_t size : { 1, 4, 5, 12, 13, 16, 19, 20, 64, 270, 271, 300 })
+		{
+			Bytes runs(size);
+			for (uint8_t& b : runs)
+				b = uint8_t(random() % 3);
+			inputs.push_back(runs);
+		}
+
+		Bytes noise(70000);
+		for (uint8_t& b : noise)
+			b = uint8_t(random());
+		inputs.push_back(noise);
+
+		inputs.push_back(Bytes(100000, 'a'));
+
+		const char text[] = "struct Vertex { float3 position; float3 normal; float2 uv; };\n";
+		Bytes mixed(64 * 1024);
+		for (size_t i = 0; i < mixed.size(); ++i)
+			mixed[i] = random() % 8 == 0 ? uint8_t(random()) : uint8_t(text[i % (sizeof(text) - 1)]);
+		inputs.push_back(mixed);
+		return inputs;
+	}
+
+	// Decodes into a buffer with guard bytes after "size" - a decoder writing past the
+	//		destination fails the check instead of corrupting the heap silently.
+	bool DecodeGuarded(CompressionMethod method, const uint8_t* source, size_t sourceSize, size_t size, Bytes* out = nullptr)
+	{
+		const size_t GUARD = 64;
+		Bytes destination(size + GUARD, 0xCD);
+		const bool ok = DecompressBlock(method, source, sourceSize, destination.data(), size);
+		bool guardIntact = true;
+		for (size_t i = size; i < destination.size(); ++i)
+			guardIntact = guardIntact && destination[i] == 0xCD;
+		CHECK(guardIntact);
+		if (out)
+			out->assign(destination.begin(), destination.begin() + size);
+		return ok;
+	}
+
+	Bytes Compress(CompressionMethod method, int level, const Bytes& input)
+	{
+		Bytes compressed(GetCompressBound(method, input.size()));
+		const size_t size = CompressBlock(method, level, input.data(), input.size(), compressed.data(), compressed.size());
+		compressed.resize(size);
+		return compressed;
+	}
+
+	void TestRoundTrip(CompressionMethod method, const std::vector<int>& levels)
+	{
+		if (!IsCompressionSupported(method))
+			return;
+
+		for (const Bytes& input : MakeInputs())
+		{
+			for (int level : levels)
+			{
+				const Bytes compressed = Compress(method, level, input);
+				CHECK(!compressed.empty() || input.empty());
+				CHECK(compressed.size() <= GetCompressBound(method, input.size()));
+
+				Bytes output;
+				CHECK(DecodeGuarded(method, compressed.data(), compressed.size(), input.size(), &output));
+				CHECK(output == input);
+
+				// The size is exact: a block never decodes to more or fewer bytes.
+				if (!input.empty())
+				{
+					CHECK(!DecodeGuarded(method, compressed.data(), compressed.size(), input.size() - 1));
+					CHECK(!DecodeGuarded(method, compressed.data(), compressed.size(), input.size() + 1));
+				}
+			}
+		}
+	}
+
+	// Compressing into less than the bound fails cleanly instead of overrunning.
+	void TestCapacity()
+	{
+		Bytes noise(4096);
+		std::mt19937 random(2);
+		for (uint8_t& b : noise)
+			b = uint8_t(random());
+
+		const size_t bound = GetCompressBound(CompressionMethod::LZ4, noise.size());
+		Bytes destination(bound + 64, 0xCD);
+		const size_t capacity = noise.size() / 2;
+		CHECK(CompressBlock(CompressionMethod::LZ4, LZ4_LEVEL_FAST, noise.data(), noise.size(), destination.data(), capacity) == 0);
+		CHECK(CompressBlock(CompressionMethod::LZ4, LZ4_LEVEL_MAX, noise.data(), noise.size(), destination.data(), capacity) == 0);
+		bool untouched = true;
+		for (size_t i = capacity; i < destination.size(); ++i)
+			untouched = untouched && destination[i] == 0xCD;
+		CHECK(untouched);
+	}
+
+	// Every proper prefix of a block is rejected: the last sequence is literals only, so
+	//		a cut either lands inside a sequence or leaves the output short.
+	void TestTruncated()
+	{
+		for (const Bytes& input : MakeInputs())
+		{
+			if (input.empty())
+				continue;
+			for (int level : { LZ4_LEVEL_FAST, LZ4_LEVEL_MAX })
+			{
+				const Bytes compressed = Compress(CompressionMethod::LZ4, level, input);
+				const size_t step = compressed.size() > 4096 ? 97 : 1;
+				for (size_t size = 0; size < compressed.size(); size += step)
+					CHECK(!DecodeGuarded(CompressionMethod::LZ4, compressed.data(), size, input.size()));
+			}
+		}
+	}
+
+	// Damaged blocks may decode to garbage or fail, but never touch memory outside the
+	//		source and destination.
+	void TestCorrupted()
+	{
+		std::mt19937 random(3);
+		for (const Bytes& input : MakeInputs())
+		{
+			const Bytes compressed = Compress(CompressionMethod::LZ4, 4, input);
+			if (compressed.empty())
+				continue;
+			for (int i = 0; i < 500; ++i)
+			{
+				Bytes damaged = compressed;
+				const int flips = 1 + int(random() % 4);
+				for (int k = 0; k < flips; ++k)
+					damaged[random() % damaged.size()] ^= uint8_t(1u << (random() % 8));
+				// Copied to an exactly sized allocation, so overreads can be caught by a
+				//		sanitizer too.
+				const size_t size = random() % 2 ? damaged.size() : random() % damaged.size();
+				const Bytes source(damaged.begin(), damaged.begin() + size);
+				DecodeGuarded(CompressionMethod::LZ4, source.data(), source.size(), input.size());
+			}
+		}
+
+		// Hand made: one literal, a match of 8, five literals. Offset 1 repeats the literal,
+		//		offsets reaching before the start of the output and zero are invalid.
+		const uint8_t valid[] = { 0x14, 'a', 0x01, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+		Bytes output;
+		CHECK(DecodeGuarded(CompressionMethod::LZ4, valid, sizeof(valid), 1 + 8 + 5, &output));
+		CHECK(std::memcmp(output.data(), "aaaaaaaaabcdef", 14) == 0);
+		const uint8_t beforeStart[] = { 0x14, 'a', 0x05, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+		CHECK(!DecodeGuarded(CompressionMethod::LZ4, beforeStart, sizeof(beforeStart), 1 + 8 + 5));
+		const uint8_t zeroOffset[] = { 0x14, 'a', 0x00, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+		CHECK(!DecodeGuarded(CompressionMethod::LZ4, zeroOffset, sizeof(zeroOffset), 1 + 8 + 5));
+	}
+
+	// A block written by the reference LZ4_compress_default() (liblz4 1.9.4): a 40 byte
+	//		literal run, a phrase repeated 20 times, 300 times 'x' (offset 1) and a literal
+	//		tail. Checks the decoder against a foreign encoder without needing the library.
+	Bytes MakeReferenceInput()
+	{
+		Bytes data;
+		uint32_t state = 12345;
+		auto next = [&state] {
+			state = state * 1664525u + 1013904223u;
+			return uint8_t(state >> 24);
+		};
+		for (int i = 0; i < 40; ++i)
+			data.push_back(next());
+		const char phrase[] = "The quick brown fox jumps over the lazy dog. ";
+		for (int i = 0; i < 20; ++i)
+			data.insert(data.end(), phrase, phrase + sizeof(phrase) - 1);
+		data.insert(data.end(), 300, uint8_t('x'));
+		for (int i = 0; i < 20; ++i)
+			data.push_back(next());
+		return data;
+	}
+
+	const uint8_t REFERENCE_BLOCK[] =
+	{
+		0xFF, 0x46, 0x05, 0x04, 0x8B, 0xA2, 0xE8, 0x1C, 0x7E, 0x8C, 0x98, 0xC8, 0x0A, 0xBE, 0xF7, 0x12,
+		0xB3, 0x75, 0x65, 0xF5, 0x67, 0xF3, 0xFE, 0xA9, 0x6C, 0x7F, 0x49, 0x6C, 0xAC, 0x27, 0x16, 0xDA,
+		0x4F, 0x01, 0x76, 0x4A, 0x92, 0xF6, 0x03, 0xC7, 0x4D, 0x52, 0x54, 0x68, 0x65, 0x20, 0x71, 0x75,
+		0x69, 0x63, 0x6B, 0x20, 0x62, 0x72, 0x6F, 0x77, 0x6E, 0x20, 0x66, 0x6F, 0x78, 0x20, 0x6A, 0x75,
+		0x6D, 0x70, 0x73, 0x20, 0x6F, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6C, 0x61, 0x7A,
+		0x79, 0x20, 0x64, 0x6F, 0x67, 0x2E, 0x20, 0x2D, 0x00, 0xFF, 0xFF, 0xFF, 0x47, 0x1F, 0x78, 0x01,
+		0x00, 0xFF, 0x19, 0xF0, 0x05, 0xF4, 0x8B, 0xAA, 0xA8, 0x9F, 0x29, 0xED, 0xC4, 0x75, 0xB9, 0x54,
+		0xB6, 0x93, 0xC2, 0x71, 0x34, 0x74, 0xAB, 0x85, 0xDF,
+	};
+
+	void TestReferenceBlock()
+	{
+		const Bytes expected = MakeReferenceInput();
+		Bytes output;
+		CHECK(DecodeGuarded(CompressionMethod::LZ4, REFERENCE_BLOCK, sizeof(REFERENCE_BLOCK), expected.size(), &output));
+		CHECK(output == expected);
+	}
+
+#if defined(DX12FW_TEST_WITH_LZ4)
+	// Both directions against the linked reference library, at every level.
+	void TestInterop()
+	{
+		for (const Bytes& input : MakeInputs())
+		{
+			const int inputSize = int(input.size());
+			for (int level : { 1, 2, 4, 9, 12 })
+			{
+				const Bytes compressed = Compress(CompressionMethod::LZ4, level, input);
+				Bytes output(input.size() + 1);
+				const int decoded = LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data()),
+					reinterpret_cast<char*>(output.data()), int(compressed.size()), int(output.size()));
+				CHECK(decoded == inputSize);
+				CHECK(Bytes(output.begin(), output.begin() + input.size()) == input);
+			}
+
+			Bytes compressed(size_t(LZ4_compressBound(inputSize)));
+			// LZ4_compress_HC() reads through the pointer even for empty input.
+			const char* source = input.empty() ? "" : reinterpret_cast<const char*>(input.data());
+			char* destination = reinterpret_cast<char*>(compressed.data());
+			const int capacity = int(compressed.size());
+			for (int variant = 0; variant < 3; ++variant)
+			{
+				int size = 0;
+				if (variant == 0)
+					size = LZ4_compress_default(source, destination, inputSize, capacity);
+				else if (variant == 1)
+					size = LZ4_compress_fast(source, destination, inputSize, capacity, 8);
+				else
+					size = LZ4_compress_HC(source, destination, inputSize, capacity, LZ4HC_CLEVEL_MAX);
+				CHECK(size > 0);
+
+				Bytes output;
+				CHECK(DecodeGuarded(CompressionMethod::LZ4, compressed.data(), size_t(size), input.size(), &output));
+				CHECK(output == input);
+			}
+		}
+	}
+#endif
+}
+
+int main()
+{
+	TestRoundTrip(CompressionMethod::None, { 0 });
+	TestRoundTrip(CompressionMethod::LZ4, { 1, 2, 4, 9, 12 });
+	TestRoundTrip(CompressionMethod::Zstd, { 1, ZSTD_LEVEL_DEFAULT, 19 });
+	TestCapacity();
+	TestTruncated();
+	TestCorrupted();
+	TestReferenceBlock();
+#if defined(DX12FW_TEST_WITH_LZ4)
+	TestInterop();
+#else
+	std::printf("Compression: built without liblz4, interop with the reference codec not tested\n");
+#endif
+
+	return Test::Result("Compression");
+}
@@ -0,0 +1,256 @@
+#include "Test.h"
+
+#include "Tools/AssetCooker/CookCache.h"
+#include "Tools/AssetCooker/CookerUtils.h"
+#include "Framework/Hash.h"
+#include "Framework/TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// A cache in a scratch directory next to the test:
+//		- what one cache stores, records and Save()s, a second one Load()s back, and
+//		  Restore() reproduces the packages byte for byte,
+//		- an index with a wrong header is ignored, malformed lines in a good one skipped,
+//		- an object that was damaged, cut short or deleted is a miss, and the output
+//		  that Restore() would have replaced is left alone,
+//		- many tasks storing the same few packages at once write each object exactly once
+//		  and leave no temporary files behind.
+namespace
+{
+	using Bytes = std::vector<uint8_t>;
+
+	const char* const CACHE_DIRECTORY = "CookCacheTest.cache";
+	const char* const OUTPUT_PATH = "CookCacheTest.cache/output.pkg";
+
+	Bytes MakePackage(uint32_t seed, size_t size)
+	{
+		std::mt19937 random(seed);
+		Bytes package(size);
+		for (uint8_t& byte : package)
+			byte = uint8_t(random());
+		return package;
+	}
+
+	// Objects in the store and stray temporary files anywhere in the cache.
+	void CountFiles(size_t& objects, size_t& temporaries)
+	{
+		objects = temporaries = 0;
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(CACHE_DIRECTORY))
+		{
+			if (!entry.is_regular_file())
+				continue;
+			objects += entry.path().extension() == ".pkg" && entry.path().parent_path().parent_path().filename() == "objects";
+			temporaries += entry.path().extension() == ".tmp";
+		}
+	}
+
+	void ResetDirectory()
+	{
+		fs::remove_all(CACHE_DIRECTORY);
+		fs::create_directories(CACHE_DIRECTORY);
+	}
+
+	void TestRoundTrip()
+	{
+		ResetDirectory();
+		const Bytes first = MakePackage(1, 3000), second = MakePackage(2, 70000);
+		const std::string source = std::string(CACHE_DIRECTORY) + "/source.obj";
+		WriteFileAtomic(source, first.data(), first.size());
+
+		uint64_t firstHash, secondHash, sourceHash;
+		{
+			CookCache cache(CACHE_DIRECTORY);
+			CHECK(!cache.Load());
+			bool deduplicated = true;
+			firstHash = cache.Store(0x1111, first, &deduplicated);
+			CHECK(!deduplicated && firstHash == HashXXH64(first.data(), first.size()));
+			secondHash = cache.Store(0x2222, second, &deduplicated);
+			CHECK(!deduplicated);
+			// A second key for known content shares the object.
+			CHECK(cache.Store(0x3333, first, &deduplicated) == firstHash && deduplicated);
+
+			cache.SetDependencies("scene.gltf", { "scene.bin", "textures/a b.png" });
+			cache.SetDependencies("empty.obj", {});
+			sourceHash = cache.HashFile(source);
+			CHECK(sourceHash == HashXXH64(first.data(), first.size()));
+			cache.Save();
+		}
+
+		size_t objects, temporaries;
+		CountFiles(objects, temporaries);
+		CHECK(objects == 2 && temporaries == 0);
+
+		CookCache cache(CACHE_DIRECTORY);
+		CHECK(cache.Load());
+		uint64_t hash = 0;
+		CHECK(cache.Lookup(0x1111, hash) && hash == firstHash);
+		CHECK(cache.Lookup(0x2222, hash) && hash == secondHash);
+		CHECK(cache.Lookup(0x3333, hash) && hash == firstHash);
+		CHECK(!cache.Lookup(0x4444, hash));
+		CHECK(cache.GetDependencies("scene.gltf") == std::vector<std::string>({ "scene.bin", "textures/a b.png" }));
+		CHECK(cache.GetDependencies("empty.obj").empty() && cache.GetDependencies("unknown.obj").empty());
+
+		CHECK(cache.Restore(secondHash, OUTPUT_PATH) && ReadFileBytes(OUTPUT_PATH) == second);
+		CHECK(cache.Restore(firstHash, OUTPUT_PATH) && ReadFileBytes(OUTPUT_PATH) == first);
+		CHECK(!cache.Restore(0x1234, OUTPUT_PATH));
+		// Objects already on disk aren't written again by a new cache either.
+		bool deduplicated = false;
+		CHECK(cache.Store(0x5555, second, &deduplicated) == secondHash && deduplicated);
+
+		// The file hash memo came back too: with size and write time unchanged the file
+		//		isn't read again (a same-size edit within the timestamp resolution isn't
+		//		noticed - that is the trade-off), with either changed it is.
+		const fs::file_time_type writeTime = fs::last_write_time(source);
+		Bytes edited = first;
+		edited[0] ^= 1;
+		WriteFileAtomic(source, edited.data(), edited.size());
+		fs::last_write_time(source, writeTime);
+		CHECK(cache.HashFile(source) == sourceHash);
+		fs::last_write_time(source, writeTime + std::chrono::seconds(2));
+		CHECK(cache.HashFile(source) == HashXXH64(edited.data(), edited.size()));
+		bool threw = false;
+		try
+		{
+			cache.HashFile(std::string(CACHE_DIRECTORY) + "/missing.obj");
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		CHECK(threw);
+	}
+
+	void TestDamagedIndex()
+	{
+		ResetDirectory();
+		const Bytes package = MakePackage(3, 1000);
+		uint64_t packageHash;
+		{
+			CookCache cache(CACHE_DIRECTORY);
+			packageHash = cache.Store(0xABCD, package);
+			cache.SetDependencies("a.gltf", { "a.bin" });
+			cache.Save();
+		}
+		const Bytes index = ReadFileBytes(std::string(CACHE_DIRECTORY) + "/index.txt");
+
+		// Malformed lines around the good ones are skipped.
+		{
+			std::ofstream file(std::string(CACHE_DIRECTORY) + "/index.txt", std::ios::binary | std::ios::app);
+			file << "K\t0000000000000001\n" << "K\n" << "F\tx\t1\n" << "X\tsomething\n" << "\n" << "D\n" << "K\t12\t34\t56\n";
+		}
+		CookCache cache(CACHE_DIRECTORY);
+		uint64_t hash = 0;
+		CHECK(cache.Load() && cache.Lookup(0xABCD, hash) && hash == packageHash);
+		CHECK(!cache.Lookup(1, hash) && !cache.Lookup(0x12, hash));
+		CHECK(cache.GetDependencies("a.gltf") == std::vector<std::string>({ "a.bin" }));
+
+		// Another format version: the whole index is discarded.
+		Bytes damaged = index;
+		damaged[0] = 'X';
+		WriteFileAtomic(std::string(CACHE_DIRECTORY) + "/index.txt", damaged.data(), damaged.size());
+		CookCache other(CACHE_DIRECTORY);
+		CHECK(!other.Load() && !other.Lookup(0xABCD, hash) && other.GetDependencies("a.gltf").empty());
+	}
+
+	void TestDamagedObject()
+	{
+		ResetDirectory();
+		const Bytes package = MakePackage(4, 5000), previous = MakePackage(5, 100);
+		CookCache cache(CACHE_DIRECTORY);
+		const uint64_t packageHash = cache.Store(1, package);
+
+		std::string objectPath;
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(CACHE_DIRECTORY))
+		{
+			if (entry.path().extension() == ".pkg")
+				objectPath = entry.path().string();
+		}
+		CHECK(!objectPath.empty());
+
+		Bytes flipped = package;
+		flipped[2500] ^= 0x10;
+		const Bytes truncated(package.begin(), package.end() - 1);
+		const Bytes* const damagedObjects[] = { &flipped, &truncated };
+		for (const Bytes* damaged : damagedObjects)
+		{
+			WriteFileAtomic(objectPath, damaged->data(), damaged->size());
+			WriteFileAtomic(OUTPUT_PATH, previous.data(), previous.size());
+			CHECK(!cache.Restore(packageHash, OUTPUT_PATH));
+			CHECK(ReadFileBytes(OUTPUT_PATH) == previous);
+		}
+
+		fs::remove(objectPath);
+		CHECK(!cache.Restore(packageHash, OUTPUT_PATH) && ReadFileBytes(OUTPUT_PATH) == previous);
+
+		// A new cache on the directory writes the object again once it is gone.
+		CookCache fresh(CACHE_DIRECTORY);
+		bool deduplicated = true;
+		CHECK(fresh.Store(2, package, &deduplicated) == packageHash && !deduplicated);
+		CHECK(fresh.Restore(packageHash, OUTPUT_PATH) && ReadFileBytes(OUTPUT_PATH) == package);
+	}
+
+	// 256 stores of 8 distinct packages from all threads at once, in rounds with a new
+	//		cache and directory each.
+	void TestConcurrentStore(TaskScheduler& scheduler)
+	{
+		const size_t packageCount = 8, storeCount = 256;
+		std::vector<Bytes> packages;
+		for (size_t i = 0; i < packageCount; ++i)
+			packages.push_back(MakePackage(uint32_t(100 + i), 32 * 1024 + i));
+
+		for (int round = 0; round < 8; ++round)
+		{
+			ResetDirectory();
+			CookCache cache(CACHE_DIRECTORY);
+			std::atomic<size_t> written(0), wrongHash(0);
+			scheduler.ParallelFor(0, storeCount, 1, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+				{
+					const Bytes& package = packages[i % packageCount];
+					bool deduplicated = true;
+					if (cache.Store(i, package, &deduplicated) != HashXXH64(package.data(), package.size()))
+						++wrongHash;
+					if (!deduplicated)
+						++written;
+				}
+			});
+			CHECK(written == packageCount && wrongHash == 0);
+
+			size_t objects, temporaries;
+			CountFiles(objects, temporaries);
+			CHECK(objects == packageCount && temporaries == 0);
+
+			bool restored = true;
+			for (size_t i = 0; i < storeCount; i += 13)
+			{
+				uint64_t hash = 0;
+				restored = restored && cache.Lookup(i, hash) && cache.Restore(hash, OUTPUT_PATH) &&
+					ReadFileBytes(OUTPUT_PATH) == packages[i % packageCount];
+			}
+			CHECK(restored);
+		}
+	}
+}
+
+int main()
+{
+	TaskScheduler scheduler(3);
+
+	TestRoundTrip();
+	TestDamagedIndex();
+	TestDamagedObject();
+	TestConcurrentStore(scheduler);
+
+	fs::remove_all(CACHE_DIRECTORY);
+	return Test::Result("CookCache");
+}
@@ -0,0 +1,77 @@
+#include "Test.h"
+
+#include "CpuTopology.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace
+{
+	void TestTopology(const CpuTopology& topology)
+	{
+		CHECK(topology.GetNumLogicalProcessors() > 0);
+		CHECK(topology.GetNumPhysicalCores() > 0);
+		CHECK(topology.GetNumPhysicalCores() <= topology.GetNumLogicalProcessors());
+
+		std::set<uint32_t> ids;
+		for (const LogicalProcessor& processor : topology.GetLogicalProcessors())
+		{
+			CHECK(ids.insert(processor.id).second);
+			CHECK(processor.coreIndex < topology.GetNumPhysicalCores());
+		}
+
+		size_t numInCores = 0;
+		for (const PhysicalCore& core : topology.GetPhysicalCores())
+		{
+			CHECK(!core.logicalProcessors.empty());
+			numInCores += core.logicalProcessors.size();
+		}
+		CHECK(numInCores == topology.GetNumLogicalProcessors());
+	}
+
+	std::set<uint32_t> GetPoolProcessors(const ThreadAffinityPolicy& policy, ThreadRole role)
+	{
+		std::set<uint32_t> processors;
+		for (uint32_t i = 0; i < policy.GetNumThreads(role); ++i)
+		{
+			std::vector<uint32_t> worker = policy.GetProcessors(role, i);
+			processors.insert(worker.begin(), worker.end());
+		}
+		return processors;
+	}
+
+	// The task scheduler and job system pools never share a logical processor.
+	void TestPolicy(const CpuTopology& topology, AffinityPolicy type)
+	{
+		ThreadAffinityPolicy policy(topology, type);
+		CHECK(policy.GetNumThreads(ThreadRole::Worker) >= 1);
+		CHECK(policy.GetNumThreads(ThreadRole::JobWorker) >= 1);
+
+		const std::set<uint32_t> workers = GetPoolProcessors(policy, ThreadRole::Worker);
+		const std::set<uint32_t> jobWorkers = GetPoolProcessors(policy, ThreadRole::JobWorker);
+		for (uint32_t id : jobWorkers)
+			CHECK(workers.count(id) == 0);
+
+		if (type == AffinityPolicy::None)
+		{
+			CHECK(workers.empty() && jobWorkers.empty());
+		}
+		else if (type == AffinityPolicy::PhysicalCores && topology.GetNumPhysicalCores() >= 3)
+		{
+			CHECK(!jobWorkers.empty());
+		}
+	}
+}
+
+int main()
+{
+	const CpuTopology topology = CpuTopology::Query();
+	TestTopology(topology);
+
+	TestPolicy(topology, AffinityPolicy::None);
+	TestPolicy(topology, AffinityPolicy::PhysicalCores);
+	TestPolicy(topology, AffinityPolicy::PerformanceCores);
+
+	return Test::Result("CpuTopology");
+}
@@ -0,0 +1,111 @@
+// Throughput of the frustum culling kernels - scalar, SSE, AVX and the parallel culler -
+//		in objects per millisecond. Not a test (timings depend on the machine); run it by hand:
+//
+//		FrustumCullingBenchmark [numObjects] [threads]
+//
+// The objects are scattered around the camera so that about a quarter is visible: the
+//		kernels write every index branch free, only the output pointer depends on the result.
+#include "FrustumCulling.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Best of "iterations" runs, in milliseconds.
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t numObjects = argc > 1 ? size_t(std::atol(argv[1])) : 1000000;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	const int iterations = 20;
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	const Frustum frustum = Frustum::FromViewProjection(XMMatrixMultiply(view, projection));
+
+	std::mt19937 random(56);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+	BoundingSpheres spheres;
+	BoundingBoxes boxes;
+	spheres.Resize(numObjects);
+	boxes.Resize(numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+	{
+		XMFLOAT3 center(position(random), position(random) * 0.2f, position(random));
+		spheres.Set(i, center, size(random));
+		boxes.Set(i, center, XMFLOAT3(size(random), size(random), size(random)));
+	}
+
+	std::vector<uint32_t> indices(numObjects);
+	std::vector<uint32_t> visible;
+	typedef size_t (*SphereKernel)(const Frustum&, const BoundingSpheres&, size_t, size_t, uint32_t*);
+	typedef size_t (*BoxKernel)(const Frustum&, const BoundingBoxes&, size_t, size_t, uint32_t*);
+	struct Kernel
+	{
+		const char* name;
+		SphereKernel spheres;
+		BoxKernel boxes;
+		bool supported;
+	};
+	const Kernel kernels[] = {
+		{ "scalar", &FrustumCuller::CullSpheresScalar, &FrustumCuller::CullBoxesScalar, true },
+		{ "SSE", &FrustumCuller::CullSpheresSSE, &FrustumCuller::CullBoxesSSE, true },
+		{ "AVX", &FrustumCuller::CullSpheresAVX, &FrustumCuller::CullBoxesAVX, FrustumCuller::IsAVXSupported() },
+	};
+
+	size_t numVisibleSpheres = 0, numVisibleBoxes = 0;
+	double scalarSpheresMs = 0.0, scalarBoxesMs = 0.0;
+	std::printf("%zu objects, %u thread(s) for the parallel culler, best of %d\n\n", numObjects, threads, iterations);
+	std::printf("kernel               spheres objects/ms  speedup     boxes objects/ms  speedup\n");
+	for (const Kernel& kernel : kernels)
+	{
+		if (!kernel.supported)
+		{
+			std::printf("%-18s  not supported on this CPU\n", kernel.name);
+			continue;
+		}
+		double spheresMs = MeasureMilliseconds(iterations, [&]() { numVisibleSpheres = kernel.spheres(frustum, spheres, 0, numObjects, indices.data()); });
+		double boxesMs = MeasureMilliseconds(iterations, [&]() { numVisibleBoxes = kernel.boxes(frustum, boxes, 0, numObjects, indices.data()); });
+		if (kernel.spheres == &FrustumCuller::CullSpheresScalar)
+		{
+			scalarSpheresMs = spheresMs;
+			scalarBoxesMs = boxesMs;
+		}
+		std::printf("%-18s  %18.0f  %6.2fx  %18.0f  %6.2fx\n", kernel.name,
+			numObjects / spheresMs, scalarSpheresMs / spheresMs, numObjects / boxesMs, scalarBoxesMs / boxesMs);
+	}
+
+	FrustumCuller culler;
+	double spheresMs = MeasureMilliseconds(iterations, [&]() { culler.CullSpheres(frustum, spheres, visible, &scheduler); });
+	double boxesMs = MeasureMilliseconds(iterations, [&]() { culler.CullBoxes(frustum, boxes, visible, &scheduler); });
+	std::printf("%-18s  %18.0f  %6.2fx  %18.0f  %6.2fx\n", "parallel, widest",
+		numObjects / spheresMs, scalarSpheresMs / spheresMs, numObjects / boxesMs, scalarBoxesMs / boxesMs);
+
+	std::printf("\n%zu spheres and %zu boxes visible\n", numVisibleSpheres, numVisibleBoxes);
+	return 0;
+}
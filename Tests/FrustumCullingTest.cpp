@@ -0,0 +1,139 @@
+#include "Test.h"
+
+#include "FrustumCulling.h"
+#include "TaskScheduler.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// Every SIMD kernel must return exactly the indices of the scalar reference, in the same
+//		order, for any range - including ranges that don't start or end on a SIMD block.
+
+namespace
+{
+	Frustum MakeFrustum()
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(3.0f, 2.0f, -10.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+		return Frustum::FromViewProjection(XMMatrixMultiply(view, projection));
+	}
+
+	// Random volumes around the frustum, plus some that touch a plane exactly
+	//		(distance + radius == 0 is visible) and degenerate ones (radius/extent 0).
+	void MakeVolumes(const Frustum& frustum, size_t count, BoundingSpheres& spheres, BoundingBoxes& boxes)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+		std::uniform_real_distribution<float> size(0.0f, 8.0f);
+
+		spheres.Resize(count);
+		boxes.Resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			XMFLOAT3 center(position(random), position(random), position(random));
+			float r = i % 17 == 0 ? 0.0f : size(random);
+			if (i % 13 == 0)
+			{
+				// Center on the near plane: |distance| is at most rounding, r = 0 sits on it.
+				const XMFLOAT4& p = frustum.planes[Frustum::Near];
+				float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+				center = XMFLOAT3(center.x - p.x * d, center.y - p.y * d, center.z - p.z * d);
+			}
+			spheres.Set(i, center, r);
+			boxes.Set(i, center, XMFLOAT3(r, size(random), i % 7 == 0 ? 0.0f : size(random)));
+		}
+	}
+
+	template<typename Volumes, typename Kernel, typename Reference>
+	void CheckKernel(const Frustum& frustum, const Volumes& volumes, size_t begin, size_t end,
+		const Kernel& kernel, const Reference& reference)
+	{
+		std::vector<uint32_t> expected(end - begin), actual(end - begin);
+		expected.resize(reference(frustum, volumes, begin, end, expected.data()));
+		actual.resize(kernel(frustum, volumes, begin, end, actual.data()));
+		CHECK(actual == expected);
+	}
+
+	template<typename Volumes, typename Kernel, typename Reference>
+	void CheckRanges(const Frustum& frustum, const Volumes& volumes, const Kernel& kernel, const Reference& reference)
+	{
+		const size_t count = volumes.GetCount();
+		CheckKernel(frustum, volumes, 0, count, kernel, reference);
+		for (size_t begin = 0; begin < 20; ++begin)
+		{
+			for (size_t length = 0; length < 40; ++length)
+				CheckKernel(frustum, volumes, begin, begin + length, kernel, reference);
+		}
+	}
+
+	void TestKernels(const Frustum& frustum, const BoundingSpheres& spheres, const BoundingBoxes& boxes)
+	{
+		CheckRanges(frustum, spheres, FrustumCuller::CullSpheresSSE, FrustumCuller::CullSpheresScalar);
+		CheckRanges(frustum, boxes, FrustumCuller::CullBoxesSSE, FrustumCuller::CullBoxesScalar);
+
+		size_t (*cullSpheres)(const Frustum&, const BoundingSpheres&, size_t, size_t, uint32_t*) = FrustumCuller::CullSpheres;
+		size_t (*cullBoxes)(const Frustum&, const BoundingBoxes&, size_t, size_t, uint32_t*) = FrustumCuller::CullBoxes;
+		CheckRanges(frustum, spheres, cullSpheres, FrustumCuller::CullSpheresScalar);
+		CheckRanges(frustum, boxes, cullBoxes, FrustumCuller::CullBoxesScalar);
+
+		if (FrustumCuller::IsAVXSupported())
+		{
+			CheckRanges(frustum, spheres, FrustumCuller::CullSpheresAVX, FrustumCuller::CullSpheresScalar);
+			CheckRanges(frustum, boxes, FrustumCuller::CullBoxesAVX, FrustumCuller::CullBoxesScalar);
+		}
+		else
+		{
+			std::printf("FrustumCulling: AVX not supported, AVX kernels not tested\n");
+		}
+	}
+
+	// The parallel cull packs the chunks together: same result as one single threaded call.
+	void TestParallel(const Frustum& frustum, const BoundingSpheres& spheres, const BoundingBoxes& boxes)
+	{
+		TaskScheduler scheduler(3);
+		FrustumCuller culler;
+
+		std::vector<uint32_t> expected(spheres.GetCount()), actual;
+		expected.resize(FrustumCuller::CullSpheresScalar(frustum, spheres, 0, spheres.GetCount(), expected.data()));
+		culler.CullSpheres(frustum, spheres, actual, &scheduler, 1000);
+		CHECK(actual == expected);
+
+		expected.resize(boxes.GetCount());
+		expected.resize(FrustumCuller::CullBoxesScalar(frustum, boxes, 0, boxes.GetCount(), expected.data()));
+		culler.CullBoxes(frustum, boxes, actual, &scheduler, 1000);
+		CHECK(actual == expected);
+		culler.CullBoxes(frustum, boxes, actual);
+		CHECK(actual == expected);
+	}
+
+	void TestKnownVolumes(const Frustum& frustum)
+	{
+		BoundingSpheres spheres;
+		spheres.Resize(3);
+		spheres.Set(0, XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f);		// looked at
+		spheres.Set(1, XMFLOAT3(6.0f, 4.0f, -20.0f), 1.0f);		// behind the camera
+		spheres.Set(2, XMFLOAT3(0.0f, 0.0f, 500.0f), 1.0f);		// past the far plane
+
+		std::vector<uint32_t> visible;
+		FrustumCuller culler;
+		culler.CullSpheres(frustum, spheres, visible);
+		CHECK(visible.size() == 1 && visible[0] == 0);
+	}
+}
+
+int main()
+{
+	const Frustum frustum = MakeFrustum();
+	TestKnownVolumes(frustum);
+
+	BoundingSpheres spheres;
+	BoundingBoxes boxes;
+	MakeVolumes(frustum, 10007, spheres, boxes);
+	TestKernels(frustum, spheres, boxes);
+	TestParallel(frustum, spheres, boxes);
+
+	return Test::Result("FrustumCulling");
+}
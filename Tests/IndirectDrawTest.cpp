@@ -0,0 +1,85 @@
+#include "Test.h"
+
+#include "IndirectDraw.h"
+#include "TaskScheduler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// The command is read by the GPU as D3D12_DRAW_INDEXED_ARGUMENTS: 5 tightly packed
+	//		32 bit values in this order (IndirectDraw.cpp checks it against d3d12.h on Windows).
+	void TestLayout()
+	{
+		CHECK(sizeof(IndirectDrawCommand) == 20);
+		CHECK(offsetof(IndirectDrawCommand, draw) == 0);
+		CHECK(offsetof(DrawIndexedArguments, indexCountPerInstance) == 0);
+		CHECK(offsetof(DrawIndexedArguments, instanceCount) == 4);
+		CHECK(offsetof(DrawIndexedArguments, startIndexLocation) == 8);
+		CHECK(offsetof(DrawIndexedArguments, baseVertexLocation) == 12);
+		CHECK(offsetof(DrawIndexedArguments, startInstanceLocation) == 16);
+	}
+
+	// Every command draws its batch's mesh range for the batch's instances - the same
+	//		DrawIndexedInstanced arguments the non indirect path uses.
+	void TestPacking(size_t numBatches, TaskScheduler* scheduler)
+	{
+		std::mt19937 random(static_cast<uint32_t>(numBatches));
+		auto next = [&random](uint32_t count) { return static_cast<uint32_t>(random() % count); };
+
+		std::vector<MeshDrawRange> meshes(37);
+		for (size_t m = 0; m < meshes.size(); ++m)
+			meshes[m] = MeshDrawRange{ 3 * (next(5000) + 1), next(100000), static_cast<int32_t>(next(20000)) - 10000 };
+
+		std::vector<InstanceBatch> batches(numBatches);
+		uint32_t firstInstance = 0;
+		for (InstanceBatch& batch : batches)
+		{
+			batch.key = MakeBatchKey(next(static_cast<uint32_t>(meshes.size())), next(8));
+			batch.firstInstance = firstInstance;
+			batch.instanceCount = next(100) + 1;
+			firstInstance += batch.instanceCount;
+		}
+
+		// One spare command: nothing may be written past the batches.
+		std::vector<IndirectDrawCommand> commands(numBatches + 1);
+		IndirectDrawCommand sentinel = {};
+		sentinel.draw.indexCountPerInstance = 0xDEADBEEF;
+		commands.back() = sentinel;
+
+		size_t numCommands = PackIndirectDrawCommands(batches.data(), batches.size(),
+			meshes.data(), meshes.size(), commands.data(), scheduler);
+		CHECK(numCommands == numBatches);
+		CHECK(commands.back().draw.indexCountPerInstance == 0xDEADBEEF);
+
+		bool correct = true;
+		for (size_t i = 0; i < numBatches; ++i)
+		{
+			const MeshDrawRange& mesh = meshes[GetBatchMesh(batches[i].key)];
+			const DrawIndexedArguments& draw = commands[i].draw;
+			correct = correct && draw.indexCountPerInstance == mesh.indexCount;
+			correct = correct && draw.instanceCount == batches[i].instanceCount;
+			correct = correct && draw.startIndexLocation == mesh.startIndex;
+			correct = correct && draw.baseVertexLocation == mesh.baseVertex;
+			correct = correct && draw.startInstanceLocation == batches[i].firstInstance;
+		}
+		CHECK(correct);
+	}
+}
+
+int main()
+{
+	TestLayout();
+
+	TaskScheduler scheduler(3);
+	TestPacking(0, nullptr);
+	TestPacking(1, nullptr);
+	TestPacking(100, &scheduler);
+	TestPacking(50000, nullptr);
+	TestPacking(50000, &scheduler);		// packed in parallel
+
+	return Test::Result("IndirectDraw");
+}
@@ -0,0 +1,78 @@
+#include "Test.h"
+
+#include "InstanceBatcher.h"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+// Batches against a std::map grouping, over frames of very different sizes: the hash
+//		table is grow only and only the slots a build used are emptied by the next one,
+//		so a stale slot would show up as a wrong or merged batch in a later frame.
+
+namespace
+{
+	void CheckBatches(const InstanceBatcher& batcher, const std::vector<uint32_t>& visible, const std::vector<BatchKey>& keys)
+	{
+		// Expected instances per key, in visible order, and the order keys first appear.
+		std::map<BatchKey, std::vector<uint32_t>> expected;
+		std::vector<BatchKey> firstSeen;
+		for (uint32_t object : visible)
+		{
+			std::vector<uint32_t>& instances = expected[keys[object]];
+			if (instances.empty())
+				firstSeen.push_back(keys[object]);
+			instances.push_back(object);
+		}
+
+		const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+		CHECK(batches.size() == firstSeen.size());
+		CHECK(batcher.GetInstanceCount() == visible.size());
+		if (batches.size() != firstSeen.size())
+			return;
+
+		bool correct = true;
+		uint32_t firstInstance = 0;
+		for (size_t b = 0; b < batches.size(); ++b)
+		{
+			const std::vector<uint32_t>& instances = expected[firstSeen[b]];
+			correct = correct && batches[b].key == firstSeen[b];
+			correct = correct && batches[b].firstInstance == firstInstance;
+			correct = correct && batches[b].instanceCount == instances.size();
+			for (uint32_t i = 0; correct && i < batches[b].instanceCount; ++i)
+				correct = batcher.GetInstanceObjects()[firstInstance + i] == instances[i];
+			firstInstance += batches[b].instanceCount;
+		}
+		CHECK(correct);
+	}
+}
+
+int main()
+{
+	const size_t numObjects = 100000;
+	std::mt19937 random(11);
+	std::vector<BatchKey> keys(numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+		keys[i] = MakeBatchKey(random() % 300, random() % 12);
+
+	InstanceBatcher batcher;
+	const size_t frameSizes[] = { 10, 100000, 0, 3, 5000, 1, 100000, 64, 20000, 2 };
+	for (size_t numVisible : frameSizes)
+	{
+		std::vector<uint32_t> visible;
+		for (size_t i = 0; i < numObjects && visible.size() < numVisible; ++i)
+		{
+			if (random() % 2 || numVisible == numObjects)
+				visible.push_back(static_cast<uint32_t>(i));
+		}
+		// Always different keys than the frame before.
+		for (uint32_t object : visible)
+			keys[object] ^= random() % 2;
+
+		batcher.Build(visible.data(), visible.size(), keys.data());
+		CheckBatches(batcher, visible, keys);
+	}
+
+	return Test::Result("InstanceBatcher");
+}
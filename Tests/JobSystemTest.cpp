@@ -0,0 +1,124 @@
+#include "Test.h"
+
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// A batch kicked and waited for from a non-job thread.
+	void TestBatch(JobSystem& jobs)
+	{
+		std::atomic<int> count(0);
+		std::vector<std::function<void()>> batch(1000, [&count] { count.fetch_add(1); });
+
+		JobCounter counter;
+		jobs.RunJobs(batch.data(), batch.size(), &counter);
+		jobs.WaitForCounter(counter);
+		CHECK(count.load() == 1000);
+		CHECK(counter.GetValue() == 0);
+	}
+
+	// Jobs that wait for jobs they kick: the waiting fibers are parked and resumed by
+	//		whichever worker sees their counter reach zero.
+	void TestNestedWaits(JobSystem& jobs)
+	{
+		std::atomic<int> leaves(0);
+		JobCounter outer;
+		for (int i = 0; i < 64; ++i)
+		{
+			jobs.RunJob([&jobs, &leaves] {
+				JobCounter inner;
+				for (int k = 0; k < 16; ++k)
+					jobs.RunJob([&leaves] { leaves.fetch_add(1); }, &inner);
+				jobs.WaitForCounter(inner);
+				CHECK(inner.GetValue() == 0);
+			}, &outer);
+		}
+		jobs.WaitForCounter(outer);
+		CHECK(leaves.load() == 64 * 16);
+	}
+
+	// More waiting jobs than fibers in the pool: the waiters are high priority, so every
+	//		fiber ends up parked while the job they wait for is still queued. Without
+	//		growing the pool this deadlocks.
+	void TestFiberPoolExhaustion()
+	{
+		JobSystem jobs(2, 4, 64 * 1024);
+
+		JobCounter release;
+		std::atomic<int> waited(0);
+		jobs.RunJob([&waited] { CHECK(waited.load() == 0); }, &release, JobPriority::Low);
+
+		JobCounter waiters;
+		for (int i = 0; i < 16; ++i)
+		{
+			jobs.RunJob([&jobs, &release, &waited] {
+				jobs.WaitForCounter(release);
+				waited.fetch_add(1);
+			}, &waiters, JobPriority::High);
+		}
+
+		jobs.WaitForCounter(waiters);
+		CHECK(waited.load() == 16);
+	}
+
+	// Jobs still queued when the job system is destroyed run to completion.
+	void TestDrainOnDestruction()
+	{
+		std::atomic<int> count(0);
+		{
+			JobSystem jobs(2, 8, 64 * 1024);
+			for (int i = 0; i < 200; ++i)
+			{
+				jobs.RunJob([&jobs, &count] {
+					JobCounter inner;
+					jobs.RunJob([&count] { count.fetch_add(1); }, &inner);
+					jobs.WaitForCounter(inner);
+					count.fetch_add(1);
+				});
+			}
+		}
+		CHECK(count.load() == 400);
+	}
+
+	// Idle workers sleep: an idle job system must not keep the CPU busy, and must still
+	//		pick up work kicked long after it went to sleep.
+	void TestIdle(JobSystem& jobs)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		const std::clock_t start = std::clock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		const double cpuSeconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+		CHECK(cpuSeconds < 0.05);
+
+		TestBatch(jobs);
+	}
+}
+
+int main()
+{
+	{
+		JobSystem jobs(4, 32, 64 * 1024);
+		CHECK(!jobs.IsInsideJob());
+		for (int repeat = 0; repeat < 20; ++repeat)
+		{
+			TestBatch(jobs);
+			TestNestedWaits(jobs);
+		}
+		TestIdle(jobs);
+	}
+
+	for (int repeat = 0; repeat < 10; ++repeat)
+	{
+		TestFiberPoolExhaustion();
+		TestDrainOnDestruction();
+	}
+
+	return Test::Result("JobSystem");
+}
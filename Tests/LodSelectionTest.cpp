@@ -0,0 +1,218 @@
+#include "Test.h"
+
+#include "FrustumCulling.h"
+#include "LodSelection.h"
+#include "TaskScheduler.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// The camera sits at the origin with a projection scale of 1000 (viewport height 1000,
+//		tan(fovY / 2) = 0.5) and a 1 pixel threshold: the allowed error is the distance to
+//		the bounding sphere / 1000. The LOD set has errors 0, 0.01, 0.02 and 0.04, so the
+//		levels fit from 10, 20 and 40 units on - and with 10% hysteresis a coarser level is
+//		only picked from 11.1, 22.2 and 44.4 on.
+//
+// Objects walk along +z and Select() runs once per step; the test records where they
+//		switched, that nothing flips inside a dead band, and how the fade advances.
+namespace
+{
+	const float FOV_Y = 2.0f * std::atan(0.5f);
+	const float VIEWPORT_HEIGHT = 1000.0f;
+	const float RADIUS = 1.0f;
+	const LodLevel LEVELS[] = { { 100, 0.0f }, { 101, 0.01f }, { 102, 0.02f }, { 103, 0.04f } };
+
+	struct Scene
+	{
+		LodSelector selector;
+		BoundingSpheres bounds;
+		std::vector<LodSetId> sets;
+
+		Scene(size_t count, const LodSelector::Settings& settings)
+		{
+			selector.SetSettings(settings);
+			selector.SetCamera(XMFLOAT3(0.0f, 0.0f, 0.0f), FOV_Y, VIEWPORT_HEIGHT);
+			sets.assign(count, selector.AddLodSet(LEVELS, 4));
+			bounds.Resize(count);
+		}
+
+		// All objects at "distance" from the camera to their bounding sphere.
+		void Select(float distance, float deltaTime, TaskScheduler* scheduler = nullptr)
+		{
+			for (size_t i = 0; i < bounds.GetCount(); ++i)
+				bounds.Set(i, XMFLOAT3(0.0f, 0.0f, distance + RADIUS), RADIUS);
+			selector.Select(bounds, sets.data(), deltaTime, scheduler);
+		}
+	};
+
+	LodSelector::Settings MakeSettings(float hysteresis, bool crossFade)
+	{
+		LodSelector::Settings settings;
+		settings.errorThreshold = 1.0f;
+		settings.hysteresis = hysteresis;
+		settings.fadeDuration = 0.25f;
+		settings.crossFade = crossFade;
+		return settings;
+	}
+
+	// Walks out from 5 to 60 units and back in steps of "step", returns the distances
+	//		of the switches out (to levels 1, 2, 3) and back in (to levels 2, 1, 0).
+	void Walk(Scene& scene, float step, float outSwitches[3], float inSwitches[3], bool& sameForAll)
+	{
+		uint32_t previous = 0;
+		sameForAll = true;
+		auto record = [&](float distance, bool out) {
+			const uint32_t lod = scene.selector.GetLod(0);
+			for (size_t i = 1; i < scene.bounds.GetCount(); ++i)
+				sameForAll = sameForAll && scene.selector.GetLod(i) == lod;
+			if (lod != previous)
+			{
+				if (out && lod == previous + 1)
+					outSwitches[previous] = distance;
+				else if (!out && lod + 1 == previous)
+					inSwitches[lod] = distance;
+				else
+					sameForAll = false;	// Skipped a level on a small step.
+				previous = lod;
+			}
+		};
+		for (int i = 0; 5.0f + i * step <= 60.0f; ++i)
+		{
+			scene.Select(5.0f + i * step, 1.0f);
+			record(5.0f + i * step, true);
+		}
+		for (int i = 0; 60.0f - i * step >= 5.0f; ++i)
+		{
+			scene.Select(60.0f - i * step, 1.0f);
+			record(60.0f - i * step, false);
+		}
+	}
+
+	bool Near(float value, float expected, float tolerance)
+	{
+		return std::fabs(value - expected) <= tolerance;
+	}
+
+	// 7 objects: 4 through the SSE loop, 3 through the scalar tail.
+	void TestHysteresis()
+	{
+		const float step = 0.01f;
+		Scene scene(7, MakeSettings(0.1f, false));
+		float out[3] = { -1.0f, -1.0f, -1.0f }, in[3] = { -1.0f, -1.0f, -1.0f };
+		bool sameForAll;
+		Walk(scene, step, out, in, sameForAll);
+		CHECK(sameForAll);
+		CHECK(Near(out[0], 10.0f / 0.9f, 2.0f * step) && Near(out[1], 20.0f / 0.9f, 2.0f * step) && Near(out[2], 40.0f / 0.9f, 2.0f * step));
+		// Refining has no margin: right when the level stops fitting.
+		CHECK(Near(in[2], 40.0f, 2.0f * step) && Near(in[1], 20.0f, 2.0f * step) && Near(in[0], 10.0f, 2.0f * step));
+
+		// Without hysteresis both directions switch at the same distance.
+		Scene exact(7, MakeSettings(0.0f, false));
+		Walk(exact, step, out, in, sameForAll);
+		CHECK(sameForAll);
+		for (int level = 0; level < 3; ++level)
+			CHECK(Near(out[level], 10.0f * float(1 << level), 2.0f * step) && Near(in[level], 10.0f * float(1 << level), 2.0f * step));
+	}
+
+	// Jitter inside the dead band keeps whichever level the object came with.
+	void TestDeadBand()
+	{
+		for (int fromFar = 0; fromFar < 2; ++fromFar)
+		{
+			Scene scene(1, MakeSettings(0.1f, false));
+			scene.Select(fromFar ? 15.0f : 5.0f, 1.0f);
+			const uint32_t expected = fromFar ? 1 : 0;
+			CHECK(scene.selector.GetLod(0) == expected);
+			int switches = 0;
+			for (int frame = 0; frame < 200; ++frame)
+			{
+				scene.Select(10.55f + 0.5f * std::sin(frame * 0.7f), 1.0f / 60.0f);
+				switches += scene.selector.GetLod(0) != expected ? 1 : 0;
+			}
+			CHECK(switches == 0);
+		}
+	}
+
+	void TestCrossFade()
+	{
+		Scene scene(1, MakeSettings(0.1f, true));
+		scene.Select(5.0f, 0.1f);
+		CHECK(scene.selector.GetLod(0) == 0 && !scene.selector.IsFading(0));
+
+		// A jump skips levels: straight to the coarsest, fading from full detail.
+		scene.Select(100.0f, 0.1f);
+		CHECK(scene.selector.GetLod(0) == 3 && scene.selector.GetPreviousLod(0) == 0);
+		CHECK(scene.selector.GetMesh(0) == 103 && scene.selector.GetPreviousMesh(0) == 100);
+		CHECK(scene.selector.GetFade(0) == 0.0f && scene.selector.IsFading(0));
+
+		// 0.25 s fade in 0.1 s frames: 0.4, 0.8, done - then the previous level is released.
+		scene.Select(100.0f, 0.1f);
+		CHECK(Near(scene.selector.GetFade(0), 0.4f, 1e-5f) && scene.selector.GetPreviousLod(0) == 0);
+		scene.Select(100.0f, 0.1f);
+		CHECK(Near(scene.selector.GetFade(0), 0.8f, 1e-5f) && scene.selector.GetPreviousLod(0) == 0);
+		scene.Select(100.0f, 0.1f);
+		CHECK(scene.selector.GetFade(0) == 1.0f && !scene.selector.IsFading(0));
+		CHECK(scene.selector.GetPreviousLod(0) == 3 && scene.selector.GetPreviousMesh(0) == 103);
+
+		// A switch during a fade fades from the level that was fading in.
+		scene.Select(30.0f, 0.1f);
+		CHECK(scene.selector.GetLod(0) == 2 && scene.selector.GetPreviousLod(0) == 3 && scene.selector.GetFade(0) == 0.0f);
+		scene.Select(30.0f, 0.1f);
+		scene.Select(5.0f, 0.1f);
+		CHECK(scene.selector.GetLod(0) == 0 && scene.selector.GetPreviousLod(0) == 2 && scene.selector.GetFade(0) == 0.0f);
+
+		// No cross-fade: switches complete at once.
+		Scene instant(1, MakeSettings(0.1f, false));
+		instant.Select(5.0f, 0.1f);
+		instant.Select(100.0f, 0.1f);
+		CHECK(instant.selector.GetLod(0) == 3 && instant.selector.GetPreviousLod(0) == 3 && !instant.selector.IsFading(0));
+	}
+
+	// An object moved to another LOD set starts over at full detail, without a fade.
+	void TestSetChange()
+	{
+		Scene scene(1, MakeSettings(0.1f, true));
+		const LodLevel others[] = { { 200, 0.0f }, { 201, 100.0f } };
+		const LodSetId other = scene.selector.AddLodSet(others, 2);
+		scene.Select(100.0f, 1.0f);
+		CHECK(scene.selector.GetLod(0) == 3);
+		scene.sets[0] = other;
+		scene.Select(100.0f, 1.0f);
+		CHECK(scene.selector.GetLod(0) == 0 && scene.selector.GetMesh(0) == 200 && !scene.selector.IsFading(0));
+	}
+
+	// More objects than one task: the scheduler gives every object the same result.
+	void TestParallel()
+	{
+		TaskScheduler scheduler(3);
+		Scene serial(20000, MakeSettings(0.1f, true)), parallel(20000, MakeSettings(0.1f, true));
+		bool same = true;
+		for (int frame = 0; frame < 100; ++frame)
+		{
+			const float distance = 5.0f + 50.0f * std::fabs(std::sin(frame * 0.05f));
+			serial.Select(distance, 0.05f);
+			parallel.Select(distance, 0.05f, &scheduler);
+			for (size_t i = 0; i < 20000; i += 97)
+			{
+				same = same && serial.selector.GetLod(i) == parallel.selector.GetLod(i) &&
+					serial.selector.GetPreviousLod(i) == parallel.selector.GetPreviousLod(i) &&
+					serial.selector.GetFade(i) == parallel.selector.GetFade(i);
+			}
+		}
+		CHECK(same);
+	}
+}
+
+int main()
+{
+	TestHysteresis();
+	TestDeadBand();
+	TestCrossFade();
+	TestSetChange();
+	TestParallel();
+
+	return Test::Result("LodSelection");
+}
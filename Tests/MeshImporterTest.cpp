@@ -0,0 +1,470 @@
+#include "Test.h"
+
+#include "Tools/AssetCooker/MeshImporter.h"
+#include "Framework/TaskScheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// The importers on sources built in memory:
+//		- OBJ: the same grid written with absolute and with negative (relative) indices,
+//		  big enough to be parsed as several chunks, so relative indices reach back into
+//		  earlier chunks; with and without a scheduler the meshes are identical and match
+//		  the grid,
+//		- glTF: a .gltf with a data URI buffer and the same document as .glb, node
+//		  transforms and mirroring,
+//		- malformed input of both: each must throw std::runtime_error (with the line for
+//		  OBJ), never crash or return a mesh with indices out of range.
+namespace
+{
+	template<typename Function>
+	bool Throws(const Function& function, const char* message = nullptr)
+	{
+		try
+		{
+			function();
+		}
+		catch (const std::runtime_error& e)
+		{
+			if (message && !std::strstr(e.what(), message))
+			{
+				std::fprintf(stderr, "unexpected error: %s\n", e.what());
+				return false;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	bool ValidIndices(const SourceMesh& mesh)
+	{
+		bool valid = mesh.indices.size() % 3 == 0;
+		for (uint32_t index : mesh.indices)
+			valid = valid && index < mesh.positions.size();
+		return valid && (mesh.normals.empty() || mesh.normals.size() == mesh.positions.size()) &&
+			(mesh.uvs.empty() || mesh.uvs.size() == mesh.positions.size());
+	}
+
+	bool Equal(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	bool SameMesh(const SourceMesh& a, const SourceMesh& b)
+	{
+		return a.indices == b.indices && a.positions.size() == b.positions.size() &&
+			std::memcmp(a.positions.data(), b.positions.data(), a.positions.size() * sizeof(XMFLOAT3)) == 0 &&
+			a.uvs.size() == b.uvs.size() && std::memcmp(a.uvs.data(), b.uvs.data(), a.uvs.size() * sizeof(XMFLOAT2)) == 0 &&
+			a.normals.size() == b.normals.size();
+	}
+
+	SourceMesh ImportObjText(const std::string& text, TaskScheduler* scheduler = nullptr)
+	{
+		SourceMesh mesh;
+		ImportObj(text.data(), text.size(), mesh, scheduler);
+		return mesh;
+	}
+
+// =====================================================================================
+//										OBJ
+// =====================================================================================
+
+	// A quad as a fan, corners sharing position / uv / normal combinations.
+	void TestObjBasics()
+	{
+		const std::string quad =
+			"# comment\n"
+			"mtllib ignored.mtl\n"
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\r\n"
+			"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+			"vn 0 0 2\n"
+			"g group\n"
+			"f 1/1/1 2/2/1 3/3/1 4/4/1 # trailing comment\n"
+			"f 1/1/1 3/3/1 4/4/1\n";
+		const SourceMesh mesh = ImportObjText(quad);
+		CHECK(ValidIndices(mesh) && mesh.positions.size() == 4 && mesh.indices.size() == 9);
+		CHECK(mesh.indices == std::vector<uint32_t>({ 0, 1, 2, 0, 2, 3, 0, 2, 3 }));
+		CHECK(Equal(mesh.positions[2], XMFLOAT3(1.0f, 1.0f, 0.0f)));
+		// v flipped to D3D's top left origin, normals normalized.
+		CHECK(mesh.uvs.size() == 4 && mesh.uvs[3].x == 0.0f && mesh.uvs[3].y == 0.0f && mesh.uvs[0].y == 1.0f);
+		CHECK(mesh.normals.size() == 4 && Equal(mesh.normals[1], XMFLOAT3(0.0f, 0.0f, 1.0f)));
+
+		// Negative indices count back from the last element read so far.
+		const SourceMesh relative = ImportObjText(
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 2\n"
+			"f -4/-4/-1 -3/-3/-1 -2/-2/-1 -1/-1/-1\nf 1/-4/1 -2/3/-1 4/-1/1\n");
+		CHECK(SameMesh(mesh, relative));
+
+		// p//n and plain p; an attribute only some corners have is dropped.
+		const SourceMesh mixed = ImportObjText("v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//1 3//1\nf 1 2 3\n");
+		CHECK(ValidIndices(mixed) && mixed.positions.size() == 6 && mixed.normals.empty() && mixed.uvs.empty());
+	}
+
+	// A grid of quads, row by row: the vertices of a row, then the faces between it and
+	//		the previous one. Relative faces only ever reach back one row and a bit - across
+	//		the chunk boundaries of a file this size.
+	std::string MakeObjGrid(int width, int height, bool relative)
+	{
+		std::string text;
+		char line[128];
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				std::snprintf(line, sizeof(line), "v %d.25 %d.5 -0.125\nvt %d %d\n", x, y, x, y);
+				text += line;
+			}
+			if (y == 0)
+				continue;
+			for (int x = 0; x + 1 < width; ++x)
+			{
+				const int current = y * width + x + 1, previous = current - width;
+				if (relative)
+				{
+					const int count = (y + 1) * width;
+					std::snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n", previous - count - 1, previous - count - 1,
+						previous - count, previous - count, current - count, current - count, current - count - 1, current - count - 1);
+				}
+				else
+				{
+					std::snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n", previous, previous, previous + 1, previous + 1,
+						current + 1, current + 1, current, current);
+				}
+				text += line;
+			}
+		}
+		return text;
+	}
+
+	void TestObjChunks(TaskScheduler& scheduler)
+	{
+		const int width = 300, height = 200;
+		const std::string absolute = MakeObjGrid(width, height, false), relative = MakeObjGrid(width, height, true);
+		// Several chunks of 1 MB.
+		CHECK(absolute.size() > 3 << 20 && relative.size() > 3 << 20);
+
+		const SourceMesh serial = ImportObjText(absolute);
+		CHECK(ValidIndices(serial) && serial.positions.size() == size_t(width * height));
+		CHECK(serial.indices.size() == size_t((width - 1) * (height - 1) * 6));
+		CHECK(SameMesh(serial, ImportObjText(absolute, &scheduler)));
+		CHECK(SameMesh(serial, ImportObjText(relative)));
+		CHECK(SameMesh(serial, ImportObjText(relative, &scheduler)));
+
+		// Every triangle is where the grid puts it.
+		bool matches = serial.indices.size() == size_t((width - 1) * (height - 1) * 6);
+		for (size_t quad = 0; matches && quad < serial.indices.size() / 6; ++quad)
+		{
+			const int x = int(quad % (width - 1)), y = int(quad / (width - 1)) + 1;
+			const int corners[6][2] = { { x, y - 1 }, { x + 1, y - 1 }, { x + 1, y }, { x, y - 1 }, { x + 1, y }, { x, y } };
+			for (int i = 0; i < 6; ++i)
+			{
+				const XMFLOAT3& p = serial.positions[serial.indices[quad * 6 + i]];
+				const XMFLOAT2& uv = serial.uvs[serial.indices[quad * 6 + i]];
+				matches = matches && Equal(p, XMFLOAT3(corners[i][0] + 0.25f, corners[i][1] + 0.5f, -0.125f)) &&
+					uv.x == float(corners[i][0]) && uv.y == 1.0f - float(corners[i][1]);
+			}
+		}
+		CHECK(matches);
+
+		// An error deep in a later chunk reports its line in the whole file, parsed in
+		//		parallel or not - both for a parse error and a resolve error.
+		const size_t lines = size_t(std::count(absolute.begin(), absolute.end(), '\n'));
+		const std::string parseError = absolute + "f 1 2\n";
+		const std::string resolveError = absolute + "f 1 2 " + std::to_string(width * height + 1) + "\n";
+		const std::string relativeError = relative + "f -1 -2 -" + std::to_string(width * height + 1) + "\n";
+		const std::string expected = "line " + std::to_string(lines + 1) + ":";
+		CHECK(Throws([&] { ImportObjText(parseError, &scheduler); }, expected.c_str()));
+		CHECK(Throws([&] { ImportObjText(parseError); }, expected.c_str()));
+		CHECK(Throws([&] { ImportObjText(resolveError, &scheduler); }, expected.c_str()));
+		CHECK(Throws([&] { ImportObjText(relativeError); }, expected.c_str()));
+	}
+
+	void TestObjMalformed()
+	{
+		const std::string vertices = "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\n";
+		const char* const faces[] =
+		{
+			"f 1 2\n",				// too few corners
+			"f 0 1 2\n",			// OBJ indices start at 1
+			"f 1 2 4\n",			// past the last vertex
+			"f -1 -2 -4\n",			// before the first one
+			"f 1 2 3 -5\n",
+			"f 1/2 2/1 3/1\n",		// uv past the end
+			"f 1//1 2//1 3//1\n",	// no normals at all
+			"f 1 2 x\n",
+			"f 1 2 3x\n",
+			"f 1 2 99999999999\n",
+			"f 1 2 -99999999999\n",
+			"v 1 2\nf 1 2 3\n",		// a number short
+			"v 1 2 z\nf 1 2 3\n",
+			"vt 0\nf 1 2 3\n",
+		};
+		for (const char* face : faces)
+		{
+			if (!CHECK(Throws([&] { ImportObjText(vertices + face); }, "line ")))
+				std::fprintf(stderr, "\taccepted: %s", face);
+		}
+		// Nothing to import.
+		CHECK(Throws([&] { ImportObjText(""); }, "no faces"));
+		CHECK(Throws([&] { ImportObjText(vertices); }, "no faces"));
+		// Forward references are fine: the count is of the whole file.
+		CHECK(ValidIndices(ImportObjText("f 1 2 3\n" + vertices)));
+		// But relative ones count only what came before.
+		CHECK(Throws([&] { ImportObjText("v 0 0 0\nf -1 -2 -3\nv 1 0 0\nv 0 1 0\n"); }, "line 2:"));
+	}
+
+// =====================================================================================
+//										glTF
+// =====================================================================================
+
+	std::string EncodeBase64(const std::vector<uint8_t>& bytes)
+	{
+		const char* const digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string text;
+		for (size_t i = 0; i < bytes.size(); i += 3)
+		{
+			const uint32_t bits = uint32_t(bytes[i]) << 16 | (i + 1 < bytes.size() ? uint32_t(bytes[i + 1]) << 8 : 0) |
+				(i + 2 < bytes.size() ? uint32_t(bytes[i + 2]) : 0);
+			text += digits[bits >> 18];
+			text += digits[(bits >> 12) & 63];
+			text += i + 1 < bytes.size() ? digits[(bits >> 6) & 63] : '=';
+			text += i + 2 < bytes.size() ? digits[bits & 63] : '=';
+		}
+		return text;
+	}
+
+	template<typename T>
+	void Append(std::vector<uint8_t>& bytes, const T* values, size_t count)
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(values);
+		bytes.insert(bytes.end(), p, p + count * sizeof(T));
+	}
+
+	// One quad: 4 float3 positions (48 bytes), 4 float2 UVs (32 bytes), 6 uint16 indices.
+	std::vector<uint8_t> MakeGltfBuffer()
+	{
+		const float positions[] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0 };
+		const float uvs[] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+		const uint16_t indices[] = { 0, 1, 2, 0, 2, 3 };
+		std::vector<uint8_t> bytes;
+		Append(bytes, positions, 12);
+		Append(bytes, uvs, 8);
+		Append(bytes, indices, 6);
+		return bytes;
+	}
+
+	// "%BUFFER%" is replaced with the buffer description, "%NODES%" with the node list.
+	const char* const GLTF_TEMPLATE = R"({
+		"asset": { "version": "2.0" },
+		"scene": 0,
+		"scenes": [ { "nodes": [ 0 ] } ],
+		"nodes": %NODES%,
+		"meshes": [ { "primitives": [ { "attributes": { "POSITION": 0, "TEXCOORD_0": 1 }, "indices": 2 } ] } ],
+		"accessors": [
+			{ "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3" },
+			{ "bufferView": 1, "componentType": 5126, "count": 4, "type": "VEC2" },
+			{ "bufferView": 2, "componentType": %INDEX_TYPE%, "count": %INDEX_COUNT%, "type": "SCALAR" }
+		],
+		"bufferViews": [
+			{ "buffer": 0, "byteOffset": 0, "byteLength": 48 },
+			{ "buffer": 0, "byteOffset": 48, "byteLength": 32 },
+			{ "buffer": 0, "byteOffset": 80, "byteLength": 12 }
+		],
+		"buffers": [ %BUFFER% ]
+	})";
+
+	struct GltfSource
+	{
+		std::string buffer;
+		std::string nodes = R"([ { "mesh": 0, "translation": [ 10, 0, 0 ] } ])";
+		std::string indexType = "5123";
+		std::string indexCount = "6";
+		std::vector<uint8_t> data = MakeGltfBuffer();
+	};
+
+	std::string Replace(std::string text, const char* key, const std::string& value)
+	{
+		const size_t position = text.find(key);
+		return position == std::string::npos ? text : text.replace(position, std::strlen(key), value);
+	}
+
+	std::string MakeGltfJson(const GltfSource& source, bool dataUri)
+	{
+		std::string json = GLTF_TEMPLATE;
+		json = Replace(json, "%NODES%", source.nodes);
+		json = Replace(json, "%INDEX_TYPE%", source.indexType);
+		json = Replace(json, "%INDEX_COUNT%", source.indexCount);
+		const std::string buffer = !source.buffer.empty() ? source.buffer : dataUri ?
+			R"({ "byteLength": 92, "uri": "data:application/octet-stream;base64,)" + EncodeBase64(source.data) + "\" }" :
+			std::string(R"({ "byteLength": 92 })");
+		return Replace(json, "%BUFFER%", buffer);
+	}
+
+	// 12 byte header, the JSON chunk padded with spaces, the BIN chunk padded with zeros.
+	std::vector<uint8_t> MakeGlb(const GltfSource& source)
+	{
+		std::string json = MakeGltfJson(source, false);
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+		std::vector<uint8_t> binary = source.data;
+		binary.resize((binary.size() + 3) & ~size_t(3), 0);
+
+		const uint32_t header[] = { 0x46546C67, 2, uint32_t(12 + 8 + json.size() + 8 + binary.size()) };
+		const uint32_t jsonChunk[] = { uint32_t(json.size()), 0x4E4F534A };
+		const uint32_t binaryChunk[] = { uint32_t(binary.size()), 0x004E4942 };
+		std::vector<uint8_t> glb;
+		Append(glb, header, 3);
+		Append(glb, jsonChunk, 2);
+		Append(glb, json.data(), json.size());
+		Append(glb, binaryChunk, 2);
+		Append(glb, binary.data(), binary.size());
+		return glb;
+	}
+
+	SourceMesh ImportGltfText(const std::string& json)
+	{
+		SourceMesh mesh;
+		ImportGltf(reinterpret_cast<const uint8_t*>(json.data()), json.size(), ".", mesh);
+		return mesh;
+	}
+
+	SourceMesh ImportGlb(const std::vector<uint8_t>& glb)
+	{
+		SourceMesh mesh;
+		ImportGltf(glb.data(), glb.size(), ".", mesh);
+		return mesh;
+	}
+
+	void TestGltf()
+	{
+		const GltfSource source;
+		const SourceMesh mesh = ImportGltfText(MakeGltfJson(source, true));
+		CHECK(ValidIndices(mesh) && mesh.positions.size() == 4 && mesh.uvs.size() == 4 && mesh.normals.empty());
+		CHECK(mesh.indices == std::vector<uint32_t>({ 0, 1, 2, 0, 2, 3 }));
+		CHECK(Equal(mesh.positions[2], XMFLOAT3(11.0f, 1.0f, 0.0f)) && mesh.uvs[2].x == 1.0f && mesh.uvs[2].y == 1.0f);
+		CHECK(SameMesh(mesh, ImportGlb(MakeGlb(source))));
+
+		// Child nodes inherit the transform; a mirroring scale turns the winding around.
+		GltfSource mirrored;
+		mirrored.nodes = R"([ { "children": [ 1 ], "translation": [ 10, 0, 0 ] }, { "mesh": 0, "scale": [ -1, 1, 1 ] } ])";
+		const SourceMesh flipped = ImportGltfText(MakeGltfJson(mirrored, true));
+		CHECK(ValidIndices(flipped) && flipped.indices == std::vector<uint32_t>({ 0, 2, 1, 0, 3, 2 }));
+		CHECK(flipped.positions.size() == 4 && Equal(flipped.positions[2], XMFLOAT3(9.0f, 1.0f, 0.0f)));
+
+		// 8 bit indices.
+		GltfSource bytes;
+		const uint8_t indices[] = { 0, 1, 2, 0, 2, 3 };
+		bytes.data.resize(80);
+		Append(bytes.data, indices, 6);
+		bytes.data.resize(92, 0);
+		std::memcpy(bytes.data.data(), MakeGltfBuffer().data(), 80);
+		bytes.indexType = "5121";
+		CHECK(ImportGltfText(MakeGltfJson(bytes, true)).indices == mesh.indices);
+	}
+
+	void TestGltfMalformed()
+	{
+		auto rejects = [](const GltfSource& source, const char* message) {
+			const bool json = Throws([&] { ImportGltfText(MakeGltfJson(source, true)); }, message);
+			const bool glb = Throws([&] { ImportGlb(MakeGlb(source)); }, message);
+			return json && glb;
+		};
+
+		// Indices: out of range, negative (as an unsigned index type can't be, the
+		//		accessor's component type is wrong), not whole triangles.
+		GltfSource source;
+		source.data[80] = 4;
+		CHECK(rejects(source, "vertex index out of range"));
+		source = GltfSource();
+		source.indexType = "5122";
+		CHECK(rejects(source, "invalid index accessor"));
+		source = GltfSource();
+		source.indexCount = "5";
+		CHECK(rejects(source, "multiple of 3"));
+		// More elements than the view holds.
+		source = GltfSource();
+		source.indexCount = "9";
+		CHECK(rejects(source, "out of bounds"));
+
+		// Negative, fractional and dangling references between objects.
+		const char* const badNodes[] =
+		{
+			R"([ { "mesh": -1 } ])",
+			R"([ { "mesh": 0.5 } ])",
+			R"([ { "mesh": 1 } ])",
+			R"([ { "mesh": 0, "children": [ -1 ] } ])",
+			R"([ { "mesh": 0, "children": [ 1 ] } ])",
+			R"([ { "mesh": 0, "children": [ 0 ] } ])",	// a cycle
+			R"([ { "mesh": 0, "matrix": [ 1, 0, 0 ] } ])",
+			R"([ { "mesh": 0, "scale": [ 1, 1 ] } ])",
+		};
+		for (const char* nodes : badNodes)
+		{
+			source = GltfSource();
+			source.nodes = nodes;
+			if (!CHECK(rejects(source, nullptr)))
+				std::fprintf(stderr, "\taccepted nodes: %s\n", nodes);
+		}
+
+		// Buffers: shorter than declared, broken base64, unsupported data URI.
+		source = GltfSource();
+		source.buffer = R"({ "byteLength": 200, "uri": "data:application/octet-stream;base64,)" + EncodeBase64(source.data) + "\" }";
+		CHECK(Throws([&] { ImportGltfText(MakeGltfJson(source, true)); }, "shorter than its byteLength"));
+		source.buffer = R"({ "byteLength": 92, "uri": "data:application/octet-stream;base64,AB*D" })";
+		CHECK(Throws([&] { ImportGltfText(MakeGltfJson(source, true)); }, "base64"));
+		source.buffer = R"({ "byteLength": 92, "uri": "data:text/plain,abc" })";
+		CHECK(Throws([&] { ImportGltfText(MakeGltfJson(source, true)); }, "data uri"));
+		// No URI outside a GLB.
+		CHECK(Throws([&] { ImportGltfText(MakeGltfJson(GltfSource(), false)); }, "buffer without uri"));
+
+		// Not JSON, not an object, nothing to import.
+		CHECK(Throws([&] { ImportGltfText(MakeGltfJson(GltfSource(), true).substr(0, 100)); }));
+		CHECK(Throws([&] { ImportGltfText("[ 1, 2 ]"); }, "not an object"));
+		CHECK(Throws([&] { ImportGltfText(R"({ "asset": { "version": "2.0" } })"); }, "no triangles"));
+
+		// GLB container: wrong version, length past the data, chunk past the length,
+		//		no JSON chunk - and every truncation of a good file.
+		const std::vector<uint8_t> glb = MakeGlb(GltfSource());
+		std::vector<uint8_t> damaged = glb;
+		damaged[4] = 1;
+		CHECK(Throws([&] { ImportGlb(damaged); }, "invalid GLB header"));
+		damaged = glb;
+		damaged[8] += 4;
+		CHECK(Throws([&] { ImportGlb(damaged); }, "invalid GLB header"));
+		damaged = glb;
+		damaged[12] += 4;
+		CHECK(Throws([&] { ImportGlb(damaged); }));
+		damaged = glb;
+		damaged[16] = 'X';
+		CHECK(Throws([&] { ImportGlb(damaged); }, "without JSON chunk"));
+
+		bool truncations = true;
+		for (size_t size = 12; size < glb.size(); ++size)
+		{
+			std::vector<uint8_t> truncated(glb.begin(), glb.begin() + size);
+			const uint32_t length = uint32_t(size);
+			std::memcpy(truncated.data() + 8, &length, sizeof(length));
+			truncations = truncations && Throws([&] { ImportGlb(truncated); });
+		}
+		CHECK(truncations);
+	}
+}
+
+int main()
+{
+	TaskScheduler scheduler(3);
+
+	TestObjBasics();
+	TestObjChunks(scheduler);
+	TestObjMalformed();
+	TestGltf();
+	TestGltfMalformed();
+
+	return Test::Result("MeshImporter");
+}
@@ -0,0 +1,123 @@
+// The mesh optimizer passes: time and vertex cache statistics (16 entry FIFO) before and
+//		after each one. Not a test (timings depend on the machine); run it by hand:
+//
+//		MeshOptimizerBenchmark [gridCells]
+//
+// Three inputs of the same grid - the scan line order a generator writes, the triangles
+//		shuffled (the worst case) and a UV sphere with the same number of triangles, whose
+//		normals give the overdraw pass something to sort. The passes run in the usual order,
+//		on the output of the previous one.
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	// A grid of cells x cells quads; "sphere" wraps it around the unit sphere.
+	Mesh MakeGrid(int cells, bool sphere)
+	{
+		Mesh mesh;
+		for (int y = 0; y <= cells; ++y)
+		{
+			for (int x = 0; x <= cells; ++x)
+			{
+				const float u = float(x) / cells, v = float(y) / cells;
+				if (sphere)
+				{
+					const float theta = u * 6.2831853f, phi = v * 3.1415927f;
+					mesh.positions.push_back(XMFLOAT3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+				}
+				else
+				{
+					mesh.positions.push_back(XMFLOAT3(u, v, 0.0f));
+				}
+			}
+		}
+		for (int y = 0; y < cells; ++y)
+		{
+			for (int x = 0; x < cells; ++x)
+			{
+				const uint32_t a = y * (cells + 1) + x, b = a + 1, c = a + cells + 1, d = c + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+			}
+		}
+		return mesh;
+	}
+
+	void Shuffle(Mesh& mesh)
+	{
+		const size_t triangleCount = mesh.indices.size() / 3;
+		std::vector<uint32_t> order(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+			order[t] = uint32_t(t);
+		std::mt19937 random(64);
+		std::shuffle(order.begin(), order.end(), random);
+		std::vector<uint32_t> shuffled;
+		shuffled.reserve(mesh.indices.size());
+		for (uint32_t t : order)
+			shuffled.insert(shuffled.end(), &mesh.indices[t * 3], &mesh.indices[t * 3] + 3);
+		mesh.indices.swap(shuffled);
+	}
+
+	template<typename Function>
+	double MeasureMilliseconds(Function function)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	void PrintRow(const char* input, const char* pass, const Mesh& mesh, double milliseconds)
+	{
+		const VertexCacheStatistics statistics = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+		if (milliseconds < 0.0)
+			std::printf("%-10s  %-14s  %6.3f  %6.3f\n", input, pass, statistics.acmr, statistics.atvr);
+		else
+			std::printf("%-10s  %-14s  %6.3f  %6.3f  %10.2f  %8.2f\n", input, pass, statistics.acmr, statistics.atvr,
+				milliseconds, mesh.indices.size() / 3 / milliseconds * 1e-3);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int cells = argc > 1 ? std::atoi(argv[1]) : 1000;
+	std::printf("%d x %d cells, %d triangles\n\n", cells, cells, 2 * cells * cells);
+	std::printf("input       pass              ACMR    ATVR          ms   Mtris/s\n");
+
+	const char* inputs[] = { "scan line", "shuffled", "sphere" };
+	for (int input = 0; input < 3; ++input)
+	{
+		Mesh mesh = MakeGrid(cells, input == 2);
+		if (input == 1)
+			Shuffle(mesh);
+		PrintRow(inputs[input], "input", mesh, -1.0);
+
+		double ms = MeasureMilliseconds([&]() { OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size()); });
+		PrintRow(inputs[input], "vertex cache", mesh, ms);
+		ms = MeasureMilliseconds([&]() {
+			OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(XMFLOAT3), mesh.positions.size());
+		});
+		PrintRow(inputs[input], "overdraw", mesh, ms);
+		ms = MeasureMilliseconds([&]() {
+			mesh.positions.resize(OptimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(),
+				mesh.positions.size(), sizeof(XMFLOAT3)));
+		});
+		PrintRow(inputs[input], "vertex fetch", mesh, ms);
+	}
+	return 0;
+}
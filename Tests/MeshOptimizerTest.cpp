@@ -0,0 +1,172 @@
+#include "Test.h"
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+// A 300 x 300 grid with its triangles shuffled is about the worst input the vertex cache
+//		can get (every triangle misses with nearly all 3 vertices) and has a known good
+//		result: a FIFO cache of 16 over a grid walked in short strips gets close to 2/3 of
+//		a miss per triangle. Every pass must keep the set of triangles, winding included;
+//		the fetch pass must move every vertex byte for byte with its indices.
+namespace
+{
+	const int GRID_CELLS = 300;
+
+	// Position first, so the positions can be read with the vertex stride.
+	struct Vertex
+	{
+		XMFLOAT3 position;
+		float uv[2];
+		uint32_t id;
+		// Random bits, so every byte of a vertex differs from its neighbours'.
+		uint32_t noise;
+	};
+
+	struct Mesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	Mesh MakeShuffledGrid()
+	{
+		std::mt19937 random(64);
+		Mesh mesh;
+		for (int y = 0; y <= GRID_CELLS; ++y)
+		{
+			for (int x = 0; x <= GRID_CELLS; ++x)
+			{
+				const float u = float(x) / GRID_CELLS, v = float(y) / GRID_CELLS;
+				mesh.vertices.push_back({ XMFLOAT3(u, v, 0.0f), { u, 1.0f - v }, uint32_t(mesh.vertices.size()), uint32_t(random()) });
+			}
+		}
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (int y = 0; y < GRID_CELLS; ++y)
+		{
+			for (int x = 0; x < GRID_CELLS; ++x)
+			{
+				const uint32_t a = y * (GRID_CELLS + 1) + x, b = a + 1, c = a + GRID_CELLS + 1, d = c + 1;
+				triangles.push_back({ { a, c, b } });
+				triangles.push_back({ { b, c, d } });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		for (const auto& triangle : triangles)
+			mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+		return mesh;
+	}
+
+	// Triangles as sorted (smallest vertex first, winding kept) lists of vertex ids.
+	std::vector<std::array<uint32_t, 3>> GetTriangleSet(const Mesh& mesh)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			std::array<uint32_t, 3> t = { { mesh.vertices[mesh.indices[i]].id, mesh.vertices[mesh.indices[i + 1]].id,
+				mesh.vertices[mesh.indices[i + 2]].id } };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	float GetAcmr(const Mesh& mesh)
+	{
+		return AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).acmr;
+	}
+
+	void TestPasses()
+	{
+		Mesh mesh = MakeShuffledGrid();
+		const std::vector<std::array<uint32_t, 3>> triangles = GetTriangleSet(mesh);
+
+		const float shuffledAcmr = GetAcmr(mesh);
+		CHECK(shuffledAcmr > 2.9f && shuffledAcmr <= 3.0f);
+
+		OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+		const float cacheAcmr = GetAcmr(mesh);
+		CHECK(cacheAcmr > 0.6f && cacheAcmr < 0.75f);
+		CHECK(GetTriangleSet(mesh) == triangles);
+
+		// Splits the cache order into clusters; each may cost up to 5% more misses, plus a
+		//		cold start per cluster.
+		OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].position, sizeof(Vertex),
+			mesh.vertices.size(), 1.05f);
+		CHECK(GetAcmr(mesh) < cacheAcmr * 1.1f);
+		CHECK(GetTriangleSet(mesh) == triangles);
+	}
+
+	// The remap of a second stream and the in place reorder of the first must agree, and
+	//		both must move every vertex with its indices, byte for byte.
+	void TestVertexFetch()
+	{
+		Mesh mesh = MakeShuffledGrid();
+		OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+		// An unreferenced vertex in the middle is dropped.
+		for (uint32_t& index : mesh.indices)
+			index = index >= 1000 ? index + 1 : index;
+		mesh.vertices.insert(mesh.vertices.begin() + 1000, Vertex{ XMFLOAT3(9.0f, 9.0f, 9.0f), { 9.0f, 9.0f }, 0xDEADu, 0xDEADu });
+
+		const Mesh original = mesh;
+		std::vector<uint32_t> remap(mesh.vertices.size());
+		const size_t remapCount = GenerateVertexFetchRemap(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), remap.data());
+		CHECK(remapCount == mesh.vertices.size() - 1);
+		CHECK(remap[1000] == ~0u);
+		std::vector<Vertex> remapped(remapCount);
+		RemapVertices(mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), remap.data(), remapped.data());
+
+		const size_t newCount = OptimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(),
+			mesh.vertices.size(), sizeof(Vertex));
+		CHECK(newCount == remapCount);
+		mesh.vertices.resize(newCount);
+		CHECK(std::memcmp(mesh.vertices.data(), remapped.data(), newCount * sizeof(Vertex)) == 0);
+
+		bool exact = true, firstUseOrder = true;
+		uint32_t nextNew = 0;
+		for (size_t i = 0; i < mesh.indices.size(); ++i)
+		{
+			exact = exact && std::memcmp(&mesh.vertices[mesh.indices[i]], &original.vertices[original.indices[i]], sizeof(Vertex)) == 0;
+			if (mesh.indices[i] == nextNew)
+				++nextNew;
+			else
+				firstUseOrder = firstUseOrder && mesh.indices[i] < nextNew;
+		}
+		CHECK(exact);
+		CHECK(firstUseOrder && nextNew == newCount);
+		// Reordering vertices never changes the cache behaviour.
+		CHECK(GetAcmr(mesh) == GetAcmr(original));
+	}
+
+	void TestIndexFormat()
+	{
+		CHECK(SelectIndexFormat(0xFFFF) == IndexFormat::UInt16);
+		CHECK(SelectIndexFormat(0x10000) == IndexFormat::UInt32);
+
+		const uint32_t indices[] = { 0, 1, 0xFFFE, 7 };
+		uint16_t packed16[4];
+		PackIndices(indices, 4, IndexFormat::UInt16, packed16);
+		CHECK(packed16[0] == 0 && packed16[1] == 1 && packed16[2] == 0xFFFE && packed16[3] == 7);
+		uint32_t packed32[4];
+		PackIndices(indices, 4, IndexFormat::UInt32, packed32);
+		CHECK(std::memcmp(packed32, indices, sizeof(indices)) == 0);
+	}
+}
+
+int main()
+{
+	TestPasses();
+	TestVertexFetch();
+	TestIndexFormat();
+
+	return Test::Result("MeshOptimizer");
+}
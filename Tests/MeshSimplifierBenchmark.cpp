@@ -0,0 +1,132 @@
+// Throughput of the quadric mesh simplifier on multi-million triangle meshes. Not a test
+//		(timings depend on the machine); run it by hand:
+//
+//		MeshSimplifierBenchmark [millionTriangles] [threads]
+//
+// Input triangles per second for a few target ratios, positions only and with 5 float
+//		attributes (normal + UV), then a LOD chain generation of 8 meshes on the scheduler.
+//		maxError is set high enough that every run reaches its target ratio.
+#include "MeshSimplifier.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<float> attributes;		// normal xyz, uv
+		std::vector<uint32_t> indices;
+	};
+
+	// A bumpy grid with about "numTriangles" triangles.
+	Mesh MakeMesh(size_t numTriangles)
+	{
+		const int cells = std::max(1, int(std::sqrt(double(numTriangles) / 2.0)));
+		Mesh mesh;
+		mesh.positions.reserve(size_t(cells + 1) * (cells + 1));
+		for (int y = 0; y <= cells; ++y)
+		{
+			for (int x = 0; x <= cells; ++x)
+			{
+				const float u = float(x) / cells, v = float(y) / cells;
+				const float z = 0.05f * std::sin(u * 40.0f) * std::cos(v * 31.0f);
+				mesh.positions.push_back(XMFLOAT3(u, v, z));
+				const float normal[5] = { -std::cos(u * 40.0f) * 0.3f, std::sin(v * 31.0f) * 0.3f, 1.0f, u, v };
+				mesh.attributes.insert(mesh.attributes.end(), normal, normal + 5);
+			}
+		}
+		mesh.indices.reserve(size_t(cells) * cells * 6);
+		for (int y = 0; y < cells; ++y)
+		{
+			for (int x = 0; x < cells; ++x)
+			{
+				const uint32_t a = y * (cells + 1) + x, b = a + 1, c = a + cells + 1, d = c + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+			}
+		}
+		return mesh;
+	}
+
+	SimplifyMeshInput GetInput(const Mesh& mesh, bool withAttributes)
+	{
+		static const float weights[5] = { 0.5f, 0.5f, 0.5f, 1.0f, 1.0f };
+		SimplifyMeshInput input;
+		input.indices = mesh.indices.data();
+		input.indexCount = mesh.indices.size();
+		input.positions = mesh.positions.data();
+		input.vertexCount = mesh.positions.size();
+		if (withAttributes)
+		{
+			input.attributes = mesh.attributes.data();
+			input.attributeStride = 5 * sizeof(float);
+			input.attributeWeights = weights;
+			input.attributeCount = 5;
+		}
+		return input;
+	}
+
+	double Seconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double millions = argc > 1 ? std::atof(argv[1]) : 2.0;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+
+	const Mesh mesh = MakeMesh(size_t(millions * 1e6));
+	const size_t numTriangles = mesh.indices.size() / 3;
+	std::printf("%zu triangles, %zu vertices\n\n", numTriangles, mesh.positions.size());
+	std::printf("attributes  ratio    output tris    error        seconds   Mtris/s\n");
+
+	SimplifySettings settings;
+	settings.maxError = 1.0f;
+	const float ratios[] = { 0.5f, 0.25f, 0.1f, 0.01f };
+	std::vector<uint32_t> indices;
+	for (int withAttributes = 0; withAttributes < 2; ++withAttributes)
+	{
+		for (float ratio : ratios)
+		{
+			settings.targetRatio = ratio;
+			const auto start = std::chrono::high_resolution_clock::now();
+			const float error = SimplifyMesh(GetInput(mesh, withAttributes != 0), settings, indices);
+			const double seconds = Seconds(start);
+			std::printf("%-10s  %5.2f  %13zu  %9.6f  %13.3f  %8.2f\n", withAttributes ? "normal+uv" : "none", ratio,
+				indices.size() / 3, error, seconds, numTriangles / seconds * 1e-6);
+		}
+	}
+
+	// 8 meshes of an eighth of the size each, 3 levels - 24 independent simplifications.
+	std::vector<Mesh> meshes;
+	std::vector<SimplifyMeshInput> inputs;
+	for (int i = 0; i < 8; ++i)
+		meshes.push_back(MakeMesh(numTriangles / 8));
+	for (const Mesh& part : meshes)
+		inputs.push_back(GetInput(part, false));
+	const float chainRatios[] = { 0.5f, 0.25f, 0.1f };
+	std::vector<SimplifiedLod> chains[8];
+	settings.maxError = 1.0f;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	GenerateLodChains(inputs.data(), inputs.size(), chainRatios, 3, settings, chains, nullptr);
+	const double serialSeconds = Seconds(start);
+	start = std::chrono::high_resolution_clock::now();
+	GenerateLodChains(inputs.data(), inputs.size(), chainRatios, 3, settings, chains, &scheduler);
+	const double parallelSeconds = Seconds(start);
+	std::printf("\nGenerateLodChains, 8 meshes x 3 levels: %.3f s serial, %.3f s on %u thread(s)\n",
+		serialSeconds, parallelSeconds, threads);
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include "Test.h"
+
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	// An open grid over [0, size]^2 with bumps of "height" - curved enough that the
+	//		simplifier stops at maxError before it reaches a low target ratio.
+	Mesh MakeBumpyGrid(int cells, float size, float height)
+	{
+		Mesh mesh;
+		for (int y = 0; y <= cells; ++y)
+		{
+			for (int x = 0; x <= cells; ++x)
+			{
+				const float u = float(x) / cells, v = float(y) / cells;
+				mesh.positions.push_back(XMFLOAT3(u * size, v * size,
+					height * std::sin(u * 12.0f) * std::cos(v * 9.0f)));
+			}
+		}
+		for (int y = 0; y < cells; ++y)
+		{
+			for (int x = 0; x < cells; ++x)
+			{
+				const uint32_t a = y * (cells + 1) + x, b = a + 1, c = a + cells + 1, d = c + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+			}
+		}
+		return mesh;
+	}
+
+	SimplifyMeshInput GetInput(const Mesh& mesh)
+	{
+		SimplifyMeshInput input;
+		input.indices = mesh.indices.data();
+		input.indexCount = mesh.indices.size();
+		input.positions = mesh.positions.data();
+		input.vertexCount = mesh.positions.size();
+		return input;
+	}
+
+	// The same mesh at another size must lose the same triangles, and report an error
+	//		that grows with it. Powers of two scale every position exactly, so the result
+	//		must be identical; other scales round the positions and may break a few cost
+	//		ties differently.
+	void TestScaleInvariance(bool lockBorder, float targetRatio)
+	{
+		const Mesh reference = MakeBumpyGrid(64, 1.0f, 0.05f);
+		SimplifySettings settings;
+		settings.targetRatio = targetRatio;
+		settings.maxError = 0.01f;
+		settings.lockBorder = lockBorder;
+
+		std::vector<uint32_t> referenceIndices;
+		const float referenceError = SimplifyMesh(GetInput(reference), settings, referenceIndices);
+		CHECK(referenceIndices.size() < reference.indices.size());
+		CHECK(referenceError > 0.0f && referenceError <= settings.maxError);
+
+		for (float scale : { 0.25f, 64.0f, 0.01f, 100.0f })
+		{
+			Mesh scaled = reference;
+			for (XMFLOAT3& p : scaled.positions)
+				p = XMFLOAT3(p.x * scale, p.y * scale, p.z * scale);
+
+			std::vector<uint32_t> indices;
+			const float error = SimplifyMesh(GetInput(scaled), settings, indices) / scale;
+			const bool exact = std::exp2(std::round(std::log2(scale))) == scale;
+			if (exact)
+			{
+				CHECK(indices == referenceIndices);
+				CHECK(error == referenceError);
+			}
+			else
+			{
+				const double difference = std::fabs(double(indices.size()) - double(referenceIndices.size()));
+				CHECK(difference <= referenceIndices.size() * 0.01);
+				CHECK(std::fabs(error - referenceError) <= referenceError * 0.01f);
+			}
+		}
+	}
+
+	// A flat grid is simplified down to the target without any error.
+	void TestFlat()
+	{
+		const Mesh mesh = MakeBumpyGrid(32, 10.0f, 0.0f);
+		SimplifySettings settings;
+		settings.targetRatio = 0.1f;
+		settings.lockBorder = false;
+
+		std::vector<uint32_t> indices;
+		const float error = SimplifyMesh(GetInput(mesh), settings, indices);
+		CHECK(indices.size() <= mesh.indices.size() / 10 + 6);
+		CHECK(error < 1e-4f);
+	}
+}
+
+int main()
+{
+	TestScaleInvariance(true, 0.5f);
+	TestScaleInvariance(true, 0.05f);
+	TestScaleInvariance(false, 0.05f);
+	TestFlat();
+
+	return Test::Result("MeshSimplifier");
+}
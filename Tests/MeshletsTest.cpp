@@ -0,0 +1,207 @@
+#include "Test.h"
+
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// BuildMeshlets on a bumpy sphere of 130k triangles - several partitioning chunks - in
+//		vertex cache order (full meshlets), shuffled (meshlets end early, many vertices
+//		shared across them) and with degenerate triangles mixed in. Checked against the
+//		input, not against a second implementation:
+//		- with and without a scheduler the output is the same bytes,
+//		- every meshlet keeps the 64 vertex / 124 triangle limits and references only its
+//		  own vertices, each once,
+//		- the meshlet triangles mapped back to mesh vertices are the index buffer, in order,
+//		- every sphere contains its vertices,
+//		- a meshlet the cone culls from an eye position has no triangle facing that eye.
+namespace
+{
+	struct Mesh
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	// Outward facing: cross(p1 - p0, p2 - p0) points away from the center.
+	Mesh MakeBumpySphere(int segments, int rings)
+	{
+		const float pi = 3.14159265f;
+		Mesh mesh;
+		for (int y = 0; y <= rings; ++y)
+		{
+			for (int x = 0; x <= segments; ++x)
+			{
+				const float theta = 2.0f * pi * x / segments, phi = pi * y / rings;
+				const float radius = 1.0f + 0.05f * std::sin(theta * 7.0f) * std::sin(phi * 5.0f);
+				mesh.positions.push_back(XMFLOAT3(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi),
+					radius * std::sin(phi) * std::sin(theta)));
+			}
+		}
+		for (int y = 0; y < rings; ++y)
+		{
+			for (int x = 0; x < segments; ++x)
+			{
+				const uint32_t a = y * (segments + 1) + x, b = a + 1, c = a + segments + 1, d = c + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		return mesh;
+	}
+
+	void Shuffle(Mesh& mesh, std::mt19937& random)
+	{
+		std::vector<uint32_t> order(mesh.indices.size() / 3);
+		for (size_t t = 0; t < order.size(); ++t)
+			order[t] = uint32_t(t);
+		std::shuffle(order.begin(), order.end(), random);
+		std::vector<uint32_t> shuffled;
+		for (uint32_t t : order)
+			shuffled.insert(shuffled.end(), &mesh.indices[t * 3], &mesh.indices[t * 3] + 3);
+		mesh.indices.swap(shuffled);
+	}
+
+	bool SameOutput(const MeshletMesh& a, const MeshletMesh& b)
+	{
+		return a.meshlets.size() == b.meshlets.size() &&
+			std::memcmp(a.meshlets.data(), b.meshlets.data(), a.meshlets.size() * sizeof(Meshlet)) == 0 &&
+			a.vertices == b.vertices && a.triangles == b.triangles && a.bounds.count == b.bounds.count &&
+			std::memcmp(a.bounds.data.data(), b.bounds.data.data(), a.bounds.data.size() * sizeof(float)) == 0;
+	}
+
+	void CheckStructure(const Mesh& mesh, const MeshletMesh& meshlets)
+	{
+		bool limits = true, packed = true, uniqueVertices = true;
+		std::vector<uint32_t> indices;
+		uint32_t vertexOffset = 0, triangleOffset = 0;
+		for (const Meshlet& meshlet : meshlets.meshlets)
+		{
+			limits = limits && meshlet.vertexCount > 0 && meshlet.vertexCount <= MAX_MESHLET_VERTICES &&
+				meshlet.triangleCount > 0 && meshlet.triangleCount <= MAX_MESHLET_TRIANGLES;
+			packed = packed && meshlet.vertexOffset == vertexOffset && meshlet.triangleOffset == triangleOffset;
+			vertexOffset += meshlet.vertexCount;
+			triangleOffset += meshlet.triangleCount;
+			if (vertexOffset > meshlets.vertices.size() || triangleOffset > meshlets.triangles.size())
+				break;
+
+			std::vector<uint32_t> vertices(&meshlets.vertices[meshlet.vertexOffset], &meshlets.vertices[meshlet.vertexOffset] + meshlet.vertexCount);
+			std::sort(vertices.begin(), vertices.end());
+			uniqueVertices = uniqueVertices && std::adjacent_find(vertices.begin(), vertices.end()) == vertices.end();
+
+			for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+			{
+				const uint32_t triangle = meshlets.triangles[meshlet.triangleOffset + t];
+				packed = packed && (triangle >> 24) == 0;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t local = (triangle >> (corner * 8)) & 0xFF;
+					limits = limits && local < meshlet.vertexCount;
+					indices.push_back(meshlets.vertices[meshlet.vertexOffset + std::min(local, meshlet.vertexCount - 1)]);
+				}
+			}
+		}
+		CHECK(limits);
+		CHECK(packed && vertexOffset == meshlets.vertices.size() && triangleOffset == meshlets.triangles.size());
+		CHECK(uniqueVertices);
+		CHECK(indices == mesh.indices);
+		CHECK(meshlets.bounds.GetCount() == meshlets.meshlets.size());
+	}
+
+	void CheckBounds(const Mesh& mesh, const MeshletMesh& meshlets, std::mt19937& random, bool expectCulling)
+	{
+		const MeshletBounds& bounds = meshlets.bounds;
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		bool contained = true, conservative = true;
+		size_t culled = 0;
+		for (size_t m = 0; m < meshlets.meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = meshlets.meshlets[m];
+			const XMFLOAT3 center(bounds.GetStream(MeshletBounds::CenterX)[m], bounds.GetStream(MeshletBounds::CenterY)[m],
+				bounds.GetStream(MeshletBounds::CenterZ)[m]);
+			const float radius = bounds.GetStream(MeshletBounds::Radius)[m];
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				const XMFLOAT3& p = mesh.positions[meshlets.vertices[meshlet.vertexOffset + i]];
+				const float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+				contained = contained && std::sqrt(dx * dx + dy * dy + dz * dz) <= radius * 1.0001f;
+			}
+
+			// Eyes around the meshlet, from touching distance to the other side of the mesh.
+			for (int sample = 0; sample < 32; ++sample)
+			{
+				const float distance = radius * (0.25f + 8.0f * sample / 32.0f);
+				const XMFLOAT3 eye(center.x + unit(random) * distance, center.y + unit(random) * distance, center.z + unit(random) * distance);
+				if (!bounds.IsBackfacing(m, eye))
+					continue;
+				++culled;
+				for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+				{
+					const uint32_t triangle = meshlets.triangles[meshlet.triangleOffset + t];
+					const XMVECTOR p0 = XMLoadFloat3(&mesh.positions[meshlets.vertices[meshlet.vertexOffset + (triangle & 0xFF)]]);
+					const XMVECTOR p1 = XMLoadFloat3(&mesh.positions[meshlets.vertices[meshlet.vertexOffset + ((triangle >> 8) & 0xFF)]]);
+					const XMVECTOR p2 = XMLoadFloat3(&mesh.positions[meshlets.vertices[meshlet.vertexOffset + ((triangle >> 16) & 0xFF)]]);
+					const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+					// Front facing: the eye is in front of the plane. A hair of slack for eyes
+					//		on the plane itself.
+					const float facing = XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(XMLoadFloat3(&eye), p0)));
+					conservative = conservative && facing <= 1e-6f * XMVectorGetX(XMVector3Length(normal)) * radius;
+				}
+			}
+		}
+		CHECK(contained);
+		CHECK(conservative);
+		CHECK(!expectCulling || culled > 0);
+	}
+
+	void TestMesh(const Mesh& mesh, TaskScheduler& scheduler, std::mt19937& random, bool expectCulling)
+	{
+		MeshletMesh serial, parallel;
+		BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(XMFLOAT3), mesh.positions.size(), serial);
+		BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(XMFLOAT3), mesh.positions.size(), parallel, &scheduler);
+		CHECK(SameOutput(serial, parallel));
+		CheckStructure(mesh, parallel);
+		CheckBounds(mesh, parallel, random, expectCulling);
+	}
+}
+
+int main()
+{
+	TaskScheduler scheduler(3);
+	std::mt19937 random(65);
+
+	// 256 x 256 quads: 131072 triangles, 8 chunks.
+	Mesh mesh = MakeBumpySphere(256, 256);
+	OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+	TestMesh(mesh, scheduler, random, true);
+
+	// Most meshlets full: vertex cache order shares about 2 triangles per vertex.
+	{
+		MeshletMesh meshlets;
+		BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(XMFLOAT3), mesh.positions.size(), meshlets);
+		CHECK(meshlets.meshlets.size() * MAX_MESHLET_TRIANGLES < mesh.indices.size() / 3 * 2);
+	}
+
+	// Degenerate triangles (repeated corners, and a collapsed triangle) in between.
+	Mesh degenerate = mesh;
+	for (size_t t = 0; t < degenerate.indices.size() / 3; t += 97)
+	{
+		uint32_t* triangle = &degenerate.indices[t * 3];
+		triangle[(t / 97) % 3] = triangle[(t / 97 + 1) % 3];
+		if (t % 5 == 0)
+			triangle[0] = triangle[1] = triangle[2];
+	}
+	TestMesh(degenerate, scheduler, random, true);
+
+	Shuffle(mesh, random);
+	TestMesh(mesh, scheduler, random, false);
+
+	return Test::Result("Meshlets");
+}
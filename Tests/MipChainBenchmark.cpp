@@ -0,0 +1,79 @@
+// Timing of the cooker's mip chain generation on the CPU. Not a test (timings depend on
+//		the machine); run it by hand:
+//
+//		MipChainBenchmark [size] [threads]
+//
+// A full chain of a size x size RGBA8 image per filter, linear and sRGB, serial and on the
+//		scheduler. Megapixels per second are of the source image.
+#include "Tools/AssetCooker/MipChain.h"
+#include "Tools/AssetCooker/TextureCooker.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Best of "iterations" runs, in milliseconds.
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t size = argc > 1 ? uint32_t(std::atoi(argv[1])) : 4096;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	const int iterations = 3;
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+
+	// Smooth gradients with some noise, like a photo texture.
+	SourceImage image;
+	image.width = size;
+	image.height = size;
+	image.rgba.resize(size_t(size) * size * 4);
+	std::mt19937 random(72);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			uint8_t* texel = &image.rgba[(size_t(y) * size + x) * 4];
+			texel[0] = uint8_t(128.0f + 100.0f * std::sin(x * 0.01f) + random() % 16);
+			texel[1] = uint8_t(128.0f + 100.0f * std::cos(y * 0.013f) + random() % 16);
+			texel[2] = uint8_t((x ^ y) & 0xFF);
+			texel[3] = 255;
+		}
+	}
+
+	std::printf("%u x %u, %u thread(s), best of %d\n\n", size, size, threads, iterations);
+	std::printf("filter  color      serial ms   MPixels/s   parallel ms   MPixels/s\n");
+	const double megapixels = double(size) * size * 1e-6;
+	std::vector<SourceImage> mips;
+	for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		for (int srgb = 0; srgb < 2; ++srgb)
+		{
+			const double serialMs = MeasureMilliseconds(iterations, [&]() { GenerateMipChain(image, filter, srgb != 0, nullptr, mips); });
+			const double parallelMs = MeasureMilliseconds(iterations, [&]() { GenerateMipChain(image, filter, srgb != 0, &scheduler, mips); });
+			std::printf("%-6s  %-6s  %12.1f  %10.1f  %12.1f  %10.1f\n", filter == MipFilter::Box ? "box" : "kaiser",
+				srgb ? "sRGB" : "linear", serialMs, megapixels / serialMs * 1000.0, parallelMs, megapixels / parallelMs * 1000.0);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,167 @@
+#include "Test.h"
+
+#include "Tools/AssetCooker/MipChain.h"
+#include "Tools/AssetCooker/TextureCooker.h"
+#include "Framework/TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// =====================================================================================
+//										Tests
+// =====================================================================================
+
+// MipChain.h promises that the cooker's box filter and Shaders/GenerateMips_CS.hlsl agree
+//		to within a step of 8 bit precision per level. The GPU side is a scalar port of the
+//		shader: the same Footprint() in float, pow() for the sRGB curves, and every level
+//		stored to an 8 bit UNORM texture (round to nearest even) before the next one reads
+//		it - the cooker instead keeps the whole chain in float. Odd sizes exercise the 3 texel
+//		footprint, noise the worst case for the accumulated rounding.
+namespace
+{
+	float SrgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	float Saturate(float value)
+	{
+		return std::min(std::max(value, 0.0f), 1.0f);
+	}
+
+	// Footprint() of GenerateMips_CS.hlsl.
+	void Footprint(uint32_t i, uint32_t srcSize, uint32_t dstSize, int& first, float weights[4])
+	{
+		const float scale = float(srcSize) / float(dstSize);
+		const float lo = float(i) * scale;
+		const float hi = float(i + 1) * scale;
+		first = int(std::floor(lo));
+		for (int k = 0; k < 4; ++k)
+		{
+			const float texel = float(first + k);
+			weights[k] = std::max(std::min(hi, texel + 1.0f) - std::max(lo, texel), 0.0f) / scale;
+		}
+	}
+
+	// One dispatch of GenerateMips_CS.hlsl: "source" is the UNORM view of the level above.
+	SourceImage GpuDownsample(const SourceImage& source, bool srgb)
+	{
+		SourceImage destination;
+		destination.width = std::max(1u, source.width / 2);
+		destination.height = std::max(1u, source.height / 2);
+		destination.rgba.resize(size_t(destination.width) * destination.height * 4);
+
+		for (uint32_t y = 0; y < destination.height; ++y)
+		{
+			for (uint32_t x = 0; x < destination.width; ++x)
+			{
+				int firstX, firstY;
+				float weightsX[4], weightsY[4];
+				Footprint(x, source.width, destination.width, firstX, weightsX);
+				Footprint(y, source.height, destination.height, firstY, weightsY);
+
+				float sum[4] = {};
+				for (int j = 0; j < 4; ++j)
+				{
+					for (int i = 0; i < 4; ++i)
+					{
+						const float weight = weightsX[i] * weightsY[j];
+						if (weight <= 0.0f)
+							continue;
+						const uint32_t sx = std::min(uint32_t(firstX + i), source.width - 1);
+						const uint32_t sy = std::min(uint32_t(firstY + j), source.height - 1);
+						const uint8_t* texel = &source.rgba[(size_t(sy) * source.width + sx) * 4];
+						for (int c = 0; c < 4; ++c)
+						{
+							const float value = texel[c] / 255.0f;
+							sum[c] += weight * (srgb && c < 3 ? SrgbToLinear(value) : value);
+						}
+					}
+				}
+
+				uint8_t* out = &destination.rgba[(size_t(y) * destination.width + x) * 4];
+				for (int c = 0; c < 4; ++c)
+				{
+					const float value = srgb && c < 3 ? LinearToSrgb(Saturate(sum[c])) : Saturate(sum[c]);
+					out[c] = uint8_t(std::nearbyint(value * 255.0f));
+				}
+			}
+		}
+		return destination;
+	}
+
+	SourceImage MakeNoise(uint32_t width, uint32_t height, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		SourceImage image;
+		image.width = width;
+		image.height = height;
+		image.rgba.resize(size_t(width) * height * 4);
+		for (uint8_t& value : image.rgba)
+			value = uint8_t(random());
+		return image;
+	}
+
+	void TestAgainstShader(TaskScheduler& scheduler)
+	{
+		const uint32_t sizes[][2] = { { 64, 64 }, { 37, 23 }, { 255, 3 }, { 1, 17 }, { 301, 129 } };
+		for (const auto& size : sizes)
+		{
+			for (int srgb = 0; srgb < 2; ++srgb)
+			{
+				const SourceImage image = MakeNoise(size[0], size[1], size[0] * 1000 + size[1]);
+				std::vector<SourceImage> mips;
+				GenerateMipChain(image, MipFilter::Box, srgb != 0, &scheduler, mips);
+				CHECK(mips.size() + 1 == GetMipCount(size[0], size[1]));
+
+				SourceImage gpu = image;
+				for (size_t level = 1; level <= mips.size(); ++level)
+				{
+					gpu = GpuDownsample(gpu, srgb != 0);
+					const SourceImage& cpu = mips[level - 1];
+					CHECK(cpu.width == gpu.width && cpu.height == gpu.height);
+					if (cpu.rgba.size() != gpu.rgba.size())
+						break;
+
+					int maxDifference = 0;
+					for (size_t i = 0; i < cpu.rgba.size(); ++i)
+						maxDifference = std::max(maxDifference, std::abs(int(cpu.rgba[i]) - int(gpu.rgba[i])));
+					CHECK(maxDifference <= int(level));
+				}
+			}
+		}
+	}
+
+	// Serial and scheduled chains are the same bytes.
+	void TestParallel(TaskScheduler& scheduler)
+	{
+		const SourceImage image = MakeNoise(513, 300, 7);
+		for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+		{
+			std::vector<SourceImage> serial, parallel;
+			GenerateMipChain(image, filter, true, nullptr, serial);
+			GenerateMipChain(image, filter, true, &scheduler, parallel);
+			CHECK(serial.size() == parallel.size());
+			for (size_t level = 0; level < std::min(serial.size(), parallel.size()); ++level)
+				CHECK(serial[level].rgba == parallel[level].rgba);
+		}
+	}
+}
+
+int main()
+{
+	TaskScheduler scheduler(3);
+	TestAgainstShader(scheduler);
+	TestParallel(scheduler);
+
+	return Test::Result("MipChain");
+}
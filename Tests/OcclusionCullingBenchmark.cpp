@@ -0,0 +1,122 @@
+// Timing of the masked occlusion buffer, scalar against AVX2 rasterization. Not a test
+//		(timings depend on the machine); run it by hand:
+//
+//		OcclusionCullingBenchmark [numOccluderTriangles] [iterations]
+#include "OcclusionCulling.h"
+#include "TaskScheduler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t WIDTH = 320;
+	const uint32_t HEIGHT = 192;
+
+	struct Scene
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+		BoundingBoxes occludees;
+		std::vector<uint32_t> allOccludees;
+	};
+
+	// Occluder quads of building-like sizes and small occludees scattered behind them.
+	Scene MakeScene(int numTriangles)
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+		std::uniform_real_distribution<float> depth(0.0f, 60.0f);
+		std::uniform_real_distribution<float> size(0.5f, 8.0f);
+
+		Scene scene;
+		for (int i = 0; i < numTriangles / 2; ++i)
+		{
+			float x = position(random), y = position(random) * 0.3f, z = depth(random);
+			float w = size(random), h = size(random);
+			uint32_t first = static_cast<uint32_t>(scene.positions.size());
+			scene.positions.push_back(XMFLOAT3(x, y, z));
+			scene.positions.push_back(XMFLOAT3(x, y + h, z));
+			scene.positions.push_back(XMFLOAT3(x + w, y + h, z));
+			scene.positions.push_back(XMFLOAT3(x + w, y, z));
+			const uint32_t quad[] = { 0, 1, 2, 0, 2, 3 };
+			for (uint32_t index : quad)
+				scene.indices.push_back(first + index);
+		}
+
+		const size_t numOccludees = 20000;
+		scene.occludees.Resize(numOccludees);
+		for (size_t i = 0; i < numOccludees; ++i)
+		{
+			scene.occludees.Set(i, XMFLOAT3(position(random), position(random) * 0.3f, depth(random) + 10.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+			scene.allOccludees.push_back(static_cast<uint32_t>(i));
+		}
+		return scene;
+	}
+
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, const Function& function)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; ++i)
+			function();
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	}
+
+	void Run(const Scene& scene, FXMMATRIX viewProjection, bool useAVX2, TaskScheduler* scheduler, int iterations)
+	{
+		MaskedOcclusionBuffer buffer;
+		buffer.Resize(WIDTH, HEIGHT);
+		buffer.SetUseAVX2(useAVX2);
+
+		const XMMATRIX matrix = viewProjection;
+		double render = MeasureMilliseconds(iterations, [&] {
+			buffer.Clear();
+			buffer.AddOccluder(scene.positions.data(), sizeof(XMFLOAT3), scene.positions.size(),
+				scene.indices.data(), scene.indices.size(), matrix, false);
+			buffer.RenderOccluders(scheduler);
+		});
+
+		std::vector<uint32_t> visible;
+		double test = MeasureMilliseconds(iterations, [&] {
+			visible = scene.allOccludees;
+			buffer.TestBoxes(scene.occludees, matrix, visible, scheduler);
+		});
+
+		std::printf("%-6s %-14s render %8.3f ms   test %8.3f ms   %zu of %zu occludees visible\n",
+			useAVX2 ? "AVX2" : "scalar", scheduler ? "multithreaded" : "single thread",
+			render, test, visible.size(), scene.allOccludees.size());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int numTriangles = argc > 1 ? std::atoi(argv[1]) : 20000;
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 2.0f, -20.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), float(WIDTH) / HEIGHT, 0.1f, 200.0f);
+	const XMMATRIX viewProjection = XMMatrixMultiply(view, projection);
+
+	const Scene scene = MakeScene(numTriangles);
+	std::printf("%d occluder triangles, %ux%u buffer, %d iterations\n", numTriangles, WIDTH, HEIGHT, iterations);
+
+	TaskScheduler scheduler;
+	for (int threaded = 0; threaded < 2; ++threaded)
+	{
+		TaskScheduler* taskScheduler = threaded ? &scheduler : nullptr;
+		Run(scene, viewProjection, false, taskScheduler, iterations);
+		if (MaskedOcclusionBuffer::IsAVX2Supported())
+			Run(scene, viewProjection, true, taskScheduler, iterations);
+	}
+	if (!MaskedOcclusionBuffer::IsAVX2Supported())
+		std::printf("AVX2 not supported on this CPU\n");
+
+	return 0;
+}
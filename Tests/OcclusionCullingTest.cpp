@@ -0,0 +1,268 @@
+#include "Test.h"
+
+#include "OcclusionCulling.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// The masked buffer is checked against a plain depth buffer rasterizer: every triangle
+//		written at its farthest depth into every pixel whose center it covers, keeping the
+//		nearest. The masked buffer may know less than that reference (it is coarse) but
+//		never more - a tile's zMax0 must be at least the farthest reference depth in it,
+//		otherwise it would cull visible objects.
+
+namespace
+{
+	const uint32_t WIDTH = 317;		// not a multiple of the tile size
+	const uint32_t HEIGHT = 189;
+
+	struct Mesh
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	XMMATRIX MakeViewProjection()
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -10.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), float(WIDTH) / HEIGHT, 0.1f, 100.0f);
+		return XMMatrixMultiply(view, projection);
+	}
+
+	// Random quads facing the camera and random triangles of both windings, some partly
+	//		off screen, all in front of the near plane.
+	// Screen position and depth, computed exactly like the occlusion buffer does.
+	XMFLOAT3 ToScreen(FXMVECTOR position, FXMMATRIX viewProjection)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(position, viewProjection));
+		float invW = 1.0f / clip.w;
+		return XMFLOAT3((clip.x * invW * 0.5f + 0.5f) * WIDTH, (0.5f - clip.y * invW * 0.5f) * HEIGHT, clip.z * invW);
+	}
+
+	Mesh MakeScene(uint32_t seed, int numQuads, int numTriangles)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-14.0f, 14.0f);
+		std::uniform_real_distribution<float> depth(-5.0f, 40.0f);
+		std::uniform_real_distribution<float> size(0.2f, 6.0f);
+
+		Mesh mesh;
+		for (int i = 0; i < numQuads; ++i)
+		{
+			float x = position(random), y = position(random), z = depth(random);
+			float w = size(random), h = size(random);
+			uint32_t first = static_cast<uint32_t>(mesh.positions.size());
+			mesh.positions.push_back(XMFLOAT3(x, y, z));
+			mesh.positions.push_back(XMFLOAT3(x, y + h, z));
+			mesh.positions.push_back(XMFLOAT3(x + w, y + h, z + 0.5f));
+			mesh.positions.push_back(XMFLOAT3(x + w, y, z + 0.5f));
+			const uint32_t quad[] = { 0, 1, 2, 0, 2, 3 };
+			for (uint32_t index : quad)
+				mesh.indices.push_back(first + index);
+		}
+		for (int i = 0; i < numTriangles; ++i)
+		{
+			float x = position(random), y = position(random), z = depth(random);
+			uint32_t first = static_cast<uint32_t>(mesh.positions.size());
+			for (int v = 0; v < 3; ++v)
+				mesh.positions.push_back(XMFLOAT3(x + size(random), y + size(random), z + size(random)));
+			for (uint32_t v = 0; v < 3; ++v)
+				mesh.indices.push_back(first + v);
+		}
+		return mesh;
+	}
+
+	// Per pixel depth, 1 where nothing was drawn.
+	std::vector<float> RasterizeReference(const Mesh& mesh, FXMMATRIX viewProjection)
+	{
+		std::vector<float> depth(size_t(WIDTH) * HEIGHT, 1.0f);
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			float x[3], y[3], zMax = 0.0f;
+			for (int v = 0; v < 3; ++v)
+			{
+				XMFLOAT3 screen = ToScreen(XMLoadFloat3(&mesh.positions[mesh.indices[i + v]]), viewProjection);
+				x[v] = screen.x;
+				y[v] = screen.y;
+				zMax = std::max(zMax, screen.z);
+			}
+
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (area == 0.0f || zMax >= 1.0f)
+				continue;
+			if (area < 0.0f)
+			{
+				std::swap(x[1], x[2]);
+				std::swap(y[1], y[2]);
+			}
+
+			for (uint32_t py = 0; py < HEIGHT; ++py)
+			{
+				for (uint32_t px = 0; px < WIDTH; ++px)
+				{
+					// Edges get a little slack: the reference covering a bit more only
+					//		makes the comparison stricter.
+					bool inside = true;
+					for (int e = 0; e < 3 && inside; ++e)
+					{
+						int next = (e + 1) % 3;
+						float a = -(y[next] - y[e]), b = x[next] - x[e];
+						float edge = a * (px + 0.5f - x[e]) + b * (py + 0.5f - y[e]);
+						inside = edge >= -1e-3f * std::sqrt(a * a + b * b);
+					}
+					float& pixel = depth[size_t(py) * WIDTH + px];
+					if (inside)
+						pixel = std::min(pixel, zMax);
+				}
+			}
+		}
+		return depth;
+	}
+
+	void Render(MaskedOcclusionBuffer& buffer, const Mesh& mesh, FXMMATRIX viewProjection, bool useAVX2, TaskScheduler* scheduler)
+	{
+		buffer.Resize(WIDTH, HEIGHT);
+		buffer.SetUseAVX2(useAVX2);
+		buffer.AddOccluder(mesh.positions.data(), sizeof(XMFLOAT3), mesh.positions.size(),
+			mesh.indices.data(), mesh.indices.size(), viewProjection, false);
+		buffer.RenderOccluders(scheduler);
+	}
+
+	// Returns the number of tiles with occlusion information.
+	int CheckConservative(const MaskedOcclusionBuffer& buffer, const std::vector<float>& reference)
+	{
+		int numOccluded = 0;
+		bool conservative = true;
+		for (uint32_t tileY = 0; tileY < buffer.GetNumTilesY(); ++tileY)
+		{
+			for (uint32_t tileX = 0; tileX < buffer.GetNumTilesX(); ++tileX)
+			{
+				float farthest = 0.0f;
+				for (uint32_t py = tileY * 8; py < std::min(HEIGHT, tileY * 8 + 8); ++py)
+				{
+					for (uint32_t px = tileX * 32; px < std::min(WIDTH, tileX * 32 + 32); ++px)
+						farthest = std::max(farthest, reference[size_t(py) * WIDTH + px]);
+				}
+				float zMax0 = buffer.GetTiles()[tileY * buffer.GetNumTilesX() + tileX].zMax0;
+				conservative = conservative && zMax0 >= farthest;
+				numOccluded += zMax0 < 1.0f ? 1 : 0;
+			}
+		}
+		CHECK(conservative);
+		return numOccluded;
+	}
+
+	bool TilesEqual(const MaskedOcclusionBuffer& a, const MaskedOcclusionBuffer& b)
+	{
+		size_t numTiles = size_t(a.GetNumTilesX()) * a.GetNumTilesY();
+		return std::memcmp(a.GetTiles(), b.GetTiles(), numTiles * sizeof(MaskedOcclusionBuffer::Tile)) == 0;
+	}
+
+	// A box reported hidden must be behind the reference depth in its whole screen rect.
+	void CheckOccludees(const MaskedOcclusionBuffer& buffer, const std::vector<float>& reference, FXMMATRIX viewProjection)
+	{
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> position(-12.0f, 12.0f);
+		std::uniform_real_distribution<float> depth(-8.0f, 60.0f);
+		std::uniform_real_distribution<float> size(0.05f, 3.0f);
+
+		int numHidden = 0;
+		bool hiddenCorrectly = true;
+		for (int i = 0; i < 2000; ++i)
+		{
+			XMFLOAT3 boxMin(position(random), position(random), depth(random));
+			XMFLOAT3 boxMax(boxMin.x + size(random), boxMin.y + size(random), boxMin.z + size(random));
+			if (buffer.IsVisible(boxMin, boxMax, viewProjection))
+				continue;
+			++numHidden;
+
+			float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, zMin = 1e30f;
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				XMVECTOR p = XMVectorSet(corner & 1 ? boxMax.x : boxMin.x, corner & 2 ? boxMax.y : boxMin.y, corner & 4 ? boxMax.z : boxMin.z, 1.0f);
+				XMFLOAT3 screen = ToScreen(p, viewProjection);
+				minX = std::min(minX, screen.x); maxX = std::max(maxX, screen.x);
+				minY = std::min(minY, screen.y); maxY = std::max(maxY, screen.y);
+				zMin = std::min(zMin, screen.z);
+			}
+			int x0 = std::max(0, int(std::floor(minX))), x1 = std::min(int(WIDTH) - 1, int(std::floor(maxX)));
+			int y0 = std::max(0, int(std::floor(minY))), y1 = std::min(int(HEIGHT) - 1, int(std::floor(maxY)));
+			for (int py = y0; py <= y1; ++py)
+			{
+				for (int px = x0; px <= x1; ++px)
+					hiddenCorrectly = hiddenCorrectly && reference[size_t(py) * WIDTH + px] <= zMin;
+			}
+		}
+		CHECK(hiddenCorrectly);
+		CHECK(numHidden > 0);
+	}
+
+	void TestRandomScenes(TaskScheduler& scheduler)
+	{
+		const XMMATRIX viewProjection = MakeViewProjection();
+		for (uint32_t seed = 1; seed <= 8; ++seed)
+		{
+			const Mesh mesh = MakeScene(seed, 40 * seed, 100 * seed);
+			const std::vector<float> reference = RasterizeReference(mesh, viewProjection);
+
+			MaskedOcclusionBuffer scalar;
+			Render(scalar, mesh, viewProjection, false, seed % 2 ? &scheduler : nullptr);
+			CHECK(!scalar.GetUseAVX2());
+			CHECK(CheckConservative(scalar, reference) > 0);
+			CheckOccludees(scalar, reference, viewProjection);
+
+			if (MaskedOcclusionBuffer::IsAVX2Supported())
+			{
+				MaskedOcclusionBuffer avx2;
+				Render(avx2, mesh, viewProjection, true, seed % 2 ? nullptr : &scheduler);
+				CHECK(avx2.GetUseAVX2());
+				CHECK(TilesEqual(scalar, avx2));
+			}
+		}
+		if (!MaskedOcclusionBuffer::IsAVX2Supported())
+			std::printf("OcclusionCulling: AVX2 not supported, AVX2 kernel not tested\n");
+	}
+
+	// A wall in front of the whole screen: every tile gets the wall's depth, things
+	//		behind it are hidden, things in front of it and beside it are not.
+	void TestWall(bool useAVX2)
+	{
+		const XMMATRIX viewProjection = MakeViewProjection();
+		Mesh wall;
+		wall.positions = { XMFLOAT3(-50, -50, 5), XMFLOAT3(-50, 50, 5), XMFLOAT3(50, 50, 5), XMFLOAT3(50, -50, 5) };
+		wall.indices = { 0, 1, 2, 0, 2, 3 };
+
+		MaskedOcclusionBuffer buffer;
+		Render(buffer, wall, viewProjection, useAVX2, nullptr);
+
+		const float wallDepth = ToScreen(XMVectorSet(0, 0, 5, 1), viewProjection).z;
+		bool allTiles = true;
+		for (uint32_t i = 0; i < buffer.GetNumTilesX() * buffer.GetNumTilesY(); ++i)
+			allTiles = allTiles && std::fabs(buffer.GetTiles()[i].zMax0 - wallDepth) < 1e-6f;
+		CHECK(allTiles);
+
+		CHECK(!buffer.IsVisible(XMFLOAT3(-1, -1, 6), XMFLOAT3(1, 1, 8), viewProjection));
+		CHECK(buffer.IsVisible(XMFLOAT3(-1, -1, 2), XMFLOAT3(1, 1, 3), viewProjection));
+		CHECK(buffer.IsVisible(XMFLOAT3(-1, -1, 3), XMFLOAT3(1, 1, 7), viewProjection));
+		CHECK(buffer.IsVisible(XMFLOAT3(-1, -1, -20), XMFLOAT3(1, 1, 8), viewProjection));	// crosses the near plane
+	}
+}
+
+int main()
+{
+	TaskScheduler scheduler(3);
+	TestWall(false);
+	if (MaskedOcclusionBuffer::IsAVX2Supported())
+		TestWall(true);
+	TestRandomScenes(scheduler);
+
+	return Test::Result("OcclusionCulling");
+}
@@ -0,0 +1,133 @@
+// Pack file throughput across compression levels and thread counts. Not a test (timings
+//		depend on the machine and the disk); run it by hand:
+//
+//		PackFileBenchmark [megabytes] [maxThreads]
+//
+// Writes a pack of game-like data (text, vertex data, a little noise) with every LZ4 level
+//		worth listing - and zstd when it is built in - on 1, 2, 4, ... maxThreads threads,
+//		then reads it back the same way. MB/s are of uncompressed data; the file stays in
+//		the page cache, so the read column is decompression speed rather than disk speed.
+#include "PackFile.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using Bytes = std::vector<uint8_t>;
+	const char* const PACK_PATH = "PackFileBenchmark.pak";
+	const size_t ENTRY_SIZE = 4 * 1024 * 1024;
+
+	// Per 4 MB entry: half words, a third float vertex data, the rest random bytes.
+	std::vector<Bytes> MakeEntries(size_t totalSize)
+	{
+		std::mt19937 random(68);
+		std::vector<Bytes> entries;
+		const char words[] = "mesh texture material shader pipeline vertex index buffer ";
+		for (size_t offset = 0; offset < totalSize; offset += ENTRY_SIZE)
+		{
+			Bytes data(ENTRY_SIZE);
+			const size_t textEnd = ENTRY_SIZE / 2, floatEnd = textEnd + ENTRY_SIZE / 3 / 4 * 4;
+			for (size_t i = 0; i < textEnd; ++i)
+				data[i] = random() % 16 == 0 ? uint8_t(random()) : uint8_t(words[i % (sizeof(words) - 1)]);
+			for (size_t i = textEnd; i < floatEnd; i += 4)
+			{
+				const float value = std::sin(float(i) * 0.001f) * 10.0f;
+				std::memcpy(&data[i], &value, 4);
+			}
+			for (size_t i = floatEnd; i < ENTRY_SIZE; ++i)
+				data[i] = uint8_t(random());
+			entries.push_back(std::move(data));
+		}
+		return entries;
+	}
+
+	double Seconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t megabytes = argc > 1 ? size_t(std::atol(argv[1])) : 64;
+	const unsigned maxThreads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+
+	const std::vector<Bytes> entries = MakeEntries(megabytes * 1024 * 1024);
+	const double totalMB = double(entries.size() * ENTRY_SIZE) / (1024.0 * 1024.0);
+
+	struct Setting
+	{
+		CompressionMethod method;
+		int level;
+	};
+	std::vector<Setting> settings = { { CompressionMethod::LZ4, LZ4_LEVEL_FAST }, { CompressionMethod::LZ4, 4 },
+		{ CompressionMethod::LZ4, 8 }, { CompressionMethod::LZ4, LZ4_LEVEL_MAX } };
+	if (IsCompressionSupported(CompressionMethod::Zstd))
+	{
+		settings.push_back({ CompressionMethod::Zstd, 1 });
+		settings.push_back({ CompressionMethod::Zstd, ZSTD_LEVEL_DEFAULT });
+		settings.push_back({ CompressionMethod::Zstd, 9 });
+		settings.push_back({ CompressionMethod::Zstd, 19 });
+	}
+	else
+	{
+		std::printf("zstd not built in (DX12FW_WITH_ZSTD) - LZ4 only\n");
+	}
+
+	std::printf("%.0f MB in %zu entries\n\n", totalMB, entries.size());
+	std::printf("method level threads   ratio   write MB/s   read MB/s\n");
+
+	Bytes readBack(ENTRY_SIZE);
+	for (const Setting& setting : settings)
+	{
+		for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			// The calling thread works too: "threads - 1" workers, no scheduler for 1.
+			std::unique_ptr<TaskScheduler> scheduler;
+			if (threads > 1)
+				scheduler.reset(new TaskScheduler(threads - 1));
+
+			PackFileWriter writer;
+			for (size_t i = 0; i < entries.size(); ++i)
+				writer.AddEntry("entry" + std::to_string(i), entries[i].data(), entries[i].size(), setting.method, setting.level);
+			auto start = std::chrono::high_resolution_clock::now();
+			if (!writer.Write(PACK_PATH, scheduler.get()))
+			{
+				std::printf("can't write %s\n", PACK_PATH);
+				return 1;
+			}
+			const double writeSeconds = Seconds(start);
+
+			PackFileReader reader;
+			if (!reader.Open(PACK_PATH))
+			{
+				std::printf("can't open %s\n", PACK_PATH);
+				return 1;
+			}
+			start = std::chrono::high_resolution_clock::now();
+			bool correct = true;
+			for (uint32_t i = 0; i < reader.GetEntryCount(); ++i)
+				correct = reader.ReadEntry(reader.GetEntry(i), readBack.data(), scheduler.get()) && correct;
+			const double readSeconds = Seconds(start);
+			reader.Close();
+
+			std::printf("%-6s %5d %7u  %6.3f  %11.1f  %10.1f%s\n", setting.method == CompressionMethod::LZ4 ? "LZ4" : "zstd",
+				setting.level, threads, double(writer.GetCompressedSize()) / writer.GetUncompressedSize(),
+				totalMB / writeSeconds, totalMB / readSeconds, correct ? "" : "  READ FAILED");
+		}
+	}
+
+	std::remove(PACK_PATH);
+	return 0;
+}
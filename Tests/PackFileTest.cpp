@@ -0,0 +1,247 @@
+#include "Test.h"
+
+#include "PackFile.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Bytes = std::vector<uint8_t>;
+
+	const char* const PACK_PATH = "PackFileTest.pak";
+	const char* const DAMAGED_PATH = "PackFileTest.damaged.pak";
+
+	struct TestEntry
+	{
+		std::string name;
+		Bytes data;
+		CompressionMethod compression;
+	};
+
+	Bytes ReadFile(const char* path)
+	{
+		Bytes data;
+		if (FILE* file = std::fopen(path, "rb"))
+		{
+			uint8_t buffer[4096];
+			size_t read;
+			while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+				data.insert(data.end(), buffer, buffer + read);
+			std::fclose(file);
+		}
+		return data;
+	}
+
+	void WriteFile(const char* path, const Bytes& data)
+	{
+		FILE* file = std::fopen(path, "wb");
+		CHECK(file != nullptr);
+		if (!file)
+			return;
+		CHECK(data.empty() || std::fwrite(data.data(), 1, data.size(), file) == data.size());
+		std::fclose(file);
+	}
+
+	// Sizes around the block size (empty, one block exactly, one byte more), data that
+	//		compresses and data that doesn't (stored blocks), and enough small entries to
+	//		give the name hash table collisions to probe through.
+	std::vector<TestEntry> MakeEntries()
+	{
+		std::mt19937 random(7);
+		std::vector<TestEntry> entries;
+
+		auto text = [&random](size_t size) {
+			const char words[] = "mesh texture material shader pipeline vertex index buffer ";
+			Bytes data(size);
+			for (size_t i = 0; i < size; ++i)
+				data[i] = random() % 16 == 0 ? uint8_t(random()) : uint8_t(words[i % (sizeof(words) - 1)]);
+			return data;
+		};
+		auto noise = [&random](size_t size) {
+			Bytes data(size);
+			for (uint8_t& b : data)
+				b = uint8_t(random());
+			return data;
+		};
+
+		entries.push_back({ "Meshes\\Empty.mesh", Bytes(), CompressionMethod::LZ4 });
+		entries.push_back({ "Meshes\\Cube.mesh", text(1000), CompressionMethod::LZ4 });
+		entries.push_back({ "Textures/OneBlock.tex", text(PACK_BLOCK_SIZE), CompressionMethod::LZ4 });
+		entries.push_back({ "Textures/OneBlockAndAByte.tex", text(PACK_BLOCK_SIZE + 1), CompressionMethod::LZ4 });
+		entries.push_back({ "Textures/Noise.tex", noise(3 * PACK_BLOCK_SIZE + 123), CompressionMethod::LZ4 });
+		entries.push_back({ "Levels/Big.level", text(37 * PACK_BLOCK_SIZE / 2), CompressionMethod::LZ4 });
+		entries.push_back({ "Levels/Stored.level", text(2 * PACK_BLOCK_SIZE + 5), CompressionMethod::None });
+		if (IsCompressionSupported(CompressionMethod::Zstd))
+			entries.push_back({ "Levels/Zstd.level", text(5 * PACK_BLOCK_SIZE), CompressionMethod::Zstd });
+		for (int i = 0; i < 300; ++i)
+			entries.push_back({ "Small/" + std::to_string(i), text(random() % 200), CompressionMethod::LZ4 });
+		return entries;
+	}
+
+	bool WritePack(const std::vector<TestEntry>& entries, TaskScheduler* scheduler)
+	{
+		PackFileWriter writer;
+		for (const TestEntry& entry : entries)
+		{
+			const int level = entry.compression == CompressionMethod::Zstd ? ZSTD_LEVEL_DEFAULT : 4;
+			CHECK(writer.AddEntry(entry.name, entry.data.data(), entry.data.size(), entry.compression, level));
+		}
+		// Same name after normalization.
+		CHECK(!writer.AddEntry("./meshes/cube.MESH", "x", 1));
+		if (!writer.Write(PACK_PATH, scheduler))
+			return false;
+		CHECK(writer.GetCompressedSize() < writer.GetUncompressedSize());
+		return true;
+	}
+
+	void TestNames()
+	{
+		CHECK(NormalizePackName("Meshes\\Cube.MESH") == "meshes/cube.mesh");
+		CHECK(NormalizePackName("././/Meshes/cube.mesh") == "meshes/cube.mesh");
+		CHECK(NormalizePackName("meshes/./cube.mesh") == "meshes/./cube.mesh");
+		CHECK(NormalizePackName("") == "");
+	}
+
+	// Every entry found by any spelling of its name, read whole (serially and spread over
+	//		workers) and block by block.
+	void TestRead(const std::vector<TestEntry>& entries, TaskScheduler& scheduler)
+	{
+		PackFileReader reader;
+		CHECK(reader.Open(PACK_PATH));
+		if (!reader.IsOpen())
+			return;
+		CHECK(reader.GetEntryCount() == entries.size());
+		CHECK(reader.FindEntry("meshes/missing.mesh") == nullptr);
+		CHECK(reader.FindEntry("") == nullptr);
+
+		for (const TestEntry& expected : entries)
+		{
+			const PackEntry* entry = reader.FindEntry(expected.name);
+			CHECK(entry != nullptr);
+			if (!entry)
+				continue;
+			CHECK(reader.FindEntry("/" + expected.name) == entry);
+			CHECK(reader.GetEntryName(*entry) == NormalizePackName(expected.name));
+			CHECK(entry->size == expected.data.size());
+			CHECK(entry->compression == expected.compression);
+			CHECK(entry->blockCount == (expected.data.size() + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE);
+
+			Bytes serial(expected.data.size(), 0xCD), parallel(expected.data.size(), 0xCD);
+			CHECK(reader.ReadEntry(*entry, serial.data()));
+			CHECK(reader.ReadEntry(*entry, parallel.data(), &scheduler));
+			CHECK(serial == expected.data);
+			CHECK(parallel == expected.data);
+
+			// Streaming: each block alone, then every range starting at block 1.
+			for (uint32_t block = 0; block < entry->blockCount; ++block)
+			{
+				const size_t start = size_t(block) * PACK_BLOCK_SIZE;
+				const size_t size = std::min<size_t>(PACK_BLOCK_SIZE, expected.data.size() - start);
+				Bytes out(size + 16, 0xCD);
+				CHECK(reader.ReadBlocks(*entry, block, 1, out.data()));
+				CHECK(std::memcmp(out.data(), expected.data.data() + start, size) == 0);
+				CHECK(out[size] == 0xCD);
+			}
+			for (uint32_t count = 1; entry->blockCount > 1 && count < entry->blockCount; ++count)
+			{
+				const size_t start = PACK_BLOCK_SIZE;
+				const size_t size = std::min<size_t>(size_t(count) * PACK_BLOCK_SIZE, expected.data.size() - start);
+				Bytes out(size);
+				CHECK(reader.ReadBlocks(*entry, 1, count, out.data()));
+				CHECK(std::memcmp(out.data(), expected.data.data() + start, size) == 0);
+			}
+			CHECK(!reader.ReadBlocks(*entry, entry->blockCount, 1, serial.data()));
+			CHECK(!reader.ReadBlocks(*entry, 0, entry->blockCount + 1, serial.data()));
+		}
+
+		reader.Close();
+		CHECK(!reader.IsOpen());
+		CHECK(reader.FindEntry(entries[1].name) == nullptr);
+	}
+
+	// A damaged header or table of contents fails Open(), so does a file cut short.
+	//		Damaged block data is only noticed by the codec: reading it may fail or return
+	//		garbage, but must not crash.
+	void TestDamaged(const std::vector<TestEntry>& entries, TaskScheduler& scheduler)
+	{
+		const Bytes pack = ReadFile(PACK_PATH);
+		CHECK(pack.size() > sizeof(PackHeader));
+		if (pack.size() <= sizeof(PackHeader))
+			return;
+		PackHeader header;
+		std::memcpy(&header, pack.data(), sizeof(header));
+		CHECK(header.magic == PACK_MAGIC && header.version == PACK_VERSION);
+		CHECK(header.tocOffset + header.tocSize == pack.size());
+
+		PackFileReader reader;
+		CHECK(!reader.Open("PackFileTest.missing.pak"));
+
+		Bytes damaged = pack;
+		damaged[0] ^= 1;
+		WriteFile(DAMAGED_PATH, damaged);
+		CHECK(!reader.Open(DAMAGED_PATH));
+
+		damaged = pack;
+		damaged[4] ^= 1;
+		WriteFile(DAMAGED_PATH, damaged);
+		CHECK(!reader.Open(DAMAGED_PATH));
+
+		for (uint64_t offset : { header.tocOffset, header.tocOffset + header.tocSize / 2, uint64_t(pack.size() - 1) })
+		{
+			damaged = pack;
+			damaged[size_t(offset)] ^= 0x10;
+			WriteFile(DAMAGED_PATH, damaged);
+			CHECK(!reader.Open(DAMAGED_PATH));
+		}
+
+		for (size_t size : { size_t(0), sizeof(PackHeader) - 1, sizeof(PackHeader), size_t(header.tocOffset), pack.size() - 1 })
+		{
+			WriteFile(DAMAGED_PATH, Bytes(pack.begin(), pack.begin() + size));
+			CHECK(!reader.Open(DAMAGED_PATH));
+		}
+
+		std::mt19937 random(11);
+		for (int i = 0; i < 50; ++i)
+		{
+			damaged = pack;
+			damaged[sizeof(PackHeader) + random() % (header.tocOffset - sizeof(PackHeader))] ^= uint8_t(1u << (random() % 8));
+			WriteFile(DAMAGED_PATH, damaged);
+			CHECK(reader.Open(DAMAGED_PATH));
+			for (const TestEntry& expected : entries)
+			{
+				const PackEntry* entry = reader.FindEntry(expected.name);
+				if (!entry || entry->blockCount == 0)
+					continue;
+				Bytes out(expected.data.size() + 16, 0xCD);
+				reader.ReadEntry(*entry, out.data(), &scheduler);
+				CHECK(out[expected.data.size()] == 0xCD);
+			}
+		}
+		reader.Close();
+		std::remove(DAMAGED_PATH);
+	}
+}
+
+int main()
+{
+	TestNames();
+
+	TaskScheduler scheduler(3);
+	const std::vector<TestEntry> entries = MakeEntries();
+	for (int parallel = 0; parallel < 2; ++parallel)
+	{
+		CHECK(WritePack(entries, parallel ? &scheduler : nullptr));
+		TestRead(entries, scheduler);
+	}
+	TestDamaged(entries, scheduler);
+	std::remove(PACK_PATH);
+
+	return Test::Result("PackFile");
+}
@@ -0,0 +1,99 @@
+// Timing of the scene hierarchy update, incremental against full, for different shares of
+//		nodes changed per frame. Not a test (timings depend on the machine); run it by hand:
+//
+//		SceneHierarchyBenchmark [numNodes] [threads]
+//
+// The scene is a forest of small trees (a root, a few children each, 5 levels deep) -
+//		like props, characters and their attachments. A changed node drags its whole
+//		subtree along, so the share of updated matrices is higher than the share of changes.
+#include "SceneHierarchy.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Best of "iterations" runs of setup() + function(), timing function() only, in ms.
+	template<typename Setup, typename Function>
+	double MeasureMilliseconds(int iterations, Setup setup, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			setup();
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t numNodes = argc > 1 ? size_t(std::atol(argv[1])) : 1000000;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	const int iterations = 10;
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+
+	std::mt19937 random(55);
+	SceneHierarchy hierarchy;
+	std::vector<NodeId> nodes;
+	nodes.reserve(numNodes);
+	std::vector<NodeId> level;
+	while (nodes.size() < numNodes)
+	{
+		// One tree: 1 root, 3 children per node for 4 levels (121 nodes), cut at numNodes.
+		level.assign(1, hierarchy.AddNode(INVALID_NODE, XMMatrixTranslation(float(random() % 1000), 0.0f, float(random() % 1000))));
+		nodes.push_back(level[0]);
+		for (int depth = 1; depth < 5 && nodes.size() < numNodes; ++depth)
+		{
+			std::vector<NodeId> next;
+			for (NodeId parent : level)
+			{
+				for (int child = 0; child < 3 && nodes.size() < numNodes; ++child)
+				{
+					next.push_back(hierarchy.AddNode(parent, XMMatrixTranslation(1.0f, 0.5f, float(child))));
+					nodes.push_back(next.back());
+				}
+			}
+			level.swap(next);
+		}
+	}
+	hierarchy.Update();
+
+	std::printf("%zu nodes, %zu levels, %u thread(s), best of %d\n\n", hierarchy.GetNodeCount(), hierarchy.GetLevelCount(), threads, iterations);
+	std::printf("changed   updated    Update ms  parallel ms   UpdateAll ms  parallel ms\n");
+
+	const double changeRates[] = { 0.0, 0.0001, 0.001, 0.01, 0.1, 0.5, 1.0 };
+	for (double rate : changeRates)
+	{
+		const size_t numChanges = size_t(rate * numNodes);
+		std::vector<NodeId> changed(numChanges);
+		for (NodeId& node : changed)
+			node = nodes[random() % nodes.size()];
+		auto change = [&]() {
+			for (NodeId node : changed)
+				hierarchy.SetLocalTransform(node, XMMatrixTranslation(1.0f, 0.5f, 0.25f));
+		};
+
+		const double incrementalMs = MeasureMilliseconds(iterations, change, [&]() { hierarchy.Update(); });
+		const size_t numUpdated = hierarchy.GetNumUpdatedLastFrame();
+		const double parallelMs = MeasureMilliseconds(iterations, change, [&]() { hierarchy.Update(&scheduler); });
+		const double fullMs = MeasureMilliseconds(iterations, change, [&]() { hierarchy.UpdateAll(); });
+		const double fullParallelMs = MeasureMilliseconds(iterations, change, [&]() { hierarchy.UpdateAll(&scheduler); });
+
+		std::printf("%6.2f%%  %7.2f%%  %11.3f  %11.3f  %13.3f  %11.3f\n", rate * 100.0, 100.0 * numUpdated / numNodes,
+			incrementalMs, parallelMs, fullMs, fullParallelMs);
+	}
+	return 0;
+}
@@ -0,0 +1,214 @@
+#include "Test.h"
+
+#include "SceneHierarchy.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace DirectX;
+
+// Randomized adds, subtree removes and SetLocalTransform calls against a plain recursive
+//		reference (world = local * world of the parent, computed from the root every
+//		time), over 20 update rounds. The hierarchy does the same multiplies in the same
+//		order, so the world matrices must match exactly - and the incremental Update()
+//		must recompute exactly the nodes that changed or have a changed ancestor.
+
+namespace
+{
+	struct ReferenceNode
+	{
+		NodeId parent;
+		XMFLOAT4X4 local;
+	};
+
+	typedef std::map<NodeId, ReferenceNode> Reference;
+
+	XMMATRIX MakeLocalTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+		return XMMatrixMultiply(XMMatrixMultiply(XMMatrixScaling(scale(random), scale(random), scale(random)),
+			XMMatrixRotationAxis(XMVectorSet(0.3f, 1.0f, 0.2f, 0.0f), angle(random))),
+			XMMatrixTranslation(position(random), position(random), position(random)));
+	}
+
+	XMMATRIX ReferenceWorld(const Reference& reference, NodeId node)
+	{
+		const ReferenceNode& entry = reference.at(node);
+		XMMATRIX local = XMLoadFloat4x4(&entry.local);
+		if (entry.parent == INVALID_NODE)
+			return local;
+		return XMMatrixMultiply(local, ReferenceWorld(reference, entry.parent));
+	}
+
+	bool IsTouched(const Reference& reference, const std::set<NodeId>& touched, NodeId node)
+	{
+		for (; node != INVALID_NODE; node = reference.at(node).parent)
+		{
+			if (touched.count(node))
+				return true;
+		}
+		return false;
+	}
+
+	size_t GetDepth(const Reference& reference, NodeId node)
+	{
+		size_t depth = 0;
+		for (node = reference.at(node).parent; node != INVALID_NODE; node = reference.at(node).parent)
+			++depth;
+		return depth;
+	}
+
+	void CheckHierarchy(const SceneHierarchy& hierarchy, const Reference& reference)
+	{
+		CHECK(hierarchy.GetNodeCount() == reference.size());
+
+		bool correct = true;
+		size_t maxDepth = 0;
+		for (const auto& entry : reference)
+		{
+			correct = correct && hierarchy.IsValid(entry.first) && hierarchy.GetParent(entry.first) == entry.second.parent;
+
+			XMFLOAT4X4 world, expected, local;
+			XMStoreFloat4x4(&world, hierarchy.GetWorldMatrix(entry.first));
+			XMStoreFloat4x4(&expected, ReferenceWorld(reference, entry.first));
+			XMStoreFloat4x4(&local, hierarchy.GetLocalTransform(entry.first));
+			correct = correct && std::memcmp(&world, &expected, sizeof(world)) == 0;
+			correct = correct && std::memcmp(&local, &entry.second.local, sizeof(local)) == 0;
+			maxDepth = std::max(maxDepth, GetDepth(reference, entry.first));
+		}
+		CHECK(correct);
+		CHECK(hierarchy.GetLevelCount() == (reference.empty() ? 0 : maxDepth + 1));
+	}
+
+	void RemoveSubtree(Reference& reference, NodeId node)
+	{
+		std::vector<NodeId> children;
+		for (const auto& entry : reference)
+		{
+			if (entry.second.parent == node)
+				children.push_back(entry.first);
+		}
+		for (NodeId child : children)
+			RemoveSubtree(reference, child);
+		reference.erase(node);
+	}
+
+	NodeId PickNode(std::mt19937& random, const Reference& reference)
+	{
+		auto it = reference.begin();
+		std::advance(it, random() % reference.size());
+		return it->first;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(55);
+	TaskScheduler scheduler(3);
+
+	SceneHierarchy hierarchy;
+	Reference reference;
+
+	for (int round = 0; round < 20; ++round)
+	{
+		std::set<NodeId> touched;
+
+		// Grow: new roots and children of random (also brand new) nodes - deep chains too.
+		const int numAdds = round % 5 == 4 ? 0 : 50 + int(random() % 400);
+		for (int i = 0; i < numAdds; ++i)
+		{
+			NodeId parent = reference.empty() || random() % 10 == 0 ? INVALID_NODE : PickNode(random, reference);
+			XMMATRIX local = MakeLocalTransform(random);
+			NodeId node = hierarchy.AddNode(parent, local);
+			CHECK(reference.count(node) == 0);
+
+			ReferenceNode entry;
+			entry.parent = parent;
+			XMStoreFloat4x4(&entry.local, local);
+			reference[node] = entry;
+			touched.insert(node);
+		}
+
+		// Change some, before and after the removes.
+		const int numChanges = round % 7 == 6 ? 0 : int(random() % 40);
+		for (int i = 0; i < numChanges && !reference.empty(); ++i)
+		{
+			NodeId node = PickNode(random, reference);
+			XMMATRIX local = MakeLocalTransform(random);
+			hierarchy.SetLocalTransform(node, local);
+			XMStoreFloat4x4(&reference[node].local, local);
+			touched.insert(node);
+		}
+
+		const int numRemoves = int(random() % 6);
+		for (int i = 0; i < numRemoves && !reference.empty(); ++i)
+		{
+			NodeId node = PickNode(random, reference);
+			hierarchy.RemoveNode(node);
+			RemoveSubtree(reference, node);
+			CHECK(!hierarchy.IsValid(node));
+		}
+		// Removing an id that is gone does nothing.
+		hierarchy.RemoveNode(NodeId(1000000));
+
+		for (int i = 0; i < numChanges / 2 && !reference.empty(); ++i)
+		{
+			NodeId node = PickNode(random, reference);
+			XMMATRIX local = MakeLocalTransform(random);
+			hierarchy.SetLocalTransform(node, local);
+			XMStoreFloat4x4(&reference[node].local, local);
+			touched.insert(node);
+		}
+
+		// Removed nodes may still be in "touched" - IsTouched only walks live ones.
+		size_t expectedUpdates = 0;
+		for (const auto& entry : reference)
+			expectedUpdates += IsTouched(reference, touched, entry.first);
+
+		// Serial, parallel with every level split, parallel above the default threshold.
+		if (round % 3 == 0)
+			hierarchy.Update();
+		else if (round % 3 == 1)
+			hierarchy.Update(&scheduler, 1);
+		else
+			hierarchy.Update(&scheduler);
+		CHECK(hierarchy.GetNumUpdatedLastFrame() == expectedUpdates);
+		CheckHierarchy(hierarchy, reference);
+
+		// Nothing changed since: nothing to do.
+		hierarchy.Update();
+		CHECK(hierarchy.GetNumUpdatedLastFrame() == 0);
+
+		// The full update gives the same matrices.
+		hierarchy.UpdateAll(round % 2 ? &scheduler : nullptr);
+		CHECK(hierarchy.GetNumUpdatedLastFrame() == reference.size());
+		CheckHierarchy(hierarchy, reference);
+	}
+
+	// Everything goes, then the hierarchy is usable again.
+	while (!reference.empty())
+	{
+		NodeId node = PickNode(random, reference);
+		hierarchy.RemoveNode(node);
+		RemoveSubtree(reference, node);
+	}
+	hierarchy.Update();
+	CheckHierarchy(hierarchy, reference);
+	NodeId root = hierarchy.AddNode(INVALID_NODE, XMMatrixTranslation(1.0f, 2.0f, 3.0f));
+	NodeId child = hierarchy.AddNode(root, XMMatrixTranslation(1.0f, 0.0f, 0.0f));
+	hierarchy.Update();
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, hierarchy.GetWorldMatrix(child));
+	CHECK(world.m[3][0] == 2.0f && world.m[3][1] == 2.0f && world.m[3][2] == 3.0f);
+
+	return Test::Result("SceneHierarchy");
+}
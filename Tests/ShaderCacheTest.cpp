@@ -0,0 +1,264 @@
+#include "Test.h"
+
+#include "ShaderCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The cache key of a shader with a small include tree, written to a scratch directory:
+//
+//		main.hlsl				includes "common.hlsli" and <lib.hlsli>, mentions more
+//		|						includes in comments and in the middle of a line
+//		common.hlsli			includes "nested/deep.hlsli" and "shared.hlsli" (only in
+//		|						the include directory) and "missing.hlsli" (nowhere)
+//		nested/deep.hlsli		includes "sibling.hlsli" (next to it) and "../common.hlsli"
+//		include/lib.hlsli		(a cycle)
+//		include/shared.hlsli
+//
+// Editing any file that is really included changes the key, and undoing the edit brings
+//		the old key back; editing or creating files that are only named in comments, or
+//		that the search order doesn't reach, leaves it alone. No compiler is needed for
+//		the key - without one GetShader() loads the build's .cso file, which is checked too.
+namespace
+{
+	const std::string ROOT = "ShaderCacheTest.shaders";
+	const std::string MAIN = ROOT + "/main.hlsl";
+
+	std::vector<std::string> g_Files;
+
+	void MakeDirectory(const std::string& path)
+	{
+#if defined(_WIN32)
+		_mkdir(path.c_str());
+#else
+		::mkdir(path.c_str(), 0755);
+#endif
+	}
+
+	void RemoveDirectory(const std::string& path)
+	{
+#if defined(_WIN32)
+		_rmdir(path.c_str());
+#else
+		::rmdir(path.c_str());
+#endif
+	}
+
+	void WriteText(const std::string& path, const std::string& text)
+	{
+		FILE* file = std::fopen(path.c_str(), "wb");
+		CHECK(file != nullptr);
+		if (!file)
+			return;
+		CHECK(std::fwrite(text.data(), 1, text.size(), file) == text.size());
+		std::fclose(file);
+		g_Files.push_back(path);
+	}
+
+	const char* const MAIN_SOURCE =
+		"// #include \"commented.hlsli\"\n"
+		"/* #include \"block.hlsli\"\n"
+		"#include \"block2.hlsli\" */\n"
+		"// a /* in a line comment opens nothing\n"
+		"#include \"common.hlsli\"\r\n"
+		"  #  include   <lib.hlsli>\n"
+		"float4 main() : SV_Target { return Shade(); } // #include \"trailing.hlsli\"\n"
+		"static const float x = 1; #include \"midline.hlsli\"\n"
+		"/**/#include \"afterComment.hlsli\"\n"
+		"/* unterminated #include \"unterminated.hlsli\"";
+
+	const char* const COMMON_SOURCE =
+		"#pragma once\n"
+		"#include \"nested/deep.hlsli\"\n"
+		"#include \"shared.hlsli\"\n"
+		"#include \"missing.hlsli\"\n"
+		"float4 Shade() { return Deep(); }\n";
+
+	const char* const DEEP_SOURCE =
+		"#pragma once\n"
+		"#include \"sibling.hlsli\"\n"
+		"#include \"../common.hlsli\"\n"
+		"float4 Deep() { return 1; }\n";
+
+	void WriteTree()
+	{
+		MakeDirectory(ROOT);
+		MakeDirectory(ROOT + "/nested");
+		MakeDirectory(ROOT + "/include");
+		WriteText(MAIN, MAIN_SOURCE);
+		WriteText(ROOT + "/common.hlsli", COMMON_SOURCE);
+		WriteText(ROOT + "/nested/deep.hlsli", DEEP_SOURCE);
+		WriteText(ROOT + "/nested/sibling.hlsli", "// sibling\n");
+		WriteText(ROOT + "/include/lib.hlsli", "// lib\n");
+		WriteText(ROOT + "/include/shared.hlsli", "// shared\n");
+	}
+
+	void RemoveTree()
+	{
+		for (const std::string& path : g_Files)
+			std::remove(path.c_str());
+		RemoveDirectory(ROOT + "/nested");
+		RemoveDirectory(ROOT + "/include");
+		RemoveDirectory(ROOT);
+	}
+
+	uint64_t Key(const ShaderCache& cache, const ShaderDesc& desc)
+	{
+		uint64_t key = 0;
+		CHECK(cache.ComputeKey(desc, key));
+		return key;
+	}
+
+	void TestIncludes(const ShaderCache& cache)
+	{
+		ShaderDesc desc;
+		desc.path = MAIN;
+		desc.stage = ShaderStage::Pixel;
+
+		uint64_t key = 0;
+		std::vector<uint8_t> source;
+		CHECK(cache.ComputeKey(desc, key, &source) && std::string(source.begin(), source.end()) == MAIN_SOURCE);
+		CHECK(Key(cache, desc) == key);
+
+		// Files the key depends on: an edit changes it, undoing the edit restores it.
+		struct Edit
+		{
+			std::string path;
+			std::string original;
+		};
+		const Edit included[] =
+		{
+			{ MAIN, MAIN_SOURCE },
+			{ ROOT + "/common.hlsli", COMMON_SOURCE },
+			{ ROOT + "/nested/deep.hlsli", DEEP_SOURCE },
+			{ ROOT + "/nested/sibling.hlsli", "// sibling\n" },
+			{ ROOT + "/include/lib.hlsli", "// lib\n" },
+			{ ROOT + "/include/shared.hlsli", "// shared\n" },
+		};
+		for (const Edit& edit : included)
+		{
+			WriteText(edit.path, edit.original + "// edited\n");
+			const bool changed = Key(cache, desc) != key;
+			WriteText(edit.path, edit.original);
+			const bool restored = Key(cache, desc) == key;
+			if (!CHECK(changed && restored))
+				std::fprintf(stderr, "\t%s\n", edit.path.c_str());
+		}
+
+		// Files only named in comments or outside a directive, or that the search order
+		//		doesn't reach ("sibling.hlsli" is included from nested/, the directory of
+		//		deep.hlsli): creating and editing them changes nothing.
+		const std::string ignored[] =
+		{
+			"commented.hlsli", "block.hlsli", "block2.hlsli", "trailing.hlsli", "midline.hlsli",
+			"unterminated.hlsli", "sibling.hlsli", "include/common.hlsli",
+		};
+		for (const std::string& name : ignored)
+		{
+			WriteText(ROOT + "/" + name, "// created\n");
+			const bool created = Key(cache, desc) == key;
+			WriteText(ROOT + "/" + name, "// edited\n");
+			const bool edited = Key(cache, desc) == key;
+			if (!CHECK(created && edited))
+				std::fprintf(stderr, "\t%s\n", name.c_str());
+		}
+
+		// A directive right after a closed block comment counts.
+		WriteText(ROOT + "/afterComment.hlsli", "// created\n");
+		CHECK(Key(cache, desc) != key);
+		std::remove((ROOT + "/afterComment.hlsli").c_str());
+		CHECK(Key(cache, desc) == key);
+
+		// A missing include that appears, and a quoted include that appears next to the
+		//		including file and so shadows the include directory.
+		WriteText(ROOT + "/missing.hlsli", "// found\n");
+		CHECK(Key(cache, desc) != key);
+		std::remove((ROOT + "/missing.hlsli").c_str());
+		CHECK(Key(cache, desc) == key);
+		WriteText(ROOT + "/shared.hlsli", "// shared\n");
+		CHECK(Key(cache, desc) != key);
+		std::remove((ROOT + "/shared.hlsli").c_str());
+		CHECK(Key(cache, desc) == key);
+	}
+
+	void TestSettings(const ShaderCache& cache)
+	{
+		ShaderDesc desc;
+		desc.path = MAIN;
+		desc.stage = ShaderStage::Pixel;
+		const uint64_t key = Key(cache, desc);
+
+		ShaderDesc other = desc;
+		other.stage = ShaderStage::Vertex;
+		CHECK(Key(cache, other) != key);
+		other = desc;
+		other.entryPoint = "PSMain";
+		CHECK(Key(cache, other) != key);
+		other = desc;
+		other.debug = true;
+		CHECK(Key(cache, other) != key);
+		other = desc;
+		other.defines.push_back({ "USE_FOG", "1" });
+		const uint64_t fog = Key(cache, other);
+		CHECK(fog != key);
+		other.defines[0].value = "0";
+		CHECK(Key(cache, other) != fog);
+		// Name and value don't run into each other.
+		other.defines[0] = { "USE_FO", "G1" };
+		CHECK(Key(cache, other) != fog);
+
+		other = desc;
+		other.path = ROOT + "/nothing.hlsl";
+		uint64_t missing = 0;
+		CHECK(!cache.ComputeKey(other, missing));
+	}
+
+	// No compiler: the .cso next to the working directory, named after the source.
+	void TestPrecompiled()
+	{
+		ShaderCache cache(ROOT + "/cache", std::shared_ptr<ShaderCompiler>());
+		ShaderDesc desc;
+		desc.path = ROOT + "/ShaderCacheTestShader.hlsl";
+		bool threw = false;
+		try
+		{
+			cache.GetShader(desc);
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		CHECK(threw);
+
+		WriteText("ShaderCacheTestShader.cso", "DXBC bytecode");
+		const ShaderBytecode bytecode = cache.GetShader(desc);
+		CHECK(bytecode && std::string(bytecode->begin(), bytecode->end()) == "DXBC bytecode");
+		CHECK(cache.GetStatistics().precompiled == 1 && cache.GetStatistics().compiled == 0);
+	}
+}
+
+int main()
+{
+	WriteTree();
+	// Whether dxcompiler loads here or not, the keys behave the same - the compiler only
+	//		adds its version.
+	ShaderCache cache(ROOT + "/cache", std::make_shared<ShaderCompiler>(), { ROOT + "/include" });
+
+	TestIncludes(cache);
+	TestSettings(cache);
+	TestPrecompiled();
+
+	RemoveTree();
+	return Test::Result("ShaderCache");
+}
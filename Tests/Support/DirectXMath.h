@@ -0,0 +1,102 @@
+#pragma once
+
+// Scalar stand-in for the subset of DirectXMath the framework uses, so the tests build
+//		without the Windows SDK. Only the results matter here, not the speed: every
+//		function is the textbook formula on 4 floats.
+//
+// Tests/CMakeLists.txt picks it up unless DIRECTXMATH_INCLUDE_DIR points to the real
+//		(header only) DirectXMath, which builds on Linux as well.
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#define XM_CALLCONV
+#define XM_ALIGNED_STRUCT(x) struct alignas(x)
+namespace DirectX {
+constexpr float XM_PI = 3.141592654f;
+struct XMVECTOR { float f[4]; };
+typedef const XMVECTOR FXMVECTOR; typedef const XMVECTOR GXMVECTOR; typedef const XMVECTOR HXMVECTOR; typedef const XMVECTOR CXMVECTOR;
+struct XMFLOAT2 { float x,y; XMFLOAT2()=default; constexpr XMFLOAT2(float a,float b):x(a),y(b){} };
+struct XMFLOAT3 { float x,y,z; XMFLOAT3()=default; constexpr XMFLOAT3(float a,float b,float c):x(a),y(b),z(c){} };
+struct XMFLOAT4 { float x,y,z,w; XMFLOAT4()=default; constexpr XMFLOAT4(float a,float b,float c,float d):x(a),y(b),z(c),w(d){} };
+struct XMFLOAT4A : XMFLOAT4 { using XMFLOAT4::XMFLOAT4; XMFLOAT4A()=default; };
+struct XMFLOAT3A : XMFLOAT3 { using XMFLOAT3::XMFLOAT3; XMFLOAT3A()=default; };
+struct XMFLOAT4X4 { float m[4][4]; };
+struct XMFLOAT3X4 { float m[3][4]; };
+struct XMMATRIX { XMVECTOR r[4]; XMMATRIX()=default; XMMATRIX(FXMVECTOR a,FXMVECTOR b,FXMVECTOR c,FXMVECTOR d){r[0]=a;r[1]=b;r[2]=c;r[3]=d;} };
+typedef const XMMATRIX FXMMATRIX; typedef const XMMATRIX CXMMATRIX;
+inline float XMConvertToRadians(float d){return d*(XM_PI/180.0f);}
+inline XMVECTOR XMVectorSet(float x,float y,float z,float w){return {{x,y,z,w}};}
+inline XMVECTOR XMVectorZero(){return {{0,0,0,0}};}
+inline XMVECTOR XMVectorSplatOne(){return {{1,1,1,1}};}
+inline XMVECTOR XMVectorReplicate(float v){return {{v,v,v,v}};}
+inline XMVECTOR XMVectorSplatX(FXMVECTOR v){return XMVectorReplicate(v.f[0]);}
+inline XMVECTOR XMVectorSplatY(FXMVECTOR v){return XMVectorReplicate(v.f[1]);}
+inline XMVECTOR XMVectorSplatZ(FXMVECTOR v){return XMVectorReplicate(v.f[2]);}
+inline XMVECTOR XMVectorSplatW(FXMVECTOR v){return XMVectorReplicate(v.f[3]);}
+inline float XMVectorGetX(FXMVECTOR v){return v.f[0];} inline float XMVectorGetY(FXMVECTOR v){return v.f[1];}
+inline float XMVectorGetZ(FXMVECTOR v){return v.f[2];} inline float XMVectorGetW(FXMVECTOR v){return v.f[3];}
+inline XMVECTOR XMVectorSetW(FXMVECTOR v,float w){XMVECTOR r=v;r.f[3]=w;return r;}
+#define OP2(name,expr) inline XMVECTOR name(FXMVECTOR a,FXMVECTOR b){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=(expr);return r;}
+OP2(XMVectorAdd,a.f[i]+b.f[i]) OP2(XMVectorSubtract,a.f[i]-b.f[i]) OP2(XMVectorMultiply,a.f[i]*b.f[i]) OP2(XMVectorDivide,a.f[i]/b.f[i])
+OP2(XMVectorMin,std::fmin(a.f[i],b.f[i])) OP2(XMVectorMax,std::fmax(a.f[i],b.f[i]))
+inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a,FXMVECTOR b,FXMVECTOR c){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=a.f[i]*b.f[i]+c.f[i];return r;}
+inline XMVECTOR XMVectorNegativeMultiplySubtract(FXMVECTOR a,FXMVECTOR b,FXMVECTOR c){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=c.f[i]-a.f[i]*b.f[i];return r;}
+inline XMVECTOR XMVectorScale(FXMVECTOR a,float s){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=a.f[i]*s;return r;}
+inline XMVECTOR XMVectorNegate(FXMVECTOR a){return XMVectorScale(a,-1);}
+inline XMVECTOR XMVectorAbs(FXMVECTOR a){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=std::fabs(a.f[i]);return r;}
+inline XMVECTOR XMVectorSqrt(FXMVECTOR a){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=std::sqrt(a.f[i]);return r;}
+inline XMVECTOR XMVectorReciprocal(FXMVECTOR a){XMVECTOR r;for(int i=0;i<4;i++)r.f[i]=1.0f/a.f[i];return r;}
+inline XMVECTOR XMVector3Dot(FXMVECTOR a,FXMVECTOR b){return XMVectorReplicate(a.f[0]*b.f[0]+a.f[1]*b.f[1]+a.f[2]*b.f[2]);}
+inline XMVECTOR XMVector4Dot(FXMVECTOR a,FXMVECTOR b){return XMVectorReplicate(a.f[0]*b.f[0]+a.f[1]*b.f[1]+a.f[2]*b.f[2]+a.f[3]*b.f[3]);}
+inline XMVECTOR XMVector3Length(FXMVECTOR a){return XMVectorSqrt(XMVector3Dot(a,a));}
+inline XMVECTOR XMVector3LengthSq(FXMVECTOR a){return XMVector3Dot(a,a);}
+inline XMVECTOR XMVector3Normalize(FXMVECTOR a){float l=std::sqrt(XMVectorGetX(XMVector3Dot(a,a)));return l>0?XMVectorScale(a,1/l):a;}
+inline XMVECTOR XMVector4Normalize(FXMVECTOR a){float l=std::sqrt(XMVectorGetX(XMVector4Dot(a,a)));return l>0?XMVectorScale(a,1/l):a;}
+inline XMVECTOR XMVector3Cross(FXMVECTOR a,FXMVECTOR b){return XMVectorSet(a.f[1]*b.f[2]-a.f[2]*b.f[1],a.f[2]*b.f[0]-a.f[0]*b.f[2],a.f[0]*b.f[1]-a.f[1]*b.f[0],0);}
+inline XMVECTOR XMVectorLerp(FXMVECTOR a,FXMVECTOR b,float t){return XMVectorAdd(a,XMVectorScale(XMVectorSubtract(b,a),t));}
+inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p){return {{p->x,p->y,p->z,p->w}};}
+inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A* p){return {{p->x,p->y,p->z,p->w}};}
+inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p){return {{p->x,p->y,p->z,0}};}
+inline XMVECTOR XMLoadFloat2(const XMFLOAT2* p){return {{p->x,p->y,0,0}};}
+inline void XMStoreFloat4(XMFLOAT4* p,FXMVECTOR v){p->x=v.f[0];p->y=v.f[1];p->z=v.f[2];p->w=v.f[3];}
+inline void XMStoreFloat4A(XMFLOAT4A* p,FXMVECTOR v){XMStoreFloat4(p,v);}
+inline void XMStoreFloat3(XMFLOAT3* p,FXMVECTOR v){p->x=v.f[0];p->y=v.f[1];p->z=v.f[2];}
+inline void XMStoreFloat2(XMFLOAT2* p,FXMVECTOR v){p->x=v.f[0];p->y=v.f[1];}
+inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* p){XMMATRIX m;std::memcpy(&m,p,64);return m;}
+inline void XMStoreFloat4x4(XMFLOAT4X4* p,FXMMATRIX m){std::memcpy(p,&m,64);}
+inline XMMATRIX XMMatrixIdentity(){return XMMATRIX(XMVectorSet(1,0,0,0),XMVectorSet(0,1,0,0),XMVectorSet(0,0,1,0),XMVectorSet(0,0,0,1));}
+inline XMMATRIX XMMatrixTranspose(FXMMATRIX m){XMMATRIX r;for(int i=0;i<4;i++)for(int j=0;j<4;j++)r.r[i].f[j]=m.r[j].f[i];return r;}
+inline XMMATRIX XMMatrixMultiply(FXMMATRIX a,CXMMATRIX b){XMMATRIX r;for(int i=0;i<4;i++)for(int j=0;j<4;j++){float s=0;for(int k=0;k<4;k++)s+=a.r[i].f[k]*b.r[k].f[j];r.r[i].f[j]=s;}return r;}
+inline XMVECTOR XMVector4Transform(FXMVECTOR v,FXMMATRIX m){XMVECTOR r;for(int j=0;j<4;j++){float s=0;for(int k=0;k<4;k++)s+=v.f[k]*m.r[k].f[j];r.f[j]=s;}return r;}
+inline XMVECTOR XMVector3Transform(FXMVECTOR v,FXMMATRIX m){return XMVector4Transform(XMVectorSetW(v,1),m);}
+inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v,FXMMATRIX m){XMVECTOR r=XMVector3Transform(v,m);return XMVectorScale(r,1/r.f[3]);}
+inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v,FXMMATRIX m){XMVECTOR r;for(int j=0;j<4;j++){float s=0;for(int k=0;k<3;k++)s+=v.f[k]*m.r[k].f[j];r.f[j]=s;}return r;}
+inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR q){float x=q.f[0],y=q.f[1],z=q.f[2],w=q.f[3];
+ return XMMATRIX(XMVectorSet(1-2*(y*y+z*z),2*(x*y+z*w),2*(x*z-y*w),0),XMVectorSet(2*(x*y-z*w),1-2*(x*x+z*z),2*(y*z+x*w),0),XMVectorSet(2*(x*z+y*w),2*(y*z-x*w),1-2*(x*x+y*y),0),XMVectorSet(0,0,0,1));}
+inline XMMATRIX XMMatrixScalingFromVector(FXMVECTOR s){return XMMATRIX(XMVectorSet(s.f[0],0,0,0),XMVectorSet(0,s.f[1],0,0),XMVectorSet(0,0,s.f[2],0),XMVectorSet(0,0,0,1));}
+inline XMMATRIX XMMatrixScaling(float x,float y,float z){return XMMatrixScalingFromVector(XMVectorSet(x,y,z,0));}
+inline XMMATRIX XMMatrixTranslationFromVector(FXMVECTOR t){return XMMATRIX(XMVectorSet(1,0,0,0),XMVectorSet(0,1,0,0),XMVectorSet(0,0,1,0),XMVectorSet(t.f[0],t.f[1],t.f[2],1));}
+inline XMMATRIX XMMatrixTranslation(float x,float y,float z){return XMMatrixTranslationFromVector(XMVectorSet(x,y,z,1));}
+inline XMMATRIX XMMatrixAffineTransformation(FXMVECTOR s,FXMVECTOR o,FXMVECTOR q,GXMVECTOR t){(void)o;XMMATRIX m=XMMatrixMultiply(XMMatrixScalingFromVector(s),XMMatrixRotationQuaternion(q));m.r[3]=XMVectorSet(t.f[0],t.f[1],t.f[2],1);return m;}
+inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis,float a){XMVECTOR n=XMVector3Normalize(axis);float s=std::sin(a*0.5f);return XMVectorSet(n.f[0]*s,n.f[1]*s,n.f[2]*s,std::cos(a*0.5f));}
+inline XMVECTOR XMQuaternionIdentity(){return XMVectorSet(0,0,0,1);}
+inline XMMATRIX XMMatrixRotationAxis(FXMVECTOR axis,float a){return XMMatrixRotationQuaternion(XMQuaternionRotationAxis(axis,a));}
+inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye,FXMVECTOR at,FXMVECTOR up){XMVECTOR z=XMVector3Normalize(XMVectorSubtract(at,eye));XMVECTOR x=XMVector3Normalize(XMVector3Cross(up,z));XMVECTOR y=XMVector3Cross(z,x);
+ XMMATRIX m(XMVectorSet(x.f[0],y.f[0],z.f[0],0),XMVectorSet(x.f[1],y.f[1],z.f[1],0),XMVectorSet(x.f[2],y.f[2],z.f[2],0),XMVectorSet(-XMVectorGetX(XMVector3Dot(x,eye)),-XMVectorGetX(XMVector3Dot(y,eye)),-XMVectorGetX(XMVector3Dot(z,eye)),1));return m;}
+inline XMMATRIX XMMatrixPerspectiveFovLH(float fov,float aspect,float n,float f){float h=1.0f/std::tan(fov*0.5f);float w=h/aspect;float r=f/(f-n);
+ return XMMATRIX(XMVectorSet(w,0,0,0),XMVectorSet(0,h,0,0),XMVectorSet(0,0,r,1),XMVectorSet(0,0,-r*n,0));}
+inline XMMATRIX XMMatrixInverse(XMVECTOR*,FXMMATRIX m){ // gauss-jordan
+ double a[4][8];for(int i=0;i<4;i++)for(int j=0;j<4;j++){a[i][j]=m.r[i].f[j];a[i][j+4]=i==j;}
+ for(int c=0;c<4;c++){int p=c;for(int r=c+1;r<4;r++)if(std::fabs(a[r][c])>std::fabs(a[p][c]))p=r;for(int j=0;j<8;j++)std::swap(a[c][j],a[p][j]);double d=a[c][c];for(int j=0;j<8;j++)a[c][j]/=d;
+ for(int r=0;r<4;r++)if(r!=c){double f=a[r][c];for(int j=0;j<8;j++)a[r][j]-=f*a[c][j];}}
+ XMMATRIX r;for(int i=0;i<4;i++)for(int j=0;j<4;j++)r.r[i].f[j]=(float)a[i][j+4];return r;}
+inline XMVECTOR XMQuaternionNormalize(FXMVECTOR q){return XMVector4Normalize(q);}
+inline XMVECTOR XMMatrixDeterminant(FXMMATRIX m){double a[3][3];for(int i=0;i<3;i++)for(int j=0;j<3;j++)a[i][j]=m.r[i].f[j];double d=a[0][0]*(a[1][1]*a[2][2]-a[1][2]*a[2][1])-a[0][1]*(a[1][0]*a[2][2]-a[1][2]*a[2][0])+a[0][2]*(a[1][0]*a[2][1]-a[1][1]*a[2][0]);return XMVectorReplicate((float)d);}
+inline XMVECTOR XMPlaneNormalize(FXMVECTOR p){float l=std::sqrt(p.f[0]*p.f[0]+p.f[1]*p.f[1]+p.f[2]*p.f[2]);return XMVectorScale(p,1/l);}
+inline XMVECTOR XMPlaneDotCoord(FXMVECTOR p,FXMVECTOR v){return XMVectorReplicate(p.f[0]*v.f[0]+p.f[1]*v.f[1]+p.f[2]*v.f[2]+p.f[3]);}
+namespace PackedVector { typedef uint16_t HALF;
+ inline HALF XMConvertFloatToHalf(float v){uint32_t f;std::memcpy(&f,&v,4);uint32_t s=(f>>16)&0x8000;int e=((f>>23)&0xff)-127+15;uint32_t m=f&0x7fffff;if(e<=0)return (HALF)s;if(e>=31)return (HALF)(s|0x7c00);return (HALF)(s|(e<<10)|((m+0x1000)>>13));}
+ inline float XMConvertHalfToFloat(HALF h){uint32_t s=(h&0x8000)<<16;uint32_t e=(h>>10)&0x1f;uint32_t m=h&0x3ff;uint32_t f;if(e==0)f=s;else f=s|((e-15+127)<<23)|(m<<13);float v;std::memcpy(&v,&f,4);return v;}
+}
+}
@@ -0,0 +1,110 @@
+// Scaling of the task scheduler from 1 to 32 threads. Not a test (timings depend on the
+//		machine); run it by hand:
+//
+//		TaskSchedulerBenchmark [maxThreads]
+//
+// The first row is the plain loop; then per thread count (the calling thread + workers):
+//		- ParallelFor over 16M elements with a coarse grain (4096) - how well real work scales,
+//		- the same loop with a fine grain (64) - the cost of splitting and stealing,
+//		- a TaskGroup of 100k empty tasks spawned from the calling thread, and a binary tree
+//		  of nested TaskGroups - millions of tasks per second.
+// Thread counts above the number of cores oversubscribe the machine; they show what
+//		happens to the spinning and sleeping workers then.
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const size_t NUM_ELEMENTS = 16 * 1024 * 1024;
+	const int NUM_TASKS = 100000;
+	const int TREE_DEPTH = 16;		// 2^17 - 1 tasks
+
+	// Best of "iterations" runs, in milliseconds.
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	// A few dozen cycles of work per element.
+	void Transform(const float* in, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			out[i] = std::sqrt(in[i] * in[i] + 1.0f) * 0.5f + std::sin(in[i]);
+	}
+
+	void SpawnTree(TaskScheduler& scheduler, int depth, std::atomic<int>& count)
+	{
+		count.fetch_add(1, std::memory_order_relaxed);
+		if (depth == 0)
+			return;
+
+		TaskGroup group(scheduler);
+		group.Run([&scheduler, depth, &count]() { SpawnTree(scheduler, depth - 1, count); });
+		group.Run([&scheduler, depth, &count]() { SpawnTree(scheduler, depth - 1, count); });
+		group.Wait();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const unsigned maxThreads = argc > 1 ? unsigned(std::atoi(argv[1])) : 32;
+	const int iterations = 5;
+
+	std::vector<float> in(NUM_ELEMENTS), out(NUM_ELEMENTS);
+	for (size_t i = 0; i < NUM_ELEMENTS; ++i)
+		in[i] = float(i % 1000) * 0.01f;
+
+	// Single threaded baseline - the loop without the scheduler (a scheduler always has
+	//		at least one worker thread: 0 means one per core).
+	const double serialMs = MeasureMilliseconds(iterations, [&]() { Transform(in.data(), out.data(), 0, NUM_ELEMENTS); });
+
+	std::printf("%u hardware thread(s), %zu elements, best of %d\n\n", std::thread::hardware_concurrency(), NUM_ELEMENTS, iterations);
+	std::printf("threads  coarse ms  speedup   fine ms  speedup   flat Mtasks/s  tree Mtasks/s\n");
+	std::printf("%7u  %9.2f  %6.2fx  %8s  %7s  %13s  %13s  (plain loop, no scheduler)\n", 1u, serialMs, 1.0, "-", "-", "-", "-");
+
+	// The creating thread is worker 0, so "threads - 1" worker threads.
+	for (unsigned threads = 2; threads <= maxThreads; threads *= 2)
+	{
+		TaskScheduler scheduler(threads - 1);
+		auto parallelFor = [&](size_t grainSize) {
+			scheduler.ParallelFor(0, NUM_ELEMENTS, grainSize, [&](size_t begin, size_t end) {
+				Transform(in.data(), out.data(), begin, end);
+			});
+		};
+
+		const double coarseMs = MeasureMilliseconds(iterations, [&]() { parallelFor(4096); });
+		const double fineMs = MeasureMilliseconds(iterations, [&]() { parallelFor(64); });
+
+		std::atomic<int> count(0);
+		const double flatMs = MeasureMilliseconds(iterations, [&]() {
+			TaskGroup group(scheduler);
+			for (int i = 0; i < NUM_TASKS; ++i)
+				group.Run([&count]() { count.fetch_add(1, std::memory_order_relaxed); });
+			group.Wait();
+		});
+		count = 0;
+		const double treeMs = MeasureMilliseconds(1, [&]() { SpawnTree(scheduler, TREE_DEPTH, count); });
+
+		std::printf("%7u  %9.2f  %6.2fx  %8.2f  %6.2fx  %13.2f  %13.2f\n", threads,
+			coarseMs, serialMs / coarseMs, fineMs, serialMs / fineMs,
+			NUM_TASKS / flatMs * 1e-3, count.load() / treeMs * 1e-3);
+	}
+	return 0;
+}
@@ -0,0 +1,190 @@
+#include "Test.h"
+
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// =====================================================================================
+//									Work stealing queue
+// =====================================================================================
+
+namespace
+{
+	// Owner: LIFO at the bottom. Thieves: FIFO at the top.
+	void TestOrdering()
+	{
+		WorkStealingQueue<int> queue(4);
+		for (int i = 0; i < 10; ++i)
+			queue.Push(i);		// grows twice
+
+		int item = -1;
+		CHECK(queue.Steal(item) && item == 0);
+		CHECK(queue.Steal(item) && item == 1);
+		CHECK(queue.Pop(item) && item == 9);
+		CHECK(queue.Pop(item) && item == 8);
+		CHECK(queue.Steal(item) && item == 2);
+
+		int remaining = 0;
+		int expected = 7;
+		while (queue.Pop(item))
+		{
+			CHECK(item == expected--);
+			++remaining;
+		}
+		CHECK(remaining == 5);
+		CHECK(queue.Empty());
+		CHECK(!queue.Pop(item));
+		CHECK(!queue.Steal(item));
+	}
+
+	// The owner pushes and pops while thieves steal. Every item must be taken exactly
+	//		once - nothing lost, nothing duplicated - including across ring buffer growth
+	//		(the queue starts tiny) and the last item races between Pop() and Steal().
+	void TestConcurrentStealing(int numThieves, int numItems)
+	{
+		WorkStealingQueue<int> queue(2);
+		std::vector<std::atomic<int>> taken(static_cast<size_t>(numItems));
+		for (std::atomic<int>& count : taken)
+			count.store(0);
+
+		std::atomic<bool> done(false);
+		std::atomic<int> stolen(0);
+		std::vector<std::thread> thieves;
+		for (int t = 0; t < numThieves; ++t)
+		{
+			thieves.emplace_back([&] {
+				int item;
+				while (!done.load(std::memory_order_acquire) || !queue.Empty())
+				{
+					if (queue.Steal(item))
+					{
+						taken[static_cast<size_t>(item)].fetch_add(1);
+						stolen.fetch_add(1);
+					}
+				}
+			});
+		}
+
+		int popped = 0;
+		int item;
+		for (int i = 0; i < numItems; ++i)
+		{
+			queue.Push(i);
+			// Pop every third item right away and drain in bursts, so Pop() often meets
+			//		a queue with a single item left.
+			if (i % 3 == 0 && queue.Pop(item))
+			{
+				taken[static_cast<size_t>(item)].fetch_add(1);
+				++popped;
+			}
+			if (i % 1024 == 0)
+			{
+				while (queue.Pop(item))
+				{
+					taken[static_cast<size_t>(item)].fetch_add(1);
+					++popped;
+				}
+			}
+		}
+		while (queue.Pop(item))
+		{
+			taken[static_cast<size_t>(item)].fetch_add(1);
+			++popped;
+		}
+		done.store(true, std::memory_order_release);
+		for (std::thread& thief : thieves)
+			thief.join();
+
+		int wrong = 0;
+		for (std::atomic<int>& count : taken)
+			wrong += count.load() != 1 ? 1 : 0;
+		CHECK(wrong == 0);
+		CHECK(popped + stolen.load() == numItems);
+	}
+}
+
+// =====================================================================================
+//										Scheduler
+// =====================================================================================
+
+namespace
+{
+	void TestParallelFor(TaskScheduler& scheduler)
+	{
+		const size_t count = 1000000;
+		std::atomic<uint64_t> sum(0);
+		std::vector<uint8_t> visited(count, 0);
+		scheduler.ParallelFor(0, count, 1000, [&](size_t begin, size_t end) {
+			uint64_t local = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				local += i;
+				++visited[i];
+			}
+			sum.fetch_add(local);
+		});
+		CHECK(sum.load() == uint64_t(count) * (count - 1) / 2);
+
+		bool once = true;
+		for (uint8_t v : visited)
+			once = once && v == 1;
+		CHECK(once);
+	}
+
+	// Tasks spawning and waiting on nested groups, a continuation, and a foreign thread
+	//		submitting through the injection queue.
+	void TestGroups(TaskScheduler& scheduler)
+	{
+		std::atomic<int> count(0);
+		std::atomic<int> continuations(0);
+		{
+			TaskGroup group(scheduler);
+			for (int i = 0; i < 10000; ++i)
+			{
+				group.Run([&] {
+					count.fetch_add(1);
+					TaskGroup inner(scheduler);
+					inner.Run([&] { count.fetch_add(1); });
+					inner.Wait();
+				});
+			}
+			group.Then([&] { continuations.fetch_add(1); });
+			group.Wait();
+		}
+		while (continuations.load() == 0)
+			scheduler.TryRunOneTask();
+		CHECK(count.load() == 20000);
+		CHECK(continuations.load() == 1);
+
+		std::thread foreign([&] {
+			CHECK(scheduler.GetCurrentThreadIndex() == -1);
+			TaskGroup group(scheduler);
+			for (int i = 0; i < 100; ++i)
+				group.Run([&] { count.fetch_add(1); });
+			group.Wait();
+		});
+		foreign.join();
+		CHECK(count.load() == 20100);
+	}
+}
+
+int main()
+{
+	TestOrdering();
+	TestConcurrentStealing(1, 200000);
+	TestConcurrentStealing(3, 200000);
+	TestConcurrentStealing(7, 100000);
+
+	for (int repeat = 0; repeat < 10; ++repeat)
+	{
+		TaskScheduler scheduler(repeat % 2 ? 7 : 3);
+		CHECK(scheduler.GetCurrentThreadIndex() == 0);
+		TestParallelFor(scheduler);
+		TestGroups(scheduler);
+	}
+
+	return Test::Result("TaskScheduler");
+}
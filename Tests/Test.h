@@ -0,0 +1,38 @@
+#pragma once
+
+// Minimal test helpers shared by the test executables.
+//
+// Every test is a plain executable: CHECK() reports a failed condition and keeps going,
+//		main() returns Test::Result() - non zero if anything failed - so ctest (and any
+//		other runner) only needs the exit code.
+#include <cstdio>
+
+namespace Test
+{
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline bool Check(bool condition, const char* expression, const char* file, int line)
+	{
+		if (!condition)
+		{
+			std::fprintf(stderr, "%s(%d): CHECK failed: %s\n", file, line, expression);
+			++Failures();
+		}
+		return condition;
+	}
+
+	inline int Result(const char* name)
+	{
+		if (Failures() == 0)
+			std::printf("%s: passed\n", name);
+		else
+			std::printf("%s: %d check(s) failed\n", name, Failures());
+		return Failures() == 0 ? 0 : 1;
+	}
+}
+
+#define CHECK(condition) Test::Check(!!(condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,86 @@
+// Timing of the SoA world matrix update, serial and on the task scheduler. Not a test
+//		(timings depend on the machine); run it by hand:
+//
+//		TransformStoreBenchmark [numTransforms] [threads]
+//
+// The budget is a million transforms per frame within a few milliseconds.
+#include "Entity.h"
+#include "TaskScheduler.h"
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Best of "iterations" runs, in milliseconds.
+	template<typename Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t numTransforms = argc > 1 ? size_t(std::atol(argv[1])) : 1000000;
+	const unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	const int iterations = 20;
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+	EntityRegistry registry;
+	TransformStore store;
+	store.Reserve(numTransforms);
+	for (size_t i = 0; i < numTransforms; ++i)
+	{
+		Entity entity = registry.Create();
+		store.Add(entity);
+		store.SetPosition(entity, XMFLOAT3(position(random), position(random), position(random)));
+		XMFLOAT4 rotation;
+		XMStoreFloat4(&rotation, XMQuaternionRotationAxis(XMVectorSet(unit(random), unit(random), 1.0f, 0.0f), unit(random) * XM_PI));
+		store.SetRotation(entity, rotation);
+		store.SetScale(entity, XMFLOAT3(scale(random), scale(random), scale(random)));
+	}
+
+	// One reference loop - what the SoA kernel replaces.
+	std::vector<XMFLOAT4X4> reference(numTransforms);
+	double scalarMs = MeasureMilliseconds(iterations, [&]() {
+		for (size_t i = 0; i < numTransforms; ++i)
+		{
+			Entity entity = store.GetEntities()[i];
+			XMFLOAT3 s = store.GetScale(entity), t = store.GetPosition(entity);
+			XMFLOAT4 q = store.GetRotation(entity);
+			XMStoreFloat4x4(&reference[i], XMMatrixAffineTransformation(XMLoadFloat3(&s), XMVectorZero(), XMLoadFloat4(&q), XMLoadFloat3(&t)));
+		}
+	});
+
+	double serialMs = MeasureMilliseconds(iterations, [&]() { store.UpdateWorldMatrices(); });
+
+	TaskScheduler scheduler(threads > 1 ? threads - 1 : 1);
+	double parallelMs = MeasureMilliseconds(iterations, [&]() { store.UpdateWorldMatrices(&scheduler); });
+
+	std::printf("%zu transforms, best of %d\n", numTransforms, iterations);
+	std::printf("  per entity AffineTransformation:  %8.3f ms\n", scalarMs);
+	std::printf("  UpdateWorldMatrices, serial:       %8.3f ms  (%.1f M/s)\n", serialMs, numTransforms / serialMs * 1e-3);
+	std::printf("  UpdateWorldMatrices, %2u thread(s): %8.3f ms  (%.1f M/s)\n", threads, parallelMs, numTransforms / parallelMs * 1e-3);
+	return 0;
+}
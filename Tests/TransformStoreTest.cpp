@@ -0,0 +1,203 @@
+#include "Test.h"
+
+#include "Entity.h"
+#include "TaskScheduler.h"
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// The store is checked against a std::map from entity to transform through rounds of
+//		random adds, removes and edits: removal swaps the last element into the hole, so
+//		a missed sparse fix-up shows up as a wrong transform (or a lost entity) in a
+//		later round. After every round the SIMD world matrices must match
+//		XMMatrixAffineTransformation, serial and parallel, for counts that are not a
+//		multiple of 4 (the tail loop) as well.
+
+namespace
+{
+	struct Transform
+	{
+		XMFLOAT3 position;
+		XMFLOAT4 rotation;
+		XMFLOAT3 scale;
+	};
+
+	typedef std::map<Entity, Transform> Reference;
+
+	Transform MakeRandomTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+
+		Transform transform;
+		transform.position = XMFLOAT3(position(random), position(random), position(random));
+		XMVECTOR axis = XMVectorSet(unit(random), unit(random), unit(random) + 2.0f, 0.0f);
+		XMStoreFloat4(&transform.rotation, XMQuaternionRotationAxis(axis, unit(random) * XM_PI));
+		transform.scale = XMFLOAT3(scale(random), scale(random), scale(random));
+		return transform;
+	}
+
+	void CheckEntityRegistry()
+	{
+		EntityRegistry registry;
+		Entity a = registry.Create();
+		Entity b = registry.Create();
+		CHECK(a != b);
+		CHECK(registry.IsAlive(a) && registry.IsAlive(b));
+		CHECK(registry.GetNumAlive() == 2);
+
+		// The index is reused with the next generation: the old id is dead for good.
+		registry.Destroy(a);
+		CHECK(!registry.IsAlive(a));
+		Entity c = registry.Create();
+		CHECK(GetEntityIndex(c) == GetEntityIndex(a));
+		CHECK(GetEntityGeneration(c) == GetEntityGeneration(a) + 1);
+		CHECK(!registry.IsAlive(a));
+		CHECK(registry.IsAlive(c));
+
+		// Destroying a stale id does nothing.
+		registry.Destroy(a);
+		CHECK(registry.IsAlive(c));
+		CHECK(registry.GetNumAlive() == 2);
+		CHECK(!registry.IsAlive(INVALID_ENTITY));
+	}
+
+	// Every entity of the reference is in the store with its transform, and the dense
+	//		arrays and the sparse set agree with each other.
+	void CheckContents(const TransformStore& store, const Reference& reference)
+	{
+		CHECK(store.GetCount() == reference.size());
+
+		bool correct = true;
+		for (const auto& entry : reference)
+		{
+			const Transform& expected = entry.second;
+			uint32_t index = store.GetIndex(entry.first);
+			correct = correct && index != TransformStore::INVALID_INDEX && index < store.GetCount();
+			correct = correct && store.GetEntities()[index] == entry.first;
+
+			XMFLOAT3 position = store.GetPosition(entry.first);
+			XMFLOAT4 rotation = store.GetRotation(entry.first);
+			XMFLOAT3 scale = store.GetScale(entry.first);
+			correct = correct && position.x == expected.position.x && position.y == expected.position.y && position.z == expected.position.z;
+			correct = correct && rotation.x == expected.rotation.x && rotation.y == expected.rotation.y &&
+				rotation.z == expected.rotation.z && rotation.w == expected.rotation.w;
+			correct = correct && scale.x == expected.scale.x && scale.y == expected.scale.y && scale.z == expected.scale.z;
+		}
+		CHECK(correct);
+
+		for (size_t i = 0; i < store.GetCount(); ++i)
+			correct = correct && reference.count(store.GetEntities()[i]) == 1;
+		CHECK(correct);
+	}
+
+	void CheckWorldMatrices(const TransformStore& store, const Reference& reference)
+	{
+		float maxError = 0.0f;
+		for (const auto& entry : reference)
+		{
+			const Transform& transform = entry.second;
+			XMMATRIX expected = XMMatrixAffineTransformation(XMLoadFloat3(&transform.scale), XMVectorZero(),
+				XMLoadFloat4(&transform.rotation), XMLoadFloat3(&transform.position));
+
+			XMFLOAT4X4 a, b;
+			XMStoreFloat4x4(&a, store.GetWorldMatrix(entry.first));
+			XMStoreFloat4x4(&b, expected);
+			for (int row = 0; row < 4; ++row)
+			{
+				for (int column = 0; column < 4; ++column)
+					maxError = std::max(maxError, std::fabs(a.m[row][column] - b.m[row][column]));
+			}
+		}
+		// Scales up to 4: a few ulps of the largest element.
+		CHECK(maxError <= 4e-6f);
+	}
+}
+
+int main()
+{
+	CheckEntityRegistry();
+
+	std::mt19937 random(54);
+	TaskScheduler scheduler(3);
+
+	EntityRegistry registry;
+	TransformStore store;
+	Reference reference;
+	std::vector<Entity> alive;
+
+	// Grows to a few thousand and shrinks back, with stale ids around once indices are reused.
+	const int roundSizes[] = { 1, 7, 4096, 5003, 130, 2, 9000, 0, 3 };
+	for (int target : roundSizes)
+	{
+		while (alive.size() < size_t(target))
+		{
+			Entity entity = registry.Create();
+			store.Add(entity);
+			CHECK(store.Has(entity));
+			reference[entity] = Transform{ XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+			alive.push_back(entity);
+		}
+		std::vector<Entity> removed;
+		while (alive.size() > size_t(target))
+		{
+			size_t victim = random() % alive.size();
+			Entity entity = alive[victim];
+			alive[victim] = alive.back();
+			alive.pop_back();
+
+			store.Remove(entity);
+			registry.Destroy(entity);
+			reference.erase(entity);
+			removed.push_back(entity);
+		}
+		// Removed (and by now reused) ids are not found; removing them again does nothing.
+		for (Entity entity : removed)
+		{
+			CHECK(!store.Has(entity));
+			store.Remove(entity);
+		}
+		CHECK(store.GetCount() == alive.size());
+
+		// Random edits to about half of them, through the setters and the chunks.
+		for (Entity entity : alive)
+		{
+			if (random() % 2)
+				continue;
+			Transform transform = MakeRandomTransform(random);
+			store.SetPosition(entity, transform.position);
+			store.SetRotation(entity, transform.rotation);
+			store.SetScale(entity, transform.scale);
+			reference[entity] = transform;
+		}
+		store.ForEachChunk(1000, [](TransformStore::Chunk& chunk) {
+			for (size_t i = chunk.begin; i < chunk.end; ++i)
+				chunk.positionY[i] += 1.0f;
+		}, &scheduler);
+		for (auto& entry : reference)
+			entry.second.position.y += 1.0f;
+
+		CheckContents(store, reference);
+
+		store.UpdateWorldMatrices();
+		CheckWorldMatrices(store, reference);
+
+		// Same matrices in parallel - clear them first so a skipped range shows.
+		store.ForEachChunk(333, [](TransformStore::Chunk& chunk) {
+			for (size_t i = chunk.begin; i < chunk.end; ++i)
+				XMStoreFloat4x4(&chunk.world[i], XMMatrixIdentity());
+		});
+		store.UpdateWorldMatrices(&scheduler);
+		CheckWorldMatrices(store, reference);
+	}
+
+	return Test::Result("TransformStore");
+}
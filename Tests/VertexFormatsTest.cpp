@@ -0,0 +1,208 @@
+#include "Test.h"
+
+#include "VertexFormats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Every attribute encodes to the same bits batched (SSE2 / F16C) and alone (the
+	//		scalar remainder loop): encode the whole array, then each element on its own.
+	template<typename In, typename Out, typename Encode>
+	bool EncodesSameAlone(const std::vector<In>& values, Encode encode)
+	{
+		std::vector<Out> batched(values.size());
+		encode(values.data(), values.size(), batched.data());
+		bool same = true;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			Out alone;
+			encode(&values[i], 1, &alone);
+			if (std::memcmp(&alone, &batched[i], sizeof(Out)) != 0)
+			{
+				std::fprintf(stderr, "element %zu encodes differently batched and alone\n", i);
+				same = false;
+			}
+		}
+		return same;
+	}
+
+	// Sign combinations of zeros in every lane position: -0 and +0 must fold the same in
+	//		the SSE and scalar paths.
+	std::vector<XMFLOAT3> MakeNormals()
+	{
+		const float zero = 0.0f, negativeZero = -0.0f;
+		std::vector<XMFLOAT3> normals = {
+			XMFLOAT3(negativeZero, 0.6f, -0.8f), XMFLOAT3(zero, 0.6f, -0.8f),
+			XMFLOAT3(0.6f, negativeZero, -0.8f), XMFLOAT3(0.6f, zero, -0.8f),
+			XMFLOAT3(negativeZero, negativeZero, -1.0f), XMFLOAT3(zero, zero, -1.0f),
+			XMFLOAT3(zero, zero, 1.0f), XMFLOAT3(negativeZero, -0.6f, 0.8f),
+			XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
+			XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(negativeZero, 1.0f, negativeZero),
+		};
+		std::mt19937 random(3);
+		std::normal_distribution<float> gaussian;
+		for (int i = 0; i < 1000; ++i)
+		{
+			const float x = gaussian(random), y = gaussian(random), z = gaussian(random);
+			const float length = std::sqrt(x * x + y * y + z * z);
+			normals.push_back(XMFLOAT3(x / length, y / length, z / length));
+		}
+		return normals;
+	}
+
+	void TestNormals()
+	{
+		const std::vector<XMFLOAT3> normals = MakeNormals();
+		// Each special normal in each of the 4 lanes of a batch.
+		for (size_t offset = 0; offset < 4; ++offset)
+		{
+			const std::vector<XMFLOAT3> shifted(normals.begin() + offset, normals.end());
+			CHECK((EncodesSameAlone<XMFLOAT3, PackedNormal>(shifted, EncodeNormalsOctahedral)));
+		}
+
+		std::vector<PackedNormal> packed(normals.size());
+		EncodeNormalsOctahedral(normals.data(), normals.size(), packed.data());
+		double maxError = 0.0;
+		for (size_t i = 0; i < normals.size(); ++i)
+		{
+			// atan2(|a x b|, a . b) in double: acos of a float dot product can't resolve
+			//		hundredths of a degree.
+			const XMFLOAT3 d = DecodeNormalOctahedral(packed[i]);
+			const XMFLOAT3& n = normals[i];
+			const double cx = double(d.y) * n.z - double(d.z) * n.y;
+			const double cy = double(d.z) * n.x - double(d.x) * n.z;
+			const double cz = double(d.x) * n.y - double(d.y) * n.x;
+			const double dot = double(d.x) * n.x + double(d.y) * n.y + double(d.z) * n.z;
+			maxError = std::max(maxError, std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 57.29577951);
+		}
+		// A few hundredths of a degree with 16 bits per component.
+		CHECK(maxError < 0.01);
+	}
+
+	void TestPositions()
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> coordinate(-50.0f, 20.0f);
+		std::vector<XMFLOAT3> positions;
+		for (int i = 0; i < 1001; ++i)
+			positions.push_back(XMFLOAT3(coordinate(random), coordinate(random), 7.0f));
+		const QuantizationBounds bounds = QuantizationBounds::FromPositions(positions.data(), positions.size());
+		CHECK(bounds.extent.z == 0.0f);
+
+		for (size_t offset = 0; offset < 2; ++offset)
+		{
+			const std::vector<XMFLOAT3> shifted(positions.begin() + offset, positions.end());
+			CHECK((EncodesSameAlone<XMFLOAT3, QuantizedPosition>(shifted,
+				[&bounds](const XMFLOAT3* in, size_t count, QuantizedPosition* out) { EncodePositions(in, count, bounds, out); })));
+		}
+
+		std::vector<QuantizedPosition> quantized(positions.size());
+		EncodePositions(positions.data(), positions.size(), bounds, quantized.data());
+		const float step = std::max(bounds.extent.x, bounds.extent.y) / 32767.0f;
+		bool withinHalfStep = true;
+		for (size_t i = 0; i < positions.size(); ++i)
+		{
+			const XMFLOAT3 decoded = DecodePosition(quantized[i], bounds);
+			withinHalfStep = withinHalfStep && std::fabs(decoded.x - positions[i].x) <= step * 0.51f &&
+				std::fabs(decoded.y - positions[i].y) <= step * 0.51f && decoded.z == 7.0f && quantized[i].w == 32767;
+		}
+		CHECK(withinHalfStep);
+	}
+
+	// F16C (when the CPU has it) against the scalar FloatToHalf, round to nearest even
+	//		cases, denormals, overflow and infinities included.
+	void TestUVs()
+	{
+		const float infinity = std::numeric_limits<float>::infinity();
+		std::vector<XMFLOAT2> uvs = {
+			XMFLOAT2(0.0f, -0.0f), XMFLOAT2(1.0f, -1.0f), XMFLOAT2(65504.0f, 65520.0f), XMFLOAT2(1e6f, -1e6f),
+			XMFLOAT2(infinity, -infinity), XMFLOAT2(6.1e-5f, 5.96e-8f), XMFLOAT2(2.98e-8f, 1e-10f),
+			XMFLOAT2(1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f), XMFLOAT2(0.33333334f, 1024.5f),
+		};
+		std::mt19937 random(9);
+		for (int i = 0; i < 2000; ++i)
+		{
+			uint32_t bits = random();
+			float value;
+			std::memcpy(&value, &bits, 4);
+			// Random bit patterns cover every exponent; NaNs are checked separately.
+			if (std::isnan(value))
+				value = 0.5f;
+			uvs.push_back(XMFLOAT2(value, std::ldexp(float(random() % 4096), int(random() % 40) - 30)));
+		}
+
+		for (size_t offset = 0; offset < 4; ++offset)
+		{
+			const std::vector<XMFLOAT2> shifted(uvs.begin() + offset, uvs.end());
+			CHECK((EncodesSameAlone<XMFLOAT2, PackedUV>(shifted, EncodeUVsHalf)));
+		}
+
+		CHECK(FloatToHalf(1.0f) == 0x3C00 && FloatToHalf(-2.0f) == 0xC000 && FloatToHalf(65504.0f) == 0x7BFF);
+		CHECK(FloatToHalf(infinity) == 0x7C00 && FloatToHalf(1e6f) == 0x7C00 && FloatToHalf(5.96e-8f) == 0x0001);
+		for (uint32_t half = 0; half < 0x10000; ++half)
+		{
+			const bool nan = (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0;
+			if (!nan)
+				CHECK(FloatToHalf(HalfToFloat(uint16_t(half))) == half);
+		}
+
+		// NaNs stay NaNs either way (F16C keeps the payload, FloatToHalf doesn't).
+		const std::vector<XMFLOAT2> nans(8, XMFLOAT2(std::nanf(""), -std::nanf("")));
+		std::vector<PackedUV> packed(nans.size());
+		EncodeUVsHalf(nans.data(), nans.size(), packed.data());
+		for (const PackedUV& uv : packed)
+			CHECK(std::isnan(HalfToFloat(uv.u)) && std::isnan(HalfToFloat(uv.v)));
+
+		if (!VertexFormatsDetail::IsF16CSupported())
+			std::printf("VertexFormats: F16C not supported, F16C kernel not tested\n");
+	}
+
+	void TestColors()
+	{
+		std::mt19937 random(13);
+		std::uniform_real_distribution<float> channel(-0.2f, 1.2f);
+		std::vector<XMFLOAT4> colors4 = { XMFLOAT4(0.5f / 255.0f, 1.5f / 255.0f, 2.5f / 255.0f, -0.0f) };
+		std::vector<XMFLOAT3> colors3 = { XMFLOAT3(0.5f / 255.0f, 1.5f / 255.0f, 2.5f / 255.0f) };
+		for (int i = 0; i < 1000; ++i)
+		{
+			colors4.push_back(XMFLOAT4(channel(random), channel(random), channel(random), channel(random)));
+			colors3.push_back(XMFLOAT3(channel(random), channel(random), channel(random)));
+		}
+		for (size_t offset = 0; offset < 4; ++offset)
+		{
+			const std::vector<XMFLOAT4> shifted4(colors4.begin() + offset, colors4.end());
+			const std::vector<XMFLOAT3> shifted3(colors3.begin() + offset, colors3.end());
+			CHECK((EncodesSameAlone<XMFLOAT4, PackedColor>(shifted4,
+				[](const XMFLOAT4* in, size_t count, PackedColor* out) { EncodeColorsRGBA8(in, count, out); })));
+			CHECK((EncodesSameAlone<XMFLOAT3, PackedColor>(shifted3,
+				[](const XMFLOAT3* in, size_t count, PackedColor* out) { EncodeColorsRGBA8(in, count, out); })));
+		}
+
+		PackedColor packed;
+		EncodeColorsRGBA8(colors3.data(), 1, &packed);
+		// Round half to even: 0.5 -> 0, 1.5 -> 2, 2.5 -> 2; RGB gets alpha 1.
+		CHECK(packed == 0xFF020200u);
+		const XMFLOAT4 decoded = DecodeColorRGBA8(0x80FF0040u);
+		CHECK(decoded.x == 64.0f / 255.0f && decoded.y == 0.0f && decoded.z == 1.0f && decoded.w == 128.0f / 255.0f);
+	}
+}
+
+int main()
+{
+	TestNormals();
+	TestPositions();
+	TestUVs();
+	TestColors();
+
+	return Test::Result("VertexFormats");
+}
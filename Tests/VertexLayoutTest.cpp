@@ -0,0 +1,246 @@
+#include "Test.h"
+
+#include "VertexFormats.h"
+#include "VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// The layouts of VertexLayout.h are built at compile time, so most of this test is
+//		static_asserts: every element's offset and size against offsetof / sizeof, the input
+//		elements of an interleaved and of a multi-stream layout (slots, per vertex and per
+//		instance data, step rates, strides), and the checks DECLARE_VERTEX_LAYOUT and
+//		VertexInputLayout run, evaluated on broken layouts written by hand - declaring one
+//		with the macros would not compile. Then the layouts are read back at run time
+//		through GetDesc(), the way a pipeline state gets them (Tests/Support/d3d12.h stands
+//		in for the SDK header).
+namespace
+{
+	// Interleaved: what a mesh vertex carries, in one stream. Members of different sizes,
+	//		so a wrong offset can't hide behind a uniform stride.
+	struct MeshVertex
+	{
+		QuantizedPosition Position;
+		PackedNormal Normal;
+		PackedNormal Tangent;
+		PackedUV UV0;
+		PackedUV UV1;
+		PackedColor Color;
+	};
+
+	// Split streams: positions alone for depth only passes, the rest for shading, plus
+	//		per instance data - a transform every instance, a tint every other instance.
+	struct PositionVertex
+	{
+		float Position[3];
+	};
+
+	struct ShadingVertex
+	{
+		PackedNormal Normal;
+		PackedUV UV;
+		PackedUV UV1;
+	};
+
+	struct InstanceTransform
+	{
+		float World0[4], World1[4], World2[4];
+	};
+
+	struct InstanceTint
+	{
+		PackedColor Color;
+	};
+}
+
+DECLARE_VERTEX_LAYOUT(MeshVertex,
+	VERTEX_ELEMENT(MeshVertex, Position, "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM),
+	VERTEX_ELEMENT(MeshVertex, Normal, "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM),
+	VERTEX_ELEMENT(MeshVertex, Tangent, "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM),
+	VERTEX_ELEMENT(MeshVertex, UV0, "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM),
+	VERTEX_ELEMENT(MeshVertex, UV1, "TEXCOORD", 1, DXGI_FORMAT_R16G16_UNORM),
+	VERTEX_ELEMENT(MeshVertex, Color, "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM));
+
+DECLARE_VERTEX_LAYOUT(PositionVertex,
+	VERTEX_ELEMENT(PositionVertex, Position, "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT));
+
+DECLARE_VERTEX_LAYOUT(ShadingVertex,
+	VERTEX_ELEMENT(ShadingVertex, Normal, "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM),
+	VERTEX_ELEMENT(ShadingVertex, UV, "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM),
+	VERTEX_ELEMENT(ShadingVertex, UV1, "TEXCOORD", 1, DXGI_FORMAT_R16G16_UNORM));
+
+DECLARE_VERTEX_LAYOUT(InstanceTransform,
+	VERTEX_ELEMENT(InstanceTransform, World0, "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT),
+	VERTEX_ELEMENT(InstanceTransform, World1, "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT),
+	VERTEX_ELEMENT(InstanceTransform, World2, "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT));
+
+DECLARE_VERTEX_LAYOUT(InstanceTint,
+	VERTEX_ELEMENT(InstanceTint, Color, "TINT", 0, DXGI_FORMAT_R8G8B8A8_UNORM));
+
+// =====================================================================================
+//									Vertex layouts
+// =====================================================================================
+
+typedef VertexLayoutOf<MeshVertex> MeshLayout;
+static_assert(MeshLayout::GetCount() == 6, "");
+static_assert(MeshLayout::GetStride() == sizeof(MeshVertex) && sizeof(MeshVertex) == 28, "");
+static_assert(MeshLayout::Get(0).offset == offsetof(MeshVertex, Position) && MeshLayout::Get(0).size == 8, "");
+static_assert(MeshLayout::Get(1).offset == offsetof(MeshVertex, Normal) && MeshLayout::Get(1).size == 4, "");
+static_assert(MeshLayout::Get(2).offset == offsetof(MeshVertex, Tangent) && MeshLayout::Get(2).size == 4, "");
+static_assert(MeshLayout::Get(3).offset == offsetof(MeshVertex, UV0) && MeshLayout::Get(3).size == 4, "");
+static_assert(MeshLayout::Get(4).offset == offsetof(MeshVertex, UV1) && MeshLayout::Get(4).size == 4, "");
+static_assert(MeshLayout::Get(5).offset == offsetof(MeshVertex, Color) && MeshLayout::Get(5).size == 4, "");
+static_assert(MeshLayout::Get(4).semanticIndex == 1 && MeshLayout::Get(4).format == DXGI_FORMAT_R16G16_UNORM, "");
+static_assert(VertexLayoutDetail::StringEqual(MeshLayout::Get(3).semantic, "TEXCOORD"), "");
+
+static_assert(VertexLayoutOf<PositionVertex>::GetStride() == 12, "");
+static_assert(VertexLayoutOf<ShadingVertex>::Get(2).offset == offsetof(ShadingVertex, UV1), "");
+static_assert(VertexLayoutOf<InstanceTransform>::Get(2).offset == offsetof(InstanceTransform, World2), "");
+static_assert(VertexLayoutOf<InstanceTransform>::Get(2).size == 16, "");
+
+// The checks of DECLARE_VERTEX_LAYOUT, on layouts it would reject: two elements at
+//		Offset0 / Offset1 of Size0 / Size1 bytes, with float formats of those sizes unless
+//		Format0 overrides the first one.
+namespace
+{
+	template<uint32_t Stride, uint32_t Offset0, uint32_t Size0, uint32_t Offset1, uint32_t Size1,
+		DXGI_FORMAT Format0 = DXGI_FORMAT_UNKNOWN>
+	struct HandWrittenLayout
+	{
+		static constexpr size_t GetCount() { return 2; }
+		static constexpr VertexElement Get(size_t index)
+		{
+			return index == 0 ?
+				VertexElement{ "A", 0, Format0 != DXGI_FORMAT_UNKNOWN ? Format0 : FormatOfSize(Size0), Offset0, Size0 } :
+				VertexElement{ "B", 0, FormatOfSize(Size1), Offset1, Size1 };
+		}
+		static constexpr uint32_t GetStride() { return Stride; }
+
+		static constexpr DXGI_FORMAT FormatOfSize(uint32_t size)
+		{
+			return size == 16 ? DXGI_FORMAT_R32G32B32A32_FLOAT : size == 12 ? DXGI_FORMAT_R32G32B32_FLOAT :
+				size == 8 ? DXGI_FORMAT_R32G32_FLOAT : size == 4 ? DXGI_FORMAT_R32_FLOAT :
+				size == 2 ? DXGI_FORMAT_R16_FLOAT : DXGI_FORMAT_R8_UNORM;
+		}
+	};
+}
+
+// Back to back and with a gap: fine.
+static_assert(VertexLayoutDetail::ElementsFit<HandWrittenLayout<12, 0, 8, 8, 4>>(), "");
+static_assert(VertexLayoutDetail::ElementsFit<HandWrittenLayout<16, 0, 4, 12, 4>>(), "");
+static_assert(VertexLayoutDetail::FormatSizesMatch<HandWrittenLayout<12, 0, 8, 8, 4>>(), "");
+// Overlapping by one byte, either order.
+static_assert(!VertexLayoutDetail::ElementsFit<HandWrittenLayout<12, 0, 8, 7, 4>>(), "");
+static_assert(!VertexLayoutDetail::ElementsFit<HandWrittenLayout<12, 7, 4, 0, 8>>(), "");
+// Running past the stride.
+static_assert(!VertexLayoutDetail::ElementsFit<HandWrittenLayout<12, 0, 4, 8, 8>>(), "");
+// A 12 byte format on an 8 byte member, and a format that isn't vertex data.
+static_assert(!VertexLayoutDetail::FormatSizesMatch<HandWrittenLayout<12, 0, 8, 8, 4, DXGI_FORMAT_R32G32B32_FLOAT>>(), "");
+static_assert(!VertexLayoutDetail::FormatSizesMatch<HandWrittenLayout<12, 0, 8, 8, 4, DXGI_FORMAT_BC1_UNORM>>(), "");
+
+static_assert(GetVertexFormatSize(DXGI_FORMAT_R10G10B10A2_UNORM) == 4 && GetVertexFormatSize(DXGI_FORMAT_R8_SNORM) == 1, "");
+static_assert(GetVertexFormatSize(DXGI_FORMAT_R32G32B32A32_TYPELESS) == 0, "");
+
+// =====================================================================================
+//									Input layouts
+// =====================================================================================
+
+typedef VertexInputLayout<VertexStream<MeshVertex, 0>> InterleavedLayout;
+static_assert(InterleavedLayout::ElementCount == 6, "");
+static_assert(InterleavedLayout::GetStride(0) == sizeof(MeshVertex) && InterleavedLayout::GetStride(1) == 0, "");
+static_assert(InterleavedLayout::GetElements().elements[5].AlignedByteOffset == offsetof(MeshVertex, Color), "");
+
+// Slots out of order and with gaps: the elements follow the stream order, each stream keeps
+//		its slot, classification and step rate.
+typedef VertexInputLayout<
+	VertexStream<PositionVertex, 0>,
+	VertexStream<ShadingVertex, 3>,
+	InstanceStream<InstanceTint, 5, 2>,
+	InstanceStream<InstanceTransform, 1>
+> SplitLayout;
+static_assert(SplitLayout::ElementCount == 8, "");
+static_assert(SplitLayout::GetStride(0) == sizeof(PositionVertex) && SplitLayout::GetStride(1) == sizeof(InstanceTransform), "");
+static_assert(SplitLayout::GetStride(3) == sizeof(ShadingVertex) && SplitLayout::GetStride(5) == sizeof(InstanceTint), "");
+static_assert(SplitLayout::GetStride(2) == 0 && SplitLayout::GetStride(4) == 0, "");
+
+// Duplicates VertexInputLayout rejects: a slot used twice, a semantic in two streams.
+//		The same semantic with another index, and the same struct in two slots with
+//		different semantics, are fine.
+static_assert(!VertexLayoutDetail::StreamList<VertexStream<PositionVertex, 0>, VertexStream<ShadingVertex, 0>>::IsUnique(), "");
+static_assert(!VertexLayoutDetail::StreamList<VertexStream<MeshVertex, 0>, VertexStream<PositionVertex, 1>>::IsUnique(), "");
+static_assert(!VertexLayoutDetail::StreamList<VertexStream<MeshVertex, 0>, VertexStream<ShadingVertex, 1>>::IsUnique(), "");
+static_assert(VertexLayoutDetail::StreamList<VertexStream<PositionVertex, 0>, VertexStream<ShadingVertex, 1>,
+	InstanceStream<InstanceTransform, 2>>::IsUnique(), "");
+
+namespace
+{
+	struct ExpectedElement
+	{
+		const char* semantic;
+		UINT index;
+		DXGI_FORMAT format;
+		UINT slot;
+		UINT offset;
+		D3D12_INPUT_CLASSIFICATION classification;
+		UINT stepRate;
+	};
+
+	template<typename Layout>
+	void CheckDesc(const ExpectedElement* expected, size_t count)
+	{
+		const D3D12_INPUT_LAYOUT_DESC desc = Layout::GetDesc();
+		CHECK(desc.NumElements == count);
+		CHECK(desc.pInputElementDescs == Layout::GetElements().elements);
+		for (size_t i = 0; i < count && i < desc.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.pInputElementDescs[i];
+			CHECK(std::strcmp(element.SemanticName, expected[i].semantic) == 0);
+			CHECK(element.SemanticIndex == expected[i].index);
+			CHECK(element.Format == expected[i].format);
+			CHECK(element.InputSlot == expected[i].slot);
+			CHECK(element.AlignedByteOffset == expected[i].offset);
+			CHECK(element.InputSlotClass == expected[i].classification);
+			CHECK(element.InstanceDataStepRate == expected[i].stepRate);
+		}
+	}
+
+	void TestInterleaved()
+	{
+		const D3D12_INPUT_CLASSIFICATION vertex = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+		const ExpectedElement expected[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, vertex, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, vertex, 0 },
+			{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, vertex, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 16, vertex, 0 },
+			{ "TEXCOORD", 1, DXGI_FORMAT_R16G16_UNORM, 0, 20, vertex, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 24, vertex, 0 },
+		};
+		CheckDesc<InterleavedLayout>(expected, 6);
+	}
+
+	void TestMultiStream()
+	{
+		const D3D12_INPUT_CLASSIFICATION vertex = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+		const D3D12_INPUT_CLASSIFICATION instance = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA;
+		const ExpectedElement expected[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, vertex, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 3, 0, vertex, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 3, 4, vertex, 0 },
+			{ "TEXCOORD", 1, DXGI_FORMAT_R16G16_UNORM, 3, 8, vertex, 0 },
+			{ "TINT", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 5, 0, instance, 2 },
+			{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, instance, 1 },
+			{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, instance, 1 },
+			{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, instance, 1 },
+		};
+		CheckDesc<SplitLayout>(expected, 8);
+	}
+}
+
+int main()
+{
+	TestInterleaved();
+	TestMultiStream();
+
+	return Test::Result("VertexLayout");
+}
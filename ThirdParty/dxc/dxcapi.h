@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcapi.h                                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides declarations for the DirectX Compiler API entry point.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Subset of include/dxc/dxcapi.h (and, on Linux, include/dxc/WinAdapter.h) from
+// https://github.com/microsoft/DirectXShaderCompiler: the declarations
+// Framework/ShaderCompiler.cpp uses. Interfaces keep every method up to the
+// last one used, in the upstream order and with the upstream signatures, and
+// the GUIDs are the upstream ones - the vtables must match dxcompiler's.
+// The Windows SDK ships the full header as <dxcapi.h>; both use the same
+// include guard, so whichever comes first wins.
+
+#ifndef __DXC_API__
+#define __DXC_API__
+
+#ifdef _WIN32
+
+// IUnknown, IID_PPV_ARGS, CoTaskMemFree.
+#include <objbase.h>
+
+#define CROSS_PLATFORM_UUIDOF(interface, spec)                                 \
+  struct __declspec(uuid(spec)) interface;
+
+#define CLSID_SCOPE __declspec(selectany) extern
+
+#else // _WIN32
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#define STDMETHODCALLTYPE
+
+typedef int32_t HRESULT;
+typedef int BOOL;
+typedef uint32_t UINT;
+typedef uint32_t UINT32;
+typedef uint32_t ULONG;
+typedef size_t SIZE_T;
+typedef void *LPVOID;
+typedef const void *LPCVOID;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef wchar_t *LPWSTR;
+typedef const wchar_t *LPCWSTR;
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define E_FAIL ((HRESULT)0x80004005L)
+
+typedef struct _GUID {
+  uint32_t Data1;
+  uint16_t Data2;
+  uint16_t Data3;
+  uint8_t Data4[8];
+} GUID;
+typedef GUID IID;
+typedef GUID CLSID;
+typedef const IID &REFIID;
+typedef const CLSID &REFCLSID;
+
+// __uuidof() is a Microsoft extension: each interface specializes
+// __emulated_uuidof() instead.
+template <typename interface> inline GUID __emulated_uuidof();
+
+#define __uuidof(T) __emulated_uuidof<typename std::decay<T>::type>()
+
+#define IID_PPV_ARGS(ppType)                                                   \
+  __uuidof(decltype(**(ppType))), reinterpret_cast<void **>(ppType)
+
+// Parses "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx".
+inline uint8_t __dxc_hex_digit(char c) {
+  return uint8_t(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+}
+
+inline GUID __dxc_parse_guid(const char *spec) {
+  GUID guid = {};
+  const char *p = spec;
+  auto next = [&p]() {
+    if (*p == '-')
+      ++p;
+    const uint8_t value =
+        uint8_t((__dxc_hex_digit(p[0]) << 4) | __dxc_hex_digit(p[1]));
+    p += 2;
+    return value;
+  };
+  for (int i = 0; i < 4; ++i)
+    guid.Data1 = (guid.Data1 << 8) | next();
+  for (int i = 0; i < 2; ++i)
+    guid.Data2 = uint16_t((guid.Data2 << 8) | next());
+  for (int i = 0; i < 2; ++i)
+    guid.Data3 = uint16_t((guid.Data3 << 8) | next());
+  for (int i = 0; i < 8; ++i)
+    guid.Data4[i] = next();
+  return guid;
+}
+
+#define CROSS_PLATFORM_UUIDOF(interface, spec)                                 \
+  struct interface;                                                            \
+  template <> inline GUID __emulated_uuidof<interface>() {                     \
+    static const GUID guid = __dxc_parse_guid(spec);                           \
+    return guid;                                                               \
+  }
+
+#define CLSID_SCOPE static
+
+// dxcompiler allocates the strings it returns (GetCommitInfo) with malloc.
+inline void CoTaskMemFree(LPVOID pv) { std::free(pv); }
+
+// Forward declarations of the COM interfaces some methods take.
+struct IMalloc;
+struct IStream;
+
+// As in WinAdapter.h: AddRef and Release are implemented by dxcompiler, and
+// the virtual destructor occupies the two vtable slots after Release.
+CROSS_PLATFORM_UUIDOF(IUnknown, "00000000-0000-0000-C000-000000000046")
+struct IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid,
+                                                   void **ppvObject) = 0;
+  virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+  virtual ULONG STDMETHODCALLTYPE Release() = 0;
+  virtual ~IUnknown() {}
+
+  template <class Q> HRESULT QueryInterface(Q **pp) {
+    return QueryInterface(__uuidof(Q), reinterpret_cast<void **>(pp));
+  }
+};
+
+#endif // _WIN32
+
+struct DxcDefine;
+struct IDxcCompilerArgs;
+
+// Entry point exported by dxcompiler.dll / libdxcompiler.so.
+#ifdef _WIN32
+typedef HRESULT(__stdcall *DxcCreateInstanceProc)(REFCLSID rclsid, REFIID riid,
+                                                  LPVOID *ppv);
+#else
+typedef HRESULT (*DxcCreateInstanceProc)(REFCLSID rclsid, REFIID riid,
+                                         LPVOID *ppv);
+#endif
+
+// Code pages for DxcBuffer::Encoding.
+#define DXC_CP_ACP 0
+#define DXC_CP_UTF16 1200
+#define DXC_CP_UTF8 65001
+
+struct DxcBuffer {
+  LPCVOID Ptr;
+  SIZE_T Size;
+  UINT Encoding;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcBlob, "8BA5FB08-5195-40e2-AC58-0D989C3A0102")
+struct IDxcBlob : public IUnknown {
+  virtual LPVOID STDMETHODCALLTYPE GetBufferPointer(void) = 0;
+  virtual SIZE_T STDMETHODCALLTYPE GetBufferSize(void) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcBlobEncoding, "7241d424-2646-4191-97c0-98e96e42fc68")
+struct IDxcBlobEncoding : public IDxcBlob {
+  virtual HRESULT STDMETHODCALLTYPE GetEncoding(BOOL *pKnown,
+                                                UINT32 *pCodePage) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcBlobWide, "A3F84EAB-0FAA-497E-A39C-EE6ED60B2D84")
+struct IDxcBlobWide : public IDxcBlobEncoding {
+  virtual LPCWSTR STDMETHODCALLTYPE GetStringPointer(void) = 0;
+  virtual SIZE_T STDMETHODCALLTYPE GetStringLength(void) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcBlobUtf8, "3DA636C9-BA71-4024-A301-30CBF125305B")
+struct IDxcBlobUtf8 : public IDxcBlobEncoding {
+  virtual LPCSTR STDMETHODCALLTYPE GetStringPointer(void) = 0;
+  virtual SIZE_T STDMETHODCALLTYPE GetStringLength(void) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler,
+                      "7f61fc7d-950d-467f-b3e3-3c02fb49187c")
+struct IDxcIncludeHandler : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename,
+                                               IDxcBlob **ppIncludeSource) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcUtils, "4605C4CB-2019-492A-ADA4-65F20BB7D67F")
+struct IDxcUtils : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE CreateBlobFromBlob(IDxcBlob *pBlob,
+                                                       UINT32 offset,
+                                                       UINT32 length,
+                                                       IDxcBlob **ppResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  CreateBlobFromPinned(LPCVOID pData, UINT32 size, UINT32 codePage,
+                       IDxcBlobEncoding **pBlobEncoding) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  MoveToBlob(LPCVOID pData, IMalloc *pIMalloc, UINT32 size, UINT32 codePage,
+             IDxcBlobEncoding **pBlobEncoding) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  CreateBlob(LPCVOID pData, UINT32 size, UINT32 codePage,
+             IDxcBlobEncoding **pBlobEncoding) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  LoadFile(LPCWSTR pFileName, UINT32 *pCodePage,
+           IDxcBlobEncoding **pBlobEncoding) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  CreateReadOnlyStreamFromBlob(IDxcBlob *pBlob, IStream **ppStream) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  CreateDefaultIncludeHandler(IDxcIncludeHandler **ppResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  GetBlobAsUtf8(IDxcBlob *pBlob, IDxcBlobUtf8 **pBlobEncoding) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  GetBlobAsWide(IDxcBlob *pBlob, IDxcBlobWide **pBlobEncoding) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  GetDxilContainerPart(const DxcBuffer *pShader, UINT32 DxcPart,
+                       void **ppPartData, UINT32 *pPartSizeInBytes) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  CreateReflection(const DxcBuffer *pData, REFIID iid,
+                   void **ppvReflection) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  BuildArguments(LPCWSTR pSourceName, LPCWSTR pEntryPoint,
+                 LPCWSTR pTargetProfile, LPCWSTR *pArguments, UINT32 argCount,
+                 const DxcDefine *pDefines, UINT32 defineCount,
+                 IDxcCompilerArgs **ppArgs) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetPDBContents(IDxcBlob *pPDBBlob,
+                                                   IDxcBlob **ppHash,
+                                                   IDxcBlob **ppContainer) = 0;
+};
+
+typedef enum DXC_OUT_KIND {
+  DXC_OUT_NONE = 0,
+  DXC_OUT_OBJECT = 1,
+  DXC_OUT_ERRORS = 2,
+  DXC_OUT_PDB = 3,
+  DXC_OUT_SHADER_HASH = 4,
+  DXC_OUT_DISASSEMBLY = 5,
+  DXC_OUT_HLSL = 6,
+  DXC_OUT_TEXT = 7,
+  DXC_OUT_REFLECTION = 8,
+  DXC_OUT_ROOT_SIGNATURE = 9,
+  DXC_OUT_EXTRA_OUTPUTS = 10,
+  DXC_OUT_REMARKS = 11,
+  DXC_OUT_TIME_REPORT = 12,
+  DXC_OUT_TIME_TRACE = 13,
+
+  DXC_OUT_LAST = DXC_OUT_TIME_TRACE,
+
+  DXC_OUT_NUM_ENUMS,
+  DXC_OUT_FORCE_DWORD = 0xFFFFFFFF
+} DXC_OUT_KIND;
+
+CROSS_PLATFORM_UUIDOF(IDxcOperationResult,
+                      "CEDB484A-D4E9-445A-B991-CA21CA157DC2")
+struct IDxcOperationResult : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetStatus(HRESULT *pStatus) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetResult(IDxcBlob **ppResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE
+  GetErrorBuffer(IDxcBlobEncoding **ppErrors) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcResult, "58346CDA-DDE7-4497-9461-6F87AF5E0659")
+struct IDxcResult : public IDxcOperationResult {
+  virtual BOOL STDMETHODCALLTYPE HasOutput(DXC_OUT_KIND dxcOutKind) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetOutput(DXC_OUT_KIND dxcOutKind,
+                                              REFIID iid, void **ppvObject,
+                                              IDxcBlobWide **ppOutputName) = 0;
+  virtual UINT32 STDMETHODCALLTYPE GetNumOutputs() = 0;
+  virtual DXC_OUT_KIND STDMETHODCALLTYPE GetOutputByIndex(UINT32 Index) = 0;
+  virtual DXC_OUT_KIND STDMETHODCALLTYPE PrimaryOutput() = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler3, "228B4687-5A6A-4730-900C-9702B2203F54")
+struct IDxcCompiler3 : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE
+  Compile(const DxcBuffer *pSource, LPCWSTR *pArguments, UINT32 argCount,
+          IDxcIncludeHandler *pIncludeHandler, REFIID riid,
+          LPVOID *ppResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Disassemble(const DxcBuffer *pObject,
+                                                REFIID riid,
+                                                LPVOID *ppResult) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcVersionInfo, "b04f5b50-2059-4f12-a8ff-a1e0cde1cc7e")
+struct IDxcVersionInfo : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetVersion(UINT32 *pMajor,
+                                               UINT32 *pMinor) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetFlags(UINT32 *pFlags) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcVersionInfo2, "fb6904c4-42f0-4b62-9c46-983af7da7c83")
+struct IDxcVersionInfo2 : public IDxcVersionInfo {
+  virtual HRESULT STDMETHODCALLTYPE GetCommitInfo(UINT32 *pCommitCount,
+                                                  char **pCommitHash) = 0;
+};
+
+// {73e22d93-e6ce-47f3-b5bf-f0664f39c1b0}
+CLSID_SCOPE const GUID CLSID_DxcCompiler = {
+    0x73e22d93,
+    0xe6ce,
+    0x47f3,
+    {0xb5, 0xbf, 0xf0, 0x66, 0x4f, 0x39, 0xc1, 0xb0}};
+
+// {6245D6AF-66E0-48FD-80B4-4D271796748C}
+CLSID_SCOPE const GUID CLSID_DxcUtils = {
+    0x6245d6af,
+    0x66e0,
+    0x48fd,
+    {0x80, 0xb4, 0x4d, 0x27, 0x17, 0x96, 0x74, 0x8c}};
+
+#endif // __DXC_API__
@@ -0,0 +1,484 @@
+// =====================================================================================
+//										Asset cooker
+// =====================================================================================
+
+// Command line tool converting source assets into GPU-ready packages (Framework/AssetPackage.h):
+//
+//		AssetCooker <sourceDir> <outputDir> [-j <threads>] [--force] [--verbose] [--cache <dir>]
+//					[--uncompressed] [--bc-quality fast|normal|best] [--color-format bc7|bc1] [--dds]
+//					[--mip-filter none|box|kaiser]
+//					[--pack <file> [--compression none|lz4|lz4hc|zstd] [--level <n>]]
+//
+//		.obj, .gltf, .glb	-> .mesh	quantized, optimized vertex/index buffers with a LOD chain
+//		.tga				-> .tex		block compressed by the name's suffix:
+//										_n/_normal	BC5, linear
+//										_mask		BC4, linear
+//										otherwise	BC7 sRGB (--color-format bc1: BC1, or BC3
+//													with partial alpha)
+//										with a full mip chain (Kaiser filtered unless
+//										--mip-filter says otherwise, see MipChain.h).
+//										--uncompressed keeps RGBA8, --dds writes .dds files
+//										instead of packages.
+//
+// --verbose lists every asset cooked or restored; for meshes also the simulated vertex
+//		cache efficiency (ACMR, ATVR) of every LOD before and after its triangles were
+//		reordered.
+//
+// The directory structure of <sourceDir> is mirrored in <outputDir>. With --pack, all
+//		packages are also collected into one pack file (Framework/PackFile.h), named by
+//		their path relative to <outputDir>; LZ4 by default, zstd needs DX12FW_WITH_ZSTD.
+//
+// Incremental: every cook is keyed on the content of its inputs, see CookCache.h. An asset
+//		whose key is in the cache is not cooked again: its package is already in place or
+//		is copied out of the cache. The cache lives in <outputDir>/.cookcache unless --cache
+//		points elsewhere (e.g. one cache shared by several output directories).
+//		--force cooks everything, the cache is still updated.
+// Parallel: every asset is one task of a TaskScheduler (one thread per core, -j to
+//		override), and the mesh pipeline spreads its LOD levels over the scheduler as well.
+//
+// Builds with Visual Studio (AssetCooker.vcxproj) and on Linux with any C++17 compiler and
+//		the header only DirectXMath (github.com/microsoft/DirectXMath, plus a sal.h such as
+//		the one of its Linux package), from the repository root:
+//
+//		g++ -std=c++17 -O2 -msse4.1 -I. -I<DirectXMath>/Inc -o AssetCooker
+//			Tools/AssetCooker/*.cpp Framework/AssetPackage.cpp Framework/Compression.cpp
+//			Framework/Hash.cpp Framework/MappedFile.cpp Framework/MeshOptimizer.cpp
+//			Framework/MeshSimplifier.cpp Framework/PackFile.cpp Framework/TaskScheduler.cpp
+//			Framework/VertexFormats.cpp
+//			-pthread [-DDX12FW_WITH_ZSTD -lzstd]
+
+#include "CookCache.h"
+#include "CookerUtils.h"
+#include "Dds.h"
+#include "MeshCooker.h"
+#include "MeshImporter.h"
+#include "TextureCooker.h"
+
+#include "Framework/AssetPackage.h"
+#include "Framework/Hash.h"
+#include "Framework/PackFile.h"
+#include "Framework/TaskScheduler.h"
+
+#include <algorithm> // std::transform
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>   // std::atoi
+#include <cstring>   // std::strcmp
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Bump when the cooker's output changes without a package format change (e.g. a
+	//		better optimizer), so existing packages are rebuilt.
+	constexpr uint32_t COOKER_VERSION = 5;
+
+	enum class SourceKind
+	{
+		Mesh,
+		Texture,
+	};
+
+	struct CookJob
+	{
+		SourceKind kind;
+		fs::path source;
+		fs::path output;
+		TextureCookSettings textureSettings;
+		// Texture as .dds instead of a package.
+		bool dds;
+		uint64_t settingsHash;
+	};
+
+	struct Options
+	{
+		fs::path sourceDir;
+		fs::path outputDir;
+		unsigned threads = 0;
+		bool force = false;
+		bool verbose = false;
+		fs::path cacheDir;
+
+		bool uncompressed = false;
+		BlockQuality quality = BlockQuality::Normal;
+		TextureEncoding colorEncoding = TextureEncoding::BC7;
+		MipFilter mipFilter = MipFilter::Kaiser;
+		bool dds = false;
+
+		fs::path packFile;
+		CompressionMethod compression = CompressionMethod::LZ4;
+		// -1 = the method's default.
+		int level = -1;
+	};
+
+	std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(),
+			[](char c) { return char(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c); });
+		return text;
+	}
+
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		const size_t length = std::strlen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		std::vector<const char*> positional;
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+				options.threads = unsigned(std::max(1, std::atoi(argv[++i])));
+			else if (std::strcmp(argv[i], "--force") == 0)
+				options.force = true;
+			else if (std::strcmp(argv[i], "--verbose") == 0)
+				options.verbose = true;
+			else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+				options.cacheDir = argv[++i];
+			else if (std::strcmp(argv[i], "--uncompressed") == 0)
+				options.uncompressed = true;
+			else if (std::strcmp(argv[i], "--dds") == 0)
+				options.dds = true;
+			else if (std::strcmp(argv[i], "--bc-quality") == 0 && i + 1 < argc)
+			{
+				const std::string quality = argv[++i];
+				if (quality == "fast")
+					options.quality = BlockQuality::Fast;
+				else if (quality == "normal")
+					options.quality = BlockQuality::Normal;
+				else if (quality == "best")
+					options.quality = BlockQuality::Best;
+				else
+					return false;
+			}
+			else if (std::strcmp(argv[i], "--color-format") == 0 && i + 1 < argc)
+			{
+				const std::string format = argv[++i];
+				if (format == "bc7")
+					options.colorEncoding = TextureEncoding::BC7;
+				else if (format == "bc1")
+					options.colorEncoding = TextureEncoding::BC1;
+				else
+					return false;
+			}
+			else if (std::strcmp(argv[i], "--mip-filter") == 0 && i + 1 < argc)
+			{
+				const std::string filter = argv[++i];
+				if (filter == "none")
+					options.mipFilter = MipFilter::None;
+				else if (filter == "box")
+					options.mipFilter = MipFilter::Box;
+				else if (filter == "kaiser")
+					options.mipFilter = MipFilter::Kaiser;
+				else
+					return false;
+			}
+			else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+				options.packFile = argv[++i];
+			else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+				options.level = std::atoi(argv[++i]);
+			else if (std::strcmp(argv[i], "--compression") == 0 && i + 1 < argc)
+			{
+				const std::string method = argv[++i];
+				if (method == "none")
+					options.compression = CompressionMethod::None;
+				else if (method == "lz4")
+					options.compression = CompressionMethod::LZ4;
+				else if (method == "lz4hc")
+				{
+					options.compression = CompressionMethod::LZ4;
+					if (options.level < 0)
+						options.level = 9;
+				}
+				else if (method == "zstd")
+					options.compression = CompressionMethod::Zstd;
+				else
+					return false;
+			}
+			else if (argv[i][0] == '-')
+				return false;
+			else
+				positional.push_back(argv[i]);
+		}
+		if (positional.size() != 2)
+			return false;
+
+		options.sourceDir = positional[0];
+		options.outputDir = positional[1];
+		if (options.cacheDir.empty())
+			options.cacheDir = options.outputDir / ".cookcache";
+		if (options.level < 0)
+			options.level = options.compression == CompressionMethod::Zstd ? ZSTD_LEVEL_DEFAULT : LZ4_LEVEL_FAST;
+		return true;
+	}
+
+	// The cache key of a cook: settings (with the package and cooker versions), source and
+	//		dependency contents. A dependency that can't be read hashes as 0 - the cook
+	//		then reports the actual error.
+	uint64_t ComputeCacheKey(const CookJob& job, const std::vector<std::string>& dependencies, CookCache& cache)
+	{
+		StreamingHash64 hash;
+		hash.UpdateValue(job.settingsHash);
+		hash.UpdateValue(cache.HashFile(job.source.string()));
+		for (const std::string& dependency : dependencies)
+		{
+			uint64_t dependencyHash = 0;
+			try
+			{
+				dependencyHash = cache.HashFile(dependency);
+			}
+			catch (const std::exception&)
+			{
+			}
+			hash.UpdateValue(dependencyHash);
+		}
+		return hash.Digest();
+	}
+
+	std::vector<uint8_t> Cook(const CookJob& job, const MeshCookSettings& meshSettings, TaskScheduler* scheduler,
+		std::vector<std::string>& dependencies, std::vector<MeshLodStatistics>* meshStatistics)
+	{
+		std::vector<uint8_t> package;
+		if (job.kind == SourceKind::Mesh)
+		{
+			SourceMesh mesh;
+			ImportMesh(job.source.string(), mesh, scheduler, &dependencies);
+			CookMesh(mesh, meshSettings, job.settingsHash, scheduler, package, meshStatistics);
+		}
+		else
+		{
+			SourceImage image;
+			LoadTga(ReadFileBytes(job.source.string()), image);
+			CookedTexture texture;
+			CookTexture(image, job.textureSettings, scheduler, texture);
+			if (job.dds)
+				WriteDds(texture, package);
+			else
+				WriteTexturePackage(texture, job.settingsHash, package);
+		}
+		return package;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "usage: AssetCooker <sourceDir> <outputDir> [-j <threads>] [--force] [--verbose] [--cache <dir>]\n"
+			"                   [--uncompressed] [--bc-quality fast|normal|best] [--color-format bc7|bc1] [--dds]\n"
+			"                   [--mip-filter none|box|kaiser]\n"
+			"                   [--pack <file> [--compression none|lz4|lz4hc|zstd] [--level <n>]]\n");
+		return 2;
+	}
+	if (!fs::is_directory(options.sourceDir))
+	{
+		std::fprintf(stderr, "error: %s is not a directory\n", options.sourceDir.string().c_str());
+		return 2;
+	}
+
+	if (!options.packFile.empty() && !IsCompressionSupported(options.compression))
+	{
+		std::fprintf(stderr, "error: zstd support needs a build with DX12FW_WITH_ZSTD\n");
+		return 2;
+	}
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// Every settings hash covers the package format and cooker versions too.
+	const MeshCookSettings meshSettings;
+	uint64_t versionHash = HashValue(ASSET_PACKAGE_VERSION);
+	versionHash = HashValue(COOKER_VERSION, versionHash);
+	const uint64_t meshSettingsHash = HashValue(meshSettings.GetHash(), versionHash);
+
+	// Collect the work.
+	std::vector<CookJob> jobs;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(options.sourceDir))
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		const std::string extension = ToLower(entry.path().extension().string());
+		const std::string stem = ToLower(entry.path().stem().string());
+
+		CookJob job;
+		job.dds = false;
+		job.source = entry.path();
+		job.output = options.outputDir / fs::relative(entry.path(), options.sourceDir);
+		if (extension == ".obj" || extension == ".gltf" || extension == ".glb")
+		{
+			job.kind = SourceKind::Mesh;
+			job.output.replace_extension(".mesh");
+			job.settingsHash = meshSettingsHash;
+		}
+		else if (extension == ".tga")
+		{
+			job.kind = SourceKind::Texture;
+			job.dds = options.dds;
+			job.output.replace_extension(options.dds ? ".dds" : ".tex");
+
+			// Normal maps keep two channels at full BC4 precision each, masks one;
+			//		everything else is color.
+			TextureCookSettings& settings = job.textureSettings;
+			const bool normalMap = EndsWith(stem, "_n") || EndsWith(stem, "_normal");
+			const bool mask = EndsWith(stem, "_mask");
+			settings.srgb = !normalMap && !mask;
+			settings.encoding = normalMap ? TextureEncoding::BC5 : mask ? TextureEncoding::BC4 : options.colorEncoding;
+			if (options.uncompressed)
+				settings.encoding = TextureEncoding::RGBA8;
+			settings.quality = options.quality;
+			settings.mipFilter = options.mipFilter;
+			job.settingsHash = HashValue(job.dds, HashValue(settings.GetHash(), versionHash));
+		}
+		else
+		{
+			continue;
+		}
+		jobs.push_back(job);
+	}
+
+	// Cook everything that is out of date, one task per asset. -j 1 runs on this thread
+	//		alone.
+	std::unique_ptr<TaskScheduler> scheduler;
+	if (options.threads != 1)
+	{
+		scheduler.reset(new TaskScheduler(options.threads ? options.threads - 1 : 0));
+	}
+
+	CookCache cache(options.cacheDir.string());
+	cache.Load();
+
+	std::atomic<uint32_t> cooked(0), upToDate(0), restored(0), deduplicated(0), failed(0);
+	std::mutex outputMutex;
+	auto cookJob = [&](const CookJob& job) {
+		try
+		{
+			const std::string source = job.source.string();
+			const std::string output = job.output.string();
+
+			// Hit: the package for this exact input is either in place already or in the
+			//		cache. The dependencies are those of the last cook - if they changed,
+			//		the source changed, and so did the key.
+			uint64_t packageHash;
+			if (!options.force && cache.Lookup(ComputeCacheKey(job, cache.GetDependencies(source), cache), packageHash))
+			{
+				std::error_code error;
+				if (fs::is_regular_file(job.output, error) && cache.HashFile(output) == packageHash)
+				{
+					++upToDate;
+					return;
+				}
+				if (cache.Restore(packageHash, output))
+				{
+					++restored;
+					if (options.verbose)
+					{
+						std::lock_guard<std::mutex> lock(outputMutex);
+						std::printf("restored %s\n", output.c_str());
+					}
+					return;
+				}
+			}
+
+			// Miss: cook, then key the result on the inputs the cook actually read.
+			std::vector<std::string> dependencies;
+			std::vector<MeshLodStatistics> meshStatistics;
+			const std::vector<uint8_t> package = Cook(job, meshSettings, scheduler.get(), dependencies,
+				options.verbose ? &meshStatistics : nullptr);
+			cache.SetDependencies(source, dependencies);
+			bool duplicate = false;
+			cache.Store(ComputeCacheKey(job, dependencies, cache), package, &duplicate);
+			WriteFileAtomic(output, package.data(), package.size());
+
+			++cooked;
+			deduplicated += duplicate ? 1 : 0;
+			if (options.verbose)
+			{
+				std::lock_guard<std::mutex> lock(outputMutex);
+				std::printf("cooked %s%s\n", output.c_str(), duplicate ? " (duplicate)" : "");
+				for (size_t lod = 0; lod < meshStatistics.size(); ++lod)
+				{
+					const MeshLodStatistics& statistics = meshStatistics[lod];
+					std::printf("  lod %zu: %zu triangles, %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+						lod, statistics.triangleCount, statistics.vertexCount,
+						statistics.before.acmr, statistics.after.acmr, statistics.before.atvr, statistics.after.atvr);
+				}
+			}
+		}
+		catch (const std::exception& exception)
+		{
+			++failed;
+			std::lock_guard<std::mutex> lock(outputMutex);
+			std::fprintf(stderr, "error: %s: %s\n", job.source.string().c_str(), exception.what());
+		}
+	};
+
+	if (scheduler)
+	{
+		TaskGroup group(*scheduler);
+		for (const CookJob& job : jobs)
+		{
+			group.Run([&cookJob, &job]() { cookJob(job); });
+		}
+		group.Wait();
+	}
+	else
+	{
+		for (const CookJob& job : jobs)
+			cookJob(job);
+	}
+
+	try
+	{
+		cache.Save();
+	}
+	catch (const std::exception& exception)
+	{
+		std::fprintf(stderr, "warning: cook cache not saved: %s\n", exception.what());
+	}
+
+	// Hits are assets that needed no cook, whether the package was in place or restored.
+	const uint32_t hits = upToDate + restored;
+	const uint32_t lookups = hits + cooked + failed;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::printf("%u cooked, %u up to date, %u restored from cache, %u failed (%.2f s)\n",
+		cooked.load(), upToDate.load(), restored.load(), failed.load(), seconds);
+	std::printf("cache: %.1f%% hit rate (%u of %u), %u duplicate packages stored once\n",
+		lookups ? 100.0 * hits / lookups : 0.0, hits, lookups, deduplicated.load());
+
+	// Pack every package there is, cooked now or before.
+	if (!options.packFile.empty())
+	{
+		const auto packStartTime = std::chrono::steady_clock::now();
+		PackFileWriter writer;
+		for (const CookJob& job : jobs)
+		{
+			std::error_code error;
+			if (!fs::is_regular_file(job.output, error))
+				continue;
+
+			const std::vector<uint8_t> package = ReadFileBytes(job.output.string());
+			const std::string name = fs::relative(job.output, options.outputDir).generic_string();
+			writer.AddEntry(name, package.data(), package.size(), options.compression, options.level);
+		}
+
+		if (!writer.Write(options.packFile.string().c_str(), scheduler.get()))
+		{
+			std::fprintf(stderr, "error: can't write %s\n", options.packFile.string().c_str());
+			return 1;
+		}
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - packStartTime).count();
+		std::printf("packed %llu -> %llu bytes (%.2f s)\n", (unsigned long long)writer.GetUncompressedSize(),
+			(unsigned long long)writer.GetCompressedSize(), seconds);
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,802 @@
+#include "BlockCompression.h"
+
+#include "Framework/TaskScheduler.h"
+
+#include <algorithm> // std::min, std::max, std::swap
+#include <atomic>
+#include <cfloat>    // FLT_MAX
+#include <cmath>
+#include <cstring>   // std::memcpy
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BLOCK_COMPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+	constexpr int MAX_PALETTE_SIZE = 16;
+	constexpr int MAX_CHANNELS = 4;
+
+	// Weights of the second endpoint in the BC7 4 bit index palette, out of 64.
+	const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	template<typename T>
+	inline T Clamp(T value, T lo, T hi) { return std::min(std::max(value, lo), hi); }
+
+	// The 16 texels of a block, one array per channel, so the kernels load 4 or 8 texels
+	//		of a channel at once.
+	struct BlockTexels
+	{
+		alignas(32) float channels[MAX_CHANNELS][16];
+	};
+
+	struct Palette
+	{
+		float entries[MAX_PALETTE_SIZE][MAX_CHANNELS];
+		int size;
+	};
+
+	BlockKernel GetFastestKernel()
+	{
+		if (IsBlockKernelSupported(BlockKernel::AVX2))
+			return BlockKernel::AVX2;
+		if (IsBlockKernelSupported(BlockKernel::SSE2))
+			return BlockKernel::SSE2;
+		return BlockKernel::Scalar;
+	}
+
+	std::atomic<BlockKernel> g_BlockKernel(GetFastestKernel());
+
+	void LoadTexels(const uint8_t* rgba, BlockTexels& texels)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < MAX_CHANNELS; ++c)
+				texels.channels[c][i] = float(rgba[i * 4 + c]);
+		}
+	}
+
+// =====================================================================================
+//										Nearest palette entry
+// =====================================================================================
+
+	// For every texel, the palette entry with the smallest squared distance over channels
+	//		[firstChannel, firstChannel + CHANNELS). Ties go to the lower index. Returns the
+	//		summed squared error of the block.
+	template<int CHANNELS>
+	float FindNearestEntries(const BlockTexels& texels, int firstChannel, const Palette& palette, uint8_t* indices)
+	{
+		alignas(32) float errors[16];
+		alignas(32) int32_t nearest[16];
+
+		switch (g_BlockKernel.load(std::memory_order_relaxed))
+		{
+		case BlockKernel::AVX2:
+			BlockCompressionDetail::FindNearestEntriesAVX2(&texels.channels[firstChannel], CHANNELS,
+				palette.entries, palette.size, errors, nearest);
+			break;
+#if defined(BLOCK_COMPRESSION_SSE2)
+		case BlockKernel::SSE2:
+			for (int quarter = 0; quarter < 16; quarter += 4)
+			{
+				__m128 texel[CHANNELS];
+				for (int c = 0; c < CHANNELS; ++c)
+					texel[c] = _mm_load_ps(&texels.channels[firstChannel + c][quarter]);
+
+				__m128 bestError = _mm_set1_ps(FLT_MAX);
+				__m128 bestIndex = _mm_setzero_ps();
+				for (int k = 0; k < palette.size; ++k)
+				{
+					__m128 error = _mm_setzero_ps();
+					for (int c = 0; c < CHANNELS; ++c)
+					{
+						const __m128 difference = _mm_sub_ps(texel[c], _mm_set1_ps(palette.entries[k][c]));
+						error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+					}
+					const __m128 closer = _mm_cmplt_ps(error, bestError);
+					bestError = _mm_min_ps(error, bestError);
+					// blendvps is SSE4.1; and/andnot/or is as fast here.
+					bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(float(k))), _mm_andnot_ps(closer, bestIndex));
+				}
+				_mm_store_ps(&errors[quarter], bestError);
+				_mm_store_si128(reinterpret_cast<__m128i*>(&nearest[quarter]), _mm_cvttps_epi32(bestIndex));
+			}
+			break;
+#endif
+		default:
+			for (int i = 0; i < 16; ++i)
+			{
+				errors[i] = FLT_MAX;
+				nearest[i] = 0;
+				for (int k = 0; k < palette.size; ++k)
+				{
+					float error = 0.0f;
+					for (int c = 0; c < CHANNELS; ++c)
+					{
+						const float difference = texels.channels[firstChannel + c][i] - palette.entries[k][c];
+						error += difference * difference;
+					}
+					if (error < errors[i])
+					{
+						errors[i] = error;
+						nearest[i] = k;
+					}
+				}
+			}
+			break;
+		}
+
+		float total = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			indices[i] = uint8_t(nearest[i]);
+			total += errors[i];
+		}
+		return total;
+	}
+
+// =====================================================================================
+//										Endpoint fitting
+// =====================================================================================
+
+	// Mean and principal axis (unit length) of the texels over [firstChannel,
+	//		firstChannel + channelCount). Texels with "exclude" set don't count.
+	void ComputePrincipalAxis(const BlockTexels& texels, int firstChannel, int channelCount, const bool* exclude,
+		float* mean, float* axis)
+	{
+		float count = 0.0f;
+		for (int c = 0; c < channelCount; ++c)
+			mean[c] = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (exclude && exclude[i])
+				continue;
+			for (int c = 0; c < channelCount; ++c)
+				mean[c] += texels.channels[firstChannel + c][i];
+			count += 1.0f;
+		}
+		for (int c = 0; c < channelCount; ++c)
+			mean[c] /= std::max(count, 1.0f);
+
+		float covariance[MAX_CHANNELS][MAX_CHANNELS] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (exclude && exclude[i])
+				continue;
+			for (int a = 0; a < channelCount; ++a)
+			{
+				const float da = texels.channels[firstChannel + a][i] - mean[a];
+				for (int b = a; b < channelCount; ++b)
+					covariance[a][b] += da * (texels.channels[firstChannel + b][i] - mean[b]);
+			}
+		}
+		for (int a = 0; a < channelCount; ++a)
+		{
+			for (int b = 0; b < a; ++b)
+				covariance[a][b] = covariance[b][a];
+		}
+
+		// Power iteration, starting from the column with the largest variance - never
+		//		orthogonal to the principal axis, unlike a fixed start vector.
+		int largest = 0;
+		for (int c = 1; c < channelCount; ++c)
+			largest = covariance[c][c] > covariance[largest][largest] ? c : largest;
+		float vector[MAX_CHANNELS];
+		for (int c = 0; c < channelCount; ++c)
+			vector[c] = covariance[c][largest];
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[MAX_CHANNELS] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = 0; b < channelCount; ++b)
+					next[a] += covariance[a][b] * vector[b];
+				length += next[a] * next[a];
+			}
+			// A single color: any axis does.
+			if (length < 1e-12f)
+				break;
+			length = 1.0f / std::sqrt(length);
+			for (int c = 0; c < channelCount; ++c)
+				vector[c] = next[c] * length;
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < channelCount; ++c)
+			length += vector[c] * vector[c];
+		for (int c = 0; c < channelCount; ++c)
+			axis[c] = length > 1e-12f ? vector[c] / std::sqrt(length) : 1.0f / std::sqrt(float(channelCount));
+	}
+
+	// The extremes of the texels projected onto the principal axis, clamped to [0, 255].
+	void ComputeEndpoints(const BlockTexels& texels, int firstChannel, int channelCount, const bool* exclude,
+		float* lo, float* hi)
+	{
+		float mean[MAX_CHANNELS], axis[MAX_CHANNELS];
+		ComputePrincipalAxis(texels, firstChannel, channelCount, exclude, mean, axis);
+
+		float minimum = FLT_MAX, maximum = -FLT_MAX;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (exclude && exclude[i])
+				continue;
+			float t = 0.0f;
+			for (int c = 0; c < channelCount; ++c)
+				t += (texels.channels[firstChannel + c][i] - mean[c]) * axis[c];
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+		for (int c = 0; c < channelCount; ++c)
+		{
+			lo[c] = Clamp(mean[c] + minimum * axis[c], 0.0f, 255.0f);
+			hi[c] = Clamp(mean[c] + maximum * axis[c], 0.0f, 255.0f);
+		}
+	}
+
+	// Least squares endpoints for fixed indices: texel i is modeled as
+	//		(1 - w) * e0 + w * e1 with w = weights[indices[i]]; negative weights mark palette
+	//		entries that aren't interpolated (texels using them don't count). False if the
+	//		system is singular - all texels on one endpoint.
+	bool RefitEndpoints(const BlockTexels& texels, int firstChannel, int channelCount, const uint8_t* indices,
+		const float* weights, float* e0, float* e1)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[MAX_CHANNELS] = {}, bx[MAX_CHANNELS] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			const float w = weights[indices[i]];
+			if (w < 0.0f)
+				continue;
+			const float a = 1.0f - w;
+			aa += a * a;
+			ab += a * w;
+			bb += w * w;
+			for (int c = 0; c < channelCount; ++c)
+			{
+				ax[c] += a * texels.channels[firstChannel + c][i];
+				bx[c] += w * texels.channels[firstChannel + c][i];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-4f)
+			return false;
+		const float inverse = 1.0f / determinant;
+		for (int c = 0; c < channelCount; ++c)
+		{
+			e0[c] = Clamp((ax[c] * bb - bx[c] * ab) * inverse, 0.0f, 255.0f);
+			e1[c] = Clamp((bx[c] * aa - ax[c] * ab) * inverse, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	int GetRefitCount(BlockQuality quality)
+	{
+		return quality == BlockQuality::Fast ? 0 : quality == BlockQuality::Normal ? 1 : 3;
+	}
+
+// =====================================================================================
+//										BC1 color
+// =====================================================================================
+
+	uint16_t QuantizeRgb565(const float* rgb)
+	{
+		const int r = Clamp(int(rgb[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+		const int g = Clamp(int(rgb[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+		const int b = Clamp(int(rgb[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void ExpandRgb565(uint16_t color, float* rgb)
+	{
+		const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		rgb[0] = float((r << 3) | (r >> 2));
+		rgb[1] = float((g << 2) | (g >> 4));
+		rgb[2] = float((b << 3) | (b >> 2));
+	}
+
+	struct Bc1Candidate
+	{
+		uint16_t color0;
+		uint16_t color1;
+		uint8_t indices[16];
+		float error;
+	};
+
+	// Palette order is the index encoding: 0 = color0, 1 = color1, then the interpolated
+	//		colors. color0 > color1 selects 4 colors; otherwise 3 colors + transparent black
+	//		(index 3) - BC3's color block always decodes as 4 colors.
+	const float BC1_WEIGHTS_4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const float BC1_WEIGHTS_3[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+
+	Bc1Candidate EvaluateBc1(const BlockTexels& texels, uint16_t a, uint16_t b, bool transparentMode,
+		const bool* transparent)
+	{
+		if (transparentMode ? a > b : a < b)
+			std::swap(a, b);
+
+		Bc1Candidate candidate;
+		candidate.color0 = a;
+		candidate.color1 = b;
+
+		Palette palette;
+		ExpandRgb565(a, palette.entries[0]);
+		ExpandRgb565(b, palette.entries[1]);
+		if (!transparentMode)
+		{
+			palette.size = 4;
+			for (int c = 0; c < 3; ++c)
+			{
+				palette.entries[2][c] = (2.0f * palette.entries[0][c] + palette.entries[1][c]) / 3.0f;
+				palette.entries[3][c] = (palette.entries[0][c] + 2.0f * palette.entries[1][c]) / 3.0f;
+			}
+		}
+		else
+		{
+			palette.size = 3;
+			for (int c = 0; c < 3; ++c)
+				palette.entries[2][c] = (palette.entries[0][c] + palette.entries[1][c]) * 0.5f;
+		}
+
+		candidate.error = FindNearestEntries<3>(texels, 0, palette, candidate.indices);
+		if (transparentMode)
+		{
+			// Transparent texels take index 3 whatever their color; only the others count.
+			candidate.error = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				if (transparent[i])
+				{
+					candidate.indices[i] = 3;
+					continue;
+				}
+				for (int c = 0; c < 3; ++c)
+				{
+					const float difference = texels.channels[c][i] - palette.entries[candidate.indices[i]][c];
+					candidate.error += difference * difference;
+				}
+			}
+		}
+		return candidate;
+	}
+
+	void EncodeBc1Color(const BlockTexels& texels, BlockQuality quality, bool allowTransparent, uint8_t* out)
+	{
+		bool transparent[16];
+		int transparentCount = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			transparent[i] = allowTransparent && texels.channels[3][i] < 128.0f;
+			transparentCount += transparent[i] ? 1 : 0;
+		}
+		const bool transparentMode = transparentCount > 0;
+
+		Bc1Candidate best;
+		if (transparentCount == 16)
+		{
+			best.color0 = best.color1 = 0;
+			std::fill(best.indices, best.indices + 16, uint8_t(3));
+		}
+		else
+		{
+			float lo[3], hi[3];
+			ComputeEndpoints(texels, 0, 3, transparentMode ? transparent : nullptr, lo, hi);
+			if (quality == BlockQuality::Fast)
+			{
+				// Quantization pulls the endpoints around anyway; insetting them a little
+				//		keeps the extremes from dominating the palette.
+				for (int c = 0; c < 3; ++c)
+				{
+					const float inset = (hi[c] - lo[c]) / 16.0f;
+					lo[c] += inset;
+					hi[c] -= inset;
+				}
+			}
+			best = EvaluateBc1(texels, QuantizeRgb565(hi), QuantizeRgb565(lo), transparentMode, transparent);
+
+			const float* weights = transparentMode ? BC1_WEIGHTS_3 : BC1_WEIGHTS_4;
+			for (int refit = 0; refit < GetRefitCount(quality); ++refit)
+			{
+				float e0[3], e1[3];
+				if (!RefitEndpoints(texels, 0, 3, best.indices, weights, e0, e1))
+					break;
+				const Bc1Candidate candidate = EvaluateBc1(texels, QuantizeRgb565(e0), QuantizeRgb565(e1),
+					transparentMode, transparent);
+				if (candidate.error >= best.error)
+					break;
+				best = candidate;
+			}
+
+			if (quality == BlockQuality::Best)
+			{
+				// One step in every 565 channel of either endpoint, kept if it helps.
+				const uint16_t fields[3][2] = { { 11, 31 }, { 5, 63 }, { 0, 31 } };
+				for (int endpoint = 0; endpoint < 2; ++endpoint)
+				{
+					for (int field = 0; field < 3; ++field)
+					{
+						for (int step = -1; step <= 1; step += 2)
+						{
+							uint16_t colors[2] = { best.color0, best.color1 };
+							const int value = (colors[endpoint] >> fields[field][0]) & fields[field][1];
+							if (value + step < 0 || value + step > fields[field][1])
+								continue;
+							colors[endpoint] = uint16_t((colors[endpoint] & ~(fields[field][1] << fields[field][0])) |
+								((value + step) << fields[field][0]));
+							const Bc1Candidate candidate = EvaluateBc1(texels, colors[0], colors[1], transparentMode, transparent);
+							if (candidate.error < best.error)
+								best = candidate;
+						}
+					}
+				}
+			}
+		}
+
+		uint32_t indexBits = 0;
+		for (int i = 0; i < 16; ++i)
+			indexBits |= uint32_t(best.indices[i]) << (i * 2);
+		out[0] = uint8_t(best.color0);
+		out[1] = uint8_t(best.color0 >> 8);
+		out[2] = uint8_t(best.color1);
+		out[3] = uint8_t(best.color1 >> 8);
+		std::memcpy(out + 4, &indexBits, 4);
+	}
+
+// =====================================================================================
+//										BC4 channel
+// =====================================================================================
+
+	struct Bc4Candidate
+	{
+		uint8_t endpoint0;
+		uint8_t endpoint1;
+		uint8_t indices[16];
+		float error;
+	};
+
+	// Index encoding: 0 = endpoint0, 1 = endpoint1, then interpolated values. endpoint0 >
+	//		endpoint1 selects 8 values; otherwise 6 values plus the constants 0 (index 6)
+	//		and 255 (index 7).
+	const float BC4_WEIGHTS_8[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+	const float BC4_WEIGHTS_6[8] = { 0.0f, 1.0f, 1.0f / 5.0f, 2.0f / 5.0f, 3.0f / 5.0f, 4.0f / 5.0f, -1.0f, -1.0f };
+
+	Bc4Candidate EvaluateBc4(const BlockTexels& texels, int channel, int a, int b, bool sixValueMode)
+	{
+		if (sixValueMode ? a > b : a < b)
+			std::swap(a, b);
+		// Equal endpoints decode in 6 value mode.
+		sixValueMode |= a == b;
+
+		Bc4Candidate candidate;
+		candidate.endpoint0 = uint8_t(a);
+		candidate.endpoint1 = uint8_t(b);
+
+		const float* weights = sixValueMode ? BC4_WEIGHTS_6 : BC4_WEIGHTS_8;
+		Palette palette;
+		palette.size = 8;
+		for (int k = 0; k < 8; ++k)
+			palette.entries[k][0] = float(a) + (float(b) - float(a)) * weights[k];
+		if (sixValueMode)
+		{
+			palette.entries[6][0] = 0.0f;
+			palette.entries[7][0] = 255.0f;
+		}
+
+		candidate.error = FindNearestEntries<1>(texels, channel, palette, candidate.indices);
+		return candidate;
+	}
+
+	void RefineBc4(const BlockTexels& texels, int channel, int refits, bool sixValueMode, Bc4Candidate& best)
+	{
+		for (int refit = 0; refit < refits; ++refit)
+		{
+			float e0, e1;
+			if (!RefitEndpoints(texels, channel, 1, best.indices, sixValueMode ? BC4_WEIGHTS_6 : BC4_WEIGHTS_8, &e0, &e1))
+				return;
+			const Bc4Candidate candidate = EvaluateBc4(texels, channel, int(e0 + 0.5f), int(e1 + 0.5f), sixValueMode);
+			if (candidate.error >= best.error)
+				return;
+			best = candidate;
+		}
+	}
+
+	void EncodeBc4Channel(const BlockTexels& texels, int channel, BlockQuality quality, uint8_t* out)
+	{
+		const float* values = texels.channels[channel];
+		float minimum = 255.0f, maximum = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			minimum = std::min(minimum, values[i]);
+			maximum = std::max(maximum, values[i]);
+		}
+
+		Bc4Candidate best = EvaluateBc4(texels, channel, int(maximum + 0.5f), int(minimum + 0.5f), false);
+		RefineBc4(texels, channel, GetRefitCount(quality), false, best);
+
+		if (quality == BlockQuality::Best)
+		{
+			// Blocks reaching 0 or 255 can spend all 6 interpolated values on the rest.
+			float innerMinimum = 255.0f, innerMaximum = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				if (values[i] > 0.0f && values[i] < 255.0f)
+				{
+					innerMinimum = std::min(innerMinimum, values[i]);
+					innerMaximum = std::max(innerMaximum, values[i]);
+				}
+			}
+			if (innerMinimum <= innerMaximum)
+			{
+				Bc4Candidate candidate = EvaluateBc4(texels, channel, int(innerMinimum + 0.5f), int(innerMaximum + 0.5f), true);
+				RefineBc4(texels, channel, GetRefitCount(quality), true, candidate);
+				if (candidate.error < best.error)
+					best = candidate;
+			}
+		}
+
+		uint64_t indexBits = 0;
+		for (int i = 0; i < 16; ++i)
+			indexBits |= uint64_t(best.indices[i]) << (i * 3);
+		out[0] = best.endpoint0;
+		out[1] = best.endpoint1;
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = uint8_t(indexBits >> (i * 8));
+	}
+
+// =====================================================================================
+//										BC7 mode 6
+// =====================================================================================
+
+	struct Bc7Candidate
+	{
+		// 7 bit endpoint values + one p-bit per endpoint: decoded = value << 1 | pbit.
+		uint8_t endpoints[2][4];
+		uint8_t pbits[2];
+		uint8_t indices[16];
+		float error;
+	};
+
+	void QuantizeBc7Endpoint(const float* value, int pbit, uint8_t* quantized, float& error)
+	{
+		error = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			quantized[c] = uint8_t(Clamp(int((value[c] - float(pbit)) * 0.5f + 0.5f), 0, 127));
+			const float difference = float((quantized[c] << 1) | pbit) - value[c];
+			error += difference * difference;
+		}
+	}
+
+	// "pbits" = -1 picks each endpoint's p-bit by its own quantization error, 0..3 forces
+	//		the combination (bit 0: endpoint 0, bit 1: endpoint 1).
+	Bc7Candidate EvaluateBc7(const BlockTexels& texels, const float* e0, const float* e1, int pbits)
+	{
+		Bc7Candidate candidate;
+		const float* endpoints[2] = { e0, e1 };
+		for (int e = 0; e < 2; ++e)
+		{
+			if (pbits < 0)
+			{
+				uint8_t quantized[4];
+				float error0, error1;
+				QuantizeBc7Endpoint(endpoints[e], 0, candidate.endpoints[e], error0);
+				QuantizeBc7Endpoint(endpoints[e], 1, quantized, error1);
+				candidate.pbits[e] = error1 < error0 ? 1 : 0;
+				if (candidate.pbits[e])
+					std::memcpy(candidate.endpoints[e], quantized, 4);
+			}
+			else
+			{
+				float error;
+				candidate.pbits[e] = uint8_t((pbits >> e) & 1);
+				QuantizeBc7Endpoint(endpoints[e], candidate.pbits[e], candidate.endpoints[e], error);
+			}
+		}
+
+		// Exactly the decoder's integer interpolation.
+		Palette palette;
+		palette.size = 16;
+		for (int c = 0; c < 4; ++c)
+		{
+			const int a = (candidate.endpoints[0][c] << 1) | candidate.pbits[0];
+			const int b = (candidate.endpoints[1][c] << 1) | candidate.pbits[1];
+			for (int k = 0; k < 16; ++k)
+				palette.entries[k][c] = float(((64 - BC7_WEIGHTS4[k]) * a + BC7_WEIGHTS4[k] * b + 32) >> 6);
+		}
+
+		candidate.error = FindNearestEntries<4>(texels, 0, palette, candidate.indices);
+		return candidate;
+	}
+
+	// Little endian bit stream over the 128 bit block.
+	struct BlockBitWriter
+	{
+		uint64_t words[2] = {};
+		uint32_t position = 0;
+
+		void Write(uint64_t value, uint32_t count)
+		{
+			const uint32_t word = position >> 6, shift = position & 63;
+			words[word] |= value << shift;
+			if (shift + count > 64)
+				words[word + 1] |= value >> (64 - shift);
+			position += count;
+		}
+	};
+
+	void EncodeBc7Mode6(const BlockTexels& texels, BlockQuality quality, uint8_t* out)
+	{
+		float lo[4], hi[4];
+		ComputeEndpoints(texels, 0, 4, nullptr, lo, hi);
+
+		Bc7Candidate best = EvaluateBc7(texels, lo, hi, -1);
+		if (quality == BlockQuality::Best)
+		{
+			for (int pbits = 0; pbits < 4; ++pbits)
+			{
+				const Bc7Candidate candidate = EvaluateBc7(texels, lo, hi, pbits);
+				if (candidate.error < best.error)
+					best = candidate;
+			}
+		}
+
+		float weights[16];
+		for (int k = 0; k < 16; ++k)
+			weights[k] = BC7_WEIGHTS4[k] / 64.0f;
+		for (int refit = 0; refit < GetRefitCount(quality); ++refit)
+		{
+			float e0[4], e1[4];
+			if (!RefitEndpoints(texels, 0, 4, best.indices, weights, e0, e1))
+				break;
+			Bc7Candidate candidate = EvaluateBc7(texels, e0, e1, -1);
+			if (quality == BlockQuality::Best)
+			{
+				for (int pbits = 0; pbits < 4; ++pbits)
+				{
+					const Bc7Candidate other = EvaluateBc7(texels, e0, e1, pbits);
+					if (other.error < candidate.error)
+						candidate = other;
+				}
+			}
+			if (candidate.error >= best.error)
+				break;
+			best = candidate;
+		}
+
+		// The first index is stored with 3 bits, its top bit implied 0: mirror the palette
+		//		if needed.
+		if (best.indices[0] & 8)
+		{
+			std::swap(best.endpoints[0], best.endpoints[1]);
+			std::swap(best.pbits[0], best.pbits[1]);
+			for (int i = 0; i < 16; ++i)
+				best.indices[i] = uint8_t(15 - best.indices[i]);
+		}
+
+		BlockBitWriter writer;
+		writer.Write(1 << 6, 7);	// mode 6: six 0 bits, then a 1
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(best.endpoints[0][c], 7);
+			writer.Write(best.endpoints[1][c], 7);
+		}
+		writer.Write(best.pbits[0], 1);
+		writer.Write(best.pbits[1], 1);
+		writer.Write(best.indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+			writer.Write(best.indices[i], 4);
+		std::memcpy(out, writer.words, 16);
+	}
+}
+
+// =====================================================================================
+//										Kernels
+// =====================================================================================
+
+bool IsBlockKernelSupported(BlockKernel kernel)
+{
+	switch (kernel)
+	{
+	case BlockKernel::Scalar:
+		return true;
+	case BlockKernel::SSE2:
+#if defined(BLOCK_COMPRESSION_SSE2)
+		return true;
+#else
+		return false;
+#endif
+	case BlockKernel::AVX2:
+		return BlockCompressionDetail::IsAVX2Supported();
+	}
+	return false;
+}
+
+bool SetBlockKernel(BlockKernel kernel)
+{
+	if (!IsBlockKernelSupported(kernel))
+		return false;
+	g_BlockKernel.store(kernel, std::memory_order_relaxed);
+	return true;
+}
+
+BlockKernel GetBlockKernel()
+{
+	return g_BlockKernel.load(std::memory_order_relaxed);
+}
+
+// =====================================================================================
+//										Blocks
+// =====================================================================================
+
+size_t GetBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+void CompressBlock(BlockFormat format, BlockQuality quality, const uint8_t* rgba, uint8_t* out)
+{
+	BlockTexels texels;
+	LoadTexels(rgba, texels);
+
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		EncodeBc1Color(texels, quality, true, out);
+		break;
+	case BlockFormat::BC3:
+		EncodeBc4Channel(texels, 3, quality, out);
+		EncodeBc1Color(texels, quality, false, out + 8);
+		break;
+	case BlockFormat::BC4:
+		EncodeBc4Channel(texels, 0, quality, out);
+		break;
+	case BlockFormat::BC5:
+		EncodeBc4Channel(texels, 0, quality, out);
+		EncodeBc4Channel(texels, 1, quality, out + 8);
+		break;
+	case BlockFormat::BC7:
+		EncodeBc7Mode6(texels, quality, out);
+		break;
+	}
+}
+
+void CompressImage(BlockFormat format, BlockQuality quality, const uint8_t* rgba, uint32_t width, uint32_t height,
+	size_t rowPitch, uint8_t* out, size_t outRowPitch, TaskScheduler* scheduler)
+{
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const size_t blockSize = GetBlockSize(format);
+
+	auto compressRows = [&](size_t begin, size_t end)
+	{
+		uint8_t block[64];
+		for (size_t blockY = begin; blockY < end; ++blockY)
+		{
+			uint8_t* outRow = out + blockY * outRowPitch;
+			for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+			{
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const uint32_t sourceY = std::min(uint32_t(blockY) * 4 + y, height - 1);
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						const uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+						std::memcpy(&block[(y * 4 + x) * 4], rgba + sourceY * rowPitch + size_t(sourceX) * 4, 4);
+					}
+				}
+				CompressBlock(format, quality, block, outRow + blockX * blockSize);
+			}
+		}
+	};
+
+	// One block row per task: a row of a 2048 texel wide texture is 512 blocks, plenty to
+	//		amortize the task.
+	if (scheduler)
+		scheduler->ParallelFor(0, blocksHigh, 1, compressRows);
+	else
+		compressRows(0, blocksHigh);
+}
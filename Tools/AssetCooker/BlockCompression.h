@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class TaskScheduler;
+
+// =====================================================================================
+//									Block compression
+// =====================================================================================
+
+// CPU encoders for the BCn formats. Every format stores 4x4 texel blocks in 8 or 16 bytes,
+//		which the texture units decode on the fly - 4:1 to 8:1 less memory and bandwidth
+//		than RGBA8:
+//		- BC1: RGB as two RGB565 endpoints + 2 bit indices (optionally 1 bit alpha),
+//		- BC4: one channel as two 8 bit endpoints + 3 bit indices,
+//		- BC3: BC4 alpha + BC1 color, BC5: BC4 red + BC4 green (normal maps),
+//		- BC7: here mode 6 only: RGBA with 7 bit + shared p-bit endpoints and 4 bit indices,
+//		  one subset. The other modes add partitions for blocks with several distinct
+//		  colors; mode 6 alone is the usual fast setting of BC7 encoders.
+//
+// All encoders follow the same plan: principal axis of the block's colors (power iteration
+//		on the covariance), endpoints at the extremes along it, indices by nearest palette
+//		entry, then least squares refits of the endpoints to the chosen indices. The nearest
+//		palette search is the hot loop - it runs on 8 texels per AVX2 instruction (4 with
+//		SSE2), see BlockKernel.
+enum class BlockFormat : uint8_t
+{
+	BC1,
+	BC3,
+	BC4,
+	BC5,
+	BC7,
+};
+
+// Trade of encoding time against error:
+//		Fast	one pass, endpoints inset from the extremes,
+//		Normal	plus a least squares refit,
+//		Best	several refits, endpoint search (BC1 +-1 steps, BC7 all p-bit combinations)
+//				and BC4's 6 value mode.
+enum class BlockQuality : uint8_t
+{
+	Fast,
+	Normal,
+	Best,
+};
+
+// Implementations of the nearest palette search:
+//		Scalar	plain C++,
+//		SSE2	4 texels per instruction, compiled in on x86/x64 (the baseline there),
+//		AVX2	8 texels per instruction, in BlockCompressionAVX2.cpp - the only file built
+//				with /arch:AVX2 - and used when the CPU supports AVX2.
+// All of them produce the same blocks bit for bit; the choice only changes the speed.
+enum class BlockKernel : uint8_t
+{
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+// True if "kernel" was compiled in and the CPU supports it.
+bool IsBlockKernelSupported(BlockKernel kernel);
+// The kernel every encoder uses from now on, on every thread. Defaults to the fastest
+//		supported one; unsupported kernels are ignored (returns false). For tests and
+//		benchmarks - there is no reason to pick a slower one otherwise.
+bool SetBlockKernel(BlockKernel kernel);
+BlockKernel GetBlockKernel();
+
+// Bytes per 4x4 block: 8 for BC1 and BC4, 16 for the others.
+size_t GetBlockSize(BlockFormat format);
+
+// One block: "rgba" is 16 texels, row major, 4 bytes each. BC4 encodes red, BC5 red and
+//		green; BC1 turns texels with alpha < 128 transparent (1 bit alpha mode) if any.
+void CompressBlock(BlockFormat format, BlockQuality quality, const uint8_t* rgba, uint8_t* out);
+
+// A whole RGBA8 image, rows "rowPitch" bytes apart, into rows of blocks "outRowPitch"
+//		bytes apart. Partial blocks at the right and bottom edges repeat the last column /
+//		row. Block rows are spread over "scheduler" (nullptr: all on this thread).
+void CompressImage(BlockFormat format, BlockQuality quality, const uint8_t* rgba, uint32_t width, uint32_t height,
+	size_t rowPitch, uint8_t* out, size_t outRowPitch, TaskScheduler* scheduler);
+
+// Between BlockCompression.cpp and BlockCompressionAVX2.cpp only. Raw arrays rather than
+//		the encoder's structs keep the latter's inline functions out of the AVX2 file.
+namespace BlockCompressionDetail
+{
+	bool IsAVX2Supported();
+	// errors[i] / nearest[i]: squared distance to and index of the nearest of the
+	//		"paletteSize" entries over "channelCount" (1, 3 or 4) channels, for the 16
+	//		texels of "channels" (32 byte aligned). Ties go to the lower index.
+	void FindNearestEntriesAVX2(const float (*channels)[16], int channelCount, const float (*entries)[4],
+		int paletteSize, float* errors, int32_t* nearest);
+}
@@ -0,0 +1,90 @@
+// The AVX2 nearest palette search of the BCn encoders. This is the only cooker file
+//		compiled with /arch:AVX2 (-mavx2): the rest keeps the baseline instruction set, and
+//		the encoders use this kernel only when the CPU supports it
+//		(IsBlockKernelSupported(BlockKernel::AVX2)).
+//
+// Keep inline functions shared with other files out of here (std::min, std::max,
+//		std::vector accessors): the compiler emits an AVX2 copy of every one this file
+//		uses, and the linker is free to keep that copy for the whole program.
+#include "BlockCompression.h"
+
+#include "Framework/CpuTopology.h"
+
+#include <cfloat> // FLT_MAX
+
+// MSVC defines __AVX2__ for /arch:AVX2, GCC/Clang for -mavx2.
+#if defined(__AVX2__)
+#define BLOCK_COMPRESSION_AVX2 1
+#include <immintrin.h>
+#endif
+
+bool BlockCompressionDetail::IsAVX2Supported()
+{
+#if defined(BLOCK_COMPRESSION_AVX2)
+	return CpuFeatures::Get().avx2;
+#else
+	return false;
+#endif
+}
+
+#if defined(BLOCK_COMPRESSION_AVX2)
+
+namespace
+{
+	// Same as the scalar loop of FindNearestEntries, 8 texels per register: the palette
+	//		loop runs twice per block. The squared distances are summed in the same order,
+	//		so errors and indices match the scalar kernel exactly.
+	template<int CHANNELS>
+	void FindNearestEntries(const float (*channels)[16], const float (*entries)[4], int paletteSize,
+		float* errors, int32_t* nearest)
+	{
+		for (int half = 0; half < 16; half += 8)
+		{
+			__m256 texel[CHANNELS];
+			for (int c = 0; c < CHANNELS; ++c)
+				texel[c] = _mm256_load_ps(&channels[c][half]);
+
+			__m256 bestError = _mm256_set1_ps(FLT_MAX);
+			__m256 bestIndex = _mm256_setzero_ps();
+			for (int k = 0; k < paletteSize; ++k)
+			{
+				__m256 error = _mm256_setzero_ps();
+				for (int c = 0; c < CHANNELS; ++c)
+				{
+					const __m256 difference = _mm256_sub_ps(texel[c], _mm256_set1_ps(entries[k][c]));
+					error = _mm256_add_ps(error, _mm256_mul_ps(difference, difference));
+				}
+				const __m256 closer = _mm256_cmp_ps(error, bestError, _CMP_LT_OQ);
+				bestError = _mm256_min_ps(error, bestError);
+				bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(float(k)), closer);
+			}
+			_mm256_store_ps(&errors[half], bestError);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&nearest[half]), _mm256_cvttps_epi32(bestIndex));
+		}
+	}
+}
+
+void BlockCompressionDetail::FindNearestEntriesAVX2(const float (*channels)[16], int channelCount,
+	const float (*entries)[4], int paletteSize, float* errors, int32_t* nearest)
+{
+	switch (channelCount)
+	{
+	case 1:
+		FindNearestEntries<1>(channels, entries, paletteSize, errors, nearest);
+		break;
+	case 3:
+		FindNearestEntries<3>(channels, entries, paletteSize, errors, nearest);
+		break;
+	case 4:
+		FindNearestEntries<4>(channels, entries, paletteSize, errors, nearest);
+		break;
+	}
+}
+
+#else
+
+void BlockCompressionDetail::FindNearestEntriesAVX2(const float (*)[16], int, const float (*)[4], int, float*, int32_t*)
+{
+}
+
+#endif
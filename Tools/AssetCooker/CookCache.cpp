@@ -0,0 +1,239 @@
+#include "CookCache.h"
+#include "CookerUtils.h"
+
+#include "Framework/Hash.h"
+#include "Framework/MappedFile.h"
+
+#include <cinttypes> // PRIx64
+#include <cstdio>
+#include <cstdlib>   // std::strtoull, std::strtoll
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+
+// =====================================================================================
+//										Index file
+// =====================================================================================
+
+// Text, one record per line, fields separated by tabs (file names don't contain any):
+//		K <key> <package hash>
+//		F <path> <size> <write time> <hash>
+//		D <source> <dependency>...
+// Unknown or malformed lines are skipped, a wrong header discards the whole index.
+
+namespace
+{
+	const char CACHE_INDEX_HEADER[] = "DXCOOKCACHE 1";
+
+	std::vector<std::string> SplitFields(const std::string& line)
+	{
+		std::vector<std::string> fields;
+		size_t start = 0;
+		for (;;)
+		{
+			const size_t tab = line.find('\t', start);
+			fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+			if (tab == std::string::npos)
+				return fields;
+			start = tab + 1;
+		}
+	}
+
+	std::string ToHex(uint64_t value)
+	{
+		char text[17];
+		std::snprintf(text, sizeof(text), "%016" PRIx64, value);
+		return text;
+	}
+
+	uint64_t FromHex(const std::string& text)
+	{
+		return std::strtoull(text.c_str(), nullptr, 16);
+	}
+}
+
+CookCache::CookCache(const std::string& directory)
+	: m_Directory(directory)
+{
+}
+
+bool CookCache::Load()
+{
+	std::ifstream file(fs::path(m_Directory) / "index.txt");
+	std::string line;
+	if (!file || !std::getline(file, line) || line != CACHE_INDEX_HEADER)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	while (std::getline(file, line))
+	{
+		const std::vector<std::string> fields = SplitFields(line);
+		if (fields[0] == "K" && fields.size() == 3)
+		{
+			m_Keys[FromHex(fields[1])] = FromHex(fields[2]);
+		}
+		else if (fields[0] == "F" && fields.size() == 5)
+		{
+			FileRecord record;
+			record.size = std::strtoull(fields[2].c_str(), nullptr, 10);
+			record.writeTime = std::strtoll(fields[3].c_str(), nullptr, 10);
+			record.hash = FromHex(fields[4]);
+			m_Files[fields[1]] = record;
+		}
+		else if (fields[0] == "D" && fields.size() >= 2)
+		{
+			m_Dependencies[fields[1]].assign(fields.begin() + 2, fields.end());
+		}
+	}
+	return true;
+}
+
+void CookCache::Save() const
+{
+	std::string text = CACHE_INDEX_HEADER;
+	text += '\n';
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (const auto& key : m_Keys)
+	{
+		text += "K\t" + ToHex(key.first) + '\t' + ToHex(key.second) + '\n';
+	}
+	for (const auto& file : m_Files)
+	{
+		text += "F\t" + file.first + '\t' + std::to_string(file.second.size) + '\t' +
+			std::to_string(file.second.writeTime) + '\t' + ToHex(file.second.hash) + '\n';
+	}
+	for (const auto& source : m_Dependencies)
+	{
+		if (source.second.empty())
+			continue;
+		text += "D\t" + source.first;
+		for (const std::string& dependency : source.second)
+			text += '\t' + dependency;
+		text += '\n';
+	}
+
+	WriteFileAtomic((fs::path(m_Directory) / "index.txt").string(), text.data(), text.size());
+}
+
+// =====================================================================================
+//										Files
+// =====================================================================================
+
+uint64_t CookCache::HashFile(const std::string& path)
+{
+	std::error_code error;
+	const uint64_t size = fs::file_size(path, error);
+	const int64_t writeTime = error ? 0 : int64_t(fs::last_write_time(path, error).time_since_epoch().count());
+	if (error)
+		throw std::runtime_error("can't open " + path);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const auto known = m_Files.find(path);
+		if (known != m_Files.end() && known->second.size == size && known->second.writeTime == writeTime)
+			return known->second.hash;
+	}
+
+	MappedFile file;
+	if (!file.Open(path.c_str(), true))
+		throw std::runtime_error("can't open " + path);
+	const uint64_t hash = HashXXH64(file.GetData(), file.GetSize());
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Files[path] = FileRecord{ uint64_t(file.GetSize()), writeTime, hash };
+	return hash;
+}
+
+std::vector<std::string> CookCache::GetDependencies(const std::string& source) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	const auto dependencies = m_Dependencies.find(source);
+	return dependencies != m_Dependencies.end() ? dependencies->second : std::vector<std::string>();
+}
+
+void CookCache::SetDependencies(const std::string& source, const std::vector<std::string>& dependencies)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Dependencies[source] = dependencies;
+}
+
+// =====================================================================================
+//										Packages
+// =====================================================================================
+
+std::string CookCache::GetObjectPath(uint64_t packageHash) const
+{
+	// 256 subdirectories keep the directories small on big projects.
+	const std::string name = ToHex(packageHash);
+	return (fs::path(m_Directory) / "objects" / name.substr(0, 2) / (name + ".pkg")).string();
+}
+
+bool CookCache::Lookup(uint64_t key, uint64_t& packageHash) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	const auto found = m_Keys.find(key);
+	if (found == m_Keys.end())
+		return false;
+	packageHash = found->second;
+	return true;
+}
+
+bool CookCache::Restore(uint64_t packageHash, const std::string& path) const
+{
+	MappedFile object;
+	if (!object.Open(GetObjectPath(packageHash).c_str(), true))
+		return false;
+	// A damaged object is a miss, not a broken output.
+	if (HashXXH64(object.GetData(), object.GetSize()) != packageHash)
+		return false;
+
+	WriteFileAtomic(path, object.GetData(), object.GetSize());
+	return true;
+}
+
+uint64_t CookCache::Store(uint64_t key, const std::vector<uint8_t>& package, bool* deduplicated)
+{
+	const uint64_t packageHash = HashXXH64(package.data(), package.size());
+	const std::string objectPath = GetObjectPath(packageHash);
+
+	bool write;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Keys[key] = packageHash;
+		write = !m_Objects.count(packageHash) && !m_ObjectsInFlight.count(packageHash);
+		if (write)
+		{
+			std::error_code error;
+			write = !fs::exists(objectPath, error);
+			if (write)
+				m_ObjectsInFlight.insert(packageHash);
+			else
+				m_Objects.insert(packageHash);
+		}
+	}
+	if (deduplicated)
+		*deduplicated = !write;
+	if (!write)
+		return packageHash;
+
+	try
+	{
+		WriteFileAtomic(objectPath, package.data(), package.size());
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_ObjectsInFlight.erase(packageHash);
+		m_Keys.erase(key);
+		throw;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_ObjectsInFlight.erase(packageHash);
+	m_Objects.insert(packageHash);
+	return packageHash;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// =====================================================================================
+//										Cook cache
+// =====================================================================================
+
+// Content addressed store of cooked packages, the cooker's incremental build state.
+//
+// Every cook is identified by a key: XXH64 over the settings hash (which covers the
+//		package format and cooker versions), the bytes of the source and the bytes of every
+//		file the source pulled in last time (glTF buffers, ...). The key maps to the hash
+//		of the package it produced, and packages are stored once per distinct content:
+//
+//		<directory>/index.txt				keys, dependency lists, file hash memo
+//		<directory>/objects/ab/<hash>.pkg	one file per distinct package
+//
+// So an asset is only cooked if that exact input was never cooked before - reverting an
+//		edit, switching branches or copying a source file all hit the cache - and
+//		identical outputs share one object.
+//
+// Hashing a file memory maps it once; the hash is remembered together with the file's
+//		size and modification time, so unchanged files aren't read again on later runs.
+//
+// All member functions are thread safe; cook tasks use one cache concurrently.
+class CookCache
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	explicit CookCache(const std::string& directory);
+	CookCache(const CookCache&) = delete;
+	CookCache& operator=(const CookCache&) = delete;
+
+	// Reads the index. False if there is none (or it is unreadable): the cache starts empty.
+	bool Load();
+	// Writes the index atomically. Throws on failure.
+	void Save() const;
+
+	// XXH64 of the file's bytes. Throws if the file can't be read.
+	uint64_t HashFile(const std::string& path);
+
+	// Files "source" read while it was cooked last time, empty if unknown.
+	std::vector<std::string> GetDependencies(const std::string& source) const;
+	void SetDependencies(const std::string& source, const std::vector<std::string>& dependencies);
+
+	// Hash of the package cooked for "key", false if there is none.
+	bool Lookup(uint64_t key, uint64_t& packageHash) const;
+	// Writes the stored package to "path". False if it isn't in the cache (any more).
+	bool Restore(uint64_t packageHash, const std::string& path) const;
+	// Records a freshly cooked package for "key" and returns its hash. "deduplicated" is
+	//		set if an identical package was already stored. Throws if it can't be written.
+	uint64_t Store(uint64_t key, const std::vector<uint8_t>& package, bool* deduplicated = nullptr);
+
+private:
+	std::string GetObjectPath(uint64_t packageHash) const;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	struct FileRecord
+	{
+		uint64_t size;
+		int64_t writeTime;
+		uint64_t hash;
+	};
+
+	std::string m_Directory;
+
+	mutable std::mutex m_Mutex;
+	// Cook key -> package hash.
+	std::unordered_map<uint64_t, uint64_t> m_Keys;
+	std::unordered_map<std::string, std::vector<std::string>> m_Dependencies;
+	std::unordered_map<std::string, FileRecord> m_Files;
+	// Objects known to be stored, and those another task is writing right now.
+	std::unordered_set<uint64_t> m_Objects;
+	std::unordered_set<uint64_t> m_ObjectsInFlight;
+};
@@ -0,0 +1,80 @@
+#include "CookerUtils.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+
+// =====================================================================================
+//										Files
+// =====================================================================================
+
+std::vector<uint8_t> ReadFileBytes(const std::string& path)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		throw std::runtime_error("can't open " + path);
+
+	std::vector<uint8_t> data;
+	uint8_t buffer[64 * 1024];
+	size_t read;
+	while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + read);
+	}
+	const bool failed = std::ferror(file) != 0;
+	std::fclose(file);
+
+	if (failed)
+		throw std::runtime_error("can't read " + path);
+	return data;
+}
+
+void WriteFileAtomic(const std::string& path, const void* data, size_t size)
+{
+	const fs::path target(path);
+	if (target.has_parent_path())
+	{
+		fs::create_directories(target.parent_path());
+	}
+
+	const std::string temporary = path + ".tmp";
+	FILE* file = std::fopen(temporary.c_str(), "wb");
+	if (!file)
+		throw std::runtime_error("can't create " + temporary);
+
+	const bool written = std::fwrite(data, 1, size, file) == size;
+	const bool closed = std::fclose(file) == 0;
+	if (!written || !closed)
+	{
+		std::remove(temporary.c_str());
+		throw std::runtime_error("can't write " + temporary);
+	}
+
+	// Replaces an existing file on POSIX and Windows alike.
+	std::error_code error;
+	fs::rename(temporary, target, error);
+	if (error)
+	{
+		std::remove(temporary.c_str());
+		throw std::runtime_error("can't replace " + path + ": " + error.message());
+	}
+}
+
+// =====================================================================================
+//										Hashing
+// =====================================================================================
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
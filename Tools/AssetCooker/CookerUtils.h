@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =====================================================================================
+//									Cooker utilities
+// =====================================================================================
+
+// The cooker reports errors by throwing std::runtime_error with a readable message; the
+//		driver catches them per asset, so one broken source file doesn't stop the build.
+
+// Reads a whole file. Throws if it can't be opened or read.
+std::vector<uint8_t> ReadFileBytes(const std::string& path);
+
+// Writes to "path.tmp" and renames it over "path", so an interrupted cook never leaves a
+//		truncated package that looks up to date. Creates missing directories. Throws on failure.
+void WriteFileAtomic(const std::string& path, const void* data, size_t size);
+
+// FNV-1a, 64 bit - for the small settings blocks of the incremental build checks.
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+template<typename T>
+uint64_t HashValue(const T& value, uint64_t seed = 0xcbf29ce484222325ull)
+{
+	return HashBytes(&value, sizeof(T), seed);
+}
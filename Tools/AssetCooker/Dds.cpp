@@ -0,0 +1,153 @@
+#include "Dds.h"
+
+#include <cstring> // std::memcpy
+
+
+// =====================================================================================
+//										Headers
+// =====================================================================================
+
+namespace
+{
+	const uint32_t DDS_MAGIC = 0x20534444;	// "DDS "
+	const uint32_t DDS_FOURCC_DX10 = 0x30315844;	// "DX10"
+
+	// DDS_HEADER flags.
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PITCH = 0x8;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	// DDS_PIXELFORMAT flags.
+	const uint32_t DDPF_FOURCC = 0x4;
+	// Caps.
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+	const uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t bitMasks[4];
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+	static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER is 124 bytes.");
+
+	struct DdsHeaderDx10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+	static_assert(sizeof(DdsHeaderDx10) == 20, "DDS_HEADER_DXT10 is 20 bytes.");
+
+	// Bytes per 4x4 block, 0 for the uncompressed formats.
+	uint32_t GetFormatBlockSize(uint32_t format)
+	{
+		switch (format)
+		{
+		case COOKED_FORMAT_BC1_UNORM:
+		case COOKED_FORMAT_BC1_UNORM_SRGB:
+		case COOKED_FORMAT_BC4_UNORM:
+			return 8;
+		case COOKED_FORMAT_BC3_UNORM:
+		case COOKED_FORMAT_BC3_UNORM_SRGB:
+		case COOKED_FORMAT_BC5_UNORM:
+		case COOKED_FORMAT_BC7_UNORM:
+		case COOKED_FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// Bytes of one unpadded row - of texels, or of blocks.
+	size_t GetPackedRowSize(uint32_t format, uint32_t width)
+	{
+		const uint32_t blockSize = GetFormatBlockSize(format);
+		return blockSize ? size_t((width + 3) / 4) * blockSize : size_t(width) * 4;
+	}
+}
+
+// =====================================================================================
+//										Writer
+// =====================================================================================
+
+void WriteDds(const CookedTexture& texture, std::vector<uint8_t>& outFile)
+{
+	const TextureAssetHeader& header = texture.header;
+	const bool blockCompressed = GetFormatBlockSize(header.format) != 0;
+	const bool mipmapped = header.mipCount > 1;
+
+	DdsHeader dds = {};
+	dds.size = sizeof(DdsHeader);
+	dds.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | (blockCompressed ? DDSD_LINEARSIZE : DDSD_PITCH) |
+		(mipmapped ? DDSD_MIPMAPCOUNT : 0);
+	dds.height = header.height;
+	dds.width = header.width;
+	// Pitch: bytes per row; linear size: bytes of the whole top mip.
+	dds.pitchOrLinearSize = uint32_t(GetPackedRowSize(header.format, header.width) *
+		(blockCompressed ? (header.height + 3) / 4 : 1));
+	dds.depth = 1;
+	dds.mipMapCount = header.mipCount;
+	dds.pixelFormat.size = sizeof(DdsPixelFormat);
+	dds.pixelFormat.flags = DDPF_FOURCC;
+	dds.pixelFormat.fourCC = DDS_FOURCC_DX10;
+	dds.caps = DDSCAPS_TEXTURE | (mipmapped ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	DdsHeaderDx10 dx10 = {};
+	dx10.dxgiFormat = header.format;
+	dx10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+	dx10.arraySize = header.arraySize;
+
+	size_t size = sizeof(DDS_MAGIC) + sizeof(dds) + sizeof(dx10);
+	for (const TextureAssetSubresource& subresource : texture.subresources)
+		size += GetPackedRowSize(header.format, subresource.width) * subresource.rowCount;
+
+	outFile.resize(size);
+	uint8_t* out = outFile.data();
+	std::memcpy(out, &DDS_MAGIC, sizeof(DDS_MAGIC));
+	out += sizeof(DDS_MAGIC);
+	std::memcpy(out, &dds, sizeof(dds));
+	out += sizeof(dds);
+	std::memcpy(out, &dx10, sizeof(dx10));
+	out += sizeof(dx10);
+
+	// The package's subresource order (slice major, D3D12 subresource index order) is the
+	//		DDS order already; only the row padding goes.
+	for (const TextureAssetSubresource& subresource : texture.subresources)
+	{
+		const size_t rowSize = GetPackedRowSize(header.format, subresource.width);
+		for (uint32_t row = 0; row < subresource.rowCount; ++row)
+		{
+			std::memcpy(out, &texture.data[subresource.offset + size_t(row) * subresource.rowPitch], rowSize);
+			out += rowSize;
+		}
+	}
+}
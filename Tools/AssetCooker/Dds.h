@@ -0,0 +1,19 @@
+#pragma once
+
+#include "TextureCooker.h"
+
+#include <cstdint>
+#include <vector>
+
+// =====================================================================================
+//										DDS output
+// =====================================================================================
+
+// DirectDraw Surface with the DX10 extension header: the format every texture tool reads
+//		(texconv, RenderDoc, image viewers) and DirectXTK's DDSTextureLoader loads. The
+//		cooker writes it with --dds instead of a texture package, for inspecting encoder
+//		output or feeding other tools.
+//
+// Layout: "DDS ", the 124 byte header, the 20 byte DX10 header with the DXGI format, then
+//		the subresources tightly packed - slice by slice, every mip of a slice in order.
+void WriteDds(const CookedTexture& texture, std::vector<uint8_t>& outFile);
@@ -0,0 +1,629 @@
+#include "MeshImporter.h"
+#include "Json.h"
+
+#include "Framework/MappedFile.h"
+
+#include <cmath>
+#include <cstring> // std::memcpy
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+using namespace DirectX;
+
+
+// =====================================================================================
+//										glTF buffers
+// =====================================================================================
+
+namespace
+{
+	constexpr uint32_t GLB_MAGIC = 0x46546C67;		// "glTF"
+	constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;	// "JSON"
+	constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;	// "BIN\0"
+
+	enum GltfComponentType
+	{
+		GLTF_BYTE = 5120,
+		GLTF_UNSIGNED_BYTE = 5121,
+		GLTF_SHORT = 5122,
+		GLTF_UNSIGNED_SHORT = 5123,
+		GLTF_UNSIGNED_INT = 5125,
+		GLTF_FLOAT = 5126,
+	};
+
+	constexpr int GLTF_MODE_TRIANGLES = 4;
+
+	// A buffer's bytes: the GLB binary chunk, an external file mapped in place, or a
+	//		decoded data URI.
+	struct GltfBuffer
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		MappedFile mapped;
+		std::vector<uint8_t> decoded;
+	};
+
+	struct GltfDocument
+	{
+		JsonValue json;
+		std::vector<std::unique_ptr<GltfBuffer>> buffers;
+	};
+
+	uint32_t ReadUint32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	size_t GetIndex(const JsonValue& object, const char* key, size_t count)
+	{
+		const double value = object.GetNumber(key, -1.0);
+		if (value < 0.0 || value >= double(count) || value != std::floor(value))
+			throw std::runtime_error(std::string("invalid ") + key + " index");
+		return size_t(value);
+	}
+
+	const JsonValue& GetArrayElement(const JsonValue& root, const char* key, size_t index)
+	{
+		const JsonValue* array = root.Find(key);
+		if (!array || index >= array->Size())
+			throw std::runtime_error(std::string("missing ") + key + " entry");
+		return (*array)[index];
+	}
+
+	std::vector<uint8_t> DecodeBase64(const char* p, const char* end)
+	{
+		std::vector<uint8_t> bytes;
+		bytes.reserve(size_t(end - p) / 4 * 3);
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (; p < end && *p != '='; ++p)
+		{
+			const char c = *p;
+			const int value = c >= 'A' && c <= 'Z' ? c - 'A' :
+				c >= 'a' && c <= 'z' ? c - 'a' + 26 :
+				c >= '0' && c <= '9' ? c - '0' + 52 :
+				c == '+' ? 62 : c == '/' ? 63 : -1;
+			if (value < 0)
+				throw std::runtime_error("invalid base64 data");
+			bits = (bits << 6) | uint32_t(value);
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				bytes.push_back(uint8_t(bits >> bitCount));
+			}
+		}
+		return bytes;
+	}
+
+	// URIs are percent encoded ("my%20model.bin").
+	std::string DecodeUri(const std::string& uri)
+	{
+		std::string path;
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size())
+			{
+				path += char(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			}
+			else
+			{
+				path += uri[i];
+			}
+		}
+		return path;
+	}
+
+	void LoadBuffers(GltfDocument& document, const uint8_t* glbBinary, size_t glbBinarySize, const std::string& baseDirectory,
+		std::vector<std::string>* dependencies)
+	{
+		const JsonValue* buffers = document.json.Find("buffers");
+		if (!buffers)
+			return;
+
+		for (size_t i = 0; i < buffers->Size(); ++i)
+		{
+			const JsonValue& description = (*buffers)[i];
+			std::unique_ptr<GltfBuffer> buffer(new GltfBuffer());
+			const std::string* uri = description.GetString("uri");
+			if (!uri)
+			{
+				// The first buffer of a GLB without a URI is the binary chunk.
+				if (i != 0 || !glbBinary)
+					throw std::runtime_error("buffer without uri");
+				buffer->data = glbBinary;
+				buffer->size = glbBinarySize;
+			}
+			else if (uri->compare(0, 5, "data:") == 0)
+			{
+				const size_t base64 = uri->find(";base64,");
+				if (base64 == std::string::npos)
+					throw std::runtime_error("unsupported data uri");
+				const char* begin = uri->c_str() + base64 + 8;
+				buffer->decoded = DecodeBase64(begin, uri->c_str() + uri->size());
+				buffer->data = buffer->decoded.data();
+				buffer->size = buffer->decoded.size();
+			}
+			else
+			{
+				const std::string path = (fs::path(baseDirectory) / fs::u8path(DecodeUri(*uri))).lexically_normal().string();
+				if (dependencies)
+					dependencies->push_back(path);
+				// Accessors jump around in the buffer.
+				if (!buffer->mapped.Open(path.c_str(), false))
+					throw std::runtime_error("can't open buffer " + path);
+				buffer->data = buffer->mapped.GetData();
+				buffer->size = buffer->mapped.GetSize();
+			}
+
+			if (buffer->size < size_t(description.GetNumber("byteLength", 0.0)))
+				throw std::runtime_error("buffer " + std::to_string(i) + " is shorter than its byteLength");
+			document.buffers.push_back(std::move(buffer));
+		}
+	}
+
+// =====================================================================================
+//										glTF accessors
+// =====================================================================================
+
+	size_t GetComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE:
+			return 1;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT:
+			return 2;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT:
+			return 4;
+		default:
+			throw std::runtime_error("invalid accessor componentType");
+		}
+	}
+
+	size_t GetComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4")
+			return 4;
+		throw std::runtime_error("unsupported accessor type " + type);
+	}
+
+	// An accessor resolved to a strided byte range, bounds checked.
+	struct AccessorView
+	{
+		const uint8_t* data = nullptr;	// nullptr: no bufferView, all zeros
+		size_t count = 0;
+		size_t stride = 0;
+		size_t components = 0;
+		int componentType = 0;
+		bool normalized = false;
+	};
+
+	AccessorView GetAccessorView(const GltfDocument& document, size_t accessorIndex)
+	{
+		const JsonValue& accessor = GetArrayElement(document.json, "accessors", accessorIndex);
+		if (accessor.Find("sparse"))
+			throw std::runtime_error("sparse accessors are not supported");
+
+		AccessorView view;
+		const std::string* type = accessor.GetString("type");
+		view.components = GetComponentCount(type ? *type : std::string());
+		view.componentType = int(accessor.GetNumber("componentType", 0.0));
+		view.normalized = accessor.Find("normalized") && accessor.Find("normalized")->AsBool();
+		const double count = accessor.GetNumber("count", -1.0);
+		if (count < 0.0 || count > double(UINT32_MAX))
+			throw std::runtime_error("invalid accessor count");
+		view.count = size_t(count);
+
+		const size_t elementSize = GetComponentSize(view.componentType) * view.components;
+		view.stride = elementSize;
+		if (!accessor.Find("bufferView") || view.count == 0)
+			return view;
+
+		const JsonValue& bufferView = GetArrayElement(document.json, "bufferViews",
+			GetIndex(accessor, "bufferView", document.json.Find("bufferViews") ? document.json.Find("bufferViews")->Size() : 0));
+		const GltfBuffer& buffer = *document.buffers[GetIndex(bufferView, "buffer", document.buffers.size())];
+
+		const size_t viewOffset = size_t(bufferView.GetNumber("byteOffset", 0.0));
+		const size_t viewLength = size_t(bufferView.GetNumber("byteLength", 0.0));
+		const size_t accessorOffset = size_t(accessor.GetNumber("byteOffset", 0.0));
+		const size_t byteStride = size_t(bufferView.GetNumber("byteStride", 0.0));
+		view.stride = byteStride ? byteStride : elementSize;
+
+		if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset ||
+			accessorOffset > viewLength || (view.count - 1) * view.stride + elementSize > viewLength - accessorOffset)
+			throw std::runtime_error("accessor " + std::to_string(accessorIndex) + " is out of bounds");
+
+		view.data = buffer.data + viewOffset + accessorOffset;
+		return view;
+	}
+
+	float ReadComponent(const uint8_t* p, int componentType, bool normalized)
+	{
+		switch (componentType)
+		{
+		case GLTF_FLOAT:
+		{
+			float value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+		case GLTF_UNSIGNED_BYTE:
+			return normalized ? *p / 255.0f : float(*p);
+		case GLTF_BYTE:
+		{
+			const float value = float(int8_t(*p));
+			return normalized ? std::fmax(value / 127.0f, -1.0f) : value;
+		}
+		case GLTF_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return normalized ? value / 65535.0f : float(value);
+		}
+		case GLTF_SHORT:
+		{
+			int16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return normalized ? std::fmax(value / 32767.0f, -1.0f) : float(value);
+		}
+		default:
+			return float(ReadUint32(p));
+		}
+	}
+
+	// "components" floats per element, appended to "out".
+	void ReadFloats(const GltfDocument& document, size_t accessorIndex, size_t components, std::vector<float>& out)
+	{
+		const AccessorView view = GetAccessorView(document, accessorIndex);
+		if (view.components != components)
+			throw std::runtime_error("unexpected accessor type");
+
+		const size_t first = out.size();
+		out.resize(first + view.count * components, 0.0f);
+		if (!view.data)
+			return;
+
+		float* destination = out.data() + first;
+		if (view.componentType == GLTF_FLOAT && view.stride == components * sizeof(float))
+		{
+			// Tightly packed floats - the common case - in one copy.
+			std::memcpy(destination, view.data, view.count * view.stride);
+			return;
+		}
+
+		const size_t componentSize = GetComponentSize(view.componentType);
+		for (size_t i = 0; i < view.count; ++i)
+		{
+			const uint8_t* element = view.data + i * view.stride;
+			for (size_t c = 0; c < components; ++c)
+				*destination++ = ReadComponent(element + c * componentSize, view.componentType, view.normalized);
+		}
+	}
+
+	void ReadIndices(const GltfDocument& document, size_t accessorIndex, uint32_t baseVertex, std::vector<uint32_t>& out)
+	{
+		const AccessorView view = GetAccessorView(document, accessorIndex);
+		if (view.components != 1 || (view.componentType != GLTF_UNSIGNED_BYTE &&
+			view.componentType != GLTF_UNSIGNED_SHORT && view.componentType != GLTF_UNSIGNED_INT))
+			throw std::runtime_error("invalid index accessor");
+		if (!view.data)
+			throw std::runtime_error("index accessor without bufferView");
+
+		out.reserve(out.size() + view.count);
+		for (size_t i = 0; i < view.count; ++i)
+		{
+			const uint8_t* element = view.data + i * view.stride;
+			uint32_t index;
+			if (view.componentType == GLTF_UNSIGNED_BYTE)
+			{
+				index = *element;
+			}
+			else if (view.componentType == GLTF_UNSIGNED_SHORT)
+			{
+				uint16_t value;
+				std::memcpy(&value, element, sizeof(value));
+				index = value;
+			}
+			else
+			{
+				index = ReadUint32(element);
+			}
+			out.push_back(baseVertex + index);
+		}
+	}
+
+// =====================================================================================
+//										glTF scene
+// =====================================================================================
+
+	// glTF matrices are column major for column vectors; read row by row that is exactly
+	//		the row vector matrix DirectXMath uses.
+	XMMATRIX GetLocalTransform(const JsonValue& node)
+	{
+		if (const JsonValue* matrix = node.Find("matrix"))
+		{
+			if (matrix->Size() != 16)
+				throw std::runtime_error("node matrix needs 16 numbers");
+			XMFLOAT4X4 m;
+			for (size_t i = 0; i < 16; ++i)
+				m.m[i / 4][i % 4] = float((*matrix)[i].AsNumber());
+			return XMLoadFloat4x4(&m);
+		}
+
+		auto readVector = [&](const char* key, size_t count, XMFLOAT4 fallback)
+		{
+			const JsonValue* value = node.Find(key);
+			if (!value)
+				return fallback;
+			if (value->Size() != count)
+				throw std::runtime_error(std::string("node ") + key + " has the wrong size");
+			float* components = &fallback.x;
+			for (size_t i = 0; i < count; ++i)
+				components[i] = float((*value)[i].AsNumber());
+			return fallback;
+		};
+		const XMFLOAT4 translation = readVector("translation", 3, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+		const XMFLOAT4 rotation = readVector("rotation", 4, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+		const XMFLOAT4 scale = readVector("scale", 3, XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f));
+
+		return XMMatrixAffineTransformation(XMLoadFloat4(&scale), XMVectorZero(),
+			XMQuaternionNormalize(XMLoadFloat4(&rotation)), XMLoadFloat4(&translation));
+	}
+
+	struct GltfImportState
+	{
+		const GltfDocument* document;
+		SourceMesh* mesh;
+		// Every primitive so far had normals / UVs - otherwise they are dropped at the end.
+		bool allNormals = true;
+		bool allUVs = true;
+		std::vector<float> scratch;
+	};
+
+	void ImportPrimitive(GltfImportState& state, const JsonValue& primitive, FXMMATRIX world)
+	{
+		if (int(primitive.GetNumber("mode", GLTF_MODE_TRIANGLES)) != GLTF_MODE_TRIANGLES)
+			return;	// points and lines have no place in a triangle mesh
+		const JsonValue* attributes = primitive.Find("attributes");
+		if (!attributes || !attributes->Find("POSITION"))
+			throw std::runtime_error("primitive without POSITION");
+
+		const GltfDocument& document = *state.document;
+		SourceMesh& mesh = *state.mesh;
+		const size_t accessorCount = document.json.Find("accessors") ? document.json.Find("accessors")->Size() : 0;
+		const size_t baseVertex = mesh.positions.size();
+
+		state.scratch.clear();
+		ReadFloats(document, GetIndex(*attributes, "POSITION", accessorCount), 3, state.scratch);
+		const size_t vertexCount = state.scratch.size() / 3;
+		if (baseVertex + vertexCount > UINT32_MAX)
+			throw std::runtime_error("too many vertices");
+		mesh.positions.resize(baseVertex + vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const XMVECTOR position = XMVectorSet(state.scratch[i * 3], state.scratch[i * 3 + 1], state.scratch[i * 3 + 2], 1.0f);
+			XMStoreFloat3(&mesh.positions[baseVertex + i], XMVector3TransformCoord(position, world));
+		}
+
+		// Normals take the inverse transpose; normalizing afterwards removes any scale.
+		mesh.normals.resize(baseVertex + vertexCount, XMFLOAT3(0.0f, 0.0f, 1.0f));
+		if (attributes->Find("NORMAL"))
+		{
+			state.scratch.clear();
+			ReadFloats(document, GetIndex(*attributes, "NORMAL", accessorCount), 3, state.scratch);
+			if (state.scratch.size() != vertexCount * 3)
+				throw std::runtime_error("NORMAL and POSITION counts differ");
+			const XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				const XMVECTOR normal = XMVectorSet(state.scratch[i * 3], state.scratch[i * 3 + 1], state.scratch[i * 3 + 2], 0.0f);
+				XMStoreFloat3(&mesh.normals[baseVertex + i], XMVector3Normalize(XMVector3TransformNormal(normal, normalMatrix)));
+			}
+		}
+		else
+		{
+			state.allNormals = false;
+		}
+
+		// glTF has v = 0 at the top of the image, like D3D.
+		mesh.uvs.resize(baseVertex + vertexCount, XMFLOAT2(0.0f, 0.0f));
+		if (attributes->Find("TEXCOORD_0"))
+		{
+			state.scratch.clear();
+			ReadFloats(document, GetIndex(*attributes, "TEXCOORD_0", accessorCount), 2, state.scratch);
+			if (state.scratch.size() != vertexCount * 2)
+				throw std::runtime_error("TEXCOORD_0 and POSITION counts differ");
+			std::memcpy(&mesh.uvs[baseVertex], state.scratch.data(), vertexCount * sizeof(XMFLOAT2));
+		}
+		else
+		{
+			state.allUVs = false;
+		}
+
+		const size_t firstIndex = mesh.indices.size();
+		if (primitive.Find("indices"))
+		{
+			ReadIndices(document, GetIndex(primitive, "indices", accessorCount), uint32_t(baseVertex), mesh.indices);
+		}
+		else
+		{
+			for (size_t i = 0; i < vertexCount; ++i)
+				mesh.indices.push_back(uint32_t(baseVertex + i));
+		}
+		if ((mesh.indices.size() - firstIndex) % 3 != 0)
+			throw std::runtime_error("triangle list index count is not a multiple of 3");
+		for (size_t i = firstIndex; i < mesh.indices.size(); ++i)
+		{
+			if (mesh.indices[i] >= baseVertex + vertexCount)
+				throw std::runtime_error("vertex index out of range");
+		}
+
+		// Mirroring transforms turn the winding around.
+		if (XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f)
+		{
+			for (size_t i = firstIndex; i < mesh.indices.size(); i += 3)
+				std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+		}
+	}
+
+	void ImportNode(GltfImportState& state, size_t nodeIndex, FXMMATRIX parent, size_t depth)
+	{
+		const JsonValue& root = state.document->json;
+		const JsonValue* nodes = root.Find("nodes");
+		// Deeper than the node count means a cycle.
+		if (depth > nodes->Size())
+			throw std::runtime_error("node hierarchy has a cycle");
+
+		const JsonValue& node = GetArrayElement(root, "nodes", nodeIndex);
+		const XMMATRIX world = XMMatrixMultiply(GetLocalTransform(node), parent);
+
+		if (node.Find("mesh"))
+		{
+			const JsonValue* meshes = root.Find("meshes");
+			const JsonValue& mesh = GetArrayElement(root, "meshes", GetIndex(node, "mesh", meshes ? meshes->Size() : 0));
+			if (const JsonValue* primitives = mesh.Find("primitives"))
+			{
+				for (const JsonValue& primitive : primitives->GetElements())
+					ImportPrimitive(state, primitive, world);
+			}
+		}
+
+		if (const JsonValue* children = node.Find("children"))
+		{
+			for (const JsonValue& child : children->GetElements())
+			{
+				const double index = child.AsNumber(-1.0);
+				if (index < 0.0 || index >= double(nodes->Size()))
+					throw std::runtime_error("invalid child node index");
+				ImportNode(state, size_t(index), world, depth + 1);
+			}
+		}
+	}
+}
+
+// =====================================================================================
+//										glTF import
+// =====================================================================================
+
+void ImportGltf(const uint8_t* data, size_t size, const std::string& baseDirectory, SourceMesh& mesh,
+	std::vector<std::string>* dependencies)
+{
+	mesh = SourceMesh();
+
+	// .glb: 12 byte header, then chunks (length, type, data padded to 4 bytes): JSON
+	//		first, optionally BIN.
+	GltfDocument document;
+	const uint8_t* binary = nullptr;
+	size_t binarySize = 0;
+	if (size >= 12 && ReadUint32(data) == GLB_MAGIC)
+	{
+		const size_t length = ReadUint32(data + 8);
+		if (ReadUint32(data + 4) != 2 || length > size)
+			throw std::runtime_error("invalid GLB header");
+
+		size_t offset = 12;
+		bool hasJson = false;
+		while (offset + 8 <= length)
+		{
+			const size_t chunkLength = ReadUint32(data + offset);
+			const uint32_t chunkType = ReadUint32(data + offset + 4);
+			offset += 8;
+			if (chunkLength > length - offset)
+				throw std::runtime_error("GLB chunk out of bounds");
+
+			if (chunkType == GLB_CHUNK_JSON && !hasJson)
+			{
+				document.json = ParseJson(reinterpret_cast<const char*>(data + offset), chunkLength);
+				hasJson = true;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && !binary)
+			{
+				binary = data + offset;
+				binarySize = chunkLength;
+			}
+			offset += (chunkLength + 3) & ~size_t(3);
+		}
+		if (!hasJson)
+			throw std::runtime_error("GLB without JSON chunk");
+	}
+	else
+	{
+		document.json = ParseJson(reinterpret_cast<const char*>(data), size);
+	}
+
+	if (!document.json.IsObject())
+		throw std::runtime_error("glTF root is not an object");
+	LoadBuffers(document, binary, binarySize, baseDirectory, dependencies);
+
+	// The default scene's root nodes; without scenes, every node nobody references as a child.
+	std::vector<size_t> roots;
+	const JsonValue* nodes = document.json.Find("nodes");
+	const size_t nodeCount = nodes ? nodes->Size() : 0;
+	if (document.json.Find("scenes"))
+	{
+		const JsonValue& scene = GetArrayElement(document.json, "scenes", size_t(document.json.GetNumber("scene", 0.0)));
+		if (const JsonValue* sceneNodes = scene.Find("nodes"))
+		{
+			for (const JsonValue& node : sceneNodes->GetElements())
+			{
+				const double index = node.AsNumber(-1.0);
+				if (index < 0.0 || index >= double(nodeCount))
+					throw std::runtime_error("invalid scene node index");
+				roots.push_back(size_t(index));
+			}
+		}
+	}
+	else
+	{
+		std::vector<bool> isChild(nodeCount, false);
+		for (size_t i = 0; i < nodeCount; ++i)
+		{
+			if (const JsonValue* children = (*nodes)[i].Find("children"))
+			{
+				for (const JsonValue& child : children->GetElements())
+				{
+					const double index = child.AsNumber(-1.0);
+					if (index >= 0.0 && index < double(nodeCount))
+						isChild[size_t(index)] = true;
+				}
+			}
+		}
+		for (size_t i = 0; i < nodeCount; ++i)
+		{
+			if (!isChild[i])
+				roots.push_back(i);
+		}
+	}
+
+	GltfImportState state;
+	state.document = &document;
+	state.mesh = &mesh;
+	for (size_t root : roots)
+		ImportNode(state, root, XMMatrixIdentity(), 0);
+
+	if (mesh.indices.empty())
+		throw std::runtime_error("no triangles");
+
+	// An attribute is kept only if every primitive has it.
+	if (!state.allNormals)
+		mesh.normals.clear();
+	if (!state.allUVs)
+		mesh.uvs.clear();
+
+	DeduplicateVertices(mesh);
+}
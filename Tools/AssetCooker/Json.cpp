@@ -0,0 +1,288 @@
+#include "Json.h"
+#include "TextParsing.h"
+
+#include <cstring> // std::strcmp
+#include <stdexcept>
+
+
+// =====================================================================================
+//										Values
+// =====================================================================================
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+	for (const auto& member : m_Members)
+	{
+		if (std::strcmp(member.first.c_str(), key) == 0)
+			return &member.second;
+	}
+	return nullptr;
+}
+
+double JsonValue::GetNumber(const char* key, double fallback) const
+{
+	const JsonValue* value = Find(key);
+	return value ? value->AsNumber(fallback) : fallback;
+}
+
+const std::string* JsonValue::GetString(const char* key) const
+{
+	const JsonValue* value = Find(key);
+	return value && value->IsString() ? &value->m_String : nullptr;
+}
+
+// =====================================================================================
+//										Parser
+// =====================================================================================
+
+// Recursive descent. The nesting depth is limited so hostile input can't overflow the stack.
+class JsonParser
+{
+public:
+	JsonParser(const char* data, size_t size)
+		: m_Begin(data)
+		, m_P(data)
+		, m_End(data + size)
+	{
+	}
+
+	JsonValue ParseDocument()
+	{
+		JsonValue root;
+		ParseValue(root, 0);
+		m_P = SkipWhitespace(m_P, m_End);
+		if (m_P != m_End)
+			Fail("trailing characters after the document");
+		return root;
+	}
+
+private:
+	static constexpr int MAX_DEPTH = 256;
+
+	[[noreturn]] void Fail(const char* message) const
+	{
+		throw std::runtime_error("JSON offset " + std::to_string(m_P - m_Begin) + ": " + message);
+	}
+
+	void Expect(char c)
+	{
+		if (m_P >= m_End || *m_P != c)
+		{
+			const char message[] = { 'e', 'x', 'p', 'e', 'c', 't', 'e', 'd', ' ', '\'', c, '\'', '\0' };
+			Fail(message);
+		}
+		++m_P;
+	}
+
+	bool ConsumeWord(const char* word, size_t length)
+	{
+		if (size_t(m_End - m_P) < length || std::memcmp(m_P, word, length) != 0)
+			return false;
+		m_P += length;
+		return true;
+	}
+
+	void ParseValue(JsonValue& value, int depth)
+	{
+		if (depth > MAX_DEPTH)
+			Fail("nesting too deep");
+
+		m_P = SkipWhitespace(m_P, m_End);
+		if (m_P >= m_End)
+			Fail("unexpected end of input");
+
+		switch (*m_P)
+		{
+		case '{':
+			ParseObject(value, depth);
+			break;
+		case '[':
+			ParseArray(value, depth);
+			break;
+		case '"':
+			value.m_Type = JsonValue::Type::String;
+			ParseString(value.m_String);
+			break;
+		case 't':
+		case 'f':
+			value.m_Type = JsonValue::Type::Bool;
+			value.m_Bool = *m_P == 't';
+			if (!(value.m_Bool ? ConsumeWord("true", 4) : ConsumeWord("false", 5)))
+				Fail("invalid literal");
+			break;
+		case 'n':
+			if (!ConsumeWord("null", 4))
+				Fail("invalid literal");
+			break;
+		default:
+			// JSON has no inf/nan, ParseDouble would accept them.
+			if (*m_P != '-' && (*m_P < '0' || *m_P > '9'))
+				Fail("unexpected character");
+			value.m_Type = JsonValue::Type::Number;
+			if (!ParseDouble(m_P, m_End, value.m_Number))
+				Fail("invalid number");
+			break;
+		}
+	}
+
+	void ParseObject(JsonValue& value, int depth)
+	{
+		value.m_Type = JsonValue::Type::Object;
+		++m_P;
+		m_P = SkipWhitespace(m_P, m_End);
+		if (m_P < m_End && *m_P == '}')
+		{
+			++m_P;
+			return;
+		}
+
+		for (;;)
+		{
+			m_P = SkipWhitespace(m_P, m_End);
+			value.m_Members.emplace_back();
+			ParseString(value.m_Members.back().first);
+			m_P = SkipWhitespace(m_P, m_End);
+			Expect(':');
+			ParseValue(value.m_Members.back().second, depth + 1);
+
+			m_P = SkipWhitespace(m_P, m_End);
+			if (m_P < m_End && *m_P == ',')
+			{
+				++m_P;
+				continue;
+			}
+			Expect('}');
+			return;
+		}
+	}
+
+	void ParseArray(JsonValue& value, int depth)
+	{
+		value.m_Type = JsonValue::Type::Array;
+		++m_P;
+		m_P = SkipWhitespace(m_P, m_End);
+		if (m_P < m_End && *m_P == ']')
+		{
+			++m_P;
+			return;
+		}
+
+		for (;;)
+		{
+			value.m_Elements.emplace_back();
+			ParseValue(value.m_Elements.back(), depth + 1);
+
+			m_P = SkipWhitespace(m_P, m_End);
+			if (m_P < m_End && *m_P == ',')
+			{
+				++m_P;
+				continue;
+			}
+			Expect(']');
+			return;
+		}
+	}
+
+	uint32_t ParseHex4()
+	{
+		if (m_End - m_P < 4)
+			Fail("truncated \\u escape");
+		uint32_t code = 0;
+		for (int i = 0; i < 4; ++i, ++m_P)
+		{
+			const char c = *m_P;
+			const uint32_t digit = c >= '0' && c <= '9' ? uint32_t(c - '0') :
+				c >= 'a' && c <= 'f' ? uint32_t(c - 'a' + 10) :
+				c >= 'A' && c <= 'F' ? uint32_t(c - 'A' + 10) : 16;
+			if (digit > 15)
+				Fail("invalid \\u escape");
+			code = code * 16 + digit;
+		}
+		return code;
+	}
+
+	static void AppendUtf8(std::string& out, uint32_t code)
+	{
+		if (code < 0x80)
+		{
+			out += char(code);
+		}
+		else if (code < 0x800)
+		{
+			out += char(0xC0 | (code >> 6));
+			out += char(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			out += char(0xE0 | (code >> 12));
+			out += char(0x80 | ((code >> 6) & 0x3F));
+			out += char(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			out += char(0xF0 | (code >> 18));
+			out += char(0x80 | ((code >> 12) & 0x3F));
+			out += char(0x80 | ((code >> 6) & 0x3F));
+			out += char(0x80 | (code & 0x3F));
+		}
+	}
+
+	void ParseString(std::string& out)
+	{
+		Expect('"');
+		for (;;)
+		{
+			// Plain runs are copied in one go - most strings have no escapes at all.
+			const char* run = FindQuoteOrEscape(m_P, m_End);
+			out.append(m_P, run);
+			m_P = run;
+			if (m_P >= m_End)
+				Fail("unterminated string");
+			if (*m_P++ == '"')
+				return;
+
+			if (m_P >= m_End)
+				Fail("unterminated string");
+			const char escape = *m_P++;
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t code = ParseHex4();
+				// UTF-16 surrogate pair.
+				if (code >= 0xD800 && code < 0xDC00)
+				{
+					if (!ConsumeWord("\\u", 2))
+						Fail("unpaired surrogate");
+					const uint32_t low = ParseHex4();
+					if (low < 0xDC00 || low >= 0xE000)
+						Fail("unpaired surrogate");
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(out, code);
+				break;
+			}
+			default:
+				Fail("invalid escape");
+			}
+		}
+	}
+
+private:
+	const char* m_Begin;
+	const char* m_P;
+	const char* m_End;
+};
+
+JsonValue ParseJson(const char* data, size_t size)
+{
+	return JsonParser(data, size).ParseDocument();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// =====================================================================================
+//										JSON
+// =====================================================================================
+
+// A minimal JSON document model for glTF: values are parsed into a tree once, the importer
+//		then looks up what it needs. Numbers are doubles (exact for every integer a glTF
+//		file uses as an index or offset). Object members keep the file order; lookups are
+//		linear, which beats hashing for the handful of keys per glTF object.
+class JsonValue
+{
+// ------------------------------------------------------------------------------------------
+//									Function members
+// ------------------------------------------------------------------------------------------
+public:
+	enum class Type : uint8_t
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object,
+	};
+
+	Type GetType() const { return m_Type; }
+	bool IsNull() const { return m_Type == Type::Null; }
+	bool IsNumber() const { return m_Type == Type::Number; }
+	bool IsString() const { return m_Type == Type::String; }
+	bool IsArray() const { return m_Type == Type::Array; }
+	bool IsObject() const { return m_Type == Type::Object; }
+
+	// Values of the matching type, "fallback" otherwise.
+	bool AsBool(bool fallback = false) const { return m_Type == Type::Bool ? m_Bool : fallback; }
+	double AsNumber(double fallback = 0.0) const { return m_Type == Type::Number ? m_Number : fallback; }
+	const std::string& AsString() const { return m_String; }
+
+	// Arrays. Size() is 0 for anything else.
+	size_t Size() const { return m_Elements.size(); }
+	const JsonValue& operator[](size_t index) const { return m_Elements[index]; }
+	const std::vector<JsonValue>& GetElements() const { return m_Elements; }
+
+	// Objects. nullptr if the member doesn't exist or this isn't an object.
+	const JsonValue* Find(const char* key) const;
+	const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return m_Members; }
+
+	// Member lookups with a default for missing / mistyped members.
+	double GetNumber(const char* key, double fallback) const;
+	const std::string* GetString(const char* key) const;
+
+private:
+	friend class JsonParser;
+
+// ------------------------------------------------------------------------------------------
+//									Data members
+// ------------------------------------------------------------------------------------------
+private:
+	Type m_Type = Type::Null;
+	bool m_Bool = false;
+	double m_Number = 0.0;
+	std::string m_String;
+	std::vector<JsonValue> m_Elements;
+	std::vector<std::pair<std::string, JsonValue>> m_Members;
+};
+
+// Parses a complete UTF-8 document (RFC 8259; \u escapes are converted to UTF-8).
+//		Throws std::runtime_error with the byte offset on malformed input.
+JsonValue ParseJson(const char* data, size_t size);
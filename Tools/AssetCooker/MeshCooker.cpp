@@ -0,0 +1,182 @@
+#include "MeshCooker.h"
+#include "CookerUtils.h"
+
+#include "Framework/AssetPackage.h"
+#include "Framework/VertexFormats.h"
+
+#include <stdexcept>
+
+using namespace DirectX;
+
+
+namespace
+{
+	// AnalyzeVertexCache relative to the vertices the index list actually uses - a
+	//		coarse LOD only uses part of the mesh's vertices.
+	VertexCacheStatistics AnalyzeLod(const std::vector<uint32_t>& indices, size_t vertexCount, size_t usedVertexCount)
+	{
+		VertexCacheStatistics statistics = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+		statistics.atvr = usedVertexCount ? float(statistics.vertexTransforms) / usedVertexCount : 0.0f;
+		return statistics;
+	}
+
+	size_t CountUsedVertices(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		std::vector<bool> used(vertexCount, false);
+		size_t count = 0;
+		for (uint32_t index : indices)
+		{
+			count += used[index] ? 0 : 1;
+			used[index] = true;
+		}
+		return count;
+	}
+}
+
+// =====================================================================================
+//										Mesh cooking
+// =====================================================================================
+
+uint64_t MeshCookSettings::GetHash() const
+{
+	uint64_t hash = HashBytes(lodRatios.data(), lodRatios.size() * sizeof(float));
+	hash = HashValue(simplify.targetRatio, hash);
+	hash = HashValue(simplify.maxError, hash);
+	hash = HashValue(simplify.lockBorder, hash);
+	hash = HashValue(normalWeight, hash);
+	return HashValue(minLodReduction, hash);
+}
+
+void CookMesh(const SourceMesh& source, const MeshCookSettings& settings, uint64_t settingsHash,
+	TaskScheduler* scheduler, std::vector<uint8_t>& outPackage, std::vector<MeshLodStatistics>* outLodStatistics)
+{
+	const size_t vertexCount = source.positions.size();
+	if (source.indices.empty() || source.indices.size() % 3 != 0)
+		throw std::runtime_error("mesh has no triangles");
+	if (vertexCount > 0xFFFFFFFFull || source.indices.size() > 0xFFFFFFFFull)
+		throw std::runtime_error("mesh too large");
+	for (uint32_t index : source.indices)
+	{
+		if (index >= vertexCount)
+			throw std::runtime_error("index out of range");
+	}
+
+	// 1) LOD chain, normals steer the simplifier away from creases.
+	SimplifyMeshInput input;
+	input.indices = source.indices.data();
+	input.indexCount = source.indices.size();
+	input.positions = source.positions.data();
+	input.vertexCount = vertexCount;
+	const float normalWeights[3] = { settings.normalWeight, settings.normalWeight, settings.normalWeight };
+	if (!source.normals.empty())
+	{
+		input.attributes = &source.normals[0].x;
+		input.attributeStride = sizeof(XMFLOAT3);
+		input.attributeWeights = normalWeights;
+		input.attributeCount = 3;
+	}
+
+	std::vector<SimplifiedLod> chain;
+	GenerateLodChains(&input, 1, settings.lodRatios.data(), settings.lodRatios.size(), settings.simplify,
+		&chain, scheduler);
+
+	// 2) Keep the levels that are worth it, each optimized on its own, all in one index list.
+	std::vector<uint32_t> indices;
+	std::vector<MeshAssetLod> lods;
+	size_t previousCount = 0;
+	for (SimplifiedLod& level : chain)
+	{
+		if (level.indices.empty() ||
+			(!lods.empty() && level.indices.size() > previousCount * settings.minLodReduction))
+			continue;
+
+		MeshLodStatistics statistics = {};
+		if (outLodStatistics)
+		{
+			statistics.triangleCount = level.indices.size() / 3;
+			statistics.vertexCount = CountUsedVertices(level.indices, vertexCount);
+			statistics.before = AnalyzeLod(level.indices, vertexCount, statistics.vertexCount);
+		}
+
+		OptimizeVertexCache(level.indices.data(), level.indices.size(), vertexCount);
+		OptimizeOverdraw(level.indices.data(), level.indices.size(), source.positions.data(), sizeof(XMFLOAT3), vertexCount);
+
+		if (outLodStatistics)
+		{
+			statistics.after = AnalyzeLod(level.indices, vertexCount, statistics.vertexCount);
+			outLodStatistics->push_back(statistics);
+		}
+
+		MeshAssetLod lod = {};
+		lod.firstIndex = uint32_t(indices.size());
+		lod.indexCount = uint32_t(level.indices.size());
+		lod.geometricError = level.error;
+		lods.push_back(lod);
+		indices.insert(indices.end(), level.indices.begin(), level.indices.end());
+		previousCount = level.indices.size();
+	}
+
+	// 3) Vertices in order of first use. Level 0 comes first in the index list, so the
+	//		order is the one of the full detail mesh; the coarser levels (a subset of its
+	//		vertices) reuse it.
+	std::vector<uint32_t> remap(vertexCount);
+	const size_t usedVertexCount = GenerateVertexFetchRemap(indices.data(), indices.size(), vertexCount, remap.data());
+	for (uint32_t& index : indices)
+	{
+		index = remap[index];
+	}
+
+	std::vector<XMFLOAT3> positions(usedVertexCount);
+	RemapVertices(source.positions.data(), vertexCount, sizeof(XMFLOAT3), remap.data(), positions.data());
+
+	// 4) Final vertex formats.
+	const QuantizationBounds bounds = QuantizationBounds::FromPositions(positions.data(), usedVertexCount);
+	std::vector<QuantizedPosition> quantizedPositions(usedVertexCount);
+	EncodePositions(positions.data(), usedVertexCount, bounds, quantizedPositions.data());
+
+	std::vector<PackedNormal> packedNormals;
+	if (!source.normals.empty())
+	{
+		std::vector<XMFLOAT3> normals(usedVertexCount);
+		RemapVertices(source.normals.data(), vertexCount, sizeof(XMFLOAT3), remap.data(), normals.data());
+		packedNormals.resize(usedVertexCount);
+		EncodeNormalsOctahedral(normals.data(), usedVertexCount, packedNormals.data());
+	}
+
+	std::vector<PackedUV> packedUVs;
+	if (!source.uvs.empty())
+	{
+		std::vector<XMFLOAT2> uvs(usedVertexCount);
+		RemapVertices(source.uvs.data(), vertexCount, sizeof(XMFLOAT2), remap.data(), uvs.data());
+		packedUVs.resize(usedVertexCount);
+		EncodeUVsHalf(uvs.data(), usedVertexCount, packedUVs.data());
+	}
+
+	// 5) Index format.
+	const IndexFormat indexFormat = SelectIndexFormat(usedVertexCount);
+	std::vector<uint8_t> packedIndices(indices.size() * GetIndexSize(indexFormat));
+	PackIndices(indices.data(), indices.size(), indexFormat, packedIndices.data());
+
+	MeshAssetHeader header = {};
+	header.vertexCount = uint32_t(usedVertexCount);
+	header.indexCount = uint32_t(indices.size());
+	header.indexFormat = uint32_t(indexFormat);
+	header.lodCount = uint32_t(lods.size());
+	header.boundsCenter[0] = bounds.center.x;
+	header.boundsCenter[1] = bounds.center.y;
+	header.boundsCenter[2] = bounds.center.z;
+	header.boundsExtent[0] = bounds.extent.x;
+	header.boundsExtent[1] = bounds.extent.y;
+	header.boundsExtent[2] = bounds.extent.z;
+
+	AssetPackageWriter writer(AssetType::Mesh, settingsHash);
+	writer.AddSection(SectionType::MeshHeader, header);
+	writer.AddSection(SectionType::Positions, quantizedPositions);
+	if (!packedNormals.empty())
+		writer.AddSection(SectionType::Normals, packedNormals);
+	if (!packedUVs.empty())
+		writer.AddSection(SectionType::UVs, packedUVs);
+	writer.AddSection(SectionType::Indices, packedIndices);
+	writer.AddSection(SectionType::Lods, lods);
+	writer.Serialize(outPackage);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Framework/MeshOptimizer.h"
+#include "Framework/MeshSimplifier.h"
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//										Source meshes
+// =====================================================================================
+
+// An indexed triangle list as it comes out of an importer: float attributes, one vertex
+//		per unique attribute combination. "normals" and "uvs" are either empty or one per
+//		position.
+struct SourceMesh
+{
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<uint32_t> indices;
+};
+
+// =====================================================================================
+//										Mesh cooking
+// =====================================================================================
+
+struct MeshCookSettings
+{
+	// The coarse levels are only seen from a distance: let them drift up to 5% of the
+	//		mesh extent (LodSelector still picks them by their actual error).
+	MeshCookSettings() { simplify.maxError = 0.05f; }
+
+	// Triangle ratios of the coarser LODs, relative to the full mesh, decreasing.
+	std::vector<float> lodRatios = { 0.5f, 0.25f, 0.125f };
+	SimplifySettings simplify;
+	// Weight of normal differences against the geometric error in the simplifier.
+	float normalWeight = 0.05f;
+	// A LOD is dropped unless it has at most this fraction of the previous level's
+	//		triangles - the simplifier stops early on meshes that can't be reduced further
+	//		within simplify.maxError, and near duplicate levels only cost memory.
+	float minLodReduction = 0.85f;
+
+	uint64_t GetHash() const;
+};
+
+// Post-transform cache efficiency of one cooked LOD, before and after its triangles
+//		were reordered (step 2 below). ATVR is relative to the vertices the level uses.
+struct MeshLodStatistics
+{
+	size_t triangleCount;
+	size_t vertexCount;
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+};
+
+// Runs the full mesh pipeline and writes an AssetType::Mesh package:
+//		1) LOD chain (GenerateLodChains),
+//		2) per LOD: OptimizeVertexCache + OptimizeOverdraw,
+//		3) vertex fetch order over all LODs, so every level reads a prefix-heavy range,
+//		4) quantized positions, octahedral normals, half float UVs (VertexFormats.h),
+//		5) 16 bit indices when the vertex count allows.
+//		With "outLodStatistics" the vertex cache of every kept LOD is simulated before and
+//		after step 2.
+void CookMesh(const SourceMesh& source, const MeshCookSettings& settings, uint64_t settingsHash,
+	TaskScheduler* scheduler, std::vector<uint8_t>& outPackage,
+	std::vector<MeshLodStatistics>* outLodStatistics = nullptr);
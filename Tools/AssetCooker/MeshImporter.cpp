@@ -0,0 +1,116 @@
+#include "MeshImporter.h"
+
+#include "Framework/MappedFile.h"
+
+#include <cstring> // std::memcmp, std::memcpy
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+using namespace DirectX;
+
+
+// =====================================================================================
+//										Import
+// =====================================================================================
+
+void ImportMesh(const std::string& path, SourceMesh& mesh, TaskScheduler* scheduler,
+	std::vector<std::string>* dependencies)
+{
+	// Sequential access: both importers stream through the file front to back (glTF
+	//		buffers are read in accessor order, close enough).
+	MappedFile file;
+	if (!file.Open(path.c_str(), true))
+		throw std::runtime_error("can't open " + path);
+
+	std::string extension = fs::path(path).extension().string();
+	for (char& c : extension)
+		c = char(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+
+	if (extension == ".obj")
+	{
+		ImportObj(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), mesh, scheduler);
+	}
+	else if (extension == ".gltf" || extension == ".glb")
+	{
+		ImportGltf(file.GetData(), file.GetSize(), fs::path(path).parent_path().string(), mesh, dependencies);
+	}
+	else
+	{
+		throw std::runtime_error("unknown mesh format " + extension);
+	}
+}
+
+// =====================================================================================
+//										Vertex welding
+// =====================================================================================
+
+namespace
+{
+	struct PackedVertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+		XMFLOAT2 uv;
+	};
+
+	// FNV-1a over the 32 raw bytes - cheap, and bitwise equality is what we test anyway.
+	uint32_t HashVertex(const PackedVertex& vertex)
+	{
+		uint32_t words[sizeof(PackedVertex) / 4];
+		std::memcpy(words, &vertex, sizeof(words));
+		uint32_t hash = 2166136261u;
+		for (uint32_t word : words)
+			hash = (hash ^ word) * 16777619u;
+		return hash ^ (hash >> 16);
+	}
+}
+
+void DeduplicateVertices(SourceMesh& mesh)
+{
+	const size_t vertexCount = mesh.positions.size();
+	const bool hasNormals = !mesh.normals.empty();
+	const bool hasUVs = !mesh.uvs.empty();
+
+	// Open addressing, power of two table at most half full, vertex index + 1 per slot.
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<uint32_t> table(tableSize, 0);
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<PackedVertex> unique;
+	unique.reserve(vertexCount);
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		PackedVertex vertex = {};
+		vertex.position = mesh.positions[i];
+		vertex.normal = hasNormals ? mesh.normals[i] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		vertex.uv = hasUVs ? mesh.uvs[i] : XMFLOAT2(0.0f, 0.0f);
+
+		size_t slot = HashVertex(vertex) & (tableSize - 1);
+		while (table[slot] && std::memcmp(&unique[table[slot] - 1], &vertex, sizeof(vertex)) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+		if (!table[slot])
+		{
+			unique.push_back(vertex);
+			table[slot] = uint32_t(unique.size());
+		}
+		remap[i] = table[slot] - 1;
+	}
+
+	for (uint32_t& index : mesh.indices)
+		index = remap[index];
+
+	mesh.positions.resize(unique.size());
+	mesh.normals.resize(hasNormals ? unique.size() : 0);
+	mesh.uvs.resize(hasUVs ? unique.size() : 0);
+	for (size_t i = 0; i < unique.size(); ++i)
+	{
+		mesh.positions[i] = unique[i].position;
+		if (hasNormals)
+			mesh.normals[i] = unique[i].normal;
+		if (hasUVs)
+			mesh.uvs[i] = unique[i].uv;
+	}
+}
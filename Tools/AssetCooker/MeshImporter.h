@@ -0,0 +1,43 @@
+#pragma once
+
+#include "MeshCooker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//										Mesh import
+// =====================================================================================
+
+// The importers read the source file through a memory mapping (Framework/MappedFile.h)
+//		and parse it in place: no whole-file copy, no zero terminated string, numbers via
+//		TextParsing.h instead of strtof. Their output is a deduplicated indexed triangle
+//		list, ready for CookMesh. All of them throw std::runtime_error on malformed input.
+
+// Dispatches on the extension: .obj, .gltf or .glb. "scheduler" may be nullptr.
+//		"dependencies" receives the other files the import read (glTF buffers) - the cook
+//		cache hashes them along with the source.
+void ImportMesh(const std::string& path, SourceMesh& mesh, TaskScheduler* scheduler,
+	std::vector<std::string>* dependencies = nullptr);
+
+// Wavefront OBJ: v / vt / vn / f (polygons are triangulated as fans, negative indices
+//		are relative). Everything else (materials, groups, ...) is ignored.
+//		Large files are split into chunks at line boundaries and parsed in parallel; the
+//		chunks are stitched together afterwards.
+void ImportObj(const char* data, size_t size, SourceMesh& mesh, TaskScheduler* scheduler);
+
+// glTF 2.0, .gltf (JSON + external or data URI buffers) or .glb (binary container). All
+//		triangle primitives of the default scene are flattened into one mesh in world
+//		space: POSITION, NORMAL and TEXCOORD_0. External buffers are resolved relative to
+//		"baseDirectory" and appended to "dependencies".
+void ImportGltf(const uint8_t* data, size_t size, const std::string& baseDirectory, SourceMesh& mesh,
+	std::vector<std::string>* dependencies = nullptr);
+
+// Merges vertices whose attributes are bitwise identical and remaps the indices. glTF
+//		stores split vertices per primitive; welding them again gives the optimizers and
+//		the simplifier a connected mesh.
+void DeduplicateVertices(SourceMesh& mesh);
@@ -0,0 +1,314 @@
+#include "MipChain.h"
+#include "TextureCooker.h"
+
+#include "Framework/TaskScheduler.h"
+
+#include <algorithm> // std::min, std::max
+#include <cmath>
+#include <functional>
+#include <utility>   // std::move, std::pair
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIP_CHAIN_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+// =====================================================================================
+//										sRGB
+// =====================================================================================
+
+namespace
+{
+	constexpr double PI = 3.14159265358979323846;
+
+	double SrgbToLinear(double value)
+	{
+		return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+	}
+
+	// Decoding is a table lookup. Encoding rounds to the nearest code: the boundaries
+	//		between codes are precomputed in linear space, so a binary search gives the
+	//		exact result without a pow per channel.
+	struct SrgbTables
+	{
+		float toLinear[256];
+		// Linear value halfway (in sRGB space) between code i and code i + 1.
+		float boundaries[255];
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; ++i)
+				toLinear[i] = float(SrgbToLinear(i / 255.0));
+			for (int i = 0; i < 255; ++i)
+				boundaries[i] = float(SrgbToLinear((i + 0.5) / 255.0));
+		}
+	};
+
+	const SrgbTables& GetSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	uint8_t EncodeSrgb(float linear, const SrgbTables& tables)
+	{
+		// The number of boundaries at or below the value is the code.
+		int code = 0;
+		for (int step = 128; step; step >>= 1)
+		{
+			if (code + step <= 255 && linear >= tables.boundaries[code + step - 1])
+				code += step;
+		}
+		return uint8_t(code);
+	}
+
+	uint8_t EncodeUnorm(float value)
+	{
+		return uint8_t(std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f));
+	}
+
+// =====================================================================================
+//										Filter taps
+// =====================================================================================
+
+	constexpr double KAISER_RADIUS = 3.0;
+	constexpr double KAISER_ALPHA = 4.0;
+
+	// Modified Bessel function of the first kind, order 0 - the series converges fast for
+	//		the small arguments of the window.
+	double BesselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32 && term > sum * 1e-12; ++k)
+		{
+			term *= (x * x) / (4.0 * k * k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	// "t" in destination texels.
+	double Kaiser(double t)
+	{
+		if (std::fabs(t) >= KAISER_RADIUS)
+			return 0.0;
+		const double sinc = t == 0.0 ? 1.0 : std::sin(PI * t) / (PI * t);
+		const double ratio = t / KAISER_RADIUS;
+		return sinc * BesselI0(KAISER_ALPHA * std::sqrt(1.0 - ratio * ratio)) / BesselI0(KAISER_ALPHA);
+	}
+
+	// The source texels and weights of every destination texel along one axis, "maxTaps"
+	//		per texel (unused taps have weight 0).
+	struct FilterTaps
+	{
+		int maxTaps = 0;
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	FilterTaps ComputeTaps(MipFilter filter, uint32_t sourceSize, uint32_t destinationSize)
+	{
+		const double scale = double(sourceSize) / destinationSize;
+		std::vector<std::vector<std::pair<int, double>>> taps(destinationSize);
+
+		for (uint32_t i = 0; i < destinationSize; ++i)
+		{
+			std::vector<std::pair<int, double>>& texel = taps[i];
+			if (filter == MipFilter::Box)
+			{
+				// Same arithmetic as the compute shader: coverage of [i, i + 1) * scale.
+				const float lo = float(i) * float(scale), hi = float(i + 1) * float(scale);
+				for (int j = int(std::floor(lo)); j < int(std::ceil(hi)); ++j)
+				{
+					const float coverage = std::min(hi, float(j + 1)) - std::max(lo, float(j));
+					if (coverage > 0.0f)
+						texel.emplace_back(j, coverage / float(scale));
+				}
+			}
+			else
+			{
+				// The kernel is stretched by the scale: its zeros fall on destination texels.
+				const double center = (i + 0.5) * scale;
+				const double support = KAISER_RADIUS * scale;
+				double sum = 0.0;
+				for (int j = int(std::floor(center - support)); j <= int(std::ceil(center + support)); ++j)
+				{
+					const double weight = Kaiser((j + 0.5 - center) / scale);
+					if (weight == 0.0)
+						continue;
+					const int index = std::min(std::max(j, 0), int(sourceSize) - 1);
+					sum += weight;
+					if (!texel.empty() && texel.back().first == index)
+						texel.back().second += weight;
+					else
+						texel.emplace_back(index, weight);
+				}
+				for (std::pair<int, double>& tap : texel)
+					tap.second /= sum;
+			}
+		}
+
+		FilterTaps result;
+		for (const std::vector<std::pair<int, double>>& texel : taps)
+			result.maxTaps = std::max(result.maxTaps, int(texel.size()));
+		result.indices.assign(size_t(destinationSize) * result.maxTaps, 0);
+		result.weights.assign(size_t(destinationSize) * result.maxTaps, 0.0f);
+		for (uint32_t i = 0; i < destinationSize; ++i)
+		{
+			for (size_t k = 0; k < taps[i].size(); ++k)
+			{
+				result.indices[i * result.maxTaps + k] = taps[i][k].first;
+				result.weights[i * result.maxTaps + k] = float(taps[i][k].second);
+			}
+		}
+		return result;
+	}
+
+// =====================================================================================
+//										Filtering
+// =====================================================================================
+
+	// A level as linear float RGBA.
+	struct FloatImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<float> texels;
+	};
+
+	// One destination texel of the horizontal pass: weighted sum of RGBA texels of "row".
+	inline void FilterTexel(const float* row, const int* indices, const float* weights, int taps, float* out)
+	{
+#if defined(MIP_CHAIN_SSE)
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < taps; ++k)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + size_t(indices[k]) * 4)));
+		_mm_storeu_ps(out, sum);
+#else
+		float sum[4] = {};
+		for (int k = 0; k < taps; ++k)
+		{
+			for (int c = 0; c < 4; ++c)
+				sum[c] += weights[k] * row[size_t(indices[k]) * 4 + c];
+		}
+		for (int c = 0; c < 4; ++c)
+			out[c] = sum[c];
+#endif
+	}
+
+	// out += weight * in over "count" floats - the vertical pass works on whole rows, so
+	//		every tap streams through memory once.
+	inline void AddScaledRow(float* out, const float* in, float weight, size_t count)
+	{
+		size_t i = 0;
+#if defined(MIP_CHAIN_SSE)
+		const __m128 w = _mm_set1_ps(weight);
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w, _mm_loadu_ps(in + i))));
+#endif
+		for (; i < count; ++i)
+			out[i] += weight * in[i];
+	}
+
+	void RunRows(TaskScheduler* scheduler, uint32_t rows, size_t texelsPerRow, const std::function<void(size_t, size_t)>& func)
+	{
+		// About 16K texels per task.
+		const size_t grain = std::max<size_t>(1, 16384 / std::max<size_t>(texelsPerRow, 1));
+		if (scheduler && rows > grain)
+			scheduler->ParallelFor(0, rows, grain, func);
+		else
+			func(0, rows);
+	}
+
+	void Downsample(const FloatImage& source, MipFilter filter, FloatImage& destination, TaskScheduler* scheduler)
+	{
+		destination.width = std::max(1u, source.width / 2);
+		destination.height = std::max(1u, source.height / 2);
+		const FilterTaps horizontal = ComputeTaps(filter, source.width, destination.width);
+		const FilterTaps vertical = ComputeTaps(filter, source.height, destination.height);
+
+		// Horizontal: source.width x source.height -> destination.width x source.height.
+		std::vector<float> rows(size_t(destination.width) * source.height * 4);
+		RunRows(scheduler, source.height, destination.width, [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; ++y)
+			{
+				const float* in = &source.texels[y * source.width * 4];
+				float* out = &rows[y * destination.width * 4];
+				for (uint32_t x = 0; x < destination.width; ++x)
+				{
+					FilterTexel(in, &horizontal.indices[size_t(x) * horizontal.maxTaps],
+						&horizontal.weights[size_t(x) * horizontal.maxTaps], horizontal.maxTaps, out + size_t(x) * 4);
+				}
+			}
+		});
+
+		// Vertical.
+		const size_t rowFloats = size_t(destination.width) * 4;
+		destination.texels.assign(rowFloats * destination.height, 0.0f);
+		RunRows(scheduler, destination.height, destination.width, [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; ++y)
+			{
+				float* out = &destination.texels[y * rowFloats];
+				for (int k = 0; k < vertical.maxTaps; ++k)
+				{
+					const float weight = vertical.weights[y * vertical.maxTaps + k];
+					if (weight != 0.0f)
+						AddScaledRow(out, &rows[size_t(vertical.indices[y * vertical.maxTaps + k]) * rowFloats], weight, rowFloats);
+				}
+			}
+		});
+	}
+}
+
+// =====================================================================================
+//										Mip chain
+// =====================================================================================
+
+uint32_t GetMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+		++count;
+	return count;
+}
+
+void GenerateMipChain(const SourceImage& image, MipFilter filter, bool srgb, TaskScheduler* scheduler,
+	std::vector<SourceImage>& outMips)
+{
+	outMips.clear();
+	if (filter == MipFilter::None)
+		return;
+
+	const SrgbTables& tables = GetSrgbTables();
+	const size_t texelCount = size_t(image.width) * image.height;
+
+	FloatImage level;
+	level.width = image.width;
+	level.height = image.height;
+	level.texels.resize(texelCount * 4);
+	for (size_t i = 0; i < texelCount * 4; ++i)
+	{
+		const uint8_t value = image.rgba[i];
+		level.texels[i] = srgb && (i & 3) != 3 ? tables.toLinear[value] : value * (1.0f / 255.0f);
+	}
+
+	const uint32_t mipCount = GetMipCount(image.width, image.height);
+	outMips.resize(mipCount - 1);
+	for (uint32_t mip = 1; mip < mipCount; ++mip)
+	{
+		FloatImage next;
+		Downsample(level, filter, next, scheduler);
+		level = std::move(next);
+
+		// Kaiser rings below 0 and above 1 at hard edges; quantization clamps.
+		SourceImage& out = outMips[mip - 1];
+		out.width = level.width;
+		out.height = level.height;
+		out.rgba.resize(size_t(level.width) * level.height * 4);
+		for (size_t i = 0; i < out.rgba.size(); ++i)
+			out.rgba[i] = srgb && (i & 3) != 3 ? EncodeSrgb(level.texels[i], tables) : EncodeUnorm(level.texels[i]);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+struct SourceImage;
+
+// =====================================================================================
+//										Mip chains
+// =====================================================================================
+
+// Every level is filtered from the one above it at float precision and halves the size
+//		(rounding down, at least 1) down to 1x1:
+//		Box		average of the texels the destination texel covers - exactly 2x2 for even
+//				sizes, partial texels weighted by their coverage for odd ones. The same
+//				footprint as Shaders/GenerateMips_CS.hlsl, which builds mips of textures
+//				rendered at runtime (Framework/MipGenerator.h): the two agree to within a
+//				step of 8 bit precision per level (the GPU filters the quantized level).
+//		Kaiser	Kaiser windowed sinc (radius 3 destination texels, alpha 4) - sharper,
+//				keeps detail the box filter blurs away. Edges clamp.
+//
+// sRGB color is filtered in linear space: averaging the encoded values darkens every
+//		level (a black/white checkerboard would turn 50% sRGB gray instead of the 73% that
+//		has the same brightness). Alpha is always linear.
+//
+// The filters are separable, horizontal then vertical pass, 4 channels per SSE
+//		instruction; rows are spread over the scheduler.
+enum class MipFilter : uint8_t
+{
+	None,
+	Box,
+	Kaiser,
+};
+
+// Number of levels of a full chain for a width x height image.
+uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+// Levels 1 to GetMipCount() - 1 of "image" (level 0 is the image itself) into "outMips".
+//		"scheduler" may be nullptr. MipFilter::None returns no levels.
+void GenerateMipChain(const SourceImage& image, MipFilter filter, bool srgb, TaskScheduler* scheduler,
+	std::vector<SourceImage>& outMips);
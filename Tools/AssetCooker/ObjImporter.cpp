@@ -0,0 +1,373 @@
+#include "MeshImporter.h"
+#include "TextParsing.h"
+
+#include "Framework/TaskScheduler.h"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace DirectX;
+
+
+// =====================================================================================
+//										OBJ chunks
+// =====================================================================================
+
+namespace
+{
+	// Files are split into chunks of about this size (at line boundaries) which are parsed
+	//		independently. Big enough that the per-chunk overhead vanishes, small enough that
+	//		a 100 MB scan keeps every core busy.
+	constexpr size_t OBJ_CHUNK_SIZE = 1 << 20;
+
+	enum ObjAttribute
+	{
+		OBJ_POSITION,
+		OBJ_UV,
+		OBJ_NORMAL,
+		OBJ_ATTRIBUTE_COUNT,
+	};
+
+	// One face corner as parsed: an index per attribute. Negative OBJ indices count back
+	//		from the elements read so far, which a chunk only knows relative to its own
+	//		start - those are stored relative (bit set in "relativeMask") and resolved once
+	//		the element counts of the previous chunks are known.
+	struct ObjCorner
+	{
+		int32_t index[OBJ_ATTRIBUTE_COUNT];
+		uint8_t presentMask;
+		uint8_t relativeMask;
+	};
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<XMFLOAT3> normals;
+		std::vector<ObjCorner> corners;
+		std::vector<uint32_t> faceSizes;
+		// Chunk relative line of every face, for error messages after the parse.
+		std::vector<uint32_t> faceLines;
+
+		// Lines parsed - on error, the line that failed.
+		uint32_t lineCount = 0;
+		std::string error;
+	};
+
+	bool IsObjSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	void ParseObjFloats(const char*& p, const char* end, float* out, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			p = SkipSpaces(p, end);
+			if (!ParseFloat(p, end, out[i]))
+				throw std::runtime_error("expected a number");
+		}
+	}
+
+	void ParseObjIndex(const char*& p, const char* end, size_t localCount, ObjCorner& corner, ObjAttribute attribute)
+	{
+		int64_t value;
+		if (!ParseInteger(p, end, value))
+			throw std::runtime_error("expected a vertex index");
+		if (value == 0 || value > INT32_MAX || value < -int64_t(INT32_MAX))
+			throw std::runtime_error("vertex index out of range");
+
+		corner.presentMask |= uint8_t(1 << attribute);
+		if (value > 0)
+		{
+			corner.index[attribute] = int32_t(value - 1);
+		}
+		else
+		{
+			corner.index[attribute] = int32_t(int64_t(localCount) + value);
+			corner.relativeMask |= uint8_t(1 << attribute);
+		}
+	}
+
+	void ParseObjChunk(ObjChunk& chunk)
+	{
+		const char* p = chunk.begin;
+		while (p < chunk.end)
+		{
+			const char* lineEnd = FindLineEnd(p, chunk.end);
+			const char* q = SkipSpaces(p, lineEnd);
+			const size_t remaining = size_t(lineEnd - q);
+
+			if (remaining >= 2 && q[0] == 'v' && IsObjSpace(q[1]))
+			{
+				XMFLOAT3 position;
+				q += 2;
+				ParseObjFloats(q, lineEnd, &position.x, 3);
+				chunk.positions.push_back(position);
+			}
+			else if (remaining >= 3 && q[0] == 'v' && q[1] == 't' && IsObjSpace(q[2]))
+			{
+				// OBJ has v = 0 at the bottom of the image, D3D at the top.
+				XMFLOAT2 uv;
+				q += 3;
+				ParseObjFloats(q, lineEnd, &uv.x, 2);
+				chunk.uvs.push_back(XMFLOAT2(uv.x, 1.0f - uv.y));
+			}
+			else if (remaining >= 3 && q[0] == 'v' && q[1] == 'n' && IsObjSpace(q[2]))
+			{
+				XMFLOAT3 normal;
+				q += 3;
+				ParseObjFloats(q, lineEnd, &normal.x, 3);
+				chunk.normals.push_back(normal);
+			}
+			else if (remaining >= 2 && q[0] == 'f' && IsObjSpace(q[1]))
+			{
+				uint32_t faceSize = 0;
+				q = SkipSpaces(q + 2, lineEnd);
+				while (q < lineEnd && *q != '\r' && *q != '#')
+				{
+					// p, p/t, p//n or p/t/n
+					ObjCorner corner = {};
+					ParseObjIndex(q, lineEnd, chunk.positions.size(), corner, OBJ_POSITION);
+					if (q < lineEnd && *q == '/')
+					{
+						++q;
+						if (q < lineEnd && *q != '/')
+							ParseObjIndex(q, lineEnd, chunk.uvs.size(), corner, OBJ_UV);
+						if (q < lineEnd && *q == '/')
+						{
+							++q;
+							ParseObjIndex(q, lineEnd, chunk.normals.size(), corner, OBJ_NORMAL);
+						}
+					}
+					if (q < lineEnd && !IsObjSpace(*q) && *q != '\r' && *q != '#')
+						throw std::runtime_error("unexpected character in face");
+
+					chunk.corners.push_back(corner);
+					++faceSize;
+					q = SkipSpaces(q, lineEnd);
+				}
+
+				if (faceSize < 3)
+					throw std::runtime_error("face with less than 3 vertices");
+				chunk.faceSizes.push_back(faceSize);
+				chunk.faceLines.push_back(chunk.lineCount);
+			}
+
+			p = lineEnd < chunk.end ? lineEnd + 1 : lineEnd;
+			++chunk.lineCount;
+		}
+	}
+
+	// Turns the chunk's corners into absolute 0 based indices. "bases" are the element
+	//		counts of all previous chunks, "totals" those of the whole file.
+	void ResolveObjChunk(ObjChunk& chunk, const size_t* bases, const size_t* totals)
+	{
+		size_t corner = 0;
+		for (size_t face = 0; face < chunk.faceSizes.size(); ++face)
+		{
+			for (uint32_t i = 0; i < chunk.faceSizes[face]; ++i, ++corner)
+			{
+				ObjCorner& c = chunk.corners[corner];
+				for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; ++attribute)
+				{
+					if (!(c.presentMask & (1 << attribute)))
+						continue;
+					int64_t index = c.index[attribute];
+					if (c.relativeMask & (1 << attribute))
+						index += int64_t(bases[attribute]);
+					if (index < 0 || index >= int64_t(totals[attribute]))
+					{
+						chunk.lineCount = chunk.faceLines[face];
+						throw std::runtime_error("index out of range");
+					}
+					c.index[attribute] = int32_t(index);
+				}
+			}
+		}
+	}
+
+	// Runs "function" on every chunk, in parallel if there is a scheduler. Errors are kept
+	//		per chunk (tasks must not throw), the first one in file order is rethrown with
+	//		its absolute line number.
+	template<typename Function>
+	void ForEachObjChunk(std::vector<ObjChunk>& chunks, TaskScheduler* scheduler, const Function& function)
+	{
+		auto run = [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				try
+				{
+					function(i);
+				}
+				catch (const std::exception& e)
+				{
+					chunks[i].error = e.what();
+				}
+			}
+		};
+		if (scheduler && chunks.size() > 1)
+			scheduler->ParallelFor(0, chunks.size(), 1, run);
+		else
+			run(0, chunks.size());
+
+		size_t firstLine = 1;
+		for (const ObjChunk& chunk : chunks)
+		{
+			if (!chunk.error.empty())
+				throw std::runtime_error("line " + std::to_string(firstLine + chunk.lineCount) + ": " + chunk.error);
+			firstLine += chunk.lineCount;
+		}
+	}
+
+	size_t HashObjCorner(const ObjCorner& corner)
+	{
+		uint32_t hash = uint32_t(corner.index[OBJ_POSITION]) * 0x9E3779B1u;
+		hash ^= uint32_t(corner.index[OBJ_UV]) * 0x85EBCA77u;
+		hash ^= uint32_t(corner.index[OBJ_NORMAL]) * 0xC2B2AE3Du;
+		hash ^= hash >> 15;
+		return hash;
+	}
+
+	bool SameObjVertex(const ObjCorner& a, const ObjCorner& b)
+	{
+		return a.index[OBJ_POSITION] == b.index[OBJ_POSITION] && a.index[OBJ_UV] == b.index[OBJ_UV] &&
+			a.index[OBJ_NORMAL] == b.index[OBJ_NORMAL];
+	}
+}
+
+// =====================================================================================
+//										OBJ import
+// =====================================================================================
+
+void ImportObj(const char* data, size_t size, SourceMesh& mesh, TaskScheduler* scheduler)
+{
+	mesh = SourceMesh();
+
+	// 1) Chunks, cut after the first newline past every OBJ_CHUNK_SIZE bytes.
+	std::vector<ObjChunk> chunks;
+	const char* end = data + size;
+	for (const char* p = data; p < end;)
+	{
+		const char* chunkEnd = end;
+		if (size_t(end - p) > OBJ_CHUNK_SIZE)
+		{
+			chunkEnd = FindLineEnd(p + OBJ_CHUNK_SIZE, end);
+			chunkEnd = chunkEnd < end ? chunkEnd + 1 : chunkEnd;
+		}
+		chunks.emplace_back();
+		chunks.back().begin = p;
+		chunks.back().end = chunkEnd;
+		p = chunkEnd;
+	}
+
+	// 2) Parse them independently.
+	ForEachObjChunk(chunks, scheduler, [&](size_t i) { ParseObjChunk(chunks[i]); });
+
+	// 3) Element counts before every chunk, concatenated attributes.
+	std::vector<size_t> bases(chunks.size() * OBJ_ATTRIBUTE_COUNT);
+	size_t totals[OBJ_ATTRIBUTE_COUNT] = {};
+	size_t cornerCount = 0, faceCount = 0;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		bases[i * OBJ_ATTRIBUTE_COUNT + OBJ_POSITION] = totals[OBJ_POSITION];
+		bases[i * OBJ_ATTRIBUTE_COUNT + OBJ_UV] = totals[OBJ_UV];
+		bases[i * OBJ_ATTRIBUTE_COUNT + OBJ_NORMAL] = totals[OBJ_NORMAL];
+		totals[OBJ_POSITION] += chunks[i].positions.size();
+		totals[OBJ_UV] += chunks[i].uvs.size();
+		totals[OBJ_NORMAL] += chunks[i].normals.size();
+		cornerCount += chunks[i].corners.size();
+		faceCount += chunks[i].faceSizes.size();
+	}
+	if (faceCount == 0)
+		throw std::runtime_error("no faces");
+
+	std::vector<XMFLOAT3> positions, normals;
+	std::vector<XMFLOAT2> uvs;
+	positions.reserve(totals[OBJ_POSITION]);
+	uvs.reserve(totals[OBJ_UV]);
+	normals.reserve(totals[OBJ_NORMAL]);
+	for (const ObjChunk& chunk : chunks)
+	{
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+	}
+
+	// 4) Absolute indices.
+	ForEachObjChunk(chunks, scheduler, [&](size_t i) { ResolveObjChunk(chunks[i], &bases[i * OBJ_ATTRIBUTE_COUNT], totals); });
+
+	// 5) One vertex per unique corner - open addressing over a power of two table with
+	//		at most 50% load, storing vertex index + 1 (0 = empty).
+	size_t tableSize = 1;
+	while (tableSize < cornerCount * 2)
+		tableSize *= 2;
+	std::vector<uint32_t> table(tableSize, 0);
+	std::vector<ObjCorner> vertices;
+	std::vector<uint32_t> polygon;
+	mesh.indices.reserve((cornerCount - 2 * faceCount) * 3);
+
+	for (const ObjChunk& chunk : chunks)
+	{
+		size_t corner = 0;
+		for (uint32_t faceSize : chunk.faceSizes)
+		{
+			polygon.clear();
+			for (uint32_t i = 0; i < faceSize; ++i, ++corner)
+			{
+				ObjCorner c = chunk.corners[corner];
+				// Absent attributes compare equal regardless of the garbage in their slot.
+				for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; ++attribute)
+					c.index[attribute] = (c.presentMask & (1 << attribute)) ? c.index[attribute] : -1;
+
+				size_t slot = HashObjCorner(c) & (tableSize - 1);
+				while (table[slot] && !SameObjVertex(vertices[table[slot] - 1], c))
+					slot = (slot + 1) & (tableSize - 1);
+				if (!table[slot])
+				{
+					vertices.push_back(c);
+					table[slot] = uint32_t(vertices.size());
+				}
+				polygon.push_back(table[slot] - 1);
+			}
+
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[i - 1]);
+				mesh.indices.push_back(polygon[i]);
+			}
+		}
+	}
+
+	// 6) An attribute is kept only if every corner has it.
+	bool hasUVs = !uvs.empty(), hasNormals = !normals.empty();
+	for (const ObjCorner& vertex : vertices)
+	{
+		hasUVs &= vertex.index[OBJ_UV] >= 0;
+		hasNormals &= vertex.index[OBJ_NORMAL] >= 0;
+	}
+
+	mesh.positions.resize(vertices.size());
+	if (hasUVs)
+		mesh.uvs.resize(vertices.size());
+	if (hasNormals)
+		mesh.normals.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		mesh.positions[i] = positions[vertices[i].index[OBJ_POSITION]];
+		if (hasUVs)
+			mesh.uvs[i] = uvs[vertices[i].index[OBJ_UV]];
+		if (hasNormals)
+		{
+			// The octahedral encoding needs unit normals.
+			XMFLOAT3 n = normals[vertices[i].index[OBJ_NORMAL]];
+			const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+			mesh.normals[i] = length > 0.0f ? XMFLOAT3(n.x / length, n.y / length, n.z / length) : XMFLOAT3(0.0f, 0.0f, 1.0f);
+		}
+	}
+}
@@ -0,0 +1,347 @@
+#include "TextParsing.h"
+
+#include <cstdlib> // std::strtod, std::strtof
+#include <cstring> // std::memcpy
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TEXT_PARSING_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace
+{
+	inline int FirstSetBit(uint32_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return int(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Exact powers of ten as doubles: 10^22 is the largest with a 53 bit mantissa.
+	const double POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+	constexpr int MAX_EXACT_POWER = 22;
+	constexpr int MAX_MANTISSA_DIGITS = 19;
+	constexpr uint64_t MAX_EXACT_MANTISSA = uint64_t(1) << 53;
+
+	// SWAR digit check and conversion of 8 ASCII digits (little endian load: the first
+	//		character is the lowest byte, the most significant digit).
+	inline bool IsEightDigits(uint64_t v)
+	{
+		return (((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+			0x3333333333333333ull);
+	}
+
+	inline uint32_t ParseEightDigits(uint64_t v)
+	{
+		v -= 0x3030303030303030ull;
+		// Pairs of digits, then quadruples, then all eight.
+		v = (v * 10) + (v >> 8);
+		v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+			(((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+		return uint32_t(v);
+	}
+
+	struct Decimal
+	{
+		uint64_t mantissa = 0;
+		int64_t exponent = 0;
+		int digits = 0;
+		bool negative = false;
+		// More significant digits than fit the mantissa.
+		bool truncated = false;
+	};
+
+	// Appends the digits at "p" to the decimal. "fraction" digits lower the exponent.
+	const char* ScanDigits(const char* p, const char* end, Decimal& decimal, bool fraction)
+	{
+		// Leading zeros aren't significant.
+		if (decimal.mantissa == 0)
+		{
+			while (p < end && *p == '0')
+			{
+				decimal.exponent -= fraction ? 1 : 0;
+				++p;
+			}
+		}
+
+		while (p + 8 <= end && decimal.digits + 8 <= MAX_MANTISSA_DIGITS)
+		{
+			uint64_t chunk;
+			std::memcpy(&chunk, p, 8);
+			if (!IsEightDigits(chunk))
+				break;
+			decimal.mantissa = decimal.mantissa * 100000000 + ParseEightDigits(chunk);
+			decimal.digits += 8;
+			decimal.exponent -= fraction ? 8 : 0;
+			p += 8;
+		}
+
+		for (; p < end && IsDigit(*p); ++p)
+		{
+			if (decimal.digits < MAX_MANTISSA_DIGITS)
+			{
+				decimal.mantissa = decimal.mantissa * 10 + uint64_t(*p - '0');
+				++decimal.digits;
+				decimal.exponent -= fraction ? 1 : 0;
+			}
+			else
+			{
+				// Dropped digit: integer digits still scale the value.
+				decimal.truncated |= *p != '0';
+				decimal.exponent += fraction ? 0 : 1;
+			}
+		}
+		return p;
+	}
+
+	// Returns the end of the number, nullptr if there is none at "p".
+	const char* ScanDecimal(const char* p, const char* end, Decimal& decimal)
+	{
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			decimal.negative = *p == '-';
+			++p;
+		}
+
+		const char* digitsStart = p;
+		p = ScanDigits(p, end, decimal, false);
+		bool anyDigit = p != digitsStart;
+		if (p < end && *p == '.')
+		{
+			const char* fractionStart = ++p;
+			p = ScanDigits(p, end, decimal, true);
+			anyDigit |= p != fractionStart;
+		}
+		if (!anyDigit)
+			return nullptr;
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* q = p + 1;
+			bool negativeExponent = false;
+			if (q < end && (*q == '-' || *q == '+'))
+			{
+				negativeExponent = *q == '-';
+				++q;
+			}
+			if (q < end && IsDigit(*q))
+			{
+				int64_t exponent = 0;
+				for (; q < end && IsDigit(*q); ++q)
+				{
+					// Saturate, 10^100000 is as infinite as 10^999999999.
+					if (exponent < 100000)
+						exponent = exponent * 10 + (*q - '0');
+				}
+				decimal.exponent += negativeExponent ? -exponent : exponent;
+				p = q;
+			}
+		}
+		return p;
+	}
+
+	// Exact when the mantissa and the power of ten are both exact doubles.
+	bool ToDoubleFast(const Decimal& decimal, double& value)
+	{
+		if (decimal.mantissa == 0)
+		{
+			value = decimal.negative ? -0.0 : 0.0;
+			return !decimal.truncated;
+		}
+		if (decimal.truncated || decimal.mantissa > MAX_EXACT_MANTISSA ||
+			decimal.exponent < -MAX_EXACT_POWER || decimal.exponent > MAX_EXACT_POWER)
+			return false;
+
+		value = double(decimal.mantissa);
+		value = decimal.exponent < 0 ? value / POWERS_OF_TEN[-decimal.exponent] : value * POWERS_OF_TEN[decimal.exponent];
+		value = decimal.negative ? -value : value;
+		return true;
+	}
+
+	// The C library on a zero terminated copy. Returns the end of the parsed token.
+	template<typename T, typename Parse>
+	const char* ParseWithLibrary(const char* p, const char* end, T& value, Parse parse)
+	{
+		// Longest plausible token: sign, digits, '.', 'e', exponent, or inf/nan words.
+		const char* tokenEnd = p;
+		while (tokenEnd < end && (IsDigit(*tokenEnd) || *tokenEnd == '.' || *tokenEnd == '-' || *tokenEnd == '+' ||
+			*tokenEnd == 'e' || *tokenEnd == 'E' || (*tokenEnd | 0x20) == 'i' || (*tokenEnd | 0x20) == 'n' ||
+			(*tokenEnd | 0x20) == 'f' || (*tokenEnd | 0x20) == 't' || (*tokenEnd | 0x20) == 'y' || (*tokenEnd | 0x20) == 'a'))
+			++tokenEnd;
+
+		const std::string token(p, tokenEnd);
+		char* parsedEnd = nullptr;
+		value = parse(token.c_str(), &parsedEnd);
+		if (parsedEnd == token.c_str())
+			return nullptr;
+		return p + (parsedEnd - token.c_str());
+	}
+}
+
+
+// =====================================================================================
+//										Text scanning
+// =====================================================================================
+
+const char* FindLineEnd(const char* p, const char* end)
+{
+#if defined(TEXT_PARSING_SSE)
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; p + 16 <= end; p += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const uint32_t mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+		if (mask)
+			return p + FirstSetBit(mask);
+	}
+#endif
+	while (p < end && *p != '\n')
+		++p;
+	return p;
+}
+
+const char* FindQuoteOrEscape(const char* p, const char* end)
+{
+#if defined(TEXT_PARSING_SSE)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	for (; p + 16 <= end; p += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+		const uint32_t mask = uint32_t(_mm_movemask_epi8(hits));
+		if (mask)
+			return p + FirstSetBit(mask);
+	}
+#endif
+	while (p < end && *p != '"' && *p != '\\')
+		++p;
+	return p;
+}
+
+const char* SkipWhitespace(const char* p, const char* end)
+{
+	// Mostly zero to a few characters (JSON between tokens) - check the first one before
+	//		paying for a vector load.
+	if (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		return p;
+
+#if defined(TEXT_PARSING_SSE)
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; p + 16 <= end; p += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const __m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, carriageReturn), _mm_cmpeq_epi8(chunk, newline)));
+		const uint32_t mask = ~uint32_t(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+		if (mask)
+			return p + FirstSetBit(mask);
+	}
+#endif
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+		++p;
+	return p;
+}
+
+const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+	return p;
+}
+
+// =====================================================================================
+//										Numbers
+// =====================================================================================
+
+bool ParseDouble(const char*& p, const char* end, double& value)
+{
+	Decimal decimal;
+	const char* numberEnd = ScanDecimal(p, end, decimal);
+	if (numberEnd && ToDoubleFast(decimal, value))
+	{
+		p = numberEnd;
+		return true;
+	}
+
+	const char* parsedEnd = ParseWithLibrary(p, end, value, [](const char* s, char** e) { return std::strtod(s, e); });
+	if (!parsedEnd)
+		return false;
+	p = parsedEnd;
+	return true;
+}
+
+bool ParseFloat(const char*& p, const char* end, float& value)
+{
+	Decimal decimal;
+	const char* numberEnd = ScanDecimal(p, end, decimal);
+	double fast;
+	if (numberEnd && ToDoubleFast(decimal, fast))
+	{
+		// Rounding the correctly rounded double to float again is exact unless the double
+		//		sits exactly on a midpoint between two floats (the exact value may have been
+		//		on either side). Midpoints are recognizable only for normal floats.
+		uint64_t bits;
+		std::memcpy(&bits, &fast, sizeof(bits));
+		const double magnitude = fast < 0.0 ? -fast : fast;
+		const bool midpoint = (bits & ((uint64_t(1) << 29) - 1)) == (uint64_t(1) << 28);
+		if (magnitude == 0.0 || (magnitude >= 1.1754943508222875e-38 && magnitude <= 3.4028234663852886e38 && !midpoint))
+		{
+			value = float(fast);
+			p = numberEnd;
+			return true;
+		}
+	}
+
+	const char* parsedEnd = ParseWithLibrary(p, end, value, [](const char* s, char** e) { return std::strtof(s, e); });
+	if (!parsedEnd)
+		return false;
+	p = parsedEnd;
+	return true;
+}
+
+bool ParseInteger(const char*& p, const char* end, int64_t& value)
+{
+	const char* q = p;
+	bool negative = false;
+	if (q < end && (*q == '-' || *q == '+'))
+	{
+		negative = *q == '-';
+		++q;
+	}
+	if (q >= end || !IsDigit(*q))
+		return false;
+
+	uint64_t magnitude = 0;
+	for (; q < end && IsDigit(*q); ++q)
+	{
+		if (magnitude > (uint64_t(INT64_MAX) - 9) / 10)
+			return false;
+		magnitude = magnitude * 10 + uint64_t(*q - '0');
+	}
+	value = negative ? -int64_t(magnitude) : int64_t(magnitude);
+	p = q;
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// =====================================================================================
+//										Text scanning
+// =====================================================================================
+
+// Scanning and number parsing for the importers. Everything works on [p, end) ranges of
+//		memory mapped files - nothing is assumed to be zero terminated, nothing reads past
+//		"end".
+//
+// The scanners test 16 bytes per step with SSE2 compares + movemask (scalar loop for the
+//		last < 16 bytes), so skipping comments, unused lines and long strings costs
+//		a fraction of a byte-by-byte loop.
+
+// First '\n' in [p, end), or end.
+const char* FindLineEnd(const char* p, const char* end);
+// First '"' or '\\' in [p, end), or end - the end of a plain run inside a JSON string.
+const char* FindQuoteOrEscape(const char* p, const char* end);
+// First character that isn't ' ', '\t', '\r' or '\n'.
+const char* SkipWhitespace(const char* p, const char* end);
+// First character that isn't ' ' or '\t' (stays on the line).
+const char* SkipSpaces(const char* p, const char* end);
+
+// =====================================================================================
+//										Numbers
+// =====================================================================================
+
+// Decimal floating point ("-1.25e-3", "7", ".5"; also "inf" and "nan"). On success "p"
+//		moves past the number. The result is correctly rounded, identical to strtof/strtod:
+//		- digits are gathered in a 64 bit integer, eight at a time with SWAR (one multiply
+//		  chain per 8 digits instead of 8 dependent multiply-adds),
+//		- up to 19 significant digits and exponents within 10^+-22 take the exact double
+//		  path (Clinger): mantissa and power of ten are both exact doubles, so one
+//		  multiplication or division rounds correctly,
+//		- for floats the double is rounded again, which is exact unless the double landed
+//		  exactly on a midpoint between two floats,
+//		- everything else (long mantissas, huge exponents, midpoints) falls back to the C
+//		  library on a copy of the token - rare in real data.
+bool ParseFloat(const char*& p, const char* end, float& value);
+bool ParseDouble(const char*& p, const char* end, double& value);
+
+// Optional sign and decimal digits, no overflow beyond int64.
+bool ParseInteger(const char*& p, const char* end, int64_t& value);
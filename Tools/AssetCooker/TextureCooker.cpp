@@ -0,0 +1,256 @@
+#include "TextureCooker.h"
+#include "CookerUtils.h"
+
+#include "Framework/AssetPackage.h"
+
+#include <cstring>   // std::memcpy
+#include <stdexcept>
+
+
+// =====================================================================================
+//										TGA loader
+// =====================================================================================
+
+void LoadTga(const std::vector<uint8_t>& file, SourceImage& image)
+{
+	const size_t HEADER_SIZE = 18;
+	if (file.size() < HEADER_SIZE)
+		throw std::runtime_error("truncated TGA header");
+
+	const uint8_t* header = file.data();
+	const uint32_t idLength = header[0];
+	const uint32_t colorMapType = header[1];
+	const uint32_t imageType = header[2];
+	const uint32_t colorMapLength = header[5] | (header[6] << 8);
+	const uint32_t colorMapEntryBits = header[7];
+	const uint32_t width = header[12] | (header[13] << 8);
+	const uint32_t height = header[14] | (header[15] << 8);
+	const uint32_t bitsPerPixel = header[16];
+	const uint32_t descriptor = header[17];
+
+	// 2/10 = true color (raw/RLE), 3/11 = grayscale (raw/RLE). No color mapped images.
+	const bool rle = imageType == 10 || imageType == 11;
+	const bool gray = imageType == 3 || imageType == 11;
+	if (imageType != 2 && imageType != 3 && !rle)
+		throw std::runtime_error("unsupported TGA image type " + std::to_string(imageType));
+	if ((gray && bitsPerPixel != 8) || (!gray && bitsPerPixel != 24 && bitsPerPixel != 32))
+		throw std::runtime_error("unsupported TGA pixel size " + std::to_string(bitsPerPixel));
+	if (width == 0 || height == 0)
+		throw std::runtime_error("empty TGA image");
+
+	const size_t bytesPerPixel = bitsPerPixel / 8;
+	const size_t pixelCount = size_t(width) * height;
+	size_t offset = HEADER_SIZE + idLength + (colorMapType ? colorMapLength * ((colorMapEntryBits + 7) / 8) : 0);
+
+	// Decode to the file's own pixel order first, BGR(A) or gray.
+	std::vector<uint8_t> pixels(pixelCount * bytesPerPixel);
+	if (!rle)
+	{
+		if (offset + pixels.size() > file.size())
+			throw std::runtime_error("truncated TGA pixel data");
+		std::memcpy(pixels.data(), file.data() + offset, pixels.size());
+	}
+	else
+	{
+		// Packets: a count byte, then either one pixel repeated (high bit set) or that many
+		//		raw pixels.
+		size_t pixel = 0;
+		while (pixel < pixelCount)
+		{
+			if (offset >= file.size())
+				throw std::runtime_error("truncated TGA RLE data");
+			const uint8_t packet = file[offset++];
+			const size_t count = (packet & 0x7F) + 1u;
+			const size_t bytes = packet & 0x80 ? bytesPerPixel : count * bytesPerPixel;
+			if (pixel + count > pixelCount || offset + bytes > file.size())
+				throw std::runtime_error("corrupt TGA RLE data");
+
+			if (packet & 0x80)
+			{
+				for (size_t i = 0; i < count; ++i)
+					std::memcpy(&pixels[(pixel + i) * bytesPerPixel], &file[offset], bytesPerPixel);
+			}
+			else
+			{
+				std::memcpy(&pixels[pixel * bytesPerPixel], &file[offset], bytes);
+			}
+			offset += bytes;
+			pixel += count;
+		}
+	}
+
+	// Descriptor bit 5: rows stored top to bottom (else bottom to top); bit 4: right to left.
+	const bool topToBottom = (descriptor & 0x20) != 0;
+	const bool rightToLeft = (descriptor & 0x10) != 0;
+
+	image.width = width;
+	image.height = height;
+	image.rgba.resize(pixelCount * 4);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint32_t sourceY = topToBottom ? y : height - 1 - y;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint32_t sourceX = rightToLeft ? width - 1 - x : x;
+			const uint8_t* in = &pixels[(size_t(sourceY) * width + sourceX) * bytesPerPixel];
+			uint8_t* out = &image.rgba[(size_t(y) * width + x) * 4];
+			if (gray)
+			{
+				out[0] = out[1] = out[2] = in[0];
+				out[3] = 255;
+			}
+			else
+			{
+				out[0] = in[2];
+				out[1] = in[1];
+				out[2] = in[0];
+				out[3] = bytesPerPixel == 4 ? in[3] : 255;
+			}
+		}
+	}
+}
+
+// =====================================================================================
+//										Texture cooking
+// =====================================================================================
+
+uint64_t TextureCookSettings::GetHash() const
+{
+	uint64_t hash = HashValue(srgb);
+	hash = HashValue(encoding, hash);
+	hash = HashValue(quality, hash);
+	return HashValue(mipFilter, hash);
+}
+
+namespace
+{
+	// 0 = fully transparent or opaque texels only, BC1 handles it; anything in between
+	//		needs a real alpha channel.
+	bool HasPartialAlpha(const SourceImage& image)
+	{
+		for (size_t i = 3; i < image.rgba.size(); i += 4)
+		{
+			if (image.rgba[i] != 0 && image.rgba[i] != 255)
+				return true;
+		}
+		return false;
+	}
+
+	uint32_t GetCookedFormat(TextureEncoding encoding, bool srgb)
+	{
+		switch (encoding)
+		{
+		case TextureEncoding::BC1:
+			return srgb ? COOKED_FORMAT_BC1_UNORM_SRGB : COOKED_FORMAT_BC1_UNORM;
+		case TextureEncoding::BC3:
+			return srgb ? COOKED_FORMAT_BC3_UNORM_SRGB : COOKED_FORMAT_BC3_UNORM;
+		case TextureEncoding::BC4:
+			return COOKED_FORMAT_BC4_UNORM;
+		case TextureEncoding::BC5:
+			return COOKED_FORMAT_BC5_UNORM;
+		case TextureEncoding::BC7:
+			return srgb ? COOKED_FORMAT_BC7_UNORM_SRGB : COOKED_FORMAT_BC7_UNORM;
+		default:
+			return srgb ? COOKED_FORMAT_R8G8B8A8_UNORM_SRGB : COOKED_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	BlockFormat GetBlockFormat(TextureEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case TextureEncoding::BC1:
+			return BlockFormat::BC1;
+		case TextureEncoding::BC3:
+			return BlockFormat::BC3;
+		case TextureEncoding::BC4:
+			return BlockFormat::BC4;
+		case TextureEncoding::BC5:
+			return BlockFormat::BC5;
+		default:
+			return BlockFormat::BC7;
+		}
+	}
+}
+
+void CookTexture(const SourceImage& image, const TextureCookSettings& settings, TaskScheduler* scheduler,
+	CookedTexture& outTexture)
+{
+	if (image.width == 0 || image.height == 0 || image.rgba.size() != size_t(image.width) * image.height * 4)
+		throw std::runtime_error("invalid image");
+
+	TextureEncoding encoding = settings.encoding;
+	if (encoding == TextureEncoding::BC1 && HasPartialAlpha(image))
+		encoding = TextureEncoding::BC3;
+	if (image.width % 4 != 0 || image.height % 4 != 0)
+		encoding = TextureEncoding::RGBA8;
+
+	std::vector<SourceImage> mips;
+	GenerateMipChain(image, settings.mipFilter, settings.srgb, scheduler, mips);
+
+	TextureAssetHeader& header = outTexture.header;
+	header = {};
+	header.width = image.width;
+	header.height = image.height;
+	header.arraySize = 1;
+	header.mipCount = uint32_t(1 + mips.size());
+	header.format = GetCookedFormat(encoding, settings.srgb);
+
+	// Lay the levels out one after the other, each at a placement aligned offset.
+	outTexture.subresources.resize(header.mipCount);
+	uint64_t size = 0;
+	for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+	{
+		const SourceImage& level = mip ? mips[mip - 1] : image;
+		TextureAssetSubresource& subresource = outTexture.subresources[mip];
+		subresource = {};
+		subresource.offset = AlignAssetOffset(size);
+		subresource.width = level.width;
+		subresource.height = level.height;
+		if (encoding == TextureEncoding::RGBA8)
+		{
+			subresource.rowCount = level.height;
+			subresource.rowPitch = uint32_t(AlignAssetOffset(size_t(level.width) * 4, ASSET_TEXTURE_PITCH_ALIGNMENT));
+		}
+		else
+		{
+			// A "row" of a block compressed subresource is a row of 4x4 blocks. Levels
+			//		below 4x4 still take a whole block.
+			subresource.rowCount = (level.height + 3) / 4;
+			subresource.rowPitch = uint32_t(AlignAssetOffset(((level.width + 3) / 4) * GetBlockSize(GetBlockFormat(encoding)),
+				ASSET_TEXTURE_PITCH_ALIGNMENT));
+		}
+		size = subresource.offset + uint64_t(subresource.rowPitch) * subresource.rowCount;
+	}
+
+	// Copy the rows into their pitched place or compress them there, the padding stays zero.
+	outTexture.data.assign(size_t(size), 0);
+	for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+	{
+		const SourceImage& level = mip ? mips[mip - 1] : image;
+		const TextureAssetSubresource& subresource = outTexture.subresources[mip];
+		uint8_t* out = &outTexture.data[size_t(subresource.offset)];
+		if (encoding == TextureEncoding::RGBA8)
+		{
+			for (uint32_t y = 0; y < level.height; ++y)
+			{
+				std::memcpy(out + size_t(y) * subresource.rowPitch, &level.rgba[size_t(y) * level.width * 4],
+					size_t(level.width) * 4);
+			}
+		}
+		else
+		{
+			CompressImage(GetBlockFormat(encoding), settings.quality, level.rgba.data(), level.width, level.height,
+				size_t(level.width) * 4, out, subresource.rowPitch, scheduler);
+		}
+	}
+}
+
+void WriteTexturePackage(const CookedTexture& texture, uint64_t settingsHash, std::vector<uint8_t>& outPackage)
+{
+	AssetPackageWriter writer(AssetType::Texture, settingsHash);
+	writer.AddSection(SectionType::TextureHeader, texture.header);
+	writer.AddSection(SectionType::Subresources, texture.subresources);
+	writer.AddSection(SectionType::TextureData, texture.data);
+	writer.Serialize(outPackage);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "MipChain.h"
+
+#include "Framework/AssetPackage.h"
+
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// =====================================================================================
+//										Source images
+// =====================================================================================
+
+// 8 bit RGBA, rows top to bottom, tightly packed.
+struct SourceImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> rgba;
+};
+
+// Truevision TGA: uncompressed or RLE, 8 bit grayscale, 24 or 32 bit color, either
+//		origin. Throws on anything else.
+void LoadTga(const std::vector<uint8_t>& file, SourceImage& image);
+
+// =====================================================================================
+//										Texture cooking
+// =====================================================================================
+
+// DXGI_FORMAT values of the formats the cooker writes - the cooker builds without the
+//		Windows SDK, so they are spelled out here.
+enum CookedTextureFormat : uint32_t
+{
+	COOKED_FORMAT_R8G8B8A8_UNORM = 28,
+	COOKED_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	COOKED_FORMAT_BC1_UNORM = 71,
+	COOKED_FORMAT_BC1_UNORM_SRGB = 72,
+	COOKED_FORMAT_BC3_UNORM = 77,
+	COOKED_FORMAT_BC3_UNORM_SRGB = 78,
+	COOKED_FORMAT_BC4_UNORM = 80,
+	COOKED_FORMAT_BC5_UNORM = 83,
+	COOKED_FORMAT_BC7_UNORM = 98,
+	COOKED_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+// How the texels are stored, see BlockCompression.h for the BCn formats:
+//		RGBA8	uncompressed,
+//		BC1		color (with 1 bit alpha); switches to BC3 if the image has partial alpha,
+//		BC3		color + alpha,
+//		BC4		red only - masks, roughness, ...,
+//		BC5		red + green - tangent space normal maps, the shader rebuilds z,
+//		BC7		color + alpha at BC3's size with much less error.
+// BC formats need the texture's width and height to be multiples of 4 in D3D12; other
+//		sizes are stored as RGBA8.
+enum class TextureEncoding : uint8_t
+{
+	RGBA8,
+	BC1,
+	BC3,
+	BC4,
+	BC5,
+	BC7,
+};
+
+struct TextureCookSettings
+{
+	// Color textures are sRGB, data textures (normal maps, masks) linear. BC4 and BC5
+	//		have no sRGB variant.
+	bool srgb = true;
+	TextureEncoding encoding = TextureEncoding::BC7;
+	BlockQuality quality = BlockQuality::Normal;
+	MipFilter mipFilter = MipFilter::Kaiser;
+
+	uint64_t GetHash() const;
+};
+
+// A cooked texture before it is written out: subresources laid out as in the package,
+//		rows padded to ASSET_TEXTURE_PITCH_ALIGNMENT.
+struct CookedTexture
+{
+	TextureAssetHeader header = {};
+	std::vector<TextureAssetSubresource> subresources;
+	std::vector<uint8_t> data;
+};
+
+// The full mip chain (or just the image with MipFilter::None), every level encoded as
+//		"settings" says. Mip generation and block compression are spread over "scheduler"
+//		(may be nullptr).
+void CookTexture(const SourceImage& image, const TextureCookSettings& settings, TaskScheduler* scheduler,
+	CookedTexture& outTexture);
+
+// Writes an AssetType::Texture package, ready for CopyTextureRegion from upload memory.
+void WriteTexturePackage(const CookedTexture& texture, uint64_t settingsHash, std::vector<uint8_t>& outPackage);